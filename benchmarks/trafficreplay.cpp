@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+// Replays a recording made with TrafficRecorder against a server and prints the latency deltas
+//
+//   trafficreplay <recording> <endpoint> [speed]
+//
+// speed is a multiple of the recorded rate - 1 as recorded (the default), 10 ten times as fast, 0 flat out
+#include <open62541cpp/open62541client.h>
+#include <open62541cpp/trafficrecorder.h>
+#include <cstdlib>
+#include <iostream>
+
+namespace opc = Open62541;
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "usage: trafficreplay <recording> <endpoint> [speed]" << std::endl;
+        return 1;
+    }
+    opc::TrafficReplayer replayer;
+    if (!replayer.load(argv[1])) {
+        std::cerr << "cannot load " << argv[1] << ": " << UA_StatusCode_name(replayer.lastError()) << std::endl;
+        return 1;
+    }
+    replayer.setSpeed((argc > 3) ? std::atof(argv[3]) : 1.0);
+    //
+    opc::Client client;
+    if (!client.connect(argv[2])) {
+        std::cerr << "cannot connect to " << argv[2] << std::endl;
+        return 1;
+    }
+    bool ok = replayer.replay(client);
+    replayer.report(std::cout);
+    if (!ok)
+        std::cout << "results differ from the recording: " << UA_StatusCode_name(replayer.lastError()) << std::endl;
+    client.disconnect();
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+// Micro-benchmarks of the wrapper layer - run with --benchmark_format=json for machine readable output
+#include <benchmark/benchmark.h>
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/propertytree.h>
+#include <open62541cpp/metrics.h>
+#include "rollingbuffer.hpp"
+
+namespace opc = Open62541;
+
+// TypeBase copy and assign
+static void BM_NodeIdCopy(benchmark::State& state)
+{
+    opc::NodeId a(2, "Plant.Line1.Motor.Speed");
+    for (auto _ : state) {
+        opc::NodeId b(a);
+        benchmark::DoNotOptimize(b.ref());
+    }
+}
+BENCHMARK(BM_NodeIdCopy);
+
+static void BM_NodeIdAssign(benchmark::State& state)
+{
+    opc::NodeId a(2, "Plant.Line1.Motor.Speed");
+    opc::NodeId b;
+    for (auto _ : state) {
+        b = a;
+        benchmark::DoNotOptimize(b.ref());
+    }
+}
+BENCHMARK(BM_NodeIdAssign);
+
+static void BM_VariantCopy(benchmark::State& state)
+{
+    opc::Variant a(std::string("a string value of typical length"));
+    for (auto _ : state) {
+        opc::Variant b(a);
+        benchmark::DoNotOptimize(b.ref());
+    }
+}
+BENCHMARK(BM_VariantCopy);
+
+// Variant construction per type
+template <typename T>
+static void BM_VariantConstruct(benchmark::State& state, T v)
+{
+    for (auto _ : state) {
+        opc::Variant a(v);
+        benchmark::DoNotOptimize(a.ref());
+    }
+}
+BENCHMARK_CAPTURE(BM_VariantConstruct, bool, true);
+BENCHMARK_CAPTURE(BM_VariantConstruct, int, 42);
+BENCHMARK_CAPTURE(BM_VariantConstruct, unsigned, 42u);
+BENCHMARK_CAPTURE(BM_VariantConstruct, uint64, UA_UInt64(42));
+BENCHMARK_CAPTURE(BM_VariantConstruct, double, 42.0);
+BENCHMARK_CAPTURE(BM_VariantConstruct, string, std::string("a string value of typical length"));
+
+// NodeId hashing and comparison
+static void BM_NodeIdHashNumeric(benchmark::State& state)
+{
+    opc::NodeId a(2, 12345);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.hash());
+    }
+}
+BENCHMARK(BM_NodeIdHashNumeric);
+
+static void BM_NodeIdHashString(benchmark::State& state)
+{
+    opc::NodeId a(2, "Plant.Line1.Motor.Speed");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.hash());
+    }
+}
+BENCHMARK(BM_NodeIdHashString);
+
+static void BM_NodeIdEqual(benchmark::State& state)
+{
+    opc::NodeId a(2, "Plant.Line1.Motor.Speed");
+    opc::NodeId b(2, "Plant.Line1.Motor.Speed");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(BM_NodeIdEqual);
+
+static void BM_NodeIdSetFind(benchmark::State& state)
+{
+    opc::NodeIdSet s;
+    for (unsigned i = 0; i < unsigned(state.range(0)); i++) {
+        s.put(opc::NodeId(2, i).get());
+    }
+    opc::NodeId k(2, unsigned(state.range(0) / 2));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s.find(k.get()));
+    }
+}
+BENCHMARK(BM_NodeIdSetFind)->Range(64, 64 << 10);
+
+// PropertyTree insert and find
+static std::string treePath(unsigned i) { return "Plant/Line" + std::to_string(i % 16) + "/Tag" + std::to_string(i); }
+
+static void BM_PropertyTreeInsert(benchmark::State& state)
+{
+    std::vector<std::string> paths;
+    for (unsigned i = 0; i < unsigned(state.range(0)); i++) {
+        paths.push_back(treePath(i));
+    }
+    for (auto _ : state) {
+        opc::PropertyTree<std::string, int> t;
+        for (size_t i = 0; i < paths.size(); i++) {
+            t.set(paths[i], int(i));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PropertyTreeInsert)->Range(64, 16 << 10);
+
+static void BM_PropertyTreeFind(benchmark::State& state)
+{
+    opc::PropertyTree<std::string, int> t;
+    for (unsigned i = 0; i < unsigned(state.range(0)); i++) {
+        t.set(treePath(i), int(i));
+    }
+    const std::string k = treePath(unsigned(state.range(0) / 2));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(t.get(k));
+    }
+}
+BENCHMARK(BM_PropertyTreeFind)->Range(64, 16 << 10);
+
+// statistics updates - the hot path metrics histogram
+static void BM_MetricsRecord(benchmark::State& state)
+{
+    UA_UInt64 ns = 0;
+    for (auto _ : state) {
+        opc::Metrics::record(opc::Metrics::DataSourceRead, ns);
+        ns = (ns + 977) & 0xFFFFF;
+    }
+}
+BENCHMARK(BM_MetricsRecord)->ThreadRange(1, 8);
+
+static void BM_MetricsScope(benchmark::State& state)
+{
+    for (auto _ : state) {
+        opc::Metrics::Scope s(opc::Metrics::DataSourceRead);
+    }
+}
+BENCHMARK(BM_MetricsScope);
+
+// rolling buffers and statistics of the OpcService examples
+static void BM_RollingBufferAdd(benchmark::State& state)
+{
+    MRL::RollingBuffer<double> b(int(state.range(0)));
+    double v = 0.0;
+    for (auto _ : state) {
+        b.addValue(time_t(1), v);  // a fixed time - the count window evicts
+        v += 0.5;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RollingBufferAdd)->Range(64, 16 << 10);
+
+static void BM_StatisticsBufferEvaluate(benchmark::State& state)
+{
+    MRL::StatisticsBuffer b(int(state.range(0)));
+    double v = 0.0;
+    for (int i = 0; i < int(state.range(0)); i++, v += 0.5) {
+        b.addValue(time_t(1), v);
+    }
+    for (auto _ : state) {
+        b.addValue(time_t(1), v);  // one new value per evaluation - as a sampled tag
+        v += 0.5;
+        benchmark::DoNotOptimize(b.evaluate().getMean());
+    }
+}
+BENCHMARK(BM_StatisticsBufferEvaluate)->Range(64, 16 << 10);
+
+static void BM_StatisticsSetValue(benchmark::State& state)
+{
+    MRL::Statistics s;
+    double v = 0.0;
+    for (auto _ : state) {
+        s.setValue(v);
+        v += 0.5;
+    }
+    benchmark::DoNotOptimize(s.getMean());
+}
+BENCHMARK(BM_StatisticsSetValue);
+
+// variantToString
+template <typename T>
+static void BM_VariantToString(benchmark::State& state, T v)
+{
+    opc::Variant a(v);
+    std::string out;
+    for (auto _ : state) {
+        opc::variantToString(a.get(), out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK_CAPTURE(BM_VariantToString, int, 42);
+BENCHMARK_CAPTURE(BM_VariantToString, double, 42.5);
+BENCHMARK_CAPTURE(BM_VariantToString, string, std::string("a string value of typical length"));
+
+BENCHMARK_MAIN();
@@ -0,0 +1,776 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/open62541client.h>
+#include <open62541cpp/clientsubscription.h>
+#include <open62541cpp/monitoreditem.h>
+#include <open62541cpp/eventfanout.h>
+#include <open62541cpp/serverrepeatedcallback.h>
+#include <open62541cpp/servertimedcallback.h>
+using namespace std;
+
+/*
+ * Condition, event and timer benchmark - the cost of raising, acknowledging and clearing conditions, event
+ * delivery throughput to event subscribers and the cost of registering and firing server timers.
+ *
+ * conditions - in process, no subscribers: create, raise, ack, clear and delete N conditions spread over a
+ *              number of source objects, each change one Condition::Transaction. Raised again through an
+ *              AlarmFloodFilter to show the cost of the filter and how much it drops
+ * events     - a server on a thread and N clients on localhost, each with an event monitored item on the Server
+ *              object, then the same N consumers sharing one item of one client through EventFanout
+ * timers     - N ServerRepeatedCallback timers and N one shot timers, on the C library scheduler and on the
+ *              timer wheel. One shot timers on the library are ServerTimedCallback, on the wheel
+ *              Server::addTimedEvent as ServerTimedCallback always uses the library
+ *
+ * Each result is written to stdout as one JSON object per line, e.g.
+ *   {"suite":"conditions","test":"raise","conditions":10000,"seconds":0.82,"rate":12195,"median_us":71,"p99_us":240}
+ *
+ * usage: ConditionBenchmark [--conditions n] [--sources n] [--flood n] [--subscribers n] [--events n] [--timers n]
+ *                           [--interval ms] [--duration ms] [--tick ms] [--port n] [suite ...]
+ * suites: conditions events timers - all by default. Counts are maxima - each suite steps up to them by factors
+ * of ten
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double>(b - a).count(); }
+
+/*!
+ * \brief residentBytes
+ * \return resident set size of the process, 0 if unknown
+ */
+static size_t residentBytes()
+{
+    size_t pages = 0;
+    size_t rss   = 0;
+    FILE* f      = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%zu %zu", &pages, &rss) != 2)
+            rss = 0;
+        fclose(f);
+    }
+    return rss * size_t(sysconf(_SC_PAGESIZE));
+}
+
+/*!
+ * \brief The Options struct
+ */
+struct Options {
+    size_t conditions  = 100000;
+    size_t sources     = 10;     // condition source objects
+    size_t flood       = 100;    // events per source per window through the flood filter
+    size_t subscribers = 100;
+    size_t events      = 10000;  // triggered per delivery run
+    size_t timers      = 100000;
+    unsigned interval  = 100;    // repeated timer interval ms
+    unsigned duration  = 3000;   // ms repeated timers are run for
+    unsigned tick      = 10;     // timer wheel tick ms
+    int port           = 4850;
+    std::vector<std::string> suites;
+};
+
+/*!
+ * \brief The Result class
+ * Builds one line of JSON
+ */
+class Result
+{
+    std::string _s;
+
+public:
+    Result(const std::string& suite, const std::string& test)
+        : _s("{\"suite\":\"" + suite + "\",\"test\":\"" + test + "\"")
+    {
+    }
+    Result& operator()(const char* k, double v)
+    {
+        char b[64];
+        snprintf(b, sizeof(b), "%.6g", v);
+        _s += std::string(",\"") + k + "\":" + b;
+        return *this;
+    }
+    Result& operator()(const char* k, const std::string& v)
+    {
+        _s += std::string(",\"") + k + "\":\"" + v + "\"";
+        return *this;
+    }
+    void print() { cout << _s << "}" << endl; }
+};
+
+/*!
+ * \brief percentile
+ * \param v sorted
+ * \param p
+ * \return
+ */
+static double percentile(const std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t i = size_t(p * double(v.size() - 1) + 0.5);
+    return v[std::min(i, v.size() - 1)];
+}
+
+/*!
+ * \brief steps
+ * \param from
+ * \param to
+ * \return from, 10 * from ... up to to, and to itself if it is not a step
+ */
+static std::vector<size_t> steps(size_t from, size_t to)
+{
+    std::vector<size_t> l;
+    for (size_t n = from; n < to; n *= 10)
+        l.push_back(n);
+    l.push_back(to);
+    return l;
+}
+
+/*!
+ * \brief timed
+ * Report a pass over a set of operations
+ * \param suite
+ * \param test
+ * \param key what was counted
+ * \param us sorted per operation times
+ * \param secs
+ * \param failed
+ */
+static void timed(const std::string& suite,
+                  const std::string& test,
+                  const char* key,
+                  const std::vector<double>& us,
+                  double secs,
+                  size_t failed)
+{
+    Result(suite, test)(key, double(us.size()))("seconds", secs)(
+        "rate", secs > 0.0 ? double(us.size()) / secs : 0.0)("median_us", percentile(us, 0.5))(
+        "p99_us", percentile(us, 0.99))("max_us", us.empty() ? 0.0 : us.back())("failed", double(failed))
+        .print();
+}
+
+/*!
+ * \brief iterate
+ * Run the server loop once without waiting on the network
+ * \param server
+ */
+static void iterate(Open62541::Server& server) { UA_Server_run_iterate(server.server(), false); }
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+/*!
+ * \brief The BenchCondition class
+ * No state callbacks - the benchmark drives the fields directly
+ */
+class BenchCondition : public Open62541::Condition
+{
+public:
+    BenchCondition(Open62541::Server& s, const Open62541::NodeId& c, const Open62541::NodeId& src)
+        : Condition(s, c, src)
+    {
+    }
+};
+
+/*!
+ * \brief change
+ * Commit the same change to every condition
+ * \param conditions
+ * \param f stages the change
+ * \param us per condition times - sorted on return
+ * \return failures
+ */
+static size_t change(std::vector<Open62541::Condition*>& conditions,
+                     std::function<void(Open62541::Condition::Transaction&)> f,
+                     std::vector<double>& us)
+{
+    size_t failed = 0;
+    us.clear();
+    us.reserve(conditions.size());
+    for (auto c : conditions) {
+        auto a = Clock::now();
+        Open62541::Condition::Transaction t(*c);
+        f(t);
+        if (!t.commit())
+            failed++;
+        us.push_back(seconds(a, Clock::now()) * 1e6);
+    }
+    std::sort(us.begin(), us.end());
+    return failed;
+}
+
+/*!
+ * \brief runConditions
+ * \param o
+ * \param count
+ */
+static void runConditions(const Options& o, size_t count)
+{
+    const std::string suite = "conditions";
+    Open62541::Server server(o.port);
+    UA_Server_run_startup(server.server());
+    //
+    // sources notify through the Server object so conditions are event sources
+    std::vector<Open62541::NodeId> sources;
+    for (size_t i = 0; i < std::max<size_t>(1, o.sources); i++) {
+        Open62541::ObjectAttributes obj;
+        obj.setDefault();
+        obj.setDisplayName("Source_" + std::to_string(i));
+        Open62541::QualifiedName qn(0, "Source_" + std::to_string(i));
+        Open62541::NodeId n;
+        n.notNull();
+        if (!server.addObjectNode(Open62541::NodeId::Null,
+                                  Open62541::NodeId::Objects,
+                                  Open62541::NodeId::Organizes,
+                                  qn,
+                                  Open62541::NodeId::BaseObjectType,
+                                  obj,
+                                  n)) {
+            cerr << "Failed to add source " << Open62541::toString(server.lastError()) << endl;
+            return;
+        }
+        Open62541::ExpandedNodeId ex(n.nameSpaceIndex(), n.numeric());
+        server.addReference(Open62541::NodeId::Server, Open62541::NodeId::HasNotifier, ex, true);
+        sources.push_back(n);
+    }
+    //
+    // create and enable
+    std::vector<Open62541::Condition*> conditions;
+    conditions.reserve(count);
+    std::vector<double> us;
+    us.reserve(count);
+    size_t failed = 0;
+    size_t rss0   = residentBytes();
+    auto start    = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        auto a                   = Clock::now();
+        Open62541::Condition_p c = nullptr;
+        if (server.createCondition<BenchCondition>(UA_NODEID_NUMERIC(0, UA_NS0ID_OFFNORMALALARMTYPE),
+                                                   "Condition_" + std::to_string(i),
+                                                   sources[i % sources.size()],
+                                                   c,
+                                                   Open62541::NodeId::HasComponent) &&
+            c) {
+            Open62541::Condition::Transaction t(*c);
+            t.setProperty("EnabledState", "Id", Open62541::Variant(true))
+                .setField("Retain", Open62541::Variant(true));
+            if (!t.commit(false))
+                failed++;
+            conditions.push_back(c);
+        }
+        else {
+            failed++;
+        }
+        us.push_back(seconds(a, Clock::now()) * 1e6);
+    }
+    double secs = seconds(start, Clock::now());
+    std::sort(us.begin(), us.end());
+    timed(suite, "create", "conditions", us, secs, failed);
+    size_t rss1 = residentBytes();
+    Result(suite, "memory")("conditions", double(conditions.size()))(
+        "resident_bytes", double(rss1 > rss0 ? rss1 - rss0 : 0))(
+        "resident_per_condition",
+        conditions.size() && (rss1 > rss0) ? double(rss1 - rss0) / double(conditions.size()) : 0.0)
+        .print();
+    //
+    // raise, acknowledge and clear - one event each
+    start  = Clock::now();
+    failed = change(
+        conditions,
+        [](Open62541::Condition::Transaction& t) {
+            t.setProperty("ActiveState", "Id", Open62541::Variant(true))
+                .setField("Severity", Open62541::Variant(UA_UInt16(500)));
+        },
+        us);
+    timed(suite, "raise", "conditions", us, seconds(start, Clock::now()), failed);
+    //
+    // walking the active list is what a refresh costs before any event is sent
+    size_t active = 0;
+    start         = Clock::now();
+    server.conditions().forEachActive([&active](Open62541::Condition&) { active++; });
+    Result(suite, "active_scan")("conditions", double(conditions.size()))("active", double(active))(
+        "seconds", seconds(start, Clock::now()))
+        .print();
+    //
+    start  = Clock::now();
+    failed = change(
+        conditions,
+        [](Open62541::Condition::Transaction& t) { t.setProperty("AckedState", "Id", Open62541::Variant(true)); },
+        us);
+    timed(suite, "ack", "conditions", us, seconds(start, Clock::now()), failed);
+    //
+    start  = Clock::now();
+    failed = change(
+        conditions,
+        [](Open62541::Condition::Transaction& t) {
+            t.setProperty("ActiveState", "Id", Open62541::Variant(false))
+                .setProperty("AckedState", "Id", Open62541::Variant(false));
+        },
+        us);
+    timed(suite, "clear", "conditions", us, seconds(start, Clock::now()), failed);
+    Result(suite, "active_after_clear")("conditions", double(conditions.size()))(
+        "active", double(server.conditions().activeCount()))
+        .print();
+    //
+    // a storm through the flood filter - each source may emit o.flood events per window
+    {
+        Open62541::AlarmFloodFilter filter(server);
+        Open62541::AlarmFloodFilter::Limits l;
+        l.floodCount  = unsigned(o.flood);
+        l.floodWindow = 60000;  // the whole storm falls in one window
+        filter.setDefaultLimits(l);
+        server.setAlarmFilter(&filter);
+        start  = Clock::now();
+        failed = change(
+            conditions,
+            [](Open62541::Condition::Transaction& t) {
+                t.setProperty("ActiveState", "Id", Open62541::Variant(true));
+            },
+            us);
+        double t                                           = seconds(start, Clock::now());
+        Open62541::AlarmFloodFilter::Statistics statistics = filter.statistics();
+        timed(suite, "raise_filtered", "conditions", us, t, failed);
+        Result(suite, "flood")("conditions", double(conditions.size()))("sources", double(sources.size()))(
+            "flood_count", double(o.flood))("emitted", double(statistics.emitted))(
+            "suppressed", double(statistics.suppressed))
+            .print();
+        server.setAlarmFilter(nullptr);
+    }
+    //
+    // delete
+    us.clear();
+    start = Clock::now();
+    for (auto c : conditions) {
+        Open62541::NodeId n = c->condition();  // c goes with the condition
+        auto a              = Clock::now();
+        server.deleteCondition(n);
+        us.push_back(seconds(a, Clock::now()) * 1e6);
+    }
+    secs = seconds(start, Clock::now());
+    std::sort(us.begin(), us.end());
+    timed(suite, "delete", "conditions", us, secs, server.conditions().size());
+}
+#endif
+
+/*!
+ * \brief The EventServer class
+ * Server run on its own thread for the event suite
+ */
+class EventServer : public Open62541::Server
+{
+    std::atomic<bool> _ready{false};
+
+public:
+    EventServer(int port)
+        : Server(port)
+    {
+    }
+    void initialise() { _ready = true; }
+    bool ready() const { return _ready; }
+};
+
+/*!
+ * \brief The EventClient struct
+ * A subscriber iterating on its own thread
+ */
+struct EventClient {
+    Open62541::Client client;
+    std::atomic<size_t> received{0};
+};
+
+/*!
+ * \brief addEventItem
+ * An event monitored item on the Server object with a queue deep enough for a burst
+ * \param s
+ * \param f
+ * \param queue
+ * \return true on success
+ */
+static bool addEventItem(Open62541::ClientSubscription& s, Open62541::monitorEventFunc f, UA_UInt32 queue)
+{
+    auto* m = new Open62541::MonitoredItemEvent(f, s);
+    m->setMonitorItem(Open62541::NodeId::Server, 2);
+    m->setClause(0, "Message");
+    m->setClause(1, "Severity");
+    m->monitorItem().get().requestedParameters.queueSize = queue;
+    Open62541::NodeId n(Open62541::NodeId::Server);
+    if (!m->addEvent(n)) {
+        delete m;
+        return false;
+    }
+    Open62541::MonitoredItemRef r(m);
+    return s.addMonitorItem(r) != 0;
+}
+
+/*!
+ * \brief subscribe
+ * \param c
+ * \return the new subscription or nullptr
+ */
+static Open62541::ClientSubscription* subscribe(Open62541::Client& c)
+{
+    Open62541::CreateSubscriptionRequest settings;
+    settings.get()                             = UA_CreateSubscriptionRequest_default();
+    settings.get().requestedPublishingInterval = 50.0;
+    settings.get().maxNotificationsPerPublish  = 0;  // unlimited
+    UA_UInt32 id                               = 0;
+    return c.addSubscription(id, &settings) ? c.subscription(id) : nullptr;
+}
+
+/*!
+ * \brief deliver
+ * Trigger a burst of events on the server and wait for every consumer to receive it
+ * \param o
+ * \param server
+ * \param received sum over the consumers
+ * \param expected
+ * \param test
+ * \param consumers
+ */
+static void deliver(const Options& o,
+                    EventServer& server,
+                    std::function<size_t()> received,
+                    size_t expected,
+                    const std::string& test,
+                    size_t consumers)
+{
+    std::atomic<size_t> triggered{0};
+    std::atomic<double> triggerSeconds{0.0};
+    const size_t batch = 1000;  // events per posted command
+    size_t before      = received();
+    auto start         = Clock::now();
+    for (size_t i = 0; i < o.events; i += batch) {
+        size_t n = std::min(batch, o.events - i);
+        auto f   = [n, &triggered, &triggerSeconds](Open62541::Server& s) {
+            auto a = Clock::now();
+            for (size_t j = 0; j < n; j++) {
+                Open62541::NodeId e;
+                if (s.setUpEvent(e, Open62541::NodeId::BaseEventType, "Benchmark", "ConditionBenchmark", 500))
+                    s.triggerEvent(e, Open62541::NodeId::Server);
+            }
+            triggerSeconds = triggerSeconds + seconds(a, Clock::now());
+            triggered += n;
+        };
+        while (!server.postCommand(f))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // a queue overflow drops events, so stop once the count has not moved for a while
+    size_t last    = 0;
+    auto moved     = Clock::now();
+    const double q = 5.0;
+    while (((received() - before) < expected) && (seconds(moved, Clock::now()) < q)) {
+        size_t r = received() - before;
+        if (r != last) {
+            last  = r;
+            moved = Clock::now();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    size_t delivered = received() - before;
+    double secs      = seconds(start, Clock::now());
+    while (triggered < o.events)  // the posted commands refer to this frame
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (delivered < expected)
+        secs -= q;  // the idle wait is not delivery time
+    double t = triggerSeconds;
+    Result("events", test)("subscribers", double(consumers))("events", double(triggered))(
+        "trigger_seconds", t)("trigger_rate", t > 0.0 ? double(triggered) / t : 0.0)("expected", double(expected))(
+        "delivered", double(delivered))("seconds", secs)("rate", secs > 0.0 ? double(delivered) / secs : 0.0)
+        .print();
+}
+
+/*!
+ * \brief runEvents
+ * \param o
+ * \param count subscribers
+ */
+static void runEvents(const Options& o, size_t count)
+{
+    EventServer server(o.port);
+    const UA_UInt32 queue                     = UA_UInt32(o.events);
+    server.serverConfig().queueSizeLimits.max = queue;  // the burst fits in the item queues
+    std::thread loop([&server] { server.start(); });
+    while (!server.ready())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const std::string url = "opc.tcp://localhost:" + std::to_string(o.port);
+    //
+    // one session and item per subscriber - the server filters and encodes each event N times
+    {
+        std::vector<std::unique_ptr<EventClient>> clients;
+        for (size_t i = 0; i < count; i++) {
+            std::unique_ptr<EventClient> c(new EventClient);
+            EventClient* p                   = c.get();
+            Open62541::ClientSubscription* s = c->client.connect(url) ? subscribe(c->client) : nullptr;
+            auto f = [p](Open62541::ClientSubscription&, Open62541::VariantArray&) { p->received++; };
+            if (!s || !addEventItem(*s, f, queue)) {
+                cerr << "Failed to subscribe client " << i << endl;
+                break;
+            }
+            clients.push_back(std::move(c));
+        }
+        std::atomic<bool> running{true};
+        std::vector<std::thread> threads;
+        for (auto& c : clients) {
+            EventClient* p = c.get();
+            threads.emplace_back([p, &running] {
+                while (running)
+                    p->client.runIterate(10);
+            });
+        }
+        deliver(
+            o,
+            server,
+            [&clients]() {
+                size_t n = 0;
+                for (auto& c : clients)
+                    n += c->received;
+                return n;
+            },
+            clients.size() * o.events,
+            "delivery",
+            clients.size());
+        running = false;
+        for (auto& t : threads)
+            t.join();
+        for (auto& c : clients)
+            c->client.disconnect();
+    }
+    //
+    // the same consumers sharing one item of one session
+    {
+        Open62541::Client client;
+        Open62541::ClientSubscription* s = client.connect(url) ? subscribe(client) : nullptr;
+        if (s) {
+            std::atomic<size_t> received{0};
+            Open62541::EventFanout::Select select(2);
+            select[0].browsePath = "Message";
+            select[1].browsePath = "Severity";
+            std::unique_ptr<Open62541::EventFanout> fanout(new Open62541::EventFanout(*s));
+            for (size_t i = 0; i < count; i++) {
+                fanout->add(Open62541::NodeId::Server,
+                            select,
+                            [&received](Open62541::ClientSubscription&, Open62541::VariantArray&) { received++; });
+            }
+            std::atomic<bool> running{true};
+            std::thread t([&client, &running] {
+                while (running)
+                    client.runIterate(10);
+            });
+            deliver(
+                o, server, [&received]() { return received.load(); }, count * o.events, "fanout", count);
+            running = false;
+            t.join();
+            fanout.reset();  // before the subscription
+            client.disconnect();
+        }
+        else {
+            cerr << "Failed to subscribe the fanout client" << endl;
+        }
+    }
+    server.stop();
+    loop.join();
+}
+
+/*!
+ * \brief runRepeated
+ * Register, fire and stop repeated timers
+ * \param o
+ * \param count
+ * \param wheel
+ */
+static void runRepeated(const Options& o, size_t count, bool wheel)
+{
+    const std::string scheduler = wheel ? "wheel" : "library";
+    Open62541::Server server(o.port);
+    if (wheel)
+        server.setTimerWheel(o.tick);
+    UA_Server_run_startup(server.server());
+    //
+    size_t fired = 0;  // the loop runs on this thread
+    std::vector<std::unique_ptr<Open62541::ServerRepeatedCallback>> timers;
+    timers.reserve(count);
+    size_t failed = 0;
+    size_t rss0   = residentBytes();
+    auto start    = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        timers.emplace_back(new Open62541::ServerRepeatedCallback(
+            server, o.interval, [&fired](Open62541::ServerRepeatedCallback&) { fired++; }));
+        if (!timers.back()->start())
+            failed++;
+    }
+    double secs = seconds(start, Clock::now());
+    size_t rss1 = residentBytes();
+    Result("timers", "register_repeated")("scheduler", scheduler)("timers", double(count))("seconds", secs)(
+        "ns_per_timer", count ? secs * 1e9 / double(count) : 0.0)(
+        "resident_per_timer", count && (rss1 > rss0) ? double(rss1 - rss0) / double(count) : 0.0)(
+        "failed", double(failed))
+        .print();
+    //
+    // fire - every timer is due once per interval, the loop should keep up
+    std::vector<double> us;
+    start = Clock::now();
+    while (seconds(start, Clock::now()) * 1000.0 < double(o.duration)) {
+        auto a = Clock::now();
+        iterate(server);
+        us.push_back(seconds(a, Clock::now()) * 1e6);
+    }
+    secs = seconds(start, Clock::now());
+    std::sort(us.begin(), us.end());
+    double expected = double(count) * secs * 1000.0 / double(o.interval);
+    Result("timers", "fire_repeated")("scheduler", scheduler)("timers", double(count))(
+        "interval_ms", double(o.interval))("seconds", secs)("fired", double(fired))("expected", expected)(
+        "rate", secs > 0.0 ? double(fired) / secs : 0.0)("iterations", double(us.size()))(
+        "iterate_median_us", percentile(us, 0.5))("iterate_p99_us", percentile(us, 0.99))
+        .print();
+    //
+    start = Clock::now();
+    for (auto& t : timers)
+        t->stop();
+    timers.clear();
+    secs = seconds(start, Clock::now());
+    Result("timers", "stop_repeated")("scheduler", scheduler)("timers", double(count))("seconds", secs)(
+        "ns_per_timer", count ? secs * 1e9 / double(count) : 0.0)
+        .print();
+}
+
+/*!
+ * \brief runOneShot
+ * Register and fire one shot timers due over one interval
+ * \param o
+ * \param count
+ * \param wheel
+ */
+static void runOneShot(const Options& o, size_t count, bool wheel)
+{
+    const std::string scheduler = wheel ? "wheel" : "library";
+    Open62541::Server server(o.port);
+    if (wheel)
+        server.setTimerWheel(o.tick);
+    UA_Server_run_startup(server.server());
+    //
+    std::vector<double> late;  // ms past due
+    late.reserve(count);
+    std::vector<std::unique_ptr<Open62541::ServerTimedCallback>> timers;
+    size_t failed       = 0;
+    const unsigned lead = 500;  // registration must finish before the first is due
+    size_t rss0         = residentBytes();
+    auto start          = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+        unsigned delay  = lead + unsigned(i % std::max(1U, o.interval));
+        UA_DateTime due = UA_DateTime_nowMonotonic() + UA_DateTime(delay) * UA_DATETIME_MSEC;
+        auto f          = [&late, due] {
+            late.push_back(double(UA_DateTime_nowMonotonic() - due) / double(UA_DATETIME_MSEC));
+        };
+        if (wheel) {
+            UA_UInt64 id = 0;
+            if (!server.addTimedEvent(delay, id, [f](Open62541::Server::Timer&) { f(); }))
+                failed++;
+        }
+        else {
+            timers.emplace_back(
+                new Open62541::ServerTimedCallback(server, [f](Open62541::ServerTimedCallback&) { f(); }));
+            timers.back()->addMilliSeconds(delay);
+            if (!timers.back()->start())
+                failed++;
+        }
+    }
+    double secs = seconds(start, Clock::now());
+    size_t rss1 = residentBytes();
+    Result("timers", "register_oneshot")("scheduler", scheduler)("timers", double(count))("seconds", secs)(
+        "ns_per_timer", count ? secs * 1e9 / double(count) : 0.0)(
+        "resident_per_timer", count && (rss1 > rss0) ? double(rss1 - rss0) / double(count) : 0.0)(
+        "failed", double(failed))
+        .print();
+    //
+    const double limit = double(lead + o.interval) / 1000.0 + 10.0;
+    start              = Clock::now();
+    while ((late.size() + failed < count) && (seconds(start, Clock::now()) < limit))
+        iterate(server);
+    secs = seconds(start, Clock::now());
+    std::sort(late.begin(), late.end());
+    Result("timers", "fire_oneshot")("scheduler", scheduler)("timers", double(count))("fired", double(late.size()))(
+        "seconds", secs)("late_median_ms", percentile(late, 0.5))("late_p99_ms", percentile(late, 0.99))(
+        "late_max_ms", late.empty() ? 0.0 : late.back())
+        .print();
+    timers.clear();  // before the server
+}
+
+/*!
+ * \brief main
+ * \return 0 on success
+ */
+int main(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more     = (i + 1) < argc;
+        if ((a == "--conditions") && more)
+            o.conditions = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--sources") && more)
+            o.sources = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--flood") && more)
+            o.flood = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--subscribers") && more)
+            o.subscribers = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--events") && more)
+            o.events = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--timers") && more)
+            o.timers = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--interval") && more)
+            o.interval = unsigned(std::max(1L, atol(argv[++i])));
+        else if ((a == "--duration") && more)
+            o.duration = unsigned(std::max(1L, atol(argv[++i])));
+        else if ((a == "--tick") && more)
+            o.tick = unsigned(std::max(1L, atol(argv[++i])));
+        else if ((a == "--port") && more)
+            o.port = int(atol(argv[++i]));
+        else if ((a == "-h") || (a == "--help")) {
+            cerr << "usage: " << argv[0]
+                 << " [--conditions n] [--sources n] [--flood n] [--subscribers n] [--events n] [--timers n]"
+                    " [--interval ms] [--duration ms] [--tick ms] [--port n] [conditions|events|timers ...]"
+                 << endl;
+            return 0;
+        }
+        else
+            o.suites.push_back(a);
+    }
+    if (o.suites.empty())
+        o.suites = {"conditions", "events", "timers"};
+    //
+    for (const auto& s : o.suites) {
+        if (s == "conditions") {
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+            for (size_t n : steps(1000, o.conditions))
+                runConditions(o, n);
+#else
+            cerr << "Alarms and conditions are not enabled in the stack" << endl;
+#endif
+        }
+        else if (s == "events") {
+            for (size_t n : steps(1, o.subscribers))
+                runEvents(o, n);
+        }
+        else if (s == "timers") {
+            for (size_t n : steps(10000, o.timers)) {
+                runRepeated(o, n, false);
+                runRepeated(o, n, true);
+                runOneShot(o, n, false);
+                runOneShot(o, n, true);
+            }
+        }
+        else {
+            cerr << "Unknown suite " << s << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
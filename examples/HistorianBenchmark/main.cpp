@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/historydatabase.h>
+#include <open62541cpp/compressedhistorian.h>
+#include <open62541cpp/mappedhistorian.h>
+#include <open62541cpp/tieredhistorian.h>
+using namespace std;
+
+/*
+ * Historian benchmark - ingest rate, raw read latency, memory per sample and continuation point paging for each
+ * history backend. The history database of each historian is driven directly, in process, so the figures are
+ * those of the history stack and not of the network.
+ *
+ * Each result is written to stdout as one JSON object per line, e.g.
+ *   {"backend":"memory","test":"ingest","nodes":100,"samples":10000,"seconds":0.41,"rate":2439024}
+ *
+ * usage: HistorianBenchmark [--nodes n] [--samples n] [--iterations n] [--dir path] [backend ...]
+ * backends: memory compressed mapped tiered - all by default. mapped needs a writable directory, /tmp by default
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double>(b - a).count(); }
+
+/*!
+ * \brief residentBytes
+ * \return resident set size of the process, 0 if unknown
+ */
+static size_t residentBytes()
+{
+    size_t pages = 0;
+    size_t rss   = 0;
+    FILE* f      = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%zu %zu", &pages, &rss) != 2)
+            rss = 0;
+        fclose(f);
+    }
+    return rss * size_t(sysconf(_SC_PAGESIZE));
+}
+
+/*!
+ * \brief removeDirectory
+ * Remove a directory of segment files
+ * \param path
+ * \return true on success
+ */
+static bool removeDirectory(const std::string& path)
+{
+    DIR* d = opendir(path.c_str());
+    if (!d)
+        return false;
+    while (struct dirent* e = readdir(d)) {
+        std::string f = e->d_name;
+        if ((f != ".") && (f != ".."))
+            ::remove((path + "/" + f).c_str());
+    }
+    closedir(d);
+    return ::rmdir(path.c_str()) == 0;
+}
+
+/*!
+ * \brief The Options struct
+ */
+struct Options {
+    size_t nodes      = 100;
+    size_t samples    = 10000;  // per node
+    size_t iterations = 50;     // reads per latency measurement
+    std::string dir   = "/tmp";
+    std::vector<std::string> backends;
+};
+
+/*!
+ * \brief The Bench struct
+ * One backend under test
+ */
+struct Bench {
+    std::string name;
+    std::unique_ptr<Open62541::Historian> historian;
+    std::function<size_t()> memoryUsed;  // bytes held as reported by the backend, if it can
+    std::string path;                    // segment directory of a persistent backend
+};
+
+/*!
+ * \brief The Result class
+ * Builds one line of JSON
+ */
+class Result
+{
+    std::string _s;
+
+public:
+    Result(const std::string& backend, const std::string& test)
+        : _s("{\"backend\":\"" + backend + "\",\"test\":\"" + test + "\"")
+    {
+    }
+    Result& operator()(const char* k, double v)
+    {
+        char b[64];
+        snprintf(b, sizeof(b), "%.6g", v);
+        _s += std::string(",\"") + k + "\":" + b;
+        return *this;
+    }
+    void print() { cout << _s << "}" << endl; }
+};
+
+/*!
+ * \brief The HistoryRead class
+ * A raw history read request as the HistoryRead service hands it to the database
+ */
+class HistoryRead
+{
+    std::vector<UA_HistoryReadValueId> _nodes;
+    UA_HistoryReadResponse _response;
+
+public:
+    HistoryRead(const std::vector<Open62541::NodeId>& nodes, size_t n)
+        : _nodes(n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            UA_HistoryReadValueId_init(&_nodes[i]);
+            _nodes[i].nodeId = *nodes[i].constRef();  // shallow
+        }
+        UA_HistoryReadResponse_init(&_response);
+    }
+    ~HistoryRead()
+    {
+        clear();
+        for (auto& r : _nodes)
+            UA_ByteString_clear(&r.continuationPoint);
+    }
+    void clear() { UA_HistoryReadResponse_clear(&_response); }
+    /*!
+     * \brief run
+     * \param db
+     * \param server
+     * \param details
+     * \return values read
+     */
+    size_t run(UA_HistoryDatabase& db, UA_Server* server, const UA_ReadRawModifiedDetails& details)
+    {
+        clear();
+        size_t n = _nodes.size();
+        _response.results =
+            static_cast<UA_HistoryReadResult*>(UA_Array_new(n, &UA_TYPES[UA_TYPES_HISTORYREADRESULT]));
+        _response.resultsSize = n;
+        std::vector<UA_HistoryData*> data(n);
+        for (size_t i = 0; i < n; i++) {
+            data[i]                                               = UA_HistoryData_new();
+            _response.results[i].historyData.encoding             = UA_EXTENSIONOBJECT_DECODED;
+            _response.results[i].historyData.content.decoded.type = &UA_TYPES[UA_TYPES_HISTORYDATA];
+            _response.results[i].historyData.content.decoded.data = data[i];
+        }
+        UA_RequestHeader header;
+        UA_RequestHeader_init(&header);
+        UA_NodeId session = UA_NODEID_NULL;
+        db.readRaw(server,
+                   db.context,
+                   &session,
+                   nullptr,
+                   &header,
+                   &details,
+                   UA_TIMESTAMPSTORETURN_BOTH,
+                   false,
+                   n,
+                   _nodes.data(),
+                   &_response,
+                   data.data());
+        size_t values = 0;
+        for (size_t i = 0; i < n; i++) {
+            values += data[i]->dataValuesSize;
+            // the next request continues from here
+            UA_ByteString_clear(&_nodes[i].continuationPoint);
+            UA_ByteString_copy(&_response.results[i].continuationPoint, &_nodes[i].continuationPoint);
+        }
+        return values;
+    }
+    bool more() const { return _nodes.size() && (_nodes[0].continuationPoint.length > 0); }
+};
+
+/*!
+ * \brief makeBench
+ * \param name
+ * \param o
+ * \param b set up on success
+ * \return true if the backend is known
+ */
+static bool makeBench(const std::string& name, const Options& o, Bench& b)
+{
+    b.name = name;
+    if (name == "memory") {
+        b.historian.reset(new Open62541::MemoryHistorian(o.nodes, o.samples));
+    }
+    else if (name == "compressed") {
+        auto* h = new Open62541::CompressedMemoryHistorian(o.nodes);
+        b.historian.reset(h);
+        b.memoryUsed = [h]() { return h->store().memoryUsed(); };
+    }
+    else if (name == "mapped") {
+        std::string t = o.dir + "/historianbenchXXXXXX";
+        std::vector<char> p(t.begin(), t.end());
+        p.push_back(0);
+        if (!mkdtemp(p.data())) {
+            cerr << "Cannot create a segment directory in " << o.dir << endl;
+            return false;
+        }
+        b.path  = p.data();
+        auto* h = new Open62541::MappedHistorian(b.path, o.nodes);
+        b.historian.reset(h);
+        if (!h->open()) {
+            cerr << "Cannot open the mapped store in " << b.path << endl;
+            return false;
+        }
+    }
+    else if (name == "tiered") {
+        // raw values are all kept so reads compare like with like - this measures the cost of the rollups
+        std::vector<Open62541::TieredHistoryBackend::Tier> tiers;
+        tiers.push_back(Open62541::TieredHistoryBackend::Tier(0, 0));
+        tiers.push_back(Open62541::TieredHistoryBackend::Tier(60 * UA_DATETIME_SEC, 0));
+        tiers.push_back(Open62541::TieredHistoryBackend::Tier(3600 * UA_DATETIME_SEC, 0));
+        auto* h = new Open62541::TieredMemoryHistorian(o.nodes, tiers);
+        b.historian.reset(h);
+        b.memoryUsed = [h]() { return h->store().memoryUsed(); };
+    }
+    else {
+        cerr << "Unknown backend " << name << endl;
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief percentile
+ * \param v sorted
+ * \param p
+ * \return
+ */
+static double percentile(const std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t i = size_t(p * double(v.size() - 1) + 0.5);
+    return v[std::min(i, v.size() - 1)];
+}
+
+/*!
+ * \brief run
+ * Run every test against one backend
+ * \param o
+ * \param b
+ */
+static void run(const Options& o, Bench& b)
+{
+    Open62541::Server server;
+    UA_Server* s = server.server();
+    UA_UInt16 ns = server.addNamespace("urn:historian:benchmark");
+    //
+    std::vector<Open62541::NodeId> nodes;
+    Open62541::Variant initial(0.0);
+    for (size_t i = 0; i < o.nodes; i++) {
+        Open62541::NodeId n(ns, unsigned(i + 1));
+        if (!server.addHistoricalVariable(Open62541::NodeId::Objects, "Bench_" + std::to_string(i), initial, n)) {
+            cerr << "Failed to create node " << i << endl;
+            return;
+        }
+        // whole windows fit in one response - the paging test sets its own page size
+        b.historian->setUpdateNode(n, server, o.samples + 2);
+        nodes.push_back(n);
+    }
+    UA_HistoryDatabase& db = b.historian->database();
+    //
+    // sustained ingest - one value per node per step, in time order
+    const UA_DateTime step = UA_DATETIME_SEC;
+    const UA_DateTime t0   = UA_DateTime_now() - UA_DateTime(o.samples) * step;
+    size_t rss0            = residentBytes();
+    UA_NodeId session      = UA_NODEID_NULL;
+    UA_DataValue v;
+    UA_DataValue_init(&v);
+    UA_Double d             = 0.0;
+    v.hasValue              = true;
+    v.hasSourceTimestamp    = true;
+    v.hasServerTimestamp    = true;
+    UA_Variant_setScalar(&v.value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);  // not owned
+    auto start = Clock::now();
+    for (size_t i = 0; i < o.samples; i++) {
+        v.sourceTimestamp = v.serverTimestamp = t0 + UA_DateTime(i) * step;
+        for (size_t n = 0; n < nodes.size(); n++) {
+            d = double(i % 1000) + 0.001 * double(n);
+            db.setValue(s, db.context, &session, nullptr, nodes[n].constRef(), true, &v);
+        }
+    }
+    double secs  = seconds(start, Clock::now());
+    size_t total = o.samples * o.nodes;
+    Result(b.name, "ingest")("nodes", double(o.nodes))("samples", double(total))("seconds", secs)(
+        "rate", secs > 0.0 ? double(total) / secs : 0.0)
+        .print();
+    //
+    // memory per sample - resident growth, and what the backend says it holds if it can
+    size_t rss1 = residentBytes();
+    Result r(b.name, "memory");
+    r("samples", double(total))("resident_bytes", double(rss1 > rss0 ? rss1 - rss0 : 0))(
+        "resident_per_sample", total && (rss1 > rss0) ? double(rss1 - rss0) / double(total) : 0.0);
+    if (b.memoryUsed) {
+        size_t m = b.memoryUsed();
+        r("backend_bytes", double(m))("backend_per_sample", total ? double(m) / double(total) : 0.0);
+    }
+    r.print();
+    //
+    // raw read latency of the latest window for a range of window sizes and node counts
+    UA_ReadRawModifiedDetails details;
+    UA_ReadRawModifiedDetails_init(&details);
+    const size_t windows[] = {10, 100, 1000, 10000, 100000};
+    const size_t counts[]  = {1, 10, 100, 1000};
+    for (size_t c : counts) {
+        if (c > o.nodes)
+            break;
+        for (size_t w : windows) {
+            if (w > o.samples)
+                break;
+            details.startTime        = t0 + UA_DateTime(o.samples - w) * step;
+            details.endTime          = t0 + UA_DateTime(o.samples - 1) * step;
+            details.numValuesPerNode = 0;
+            size_t iterations        = std::max<size_t>(3, std::min(o.iterations, size_t(2000000) / (w * c)));
+            std::vector<double> us;
+            size_t values = 0;
+            HistoryRead read(nodes, c);
+            for (size_t i = 0; i < iterations; i++) {
+                auto a = Clock::now();
+                values = read.run(db, s, details);
+                us.push_back(seconds(a, Clock::now()) * 1e6);
+            }
+            std::sort(us.begin(), us.end());
+            Result(b.name, "read_raw")("nodes", double(c))("window", double(w))("values", double(values))(
+                "iterations", double(iterations))("min_us", us.front())("median_us", percentile(us, 0.5))(
+                "p99_us", percentile(us, 0.99))
+                .print();
+        }
+    }
+    //
+    // continuation point paging - the whole history of one node a page at a time
+    const size_t pages[] = {100, 1000, 10000};
+    for (size_t p : pages) {
+        if (p >= o.samples)
+            break;
+        details.startTime        = t0;
+        details.endTime          = t0 + UA_DateTime(o.samples - 1) * step;
+        details.numValuesPerNode = UA_UInt32(p);
+        HistoryRead read(nodes, 1);
+        size_t requests = 0;
+        size_t values   = 0;
+        auto a          = Clock::now();
+        do {
+            values += read.run(db, s, details);
+            requests++;
+        } while (read.more() && (requests <= o.samples));
+        double t = seconds(a, Clock::now());
+        Result(b.name, "paging")("page", double(p))("values", double(values))("requests", double(requests))(
+            "seconds", t)("us_per_page", requests ? t * 1e6 / double(requests) : 0.0)(
+            "ns_per_value", values ? t * 1e9 / double(values) : 0.0)
+            .print();
+    }
+}
+
+/*!
+ * \brief main
+ * \return 0 on success
+ */
+int main(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more     = (i + 1) < argc;
+        if ((a == "--nodes") && more)
+            o.nodes = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--samples") && more)
+            o.samples = size_t(std::max(2L, atol(argv[++i])));
+        else if ((a == "--iterations") && more)
+            o.iterations = size_t(std::max(1L, atol(argv[++i])));
+        else if ((a == "--dir") && more)
+            o.dir = argv[++i];
+        else if ((a == "-h") || (a == "--help")) {
+            cerr << "usage: " << argv[0]
+                 << " [--nodes n] [--samples n] [--iterations n] [--dir path] [memory|compressed|mapped|tiered ...]"
+                 << endl;
+            return 0;
+        }
+        else
+            o.backends.push_back(a);
+    }
+    if (o.backends.empty())
+        o.backends = {"memory", "compressed", "mapped", "tiered"};
+    //
+    int ret = 0;
+    for (const std::string& name : o.backends) {
+        Bench b;
+        if (!makeBench(name, o, b)) {
+            if (!b.path.empty())
+                removeDirectory(b.path);
+            ret = 1;
+            continue;
+        }
+        run(o, b);
+        b.historian.reset();
+        if (!b.path.empty() && !removeDirectory(b.path))
+            cerr << "Segment directory " << b.path << " left behind" << endl;
+    }
+    return ret;
+}
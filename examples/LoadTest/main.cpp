@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/open62541client.h>
+#include <open62541cpp/clientsubscription.h>
+using namespace std;
+
+/*
+ * Load test - N clients doing a weighted mix of reads, writes, browses, method calls and subscriptions against a
+ * server with M variables. The server runs in process unless --url names one started elsewhere with the same
+ * options (LoadTest --serve). Throughput and latency percentiles of each operation are written to stdout every
+ * interval, one JSON object per line, e.g.
+ *   {"t":5,"op":"read","count":41210,"rate":8242,"p50us":310,"p99us":1450,"p999us":4100,"errors":0}
+ * and a line with "t":"total" for the whole run.
+ *
+ * usage: LoadTest [--clients n] [--nodes n] [--seconds n] [--interval n] [--port n] [--url url] [--serve]
+ *                 [--mix read,write,browse,call] [--monitored n] [--changes n] [--workers n]
+ * --mix weights the operations, 70,20,5,5 by default. --monitored items are subscribed per client; the server
+ * changes --changes variables every 100 ms to drive notifications
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* LoadNamespace = "urn:open62541cpp:loadtest";
+
+/*!
+ * \brief The Options struct
+ */
+struct Options {
+    size_t clients    = 8;
+    size_t nodes      = 1000;
+    size_t seconds    = 30;
+    size_t interval   = 5;     // seconds between reports
+    int port          = 4850;
+    std::string url;           // external server
+    bool serve        = false; // only run the server
+    unsigned mix[4]   = {70, 20, 5, 5};
+    size_t monitored  = 10;    // per client
+    size_t changes    = 100;   // per 100 ms
+    size_t workers    = 0;     // server worker threads
+};
+
+enum Op { Read = 0, Write, Browse, Call, Notify, OpCount };
+static const char* opNames[OpCount] = {"read", "write", "browse", "call", "notify"};
+
+/*!
+ * \brief The Samples class
+ * Latencies of one client - taken by the reporter each interval
+ */
+class Samples
+{
+    std::mutex _mutex;
+    std::vector<uint32_t> _us[OpCount];
+    size_t _errors[OpCount] = {};
+
+public:
+    void add(Op op, uint32_t us)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _us[op].push_back(us);
+    }
+    void error(Op op)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _errors[op]++;
+    }
+    void take(std::vector<uint32_t>* us, size_t* errors)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        for (int i = 0; i < OpCount; i++) {
+            us[i].insert(us[i].end(), _us[i].begin(), _us[i].end());
+            _us[i].clear();
+            errors[i] += _errors[i];
+            _errors[i] = 0;
+        }
+    }
+};
+
+/*!
+ * \brief The LoadServer class
+ * M double variables under a Load folder, an Echo method and a timer changing values
+ */
+class LoadServer : public Open62541::Server
+{
+    const Options& _options;
+    int _idx = 0;
+    Open62541::ServerMethod _echo;
+    Open62541::Argument _in;
+    Open62541::Argument _out;
+    std::atomic<bool> _ready{false};
+    std::atomic<bool> _failed{false};  // the address space could not be built
+    std::mt19937 _random;
+
+public:
+    LoadServer(const Options& o)
+        : Server(o.port)
+        , _options(o)
+        , _echo(
+              "Echo",
+              [](Open62541::Server&, const UA_NodeId*, size_t inputSize, const UA_Variant* input, size_t outputSize,
+                 UA_Variant* output) {
+                  if ((inputSize == 1) && (outputSize == 1))
+                      return UA_Variant_copy(&input[0], &output[0]);
+                  return UA_StatusCode(UA_STATUSCODE_BADARGUMENTSMISSING);
+              },
+              1,
+              1)
+    {
+        _echo.in()[0]  = _in.set(UA_TYPES_DOUBLE, "Value", "Value");
+        _echo.out()[0] = _out.set(UA_TYPES_DOUBLE, "Value", "Value");
+        setWorkerThreads(o.workers);
+    }
+    bool ready() const { return _ready; }
+    bool failed() const { return _failed; }
+    void initialise() override
+    {
+        if (build())
+            _ready = true;
+        else
+            _failed = true;
+    }
+
+private:
+    bool build()
+    {
+        _idx = addNamespace(LoadNamespace);
+        Open62541::NodeId folder(_idx, "Load");
+        if (!addFolder(Open62541::NodeId::Objects, "Load", folder, Open62541::NodeId::Null)) {
+            cerr << "Failed to add folder " << UA_StatusCode_name(lastError()) << endl;
+            return false;
+        }
+        for (size_t i = 0; i < _options.nodes; i++) {
+            const std::string name = "Tag" + std::to_string(i);
+            Open62541::NodeId n(_idx, unsigned(i + 1));
+            Open62541::Variant v(double(i));
+            if (!addVariable(folder, name, v, n, Open62541::NodeId::Null)) {
+                cerr << "Failed to add " << name << " " << UA_StatusCode_name(lastError()) << endl;
+                return false;
+            }
+        }
+        Open62541::NodeId methodId(_idx, "Echo");
+        if (!_echo.addServerMethod(*this, "Echo", folder, methodId, Open62541::NodeId::Null, _idx)) {
+            cerr << "Failed to add method " << UA_StatusCode_name(lastError()) << endl;
+            return false;
+        }
+        if (_options.changes > 0) {
+            UA_UInt64 id = 0;
+            addRepeatedTimerEvent(100, id, [this](Open62541::Server::Timer&) {
+                std::uniform_int_distribution<size_t> d(0, _options.nodes - 1);
+                for (size_t i = 0; i < _options.changes; i++) {
+                    Open62541::NodeId n(_idx, unsigned(d(_random) + 1));
+                    writeValue(n, Open62541::Variant(double(_random())));
+                }
+            });
+        }
+        return true;
+    }
+};
+
+/*!
+ * \brief The LoadClient class
+ * One simulated client on its own thread
+ */
+class LoadClient
+{
+    const Options& _options;
+    std::string _url;
+    Samples& _samples;
+    std::atomic<bool>& _stop;
+    unsigned _seed;
+
+    static uint32_t since(Clock::time_point t)
+    {
+        return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t).count());
+    }
+
+public:
+    LoadClient(const Options& o, const std::string& url, Samples& s, std::atomic<bool>& stop, unsigned seed)
+        : _options(o)
+        , _url(url)
+        , _samples(s)
+        , _stop(stop)
+        , _seed(seed)
+    {
+    }
+
+    void run()
+    {
+        Open62541::Client client;
+        if (!client.connect(_url)) {
+            cerr << "Failed to connect to " << _url << endl;
+            return;
+        }
+        const int idx = client.namespaceGetIndex(LoadNamespace);
+        if (idx < 1) {
+            cerr << "Load namespace not found at " << _url << endl;
+            return;
+        }
+        std::mt19937 random(_seed);
+        std::uniform_int_distribution<unsigned> node(1, unsigned(_options.nodes));
+        const unsigned total = _options.mix[0] + _options.mix[1] + _options.mix[2] + _options.mix[3];
+        std::uniform_int_distribution<unsigned> pick(0, std::max(1u, total) - 1);
+        Open62541::NodeId folder(idx, "Load");
+        Open62541::NodeId methodId(idx, "Echo");
+        //
+        // subscribe - the latency of a notification is the time since the value was timestamped
+        UA_UInt32 subId = 0;
+        if ((_options.monitored > 0) && client.addSubscription(subId)) {
+            Open62541::ClientSubscription& cs = *client.subscription(subId);
+            for (size_t i = 0; i < _options.monitored; i++) {
+                Open62541::NodeId n(idx, node(random));
+                cs.addMonitorNodeId(
+                    [this](Open62541::ClientSubscription&, UA_DataValue* v) {
+                        if (v && (v->hasSourceTimestamp || v->hasServerTimestamp)) {
+                            UA_DateTime d =
+                                UA_DateTime_now() - (v->hasSourceTimestamp ? v->sourceTimestamp : v->serverTimestamp);
+                            _samples.add(Notify, uint32_t(std::max<UA_DateTime>(0, d) / UA_DATETIME_USEC));
+                        }
+                    },
+                    n);
+            }
+        }
+        //
+        size_t n = 0;
+        while (!_stop) {
+            unsigned r = total ? pick(random) : 0;
+            Op op      = Read;
+            for (int i = 0; i < 4; i++) {
+                if (r < _options.mix[i]) {
+                    op = Op(i);
+                    break;
+                }
+                r -= _options.mix[i];
+            }
+            Open62541::NodeId target(idx, node(random));
+            Clock::time_point t = Clock::now();
+            bool ok             = false;
+            try {
+                switch (op) {
+                    case Read: {
+                        Open62541::Variant v;
+                        ok = client.readValueAttribute(target, v);
+                    } break;
+                    case Write: {
+                        Open62541::Variant v(double(n));
+                        ok = client.setValueAttribute(target, v);
+                    } break;
+                    case Browse: {
+                        Open62541::NodeIdSet s;
+                        ok = client.browseChildren(folder.get(), s);
+                    } break;
+                    case Call: {
+                        Open62541::Variant in(double(n));
+                        Open62541::VariantList args;
+                        args.push_back(in.get());  // shallow
+                        Open62541::VariantCallResult out;
+                        ok = client.callMethod(folder, methodId, args, out);
+                    } break;
+                    default:
+                        break;
+                }
+            }
+            catch (const std::exception& e) {
+                cerr << "Client exception " << e.what() << endl;
+                ok = false;
+            }
+            if (ok)
+                _samples.add(op, since(t));
+            else
+                _samples.error(op);
+            if ((++n % 16) == 0 && subId)
+                client.runIterate(0);  // deliver notifications
+        }
+        client.disconnect();
+    }
+};
+
+/*!
+ * \brief report
+ * Write one line per operation
+ * \param t label - seconds since start or "total"
+ * \param us latencies - sorted in place
+ * \param errors
+ * \param seconds length of the period
+ */
+static void report(const std::string& t, std::vector<uint32_t>* us, size_t* errors, double seconds)
+{
+    for (int i = 0; i < OpCount; i++) {
+        std::vector<uint32_t>& v = us[i];
+        if (v.empty() && !errors[i])
+            continue;
+        std::sort(v.begin(), v.end());
+        auto pct = [&v](double p) -> uint32_t { return v.empty() ? 0 : v[std::min(v.size() - 1, size_t(p * v.size()))]; };
+        char b[256];
+        snprintf(b,
+                 sizeof(b),
+                 "{\"t\":%s,\"op\":\"%s\",\"count\":%zu,\"rate\":%.0f,\"p50us\":%u,\"p99us\":%u,\"p999us\":%u,"
+                 "\"errors\":%zu}",
+                 t.c_str(),
+                 opNames[i],
+                 v.size(),
+                 seconds > 0 ? v.size() / seconds : 0.0,
+                 pct(0.5),
+                 pct(0.99),
+                 pct(0.999),
+                 errors[i]);
+        cout << b << endl;
+    }
+}
+
+/*!
+ * \brief parse
+ * \param argc
+ * \param argv
+ * \param o
+ * \return false on a bad argument
+ */
+static bool parse(int argc, char** argv, Options& o)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next     = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (a == "--clients")
+            o.clients = size_t(atol(next()));
+        else if (a == "--nodes")
+            o.nodes = std::max<size_t>(1, size_t(atol(next())));
+        else if (a == "--seconds")
+            o.seconds = size_t(atol(next()));
+        else if (a == "--interval")
+            o.interval = std::max<size_t>(1, size_t(atol(next())));
+        else if (a == "--port")
+            o.port = atoi(next());
+        else if (a == "--url")
+            o.url = next();
+        else if (a == "--serve")
+            o.serve = true;
+        else if (a == "--monitored")
+            o.monitored = size_t(atol(next()));
+        else if (a == "--changes")
+            o.changes = size_t(atol(next()));
+        else if (a == "--workers")
+            o.workers = size_t(atol(next()));
+        else if (a == "--mix") {
+            if (sscanf(next(), "%u,%u,%u,%u", &o.mix[0], &o.mix[1], &o.mix[2], &o.mix[3]) != 4)
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+    if (!parse(argc, argv, o)) {
+        cerr << "usage: LoadTest [--clients n] [--nodes n] [--seconds n] [--interval n] [--port n] [--url url] "
+                "[--serve] [--mix read,write,browse,call] [--monitored n] [--changes n] [--workers n]"
+             << endl;
+        return 1;
+    }
+    //
+    std::unique_ptr<LoadServer> server;
+    std::thread serverThread;
+    std::string url = o.url;
+    if (url.empty()) {
+        server.reset(new LoadServer(o));
+        if (o.serve) {
+            server->start();
+            return 0;
+        }
+        serverThread = std::thread([&server] { server->start(); });
+        const Clock::time_point deadline = Clock::now() + std::chrono::seconds(30);
+        while (!server->ready() && !server->failed() && (Clock::now() < deadline))
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (!server->ready()) {
+            cerr << (server->failed() ? "Server failed to initialise" : "Server not ready after 30s") << endl;
+            server->stop();
+            serverThread.join();
+            return 1;
+        }
+        url = "opc.tcp://localhost:" + std::to_string(o.port);
+    }
+    //
+    std::atomic<bool> stop{false};
+    std::vector<std::unique_ptr<Samples>> samples;
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < o.clients; i++) {
+        samples.emplace_back(new Samples);
+        Samples& s = *samples.back();
+        clients.emplace_back([&o, &url, &s, &stop, i] {
+            LoadClient c(o, url, s, stop, unsigned(i + 1));
+            c.run();
+        });
+    }
+    //
+    std::vector<uint32_t> all[OpCount];
+    size_t allErrors[OpCount] = {};
+    Clock::time_point start   = Clock::now();
+    for (size_t t = o.interval; t <= o.seconds; t += o.interval) {
+        std::this_thread::sleep_until(start + std::chrono::seconds(t));
+        std::vector<uint32_t> us[OpCount];
+        size_t errors[OpCount] = {};
+        for (auto& s : samples)
+            s->take(us, errors);
+        report(std::to_string(t), us, errors, double(o.interval));
+        for (int i = 0; i < OpCount; i++) {
+            all[i].insert(all[i].end(), us[i].begin(), us[i].end());
+            allErrors[i] += errors[i];
+        }
+    }
+    stop = true;
+    for (auto& c : clients)
+        c.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& s : samples)
+        s->take(all, allErrors);
+    report("\"total\"", all, allErrors, elapsed);
+    //
+    if (server) {
+        server->stop();
+        serverThread.join();
+    }
+    return 0;
+}
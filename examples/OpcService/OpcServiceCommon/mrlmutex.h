@@ -4,11 +4,12 @@
 #include <boost/thread.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/bind.hpp>
+#include <open62541cpp/lockpolicy.h>
 namespace MRL {
 
-// Mutexs - tree access needs to be thread safe
-typedef boost::shared_mutex ReadWriteMutex;
-typedef boost::shared_lock<boost::shared_mutex> ReadLock;
-typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+// Mutexs - tree access needs to be thread safe. The lock policy is the library's - see lockpolicy.h
+typedef Open62541::ReadWriteMutex ReadWriteMutex;
+typedef Open62541::ReadLock ReadLock;
+typedef Open62541::WriteLock WriteLock;
 }  // namespace MRL
 #endif  // MRLMUTEX_H
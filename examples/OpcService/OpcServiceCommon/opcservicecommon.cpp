@@ -14,6 +14,7 @@ MRL::OpcServiceCommon::OpcServiceCommon()
     _data.set(STOCKDEFS::SettingsSection, true);
     _data.set(STOCKDEFS::ConfigureSection, true);
     _data.set(STOCKDEFS::RuntimeSection, true);
+    _data.setJournal(JournalSize);  // web sessions pull changes
 }
 
 /*!
@@ -34,6 +35,7 @@ bool MRL::OpcServiceCommon::loadConfiguration(const std::string& n)
             if (stringToJson(strStream.str(), v)) {
                 auto n = data().node(STOCKDEFS::ConfigureSection);
                 data().fromJson(n, v);
+                data().invalidateJournal();
                 return true;
             }
         }
@@ -60,6 +62,7 @@ bool MRL::OpcServiceCommon::loadSettings()
             if (stringToJson(strStream.str(), v)) {
                 auto n = data().node(STOCKDEFS::SettingsSection);
                 data().fromJson(n, v);
+                data().invalidateJournal();
                 return true;
             }
         }
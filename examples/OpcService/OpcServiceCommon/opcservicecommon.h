@@ -12,6 +12,8 @@ namespace MRL {
 
 // the root directory
 constexpr const char* RootDir = "/usr/local/MRL5/OpcService";
+// changes of the shared data kept for web sessions
+constexpr size_t JournalSize = 4096;
 /*!
     \brief The OpcServiceCommon class
     singletons shared by objects
@@ -19,6 +19,8 @@
 #include <ostream>
 #include <functional>
 #include <list>
+#include <atomic>
+#include <unordered_map>
 
 namespace MRL {
 
@@ -195,14 +197,18 @@ public:
         \param s browse name of child to find
         \return pointer to child or nullptr
     */
-    Node* child(const K& s) { return _children[s]; }
+    Node* child(const K& s)
+    {
+        auto i = _children.find(s);
+        return (i != _children.end()) ? i->second : nullptr;
+    }
 
     /*!
         \brief hasChild
         \param s browse name of child
         \return true if child exists
     */
-    bool hasChild(const K& s) { return _children[s] != nullptr; }
+    bool hasChild(const K& s) { return child(s) != nullptr; }
     /*!
         \brief addChild
         \param key browse name of child
@@ -459,31 +465,251 @@ public:
         n->setData(data());
         if (children().size() > 0) {
             for (auto i = children().begin(); i != children().end(); i++) {
-                Node* c = new Node();
-                c->addChild(n);        // add the child
-                i->second->copyTo(c);  // now recurse
+                if (i->second) {
+                    Node* c = new Node(i->first, n);
+                    n->addChild(c);        // add the child
+                    i->second->copyTo(c);  // now recurse
+                }
             }
         }
     }
 };
 
-template <typename K, typename T>
 /*!
- * \brief The PropertyTree class
- */
+    \brief The PathIndex class
+    Full path hash to node index for a PropertyTree - a complete path resolves with one probe instead of a
+    child lookup per element. A probe is checked against the names up the node's parents, so a hash
+    collision costs a compare, never a wrong node. Nodes must leave the tree through the tree (remove,
+    clear) while it is indexed, or the index is left holding them
+*/
+template <typename K, typename N>
+class PathIndex
+{
+    std::unordered_multimap<size_t, N*> _map;
+
+    static bool matches(const N* n, const NodePath<K>& p, const N* root)
+    {
+        for (auto i = p.rbegin(); i != p.rend(); i++) {
+            if (!n || (n == root) || !(n->name() == *i))
+                return false;
+            n = n->parent();
+        }
+        return n == root;
+    }
+
+public:
+    /*!
+        \brief combine
+        \param h hash of the parent path
+        \param k child name
+        \return hash of the child path
+    */
+    static size_t combine(size_t h, const K& k) { return h ^ (std::hash<K>()(k) + 0x9e3779b9 + (h << 6) + (h >> 2)); }
+    /*!
+        \brief hashOf
+        \param p path
+        \return path hash - pass to the PropertyTree overloads that take one to skip hashing a path again
+    */
+    static size_t hashOf(const NodePath<K>& p)
+    {
+        size_t h = 0;
+        for (auto i = p.begin(); i != p.end(); i++) {
+            h = combine(h, *i);
+        }
+        return h;
+    }
+    /*!
+        \brief hashOf
+        \param n node
+        \param root root of the tree
+        \return hash of the path of n from root
+    */
+    static size_t hashOf(const N* n, const N* root)
+    {
+        return (!n || (n == root)) ? 0 : combine(hashOf(n->parent(), root), n->name());
+    }
+    /*!
+        \brief find
+        \param p path
+        \param h hash of p
+        \param root
+        \return node or nullptr if not indexed
+    */
+    N* find(const NodePath<K>& p, size_t h, const N* root) const
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (matches(i->second, p, root))
+                return i->second;
+        }
+        return nullptr;
+    }
+    /*!
+        \brief insert
+        \param h path hash
+        \param n
+    */
+    void insert(size_t h, N* n)
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (i->second == n)
+                return;
+        }
+        _map.emplace(h, n);
+    }
+    /*!
+        \brief insertTree
+        Index a node and its subtree
+        \param h path hash of n
+        \param n
+    */
+    void insertTree(size_t h, N* n)
+    {
+        insert(h, n);
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second)
+                insertTree(combine(h, i->first), i->second);
+        }
+    }
+    /*!
+        \brief eraseTree
+        Drop a node and its subtree
+        \param h path hash of n
+        \param n
+    */
+    void eraseTree(size_t h, N* n)
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (i->second == n) {
+                _map.erase(i);
+                break;
+            }
+        }
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second)
+                eraseTree(combine(h, i->first), i->second);
+        }
+    }
+    /*!
+        \brief build
+        Index every node below root
+        \param root
+    */
+    void build(N* root)
+    {
+        _map.clear();
+        for (auto i = root->children().begin(); i != root->children().end(); i++) {
+            if (i->second)
+                insertTree(combine(0, i->first), i->second);
+        }
+    }
+    void clear() { _map.clear(); }
+    size_t size() const { return _map.size(); }
+};
+
+/*!
+    \brief The PropertyTree class
+    Locking is per branch - a subtree of the root. Operations hold the tree mutex shared and the lock of
+    the branch they touch, so writers to different branches run in parallel and readers only wait for
+    writers to their own branch. Making or removing a branch, clear, read and iterateNodes hold the tree
+    mutex exclusively. Branches share BranchLocks locks by the hash of their name
+*/
+template <typename K, typename T>
 class PropertyTree
 {
-    mutable ReadWriteMutex _mutex;  //!< mutex for read/write access
-    bool _changed = false;          //!< track if any action may have changed the tree
 public:
-    //
-    T _defaultData;  //!< default data to be returned
+    enum { BranchLocks = 32 };  // power of two
+
+private:
+    mutable ReadWriteMutex _mutex;
+    mutable ReadWriteMutex _branch[BranchLocks];
+    std::atomic<bool> _changed{false};
+
+public:
+    T _defaultData;
     typedef Node<K, T> PropertyNode;
     typedef NodePath<K> Path;
-    //
+    typedef PathIndex<K, PropertyNode> Index;
+
 private:
-    PropertyNode _empty;  //!< empty node
-    PropertyNode _root;   //!< the root node
+    PropertyNode _empty;          // empty node
+    PropertyNode _root;           // the root node
+    Index _index[BranchLocks];    // full path index when enabled - one per branch lock
+    bool _indexed = false;
+
+    static const Path& toPath(const Path& p) { return p; }
+    static Path toPath(const K& s)
+    {
+        Path p;
+        p.toList(s);
+        return p;
+    }
+    static size_t branch(const K& k) { return std::hash<K>()(k) & (BranchLocks - 1); }
+    // name of the branch holding n
+    const K& branchOf(PropertyNode* n) const
+    {
+        while (n->parent() && (n->parent() != &_root)) {
+            n = n->parent();
+        }
+        return n->name();
+    }
+    // caller holds the tree lock shared and the branch lock, or the tree lock exclusively
+    PropertyNode* lookup(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return nullptr;
+        if (_indexed) {
+            PropertyNode* n = _index[branch(path.front())].find(path, h, &_root);
+            if (n)
+                return n;  // nodes added through the node API are not indexed - walk for those
+        }
+        return _root.find(path);
+    }
+    // caller holds the branch lock exclusively or the tree lock exclusively
+    PropertyNode* addPath(const Path& path, size_t h)
+    {
+        PropertyNode* n = lookup(path, h);
+        if (!n) {
+            n = _root.add(path);
+            if (_indexed) {
+                // index the path and any parents made on the way
+                Index& x        = _index[branch(path.front())];
+                PropertyNode* c = n;
+                size_t hc       = h;
+                for (auto i = path.rbegin(); (i != path.rend()) && c && (c != &_root); i++) {
+                    x.insert(hc, c);
+                    c  = c->parent();
+                    hc = Index::hashOf(c, &_root);
+                }
+            }
+        }
+        return n;
+    }
+    // caller holds the tree lock exclusively
+    void buildIndex()
+    {
+        for (size_t i = 0; i < BranchLocks; i++) {
+            _index[i].clear();
+        }
+        if (_indexed) {
+            for (auto i = _root.children().begin(); i != _root.children().end(); i++) {
+                if (i->second)
+                    _index[branch(i->first)].insertTree(Index::combine(0, i->first), i->second);
+            }
+        }
+    }
+protected:
+    // hold every branch shared - tree lock first then branches in order, as everywhere else
+    void lockBranches(std::vector<ReadLock>& l) const
+    {
+        l.reserve(BranchLocks);
+        for (size_t i = 0; i < BranchLocks; i++) {
+            l.emplace_back(_branch[i]);
+        }
+    }
+
 public:
     /*!
         \brief PropertyTree
@@ -501,179 +727,313 @@ public:
 
     /*!
         \brief mutex
-        \return mutex
+        Held exclusively this excludes every operation, held shared it excludes only the tree wide ones
+        \return
     */
     ReadWriteMutex& mutex() { return _mutex; }
+    /*!
+        \brief branchMutex
+        \param name name of a child of the root
+        \return the lock of the branch
+    */
+    ReadWriteMutex& branchMutex(const K& name) const { return _branch[branch(name)]; }
+    /*!
+        \brief pathMutex
+        \param path path or path string, not empty
+        \return the lock of the branch holding the path - hold it with mutex() shared to read the node
+    */
+    template <typename P>
+    ReadWriteMutex& pathMutex(const P& path) const
+    {
+        const Path& p = toPath(path);
+        return branchMutex(p.empty() ? K() : p.front());
+    }
     /*!
         \brief changed
-        \return changed flag
+        \return
     */
     bool changed() const { return _changed; }
     /*!
         \brief clearChanged
-        Clears the changed flag
     */
     void clearChanged() { _changed = false; }
     /*!
         \brief setChanged
-        \param f value to set the changed flag to
+        \param f
     */
     void setChanged(bool f = true) { _changed = f; }
     /*!
         \brief clear
-        clear / delete all nodes (other than root) from the tree
     */
     void clear()
     {
         WriteLock l(_mutex);
         _root.clear();
+        buildIndex();
         setChanged();
     }
 
     /*!
-
+        \brief setIndexed
+        Enable or disable the full path index. Enabling indexes the current tree
+        \param f
     */
-    template <typename P>
+    void setIndexed(bool f = true)
+    {
+        WriteLock l(_mutex);
+        _indexed = f;
+        buildIndex();
+    }
     /*!
-     * \brief get
-     * Get a data value reference from the tree by path
-     * \param path the path
-     * \return reference to object or default value if not found
-     */
-    T& get(const P& path)
+        \brief indexed
+        \return true if the full path index is enabled
+    */
+    bool indexed() const { return _indexed; }
+    /*!
+        \brief pathHash
+        \param path
+        \return hash for the overloads taking a precomputed hash
+    */
+    static size_t pathHash(const Path& path) { return Index::hashOf(path); }
+    /*!
+        \brief pathHash
+        \param path separated path string
+        \return hash for the overloads taking a precomputed hash
+    */
+    static size_t pathHash(const K& path) { return Index::hashOf(toPath(path)); }
+
+    /*!
+        \brief get
+        \param path
+        \param h pathHash(path)
+        \return data or the default
+    */
+    T& get(const Path& path, size_t h)
     {
-        ReadLock l(_mutex);
-        auto* p = _root.find(path);
-        if (p) {
-            return p->data();
+        if (path.empty()) {
+            ReadLock l(_mutex);
+            return _root.data();
+        }
+        else {
+            ReadLock l(_mutex);
+            ReadLock b(branchMutex(path.front()));
+            auto* p = lookup(path, h);
+            if (p) {
+                return p->data();
+            }
         }
         return _defaultData;
     }
 
+    /*!
+
+    */
+    template <typename P>
+    T& get(const P& path)
+    {
+        const Path& p = toPath(path);
+        return get(p, pathHash(p));
+    }
+
     /*!
         \brief root
-        \return reference to root node
+        \return
     */
     PropertyNode& root() { return _root; }
 
     /*!
         \brief rootNode
-        \return pointer to root node
+        \return
     */
     PropertyNode* rootNode() { return &this->_root; }
 
-    template <typename P>
     /*!
-     * \brief node
-     * Find a node by path
-     * \param path
-     * \return pointer to node or nullptr
-     */
+        \brief node
+    */
+    template <typename P>
     PropertyNode* node(const P& path)
     {
+        const Path& p = toPath(path);
+        return node(p, pathHash(p));
+    }
+    /*!
+        \brief node
+        \param path
+        \param h pathHash(path)
+        \return node or nullptr
+    */
+    PropertyNode* node(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return &_root;
         ReadLock l(_mutex);
-        return _root.find(path);
+        ReadLock b(branchMutex(path.front()));
+        return lookup(path, h);
     }
 
-    template <typename P>
     /*!
-     * \brief set
-     * Set data for a node. Path is created if necessary
-     * \param path path to item
-     * \param d data
-     */
+        \brief set
+    */
+    template <typename P>
     PropertyNode* set(const P& path, const T& d)
     {
-        auto p = _root.find(path);
-        if (!p) {
-            WriteLock l(_mutex);
-            p = _root.add(path);
-        }
+        const Path& p = toPath(path);
+        return set(p, pathHash(p), d);
+    }
+    /*!
+        \brief set
+        Set the data of a node, creating the path as required
+        \param path
+        \param h pathHash(path)
+        \param d
+        \return the node
+    */
+    PropertyNode* set(const Path& path, size_t h, const T& d)
+    {
+        PropertyNode* p = path.empty() ? &_root : nullptr;
         if (p) {
             WriteLock l(_mutex);
             p->setData(d);
         }
+        else {
+            ReadLock l(_mutex);
+            WriteLock b(branchMutex(path.front()));
+            if (_root.hasChild(path.front())) {  // the root is not changed while the tree lock is shared
+                p = addPath(path, h);
+                p->setData(d);
+            }
+        }
+        if (!p) {
+            WriteLock l(_mutex);  // a new branch
+            p = addPath(path, h);
+            p->setData(d);
+        }
         setChanged();
         return p;
     }
 
-    template <typename P>
     /*!
-     * \brief exists
-     * \param path
-     * \return true if the item exists in the tree
-     */
+        \brief exists
+    */
+    template <typename P>
     bool exists(const P& path)
     {
-        return _root.find(path) != nullptr;
+        const Path& p = toPath(path);
+        return exists(p, pathHash(p));
     }
+    /*!
+        \brief exists
+        \param path
+        \param h pathHash(path)
+        \return true if the node exists
+    */
+    bool exists(const Path& path, size_t h) { return node(path, h) != nullptr; }
 
-    template <typename P>
     /*!
-     * \brief remove
-     * remove a node from the tree
-     * \param path
-     */
+
+    */
+    template <typename P>
     void remove(const P& path)
     {
-        WriteLock l(_mutex);
+        const Path& p = toPath(path);
+        remove(p, pathHash(p));
+    }
+    /*!
+        \brief remove
+        \param path
+        \param h pathHash(path)
+    */
+    void remove(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return;
+        auto f = [&]() {
+            PropertyNode* n = lookup(path, h);
+            if (n) {
+                if (_indexed)
+                    _index[branch(path.front())].eraseTree(h, n);
+                delete n;  // detaches from its parent
+            }
+        };
+        if (path.size() == 1) {
+            WriteLock l(_mutex);  // removing a branch changes the root
+            f();
+        }
+        else {
+            ReadLock l(_mutex);
+            WriteLock b(branchMutex(path.front()));
+            f();
+        }
         setChanged();
-        _root.remove(path);
     }
 
     /*!
         \brief absolutePath
-        Get the full path to a node
-        \param n node to find path for
-        \param p receives the path
+        \param n
+        \param p
     */
     void absolutePath(PropertyNode* n, Path& p)
     {
         p.clear();
         if (n) {
             ReadLock l(_mutex);
-            while (n->parent() != nullptr) {
-                p.push_front(n->name());
+            do {
+                p.push_back(n->name());
                 n = n->parent();
-            }
+            } while (n != nullptr);
+            std::reverse(std::begin(p), std::end(p));
         }
     }
 
     /*!
         \brief getChild
-        Get child of a node
         \param node
         \param s
         \param def
-        \return reference to the data or default
+        \return
     */
     T& getChild(PropertyNode* node, const K& s, T& def)
     {
-        ReadLock l(_mutex);
-        if (node && node->hasChild(s)) {
-            return node->child(s)->data();
+        if (node) {
+            ReadLock l(_mutex);
+            ReadLock b(branchMutex((node == &_root) ? s : branchOf(node)));
+            PropertyNode* c = node->child(s);
+            if (c) {
+                return c->data();
+            }
         }
         return def;
     }
 
     /*!
         \brief setChild
-        Set the data for a child
         \param node
-        \param s child name
-        \param v data
+        \param s
+        \param v
     */
     void setChild(PropertyNode* node, const K& s, const T& v)
     {
         if (node) {
-            WriteLock l(_mutex);
-            if (node->hasChild(s)) {
-
-                node->child(s)->setData(v);
+            auto f = [&]() {
+                PropertyNode* c = node->child(s);
+                if (c) {
+                    c->setData(v);
+                }
+                else {
+                    c = node->createChild(s);
+                    c->setData(v);
+                    if (_indexed)
+                        _index[branch((node == &_root) ? s : branchOf(node))].insert(Index::hashOf(c, &_root), c);
+                }
+            };
+            if (node == &_root) {
+                WriteLock l(_mutex);
+                f();
             }
             else {
-                PropertyNode* c = node->createChild(s);
-                c->setData(v);
+                ReadLock l(_mutex);
+                WriteLock b(branchMutex(branchOf(node)));
+                f();
             }
             setChanged();
         }
@@ -681,67 +1041,79 @@ public:
 
     /*!
         \brief iterateNodes
-        Iterates all nodes with func
-        \param func lamda to visit nodes with
-        \return true if iteration is to continue
+        \param func
+        \return
     */
     bool iterateNodes(std::function<bool(PropertyNode&)> func)
     {
-        ReadLock l(_mutex);
+        WriteLock l(_mutex);
         return _root.iterateNodes(func);
     }
 
     /*!
         \brief write
-        Write on a stream
     */
     template <typename S>
     void write(S& os)
     {
         ReadLock l(_mutex);
+        std::vector<ReadLock> b;
+        lockBranches(b);
         _root.write(os);
     }
 
     /*!
         \brief read
-        Read from a stream
     */
     template <typename S>
     void read(S& is)
     {
         WriteLock l(_mutex);
         _root.read(is);
+        buildIndex();
         setChanged();
     }
 
     /*!
         \brief copyTo
-        Copy to a tree
-        \param dest destination tree
+        \param dest
     */
     void copyTo(PropertyTree& dest)
     {
         ReadLock l(_mutex);
+        std::vector<ReadLock> b;
+        lockBranches(b);
+        WriteLock d(dest._mutex);
         _root.copyTo(&dest._root);
+        dest.buildIndex();
         dest.setChanged();
     }
 
     template <typename P>
     /*!
-        \brief listChildren
-        List the children of a node
-        \param path  path to node
-        \param l receives the list of child node names
+        \brief list
+        \param path
+        \param l
     */
     int listChildren(const P& path, std::list<K>& l)
     {
-        auto i = node(path);
-        if (i) {
+        const Path& p = toPath(path);
+        if (p.empty()) {
             ReadLock lx(_mutex);
-            for (auto j = i->children().begin(); j != i->children().end(); j++) {
+            for (auto j = _root.children().begin(); j != _root.children().end(); j++) {
                 l.push_back(j->first);
             }
         }
+        else {
+            ReadLock lx(_mutex);
+            ReadLock b(branchMutex(p.front()));
+            auto i = lookup(p, pathHash(p));
+            if (i) {
+                for (auto j = i->children().begin(); j != i->children().end(); j++) {
+                    l.push_back(j->first);
+                }
+            }
+        }
         return l.size();
     }
 
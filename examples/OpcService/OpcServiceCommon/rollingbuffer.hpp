@@ -11,7 +11,11 @@
 //
 
 #include "stats.hpp"
+#include <algorithm>
 #include <deque>
+#include <vector>
+#include <stdint.h>
+#include <ctime>
 #include <time.h>
 //
 namespace MRL {
@@ -30,35 +34,83 @@ public:
     struct rItem {
         time_t _time;
         T _value;
+        rItem()
+            : _time(0)
+            , _value()
+        {
+        }
         rItem(time_t t, T v)
             : _time(t)
             , _value(v)
         {
         }
         rItem(const rItem& i) = default;
+        rItem& operator=(const rItem& i) = default;
     };
 
 private:
     int _width = 60;  //!< number of samples to hold in the rolling buffer
     //
-    std::deque<rItem> _buffer;  //!< buffer of time stamped values
+    std::vector<rItem> _buffer;  //!< ring of time stamped values - contiguous, reused once full
+    size_t _head  = 0;           //!< index of the oldest value
+    size_t _count = 0;           //!< values held
     //
     bool _changed = false;          // if true stats need to be recalculated
     StatisticsThresholdSet _stats;  // the current statistic of the buffer
     WindowType _windowType = CountWindow;
 
+    void grow()
+    {
+        // linearise into a larger ring - only while the window is filling
+        std::vector<rItem> b(std::max<size_t>(_buffer.size() * 2, 16));
+        for (size_t i = 0; i < _count; i++) {
+            b[i] = at(int(i));
+        }
+        _buffer.swap(b);
+        _head = 0;
+    }
+    void popFront()
+    {
+        const rItem& o = _buffer[_head];  // the slot is not reused until the next add
+        _head          = (_head + 1) % _buffer.size();
+        _count--;
+        evicted(o);
+    }
+
+protected:
+    /*!
+        \brief added
+        Called after a value enters the window - derived buffers keep running statistics with this
+        \param i the new value
+    */
+    virtual void added(const rItem& /*i*/) {}
+    /*!
+        \brief evicted
+        Called as a value leaves the window
+        \param i the oldest value
+    */
+    virtual void evicted(const rItem& /*i*/) {}
+    /*!
+        \brief cleared
+        Called when the buffer is emptied
+    */
+    virtual void cleared() {}
+
 public:
     /**
         @brief  Constructs a rolling buffer  of given size.
 
         @fn RollingBuffer
-        @param width Buffer Size
+        @param width Buffer Size - a count window of width 0 holds no values
     */
     RollingBuffer(int width = 60, WindowType w = CountWindow)
         : _width(width)
         , _windowType(w)
     {
+        if ((w == CountWindow) && (width > 0))
+            _buffer.resize(size_t(width));  // the ring never grows in count mode
     }
+    virtual ~RollingBuffer() {}
 
     /*!
         \brief changed
@@ -74,7 +126,12 @@ public:
         \brief size
         \return
     */
-    int size() const { return int(_buffer.size()); }
+    int size() const { return int(_count); }
+    /*!
+        \brief capacity
+        \return values the ring holds before it must grow
+    */
+    int capacity() const { return int(_buffer.size()); }
     /**
         @brief  Copy constructor
 
@@ -84,6 +141,8 @@ public:
     RollingBuffer(const RollingBuffer& r)
         : _width(r._width)
         , _buffer(r._buffer)
+        , _head(r._head)
+        , _count(r._count)
         , _changed(r._changed)
         , _windowType(r._windowType)
     {
@@ -97,7 +156,8 @@ public:
     void clearBuffer()
     {
         _stats.clear();
-        _buffer.clear();
+        _head = _count = 0;
+        cleared();
     }
     //
     /**
@@ -107,6 +167,11 @@ public:
         @return int
     */
     int width() const { return _width; }
+    /*!
+        \brief windowType
+        \return
+    */
+    WindowType windowType() const { return _windowType; }
     //
     /**
         @brief  Sets the buffer width
@@ -129,38 +194,122 @@ public:
         @fn addValue
         @param v  Value to add to buffer
     */
-    void addValue(T v)
+    void addValue(T v) { addValue(::time(nullptr), v); }
+    /**
+        @brief  Adds a time stamped value to the rolling buffer. The oldest values are dropped as they leave the
+       window - by count or by age relative to this value
+
+        @fn addValue
+        @param t time stamp
+        @param v  Value to add to buffer
+    */
+    void addValue(time_t t, T v)
     {
+        if ((_windowType == CountWindow) && (_width <= 0))
+            return;  // a count window of no width holds no values
         _changed = true;
-        rItem d(::time(nullptr), v);
-        _buffer.push_back(d);
-        //
         if (_windowType == CountWindow) {
-            while ((int)_buffer.size() > _width)
-                _buffer.pop_front();
+            while ((_count > 0) && ((int)_count >= _width))
+                popFront();
         }
-        else {
-            while ((std::difftime(_buffer.back()._time, _buffer.front()._time) > double(_width)) &&
-                   (_buffer.size() > 0)) {
-                _buffer.pop_front();
+        if (_count == _buffer.size())
+            grow();
+        rItem& d = _buffer[(_head + _count) % _buffer.size()];
+        d._time  = t;
+        d._value = v;
+        _count++;
+        added(d);
+        //
+        if (_windowType == TimeWindow) {
+            while ((_count > 0) && (std::difftime(t, _buffer[_head]._time) > double(_width))) {
+                popFront();
             }
         }
     }
+    /*!
+        \brief at
+        \param i 0 for the oldest value
+        \return the value
+    */
+    rItem& at(int i) { return _buffer[(_head + size_t(i)) % _buffer.size()]; }
+    const rItem& at(int i) const { return _buffer[(_head + size_t(i)) % _buffer.size()]; }
+    rItem& operator[](int i) { return at(i); }
+    /*!
+        \brief first
+        \return oldest value
+    */
+    rItem& first() { return at(0); }
     /*!
         \brief last
         \return
     */
-    rItem& last() { return _buffer.back(); }
-
-    std::deque<rItem>& buffer() { return _buffer; }
+    rItem& last() { return at(int(_count) - 1); }
 };
 
 /*!
     \brief The StatisticsBuffer class
+    Statistics of the window are kept as values come and go - a running sum and sum of squares, and
+    monotonic queues for the minimum and maximum - so reading them is O(1) rather than a rescan
 */
 class StatisticsBuffer : public RollingBuffer<double>
 {
     StatisticsThresholdSet _stats;  // the current statistic of the buffer
+    //
+    double _sum        = 0.0;
+    double _sumSquares = 0.0;
+    uint64_t _in       = 0;  // sequence number of the next value
+    uint64_t _out      = 0;  // sequence number of the oldest value
+    uint64_t _evicted  = 0;  // evictions since the sums were last recalculated
+    std::deque<std::pair<uint64_t, double>> _min;  // increasing values - front is the minimum
+    std::deque<std::pair<uint64_t, double>> _max;  // decreasing values - front is the maximum
+
+    void resum()
+    {
+        // running sums drift as values leave - recalculate now and then
+        _sum = _sumSquares = 0.0;
+        for (int i = 0; i < size(); i++) {
+            double v = at(i)._value;
+            _sum += v;
+            _sumSquares += v * v;
+        }
+        _evicted = 0;
+    }
+
+protected:
+    virtual void added(const rItem& i)
+    {
+        double v = i._value;
+        _sum += v;
+        _sumSquares += v * v;
+        while (!_min.empty() && (_min.back().second >= v))
+            _min.pop_back();
+        _min.emplace_back(_in, v);
+        while (!_max.empty() && (_max.back().second <= v))
+            _max.pop_back();
+        _max.emplace_back(_in, v);
+        _in++;
+    }
+    virtual void evicted(const rItem& i)
+    {
+        double v = i._value;
+        _sum -= v;
+        _sumSquares -= v * v;
+        if (!_min.empty() && (_min.front().first == _out))
+            _min.pop_front();
+        if (!_max.empty() && (_max.front().first == _out))
+            _max.pop_front();
+        _out++;
+        if (++_evicted > uint64_t(std::max(capacity(), 1024)))
+            resum();
+    }
+    virtual void cleared()
+    {
+        _sum = _sumSquares = 0.0;
+        _in = _out = _evicted = 0;
+        _min.clear();
+        _max.clear();
+    }
+
 public:
     StatisticsBuffer(int width = 60, WindowType w = CountWindow)
         : RollingBuffer(width, w)
@@ -174,20 +323,73 @@ public:
     StatisticsThresholdSet& statistics() { return _stats; }
     /**
         @brief Evaluates the statistics of the buffer and returns the result.
+        Without thresholds or SPC tracking this takes the running statistics. Thresholds and SPC counts depend on
+        the order of the values so those need a rescan of the window
         @return StatisticsThresholdSet
     */
     StatisticsThresholdSet& evaluate()
     {
         if (changed()) {
             // recalculate if necessary
-            _stats.clear();
-            for (size_t i = 0; i < buffer().size(); i++) {
-                _stats.setValue(buffer()[i]._value);
+            if (_stats.thresholdsEnabled() || _stats.getTrackSpc()) {
+                _stats.clear();
+                for (int i = 0; i < size(); i++) {
+                    _stats.setValue(at(i)._value);
+                }
+            }
+            else if (size() > 0) {
+                _stats.setSummary(unsigned(size()), _sum, _sumSquares, minimum(), maximum(), last()._value,
+                                  last()._time);
+            }
+            else {
+                _stats.clear();
             }
         };
         setChanged(false);
         return _stats;
     }
+    /*!
+        \brief count
+        \return values in the window
+    */
+    int count() const { return size(); }
+    /*!
+        \brief sum
+        \return
+    */
+    double sum() const { return _sum; }
+    /*!
+        \brief mean
+        \return
+    */
+    double mean() const { return (size() > 0) ? _sum / double(size()) : 0.0; }
+    /*!
+        \brief variance
+        \return sample variance
+    */
+    double variance() const
+    {
+        if (size() > 1) {
+            double v = (_sumSquares - ((_sum * _sum) / size())) / (size() - 1);
+            return (v > 0.0) ? v : 0.0;
+        }
+        return 0.0;
+    }
+    /*!
+        \brief stdDev
+        \return
+    */
+    double stdDev() const { return sqrt(variance()); }
+    /*!
+        \brief minimum
+        \return
+    */
+    double minimum() const { return _min.empty() ? 0.0 : _min.front().second; }
+    /*!
+        \brief maximum
+        \return
+    */
+    double maximum() const { return _max.empty() ? 0.0 : _max.front().second; }
     /*!
         \brief clear
     */
@@ -200,45 +402,293 @@ public:
 
 /*!
     \brief The BooleanBuffer class
+    Rolling buffer of digital values packed one bit per value into a ring of 64 bit words. Time stamps are run
+    length encoded - one entry per run of values with the same time stamp - so a input sampled many times a second
+    costs little more than its bits. The high count and the number of transitions in the window are kept as values
+    come and go, and counts over part of the window are popcounts of whole words
 */
-class BooleanBuffer : public RollingBuffer<bool>
+class BooleanBuffer
 {
-    int _hi = 0;
-    int _lo = 0;
+public:
+    typedef RollingBuffer<bool>::WindowType WindowType;
+    typedef RollingBuffer<bool>::rItem rItem;
+    static const WindowType TimeWindow  = RollingBuffer<bool>::TimeWindow;
+    static const WindowType CountWindow = RollingBuffer<bool>::CountWindow;
+
+private:
+    /*!
+        \brief The Run struct
+        Consecutive values sharing a time stamp
+    */
+    struct Run {
+        time_t _time;
+        uint32_t _count;
+    };
+
+    int _width = 60;
+    WindowType _windowType = RollingBuffer<bool>::CountWindow;
+    bool _changed = false;
+    //
+    std::vector<uint64_t> _bits;  //!< ring of values - the capacity is a multiple of 64
+    size_t _head  = 0;            //!< bit index of the oldest value
+    size_t _count = 0;            //!< values held
+    std::deque<Run> _runs;        //!< time stamps of the values in order
+    //
+    int _hi          = 0;  //!< high values in the window
+    int _transitions = 0;  //!< changes of value between neighbours in the window
+
+    size_t bitCapacity() const { return _bits.size() * 64; }
+    bool bit(size_t p) const { return (_bits[p >> 6] >> (p & 63)) & 1; }
+    void setBit(size_t p, bool v)
+    {
+        const uint64_t m = uint64_t(1) << (p & 63);
+        if (v)
+            _bits[p >> 6] |= m;
+        else
+            _bits[p >> 6] &= ~m;
+    }
+    /*!
+        \brief word
+        \param i index of the first value, 0 for the oldest
+        \param n number of values, 1 to 64
+        \return the values as bits, the first in bit 0
+    */
+    uint64_t word(size_t i, unsigned n) const
+    {
+        size_t p   = (_head + i) % bitCapacity();
+        size_t w   = p >> 6;
+        unsigned o = unsigned(p & 63);
+        uint64_t x = _bits[w] >> o;
+        if (o && (n > 64 - o))
+            x |= _bits[(w + 1) % _bits.size()] << (64 - o);  // the ring wraps on a word boundary
+        return (n < 64) ? (x & ((uint64_t(1) << n) - 1)) : x;
+    }
+    void grow()
+    {
+        // linearise into a larger ring - only while the window is filling
+        std::vector<uint64_t> b(std::max<size_t>(_bits.size() * 2, 1), 0);
+        for (size_t i = 0; i < _count; i += 64) {
+            unsigned n = unsigned(std::min<size_t>(64, _count - i));
+            b[i >> 6]  = word(i, n);
+        }
+        _bits.swap(b);
+        _head = 0;
+    }
+    void popFront()
+    {
+        uint64_t x = word(0, (_count > 1) ? 2 : 1);
+        _hi -= int(x & 1);
+        if (_count > 1)
+            _transitions -= int((x ^ (x >> 1)) & 1);  // the last value has no neighbour to change from
+        _head = (_head + 1) % bitCapacity();
+        _count--;
+        if (!--_runs.front()._count)
+            _runs.pop_front();
+        if (!_count) {
+            _hi          = 0;
+            _transitions = 0;
+        }
+        else if (_transitions < 0) {
+            _transitions = 0;
+        }
+    }
 
 public:
     /*!
         \brief BooleanBuffer
-        \param width
+        \param width a count window of width 0 holds no values
         \param w
     */
-    BooleanBuffer(int width = 60, WindowType w = CountWindow)
-        : RollingBuffer(width, w)
+    BooleanBuffer(int width = 60, WindowType w = RollingBuffer<bool>::CountWindow)
+        : _width(width)
+        , _windowType(w)
+    {
+        if ((w == CountWindow) && (width > 0))
+            _bits.resize((size_t(width) + 63) / 64, 0);  // the ring never grows in count mode
+    }
+    virtual ~BooleanBuffer() {}
+
+    /*!
+        \brief changed
+        \return
+    */
+    bool changed() const { return _changed; }
+    /*!
+        \brief setChanged
+        \param f
+    */
+    void setChanged(bool f = true) { _changed = f; }
+    /*!
+        \brief size
+        \return
+    */
+    int size() const { return int(_count); }
+    /*!
+        \brief capacity
+        \return values the ring holds before it must grow
+    */
+    int capacity() const { return int(bitCapacity()); }
+    /*!
+        \brief width
+        \return
+    */
+    int width() const { return _width; }
+    /*!
+        \brief setWidth
+        \param w
+    */
+    void setWidth(int w)
     {
+        if (w > 0) {
+            _width   = w;
+            _changed = true;
+        }
     }
+    /*!
+        \brief windowType
+        \return
+    */
+    WindowType windowType() const { return _windowType; }
+    /*!
+        \brief memoryUsed
+        \return approximate bytes held by the values and time stamps
+    */
+    size_t memoryUsed() const { return _bits.capacity() * sizeof(uint64_t) + _runs.size() * sizeof(Run); }
+
+    /*!
+        \brief addValue
+        \param v
+    */
+    void addValue(bool v) { addValue(::time(nullptr), v); }
+    /*!
+        \brief addValue
+        Adds a time stamped value - the oldest values are dropped as they leave the window
+        \param t time stamp
+        \param v
+    */
+    void addValue(time_t t, bool v)
+    {
+        if ((_windowType == CountWindow) && (_width <= 0))
+            return;  // a count window of no width holds no values
+        _changed = true;
+        if (_windowType == CountWindow) {
+            while ((_count > 0) && ((int)_count >= _width))
+                popFront();
+        }
+        if (_count == bitCapacity())
+            grow();
+        if (_count && (v != at(int(_count) - 1)))
+            _transitions++;
+        setBit((_head + _count) % bitCapacity(), v);
+        _count++;
+        if (v)
+            _hi++;
+        if (!_runs.empty() && (_runs.back()._time == t) && (_runs.back()._count < UINT32_MAX))
+            _runs.back()._count++;
+        else
+            _runs.push_back(Run{t, 1});
+        //
+        if (_windowType == TimeWindow) {
+            while ((_count > 0) && (std::difftime(t, _runs.front()._time) > double(_width))) {
+                popFront();
+            }
+        }
+    }
+
+    /*!
+        \brief at
+        \param i 0 for the oldest value
+        \return the value
+    */
+    bool at(int i) const { return bit((_head + size_t(i)) % bitCapacity()); }
+    bool operator[](int i) const { return at(i); }
+    /*!
+        \brief timeAt
+        Walks the time stamp runs - O(runs)
+        \param i 0 for the oldest value
+        \return time stamp of the value
+    */
+    time_t timeAt(int i) const
+    {
+        size_t n = size_t(i);
+        for (const Run& r : _runs) {
+            if (n < r._count)
+                return r._time;
+            n -= r._count;
+        }
+        return 0;
+    }
+    /*!
+        \brief item
+        \param i 0 for the oldest value
+        \return the time stamped value
+    */
+    rItem item(int i) const { return rItem(timeAt(i), at(i)); }
+    /*!
+        \brief last
+        \return the newest value
+    */
+    bool last() const { return at(int(_count) - 1); }
 
     int hi() const { return _hi; }
-    int lo() const { return _lo; }
+    int lo() const { return int(_count) - _hi; }
+    /*!
+        \brief transitions
+        \return changes of value between neighbouring values in the window
+    */
+    int transitions() const { return _transitions; }
+    /*!
+        \brief dutyCycle
+        \return fraction of the window that is high
+    */
+    double dutyCycle() const { return _count ? double(_hi) / double(_count) : 0.0; }
+
+    /*!
+        \brief hi
+        \param first index of the first value, 0 for the oldest
+        \param n number of values
+        \return high values in the range
+    */
+    int hi(int first, int n) const
+    {
+        int c = 0;
+        for (int i = 0; i < n; i += 64) {
+            c += __builtin_popcountll(word(size_t(first + i), unsigned(std::min(64, n - i))));
+        }
+        return c;
+    }
+    /*!
+        \brief transitions
+        \param first index of the first value, 0 for the oldest
+        \param n number of values
+        \return changes of value between neighbours within the range
+    */
+    int transitions(int first, int n) const
+    {
+        int c = 0;
+        for (int i = 0; i + 1 < n; i += 63) {
+            // each chunk overlaps the next by one value so every neighbouring pair is compared once
+            unsigned m = unsigned(std::min(64, n - i));
+            uint64_t x = word(size_t(first + i), m);
+            c += __builtin_popcountll((x ^ (x >> 1)) & ((uint64_t(1) << (m - 1)) - 1));
+        }
+        return c;
+    }
+    /*!
+        \brief dutyCycle
+        \param first index of the first value, 0 for the oldest
+        \param n number of values
+        \return fraction of the range that is high
+    */
+    double dutyCycle(int first, int n) const { return (n > 0) ? double(hi(first, n)) / double(n) : 0.0; }
 
     /*!
         \brief evaluate
+        The counts are kept as values come and go
         \return
     */
     int evaluate()
     {
-        if (changed()) {
-            // recalculate if necessary
-            _hi = 0;
-            _lo = 0;
-            for (size_t i = 0; i < buffer().size(); i++) {
-                if (buffer()[i]._value) {
-                    _hi++;
-                }
-                else {
-                    _lo++;
-                }
-            }
-        };
         setChanged(false);
         return _hi;
     }
@@ -248,8 +698,9 @@ public:
     */
     void clear()
     {
-        clearBuffer();
-        _hi = _lo = 0;
+        _head = _count = 0;
+        _runs.clear();
+        _hi = _transitions = 0;
     }
 };
 }  // namespace MRL
@@ -13,6 +13,9 @@ class ServerBase : public Wt::WApplication
 {
     std::unique_ptr<T> _frame;
     std::unique_ptr<Wt::WBootstrapTheme> _theme;  // the theme
+    uint64_t _seen = 0;                           // last change of the shared data this session has
+    bool _synced   = false;                       // the session has had the whole tree
+    Open62541::JsonWriter _writer;                // reused for the whole tree
 public:
     ServerBase(const Wt::WEnvironment& env)
         : Wt::WApplication(env)
@@ -23,6 +26,23 @@ public:
         _frame = std::make_unique<T>(root());
     }
     T* frame() { return _frame.get(); }
+    /*!
+        \brief changes
+        The shared data this session has not seen - call on each refresh instead of serialising the tree
+        \param json receives a delta (see ValueTree::delta) or, the first time and after falling behind the
+        journal, the whole tree
+        \return true if json is a delta
+    */
+    bool changes(std::string& json)
+    {
+        VariantPropertyTree& d = OpcServiceCommon::data();
+        if (_synced && d.delta(_seen, json, _seen))
+            return true;
+        _seen   = d.snapshot(_writer);
+        _synced = true;
+        json    = _writer.str();
+        return false;
+    }
 };
 }  // namespace MRL
 
@@ -1,5 +1,14 @@
 #include "stats.hpp"
+#include <algorithm>
+#include <cmath>
 #include <time.h>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define MRL_STATS_AVX2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MRL_STATS_NEON
+#endif
 //
 // $Id: stats.cpp,v 1.1.1.1 2013/12/24 18:07:04 barry Exp $
 // Statistics class
@@ -7,17 +16,91 @@
 void MRL::Statistics::setValue(double v)
 {
     updateTime = time(nullptr);
-    sum += v;
-    sumSquares += v * v;
-    if (!numberSamples)
-        minimum = maximum = v;
+    addSum(v);
     numberSamples++;
+    double d = v - mean;
+    mean += d / double(numberSamples);
+    m2 += d * (v - mean);
+    if (numberSamples == 1)
+        minimum = maximum = v;
     if (v > maximum) {
         maximum = v;
     }
     else if (v < minimum) {
         minimum = v;
     };
+    spc(v);
+    lastValue = v;
+}
+
+/*!
+ * \brief MRL::Statistics::addSum
+ * Neumaier compensated summation - the low order bits lost from sum are kept in sumError
+ * \param v
+ */
+void MRL::Statistics::addSum(double v)
+{
+    double t = sum + v;
+    if (std::fabs(sum) >= std::fabs(v))
+        sumError += (sum - t) + v;
+    else
+        sumError += (v - t) + sum;
+    sum = t;
+}
+
+/*!
+ * \brief MRL::Statistics::combine
+ * Chan et al. pairwise update with the summary of another population
+ * \param n number of samples
+ * \param s sum
+ * \param m mean
+ * \param d2 sum of squared deviations from m
+ * \param mn minimum
+ * \param mx maximum
+ */
+void MRL::Statistics::combine(unsigned n, double s, double m, double d2, double mn, double mx)
+{
+    if (!n)
+        return;
+    addSum(s);
+    if (!numberSamples) {
+        mean    = m;
+        m2      = d2;
+        minimum = mn;
+        maximum = mx;
+    }
+    else {
+        double na = numberSamples;
+        double nb = n;
+        double nt = na + nb;
+        double d  = m - mean;
+        mean += d * (nb / nt);
+        m2 += d2 + d * d * (na * nb / nt);
+        minimum = std::min(minimum, mn);
+        maximum = std::max(maximum, mx);
+    }
+    numberSamples += n;
+}
+
+/*!
+ * \brief MRL::Statistics::merge
+ * \param s
+ */
+void MRL::Statistics::merge(const Statistics& s)
+{
+    if (!s.numberSamples)
+        return;
+    combine(s.numberSamples, s.getSum(), s.mean, s.m2, s.minimum, s.maximum);
+    lastValue  = s.lastValue;
+    updateTime = s.updateTime;
+}
+
+/*!
+ * \brief MRL::Statistics::spc
+ * \param v
+ */
+void MRL::Statistics::spc(double v)
+{
     if (trackSpc) {
         if (v > lastValue) {
             if (dirTrendUp) {
@@ -63,7 +146,6 @@ void MRL::Statistics::setValue(double v)
             meanCrowding = 0;
         }
     };
-    lastValue = v;
 }
 /*!
  * \brief MRL::Statistics::tval
@@ -122,3 +204,270 @@ int MRL::Statistics::spcAlarmTriggered()
     }
     return ret;
 }
+
+namespace {
+/*!
+ * \brief The Moments struct
+ * Four interleaved lanes - lane j takes values j, j + 4, ... The vector kernels and the scalar fallback add the
+ * lanes in the same order, and fuse the square into the add for the deviations, so every build forms the same sums
+ */
+struct Moments {
+    double sum[4];
+    double minimum;
+    double maximum;
+};
+
+void moments(const double* v, size_t n, Moments& m)
+{
+    size_t i  = 0;
+    size_t n4 = n & ~size_t(3);
+#if defined(MRL_STATS_AVX2)
+    __m256d s  = _mm256_setzero_pd();
+    __m256d mn = _mm256_set1_pd(v[0]);
+    __m256d mx = mn;
+    for (; i < n4; i += 4) {
+        __m256d x = _mm256_loadu_pd(v + i);
+        s         = _mm256_add_pd(s, x);
+        mn        = _mm256_min_pd(mn, x);
+        mx        = _mm256_max_pd(mx, x);
+    }
+    double a[4], b[4];
+    _mm256_storeu_pd(m.sum, s);
+    _mm256_storeu_pd(a, mn);
+    _mm256_storeu_pd(b, mx);
+    m.minimum = std::min(std::min(a[0], a[1]), std::min(a[2], a[3]));
+    m.maximum = std::max(std::max(b[0], b[1]), std::max(b[2], b[3]));
+#elif defined(MRL_STATS_NEON)
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = s0;
+    float64x2_t mn = vdupq_n_f64(v[0]), mx = mn;
+    for (; i < n4; i += 4) {
+        float64x2_t x0 = vld1q_f64(v + i);
+        float64x2_t x1 = vld1q_f64(v + i + 2);
+        s0             = vaddq_f64(s0, x0);
+        s1             = vaddq_f64(s1, x1);
+        mn             = vminq_f64(mn, vminq_f64(x0, x1));
+        mx             = vmaxq_f64(mx, vmaxq_f64(x0, x1));
+    }
+    vst1q_f64(m.sum, s0);
+    vst1q_f64(m.sum + 2, s1);
+    m.minimum = vminvq_f64(mn);
+    m.maximum = vmaxvq_f64(mx);
+#else
+    for (int j = 0; j < 4; j++) {
+        m.sum[j] = 0.0;
+    }
+    m.minimum = m.maximum = v[0];
+    for (; i < n4; i += 4) {
+        for (int j = 0; j < 4; j++) {
+            double x = v[i + j];
+            m.sum[j] += x;
+            m.minimum = std::min(m.minimum, x);
+            m.maximum = std::max(m.maximum, x);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        double x = v[i];
+        m.sum[i - n4] += x;
+        m.minimum = std::min(m.minimum, x);
+        m.maximum = std::max(m.maximum, x);
+    }
+}
+
+/*!
+ * \brief deviations
+ * Sum of the squared deviations from the batch mean - a second pass rather than the sum of the squares, which
+ * cancels badly when the mean is large against the spread
+ * \return the sum of the lanes, added as in moments
+ */
+double deviations(const double* v, size_t n, double mean)
+{
+    double d[4];
+    size_t i  = 0;
+    size_t n4 = n & ~size_t(3);
+#if defined(MRL_STATS_AVX2)
+    const __m256d m = _mm256_set1_pd(mean);
+    __m256d s       = _mm256_setzero_pd();
+    for (; i < n4; i += 4) {
+        __m256d x = _mm256_sub_pd(_mm256_loadu_pd(v + i), m);
+        s         = _mm256_fmadd_pd(x, x, s);
+    }
+    _mm256_storeu_pd(d, s);
+#elif defined(MRL_STATS_NEON)
+    const float64x2_t m = vdupq_n_f64(mean);
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = s0;
+    for (; i < n4; i += 4) {
+        float64x2_t x0 = vsubq_f64(vld1q_f64(v + i), m);
+        float64x2_t x1 = vsubq_f64(vld1q_f64(v + i + 2), m);
+        s0             = vfmaq_f64(s0, x0, x0);
+        s1             = vfmaq_f64(s1, x1, x1);
+    }
+    vst1q_f64(d, s0);
+    vst1q_f64(d + 2, s1);
+#else
+    for (int j = 0; j < 4; j++) {
+        d[j] = 0.0;
+    }
+    for (; i < n4; i += 4) {
+        for (int j = 0; j < 4; j++) {
+            double x = v[i + j] - mean;
+            d[j]     = std::fma(x, x, d[j]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        double x  = v[i] - mean;
+        d[i - n4] = std::fma(x, x, d[i - n4]);
+    }
+    return (d[0] + d[1]) + (d[2] + d[3]);
+}
+
+/*!
+ * \brief The Classes struct
+ * Threshold trigger counts of a batch, with the short circuits of StatisticsThresholdSet::setValue - HiHi is only
+ * compared when LoLo did not trigger and LoHi only when HiLo did not
+ */
+struct Classes {
+    int lolo = 0;
+    int hihi = 0;
+    int hilo = 0;
+    int lohi = 0;
+    int none = 0;
+};
+
+void classify(const double* v, size_t n, const double* t, const bool* e, Classes& c)
+{
+    // t and e are LoLo, HiHi, HiLo, LoHi
+    size_t i = 0;
+#if defined(MRL_STATS_AVX2)
+    const __m256d tLoLo = _mm256_set1_pd(t[0]), tHiHi = _mm256_set1_pd(t[1]);
+    const __m256d tHiLo = _mm256_set1_pd(t[2]), tLoHi = _mm256_set1_pd(t[3]);
+    const __m256d zero  = _mm256_setzero_pd();
+    const __m256d all   = _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ);
+    const __m256d eLoLo = e[0] ? all : zero, eHiHi = e[1] ? all : zero;
+    const __m256d eHiLo = e[2] ? all : zero, eLoHi = e[3] ? all : zero;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x    = _mm256_loadu_pd(v + i);
+        __m256d lolo = _mm256_and_pd(eLoLo, _mm256_cmp_pd(x, tLoLo, _CMP_LE_OQ));
+        __m256d hihi = _mm256_andnot_pd(lolo, _mm256_and_pd(eHiHi, _mm256_cmp_pd(x, tHiHi, _CMP_GE_OQ)));
+        __m256d hilo = _mm256_and_pd(eHiLo, _mm256_cmp_pd(x, tHiLo, _CMP_GE_OQ));
+        __m256d lohi = _mm256_andnot_pd(hilo, _mm256_and_pd(eLoHi, _mm256_cmp_pd(x, tLoHi, _CMP_LE_OQ)));
+        __m256d any  = _mm256_or_pd(_mm256_or_pd(lolo, hihi), _mm256_or_pd(hilo, lohi));
+        c.lolo += __builtin_popcount(_mm256_movemask_pd(lolo));
+        c.hihi += __builtin_popcount(_mm256_movemask_pd(hihi));
+        c.hilo += __builtin_popcount(_mm256_movemask_pd(hilo));
+        c.lohi += __builtin_popcount(_mm256_movemask_pd(lohi));
+        c.none += 4 - __builtin_popcount(_mm256_movemask_pd(any));
+    }
+#elif defined(MRL_STATS_NEON)
+    const float64x2_t tLoLo = vdupq_n_f64(t[0]), tHiHi = vdupq_n_f64(t[1]);
+    const float64x2_t tHiLo = vdupq_n_f64(t[2]), tLoHi = vdupq_n_f64(t[3]);
+    const uint64x2_t eLoLo = vdupq_n_u64(e[0] ? ~0ull : 0), eHiHi = vdupq_n_u64(e[1] ? ~0ull : 0);
+    const uint64x2_t eHiLo = vdupq_n_u64(e[2] ? ~0ull : 0), eLoHi = vdupq_n_u64(e[3] ? ~0ull : 0);
+    uint64x2_t nLoLo = vdupq_n_u64(0), nHiHi = nLoLo, nHiLo = nLoLo, nLoHi = nLoLo, nAny = nLoLo;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t x   = vld1q_f64(v + i);
+        uint64x2_t lolo = vandq_u64(eLoLo, vcleq_f64(x, tLoLo));
+        uint64x2_t hihi = vbicq_u64(vandq_u64(eHiHi, vcgeq_f64(x, tHiHi)), lolo);
+        uint64x2_t hilo = vandq_u64(eHiLo, vcgeq_f64(x, tHiLo));
+        uint64x2_t lohi = vbicq_u64(vandq_u64(eLoHi, vcleq_f64(x, tLoHi)), hilo);
+        uint64x2_t any  = vorrq_u64(vorrq_u64(lolo, hihi), vorrq_u64(hilo, lohi));
+        nLoLo           = vsubq_u64(nLoLo, lolo);  // each set lane is -1
+        nHiHi           = vsubq_u64(nHiHi, hihi);
+        nHiLo           = vsubq_u64(nHiLo, hilo);
+        nLoHi           = vsubq_u64(nLoHi, lohi);
+        nAny            = vsubq_u64(nAny, any);
+    }
+    c.lolo += int(vaddvq_u64(nLoLo));
+    c.hihi += int(vaddvq_u64(nHiHi));
+    c.hilo += int(vaddvq_u64(nHiLo));
+    c.lohi += int(vaddvq_u64(nLoHi));
+    c.none += int(i - vaddvq_u64(nAny));
+#endif
+    for (; i < n; i++) {
+        double x  = v[i];
+        bool lolo = e[0] && (x <= t[0]);
+        bool hihi = !lolo && e[1] && (x >= t[1]);
+        bool hilo = e[2] && (x >= t[2]);
+        bool lohi = !hilo && e[3] && (x <= t[3]);
+        c.lolo += lolo;
+        c.hihi += hihi;
+        c.hilo += hilo;
+        c.lohi += lohi;
+        c.none += !(lolo || hihi || hilo || lohi);
+    }
+}
+}  // namespace
+
+/*!
+ * \brief MRL::Statistics::setValues
+ * \param v
+ * \param n
+ */
+void MRL::Statistics::setValues(const double* v, size_t n)
+{
+    if (!v || !n)
+        return;
+    Moments m;
+    moments(v, n, m);
+    updateTime = time(nullptr);
+    double s   = (m.sum[0] + m.sum[1]) + (m.sum[2] + m.sum[3]);
+    double b   = s / double(n);
+    combine(unsigned(n), s, b, deviations(v, n, b), m.minimum, m.maximum);
+    if (trackSpc) {
+        for (size_t i = 0; i < n; i++) {
+            spc(v[i]);
+            lastValue = v[i];
+        }
+    }
+    lastValue = v[n - 1];
+}
+
+/*!
+ * \brief MRL::StatisticsThresholdSet::setValues
+ * \param v
+ * \param n
+ */
+void MRL::StatisticsThresholdSet::setValues(const double* v, size_t n)
+{
+    if (!v || !n)
+        return;
+    StatisticsThreshold& loLo = _thresholds[StatisticsThreshold::LoLo];
+    StatisticsThreshold& hiHi = _thresholds[StatisticsThreshold::HiHi];
+    StatisticsThreshold& hiLo = _thresholds[StatisticsThreshold::HiLo];
+    StatisticsThreshold& loHi = _thresholds[StatisticsThreshold::LoHi];
+    const double t[4] = {loLo.threshold(), hiHi.threshold(), hiLo.threshold(), loHi.threshold()};
+    const bool e[4]   = {loLo.enabled(), hiHi.enabled(), hiLo.enabled(), loHi.enabled()};
+    Classes c;
+    classify(v, n, t, e, c);
+    //
+    // trigger states are those of the last compare of each threshold - HiHi and LoHi are skipped by a short circuit
+    // so walk back to the last value each was compared with
+    double x      = v[n - 1];
+    bool lolo     = e[0] && (x <= t[0]);
+    bool hilo     = e[2] && (x >= t[2]);
+    bool hihi     = hiHi.triggered();
+    bool lohi     = loHi.triggered();
+    bool lastHiHi = false;
+    bool lastLoHi = false;
+    for (size_t i = n; (i > 0) && !(lastHiHi && lastLoHi); i--) {
+        double y = v[i - 1];
+        if (!lastHiHi && !(e[0] && (y <= t[0]))) {
+            hihi     = e[1] && (y >= t[1]);
+            lastHiHi = true;
+        }
+        if (!lastLoHi && !(e[2] && (y >= t[2]))) {
+            lohi     = e[3] && (y <= t[3]);
+            lastLoHi = true;
+        }
+    }
+    loLo.addTriggers(c.lolo, lolo);
+    hiHi.addTriggers(c.hihi, hihi);
+    hiLo.addTriggers(c.hilo, hilo);
+    loHi.addTriggers(c.lohi, lohi);
+    _thresholds[StatisticsThreshold::None].addTriggers(c.none, _thresholds[StatisticsThreshold::None].triggered());
+    _hihilolo  = lolo || (e[1] && (x >= t[1]));
+    _hilolohi  = hilo || (e[3] && (x <= t[3]));
+    _triggered = _hihilolo || _hilolohi;
+    Statistics::setValues(v, n);
+}
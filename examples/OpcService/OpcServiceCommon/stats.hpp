@@ -9,8 +9,10 @@
     (c)  Micro Research Limited 2010 -
     $Id: stats.hpp,v 1.1.1.1 2013/12/24 18:07:04 barry Exp $
 */
+#include <algorithm>
 #include <vector>
 #include <math.h>
+#include <stddef.h>
 #include <time.h>
 namespace MRL {
 /*!
@@ -21,8 +23,8 @@ class StatisticsBase
 {
     double _lastValue       = 0.0;
     unsigned _numberSamples = 0;
-    double _sum             = 0.0;
-    double _sumSquares      = 0.0;
+    double _mean            = 0.0;
+    double _m2              = 0.0;  // sum of squared deviations from the mean
     double _minimum         = 0.0;
     double _maximum         = 0.0;
 
@@ -31,8 +33,8 @@ public:
     StatisticsBase(const StatisticsBase& s)
         : _lastValue(s._lastValue)
         , _numberSamples(s._numberSamples)
-        , _sum(s._sum)
-        , _sumSquares(s._sumSquares)
+        , _mean(s._mean)
+        , _m2(s._m2)
         , _minimum(s._minimum)
         , _maximum(s._maximum)
     {
@@ -40,15 +42,16 @@ public:
 
     virtual void clear()
     {
-        _lastValue = _sum = _sumSquares = _minimum = _maximum = 0.0;
-        _numberSamples                                        = 0;
+        _lastValue = _mean = _m2 = _minimum = _maximum = 0.0;
+        _numberSamples                                 = 0;
     }
 
     void setValue(double v)
     {
         _lastValue = v;
-        _sum += v;
-        _sumSquares += v * v;
+        double d   = v - _mean;
+        _mean += d / double(_numberSamples + 1);
+        _m2 += d * (v - _mean);
         if (!_numberSamples) {
             _minimum = _maximum = v;
         }
@@ -63,6 +66,36 @@ public:
         _numberSamples++;
     }
 
+    /*!
+        \brief merge
+        Combine with the statistics of another set of values, as if they had been added here - the last value is
+        taken from s
+        \param s
+    */
+    void merge(const StatisticsBase& s)
+    {
+        if (!s._numberSamples)
+            return;
+        if (!_numberSamples) {
+            _mean    = s._mean;
+            _m2      = s._m2;
+            _minimum = s._minimum;
+            _maximum = s._maximum;
+        }
+        else {
+            double na = _numberSamples;
+            double nb = s._numberSamples;
+            double n  = na + nb;
+            double d  = s._mean - _mean;
+            _mean += d * (nb / n);
+            _m2 += s._m2 + d * d * (na * nb / n);
+            _minimum = std::min(_minimum, s._minimum);
+            _maximum = std::max(_maximum, s._maximum);
+        }
+        _numberSamples += s._numberSamples;
+        _lastValue = s._lastValue;
+    }
+
     /*!
         \brief lastValue
         \return
@@ -89,10 +122,7 @@ public:
     */
     double mean() const
     {
-        if (_numberSamples) {
-            return _sum / double(_numberSamples);
-        }
-        return 0.0;
+        return _mean;
     }
 
     /**
@@ -104,7 +134,7 @@ public:
     double variance() const
     {
         if (_numberSamples > 1) {
-            return ((_sumSquares - ((_sum * _sum) / _numberSamples)) / (_numberSamples - 1));
+            return _m2 / (_numberSamples - 1);
         }
         else {
             return (0.0);
@@ -140,9 +170,11 @@ class Statistics
     double lastValue       = 0.0;
     unsigned numberSamples = 0;
     double sum             = 0.0;
-    double sumSquares      = 0.0;
+    double sumError        = 0.0;  // compensation of sum
+    double mean            = 0.0;
+    double m2              = 0.0;  // sum of squared deviations from the mean
     double minimum         = 0.0;
-    double oaximum         = 0.0;
+    double maximum         = 0.0;
     //
     // SPC metrics
     //
@@ -177,6 +209,9 @@ class Statistics
     int _meanCrowdingLimit = 10;
     int _trendCountLimit   = 5;
     //
+    void spc(double v);  // SPC tracking of one value
+    void addSum(double v);  // compensated add to sum
+    void combine(unsigned n, double s, double m, double d2, double mn, double mx);
 
 public:
     enum { SpcAlarmNone = 0, SpcAlarmMeanCrowding = 1, SpcAlarmTriggerCount = 2, SpcAlarmTrendCount = 4 };
@@ -197,7 +232,9 @@ public:
         : lastValue(s.lastValue)
         , numberSamples(s.numberSamples)
         , sum(s.sum)
-        , sumSquares(s.sumSquares)
+        , sumError(s.sumError)
+        , mean(s.mean)
+        , m2(s.m2)
         , minimum(s.minimum)
         , maximum(s.maximum)
         , trackSpc(s.trackSpc)
@@ -224,7 +261,7 @@ public:
     */
     virtual void clear()
     {
-        lastValue = sum = sumSquares = minimum = maximum = 0;
+        lastValue = sum = sumError = mean = m2 = minimum = maximum = 0;
         numberSamples = trendCount = meanCrowding = triggerCount = 0;
         dirTrendUp = dirTrendDown = false;
     }
@@ -235,6 +272,52 @@ public:
         @param v value to add to statistics
     */
     virtual void setValue(double v);
+    /**
+        @brief adds a batch of values - as setValue for each in turn. The batch mean and squared deviations are
+       formed in four interleaved lanes, with AVX2 or NEON where the build allows, and merged in, so they may differ
+       from repeated setValue in the last bits but are the same on every build. SPC tracking, if enabled, is still
+       evaluated value by value
+
+        @fn setValues
+        @param v values in order
+        @param n number of values
+    */
+    virtual void setValues(const double* v, size_t n);
+    /**
+        @brief Combines the population of another statistics object with this one, as if its values had been added
+       here - so partial statistics gathered in parallel or in shards can be reduced to the whole. The mean and
+       variance are combined pairwise (Chan et al.) so stay accurate however the population is split. The last value
+       and update time are taken from s if it has samples. SPC state and limits are not merged
+
+        @fn merge
+        @param s statistics to merge in
+    */
+    void merge(const Statistics& s);
+    /**
+        @brief Sets the population summary directly - e.g. from running statistics of a window. SPC state is not
+       changed
+
+        @fn setSummary
+        @param n number of samples
+        @param s sum of the values
+        @param ss sum of the squares of the values
+        @param mn minimum
+        @param mx maximum
+        @param last last value
+        @param t time of the last value
+    */
+    void setSummary(unsigned n, double s, double ss, double mn, double mx, double last, time_t t)
+    {
+        numberSamples = n;
+        sum           = s;
+        sumError      = 0.0;
+        mean          = n ? s / double(n) : 0.0;
+        m2            = n ? std::max(ss - s * mean, 0.0) : 0.0;
+        minimum       = mn;
+        maximum       = mx;
+        lastValue     = last;
+        updateTime    = t;
+    }
     /**
         @brief Gets the last value added to the statisics object
 
@@ -285,7 +368,7 @@ public:
         @fn getSum
         @return double
     */
-    double getSum() const { return sum; }
+    double getSum() const { return sum + sumError; }
     /**
         @brief Returns the upper control  limit
 
@@ -376,7 +459,7 @@ public:
     double variance() const
     {
         if (getNumberSamples() > 1) {
-            return ((sumSquares - ((sum * sum) / getNumberSamples())) / (getNumberSamples() - 1));
+            return m2 / (getNumberSamples() - 1);
         }
         else {
             return (0.0);
@@ -440,10 +523,7 @@ public:
     */
     double getMean() const
     {
-        if (numberSamples > 0) {
-            return sum / (double)numberSamples;
-        };
-        return 0;
+        return mean;
     }
     //
     /**
@@ -694,6 +774,18 @@ public:
         @fn increment
     */
     void increment() { _triggerCount++; }
+    /**
+        @brief  adds to the trigger count and sets the trigger state - the result of a batch of compares
+
+        @fn addTriggers
+        @param n number of values that triggered
+        @param triggered trigger state after the last value compared
+    */
+    void addTriggers(int n, bool triggered)
+    {
+        _triggerCount += n;
+        _triggered = triggered;
+    }
     /**
         @brief  returns true if the threshold is enabled
 
@@ -826,6 +918,19 @@ public:
     */
     void setThreshold(StatisticsThreshold::ThresholdTypes i, StatisticsThreshold& t) { _thresholds[i] = t; }
 
+    /*!
+        \brief thresholdsEnabled
+        \return true if any threshold is enabled
+    */
+    bool thresholdsEnabled()
+    {
+        for (auto& t : _thresholds) {
+            if (t.enabled())
+                return true;
+        }
+        return false;
+    }
+
     //
     /**
         @brief  returns true if any threshold has been triggered by the last value added
@@ -892,6 +997,15 @@ public:
             _thresholds[StatisticsThreshold::None].increment();  // nothing changed
         Statistics::setValue(v);
     }
+    /**
+        @brief Adds a batch of values - as setValue for each in turn. The thresholds are classified for all the
+       values at once
+
+        @fn setValues
+        @param v values in order
+        @param n number of values
+    */
+    void setValues(const double* v, size_t n);
     //
     /**
         @brief Clears and resets the statistics object and trigger states
@@ -1,4 +1,5 @@
 #include "variant.h"
+#include <open62541cpp/jsonstream.h>
 
 // This is the object's type
 #define JSON_OBJECT_TYPE "__TYPE__"
@@ -10,25 +11,25 @@
 */
 void MRL::setJson(Wt::Json::Value& v, Variant& a)
 {
-    const char* tn = a.type().name();
-    switch (tn[0]) {
-        case 'i':
+    switch (a.which()) {
+        case 0:
             v = boost::get<int>(a);
             break;
-        case 'u':
+        case 1:
             v = (double)(boost::get<unsigned>(a));
             break;
-        case 'd':
+        case 2:
             v = boost::get<double>(a);
             break;
-        case 'S':
+        case 3:
             v = boost::get<std::string>(a).c_str();
             break;
-        case 'b':
+        case 4:
             v = boost::get<bool>(a);
             break;
-        case 't':
+        case 5:
             v = (long long)(boost::get<time_t>(a));
+            break;
         default:
             break;
     }
@@ -60,55 +61,148 @@ void MRL::getJson(Wt::Json::Value& v, Variant& a)
 
 /*!
     \brief MRL::toString
-    Could use visitors but .... this may be more efficent - exploits all type names start with different letter WARNING
-   !!!!! \param v \return
+    \param v
+    \return the value as text - empty for a void*
 */
 std::string MRL::toString(const Variant& v)
 {
-    std::string res = "";
-    const char* tn  = v.type().name();
-    switch (tn[0]) {
-        case 'i':
+    switch (v.which()) {
+        case 0:
             return std::to_string(boost::get<int>(v));
-        case 'u':
+        case 1:
             return std::to_string(boost::get<unsigned>(v));
-        case 'd':
+        case 2:
             return std::to_string(boost::get<double>(v));
-        case 'S':
+        case 3:
             return boost::get<std::string>(v);
-        case 'b':
+        case 4:
             return std::string(boost::get<bool>(v) ? "true" : "false");
-        case 't':
+        case 5:
             return std::to_string(boost::get<time_t>(v));
-
         default:
             break;
     }
-    return res;
+    return std::string();
 }
 
+/*!
+    \brief MRL::toJsonString
+    \param v
+    \return the value as JSON text - strings are escaped
+*/
 std::string MRL::toJsonString(const Variant& v)
 {
-    std::string res = "";
-    const char* tn  = v.type().name();
-    switch (tn[0]) {
+    if (v.which() == 6)
+        return std::string();  // void*
+    Open62541::JsonWriter w(32);
+    writeJson(w, v);
+    return w.str();
+}
+
+/*!
+    \brief MRL::writeJson
+    Write the bare value - numbers as numbers, a void* as null
+    \param w
+    \param v
+*/
+void MRL::writeJson(Open62541::JsonWriter& w, const Variant& v)
+{
+    switch (v.which()) {
+        case 0:
+            w.number(boost::get<int>(v));
+            break;
+        case 1:
+            w.number(boost::get<unsigned>(v));
+            break;
+        case 2:
+            w.number(boost::get<double>(v));
+            break;
+        case 3:
+            w.string(boost::get<std::string>(v));
+            break;
+        case 4:
+            w.boolean(boost::get<bool>(v));
+            break;
+        case 5:
+            w.number(int64_t(boost::get<time_t>(v)));
+            break;
+        default:
+            w.null();
+            break;
+    }
+}
+
+/*!
+    \brief MRL::readJson
+    Read a bare value - numbers are read as doubles until setJsonType() is applied
+    \param r
+    \param v
+    \return false if the value is not a scalar
+*/
+bool MRL::readJson(Open62541::JsonReader& r, Variant& v)
+{
+    switch (r.peek()) {
+        case Open62541::JsonReader::Type::Number: {
+            double d = 0.0;
+            if (!r.number(d))
+                return false;
+            v = d;
+        } break;
+        case Open62541::JsonReader::Type::String: {
+            std::string s;
+            if (!r.string(s))
+                return false;
+            v = s;
+        } break;
+        case Open62541::JsonReader::Type::Boolean: {
+            bool f = false;
+            if (!r.boolean(f))
+                return false;
+            v = f;
+        } break;
+        case Open62541::JsonReader::Type::Null:
+            v = int(0);
+            return r.null();
+        default:
+            r.skip();
+            return false;
+    }
+    return true;
+}
+
+/*!
+    \brief MRL::jsonType
+    \param v
+    \return the type tag of the value or nullptr if it has none
+*/
+const char* MRL::jsonType(const Variant& v)
+{
+    static const char* tags[] = {"i", "u", "d", "s", "b", "t"};
+    return (v.which() < 6) ? tags[v.which()] : nullptr;
+}
+
+/*!
+    \brief MRL::setJsonType
+    Convert a value read from JSON back to the type given by its tag
+    \param v
+    \param t tag from jsonType()
+*/
+void MRL::setJsonType(Variant& v, const std::string& t)
+{
+    if ((t.size() != 1) || (v.which() != 2))
+        return;  // only numbers lose their type
+    double d = boost::get<double>(v);
+    switch (t[0]) {
         case 'i':
-            return std::to_string(boost::get<int>(v));
+            v = int(d);
+            break;
         case 'u':
-            return std::to_string(boost::get<unsigned>(v));
-        case 'd':
-            return std::to_string(boost::get<double>(v));
-        case 'S': {
-            std::string s = "\"" + boost::get<std::string>(v) + "\"";
-            return s;
-        }
-        case 'b':
-            return std::string(boost::get<bool>(v) ? "true" : "false");
+            v = unsigned(d);
+            break;
         case 't':
-            return std::to_string(boost::get<time_t>(v));
-
+            v = time_t(d);
+            break;
         default:
             break;
     }
-    return res;
 }
@@ -8,10 +8,16 @@
 #include <memory>
 #include <boost/variant.hpp>
 #include <list>
+#include <cstdlib>
+#include <type_traits>
 //
 // JSON support
 #include <Wt/Json/Value>
 //
+namespace Open62541 {
+class JsonWriter;
+class JsonReader;
+}  // namespace Open62541
 
 namespace MRL {
 typedef boost::variant<int, unsigned, double, std::string, bool, time_t, void*> Variant;
@@ -30,6 +36,12 @@ typedef NodePath<std::string> PropertyPath;
 // convert to/from JSON
 void setJson(Wt::Json::Value&, Variant&);
 void getJson(Wt::Json::Value&, Variant&);
+//
+// streaming JSON - no DOM. The type tag keeps what a JSON number loses
+void writeJson(Open62541::JsonWriter&, const Variant&);
+bool readJson(Open62541::JsonReader&, Variant&);
+const char* jsonType(const Variant&);
+void setJsonType(Variant&, const std::string&);
 
 template <typename T>
 /*!
@@ -47,12 +59,39 @@ inline const std::string valueToString(const MRL::Variant& v)
     return toString(v);
 }
 
+/*!
+    \brief The NumberOf struct
+    Converts whichever number a variant holds - text is parsed, a pointer is zero
+*/
+template <typename T>
+struct NumberOf : boost::static_visitor<T> {
+    template <typename U>
+    T operator()(const U& u) const
+    {
+        return T(u);
+    }
+    T operator()(const std::string& s) const { return T(std::strtod(s.c_str(), nullptr)); }
+    T operator()(void*) const { return T(); }
+};
+
 template <typename T>
-const T& valueToType(const MRL::Variant& v)
+typename std::enable_if<!std::is_arithmetic<T>::value, const T&>::type valueToType(const MRL::Variant& v)
 {
     return boost::get<T>(v);
 }
 
+/*!
+    \brief valueToType
+    Numbers convert between the numeric slots, so a value set as an int reads as a double
+    \param v
+    \return the value as T
+*/
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, T>::type valueToType(const MRL::Variant& v)
+{
+    return boost::apply_visitor(NumberOf<T>(), v);
+}
+
 }  // namespace MRL
 
 #endif  // VARIANT_H
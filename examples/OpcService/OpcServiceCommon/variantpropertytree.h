@@ -7,47 +7,115 @@
 #include <Wt/Json/Value>
 #include <OpcServiceCommon/variant.h>
 #include <OpcServiceCommon/vauletree.h>
+#include <cstdlib>
+#include <limits>
 
 namespace MRL {
 /*!
  * \brief The VariantPropertyTree class
- * Wt::JSON does not store type information for numbers, so all numbers in Json are doubles
+ * Numbers are kept in their own slots - int, unsigned, double, bool and time_t, the 64 bit integer - and read
+ * back as any numeric type without a string round trip. Wt::Json does not store type information for numbers,
+ * so a tree loaded with fromJson holds doubles; readJson keeps the types. Setters are journaled - see
+ * ValueTree::setJournal
  */
 class VariantPropertyTree : public ValueTree<Variant>
 {
+    /*!
+        \brief The AddTo struct
+        The sum of a number and the delta, in the number's own slot - a value that is not a number gives the delta.
+        The result is built before it is assigned, as the visited value belongs to the variant being replaced
+    */
+    struct AddTo : boost::static_visitor<Variant> {
+        double delta;
+        AddTo(double d)
+            : delta(d)
+        {
+        }
+        template <typename U>
+        Variant operator()(const U& u) const
+        {
+            return Variant(U(u + delta));
+        }
+        Variant operator()(const bool&) const { return Variant(delta); }
+        Variant operator()(const std::string&) const { return Variant(delta); }
+        Variant operator()(void* const&) const { return Variant(delta); }
+    };
+
+    template <typename P>
+    void assign(const P& path, const Variant& v)
+    {
+        set(path, v);
+        record(path);
+    }
+
 public:
     VariantPropertyTree() = default;
 
     template <typename P>
     void setNumber(const P& path, int v)
     {
-        double a = v;
-        setValue(path, a);
+        assign(path, Variant(v));
     }
     template <typename P>
     void setNumber(const P& path, unsigned int v)
     {
-        double a = v;
-        setValue(path, a);
+        assign(path, Variant(v));
+    }
+    template <typename P>
+    void setNumber(const P& path, long v)
+    {
+        assign(path, Variant(time_t(v)));
     }
     template <typename P>
     void setNumber(const P& path, long long v)
     {
-        double a = v;
-        setValue(path, a);
+        assign(path, Variant(time_t(v)));
     }
     template <typename P>
     void setNumber(const P& path, unsigned long long v)
     {
-        double a = v;
-        setValue(path, a);
+        if (v <= (unsigned long long)(std::numeric_limits<time_t>::max()))
+            assign(path, Variant(time_t(v)));
+        else
+            assign(path, Variant(double(v)));
+    }
+    template <typename P>
+    void setNumber(const P& path, double v)
+    {
+        assign(path, Variant(v));
+    }
+    template <typename P>
+    void setNumber(const P& path, bool v)
+    {
+        assign(path, Variant(v));
     }
 
+    /*!
+     * \brief setNumber
+     * Parse text once, at the edge - integers go to the 64 bit slot, anything else to a double. Text that is
+     * not a number sets zero
+     * \param path
+     * \param v
+     */
     template <typename P>
     void setNumber(const P& path, const std::string& v)
     {
-        double a = std::stod(v);
-        setValue(path, a);
+        const char* b = v.c_str();
+        char* e       = nullptr;
+        long long i   = std::strtoll(b, &e, 10);
+        if ((e != b) && (*e == 0)) {
+            setNumber(path, i);
+        }
+        else {
+            double d = std::strtod(b, &e);
+            setNumber(path, (e != b) ? d : 0.0);
+        }
+    }
+
+    template <typename P>
+    void setNumber(const P& path, const char* v)
+    {
+        setNumber(path, std::string(v));  // not the bool overload
     }
 
     template <typename P, typename T>
@@ -58,26 +126,46 @@ public:
      */
     T getNumber(const P& path)
     {
-        auto n   = node(path);
-        double a = 0.0;
-        if (n) {
-            try {
-                if (isType<std::string>(n->data())) {
-                    std::string s = boost::get<std::string>(n->data());
-                    a             = std::stod(s);
-                }
-                else if (isType<bool>(n->data())) {
-                    bool f = boost::get<bool>(n->data());
-                    a      = f ? 1.0 : 0.0;
-                }
-                else {
-                    a = getValue<double>(path);
-                }
-            }
-            catch (...) {
-            }
+        return getValue<T>(path);
+    }
+
+    /*!
+     * \brief update
+     * Change a value in place under the lock of its branch - f is passed the Variant
+     * \param path
+     * \param f
+     * \return false if there is no node at path
+     */
+    template <typename P, typename F>
+    bool update(const P& path, F f)
+    {
+        {
+            ReadLock l(this->mutex());
+            WriteLock b(this->pathMutex(path));
+            auto* n = this->root().find(path);
+            if (!n)
+                return false;
+            f(n->data());
         }
-        return T(a);
+        this->setChanged();
+        record(path);
+        return true;
+    }
+
+    /*!
+     * \brief addNumber
+     * Add to a number in its own slot - e.g. a counter. A missing node is created with the delta
+     * \param path
+     * \param delta
+     */
+    template <typename P>
+    void addNumber(const P& path, double delta)
+    {
+        if (!update(path, [delta](Variant& v) {
+                Variant sum = boost::apply_visitor(AddTo(delta), v);
+                v           = sum;
+            }))
+            setNumber(path, delta);
     }
 };
 }  // namespace MRL
@@ -5,6 +5,9 @@
 #include "propertytree.h"
 #include <Wt/Json/Object>
 #include <Wt/Json/Value>
+#include <open62541cpp/jsonstream.h>
+#include <memory>
+#include <unordered_map>
 
 namespace MRL {
 
@@ -18,6 +21,62 @@ class ValueTree : public PropertyTree<std::string, V>
 public:
     typedef Node<std::string, V> ValueNode;
     typedef NodePath<std::string> ValuePath;
+
+private:
+    /*!
+        \brief The Journal struct
+        Ring of changed paths. A path changed again is recorded again; delta() skips all but its latest entry
+    */
+    struct Journal {
+        /*!
+            \brief The Entry struct
+        */
+        struct Entry {
+            uint64_t sequence = 0;
+            ValuePath path;
+            std::string key;  // path joined with '.'
+        };
+        ReadWriteMutex mutex;
+        uint64_t sequence = 0;  // of the last change
+        uint64_t dropped  = 0;  // changes up to this are no longer in the ring
+        std::vector<Entry> ring;
+        size_t next = 0;                                // slot the next change goes in
+        std::unordered_map<std::string, uint64_t> last;  // latest sequence per path
+        std::map<uint64_t, std::string> deltas;          // built since the last change - by since
+    };
+    std::unique_ptr<Journal> _journal;
+
+    static void joinPath(const std::string& path, std::string& k) { k = path; }
+    static void joinPath(const ValuePath& path, std::string& k) { path.toString(k); }
+    static void splitPath(const std::string& path, ValuePath& p) { p.toList(path); }
+    static void splitPath(const ValuePath& path, ValuePath& p) { p = path; }
+
+protected:
+    template <typename P>
+    /*!
+        \brief record
+        Journal a change of the value at path - called after the value is set
+        \param path
+    */
+    void record(const P& path)
+    {
+        if (_journal) {
+            Journal& j = *_journal;
+            WriteLock l(j.mutex);
+            auto& e = j.ring[j.next];
+            if (e.sequence)
+                j.dropped = e.sequence;
+            e.sequence = ++j.sequence;
+            e.path.clear();
+            splitPath(path, e.path);
+            joinPath(path, e.key);
+            j.last[e.key] = e.sequence;
+            j.next        = (j.next + 1) % j.ring.size();
+            j.deltas.clear();
+        }
+    }
+
+public:
     /*!
         \brief VariantPropertyTree
     */
@@ -35,6 +94,7 @@ public:
     {
         T a(v);
         this->set(path, a);
+        record(path);
     }
 
     //
@@ -50,6 +110,7 @@ public:
             path.push_back(c);
             V a(v);
             this->set(path, a);
+            record(path);
             path.pop_back();
         }
     }
@@ -64,7 +125,9 @@ public:
     {
         try {
             ReadLock l(this->mutex());
-            V& a = this->get(path);
+            ReadLock b(this->pathMutex(path));
+            auto* n = this->root().find(path);
+            V& a    = n ? n->data() : this->_defaultData;
             if (!a.empty()) {
                 std::string s = valueToString(a);  // intelligent conversion
                 return s;
@@ -85,6 +148,7 @@ public:
     {
         try {
             ReadLock l(this->mutex());
+            ReadLock b(this->pathMutex(path));
             auto* n = this->root().find(path);
             if (n) {
                 V& a = n->data();
@@ -108,8 +172,9 @@ public:
     {
         if (!c.empty()) {
             try {
-                ReadLock l(this->mutex());
                 p.push_back(c);
+                ReadLock l(this->mutex());
+                ReadLock b(this->pathMutex(p));
                 auto* n = this->root().find(p);
                 p.pop_back();
                 if (n) {
@@ -252,6 +317,261 @@ public:
         // whole tree
         this->clear();
         fromJson(this->rootNode(), v);
+        invalidateJournal();
+    }
+
+    //
+    // Streaming JSON - the same layout as toJson() plus a type tag per value, written straight to the
+    // buffer of a JsonWriter that is reused between calls
+    //
+    /*!
+        \brief writeJson
+        \param w
+        \param n
+    */
+    void writeJson(Open62541::JsonWriter& w, ValueNode* n)
+    {
+        w.key(n->name()).beginObject();
+        const char* t = jsonType(n->data());
+        if (t)
+            w.key("type", 4).string(t);
+        w.key("value", 5);
+        MRL::writeJson(w, n->data());
+        if (n->children().size() > 0) {
+            w.key("children", 8).beginObject();
+            for (auto i = n->children().begin(); i != n->children().end(); i++) {
+                if (i->second)
+                    writeJson(w, i->second);
+            }
+            w.endObject();
+        }
+        w.endObject();
+    }
+
+    /*!
+        \brief writeJson
+        Write the whole tree as one object - the writer is cleared first
+        \param w
+    */
+    void writeJson(Open62541::JsonWriter& w)
+    {
+        ReadLock l(this->mutex());
+        std::vector<ReadLock> b;
+        this->lockBranches(b);
+        w.clear();
+        w.beginObject();
+        writeJson(w, this->rootNode());
+        w.endObject();
+    }
+
+    /*!
+        \brief readJson
+        Read the node at path and its children
+        \param r
+        \param path
+        \return false on a syntax error
+    */
+    bool readJson(Open62541::JsonReader& r, ValuePath& path)
+    {
+        if (!r.beginObject())
+            return false;
+        std::string k;
+        std::string t;
+        V v;
+        bool hasValue = false;
+        while (r.member(k)) {
+            if (k == "type") {
+                if (!r.string(t))
+                    return false;
+            }
+            else if (k == "value") {
+                hasValue = MRL::readJson(r, v);
+            }
+            else if (k == "children") {
+                if (!r.beginObject())
+                    return false;
+                std::string c;
+                while (r.member(c)) {
+                    path.push_back(c);
+                    bool ok = readJson(r, path);
+                    path.pop_back();
+                    if (!ok)
+                        return false;
+                }
+            }
+            else if (!r.skip()) {
+                return false;
+            }
+        }
+        if (hasValue) {
+            setJsonType(v, t);
+            this->set(path, v);
+        }
+        return r.ok();
+    }
+
+    /*!
+        \brief readJson
+        Replace the tree with one written by writeJson() or toJson()
+        \param r
+        \return false on a syntax error - the tree then holds what was read before it
+    */
+    bool readJson(Open62541::JsonReader& r)
+    {
+        this->clear();
+        invalidateJournal();
+        if (!r.beginObject())
+            return false;
+        std::string k;
+        while (r.member(k)) {
+            ValuePath p;
+            if (!((k == this->rootNode()->name()) ? readJson(r, p) : r.skip()))
+                return false;
+        }
+        return r.ok();
+    }
+
+    //
+    // Change journal - lets a display that has the tree take only what changed since it last looked
+    //
+    /*!
+        \brief setJournal
+        Journal changes made through setValue (and the VariantPropertyTree setters) from now on. Readers that fall
+        further behind than the ring must take the whole tree again
+        \param capacity changes kept - 0 stops journaling
+    */
+    void setJournal(size_t capacity)
+    {
+        if (capacity) {
+            _journal.reset(new Journal);
+            _journal->ring.resize(capacity);
+        }
+        else {
+            _journal.reset();
+        }
+    }
+
+    /*!
+        \brief journaled
+        \return true if changes are journaled
+    */
+    bool journaled() const { return _journal != nullptr; }
+
+    /*!
+        \brief invalidateJournal
+        Values were loaded without journaling - every reader must take the whole tree again
+    */
+    void invalidateJournal()
+    {
+        if (_journal) {
+            Journal& j = *_journal;
+            WriteLock l(j.mutex);
+            j.dropped = ++j.sequence;
+            j.last.clear();
+            j.deltas.clear();
+        }
+    }
+
+    /*!
+        \brief sequence
+        \return sequence number of the last change - 0 if there is no journal
+    */
+    uint64_t sequence()
+    {
+        if (!_journal)
+            return 0;
+        ReadLock l(_journal->mutex);
+        return _journal->sequence;
+    }
+
+    template <typename P>
+    /*!
+        \brief sequence
+        \param path
+        \return sequence number of the last journaled change of the value at path - 0 if none
+    */
+    uint64_t sequence(const P& path)
+    {
+        if (_journal) {
+            std::string k;
+            joinPath(path, k);
+            ReadLock l(_journal->mutex);
+            auto i = _journal->last.find(k);
+            if (i != _journal->last.end())
+                return i->second;
+        }
+        return 0;
+    }
+
+    /*!
+        \brief snapshot
+        Write the whole tree, as writeJson(), for a reader that is starting or has fallen behind
+        \param w
+        \return sequence to pass to delta() next - taken first, so a change made during the write is sent again
+    */
+    uint64_t snapshot(Open62541::JsonWriter& w)
+    {
+        uint64_t s = sequence();
+        writeJson(w);
+        return s;
+    }
+
+    /*!
+        \brief delta
+        The values changed after a sequence number, latest value once per path:
+            {"sequence":n,"changes":{"a.b":{"type":"d","value":1.5},"a.c":null}}
+        null marks a value that has gone. Readers asking with the same since between two changes - sessions
+        refreshed on a common tick - share one serialisation
+        \param since sequence returned by the last delta() or snapshot()
+        \param out JSON
+        \param seen set to the sequence to pass next time
+        \return false if there is no journal or it no longer reaches back to since - take a snapshot()
+    */
+    bool delta(uint64_t since, std::string& out, uint64_t& seen)
+    {
+        if (!_journal)
+            return false;
+        Journal& j = *_journal;
+        WriteLock l(j.mutex);  // the shared deltas are built under it
+        if (since < j.dropped)
+            return false;
+        seen   = j.sequence;
+        auto d = j.deltas.find(since);
+        if (d == j.deltas.end()) {
+            Open62541::JsonWriter w(256);
+            w.beginObject();
+            w.key("sequence", 8).number(uint64_t(j.sequence));
+            w.key("changes", 7).beginObject();
+            const size_t n = j.ring.size();
+            for (size_t k = 1; k <= n; k++) {
+                const auto& e = j.ring[(j.next + n - k) % n];  // newest first - stop at what the reader has
+                if (e.sequence <= since)
+                    break;
+                if (j.last[e.key] != e.sequence)
+                    continue;  // changed again later
+                w.key(e.key);
+                ReadLock tl(this->mutex());
+                ReadLock bl(this->pathMutex(e.path));
+                ValueNode* vn = this->root().find(e.path);
+                if (vn) {
+                    w.beginObject();
+                    const char* t = jsonType(vn->data());
+                    if (t)
+                        w.key("type", 4).string(t);
+                    w.key("value", 5);
+                    MRL::writeJson(w, vn->data());
+                    w.endObject();
+                }
+                else {
+                    w.null();
+                }
+            }
+            w.endObject();
+            w.endObject();
+            d = j.deltas.emplace(since, w.str()).first;
+        }
+        out = d->second;
+        return true;
     }
 
     /*!
@@ -10,7 +10,8 @@ SOURCES += main.cpp \
     simulatornodecontext.cpp \
     simulatorstartmethod.cpp \
     simulatorstopmethod.cpp \
-    simulateprocess.cpp
+    simulateprocess.cpp \
+    simulationengine.cpp
 
 HEADERS += \
     simulatorapp.h \
@@ -20,4 +21,5 @@ HEADERS += \
     simulatornodecontext.h \
     simulatorstartmethod.h \
     simulatorstopmethod.h \
-    simulateprocess.h
+    simulateprocess.h \
+    simulationengine.h
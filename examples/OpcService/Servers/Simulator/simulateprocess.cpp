@@ -37,12 +37,52 @@ SimulateProcess::SimulateProcess(Open62541::Server& s, int ns)
     _startMethod.addServerMethod(s, "Start", folder, startMethodId, Open62541::NodeId::Null, _idx);
     _stopMethod.addServerMethod(s, "Stop", folder, stopMethodId, Open62541::NodeId::Null, _idx);
     //
+    MRL::PropertyPath cfg;
+    cfg.push_back(STOCKDEFS::ConfigureSection);
+    int n = int(MRL::OpcServiceCommon::data().getValue<double>(cfg, "LoadTags"));
+    if (n > 0)
+        addLoadTags(s, folder, n);
+}
+
+/*!
+    \brief addLoadTags
+    \param s
+    \param folder
+    \param n
+*/
+void SimulateProcess::addLoadTags(Open62541::Server& s, const Open62541::NodeId& folder, int n)
+{
+    Open62541::ServerNodeBuilder b(s, _idx);
+    b.reserve(size_t(n) + 1);
+    _engine.reserve(size_t(n));
+    Open62541::Variant initial(0.0);
+    auto load = b.addFolder(folder, "Load", Open62541::NodeId(_idx, "Load"));
+    for (int i = 0; i < n; i++) {
+        Open62541::NodeId id(_idx, LoadId + i);
+        b.addVariable(load, "Tag" + std::to_string(i), initial, id);
+        // cycle the profiles and spread the periods and start points so the tags do not move together
+        auto p = SimulationEngine::Profile(i % SimulationEngine::Profiles);
+        _engine.add(id, p, 0.0, 100.0, 10.0 + (i % 50), double(i) / n);
+    }
+    if (!b.build()) {
+        TRC("Failed to add all load tags")
+    }
 }
 /*!
     \brief callback
 */
 void SimulateProcess::callback()
 {
+    // advance the load tags - one batch write of those that moved
+    if (_engine.size()) {
+        // step by the time that has passed - the callback is not run exactly on its interval
+        const UA_DateTime now = UA_DateTime_nowMonotonic();
+        const double dt       = _lastStep ? double(now - _lastStep) / UA_DATETIME_SEC : 1.0;
+        _lastStep             = now;
+        _engine.step(dt);
+        _engine.publish(server());
+    }
+    //
     // get the current parameters
     _ticks++;
     MRL::PropertyPath cfg;
@@ -2,14 +2,16 @@
 #define SIMULATEPROCESS_H
 #include <open62541cpp/open62541server.h>
 #include <open62541cpp/serverrepeatedcallback.h>
+#include <open62541cpp/servernodebuilder.h>
 #include <OpcServiceCommon/opcservicecommon.h>
 #include "simulatordefs.h"
 #include <OpcServiceCommon/stockdefs.h>
 #include "simulatornodecontext.h"
 #include "simulatorstartmethod.h"
 #include "simulatorstopmethod.h"
+#include "simulationengine.h"
 
-enum { ValueId = 1000, StatusId, RangeId, TypeId, IntervalId };
+enum { ValueId = 1000, StatusId, RangeId, TypeId, IntervalId, LoadId = 100000 };  // load tags from LoadId up
 
 /*!
  * \brief The SimulateProcess class
@@ -17,14 +19,25 @@ enum { ValueId = 1000, StatusId, RangeId, TypeId, IntervalId };
  */
 class SimulateProcess : public Open62541::SeverRepeatedCallback
 {
-    int _ticks     = 0;
-    int _lastValue = 0;     // the last generated value
-    bool _dirUp    = true;  // ramp direction
-    int _idx;               // The namespace
+    int _ticks            = 0;
+    int _lastValue        = 0;     // the last generated value
+    bool _dirUp           = true;  // ramp direction
+    UA_DateTime _lastStep = 0;     // monotonic time the load tags were last stepped
+    int _idx;                      // The namespace
     //
     SimulatorNodeContext _context;
     SimulatorStartMethod _startMethod;
     SimulatorStopMethod _stopMethod;
+    SimulationEngine _engine;  // load tags
+    //
+    /*!
+        \brief addLoadTags
+        Add the configured number of load tags below the folder and register them with the engine
+        \param s server
+        \param folder parent
+        \param n number of tags
+    */
+    void addLoadTags(Open62541::Server& s, const Open62541::NodeId& folder, int n);
     //
     // The node ids used
     //
@@ -0,0 +1,201 @@
+#include "simulationengine.h"
+#include <algorithm>
+#include <cmath>
+
+static const double TwoPi = 6.283185307179586;
+
+/*!
+ * \brief SimulationEngine::~SimulationEngine
+ */
+SimulationEngine::~SimulationEngine()
+{
+    for (auto& n : _nodes)
+        UA_NodeId_clear(&n);
+}
+
+/*!
+ * \brief SimulationEngine::reserve
+ * \param n
+ */
+void SimulationEngine::reserve(size_t n)
+{
+    _nodes.reserve(n);
+    _published.reserve(n);
+    _batchIds.reserve(n);
+    _batchValues.reserve(n);
+    _results.reserve(n);
+}
+
+/*!
+ * \brief SimulationEngine::add
+ * \param node
+ * \param p
+ * \param low
+ * \param high
+ * \param period
+ * \param offset
+ */
+void SimulationEngine::add(const Open62541::NodeId& node,
+                           Profile p,
+                           double low,
+                           double high,
+                           double period,
+                           double offset)
+{
+    if ((p < 0) || (p >= Profiles))
+        return;
+    if (period <= 0.0)
+        period = 1.0;
+    offset = offset - std::floor(offset);
+    Block& b = _blocks[p];
+    const uint32_t tag = uint32_t(_nodes.size());
+    UA_NodeId id;
+    UA_NodeId_copy(node.constRef(), &id);
+    _nodes.push_back(id);
+    b.tag.push_back(tag);
+    b.low.push_back(low);
+    b.high.push_back(high);
+    b.phase.push_back(0.0);
+    b.state.push_back(0);
+    double v = low;
+    switch (p) {
+        case RandomWalk:
+            b.rate.push_back((high - low) / period);
+            b.state.back() = 0x9E3779B97F4A7C15ULL * (tag + 1);  // any odd multiple - never zero
+            v              = low + (high - low) * offset;
+            break;
+        case Sine:
+            b.rate.push_back(TwoPi / period);
+            b.phase.back() = TwoPi * offset;
+            v              = (low + high) / 2 + (high - low) / 2 * std::sin(b.phase.back());
+            break;
+        case Ramp:
+            b.rate.push_back((high - low) / period);
+            v = low + (high - low) * offset;
+            break;
+        case Step:
+            b.rate.push_back(period);
+            b.phase.back() = period * offset;
+            v              = (b.phase.back() < period / 2) ? high : low;
+            break;
+        default:
+            break;
+    }
+    b.value.push_back(v);
+    _published.push_back(std::nan(""));  // written on the first publish
+}
+
+/*!
+ * \brief SimulationEngine::step
+ * \param dt
+ */
+void SimulationEngine::step(double dt)
+{
+    {
+        // random walk - xorshift per tag, a uniform step in [-rate, rate) * dt, held in range
+        Block& b         = _blocks[RandomWalk];
+        const size_t n   = b.value.size();
+        double* v        = b.value.data();
+        const double* lo = b.low.data();
+        const double* hi = b.high.data();
+        const double* r  = b.rate.data();
+        uint64_t* s      = b.state.data();
+        for (size_t i = 0; i < n; i++) {
+            uint64_t x = s[i];
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            s[i]           = x;
+            const double u = double(x >> 11) * (1.0 / 9007199254740992.0);  // [0, 1)
+            const double w = v[i] + r[i] * dt * (2.0 * u - 1.0);
+            v[i]           = std::min(std::max(w, lo[i]), hi[i]);
+        }
+    }
+    {
+        Block& b         = _blocks[Sine];
+        const size_t n   = b.value.size();
+        double* v        = b.value.data();
+        const double* lo = b.low.data();
+        const double* hi = b.high.data();
+        const double* r  = b.rate.data();
+        double* a        = b.phase.data();
+        for (size_t i = 0; i < n; i++) {
+            double x = a[i] + r[i] * dt;
+            x -= TwoPi * std::floor(x / TwoPi);
+            a[i] = x;
+            v[i] = 0.5 * (lo[i] + hi[i]) + 0.5 * (hi[i] - lo[i]) * std::sin(x);
+        }
+    }
+    {
+        // ramp - saw tooth from low to high
+        Block& b         = _blocks[Ramp];
+        const size_t n   = b.value.size();
+        double* v        = b.value.data();
+        const double* lo = b.low.data();
+        const double* hi = b.high.data();
+        const double* r  = b.rate.data();
+        for (size_t i = 0; i < n; i++) {
+            const double span = hi[i] - lo[i];
+            if (span <= 0.0) {
+                v[i] = lo[i];
+                continue;
+            }
+            double w = v[i] - lo[i] + r[i] * dt;
+            w -= span * std::floor(w / span);  // wrapped into [low, high) however far one step goes
+            v[i] = lo[i] + w;
+        }
+    }
+    {
+        // step - high for the first half of each period, low for the second
+        Block& b         = _blocks[Step];
+        const size_t n   = b.value.size();
+        double* v        = b.value.data();
+        const double* lo = b.low.data();
+        const double* hi = b.high.data();
+        const double* p  = b.rate.data();
+        double* t        = b.phase.data();
+        for (size_t i = 0; i < n; i++) {
+            double x = t[i] + dt;
+            x -= p[i] * std::floor(x / p[i]);
+            t[i] = x;
+            v[i] = (x < 0.5 * p[i]) ? hi[i] : lo[i];
+        }
+    }
+}
+
+/*!
+ * \brief SimulationEngine::publish
+ * \param s
+ * \return number written
+ */
+size_t SimulationEngine::publish(Open62541::Server& s)
+{
+    _batchIds.clear();
+    _batchValues.clear();
+    for (Block& b : _blocks) {
+        const size_t n = b.value.size();
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t tag = b.tag[i];
+            double& last       = _published[tag];
+            if (!(std::fabs(b.value[i] - last) <= _deadband)) {  // NaN - never written - fails the test
+                last = b.value[i];
+                _batchIds.push_back(_nodes[tag]);  // shallow
+                UA_Variant v;
+                UA_Variant_setScalar(&v, &b.value[i], &UA_TYPES[UA_TYPES_DOUBLE]);
+                v.storageType = UA_VARIANT_DATA_NODELETE;  // points into the block
+                _batchValues.push_back(v);
+            }
+        }
+    }
+    const size_t n = _batchIds.size();
+    if (n) {
+        _results.resize(n);
+        if (!s.writeValues(n, _batchIds.data(), _batchValues.data(), _results.data())) {
+            for (UA_StatusCode r : _results) {
+                if (r != UA_STATUSCODE_GOOD)
+                    _failed++;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,88 @@
+#ifndef SIMULATIONENGINE_H
+#define SIMULATIONENGINE_H
+#include <open62541cpp/open62541server.h>
+#include <cstdint>
+#include <vector>
+
+/*!
+ * \brief The SimulationEngine class
+ * Simulates many tags at once. Tag states are held as structure of arrays, one block per profile, so a step is
+ * one tight branch free loop per profile over contiguous doubles that the compiler can vectorise - there is no
+ * per tag callback or Variant. Changed values are published with one batch write whose variants point
+ * straight into the state arrays
+ */
+class SimulationEngine
+{
+public:
+    enum Profile { RandomWalk = 0, Sine, Ramp, Step, Profiles };
+
+private:
+    /*!
+     * \brief The Block struct
+     * The tags of one profile
+     */
+    struct Block {
+        std::vector<uint32_t> tag;    // index of the node and its published value
+        std::vector<double> value;    // current value
+        std::vector<double> low;      // range
+        std::vector<double> high;     //
+        std::vector<double> rate;     // per second - change, angular frequency or period by profile
+        std::vector<double> phase;    // sine angle or step time
+        std::vector<uint64_t> state;  // random walk generator state
+    };
+
+    Block _blocks[Profiles];
+    std::vector<UA_NodeId> _nodes;    // owned
+    std::vector<double> _published;   // last value written per tag
+    double _deadband = 0.0;           // smallest change published
+    //
+    // reused publish batch - shallow node ids and variants pointing into the blocks
+    std::vector<UA_NodeId> _batchIds;
+    std::vector<UA_Variant> _batchValues;
+    std::vector<UA_StatusCode> _results;
+    size_t _failed = 0;
+
+public:
+    SimulationEngine() = default;
+    SimulationEngine(const SimulationEngine&) = delete;
+    SimulationEngine& operator=(const SimulationEngine&) = delete;
+    ~SimulationEngine();
+
+    /*!
+     * \brief reserve
+     * \param n tags
+     */
+    void reserve(size_t n);
+
+    /*!
+     * \brief add
+     * \param node variable written with the tag's value - a Double
+     * \param p profile
+     * \param low bottom of the range
+     * \param high top of the range
+     * \param period seconds - for a full swing, cycle or ramp
+     * \param offset 0 to 1 - start point in the cycle, so tags do not move in step
+     */
+    void add(const Open62541::NodeId& node, Profile p, double low, double high, double period, double offset = 0.0);
+
+    /*!
+     * \brief step
+     * Advance every tag
+     * \param dt seconds
+     */
+    void step(double dt);
+
+    /*!
+     * \brief publish
+     * Write the values that moved by more than the deadband since they were last written
+     * \param s server
+     * \return number of values written
+     */
+    size_t publish(Open62541::Server& s);
+
+    void setDeadband(double d) { _deadband = d; }
+    size_t size() const { return _nodes.size(); }
+    size_t failed() const { return _failed; }  // writes refused by the server
+};
+
+#endif  // SIMULATIONENGINE_H
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef ALARMFILTER_H
+#define ALARMFILTER_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/servertimedcallback.h>
+#include <mutex>
+//
+// Use ccmake to enable - enable advanced mode
+//
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+namespace Open62541 {
+
+class Server;
+class Condition;
+
+/*!
+    \brief The AlarmFloodFilter class
+    Rate limits the events of a server's conditions - see Server::setAlarmFilter. Every condition event goes
+    through admit() first, which applies in order:
+    - shelving: a shelved condition or source emits nothing until unshelved or the shelving times out
+    - deadband: a condition emits at most one event per deadband. A blocked event is held and, if trailing is
+      set, the latest state is emitted when the deadband ends so clients are not left with a stale state
+    - flood limit: a source emits at most floodCount events per floodWindow. Events over the limit are dropped
+      and, when the window closes, reported in one summary event on the source - see floodSummary()
+    Limits are looked up for the condition, then its source, then the defaults. A single ServerTimedCallback is
+    armed for the earliest pending deadline, so the filter costs nothing while no condition chatters.
+    Do not call into the filter with the server mutex held - arming the timer takes it. Destroy the filter
+    before its server
+*/
+class UA_EXPORT AlarmFloodFilter
+{
+public:
+    /*!
+        \brief The Limits struct
+        Times are in milliseconds - zero disables the limit
+    */
+    struct Limits {
+        unsigned deadband    = 0;     //!< minimum time between events of one condition
+        bool trailing        = true;  //!< emit the last held event when the deadband ends
+        unsigned floodCount  = 0;     //!< events allowed per source per window
+        unsigned floodWindow = 1000;  //!< flood window
+    };
+
+    /*!
+        \brief The Decision enum
+    */
+    enum Decision {
+        Emit = 0,    //!< trigger the event now
+        Held,        //!< within the deadband - may be emitted later
+        Suppressed,  //!< over the flood limit - counted in the summary
+        Shelved      //!< the condition or its source is shelved
+    };
+
+    /*!
+        \brief The Statistics struct
+    */
+    struct Statistics {
+        size_t emitted    = 0;
+        size_t held       = 0;
+        size_t released   = 0;  // held events emitted when their deadband ended
+        size_t suppressed = 0;
+        size_t shelved    = 0;
+        size_t summaries  = 0;
+    };
+
+private:
+    struct ConditionState {
+        UA_DateTime lastEmit = 0;
+        UA_DateTime due      = 0;  // held event to release - zero if none
+        size_t window        = 0;  // flood window the condition was last suppressed in
+    };
+    struct SourceState {
+        UA_DateTime windowStart = 0;
+        size_t window           = 0;  // window sequence number
+        size_t count            = 0;  // events in the window
+        size_t suppressed       = 0;
+        size_t conditions       = 0;  // distinct conditions suppressed in the window
+    };
+    struct Summary {
+        NodeId source;
+        size_t suppressed = 0;
+        size_t conditions = 0;
+    };
+    //
+    Server& _server;
+    mutable std::mutex _mutex;
+    std::mutex _armMutex;  // orders timer updates - taken before _mutex, never while it is held
+    Limits _defaults;
+    UnorderedNodeIdMap<Limits> _conditionLimits;
+    UnorderedNodeIdMap<Limits> _sourceLimits;
+    UnorderedNodeIdMap<UA_DateTime> _shelved;  // condition or source to expiry - zero never expires
+    UnorderedNodeIdMap<ConditionState> _conditions;
+    UnorderedNodeIdMap<SourceState> _sources;
+    NodeIdSet _pending;  // conditions with a held event
+    Statistics _statistics;
+    ServerTimedCallback _timer;
+    UA_DateTime _armed         = 0;      // deadline the timer is set for - zero if idle
+    bool _rearm                = false;  // _armed changed and the timer is yet to follow
+    UA_UInt16 _summarySeverity = 500;
+
+    // call with _mutex held
+    const Limits& conditionLimits(const UA_NodeId& condition, const UA_NodeId& source) const;
+    const Limits& sourceLimits(const UA_NodeId& source) const;
+    bool isShelved(const UA_NodeId& n, UA_DateTime now);
+    Decision decide(const UA_NodeId& condition,
+                    const UA_NodeId& source,
+                    UA_DateTime now,
+                    bool release,
+                    std::vector<Summary>& summaries);
+    void closeWindow(const UA_NodeId& source, SourceState& s, std::vector<Summary>& summaries);
+    UA_DateTime nextDeadline() const;
+    void arm(UA_DateTime due);
+    //
+    void applyArm();  // call without _mutex - moves the timer to the armed deadline
+    void tick();  // timer handler
+    void fire(const std::vector<NodeId>& release, std::vector<Summary>& summaries);
+
+public:
+    /*!
+        \brief AlarmFloodFilter
+        \param s the server whose conditions are filtered
+    */
+    AlarmFloodFilter(Server& s);
+    AlarmFloodFilter(const AlarmFloodFilter&) = delete;
+    AlarmFloodFilter& operator=(const AlarmFloodFilter&) = delete;
+    virtual ~AlarmFloodFilter();
+
+    /*!
+        \brief setDefaultLimits
+        \param l limits of conditions and sources without their own
+    */
+    void setDefaultLimits(const Limits& l);
+    const Limits& defaultLimits() const { return _defaults; }
+    /*!
+        \brief setSourceLimits
+        \param source
+        \param l
+    */
+    void setSourceLimits(const UA_NodeId& source, const Limits& l);
+    /*!
+        \brief setConditionLimits
+        The deadband of a condition - flood limits are always those of the source
+        \param condition
+        \param l
+    */
+    void setConditionLimits(const UA_NodeId& condition, const Limits& l);
+    /*!
+        \brief clearLimits
+        \param n condition or source - falls back to the source or default limits
+    */
+    void clearLimits(const UA_NodeId& n);
+
+    /*!
+        \brief shelve
+        \param n condition or source
+        \param ms shelving time - zero until unshelve() is called
+    */
+    void shelve(const UA_NodeId& n, unsigned ms = 0);
+    void unshelve(const UA_NodeId& n);
+    /*!
+        \brief shelved
+        \param n condition or source
+        \return true if n itself is shelved
+    */
+    bool shelved(const UA_NodeId& n);
+
+    /*!
+        \brief admit
+        Decide whether a condition may emit an event now - records the event as emitted if so
+        \param c
+        \return the decision
+    */
+    Decision admit(Condition& c);
+    /*!
+        \brief forget
+        Drop the state of a deleted condition
+        \param condition
+    */
+    void forget(const UA_NodeId& condition);
+    /*!
+        \brief flush
+        Release every held event and close every flood window now
+    */
+    void flush();
+    /*!
+        \brief reset
+        Drop all state and statistics - limits and shelving are kept
+    */
+    void reset();
+
+    /*!
+        \brief statistics
+        \return counters since construction or reset()
+    */
+    Statistics statistics() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _statistics;
+    }
+    UA_UInt16 summarySeverity() const { return _summarySeverity; }
+    void setSummarySeverity(UA_UInt16 s) { _summarySeverity = s; }
+
+    /*!
+        \brief floodSummary
+        Report the events dropped from a source in a closed flood window. The default triggers a BaseEventType
+        event on the source with a message giving the counts
+        \param source
+        \param suppressed number of events dropped
+        \param conditions number of conditions whose events were dropped
+    */
+    virtual void floodSummary(const NodeId& source, size_t suppressed, size_t conditions);
+};
+
+}  // namespace Open62541
+#endif
+#endif  // ALARMFILTER_H
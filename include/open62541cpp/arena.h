@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+#include <open62541cpp/open62541objects.h>
+#include <cstddef>
+
+namespace Open62541 {
+
+/*!
+    \brief The Arena class
+    Bump allocator for short lived UA structures on request paths. Memory is handed out from
+    large blocks and released in one go by rewinding. Structures made with make() / makeArray()
+    have their members cleared (UA_clear) when the arena is rewound past them.
+    An Arena is not thread safe - use one per thread (threadArena())
+*/
+class UA_EXPORT Arena
+{
+public:
+    /*!
+        \brief The Mark struct
+        Position in the arena to rewind to
+    */
+    struct Mark {
+        size_t block   = 0;
+        size_t used    = 0;
+        size_t cleanup = 0;
+    };
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    struct Cleanup {
+        void* p;
+        const UA_DataType* type;
+        size_t count;
+    };
+
+    std::vector<Block> _blocks;
+    std::vector<Cleanup> _cleanup;
+    size_t _current   = 0;
+    size_t _blockSize = 0;
+
+public:
+    /*!
+        \brief Arena
+        \param blockSize size of each allocation block
+    */
+    explicit Arena(size_t blockSize = 64 * 1024)
+        : _blockSize(blockSize)
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /*!
+        \brief ~Arena
+    */
+    ~Arena() { reset(); }
+
+    /*!
+        \brief allocate
+        \param n number of bytes
+        \param align alignment - must be a power of two
+        \return pointer to uninitialised memory, valid until the arena is rewound
+    */
+    void* allocate(size_t n, size_t align = alignof(std::max_align_t));
+
+    /*!
+        \brief make
+        Allocate and initialise a UA structure in the arena
+        \return pointer to the structure
+    */
+    template <typename T>
+    T* make()
+    {
+        return makeArray<T>(1);
+    }
+
+    /*!
+        \brief makeArray
+        Allocate and initialise an array of UA structures in the arena
+        \param n number of elements
+        \return pointer to the first element
+    */
+    template <typename T>
+    T* makeArray(size_t n)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "Arena::make needs a type with a UA_TYPES mapping");
+        T* p = static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+        memset(p, 0, sizeof(T) * n);  // UA_init
+        _cleanup.push_back({p, ua_type_traits<T>::type(), n});
+        return p;
+    }
+
+    /*!
+        \brief mark
+        \return the current position
+    */
+    Mark mark() const
+    {
+        Mark m;
+        m.block   = _current;
+        m.used    = _blocks.empty() ? 0 : _blocks[_current].used;
+        m.cleanup = _cleanup.size();
+        return m;
+    }
+
+    /*!
+        \brief rewind
+        Clears structures created after the mark and releases their memory for reuse
+        \param m position to go back to
+    */
+    void rewind(const Mark& m);
+
+    /*!
+        \brief reset
+        Rewind to the start - blocks are kept for reuse
+    */
+    void reset() { rewind(Mark()); }
+
+    /*!
+        \brief used
+        \return bytes in use
+    */
+    size_t used() const;
+
+    /*!
+        \brief capacity
+        \return bytes reserved
+    */
+    size_t capacity() const;
+
+    /*!
+        \brief release
+        Reset and free all blocks
+    */
+    void release()
+    {
+        reset();
+        _blocks.clear();
+        _current = 0;
+    }
+
+    /*!
+        \brief threadArena
+        \return the arena for the calling thread
+    */
+    static Arena& threadArena();
+
+    /*!
+        \brief current
+        \return the arena of the innermost ScopedArena on this thread or nullptr if there is none
+    */
+    static Arena* current();
+
+private:
+    friend class ScopedArena;
+    static void setCurrent(Arena* a);
+};
+
+/*!
+    \brief The ScopedArena class
+    Makes an arena current for the calling thread. On exit everything allocated in the scope is released
+    Scopes nest - an inner scope only releases what it allocated.
+*/
+class UA_EXPORT ScopedArena
+{
+    Arena& _arena;
+    Arena::Mark _mark;
+    Arena* _previous = nullptr;
+
+public:
+    /*!
+        \brief ScopedArena
+        \param a arena to use - defaults to the thread arena
+    */
+    explicit ScopedArena(Arena& a = Arena::threadArena())
+        : _arena(a)
+        , _mark(a.mark())
+        , _previous(Arena::current())
+    {
+        Arena::setCurrent(&_arena);
+    }
+
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+
+    /*!
+        \brief ~ScopedArena
+    */
+    ~ScopedArena()
+    {
+        _arena.rewind(_mark);
+        Arena::setCurrent(_previous);
+    }
+
+    /*!
+        \brief arena
+        \return the arena in use
+    */
+    Arena& arena() { return _arena; }
+};
+
+}  // namespace Open62541
+#endif  // ARENA_H
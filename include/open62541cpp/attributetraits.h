@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef ATTRIBUTETRAITS_H
+#define ATTRIBUTETRAITS_H
+#include <open62541cpp/open62541objects.h>
+
+namespace Open62541 {
+//
+// Map a node attribute to the C++ type holding it at compile time - see Server::read<A> and Server::write<A>
+// value_type - plain C type for fixed size attributes, the wrapper for the others
+// target - where the stack decodes a read to, cleared first
+// source - the C value written
+// The Value and ArrayDimensions attributes are variants and have no traits - use readValue / writeValue
+//
+template <UA_AttributeId A>
+struct attribute_traits;
+
+#define UA_ATTRIBUTE_TRAITS_FIXED(A, T, I)                            \
+    template <>                                                       \
+    struct attribute_traits<A> {                                      \
+        typedef T value_type;                                         \
+        static const UA_DataType* type() { return &UA_TYPES[I]; }     \
+        static void* target(value_type& v) { return &v; }             \
+        static const void* source(const value_type& v) { return &v; } \
+    };
+
+#define UA_ATTRIBUTE_TRAITS_WRAPPED(A, W, I)                                    \
+    template <>                                                                 \
+    struct attribute_traits<A> {                                                \
+        typedef W value_type;                                                   \
+        static const UA_DataType* type() { return &UA_TYPES[I]; }               \
+        static void* target(value_type& v) { return v.clearRef(); }             \
+        static const void* source(const value_type& v) { return v.constRef(); } \
+    };
+
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_NODEID, NodeId, UA_TYPES_NODEID)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_NODECLASS, UA_NodeClass, UA_TYPES_NODECLASS)
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_BROWSENAME, QualifiedName, UA_TYPES_QUALIFIEDNAME)
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_DISPLAYNAME, LocalizedText, UA_TYPES_LOCALIZEDTEXT)
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_DESCRIPTION, LocalizedText, UA_TYPES_LOCALIZEDTEXT)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_WRITEMASK, UA_UInt32, UA_TYPES_UINT32)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_USERWRITEMASK, UA_UInt32, UA_TYPES_UINT32)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_ISABSTRACT, UA_Boolean, UA_TYPES_BOOLEAN)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_SYMMETRIC, UA_Boolean, UA_TYPES_BOOLEAN)
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_INVERSENAME, LocalizedText, UA_TYPES_LOCALIZEDTEXT)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_CONTAINSNOLOOPS, UA_Boolean, UA_TYPES_BOOLEAN)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_EVENTNOTIFIER, UA_Byte, UA_TYPES_BYTE)
+UA_ATTRIBUTE_TRAITS_WRAPPED(UA_ATTRIBUTEID_DATATYPE, NodeId, UA_TYPES_NODEID)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_VALUERANK, UA_Int32, UA_TYPES_INT32)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_ACCESSLEVEL, UA_Byte, UA_TYPES_BYTE)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_USERACCESSLEVEL, UA_Byte, UA_TYPES_BYTE)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_MINIMUMSAMPLINGINTERVAL, UA_Double, UA_TYPES_DOUBLE)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_HISTORIZING, UA_Boolean, UA_TYPES_BOOLEAN)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_EXECUTABLE, UA_Boolean, UA_TYPES_BOOLEAN)
+UA_ATTRIBUTE_TRAITS_FIXED(UA_ATTRIBUTEID_USEREXECUTABLE, UA_Boolean, UA_TYPES_BOOLEAN)
+
+#undef UA_ATTRIBUTE_TRAITS_FIXED
+#undef UA_ATTRIBUTE_TRAITS_WRAPPED
+
+}  // namespace Open62541
+
+#endif  // ATTRIBUTETRAITS_H
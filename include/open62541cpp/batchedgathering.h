@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef BATCHEDGATHERING_H
+#define BATCHEDGATHERING_H
+#include <open62541cpp/historydatabase.h>
+#include <open62541cpp/spscqueue.h>
+#include <open62541cpp/threadconfig.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Open62541 {
+
+/*!
+    \brief The BatchedHistoryGathering class
+    History gathering that takes value writes off the server loop. Node registration, polling and settings
+    are delegated to the stack's default gathering; setValue only copies the sample into a preallocated
+    lock free ring. Samples are written to each node's backend in batches, grouped by node, either by
+    calling flush() from the server loop (Server::process) or from a background thread started with start().
+    A background flush calls the backend from that thread, so the backend must be thread safe - the
+    compressed and mapped backends are, the C memory backend is not.
+    Backends are called without a session context
+*/
+class UA_EXPORT BatchedHistoryGathering : public HistoryDataGathering
+{
+public:
+    /*!
+        \brief The OverflowPolicy enum
+        DropNewest discards the incoming sample and counts it. Block makes the writer wait for space
+    */
+    enum class OverflowPolicy { DropNewest, Block };
+
+    /*!
+        \brief The Sample struct
+        A queued value write
+    */
+    struct Sample {
+        UA_Server* server = nullptr;
+        UA_HistoryDataBackend backend;  // shallow - callbacks and context
+        UA_NodeId nodeId;
+        UA_NodeId sessionId;
+        UA_Boolean historizing = UA_FALSE;
+        UA_DataValue value;
+        Sample()
+        {
+            memset(&backend, 0, sizeof(backend));
+            UA_NodeId_init(&nodeId);
+            UA_NodeId_init(&sessionId);
+            UA_DataValue_init(&value);
+        }
+        void clear()
+        {
+            UA_NodeId_clear(&nodeId);
+            UA_NodeId_clear(&sessionId);
+            UA_DataValue_clear(&value);
+        }
+    };
+
+private:
+    UA_HistoryDataGathering _default;  // registration and settings
+    SpscQueue<Sample> _queue;
+    std::mutex _producerMutex;  // setValue may be called from any thread holding the server
+    std::mutex _consumerMutex;  // flush() and the background thread
+    OverflowPolicy _policy = OverflowPolicy::DropNewest;
+    size_t _batchSize      = 1024;
+    unsigned _interval     = 100;  // ms between background flushes
+    std::vector<Sample> _batch;
+    std::thread _thread;
+    ThreadConfig _threadConfig;
+    std::atomic<bool> _running{false};
+    std::mutex _waitMutex;
+    std::condition_variable _wake;
+    // metrics
+    std::atomic<uint64_t> _queued{0};
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _written{0};
+    std::atomic<uint64_t> _batches{0};
+    std::atomic<size_t> _highWater{0};
+
+    void run();
+    size_t writeBatch(size_t maxSamples);
+    void discard();
+
+public:
+    /*!
+        \brief BatchedHistoryGathering
+        \param initialNodeIdStoreSize initial size of the default gathering's node table
+        \param capacity ring slots - rounded up to a power of two
+        \param policy what to do when the ring is full
+    */
+    BatchedHistoryGathering(size_t initialNodeIdStoreSize = 100,
+                            size_t capacity               = 65536,
+                            OverflowPolicy policy         = OverflowPolicy::DropNewest);
+    /*!
+        \brief ~BatchedHistoryGathering
+        Stops the background thread - samples still queued are discarded
+    */
+    virtual ~BatchedHistoryGathering();
+
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the flush thread - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
+    /*!
+        \brief start
+        Flush from a background thread
+        \param intervalMs time between flushes when the ring is below a batch
+        \return true if started
+    */
+    bool start(unsigned intervalMs = 100);
+    /*!
+        \brief stop
+        \param flushRemaining write what is still queued on the calling thread
+    */
+    void stop(bool flushRemaining = true);
+    /*!
+        \brief flush
+        Write queued samples to their backends - call from Server::process to flush on the server loop
+        \param maxSamples upper bound on samples written by this call, 0 for no limit
+        \return samples written
+    */
+    size_t flush(size_t maxSamples = 0);
+
+    /*!
+        \brief setBatchSize
+        \param n samples written per batch
+    */
+    void setBatchSize(size_t n) { _batchSize = n ? n : 1; }
+    size_t batchSize() const { return _batchSize; }
+
+    // metrics
+    uint64_t queued() const { return _queued; }
+    uint64_t dropped() const { return _dropped; }
+    uint64_t written() const { return _written; }
+    uint64_t batches() const { return _batches; }
+    size_t pending() const { return _queue.size(); }
+    size_t highWater() const { return _highWater; }
+    size_t capacity() const { return _queue.capacity(); }
+    /*!
+        \brief resetMetrics
+    */
+    void resetMetrics()
+    {
+        _queued    = 0;
+        _dropped   = 0;
+        _written   = 0;
+        _batches   = 0;
+        _highWater = 0;
+    }
+
+    // HistoryDataGathering
+    virtual void deleteMembers();
+    virtual UA_StatusCode registerNodeId(Context& c, const UA_HistorizingNodeIdSettings setting);
+    virtual UA_StatusCode stopPoll(Context& c);
+    virtual UA_StatusCode startPoll(Context& c);
+    virtual UA_Boolean updateNodeIdSetting(Context& c, const UA_HistorizingNodeIdSettings setting);
+    virtual const UA_HistorizingNodeIdSettings* getHistorizingSetting(Context& c);
+    virtual void setValue(Context& c, UA_Boolean historizing, const UA_DataValue* value);
+};
+
+}  // namespace Open62541
+
+#endif  // BATCHEDGATHERING_H
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef BROWSECACHE_H
+#define BROWSECACHE_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace Open62541 {
+
+class Client;
+
+/*!
+    \brief The BrowseCache class
+    Caches the references of a browse - every page, continuation points followed - keyed by the node, reference
+    type, subtypes flag, direction, node class mask and result mask of the browse description. Attached to a
+    Client with Client::setBrowseCache, it serves Client::browseVisit (and so browseTree, browseChildren and
+    ClientNodeTree) and ClientBrowser, so navigating the static parts of an address space takes no round trips.
+    Entries are invalidated by the model change events of the server - see watch() - and expire after a time to
+    live for servers that do not send them. A cached result is immutable and shared, so readers keep it valid
+    while an invalidation replaces it
+*/
+class UA_EXPORT BrowseCache
+{
+public:
+    /*!
+        \brief The Result struct
+        The references of one browse
+    */
+    struct Result {
+        NodeId node;                                      // browsed - owns the key
+        NodeId referenceType;                             // owns the key
+        std::vector<UA_ReferenceDescription> references;  // owned
+        UA_DateTime expires = 0;                          // monotonic
+        ~Result()
+        {
+            for (auto& r : references)
+                UA_ReferenceDescription_clear(&r);
+        }
+    };
+    typedef std::shared_ptr<const Result> ResultRef;
+
+private:
+    /*!
+        \brief The Key struct
+        Shallow - the node ids point into the result or the description looked up
+    */
+    struct Key {
+        UA_NodeId node;
+        UA_NodeId referenceType;
+        UA_UInt32 nodeClassMask;
+        UA_UInt32 resultMask;
+        UA_BrowseDirection direction;
+        bool includeSubtypes;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const
+        {
+            return size_t(UA_NodeId_hash(&k.node)) ^ (size_t(UA_NodeId_hash(&k.referenceType)) << 1) ^
+                   (size_t(k.nodeClassMask) << 8) ^ (size_t(k.resultMask) << 16) ^ (size_t(k.direction) << 4) ^
+                   size_t(k.includeSubtypes);
+        }
+    };
+    struct KeyEqual {
+        bool operator()(const Key& a, const Key& b) const
+        {
+            return (a.nodeClassMask == b.nodeClassMask) && (a.resultMask == b.resultMask) &&
+                   (a.direction == b.direction) && (a.includeSubtypes == b.includeSubtypes) &&
+                   UA_NodeId_equal(&a.node, &b.node) && UA_NodeId_equal(&a.referenceType, &b.referenceType);
+        }
+    };
+    typedef std::shared_ptr<Result> EntryRef;
+    //
+    std::unordered_map<Key, EntryRef, KeyHash, KeyEqual> _entries;
+    mutable std::mutex _mutex;
+    UA_DateTime _ttl   = 300 * UA_DATETIME_SEC;
+    size_t _maxEntries = 100000;
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+    std::atomic<size_t> _invalidations{0};  // model change events acted on
+    //
+    Client* _client           = nullptr;  // watched - not owned
+    UA_UInt32 _subscriptionId = 0;
+
+    static Key keyOf(const UA_BrowseDescription& d);
+    void purge(UA_DateTime now);
+
+public:
+    BrowseCache() = default;
+    BrowseCache(const BrowseCache&) = delete;
+    BrowseCache& operator=(const BrowseCache&) = delete;
+    ~BrowseCache() { unwatch(); }
+
+    /*!
+        \brief setTtl
+        \param ms time to live of an entry - the fallback for servers that send no model change events
+    */
+    void setTtl(unsigned ms) { _ttl = UA_DateTime(ms) * UA_DATETIME_MSEC; }
+    unsigned ttl() const { return unsigned(_ttl / UA_DATETIME_MSEC); }
+    /*!
+        \brief setMaxEntries
+        \param n when full, expired entries are dropped then, if still full, the rest
+    */
+    void setMaxEntries(size_t n) { _maxEntries = (n > 0) ? n : 1; }
+    size_t maxEntries() const { return _maxEntries; }
+
+    /*!
+        \brief find
+        \param d browse description
+        \return the cached references or null if there are none or they have expired
+    */
+    ResultRef find(const UA_BrowseDescription& d);
+    /*!
+        \brief put
+        Cache the complete result of a browse
+        \param d browse description
+        \param references taken - left empty
+        \return the entry
+    */
+    ResultRef put(const UA_BrowseDescription& d, std::vector<UA_ReferenceDescription>& references);
+
+    /*!
+        \brief invalidate
+        Drop the entries browsing a node and those holding a reference to it
+        \param n node
+        \param inverse also drop every inverse and two way browse - a reference to or from n has changed and
+        its other end is not known
+    */
+    void invalidate(const NodeId& n, bool inverse = false);
+    /*!
+        \brief invalidateAll
+    */
+    void invalidateAll();
+    /*!
+        \brief modelChanged
+        Act on the fields of a model change event selected as watch() selects them - the affected nodes of a
+        GeneralModelChangeEvent are invalidated, an added reference or anything else of the BaseModelChangeEvent
+        type drops every entry, other events are ignored
+        \param fields EventType then Changes
+    */
+    void modelChanged(const VariantArray& fields);
+
+    /*!
+        \brief watch
+        Subscribe to the model change events of a client's server - an event monitored item on the Server
+        object in a subscription of its own. The subscription ends with the session: after reconnecting call
+        watch again unless the client recovers subscriptions. The cache must outlive the subscription or
+        unwatch be called
+        \param c connected client
+        \param publishingIntervalMs of the subscription
+        \return true if subscribed
+    */
+    bool watch(Client& c, double publishingIntervalMs = 1000.0);
+    /*!
+        \brief unwatch
+        Remove the subscription made by watch
+    */
+    void unwatch();
+    bool watching() const { return _subscriptionId != 0; }
+
+    size_t size() const;
+    size_t memoryUsage() const;  //!< bytes held - estimate
+    size_t hits() const { return _hits; }
+    size_t misses() const { return _misses; }
+    size_t invalidations() const { return _invalidations; }
+};
+
+}  // namespace Open62541
+
+#endif  // BROWSECACHE_H
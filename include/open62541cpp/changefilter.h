@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef CHANGEFILTER_H
+#define CHANGEFILTER_H
+#include <open62541cpp/open62541objects.h>
+#include <cmath>
+
+namespace Open62541 {
+
+/*!
+    \brief The ChangeFilter class
+    Client side data change filter for servers that ignore DataChangeFilter deadbands. Checked as each value
+    is decoded, before batching, queues and the item's handler, so a filtered value costs a few compares.
+    A value passes if its status changed, or - unless the trigger is Status - if it is outside the deadband
+    of the last value that passed and at least the minimum interval after it. Non numeric and array values
+    are not deadbanded. The latest value held back by the interval throttle is released by the first client
+    iteration after the interval has passed - unless a later value is back within the deadband. Used on the
+    client's iterate thread only
+*/
+class UA_EXPORT ChangeFilter
+{
+public:
+    enum class Trigger { Status, StatusValue };        // as DataChangeTrigger (Part 4 7.17.2)
+    enum class Deadband { None, Absolute, Percent };  // as DeadbandType - percent of the range set
+
+private:
+    Trigger _trigger         = Trigger::StatusValue;
+    Deadband _deadband       = Deadband::None;
+    double _band             = 0.0;  // absolute - percent is converted when set
+    UA_DateTime _minInterval = 0;
+    //
+    bool _hasLast             = false;
+    double _lastValue         = 0.0;
+    bool _lastNumeric         = false;
+    UA_StatusCode _lastStatus = UA_STATUSCODE_GOOD;
+    UA_DateTime _lastTime     = 0;  // monotonic
+    size_t _passed            = 0;
+    size_t _filtered          = 0;
+    //
+    UA_DataValue _held;  // latest value throttled by the interval - owned
+    bool _holding = false;
+
+    /*!
+        \brief numeric
+        \param v
+        \param x set to the value of a numeric scalar
+        \return true if v is a numeric scalar
+    */
+    static bool numeric(const UA_Variant& v, double& x)
+    {
+        if (!UA_Variant_isScalar(&v) || !v.type)
+            return false;
+        switch (v.type->typeKind) {
+            case UA_DATATYPEKIND_SBYTE:
+                x = *static_cast<const UA_SByte*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_BYTE:
+                x = *static_cast<const UA_Byte*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_INT16:
+                x = *static_cast<const UA_Int16*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_UINT16:
+                x = *static_cast<const UA_UInt16*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_INT32:
+                x = *static_cast<const UA_Int32*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_UINT32:
+                x = *static_cast<const UA_UInt32*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_INT64:
+                x = double(*static_cast<const UA_Int64*>(v.data));
+                return true;
+            case UA_DATATYPEKIND_UINT64:
+                x = double(*static_cast<const UA_UInt64*>(v.data));
+                return true;
+            case UA_DATATYPEKIND_FLOAT:
+                x = *static_cast<const UA_Float*>(v.data);
+                return true;
+            case UA_DATATYPEKIND_DOUBLE:
+                x = *static_cast<const UA_Double*>(v.data);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /*!
+        \brief changed
+        \return true if a value with the same status as the last is to pass the deadband
+    */
+    bool changed(bool isNumeric, double x) const
+    {
+        if (isNumeric && _lastNumeric && (_deadband != Deadband::None))
+            return std::fabs(x - _lastValue) > _band;
+        return !isNumeric || !_lastNumeric || (x != _lastValue);
+    }
+
+    /*!
+        \brief accept
+        Records a value passed on
+    */
+    void accept(UA_StatusCode status, bool isNumeric, double x)
+    {
+        _hasLast     = true;
+        _lastValue   = x;
+        _lastNumeric = isNumeric;
+        _lastStatus  = status;
+        if (_minInterval)
+            _lastTime = UA_DateTime_nowMonotonic();
+        _passed++;
+    }
+
+    /*!
+        \brief dropHeld
+        Discards the held value - superseded
+    */
+    void dropHeld()
+    {
+        if (_holding) {
+            UA_DataValue_clear(&_held);
+            _holding = false;
+            _filtered++;
+        }
+    }
+
+public:
+    ChangeFilter() { UA_DataValue_init(&_held); }
+    ~ChangeFilter() { UA_DataValue_clear(&_held); }
+    ChangeFilter(const ChangeFilter&) = delete;
+    ChangeFilter& operator=(const ChangeFilter&) = delete;
+
+    /*!
+        \brief setTrigger
+        \param t Status passes status changes only
+        \return this filter
+    */
+    ChangeFilter& setTrigger(Trigger t)
+    {
+        _trigger = t;
+        return *this;
+    }
+
+    /*!
+        \brief setDeadband
+        \param d deadband type
+        \param value absolute deadband or percent of the range
+        \param low bottom of the range (EURange) for a percent deadband
+        \param high top of the range
+        \return this filter
+    */
+    ChangeFilter& setDeadband(Deadband d, double value, double low = 0.0, double high = 100.0)
+    {
+        _deadband = d;
+        _band     = (d == Deadband::Percent) ? value * std::fabs(high - low) / 100.0 : value;
+        return *this;
+    }
+
+    /*!
+        \brief setMinInterval
+        \param ms least time between values passed - status changes excepted
+        \return this filter
+    */
+    ChangeFilter& setMinInterval(double ms)
+    {
+        _minInterval = UA_DateTime(ms * UA_DATETIME_MSEC);
+        return *this;
+    }
+
+    /*!
+        \brief reset
+        Forget the last value - the next one passes
+    */
+    void reset() { _hasLast = false; }
+
+    /*!
+        \brief pass
+        \param v received value - taken, leaving v empty, if it is held back by the interval throttle
+        \return true if the value is to be dispatched now
+    */
+    bool pass(UA_DataValue& v)
+    {
+        const UA_StatusCode status = v.hasStatus ? v.status : UA_STATUSCODE_GOOD;
+        double x                   = 0.0;
+        const bool isNumeric       = v.hasValue && numeric(v.value, x);
+        if (!_hasLast || (status != _lastStatus)) {
+            dropHeld();
+            accept(status, isNumeric, x);
+            return true;
+        }
+        if ((_trigger == Trigger::Status) || !changed(isNumeric, x)) {
+            dropHeld();  // the latest value is no change - the held one is stale
+            _filtered++;
+            return false;
+        }
+        if (_minInterval && ((UA_DateTime_nowMonotonic() - _lastTime) < _minInterval)) {
+            dropHeld();
+            _held = v;  // steal - the stack clears the reinitialised source
+            UA_DataValue_init(&v);
+            _holding = true;
+            return false;
+        }
+        dropHeld();
+        accept(status, isNumeric, x);
+        return true;
+    }
+
+    /*!
+        \brief holding
+        \return true if a throttled value is held
+    */
+    bool holding() const { return _holding; }
+
+    /*!
+        \brief release
+        \param now monotonic time
+        \param out set to the held value, once its interval has passed - owned by the caller
+        \param force release whatever the time
+        \return true if out is set
+    */
+    bool release(UA_DateTime now, UA_DataValue& out, bool force = false)
+    {
+        if (!_holding || (!force && ((now - _lastTime) < _minInterval)))
+            return false;
+        out = _held;
+        UA_DataValue_init(&_held);
+        _holding                   = false;
+        const UA_StatusCode status = out.hasStatus ? out.status : UA_STATUSCODE_GOOD;
+        double x                   = 0.0;
+        const bool isNumeric       = out.hasValue && numeric(out.value, x);
+        accept(status, isNumeric, x);
+        return true;
+    }
+
+    size_t passed() const { return _passed; }      //!< values dispatched
+    size_t filtered() const { return _filtered; }  //!< values dropped
+};
+
+}  // namespace Open62541
+
+#endif  // CHANGEFILTER_H
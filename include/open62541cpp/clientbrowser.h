@@ -12,6 +12,9 @@
 #ifndef CLIENTBROWSER_H
 #define CLIENTBROWSER_H
 #include <open62541cpp/open62541client.h>
+#include <deque>
+#include <set>
+#include <unordered_set>
 namespace Open62541 {
 
 /*!
@@ -21,7 +24,32 @@ namespace Open62541 {
 
 class ClientBrowser : public Browser<Client>
 {
-    //
+    // pipelined browsing state
+    struct Request {
+        ClientBrowser* browser = nullptr;
+        size_t depth           = 0;      // depth of the node browsed
+        bool next              = false;  // BrowseNext rather than Browse
+        NodeId node;                     // browsed - for the browse cache
+    };
+    size_t _pipelineDepth = 8;  // requests kept in flight
+    size_t _maxDepth      = 1;
+    size_t _inFlight      = 0;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+    std::vector<NodeId> _starts;                                      // owns the start ids _visited points at
+    std::deque<std::pair<NodeId, size_t>> _frontier;                  // nodes waiting to be browsed
+    std::deque<std::pair<UA_ByteString, size_t>> _continue;           // continuation points waiting for BrowseNext
+    std::unordered_set<UA_NodeId, NodeIdHash, NodeIdEqual> _visited;  // shallow - of the results and starts
+    std::set<Request*> _outstanding;  // detached on destruction so late callbacks are ignored
+    std::vector<BrowseCache::ResultRef> _cached;  // browse cache hits - keeps the references found in them
+
+    static void browseCallback(UA_Client* client, void* userdata, UA_UInt32 requestId, void* response);
+    void handleResult(UA_BrowseResult& r, size_t depth);
+    void handleReferences(const UA_ReferenceDescription* references, size_t n, size_t depth);
+    static void describe(UA_BrowseDescription& d, const NodeId& node);
+    bool send(bool next);
+    void releaseResults();
+    void detachOutstanding();
+
 public:
     /*!
         \brief ClientBrowser
@@ -31,16 +59,39 @@ public:
         : Browser(c)
     {
     }
+    ~ClientBrowser();
+
+    /*!
+        \brief setPipelineDepth
+        \param n number of Browse / BrowseNext requests kept in flight - at least 1
+    */
+    void setPipelineDepth(size_t n) { _pipelineDepth = (n > 0) ? n : 1; }
+    size_t pipelineDepth() const { return _pipelineDepth; }
+    UA_StatusCode lastError() const { return _lastError; }
+
     /*!
         \brief browse
         \param start node ID
     */
     void browse(UA_NodeId start)
     {
-        list().clear();
-        if (obj().client())
-            UA_Client_forEachChildNodeCall(obj().client(), start, browseIter, (void*)this);
+        std::vector<NodeId> s;
+        s.emplace_back(start);
+        browse(s, 1);
     }
+
+    /*!
+        \brief browse
+        Pipelined browse - up to pipelineDepth() asynchronous Browse and BrowseNext requests are kept in flight.
+        Browse names come back with the references so there are no per child reads. Every reference found
+        is appended to list() in arrival order - or to views() in view mode, with nothing copied. Both refer to
+        storage owned by the browser, valid until the next browse or its destruction. With a browse cache set
+        on the client, nodes found in it are not sent and complete single page results are added to it
+        \param starts nodes to browse
+        \param maxDepth levels to descend - 1 for the children of the start nodes only, 0 for unlimited
+        \return true on success
+    */
+    bool browse(const std::vector<NodeId>& starts, size_t maxDepth);
 };
 
 }  // namespace Open62541
@@ -12,6 +12,8 @@
 #ifndef CLIENTCACHE_H
 #define CLIENTCACHE_H
 #include <open62541cpp/open62541client.h>
+#include <atomic>
+#include <mutex>
 namespace Open62541 {
 
 /*!
@@ -28,7 +30,10 @@ class ClientCache
     // Cache / Dictionary of Client objects
     // these are shared pointers so can be safely copied
     //
+    DiscoveryCacheRef _discovery = std::make_shared<DiscoveryCache>();  // shared by the clients - each holds it
     std::map<std::string, ClientRef> _cache;
+    mutable std::mutex _mutex;               // add / remove may race the cache threads
+    std::atomic<unsigned> _generation{0};  // bumped on every add / remove
 
 public:
     /*!
@@ -46,10 +51,13 @@ public:
     */
     ClientRef& add(const std::string& endpoint)
     {
+        std::lock_guard<std::mutex> l(_mutex);
         if (_cache.find(endpoint) != _cache.end()) {
             return _cache[endpoint];
         }
         _cache[endpoint] = ClientRef(new Client());
+        _cache[endpoint]->setDiscoveryCache(_discovery);
+        _generation++;
         return _cache[endpoint];
     }
     /*!
@@ -58,11 +66,19 @@ public:
     */
     void remove(const std::string& s)
     {
-        auto a = find(s);
+        ClientRef a;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            auto i = _cache.find(s);
+            if (i == _cache.end())
+                return;
+            a = i->second;  // keep alive until disconnected - a cache thread may still hold it
+            _cache.erase(i);
+            _generation++;
+        }
         if (a) {
             a->disconnect();
         }
-        _cache.erase(s);
     }
     /*!
         \brief find
@@ -71,20 +87,63 @@ public:
     */
     Client* find(const std::string& endpoint)
     {
-        if (_cache.find(endpoint) != _cache.end()) {
-            return _cache[endpoint].get();
+        std::lock_guard<std::mutex> l(_mutex);
+        auto i = _cache.find(endpoint);
+        if (i != _cache.end()) {
+            return i->second.get();
         }
         return nullptr;
     }
+
+    /*!
+        \brief discovery
+        \return the discovery cache shared by the clients
+    */
+    DiscoveryCache& discovery() { return *_discovery; }
+
+    /*!
+        \brief generation
+        \return changes each time a client is added or removed
+    */
+    unsigned generation() const { return _generation; }
+
+    /*!
+        \brief snapshot
+        \param clients set to the clients in the cache - shared so they outlive a concurrent remove
+    */
+    void snapshot(std::vector<ClientRef>& clients) const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        clients.clear();
+        clients.reserve(_cache.size());
+        for (auto i = _cache.begin(); i != _cache.end(); i++) {
+            if (i->second)
+                clients.push_back(i->second);
+        }
+    }
+    /*!
+        \brief snapshot
+        \param clients set to the clients in the cache by endpoint
+    */
+    void snapshot(std::map<std::string, ClientRef>& clients) const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        clients.clear();
+        for (auto i = _cache.begin(); i != _cache.end(); i++) {
+            if (i->second)
+                clients.insert(*i);
+        }
+    }
     /*!
         \brief process
         Periodic processing interface
     */
     void process()
     {
-        for (auto i = _cache.begin(); i != _cache.end(); i++) {
-            if ((i->second))
-                (i->second)->process();
+        std::vector<ClientRef> l;
+        snapshot(l);  // process without the lock - clients may add or remove entries
+        for (auto& c : l) {
+            c->process();
         }
     }
 };
@@ -12,30 +12,59 @@
 #ifndef CLIENTCACHETHREAD_H
 #define CLIENTCACHETHREAD_H
 
+#include <open62541cpp/threadconfig.h>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
 #include <open62541cpp/clientcache.h>
 
 namespace Open62541 {
 
 /*!
     \brief The ClientCacheThread class
+    Drives the clients in a cache from one or more threads. Each thread owns a fixed share of the clients
+    and waits in UA_Client_run_iterate on their sockets, so an idle cache costs no CPU. Clients without
+    an open channel are polled once per interval.
 */
 
 class ClientCacheThread
 {
     ClientCache& _cache;
-    std::thread _thread;
-    bool _running = false;
+    std::vector<std::thread> _threads;
+    ThreadConfig _threadConfig;
+    std::atomic<bool> _running{false};
+    unsigned _threadCount = 1;
+    unsigned _interval    = 100;  // ms - longest a thread waits per pass
+    std::mutex _waitMutex;
+    std::condition_variable _wake;
+
+    void worker(unsigned index);
 
 public:
     /*!
            \brief ClientCacheThread
-           \param c
+           \param c cache to drive
+           \param threads number of threads the clients are spread across
+           \param interval longest wait per pass in milliseconds - bounds the latency of timers and stop
     */
-    ClientCacheThread(ClientCache& c)
+    ClientCacheThread(ClientCache& c, unsigned threads = 1, unsigned interval = 100)
         : _cache(c)
+        , _threadCount(threads ? threads : 1)
+        , _interval(interval ? interval : 1)
     {
     }
+    /*!
+        \brief ~ClientCacheThread
+    */
+    ~ClientCacheThread() { stop(); }
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the cache threads - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
     /*!
         \brief start
         \return
@@ -46,6 +75,27 @@ public:
         \return
     */
     bool stop();
+    /*!
+        \brief running
+        \return true if started
+    */
+    bool running() const { return _running; }
+    /*!
+        \brief setThreads
+        Takes effect on the next start
+        \param n number of threads
+    */
+    void setThreads(unsigned n) { _threadCount = n ? n : 1; }
+    /*!
+        \brief threads
+        \return number of threads
+    */
+    unsigned threads() const { return _threadCount; }
+    /*!
+        \brief setInterval
+        \param ms longest wait per pass
+    */
+    void setInterval(unsigned ms) { _interval = ms ? ms : 1; }
     /*!
         \brief cache
         \return
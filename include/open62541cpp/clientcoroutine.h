@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef CLIENTCOROUTINE_H
+#define CLIENTCOROUTINE_H
+#include <open62541cpp/open62541client.h>
+
+/*
+    Optional C++20 coroutine layer over the Client async services. Only available when the including
+    translation unit is compiled with coroutine support - the library itself stays C++14.
+
+    Coroutines are resumed from the thread pumping the client (runIterate / run), inside the async
+    completion, so one thread can drive any number of clients and outstanding awaits:
+
+        Open62541::ClientTask poll(Open62541::Client& c, Open62541::NodeId n)
+        {
+            Open62541::DataValue v = co_await Open62541::awaitReadValue(c, n);
+            if (v.status() == UA_STATUSCODE_GOOD)
+                co_await Open62541::awaitWriteValue(c, other, v.value());
+        }
+
+    While resumed, blocking calls on the same client must not be made - further co_awaits are fine.
+*/
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define OPEN62541CPP_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef OPEN62541CPP_HAS_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <memory>
+
+namespace Open62541 {
+
+/*!
+    \brief The ClientTask class
+    Fire and forget coroutine return type - starts immediately and frees itself when it finishes
+*/
+struct ClientTask {
+    struct promise_type {
+        ClientTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/*!
+    \brief The ClientAwaitable class
+    Sends an async request on suspension and resumes the coroutine from its completion
+    \param R result type passed to the completion
+*/
+template <typename R>
+class ClientAwaitable
+{
+public:
+    typedef std::function<void(UA_StatusCode, R&)> Completion;
+    typedef std::function<bool(Client&, Completion)> Starter;
+
+private:
+    Client& _client;
+    Starter _start;
+    UA_StatusCode _status = UA_STATUSCODE_GOOD;
+    R _result{};
+
+public:
+    /*!
+        \brief ClientAwaitable
+        \param c client the request is sent on
+        \param s sends the request - returns false if it could not be sent
+    */
+    ClientAwaitable(Client& c, Starter s)
+        : _client(c)
+        , _start(std::move(s))
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    /*!
+        \brief await_suspend
+        \param h coroutine to resume
+        \return false if the send failed - the coroutine continues at once with the error
+    */
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        // the completion may run on another thread before this returns - do not touch members after sending
+        if (_start(_client, [this, h](UA_StatusCode s, R& r) {
+                _status = s;
+                _result = std::move(r);
+                h.resume();
+            })) {
+            return true;
+        }
+        _status = _client.lastError();
+        if (_status == UA_STATUSCODE_GOOD)
+            _status = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+
+    /*!
+        \brief await_resume
+        \return the result
+    */
+    R await_resume() { return std::move(_result); }
+
+    /*!
+        \brief status
+        \return service or operation status
+    */
+    UA_StatusCode status() const { return _status; }
+};
+
+/*!
+    \brief The CallOutput struct
+    Result of an awaited method call
+*/
+struct CallOutput {
+    UA_StatusCode status = UA_STATUSCODE_GOOD;
+    std::vector<Variant> outputs;
+};
+
+/*!
+    \brief awaitReadValue
+    \param c client
+    \param n node to read
+    \return awaitable data value - a failed send or service is reported in its status
+*/
+inline ClientAwaitable<DataValue> awaitReadValue(Client& c, const NodeId& n)
+{
+    return ClientAwaitable<DataValue>(c, [n](Client& cl, ClientAwaitable<DataValue>::Completion done) {
+        return cl.readValueAsync(n, [done](UA_StatusCode s, DataValue& v) {
+            if (s != UA_STATUSCODE_GOOD) {
+                v.null();
+                v.ref()->hasStatus = true;
+                v.ref()->status    = s;
+            }
+            done(s, v);
+        });
+    });
+}
+
+/*!
+    \brief awaitWriteValue
+    \param c client
+    \param n node to write
+    \param v value to write
+    \return awaitable write status
+*/
+inline ClientAwaitable<UA_StatusCode> awaitWriteValue(Client& c, const NodeId& n, const Variant& v)
+{
+    return ClientAwaitable<UA_StatusCode>(c, [n, v](Client& cl, ClientAwaitable<UA_StatusCode>::Completion done) {
+        return cl.writeValueAsync(n, v, [done](UA_StatusCode s) { done(s, s); });
+    });
+}
+
+/*!
+    \brief awaitCall
+    \param c client
+    \param objectId object owning the method
+    \param methodId method to call
+    \param in input arguments - deep copied, the awaitable may outlive them
+    \return awaitable call status and output arguments
+*/
+inline ClientAwaitable<CallOutput> awaitCall(Client& c, const NodeId& objectId, const NodeId& methodId, const VariantList& in)
+{
+    auto args = std::make_shared<std::vector<Variant>>(in.begin(), in.end());
+    return ClientAwaitable<CallOutput>(c, [objectId, methodId, args](Client& cl, ClientAwaitable<CallOutput>::Completion done) {
+        VariantList l;  // shallow view of the owned copies
+        for (auto& v : *args)
+            l.push_back(*v.constRef());
+        return cl.callMethodAsync(objectId, methodId, l, [done](UA_StatusCode s, VariantCallResult& out) {
+            CallOutput r;
+            r.status = s;
+            r.outputs.resize(out.size());
+            for (size_t i = 0; i < out.size(); i++)
+                r.outputs[i].adopt(out.data()[i]);  // steal - the call result frees what is left
+            done(s, r);
+        });
+    });
+}
+
+/*!
+    \brief browseAwaitable
+    Shared by awaitBrowse and awaitBrowseNext - sends the request and adopts the single browse result
+    \param c client
+    \param request request structure
+    \param requestType request type
+    \param responseType response type
+    \return awaitable browse result
+*/
+template <typename Request>
+inline ClientAwaitable<BrowseResult> browseAwaitable(Client& c,
+                                                     std::shared_ptr<Request> request,
+                                                     const UA_DataType* requestType,
+                                                     const UA_DataType* responseType)
+{
+    return ClientAwaitable<BrowseResult>(
+        c,
+        [request, requestType, responseType](Client& cl, ClientAwaitable<BrowseResult>::Completion done) {
+            return cl.sendAsync(request.get(), requestType, responseType, [done](UA_StatusCode s, void* response) {
+                // BrowseResponse and BrowseNextResponse share the same layout up to the results
+                UA_BrowseResponse* r = static_cast<UA_BrowseResponse*>(response);
+                BrowseResult b;
+                if (s == UA_STATUSCODE_GOOD) {
+                    if (r->resultsSize == 1) {
+                        b.adopt(r->results[0]);
+                        s = b.constRef()->statusCode;
+                    }
+                    else {
+                        s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+                    }
+                }
+                if (s != UA_STATUSCODE_GOOD)
+                    b.ref()->statusCode = s;
+                done(s, b);
+            });
+        });
+}
+
+/*!
+    \brief awaitBrowse
+    Browses the forward hierarchical references of a node. Follow a non empty continuation point with
+    awaitBrowseNext
+    \param c client
+    \param n node to browse
+    \param maxReferences references per result - 0 for the server limit
+    \return awaitable browse result - the status code is set on failure
+*/
+inline ClientAwaitable<BrowseResult> awaitBrowse(Client& c, const NodeId& n, UA_UInt32 maxReferences = 0)
+{
+    struct Holder {
+        UA_BrowseRequest req;
+        UA_BrowseDescription desc;
+        NodeId node;
+    };
+    auto h = std::make_shared<Holder>();
+    h->node = n;
+    UA_BrowseDescription_init(&h->desc);
+    h->desc.nodeId          = *h->node.constRef();  // shallow - owned by the holder
+    h->desc.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    h->desc.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    h->desc.includeSubtypes = true;
+    h->desc.resultMask      = UA_BROWSERESULTMASK_ALL;
+    UA_BrowseRequest_init(&h->req);
+    h->req.requestedMaxReferencesPerNode = maxReferences;
+    h->req.nodesToBrowse                 = &h->desc;
+    h->req.nodesToBrowseSize             = 1;
+    // aliasing pointer - the request lives as long as the holder
+    return browseAwaitable(c,
+                           std::shared_ptr<UA_BrowseRequest>(h, &h->req),
+                           &UA_TYPES[UA_TYPES_BROWSEREQUEST],
+                           &UA_TYPES[UA_TYPES_BROWSERESPONSE]);
+}
+
+/*!
+    \brief awaitBrowseNext
+    \param c client
+    \param continuationPoint from the previous result - copied
+    \param release release the continuation point instead of reading more
+    \return awaitable browse result
+*/
+inline ClientAwaitable<BrowseResult> awaitBrowseNext(Client& c, const UA_ByteString& continuationPoint, bool release = false)
+{
+    struct Holder {
+        UA_BrowseNextRequest req;
+        UA_ByteString cp;
+        ~Holder() { UA_ByteString_clear(&cp); }
+    };
+    auto h = std::make_shared<Holder>();
+    UA_ByteString_copy(&continuationPoint, &h->cp);
+    UA_BrowseNextRequest_init(&h->req);
+    h->req.releaseContinuationPoints = release;
+    h->req.continuationPoints        = &h->cp;
+    h->req.continuationPointsSize    = 1;
+    return browseAwaitable(c,
+                           std::shared_ptr<UA_BrowseNextRequest>(h, &h->req),
+                           &UA_TYPES[UA_TYPES_BROWSENEXTREQUEST],
+                           &UA_TYPES[UA_TYPES_BROWSENEXTRESPONSE]);
+}
+
+}  // namespace Open62541
+
+#endif  // OPEN62541CPP_HAS_COROUTINES
+#endif  // CLIENTCOROUTINE_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef CLIENTFILE_H
+#define CLIENTFILE_H
+#include <open62541cpp/open62541client.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The ClientFile class
+    Downloads and uploads a FileType object (Part 5 C.2) - for example one served by ServerFileType.
+    A download splits the file into contiguous segments, opens a handle per segment and keeps one Read in flight
+    on each, so several Reads are pipelined without relying on the server running the calls of one handle in
+    order. An upload has the file to itself, so its Writes go one at a time - use a large chunk.
+    By default the calls pump the client (runIterate) while they wait. If another thread already runs the
+    client call setPump(false). The object must not outlive the client
+*/
+class UA_EXPORT ClientFile
+{
+    struct State;    // shared with the completions of calls in flight
+    struct Segment;  // one handle's share of a transfer
+    Client& _client;
+    NodeId _object;
+    size_t _chunk      = 4 * 1024 * 1024;
+    unsigned _parallel = 4;
+    bool _pump         = true;
+    unsigned _timeout  = 30000;  // ms to wait for the next call to complete
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    bool run(const std::shared_ptr<State>& st);
+
+public:
+    /*!
+        \brief ClientFile
+        \param client connected client
+        \param object the FileType object
+        \param chunk bytes per Read or Write call
+        \param parallel handles reading at once in a download
+    */
+    ClientFile(Client& client, const NodeId& object, size_t chunk = 4 * 1024 * 1024, unsigned parallel = 4);
+    ClientFile(const ClientFile&) = delete;
+    ClientFile& operator=(const ClientFile&) = delete;
+    virtual ~ClientFile() {}
+
+    /*!
+        \brief size
+        \param n set to the file's Size property
+        \return true on success
+    */
+    bool size(UA_UInt64& n);
+
+    /*!
+        \brief download
+        \param data set to the file's contents
+        \return true on success
+    */
+    bool download(std::vector<UA_Byte>& data);
+    /*!
+        \brief download
+        \param path local file written with the contents
+        \return true on success
+    */
+    bool download(const std::string& path);
+    /*!
+        \brief upload
+        Replace the file's contents
+        \param data
+        \param length
+        \return true on success
+    */
+    bool upload(const UA_Byte* data, size_t length);
+    bool upload(const std::vector<UA_Byte>& data) { return upload(data.data(), data.size()); }
+    /*!
+        \brief upload
+        \param path local file sent
+        \return true on success
+    */
+    bool upload(const std::string& path);
+
+    /*!
+        \brief setChunk
+        \param bytes per Read or Write call - within the message size limits of both ends
+    */
+    void setChunk(size_t bytes) { _chunk = bytes ? std::min<size_t>(bytes, 0x7FFFFFFF) : 1; }
+    size_t chunk() const { return _chunk; }
+    /*!
+        \brief setParallel
+        \param n handles reading at once in a download
+    */
+    void setParallel(unsigned n) { _parallel = n ? n : 1; }
+    unsigned parallel() const { return _parallel; }
+    /*!
+        \brief setPump
+        \param f run the client while waiting - false if another thread runs it
+    */
+    void setPump(bool f) { _pump = f; }
+    bool pump() const { return _pump; }
+    /*!
+        \brief setTimeout
+        \param ms time to wait for the next call to complete
+    */
+    void setTimeout(unsigned ms) { _timeout = ms; }
+    unsigned timeout() const { return _timeout; }
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // CLIENTFILE_H
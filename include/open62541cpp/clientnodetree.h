@@ -59,6 +59,21 @@ public:
         return _client.browseTree(root().data(), *this);  // load the tree
     }
 
+    /*!
+        \brief resync
+        Browse again into a scratch tree and apply only the differences to this one - unchanged nodes are
+        left as they are
+        \param f optional report of added, removed and modified nodes
+        \return number of changes, 0 also if the browse failed
+    */
+    size_t resync(const ChangeFunc& f = ChangeFunc())
+    {
+        UANodeTree t(root().data());
+        if (!_client.browseTree(root().data(), t))
+            return 0;
+        return applyDiff(t, f);
+    }
+
     // client and server have different methods - TO DO unify client and server - and template
     // only deal with value nodes and folders - for now
     /*!
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef CLIENTPOOL_H
+#define CLIENTPOOL_H
+#include <open62541cpp/clientcache.h>
+#include <open62541cpp/threadconfig.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+namespace Open62541 {
+
+/*!
+    \brief The ClientPool class
+    Thread safe pool of client sessions. Endpoints are sharded across a fixed set of I/O threads, each of
+    which connects, pumps and health checks the sessions it owns, reconnecting failed ones with exponential
+    backoff. Each endpoint may have several sessions so parallel requests do not queue on one client lock.
+
+    The endpoint table is an immutable snapshot replaced on add / remove, so find() never takes the pool
+    mutex and never waits on the I/O threads.
+*/
+class UA_EXPORT ClientPool
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    /*!
+        \brief ConnectFunc
+        Starts a connection - called on the owning I/O thread. The default is Client::connectAsync.
+        Return false if the attempt could not be started
+    */
+    typedef std::function<bool(Client&, const std::string&)> ConnectFunc;
+
+private:
+    /*!
+        \brief The Session struct
+        Connection state is only touched by the owning I/O thread, up is read by any thread
+    */
+    struct Session {
+        ClientRef client;
+        std::atomic<bool> up{false};
+        bool connecting = false;
+        Clock::time_point started;
+        Clock::time_point nextAttempt;
+        std::chrono::milliseconds backoff{0};
+    };
+
+    /*!
+        \brief The Endpoint struct
+    */
+    struct Endpoint {
+        std::string url;
+        unsigned shard = 0;
+        std::vector<std::unique_ptr<Session>> sessions;
+        std::atomic<unsigned> next{0};  // round robin for find
+    };
+
+    typedef std::shared_ptr<Endpoint> EndpointRef;
+    typedef std::map<std::string, EndpointRef> EndpointMap;
+    typedef std::shared_ptr<const EndpointMap> EndpointMapRef;
+
+    EndpointMapRef _endpoints;  // only accessed with std::atomic_load / atomic_store
+    std::mutex _mutex;          // serialises writers of _endpoints
+    //
+    std::vector<std::thread> _threads;
+    ThreadConfig _threadConfig;
+    std::atomic<bool> _running{false};
+    std::mutex _waitMutex;
+    std::condition_variable _wake;
+    //
+    unsigned _threadCount         = 4;
+    unsigned _sessionsPerEndpoint = 1;
+    unsigned _interval            = 100;  // ms - longest wait per pass
+    std::chrono::milliseconds _minBackoff{500};
+    std::chrono::milliseconds _maxBackoff{30000};
+    std::chrono::milliseconds _connectTimeout{10000};
+    UA_UInt32 _renewalGuard = 0;  // ms - 0 routes to sessions whatever their renewal state
+    ConnectFunc _connect;
+
+    void worker(unsigned index);
+    void service(Endpoint& e, Session& s, Clock::time_point now, unsigned slice, bool& waited);
+    void failed(Session& s, Clock::time_point now);
+    EndpointMapRef endpoints() const { return std::atomic_load(&_endpoints); }
+
+public:
+    /*!
+        \brief ClientPool
+        \param threads number of I/O threads endpoints are sharded across
+        \param sessionsPerEndpoint sessions opened to each endpoint
+    */
+    ClientPool(unsigned threads = 4, unsigned sessionsPerEndpoint = 1);
+
+    /*!
+        \brief ~ClientPool
+    */
+    virtual ~ClientPool();
+
+    /*!
+        \brief setConnect
+        Replaces the connect function - for example to log in with a user name. Set before start
+        \param f connect function
+    */
+    void setConnect(ConnectFunc f) { _connect = f; }
+
+    /*!
+        \brief setBackoff
+        \param minimum first retry delay after a failure - doubled on each failure
+        \param maximum longest retry delay
+    */
+    void setBackoff(std::chrono::milliseconds minimum, std::chrono::milliseconds maximum)
+    {
+        _minBackoff = minimum;
+        _maxBackoff = maximum;
+    }
+
+    /*!
+        \brief setConnectTimeout
+        \param t time allowed for a session to activate before it is treated as failed
+    */
+    void setConnectTimeout(std::chrono::milliseconds t) { _connectTimeout = t; }
+
+    /*!
+        \brief setRenewalGuard
+        find() prefers sessions that are not about to renew their secure channel, or have just done so, so
+        requests are not held up by a renewal - the I/O thread renews the channel while requests go to another
+        session of the endpoint. Give endpoints two or more sessions for this to help
+        \param ms window either side of a session's estimated renewal - 0 to turn off
+    */
+    void setRenewalGuard(UA_UInt32 ms) { _renewalGuard = ms; }
+
+    /*!
+        \brief setInterval
+        \param ms longest time an I/O thread waits per pass
+    */
+    void setInterval(unsigned ms) { _interval = ms ? ms : 1; }
+
+    /*!
+        \brief add
+        Adds an endpoint - its sessions are connected by the owning I/O thread
+        \param endpoint endpoint url
+        \param sessions number of sessions - 0 for the pool default
+        \return true if added, false if already present
+    */
+    bool add(const std::string& endpoint, unsigned sessions = 0);
+
+    /*!
+        \brief remove
+        Sessions are disconnected once the last reference to them is released
+        \param endpoint endpoint url
+        \return true if removed
+    */
+    bool remove(const std::string& endpoint);
+
+    /*!
+        \brief find
+        Lock free lookup - returns the connected sessions of an endpoint in turn
+        \param endpoint endpoint url
+        \return a connected session or null if none is up
+    */
+    ClientRef find(const std::string& endpoint) const;
+
+    /*!
+        \brief sessions
+        \param endpoint endpoint url
+        \param clients set to every session of the endpoint, connected or not
+    */
+    void sessions(const std::string& endpoint, std::vector<ClientRef>& clients) const;
+
+    /*!
+        \brief connected
+        \param endpoint endpoint url
+        \return number of sessions currently up
+    */
+    unsigned connected(const std::string& endpoint) const;
+
+    /*!
+        \brief size
+        \return number of endpoints
+    */
+    size_t size() const { return endpoints()->size(); }
+
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the pool threads - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
+    /*!
+        \brief start
+        \return true on success
+    */
+    bool start();
+
+    /*!
+        \brief stop
+        Stops the I/O threads - sessions stay in the pool until removed or the pool is destroyed
+    */
+    void stop();
+
+    /*!
+        \brief running
+        \return true if started
+    */
+    bool running() const { return _running; }
+};
+
+}  // namespace Open62541
+
+#endif  // CLIENTPOOL_H
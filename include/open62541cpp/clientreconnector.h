@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef CLIENTRECONNECTOR_H
+#define CLIENTRECONNECTOR_H
+#include <open62541cpp/clientcache.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace Open62541 {
+
+/*!
+    \brief The ClientReconnector class
+    Keeps the clients of a ClientCache connected without a connect storm. Handshakes are started with the
+    asynchronous connect and at most a fixed number are in flight at once, so a site wide restore does not
+    bring hundreds of secure channel handshakes onto the servers together. Endpoints waiting to connect are
+    started highest priority first. Failed attempts are retried with exponential backoff and every delay is
+    jittered, including the first one after a connection drops, so clients that failed together do not retry
+    together. The endpoint the stack selected on the last good connection is preset on the next attempt, so a
+    reconnect need not fetch the endpoints again.
+    Call process() periodically from one thread - it also pumps the handshakes it started, so it works with or
+    without a ClientCacheThread. Clients in the cache should not be connected by other code
+*/
+class UA_EXPORT ClientReconnector
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    /*!
+        \brief ConnectFunc
+        Starts a connection on a freshly initialised client whose configuration holds the cached endpoint, if
+        any. Set security and credentials on the configuration and start with the C API - UA_Client_connectAsync
+        or UA_Client_connectSecureChannelAsync - as Client::connect* initialise the client again. The default
+        calls UA_Client_connectAsync. Return false if the attempt could not be started
+    */
+    typedef std::function<bool(Client&, const std::string&)> ConnectFunc;
+
+private:
+    struct Entry {
+        ClientRef client;
+        bool up         = false;
+        bool connecting = false;
+        int priority    = 0;
+        Clock::time_point started;
+        Clock::time_point nextAttempt;
+        std::chrono::milliseconds backoff{0};
+        bool known = false;  // endpoint and policy hold the last selection
+        UA_EndpointDescription endpoint;
+        UA_UserTokenPolicy policy;
+        Entry()
+        {
+            UA_EndpointDescription_init(&endpoint);
+            UA_UserTokenPolicy_init(&policy);
+        }
+        ~Entry()
+        {
+            UA_EndpointDescription_clear(&endpoint);
+            UA_UserTokenPolicy_clear(&policy);
+        }
+    };
+    typedef std::unique_ptr<Entry> EntryRef;
+
+    ClientCache& _cache;
+    std::mutex _mutex;  // settings - the entries are only touched by process()
+    std::map<std::string, EntryRef> _entries;
+    std::map<std::string, int> _priorities;
+    bool _prioritiesChanged = false;
+    unsigned _generation    = 0;
+    bool _synced            = false;
+    ConnectFunc _connect;
+    unsigned _maxParallel = 8;
+    std::chrono::milliseconds _minBackoff{500};
+    std::chrono::milliseconds _maxBackoff{60000};
+    std::chrono::milliseconds _connectTimeout{10000};
+    double _jitter = 0.5;
+    std::mt19937 _random;
+    std::atomic<size_t> _connecting{0};
+    std::atomic<size_t> _up{0};
+    std::atomic<size_t> _attempts{0};
+    std::atomic<size_t> _failures{0};
+    std::atomic<size_t> _presets{0};
+
+    void sync();
+    bool start(const std::string& url, Entry& e, Clock::time_point now);
+    void failed(Entry& e, Clock::time_point now);
+    void dropped(Entry& e, Clock::time_point now);
+    void connected(Entry& e);
+    std::chrono::milliseconds jittered(std::chrono::milliseconds d);
+
+public:
+    /*!
+        \brief ClientReconnector
+        \param cache clients to keep connected - endpoints are the cache keys
+        \param maxParallel handshakes in flight at once
+    */
+    ClientReconnector(ClientCache& cache, unsigned maxParallel = 8);
+    ClientReconnector(const ClientReconnector&) = delete;
+    ClientReconnector& operator=(const ClientReconnector&) = delete;
+    virtual ~ClientReconnector() {}
+
+    /*!
+        \brief setConnect
+        \param f starts each attempt - see ConnectFunc
+    */
+    void setConnect(ConnectFunc f)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _connect = f;
+    }
+    /*!
+        \brief setMaxParallel
+        \param n handshakes in flight at once
+    */
+    void setMaxParallel(unsigned n)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _maxParallel = n ? n : 1;
+    }
+    /*!
+        \brief setBackoff
+        \param minimum retry delay after the first failure - doubled on each failure
+        \param maximum longest retry delay
+    */
+    void setBackoff(std::chrono::milliseconds minimum, std::chrono::milliseconds maximum)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _minBackoff = minimum;
+        _maxBackoff = std::max(minimum, maximum);
+    }
+    /*!
+        \brief setJitter
+        \param fraction each delay is drawn between (1 - fraction) and 1 times its value
+    */
+    void setJitter(double fraction)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _jitter = std::min(1.0, std::max(0.0, fraction));
+    }
+    /*!
+        \brief setConnectTimeout
+        \param t an attempt not activated by then has failed
+    */
+    void setConnectTimeout(std::chrono::milliseconds t)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _connectTimeout = t;
+    }
+    /*!
+        \brief setPriority
+        \param endpoint
+        \param priority higher connects first - default 0
+    */
+    void setPriority(const std::string& endpoint, int priority);
+
+    /*!
+        \brief process
+        One pass - check the handshakes in flight and start waiting ones up to the limit
+        \return handshakes started
+    */
+    size_t process();
+
+    size_t connecting() const { return _connecting; }  // handshakes in flight
+    size_t up() const { return _up; }                  // sessions activated
+    size_t attempts() const { return _attempts; }
+    size_t failures() const { return _failures; }
+    size_t presets() const { return _presets; }  // attempts started with a cached endpoint
+};
+
+}  // namespace Open62541
+
+#endif  // CLIENTRECONNECTOR_H
@@ -13,6 +13,8 @@
 #define CLIENTSUBSCRIPTION_H
 #include <open62541cpp/open62541objects.h>
 #include <open62541cpp/monitoreditem.h>
+#include <open62541cpp/snapshotmap.h>
+#include <algorithm>
 namespace Open62541 {
 
 /*!
@@ -22,16 +24,70 @@ namespace Open62541 {
 
 typedef std::shared_ptr<MonitoredItem> MonitoredItemRef;
 
-typedef std::map<unsigned, MonitoredItemRef> MonitoredItemMap;
+typedef SnapshotMap<unsigned, MonitoredItemRef> MonitoredItemMap;  // read without locking - see SnapshotMap
+
+/*!
+    \brief The DataChangeNotification struct
+    One queued data change - the value is owned by the batch and cleared after dispatch
+*/
+struct DataChangeNotification {
+    MonitoredItem* item = nullptr;
+    UA_DataValue value;
+};
 
 class UA_EXPORT ClientSubscription
 {
+public:
+    /*!
+        \brief The AdaptiveLimits struct
+        Bounds the adaptive mode keeps the subscription within
+    */
+    struct AdaptiveLimits {
+        double minPublishingInterval         = 100.0;  // milliseconds
+        double maxPublishingInterval         = 10000.0;
+        UA_UInt32 minQueueSize               = 1;
+        UA_UInt32 maxQueueSize               = 1000;
+        UA_UInt32 maxNotificationsPerPublish = 0;        // 0 - may be raised to unlimited
+        double window                        = 10000.0;  // milliseconds between adjustments
+    };
+    // DataValue status InfoType DataValue with the Overflow bit (Part 4 7.34.1) - a queue dropped values
+    static constexpr UA_StatusCode OverflowBits = 0x00000480;
+
+private:
     Client& _client;  // owning client
     CreateSubscriptionRequest _settings;
     CreateSubscriptionResponse _response;
     //
-    int _monitorId = 0;     // key monitor items by Id
-    MonitoredItemMap _map;  // map of monitor items - these are monitored items owned by this subscription
+    std::atomic<unsigned> _monitorId{0};     // key monitor items by Id
+    MonitoredItemMap _map;                   // monitored items owned by this subscription
+    std::vector<MonitoredItemRef> _retired;  // deleted - released by the iterate thread once nothing queued holds them
+    std::mutex _retiredMutex;
+    //
+    bool _batching = false;
+    std::vector<DataChangeNotification> _batch;  // capacity is kept between publish responses
+    std::vector<MonitoredItem*> _eventFlush;     // items holding events for the end of the iteration
+    std::vector<MonitoredItem*> _held;           // items whose change filter holds a throttled value
+    //
+    bool _adaptive = false;
+    AdaptiveLimits _limits;
+    /*!
+        \brief The Load struct
+        What the adaptive mode has seen since the last adjustment
+    */
+    struct Load {
+        UA_DateTime start     = 0;  // monotonic
+        UA_UInt32 generation  = 0;  // counts client iterations that received notifications
+        UA_UInt32 perPublish  = 0;  // notifications in this iteration
+        UA_UInt32 publishPeak = 0;
+        size_t notifications  = 0;
+        size_t overflows      = 0;
+        UA_DateTime minDelay  = 0;  // server timestamp to arrival - the smallest stands for clock offset
+        UA_DateTime maxDelay  = 0;
+        size_t totalOverflows = 0;
+        size_t adjustments    = 0;
+    } _load;
+    //
+    size_t createItems(const std::vector<MonitoredItemDataChange*>& items, bool lock, std::vector<UA_StatusCode>& results);
     //
 protected:
     UA_StatusCode _lastError = 0;
@@ -89,6 +145,198 @@ public:
         \brief changeNotificationCallback
     */
     virtual void statusChangeNotification(UA_StatusChangeNotification* /*notification*/) {}
+
+    /*!
+        \brief setBatching
+        When set data changes are queued as they are decoded and passed to dataChangeNotifications together
+        once the client iteration that received them completes, instead of one virtual call per item
+        \param on enable batching
+    */
+    void setBatching(bool on)
+    {
+        if (!on)
+            flushNotifications();
+        _batching = on;
+    }
+
+    /*!
+        \brief batching
+        \return true if data changes are batched
+    */
+    bool batching() const { return _batching; }
+
+    /*!
+        \brief setAdaptive
+        In adaptive mode the subscription watches notification rates, queue overflow bits and the delay from
+        server timestamp to arrival. Once per window it resizes the queues of data change items through
+        ModifyMonitoredItems - up on overflow, down when quiet - and changes the publishing interval and the
+        notifications per publish through ModifySubscription. Queues grow before the interval shrinks,
+        and the interval grows only while every queue has room for half again as many values, so a quiet
+        subscription publishes as seldom as its limits allow without losing values.
+        Adjustments are made from Client::runIterate
+        \param on enable adaptive mode
+        \param limits bounds of the adjustments
+    */
+    void setAdaptive(bool on, const AdaptiveLimits& limits = AdaptiveLimits())
+    {
+        _adaptive = on;
+        _limits   = limits;
+        _load     = Load();
+    }
+
+    /*!
+        \brief adaptive
+        \return true in adaptive mode
+    */
+    bool adaptive() const { return _adaptive; }
+
+    /*!
+        \brief overflows
+        \return notifications flagged with the overflow bit since adaptive mode was set - values lost
+    */
+    size_t overflows() const { return _load.totalOverflows + _load.overflows; }
+
+    /*!
+        \brief adjustments
+        \return changes the adaptive mode has made
+    */
+    size_t adjustments() const { return _load.adjustments; }
+
+    /*!
+        \brief monitoredItemCount
+        \return monitored items owned by this subscription
+    */
+    size_t monitoredItemCount() const { return _map.size(); }
+
+    /*!
+        \brief observe
+        Counts a data change for the adaptive mode - called as it is received
+        \param m monitored item
+        \param value received value
+    */
+    void observe(MonitoredItem* m, const UA_DataValue* value)
+    {
+        _load.notifications++;
+        _load.perPublish++;
+        if (m->_generation != _load.generation) {
+            m->_generation = _load.generation;
+            m->_perPublish = 0;
+        }
+        if (++m->_perPublish > m->_peak)
+            m->_peak = m->_perPublish;
+        if (value->hasStatus && ((value->status & OverflowBits) == OverflowBits)) {
+            m->_overflow = true;
+            _load.overflows++;
+        }
+        if (value->hasServerTimestamp) {
+            const UA_DateTime d = UA_DateTime_now() - value->serverTimestamp;
+            if (!_load.minDelay || (d < _load.minDelay))
+                _load.minDelay = d;
+            if (d > _load.maxDelay)
+                _load.maxDelay = d;
+        }
+    }
+
+    /*!
+        \brief adapt
+        Ends the client iteration for the adaptive mode and adjusts the subscription once a window has passed
+        \param lock take the client lock for the requests - false when called from the iterate thread
+    */
+    void adapt(bool lock);
+
+    /*!
+        \brief queueNotification
+        Takes the value from the stack - nothing is copied
+        \param m monitored item
+        \param value decoded value - left empty
+    */
+    void queueNotification(MonitoredItem* m, UA_DataValue* value)
+    {
+        _batch.emplace_back();
+        DataChangeNotification& n = _batch.back();
+        n.item                    = m;
+        n.value                   = *value;  // steal - the stack clears the reinitialised source
+        UA_DataValue_init(value);
+    }
+
+    /*!
+        \brief flushNotifications
+        Dispatches and clears the queued data changes, then flushes items holding events
+    */
+    void flushNotifications()
+    {
+        if (!_held.empty())
+            flushHeld();
+        if (!_batch.empty()) {
+            dataChangeNotifications(_batch.data(), _batch.size());
+            for (auto& n : _batch)
+                UA_DataValue_clear(&n.value);
+            _batch.clear();
+        }
+        for (size_t i = 0; i < _eventFlush.size(); i++) {
+            if (_eventFlush[i] && !_eventFlush[i]->retired())
+                _eventFlush[i]->flushEvents();
+        }
+        _eventFlush.clear();
+        releaseRetired();
+    }
+
+    /*!
+        \brief releaseRetired
+        Drop the deleted items - on the iterate thread, when no queued notification refers to them
+    */
+    void releaseRetired()
+    {
+        std::vector<MonitoredItemRef> r;
+        {
+            std::lock_guard<std::mutex> l(_retiredMutex);
+            r.swap(_retired);
+        }
+        if (!_held.empty()) {
+            for (auto& m : r) {
+                auto i = std::find(_held.begin(), _held.end(), m.get());
+                if (i != _held.end())
+                    _held.erase(i);
+            }
+        }
+    }
+
+    /*!
+        \brief queueHeld
+        \param m monitored item whose change filter started holding a value - released by flushNotifications
+    */
+    void queueHeld(MonitoredItem* m) { _held.push_back(m); }
+
+    /*!
+        \brief flushHeld
+        Dispatches the throttled values whose interval has passed - on the iterate thread, ahead of the batch
+    */
+    void flushHeld()
+    {
+        const UA_DateTime now = UA_DateTime_nowMonotonic();
+        size_t n              = 0;
+        for (size_t i = 0; i < _held.size(); i++) {
+            MonitoredItem* m = _held[i];
+            if (!m->retired() && !m->releaseHeld(now))
+                _held[n++] = m;  // still held
+        }
+        _held.resize(n);
+    }
+
+    /*!
+        \brief queueEventFlush
+        \param m monitored item to call flushEvents on from flushNotifications - once per iteration
+    */
+    void queueEventFlush(MonitoredItem* m) { _eventFlush.push_back(m); }
+
+    /*!
+        \brief dataChangeNotifications
+        Batched handler - override to process all the values of a publish cycle at once. The default
+        passes each value to its monitored item
+        \param notifications queued data changes
+        \param n number of data changes
+    */
+    virtual void dataChangeNotifications(DataChangeNotification* notifications, size_t n);
     /*!
         \brief settings
         \return reference to the request structure
@@ -107,38 +355,44 @@ public:
     */
     unsigned addMonitorItem(MonitoredItemRef& m)
     {
-        _monitorId++;
-        _map[_monitorId] = std::move(m);
-        return _monitorId;
+        const unsigned id = ++_monitorId;
+        _map.set(id, std::move(m));
+        return id;
     }
 
     /*!
         \brief deleteMonitorItem
+        May be called from any thread - the item stops dispatching at once and is destroyed by the iterate
+        thread once no queued notification refers to it. The server request to delete it is made here, so
+        take the client lock as for any other request when the client is iterated on another thread
         \param id Id of the monitored item (from addMonitorItem) to delete
     */
-
     void deleteMonitorItem(unsigned id)
     {
-        if (_map.find(id) != _map.end()) {
-            MonitoredItemRef& m = _map[id];
+        MonitoredItemRef m = _map.take(id);
+        if (m) {
+            m->retire();
             m->remove();
-            _map.erase(id);
+            std::lock_guard<std::mutex> l(_retiredMutex);
+            _retired.push_back(std::move(m));
         }
     }
 
     /*!
         \brief findMonitorItem
+        The pointer is valid until the item is deleted and released by the thread running the client - use it
+        on that thread, or hold a findMonitorItemRef
         \param id Id of monitored item
         \return pointer to MonitoredItem or null
     */
-    MonitoredItem* findMonitorItem(unsigned id)
-    {
-        if (_map.find(id) != _map.end()) {
-            MonitoredItemRef& m = _map[id];
-            return m.get();
-        }
-        return nullptr;
-    }
+    MonitoredItem* findMonitorItem(unsigned id) { return _map.find(id).get(); }
+
+    /*!
+        \brief findMonitorItemRef
+        \param id Id of monitored item
+        \return the item, kept while the reference is held - callable from any thread
+    */
+    MonitoredItemRef findMonitorItemRef(unsigned id) { return _map.find(id); }
 
     /*!
         \brief Open62541::ClientSubscription::addMonitorNodeId
@@ -160,6 +414,78 @@ public:
         return ret;  // returns item id
     }
 
+    /*!
+        \brief createDataChanges
+        Creates data change items in bulk - CreateMonitoredItems requests are chunked to the server's
+        MaxMonitoredItemsPerCall and the item map filled in one pass. Takes ownership of the items; those
+        that fail are deleted
+        \param items items to create, one per node
+        \param nodes nodes to monitor
+        \param ids set to the item id (from addMonitorItem) per node - 0 where creation failed
+        \param samplingInterval requested sampling interval in milliseconds
+        \param queueSize requested queue size
+        \param ts timestamps to return
+        \return number of items created
+    */
+    size_t createDataChanges(std::vector<MonitoredItemDataChange*>& items,
+                             const std::vector<NodeId>& nodes,
+                             std::vector<unsigned>& ids,
+                             double samplingInterval  = 250.0,
+                             UA_UInt32 queueSize      = 1,
+                             UA_TimestampsToReturn ts = UA_TIMESTAMPSTORETURN_BOTH);
+
+    /*!
+        \brief Open62541::ClientSubscription::addMonitorNodeIds
+        Bulk form of addMonitorNodeId
+        \param nodes nodes to monitor
+        \param funcs one handler for all nodes or one per node
+        \param ids set to the item id per node - 0 where creation failed
+        \param samplingInterval requested sampling interval in milliseconds
+        \param queueSize requested queue size
+        \param ts timestamps to return
+        \return number of items created
+    */
+    template <typename T = Open62541::MonitoredItemDataChange>
+    size_t addMonitorNodeIds(const std::vector<NodeId>& nodes,
+                             const std::vector<monitorItemFunc>& funcs,
+                             std::vector<unsigned>& ids,
+                             double samplingInterval  = 250.0,
+                             UA_UInt32 queueSize      = 1,
+                             UA_TimestampsToReturn ts = UA_TIMESTAMPSTORETURN_BOTH)
+    {
+        if ((funcs.size() != 1) && (funcs.size() != nodes.size())) {
+            _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+            ids.assign(nodes.size(), 0);
+            return 0;
+        }
+        std::vector<MonitoredItemDataChange*> items(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            items[i] = new T((funcs.size() == 1) ? funcs[0] : funcs[i], *this);
+        }
+        return createDataChanges(items, nodes, ids, samplingInterval, queueSize, ts);
+    }
+
+    /*!
+        \brief lastError
+        \return last error code
+    */
+    UA_StatusCode lastError() const { return _lastError; }
+
+    /*!
+        \brief invalidate
+        Forgets the server side subscription and items without deleting them, keeping their definitions
+    */
+    void invalidate();
+
+    /*!
+        \brief recover
+        Creates the subscription again on the current session and recreates its items from their stored
+        definitions - data change items in bulk
+        \param lock take the client lock per request - false when called from the iterate thread
+        \return true if the subscription was created, check lastError for item failures
+    */
+    bool recover(bool lock = true);
+
     /*!
         \brief Open62541::ClientSubscription::addEventMonitor
         \param f event handler functor
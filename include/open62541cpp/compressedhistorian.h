@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef COMPRESSEDHISTORIAN_H
+#define COMPRESSEDHISTORIAN_H
+#include <open62541cpp/historydatabase.h>
+#include <cstdint>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The CompressedHistoryBackend class
+    In memory history store holding each node as columns of compressed blocks.
+    Timestamps are delta of delta encoded, scalar numeric values are XOR encoded against the previous
+    value (Gorilla style) and status codes are run length encoded. Values that are not numeric scalars
+    are kept as plain variants in the value column. The last block of a node is encoded incrementally
+    as values arrive, so an append never decodes anything.
+    Only the history key timestamp is retained: decoded values carry it as both the source and the
+    server timestamp
+*/
+class UA_EXPORT CompressedHistoryBackend : public HistoryDataBackend
+{
+public:
+    /*!
+        \brief The StatusRun struct
+        A run of samples with the same status and value presence
+    */
+    struct StatusRun {
+        UA_StatusCode status = UA_STATUSCODE_GOOD;
+        bool hasValue        = true;
+        UA_UInt32 count      = 0;
+    };
+
+    /*!
+        \brief The Block struct
+        Up to blockSize samples of one node
+    */
+    struct Block {
+        UA_DateTime first = 0;                // timestamp of the first sample - the start of the encoding
+        UA_DateTime last  = 0;                // timestamp of the last sample
+        size_t start      = 0;                // node index of the first sample
+        size_t count      = 0;                // number of samples
+        const UA_DataType* type = nullptr;    // numeric scalar type of the values
+        bool raw                = false;      // values are held in raw rather than XOR encoded
+        std::vector<UA_Byte> times;           // delta of delta bit stream
+        std::vector<UA_Byte> values;          // XOR bit stream
+        std::vector<Variant> raw_values;      // values of a raw block
+        std::vector<StatusRun> status;        // run length encoded status codes
+        size_t valueCount = 0;                // samples carrying a value
+        // encoder state - lets the block be appended to without decoding
+        UA_Int64 prevDelta  = 0;
+        UA_UInt64 prevBits  = 0;
+        int leading         = -1;  // -1 no XOR window yet
+        int trailing        = 0;
+        unsigned timesFree  = 0;   // unused bits in the last byte of times
+        unsigned valuesFree = 0;   // unused bits in the last byte of values
+    };
+
+    /*!
+        \brief The Column struct
+        The history of one node
+    */
+    struct Column {
+        std::vector<Block> blocks;
+        size_t size = 0;  // total samples
+        // decode caches - the most recently decoded block
+        size_t valuesBlock = SIZE_MAX;
+        std::vector<DataValue> decoded;
+        size_t timesBlock = SIZE_MAX;
+        std::vector<UA_DateTime> decodedTimes;
+        void invalidate()
+        {
+            valuesBlock = SIZE_MAX;
+            timesBlock  = SIZE_MAX;
+        }
+    };
+
+private:
+    std::mutex _mutex;
+    UnorderedNodeIdMap<Column> _columns;
+    size_t _blockSize = 1024;
+
+    Column* column(const NodeId& n, bool create = false);
+    void append(std::vector<Block>& blocks, UA_DateTime t, UA_StatusCode s, const UA_Variant* v);
+    void append(std::vector<Block>& blocks, const UA_DataValue& v);
+    void renumber(Column& c, size_t from);
+    void rewrite(Column& c, size_t block, size_t count, std::vector<DataValue>& samples);
+    const std::vector<UA_DateTime>& times(Column& c, size_t block);
+    const std::vector<DataValue>& values(Column& c, size_t block);
+    size_t blockOf(const Column& c, size_t index) const;
+    size_t lowerBound(Column& c, UA_DateTime t);
+    size_t upperBound(Column& c, UA_DateTime t);
+    bool store(Column& c, const UA_DataValue& v, bool replace, bool insert);
+    static size_t bytesOf(const Column& c);
+
+public:
+    /*!
+        \brief CompressedHistoryBackend
+        \param blockSize samples per block - larger blocks compress better, smaller blocks decode faster
+    */
+    CompressedHistoryBackend(size_t blockSize = 1024);
+    virtual ~CompressedHistoryBackend() {}
+
+    /*!
+        \brief blockSize
+        \return samples per block
+    */
+    size_t blockSize() const { return _blockSize; }
+    /*!
+        \brief setBlockSize
+        Applies to blocks started after the call
+        \param n
+    */
+    void setBlockSize(size_t n) { _blockSize = (n < 2) ? 2 : n; }
+
+    /*!
+        \brief size
+        \param n node
+        \return samples held for the node
+    */
+    size_t size(const NodeId& n);
+    /*!
+        \brief nodeCount
+        \return number of nodes with history
+    */
+    size_t nodeCount();
+    /*!
+        \brief memoryUsed
+        \return approximate bytes held by the encoded columns
+    */
+    size_t memoryUsed();
+    /*!
+        \brief memoryUsage
+        \param r
+    */
+    virtual void memoryUsage(MemoryReport& r);
+    /*!
+        \brief clearNode
+        Drop the history of a node
+        \param n
+    */
+    void clearNode(const NodeId& n);
+    /*!
+        \brief clearAll
+    */
+    void clearAll();
+
+    // HistoryDataBackend low level interface
+    virtual UA_StatusCode serverSetHistoryData(Context& c, bool historizing, const UA_DataValue* value);
+    virtual size_t getDateTimeMatch(Context& c, const UA_DateTime timestamp, const MatchStrategy strategy);
+    virtual size_t getEnd(Context& c);
+    virtual size_t lastIndex(Context& c);
+    virtual size_t firstIndex(Context& c);
+    virtual size_t resultSize(Context& c, size_t startIndex, size_t endIndex);
+    virtual UA_StatusCode copyDataValues(Context& c,
+                                         size_t startIndex,
+                                         size_t endIndex,
+                                         UA_Boolean reverse,
+                                         size_t valueSize,
+                                         UA_NumericRange range,
+                                         UA_Boolean releaseContinuationPoints,
+                                         std::string& in,
+                                         std::string& out,
+                                         size_t* providedValues,
+                                         UA_DataValue* values);
+    virtual const UA_DataValue* getDataValue(Context& c, size_t index);
+    virtual UA_Boolean boundSupported(Context& /*c*/) { return UA_TRUE; }
+    virtual UA_Boolean timestampsToReturnSupported(Context& /*c*/, const UA_TimestampsToReturn /*t*/)
+    {
+        return UA_TRUE;
+    }
+    virtual UA_StatusCode insertDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode insertDataValues(Context& c, const UA_DataValue* values, size_t n, UA_StatusCode* results);
+    virtual UA_StatusCode replaceDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode updateDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode removeDataValue(Context& c, UA_DateTime startTimestamp, UA_DateTime endTimestamp);
+};
+
+/*!
+    \brief The CompressedMemoryHistorian class
+    The default gathering and database with a compressed in memory backend
+*/
+class UA_EXPORT CompressedMemoryHistorian : public Historian
+{
+    CompressedHistoryBackend _store;
+
+public:
+    /*!
+        \brief CompressedMemoryHistorian
+        \param numberNodes initial size of the gathering table
+        \param blockSize samples per compressed block
+    */
+    CompressedMemoryHistorian(size_t numberNodes = 100, size_t blockSize = 1024);
+    /*!
+        \brief ~CompressedMemoryHistorian
+        The backend is owned here, not by the C memory backend
+    */
+    virtual ~CompressedMemoryHistorian() { memset(&_backend, 0, sizeof(_backend)); }
+    /*!
+        \brief store
+        \return the backend
+    */
+    CompressedHistoryBackend& store() { return _store; }
+};
+
+}  // namespace Open62541
+
+#endif  // COMPRESSEDHISTORIAN_H
@@ -1,22 +1,95 @@
 #ifndef CONDITION_H
 #define CONDITION_H
 #include <open62541cpp/open62541objects.h>
+#include <unordered_map>
+#include <mutex>
 //
 // Use ccmake to enable - enable advanced mode
 //
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
 namespace Open62541 {
 class Server;
+class ConditionManager;
+class MemoryReport;
 class UA_EXPORT Condition
 {
+    friend class ConditionManager;
     Server& _server;          // owning server
     NodeId _condition;        // condition id
     NodeId _conditionSource;  // parent of the condition
     UA_StatusCode _lastError = 0;
+    std::unordered_map<std::string, NodeId> _fields;  // resolved field variables - keyed on field and property name
+    // active list links - owned by the server's ConditionManager
+    Condition* _activePrev = nullptr;
+    Condition* _activeNext = nullptr;
+    bool _active           = false;
 
 public:
     typedef std::function<bool(Condition&)> ConditionFunc;
 
+    /*!
+        \brief The Transaction class
+        Stages condition field changes and commits them together - the field variables are resolved once per
+        condition and cached, each change is a single value write and the event is triggered once at the end.
+        Setting the same field twice in a transaction only writes the last value. A transaction that is not
+        committed is discarded
+    */
+    class UA_EXPORT Transaction
+    {
+        Condition& _c;
+        std::vector<std::pair<const NodeId*, Variant>> _writes;  // field variable and value
+        UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+        std::string _eventId;  // bytes of the last event id
+        int _active = -1;      // ActiveState/Id staged - 0 or 1
+        void stage(const NodeId* n, const Variant& v);
+
+    public:
+        explicit Transaction(Condition& c)
+            : _c(c)
+        {
+        }
+        /*!
+            \brief setField
+            \param name field browse name
+            \param v
+            \return *this - an unknown field is recorded in lastError and fails the commit
+        */
+        Transaction& setField(const std::string& name, const Variant& v);
+        /*!
+            \brief setProperty
+            \param field
+            \param property
+            \param v
+            \return *this
+        */
+        Transaction& setProperty(const std::string& field, const std::string& property, const Variant& v);
+        /*!
+            \brief commit
+            Write the staged values then trigger the condition event
+            \param trigger false to only write the fields
+            \return true on success - the transaction is empty afterwards either way
+        */
+        bool commit(bool trigger = true);
+        /*!
+            \brief cancel
+            Discard the staged changes
+        */
+        void cancel()
+        {
+            _writes.clear();
+            _lastError = UA_STATUSCODE_GOOD;
+            _active    = -1;
+        }
+        size_t size() const { return _writes.size(); }
+        /*!
+            \brief eventId
+            \return id of the event triggered by the last commit
+        */
+        const std::string& eventId() const { return _eventId; }
+        UA_StatusCode lastError() const { return _lastError; }
+        bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+    };
+
 protected:
     ConditionFunc _enteringEnabledState;
     ConditionFunc _enteringAckedState;
@@ -32,6 +105,19 @@ public:
 
     Server& server() { return _server; }  // owning server
 
+    /*!
+        \brief isActive
+        \return true if the condition is in the server's active list
+    */
+    bool isActive() const { return _active; }
+    /*!
+        \brief markActive
+        Record the active state in the server's active list. Done automatically when ActiveState/Id is written
+        through this object and when the stack reports the active state being entered
+        \param f
+    */
+    void markActive(bool f);
+
     /* Set the value of condition field.
      *
      * @param server The server object
@@ -56,6 +142,24 @@ public:
      * \return
      */
     bool triggerConditionEvent(const std::string& outEventId);
+    /*!
+     * \brief transaction
+     * \return a transaction on this condition
+     */
+    Transaction transaction() { return Transaction(*this); }
+    /*!
+     * \brief fieldNodeId
+     * Resolve a field - or a property of a field - to its variable and cache it
+     * \param field
+     * \param property empty for the field itself
+     * \return the variable or nullptr if there is no such field
+     */
+    const NodeId* fieldNodeId(const std::string& field, const std::string& property = std::string());
+    /*!
+     * \brief clearFieldCache
+     * Forget resolved fields - needed if optional fields are removed
+     */
+    void clearFieldCache() { _fields.clear(); }
     /*!
      * \brief addConditionOptionalField
      * \param conditionType
@@ -157,8 +261,121 @@ private:
     static UA_StatusCode twoStateVariableChangeActiveStateCallback(UA_Server* server, const UA_NodeId* condition);
 };
 
-typedef std::unique_ptr<Condition> ConditionPtr;
+typedef std::shared_ptr<Condition> ConditionPtr;  // shared so a found condition outlives its removal
 typedef Condition* Condition_p;
+
+/*!
+    \brief The ConditionManager class
+    The server's conditions, hashed on condition node id, indexed by source node and with an intrusive list of
+    the active ones - so finding a condition is a hash probe and walking the active alarms, of all sources or
+    of one, costs the number of active conditions rather than the number configured.
+    ConditionRefresh does not use the active list: the method is served by the open62541 stack, which replays
+    the retained conditions to the event items of the calling subscription itself, and the public API has no
+    way to send an event to the items of one subscription only.
+    The visitors are called with the manager locked - they may mark conditions active or inactive but must not
+    add or remove conditions
+*/
+class UA_EXPORT ConditionManager
+{
+    mutable std::recursive_mutex _mutex;
+    UnorderedNodeIdMap<ConditionPtr> _conditions;
+    UnorderedNodeIdMap<std::vector<Condition*>> _sources;
+    Condition* _activeHead = nullptr;
+    size_t _activeCount    = 0;
+
+    void unlink(Condition* c);
+
+public:
+    typedef std::function<void(Condition&)> ConditionVisitor;
+
+    ConditionManager() {}
+    ConditionManager(const ConditionManager&) = delete;
+    ConditionManager& operator=(const ConditionManager&) = delete;
+    ~ConditionManager() { clear(); }
+
+    /*!
+        \brief add
+        Take ownership of a condition - replaces any condition with the same node id
+        \param c
+        \return the condition
+    */
+    Condition* add(ConditionPtr&& c);
+    /*!
+        \brief find
+        \param condition node id
+        \return the condition or a null pointer - never inserts. Holding the returned pointer keeps the condition
+        alive if it is removed meanwhile
+    */
+    ConditionPtr find(const UA_NodeId& condition);
+    /*!
+        \brief remove
+        Delete a condition
+        \param condition
+        \return false if not known
+    */
+    bool remove(const UA_NodeId& condition);
+    /*!
+        \brief clear
+        Delete every condition
+    */
+    void clear();
+    size_t size() const
+    {
+        std::lock_guard<std::recursive_mutex> l(_mutex);
+        return _conditions.size();
+    }
+    size_t activeCount() const
+    {
+        std::lock_guard<std::recursive_mutex> l(_mutex);
+        return _activeCount;
+    }
+    /*!
+        \brief memoryUsage
+        Add the conditions, their resolved fields and the source index as "conditions" - one item per
+        condition with detail
+        \param r
+    */
+    void memoryUsage(MemoryReport& r) const;
+    /*!
+        \brief setActive
+        Add to or remove from the active list
+        \param c
+        \param f
+    */
+    void setActive(Condition* c, bool f);
+    /*!
+        \brief forEach
+        \param f called for every condition
+        \return conditions visited
+    */
+    size_t forEach(const ConditionVisitor& f);
+    /*!
+        \brief forSource
+        \param source
+        \param f called for each condition of the source
+        \return conditions visited
+    */
+    size_t forSource(const UA_NodeId& source, const ConditionVisitor& f);
+    /*!
+        \brief forEachActive
+        \param f called for each active condition - most recently activated first
+        \return conditions visited
+    */
+    size_t forEachActive(const ConditionVisitor& f);
+    /*!
+        \brief forEachActive
+        \param source
+        \param f called for each active condition of the source
+        \return conditions visited
+    */
+    size_t forEachActive(const UA_NodeId& source, const ConditionVisitor& f);
+    /*!
+        \brief active
+        \param l set to the active conditions
+        \param source only those of this source unless null
+    */
+    void active(std::vector<Condition*>& l, const UA_NodeId& source = UA_NODEID_NULL);
+};
 }  // namespace Open62541
 #endif
 #endif  // CONDITION_H
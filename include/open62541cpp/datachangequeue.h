@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef DATACHANGEQUEUE_H
+#define DATACHANGEQUEUE_H
+#include <open62541cpp/monitoreditem.h>
+#include <open62541cpp/spscqueue.h>
+#include <open62541cpp/threadconfig.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Open62541 {
+
+/*!
+    \brief The DataChangeQueue class
+    Hands data changes from the client iterate thread to a consumer thread through a preallocated lock free
+    ring, so a slow consumer does not stall the publish pipeline. The producer takes the value from the
+    stack without copying; the consumer owns it until its handler returns.
+*/
+class UA_EXPORT DataChangeQueue
+{
+public:
+    /*!
+        \brief The OverflowPolicy enum
+        DropNewest discards the incoming value and counts it. Block makes the iterate thread wait for space -
+        lossless but it back pressures the subscription
+    */
+    enum class OverflowPolicy { DropNewest, Block };
+    typedef std::function<void(UA_UInt32 monId, UA_DataValue& value)> Handler;
+
+private:
+    struct Entry {
+        UA_UInt32 monId = 0;
+        UA_DataValue value;
+        Entry() { UA_DataValue_init(&value); }
+    };
+    SpscQueue<Entry> _queue;
+    OverflowPolicy _policy = OverflowPolicy::DropNewest;
+    Handler _handler;
+    std::thread _thread;
+    ThreadConfig _threadConfig;
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _sleeping{false};
+    std::mutex _waitMutex;
+    std::condition_variable _wake;
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _delivered{0};
+
+    void consume();
+    void drain(bool dispatch);
+
+public:
+    /*!
+        \brief DataChangeQueue
+        \param capacity slots preallocated - rounded up to a power of two
+        \param policy what to do when full
+    */
+    DataChangeQueue(size_t capacity = 4096, OverflowPolicy policy = OverflowPolicy::DropNewest)
+        : _queue(capacity)
+        , _policy(policy)
+    {
+    }
+
+    /*!
+        \brief ~DataChangeQueue
+        Stops the consumer and frees anything still queued
+    */
+    ~DataChangeQueue();
+
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the consumer thread - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
+    /*!
+        \brief start
+        \param h called on the consumer thread for each data change
+        \return true if started
+    */
+    bool start(Handler h);
+
+    /*!
+        \brief stop
+        Stops the consumer after it has handled what is already queued
+    */
+    void stop();
+
+    /*!
+        \brief push
+        Producer side - single thread only, normally the client iterate thread
+        \param monId monitored item id
+        \param value value to take - reinitialised when queued
+        \return true if queued
+    */
+    bool push(UA_UInt32 monId, UA_DataValue* value);
+
+    /*!
+        \brief dropped
+        \return values discarded because the queue was full
+    */
+    uint64_t dropped() const { return _dropped; }
+
+    /*!
+        \brief delivered
+        \return values passed to the handler
+    */
+    uint64_t delivered() const { return _delivered; }
+
+    /*!
+        \brief size
+        \return values waiting
+    */
+    size_t size() const { return _queue.size(); }
+
+    /*!
+        \brief capacity
+        \return number of slots
+    */
+    size_t capacity() const { return _queue.capacity(); }
+};
+
+/*!
+    \brief The MonitoredItemQueued class
+    Data change item that pushes its notifications to a DataChangeQueue instead of handling them inline.
+    Many items can share one queue as long as their client is iterated by one thread
+*/
+class UA_EXPORT MonitoredItemQueued : public MonitoredItemDataChange
+{
+    DataChangeQueue& _queue;
+
+public:
+    /*!
+        \brief MonitoredItemQueued
+        \param q queue to feed
+        \param s owning subscription
+    */
+    MonitoredItemQueued(DataChangeQueue& q, ClientSubscription& s)
+        : MonitoredItemDataChange(s)
+        , _queue(q)
+    {
+    }
+
+    /*!
+        \brief dataChangeNotification
+        \param value taken by the queue
+    */
+    virtual void dataChangeNotification(UA_DataValue* value)
+    {
+        if (value) {
+            updateCache(value);  // before the queue takes the value
+            _queue.push(id(), value);
+        }
+    }
+
+    /*!
+        \brief queue
+        \return the queue fed by this item
+    */
+    DataChangeQueue& queue() { return _queue; }
+};
+
+}  // namespace Open62541
+
+#endif  // DATACHANGEQUEUE_H
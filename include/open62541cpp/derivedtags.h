@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef DERIVEDTAGS_H
+#define DERIVEDTAGS_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/nodecontext.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The DerivedTags class
+    Calculated variables recomputed on change. Each derived node names its inputs and a function of their values.
+    Inputs may be plain variables or other derived nodes; the engine orders the derived nodes by dependency and,
+    when inputs change, recomputes only the nodes downstream of them, each once per batch and in order. A result
+    equal to the node's last value is not written and stops the propagation.
+    Plain inputs are watched through a value callback with this object as their node context, so it only works
+    for inputs without a context of their own - for those call changed() from their own write handler. Derived
+    nodes are never watched; add a derived node before the nodes that read it so it is not taken for a plain input.
+    Changes arriving between two server loop iterations form one batch, run on the loop thread through
+    Server::postCommand. Create after the server and destroy before it - the destructor waits for a batch in
+    flight and gives the watched inputs back their null context
+*/
+class UA_EXPORT DerivedTags : public NodeContext
+{
+public:
+    /*!
+        \brief Func
+        Compute a result from the input values, in the order the inputs were given - false to leave the node
+    */
+    typedef std::function<bool(const std::vector<Variant>& inputs, Variant& result)> Func;
+    /*!
+        \brief NumericFunc
+        Numeric form - inputs converted to double, result written as a Double
+    */
+    typedef std::function<double(const std::vector<double>& inputs)> NumericFunc;
+
+private:
+    struct Tag {
+        NodeId node;
+        std::vector<NodeId> inputs;
+        std::vector<int> sources;     // tag of each input, -1 for a plain input - set by order()
+        std::vector<size_t> readers;  // tags with this one as an input - set by order()
+        Func func;
+        unsigned rank = 0;  // longest path from a plain input
+        bool cyclic   = false;
+        bool removed  = false;
+        bool known    = false;  // last holds the written value
+        Variant last;
+    };
+    Server& _server;
+    // the graph - held by add, remove and recompute while calling the server, never taken under _mutex
+    std::mutex _graphMutex;
+    std::vector<Tag> _tags;
+    UnorderedNodeIdMap<size_t> _outputs;               // derived node to tag
+    UnorderedNodeIdMap<std::vector<size_t>> _readers;  // plain input to the tags reading it
+    bool _ordered  = true;
+    size_t _cycles = 0;
+    size_t _live   = 0;
+    // pending changes - short sections, entered from the stack's write path
+    std::mutex _mutex;
+    UnorderedNodeIdMap<Variant> _inputs;  // last value delivered for each plain input
+    std::vector<NodeId> _changed;
+    bool _all       = false;
+    bool _scheduled = false;
+    std::vector<NodeId> _watched;  // inputs given this object as their context - guarded by _graphMutex
+    struct Self {
+        std::mutex mutex;  // held while a posted batch runs
+        DerivedTags* engine = nullptr;
+    };
+    std::shared_ptr<Self> _self;  // posted batches reach the engine through it - cleared by the destructor
+    std::atomic<size_t> _computed{0};
+    std::atomic<size_t> _unchanged{0};
+    std::atomic<size_t> _batches{0};
+
+    void order();
+    void schedule();
+    void recompute();
+    bool input(const NodeId& node, Variant& value);
+
+public:
+    /*!
+        \brief DerivedTags
+        \param s server
+    */
+    DerivedTags(Server& s);
+    DerivedTags(const DerivedTags&) = delete;
+    DerivedTags& operator=(const DerivedTags&) = delete;
+    virtual ~DerivedTags();
+
+    /*!
+        \brief add
+        \param output variable node written with the result
+        \param inputs nodes read - plain variables or other derived nodes
+        \param f
+        \param watch install the change watch on the plain inputs
+        \return false if the output is already derived
+    */
+    bool add(const NodeId& output, const std::vector<NodeId>& inputs, Func f, bool watch = true);
+    /*!
+        \brief addNumeric
+        Inputs that are not numeric scalars leave the node unchanged
+        \param output
+        \param inputs
+        \param f
+        \param watch
+        \return false if the output is already derived
+    */
+    bool addNumeric(const NodeId& output, const std::vector<NodeId>& inputs, NumericFunc f, bool watch = true);
+    /*!
+        \brief remove
+        \param output
+        \return false if not a derived node
+    */
+    bool remove(const NodeId& output);
+    /*!
+        \brief watch
+        Make this the node's context with a value callback so writes to it are seen
+        \param input
+        \return false if the node is derived, has another context or the callback could not be set
+    */
+    bool watch(const NodeId& input);
+    /*!
+        \brief changed
+        Report a change to a plain input - from any thread
+        \param input
+        \param value the new value if known - otherwise it is read when needed
+    */
+    void changed(const UA_NodeId& input, const UA_Variant* value = nullptr);
+    /*!
+        \brief recomputeAll
+        Recompute every derived node in the next batch - e.g. after start up
+    */
+    void recomputeAll();
+
+    /*!
+        \brief writeValue
+        Value callback of watched inputs
+    */
+    void writeValue(Server& server, NodeId& node, const UA_NumericRange* range, const UA_DataValue& value) override;
+
+    /*!
+        \brief size
+        \return number of derived nodes
+    */
+    size_t size()
+    {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        return _live;
+    }
+    /*!
+        \brief cycles
+        \return derived nodes skipped because they depend on themselves - known after the next batch
+    */
+    size_t cycles()
+    {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        return _cycles;
+    }
+    size_t computed() const { return _computed; }    // results written
+    size_t unchanged() const { return _unchanged; }  // results equal to the last value
+    size_t batches() const { return _batches; }
+};
+
+}  // namespace Open62541
+
+#endif  // DERIVEDTAGS_H
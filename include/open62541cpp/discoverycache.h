@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef DISCOVERYCACHE_H
+#define DISCOVERYCACHE_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <open62541cpp/threadconfig.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Open62541 {
+
+/*!
+    \brief The DiscoveryCache class
+    Caches GetEndpoints, FindServers and FindServersOnNetwork results per server URL for a time to live. Misses
+    are fetched through private clients of the cache, so no Client lock is taken and no session is needed;
+    concurrent misses for the same URL share one request and misses for different URLs run in parallel. A
+    background thread can refresh entries that are still in use before they expire, so callers rarely wait on
+    the network.
+    Entries are invalidated explicitly, when a FindServersOnNetwork result shows an mDNS record has changed,
+    and from an in process LDS through serverRegistered() / serverOnNetwork().
+    One cache is shared by the clients of a ClientCache, each holding a DiscoveryCacheRef - see
+    Client::setDiscoveryCache
+*/
+class UA_EXPORT DiscoveryCache
+{
+public:
+    enum Kind { Endpoints = 0, Servers, ServersOnNetwork };
+
+private:
+    /*!
+        \brief The Entry struct
+        One cached result - an array of the kind's type
+    */
+    struct Entry {
+        void* data              = nullptr;
+        size_t length           = 0;
+        const UA_DataType* type = nullptr;
+        UA_DateTime expires     = 0;
+        UA_StatusCode status    = UA_STATUSCODE_GOOD;
+        bool fetching           = false;  // a request is in flight
+        bool used               = false;  // read since the last refresh
+        ~Entry()
+        {
+            if (data)
+                UA_Array_delete(data, length, type);
+        }
+    };
+    typedef std::shared_ptr<Entry> EntryRef;
+    //
+    std::unordered_map<std::string, EntryRef> _entries[3];  // by kind then URL
+    std::unordered_map<std::string, UA_UInt32> _records;     // mDNS record ids by discovery URL
+    mutable std::mutex _mutex;
+    std::condition_variable _fetched;
+    std::mutex _clientMutex;        // guards _idle - not held during a request
+    std::vector<UA_Client*> _idle;  // private clients between fetches - one per request in flight
+    size_t _maxIdle  = 4;           // clients kept for reuse - the rest are deleted after their fetch
+    UA_DateTime _ttl = 60 * UA_DATETIME_SEC;
+    //
+    std::thread _thread;
+    ThreadConfig _threadConfig;
+    std::mutex _threadMutex;
+    std::condition_variable _threadCond;
+    bool _refreshing = false;
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+    std::atomic<UA_StatusCode> _lastError{UA_STATUSCODE_GOOD};
+
+    UA_Client* takeClient();
+    void returnClient(UA_Client* c);
+    UA_StatusCode fetch(Kind k, const std::string& url, void** data, size_t* length);
+    UA_StatusCode get(Kind k, const std::string& url, void** data, size_t* length);
+    void checkRecords(const UA_ServerOnNetwork* s, size_t n);
+    void refreshLoop(unsigned intervalMs);
+
+public:
+    DiscoveryCache();
+    DiscoveryCache(const DiscoveryCache&) = delete;
+    DiscoveryCache& operator=(const DiscoveryCache&) = delete;
+    virtual ~DiscoveryCache();
+
+    /*!
+        \brief setTtl
+        \param ms time to live of an entry
+    */
+    void setTtl(unsigned ms) { _ttl = UA_DateTime(ms) * UA_DATETIME_MSEC; }
+    unsigned ttl() const { return unsigned(_ttl / UA_DATETIME_MSEC); }
+
+    /*!
+        \brief getEndpoints
+        \param serverUrl
+        \param list set to a copy of the endpoints
+        \return status of this call - lastError() may already belong to another caller
+    */
+    UA_StatusCode getEndpoints(const std::string& serverUrl, EndpointDescriptionArray& list);
+    /*!
+        \brief findServers
+        Servers known to an LDS - no URI or locale filter
+        \param serverUrl
+        \param registeredServers set to a copy
+        \return status of this call
+    */
+    UA_StatusCode findServers(const std::string& serverUrl, ApplicationDescriptionArray& registeredServers);
+    /*!
+        \brief findServersOnNetwork
+        Servers known to an LDS-ME - no capability filter. Entries of servers whose mDNS record changed since the
+        last call are invalidated
+        \param serverUrl
+        \param serverOnNetwork set to a copy
+        \return status of this call
+    */
+    UA_StatusCode findServersOnNetwork(const std::string& serverUrl, ServerOnNetworkArray& serverOnNetwork);
+
+    /*!
+        \brief invalidate
+        Drop every entry for a URL
+        \param serverUrl
+    */
+    void invalidate(const std::string& serverUrl);
+    /*!
+        \brief invalidateAll
+    */
+    void invalidateAll();
+    /*!
+        \brief serverRegistered
+        Forward from Server::registerServer of an in process LDS - the server and the LDS lists are invalidated
+        \param s
+    */
+    void serverRegistered(const UA_RegisteredServer* s);
+    /*!
+        \brief serverOnNetwork
+        Forward from Server::serverOnNetwork of an in process LDS-ME
+        \param s
+    */
+    void serverOnNetwork(const UA_ServerOnNetwork* s);
+
+    /*!
+        \brief refresh
+        Fetch again the entries read since the last refresh that expire within a quarter of the time to live.
+        Entries not read are left to expire
+        \return number refreshed
+    */
+    size_t refresh();
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the refresh thread - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
+    /*!
+        \brief startRefresh
+        Run refresh() on a background thread
+        \param intervalMs
+        \return true if started
+    */
+    bool startRefresh(unsigned intervalMs);
+    /*!
+        \brief stopRefresh
+    */
+    void stopRefresh();
+
+    size_t size() const;
+    size_t hits() const { return _hits; }
+    size_t misses() const { return _misses; }
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+/*!
+    \brief DiscoveryCacheRef
+*/
+typedef std::shared_ptr<DiscoveryCache> DiscoveryCacheRef;
+}  // namespace Open62541
+
+#endif  // DISCOVERYCACHE_H
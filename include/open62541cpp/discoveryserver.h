@@ -14,21 +14,46 @@
 */
 
 #include <open62541cpp/open62541objects.h>
+#include <open62541cpp/registrationtable.h>
 namespace Open62541 {
 // LDS (discovery server) object
 /*!
        \brief The DiscoveryServer class
+       Registrations are mirrored in a RegistrationTable for hashed lookup, filtered queries and encoded
+       FindServers responses - the stack keeps its own list to answer FindServers on the wire
 */
 class UA_EXPORT DiscoveryServer
 {
     UA_ServerConfig* _config;
     UA_Server* _server  = nullptr;
     UA_Boolean _running = true;
+    RegistrationTable _registrations;
+    UA_UInt64 _expiryCallbackId = 0;
+
+    static void registerServerCallback(const UA_RegisteredServer* registeredServer, void* data);
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+    static void serverOnNetworkCallback(const UA_ServerOnNetwork* serverOnNetwork,
+                                        UA_Boolean isServerAnnounce,
+                                        UA_Boolean isTxtReceived,
+                                        void* data);
+#endif
+    static void expiryCallback(UA_Server* server, void* data);
 
 public:
     DiscoveryServer(int port, const std::string& url);
     virtual ~DiscoveryServer();
     bool run();
+
+    /*!
+        \brief setRegistrationTimeout
+        \param seconds a server not registering again within this time is removed - 0 never
+    */
+    void setRegistrationTimeout(unsigned seconds);
+    /*!
+        \brief registrations
+        \return the registered servers
+    */
+    RegistrationTable& registrations() { return _registrations; }
 };
 }  // namespace Open62541
 #endif  // DISCOVERYSERVER_H
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef EVENTBINDING_H
+#define EVENTBINDING_H
+#include <open62541cpp/clientsubscription.h>
+#include <algorithm>
+
+namespace Open62541 {
+
+//
+// Conversion of one event field into a struct member - chosen when the field is bound, so decoding an event
+// is one indirect call per field with no switch on the variant type.
+// convert() returns false if the field is of another type; an empty field (not in the event) resets the
+// member. Supported members are the fixed size UA types (UA_DateTime and UA_StatusCode through their
+// aliases), std::string (from String, ByteString, LocalizedText text or QualifiedName name) and NodeId
+//
+template <typename M, typename Enable = void>
+struct event_field;
+
+template <typename M>
+struct event_field<M, typename std::enable_if<ua_type_traits<M>::is_fixed_size>::type> {
+    static bool convert(const UA_Variant& v, void* p)
+    {
+        M& x = *static_cast<M*>(p);
+        if (UA_Variant_isScalar(&v) && ua_type_traits<M>::accepts(v.type)) {
+            x = *static_cast<const M*>(v.data);
+            return true;
+        }
+        x = M();
+        return UA_Variant_isEmpty(&v);
+    }
+};
+
+template <>
+struct event_field<std::string> {
+    static bool convert(const UA_Variant& v, void* p)
+    {
+        std::string& x     = *static_cast<std::string*>(p);
+        const UA_String* s = nullptr;
+        if (UA_Variant_isScalar(&v)) {
+            if ((v.type == &UA_TYPES[UA_TYPES_STRING]) || (v.type == &UA_TYPES[UA_TYPES_BYTESTRING]))
+                s = static_cast<const UA_String*>(v.data);
+            else if (v.type == &UA_TYPES[UA_TYPES_LOCALIZEDTEXT])
+                s = &static_cast<const UA_LocalizedText*>(v.data)->text;
+            else if (v.type == &UA_TYPES[UA_TYPES_QUALIFIEDNAME])
+                s = &static_cast<const UA_QualifiedName*>(v.data)->name;
+        }
+        if (!s) {
+            x.clear();
+            return UA_Variant_isEmpty(&v);
+        }
+        x.assign(reinterpret_cast<const char*>(s->data), s->length);  // keeps the capacity of a reused member
+        return true;
+    }
+};
+
+template <>
+struct event_field<NodeId> {
+    static bool convert(const UA_Variant& v, void* p)
+    {
+        NodeId& x = *static_cast<NodeId*>(p);
+        UA_NodeId_clear(x.ref());
+        if (UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_NODEID]))
+            return UA_NodeId_copy(static_cast<const UA_NodeId*>(v.data), x.ref()) == UA_STATUSCODE_GOOD;
+        return UA_Variant_isEmpty(&v);
+    }
+};
+
+/*!
+    \brief The MonitoredItemEventBinding class
+    Event monitored item that delivers events as batches of structs instead of positional variant arrays.
+    Each bound field is a select clause of the event filter and a member of T with its conversion, both fixed
+    when the field is bound:
+
+        struct Alarm { UA_DateTime time; UA_UInt16 severity; std::string message; NodeId source; };
+        auto* m = new MonitoredItemEventBinding<Alarm>(handler, sub);
+        m->field("Time", &Alarm::time).field("Severity", &Alarm::severity).field("Message", &Alarm::message);
+        m->field("SourceNode", &Alarm::source);
+        m->addEvent(node);
+
+    Events are decoded in place into reused structs - strings keep their capacity - and passed to the
+    handler when the batch is full or when the client iteration that received them completes (runIterate).
+    The struct pointer is only valid in the handler. T must be default constructible
+*/
+template <typename T>
+class MonitoredItemEventBinding : public MonitoredItemEvent
+{
+public:
+    typedef std::function<void(ClientSubscription&, const T*, size_t)> batchFunc;
+    typedef bool (*convertFunc)(const UA_Variant&, void*);
+
+private:
+    /*!
+        \brief The Field struct
+    */
+    struct Field {
+        StdStringArray browsePath;
+        UA_UInt32 attributeId = UA_ATTRIBUTEID_VALUE;
+        NodeId typeDefinition;
+        size_t offset       = 0;  // of the member in T
+        convertFunc convert = nullptr;
+    };
+
+    batchFunc _batchFunc;
+    std::vector<Field> _fields;
+    std::vector<T> _batch;  // decoded events - the first _count are pending
+    size_t _count      = 0;
+    size_t _batchSize  = 256;
+    size_t _mismatches = 0;
+    bool _compiled     = false;
+    bool _queued       = false;  // waiting for the subscription to flush
+
+public:
+    /*!
+        \brief MonitoredItemEventBinding
+        \param f handler of event batches
+        \param s owning subscription
+    */
+    MonitoredItemEventBinding(batchFunc f, ClientSubscription& s)
+        : MonitoredItemEvent(s)
+        , _batchFunc(f)
+    {
+    }
+
+    /*!
+        \brief field
+        Bind the next select clause to a member
+        \param browsePath from the event type - levels separated by '/', e.g. "EnabledState/Id"
+        \param member
+        \param attributeId attribute selected
+        \param typeDefinition event type the path starts at
+        \return this binding
+    */
+    template <typename M>
+    MonitoredItemEventBinding& field(const std::string& browsePath,
+                                     M T::*member,
+                                     UA_UInt32 attributeId        = UA_ATTRIBUTEID_VALUE,
+                                     const NodeId& typeDefinition = NodeId::BaseEventType)
+    {
+        static const T probe{};
+        Field f;
+        for (size_t b = 0, e = 0; b <= browsePath.size(); b = e + 1) {
+            e = browsePath.find('/', b);
+            if (e == std::string::npos)
+                e = browsePath.size();
+            f.browsePath.push_back(browsePath.substr(b, e - b));
+        }
+        const char* base = reinterpret_cast<const char*>(&probe);
+        f.attributeId    = attributeId;
+        f.typeDefinition = typeDefinition;
+        f.offset         = size_t(reinterpret_cast<const char*>(&(probe.*member)) - base);
+        f.convert        = &event_field<M>::convert;
+        _fields.push_back(std::move(f));
+        _compiled = false;
+        return *this;
+    }
+
+    /*!
+        \brief compile
+        Build the select clauses from the bound fields. Called by addEvent if fields changed - call it
+        directly to add a where clause to monitorItem().filter() before addEvent
+    */
+    void compile()
+    {
+        setMonitorItem(nodeId(), _fields.size());
+        for (size_t i = 0; i < _fields.size(); i++) {
+            Field& f = _fields[i];
+            setClause(i, f.browsePath, f.attributeId, f.typeDefinition);
+        }
+        _compiled = true;
+    }
+
+    /*!
+        \brief addEvent
+        \param n node id
+        \param ts timestamp flags
+        \return true on success
+    */
+    virtual bool addEvent(NodeId& n, UA_TimestampsToReturn ts = UA_TIMESTAMPSTORETURN_BOTH)
+    {
+        if (!_compiled || (n != _nodeId)) {
+            _nodeId = n;
+            compile();
+        }
+        return MonitoredItemEvent::addEvent(_nodeId, ts);
+    }
+
+    /*!
+        \brief setBatchSize
+        \param n events passed to the handler at most at once
+    */
+    void setBatchSize(size_t n) { _batchSize = n ? n : 1; }
+
+    /*!
+        \brief mismatches
+        \return fields received with a type their member cannot take - the member is reset
+    */
+    size_t mismatches() const { return _mismatches; }
+
+    /*!
+        \brief eventNotification
+        Decode into the next struct of the batch
+    */
+    virtual void eventNotification(size_t nEventFields, UA_Variant* eventFields)
+    {
+        if (_count == _batch.size())
+            _batch.emplace_back();
+        char* p        = reinterpret_cast<char*>(&_batch[_count++]);
+        const size_t n = std::min(nEventFields, _fields.size());
+        for (size_t i = 0; i < n; i++) {
+            if (!_fields[i].convert(eventFields[i], p + _fields[i].offset))
+                _mismatches++;
+        }
+        if (_count >= _batchSize) {
+            deliver();
+        }
+        else if (!_queued) {
+            _queued = true;
+            subscription().queueEventFlush(this);
+        }
+    }
+
+    /*!
+        \brief flushEvents
+        Pass the pending events to the handler
+    */
+    virtual void flushEvents()
+    {
+        _queued = false;
+        deliver();
+    }
+
+private:
+    void deliver()
+    {
+        if (_count) {
+            const size_t n = _count;
+            _count         = 0;
+            if (_batchFunc)
+                _batchFunc(subscription(), _batch.data(), n);
+        }
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // EVENTBINDING_H
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef EVENTFANOUT_H
+#define EVENTFANOUT_H
+#include <open62541cpp/clientsubscription.h>
+#include <open62541cpp/monitoreditem.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The EventFanout class
+    Client side fanout - shares event monitored items between the consumers of one subscription of one client.
+    Consumers asking for the events of the same node with the same select and where clauses join one item: the
+    server evaluates the filter and sends the fields once per event to this subscription, and the decoded fields
+    are passed to every handler of the group without copying. Nothing is shared across subscriptions or clients,
+    so the server's work per event is not reduced beyond this subscription - there is no server side grouping of
+    identical filters, which would need the stack's event dispatch.
+    A condition refresh is one ConditionRefresh call for the subscription, however many consumers there are -
+    the server replays the retained conditions to each item of the subscription once, as the standard method
+    does, not from an index of the active conditions.
+    Handlers are called on the thread running the client and must not change the fields they are passed. The
+    fanout must be destroyed before its subscription
+*/
+class UA_EXPORT EventFanout
+{
+public:
+    /*!
+        \brief The Clause struct
+        A select clause
+    */
+    struct Clause {
+        std::string browsePath;                         // from the event type - levels separated by '/'
+        UA_UInt32 attributeId = UA_ATTRIBUTEID_VALUE;
+        NodeId typeDefinition = NodeId::BaseEventType;  // event type the path starts at
+    };
+    typedef std::vector<Clause> Select;
+
+private:
+    typedef std::vector<std::pair<unsigned, monitorEventFunc>> Handlers;
+    typedef std::shared_ptr<const Handlers> HandlersRef;  // replaced, not changed, so dispatch takes no lock
+    class Item;
+    /*!
+        \brief The Group struct
+        Consumers of one monitored item
+    */
+    struct Group {
+        std::string key;
+        unsigned item = 0;  // monitored item id in the subscription
+        HandlersRef handlers;
+        std::atomic<size_t> events{0};
+    };
+    typedef std::shared_ptr<Group> GroupPtr;  // shared with the item - a dispatch in flight outlives remove()
+    //
+    ClientSubscription& _subscription;
+    std::map<std::string, GroupPtr> _groups;  // by key
+    std::map<unsigned, Group*> _handlers;     // group of a handler id
+    unsigned _nextId = 0;
+    mutable std::mutex _mutex;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    static std::string keyOf(const NodeId& node, const Select& select, const UA_ContentFilter* where);
+
+public:
+    /*!
+        \brief EventFanout
+        \param s subscription the shared items are added to
+    */
+    EventFanout(ClientSubscription& s)
+        : _subscription(s)
+    {
+    }
+    EventFanout(const EventFanout&) = delete;
+    EventFanout& operator=(const EventFanout&) = delete;
+    ~EventFanout() { clear(); }
+
+    /*!
+        \brief add
+        Register a consumer of events - joins the item of an identical filter or creates one
+        \param node object the events are monitored on - usually the Server object
+        \param select clauses - the fields passed to the handler, in order
+        \param f handler
+        \param where optional where clause - copied
+        \return handler id or 0 on failure
+    */
+    unsigned add(const NodeId& node, const Select& select, monitorEventFunc f, const UA_ContentFilter* where = nullptr);
+    /*!
+        \brief remove
+        Drop a consumer - the item goes with the last consumer of its group
+        \param id from add
+        \return false if not known
+    */
+    bool remove(unsigned id);
+    /*!
+        \brief clear
+        Drop every consumer and item
+    */
+    void clear();
+    /*!
+        \brief refresh
+        Ask the server to send the retained conditions to every event item of the subscription - one call
+        instead of one per consumer. The events arrive between a RefreshStartEvent and a RefreshEndEvent
+        \return true on success
+    */
+    bool refresh();
+
+    size_t groups() const;    //!< shared items
+    size_t handlers() const;  //!< consumers
+    /*!
+        \brief events
+        \param id handler id
+        \return events received by the group of the handler
+    */
+    size_t events(unsigned id) const;
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // EVENTFANOUT_H
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef HISTORYAGGREGATES_H
+#define HISTORYAGGREGATES_H
+#include <open62541cpp/historydatabase.h>
+#include <map>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The HistoryAggregates class
+    ReadProcessed engine. Aggregates are computed in one streaming pass over the values of a history
+    backend - nothing is copied out of the backend beyond the value being looked at.
+    Optionally closed intervals of a fixed rollup size are summarised once and cached so the summary
+    based aggregates over long ranges are built from the summaries rather than the raw values.
+    Summaries are only taken of intervals that end before the newest value, so appends never stale them;
+    call invalidate() after inserting, replacing or removing history.
+    Only numeric scalar values with a good status contribute to an aggregate
+*/
+class UA_EXPORT HistoryAggregates
+{
+public:
+    /*!
+        \brief The Aggregate enum
+    */
+    enum class Aggregate {
+        Average,
+        Minimum,
+        Maximum,
+        Count,
+        TimeAverage,
+        Interpolative,
+        StandardDeviation,  // sample standard deviation
+        Variance            // sample variance
+    };
+
+    /*!
+        \brief The Summary struct
+        Mergeable accumulator of an interval. The mean and the squared deviations from it are updated as in
+        Welford and merged pairwise as in Chan et al., so summaries of parts of a range - cached rollups or
+        partial summaries from parallel reads - combine to the same result as a single pass
+    */
+    struct Summary {
+        size_t count         = 0;  // good numeric samples
+        size_t bad           = 0;  // samples that were skipped
+        double sum           = 0.0;
+        double mean          = 0.0;
+        double m2            = 0.0;  // sum of squared deviations from the mean
+        double minimum       = 0.0;
+        double maximum       = 0.0;
+        UA_DateTime minTime  = 0;
+        UA_DateTime maxTime  = 0;
+        void clear() { *this = Summary(); }
+        void add(UA_DateTime t, double v)
+        {
+            if (!count || (v < minimum)) {
+                minimum = v;
+                minTime = t;
+            }
+            if (!count || (v > maximum)) {
+                maximum = v;
+                maxTime = t;
+            }
+            sum += v;
+            count++;
+            double d = v - mean;
+            mean += d / double(count);
+            m2 += d * (v - mean);
+        }
+        void merge(const Summary& s)
+        {
+            if (s.count) {
+                if (!count || (s.minimum < minimum)) {
+                    minimum = s.minimum;
+                    minTime = s.minTime;
+                }
+                if (!count || (s.maximum > maximum)) {
+                    maximum = s.maximum;
+                    maxTime = s.maxTime;
+                }
+                if (count) {
+                    double na = double(count);
+                    double nb = double(s.count);
+                    double d  = s.mean - mean;
+                    mean += d * (nb / (na + nb));
+                    m2 += s.m2 + d * d * (na * nb / (na + nb));
+                }
+                else {
+                    mean = s.mean;
+                    m2   = s.m2;
+                }
+                sum += s.sum;
+                count += s.count;
+            }
+            bad += s.bad;
+        }
+        /*!
+            \brief variance
+            \return the sample variance, 0 for fewer than two samples
+        */
+        double variance() const { return (count > 1) ? m2 / double(count - 1) : 0.0; }
+    };
+
+private:
+    UA_HistoryDataBackend _backend;  // shallow copy of the backend being read
+    UA_NodeId _session;              // C++ backends need a session id
+    std::mutex _mutex;
+    UA_DateTime _rollup   = 0;  // rollup interval, 0 for none
+    size_t _maxIntervals  = 100000;
+    typedef std::map<UA_DateTime, Summary> Rollups;  // by interval start
+    UnorderedNodeIdMap<Rollups> _rollups;
+    uint64_t _rawValues   = 0;  // values read from the backend
+    uint64_t _rollupsUsed = 0;
+
+    /*!
+        \brief The Sample struct
+        A numeric value from the backend
+    */
+    struct Sample {
+        UA_DateTime time = 0;
+        double value     = 0.0;
+        bool good        = false;
+    };
+    class Cursor;
+
+    static double interpolate(const Sample& a, const Sample& b, UA_DateTime t);
+    void summarise(UA_Server* server, const UA_NodeId& node, UA_DateTime start, UA_DateTime end, Summary& s);
+    bool summary(UA_Server* server, const UA_NodeId& node, UA_DateTime start, UA_DateTime end, Summary& s);
+    UA_StatusCode processRaw(UA_Server* server,
+                             const UA_NodeId& node,
+                             UA_DateTime start,
+                             UA_DateTime end,
+                             UA_DateTime interval,
+                             Aggregate a,
+                             std::vector<DataValue>& out);
+    UA_StatusCode processRollups(UA_Server* server,
+                                 const UA_NodeId& node,
+                                 UA_DateTime start,
+                                 UA_DateTime end,
+                                 UA_DateTime interval,
+                                 Aggregate a,
+                                 std::vector<DataValue>& out);
+
+public:
+    /*!
+        \brief HistoryAggregates
+        \param backend the backend to aggregate - e.g. historian.backend()
+    */
+    HistoryAggregates(const UA_HistoryDataBackend& backend);
+    virtual ~HistoryAggregates();
+
+    /*!
+        \brief toDouble
+        \param v
+        \param d set to the value of a numeric scalar
+        \return true if the value is numeric
+    */
+    static bool toDouble(const UA_DataValue& v, double& d);
+    /*!
+        \brief setResult
+        Set a value to a summary based aggregate - Average, Minimum, Maximum, Count, StandardDeviation or Variance
+        \param d
+        \param t timestamp of the interval
+        \param a
+        \param s
+    */
+    static void setResult(DataValue& d, UA_DateTime t, Aggregate a, const Summary& s);
+
+    /*!
+        \brief aggregateFromNodeId
+        Map a standard aggregate function node id to an aggregate
+        \param n
+        \param a
+        \return true if the aggregate is supported
+    */
+    static bool aggregateFromNodeId(const UA_NodeId& n, Aggregate& a);
+
+    /*!
+        \brief setRollupInterval
+        Summarise closed intervals of this size - processing intervals that are multiples of it, starting
+        on a rollup boundary, are built from the summaries. Drops existing summaries
+        \param ms rollup interval in milliseconds, 0 to disable
+    */
+    void setRollupInterval(UA_Double ms);
+    UA_Double rollupInterval() const { return UA_Double(_rollup) / UA_DATETIME_MSEC; }
+    /*!
+        \brief setMaxIntervals
+        \param n upper bound on the intervals a read may produce
+    */
+    void setMaxIntervals(size_t n) { _maxIntervals = n ? n : 1; }
+    size_t maxIntervals() const { return _maxIntervals; }
+    /*!
+        \brief invalidate
+        Drop summaries overlapping a changed time range of a node
+        \param node
+        \param from
+        \param to
+    */
+    void invalidate(const NodeId& node, UA_DateTime from = UA_INT64_MIN, UA_DateTime to = UA_INT64_MAX);
+    /*!
+        \brief invalidateAll
+    */
+    void invalidateAll();
+
+    // metrics
+    uint64_t rawValues() const { return _rawValues; }
+    uint64_t rollupsUsed() const { return _rollupsUsed; }
+
+    /*!
+        \brief readProcessed
+        Aggregate the history of one node. If end is before start the intervals are returned latest first
+        \param server
+        \param node
+        \param start
+        \param end
+        \param processingInterval interval length in milliseconds, 0 for a single interval
+        \param a aggregate
+        \param out one value per interval, timestamped with the interval start unless the aggregate has
+        a natural timestamp (Minimum, Maximum)
+        \return status
+    */
+    UA_StatusCode readProcessed(Server& server,
+                                const NodeId& node,
+                                UA_DateTime start,
+                                UA_DateTime end,
+                                UA_Double processingInterval,
+                                Aggregate a,
+                                std::vector<DataValue>& out);
+    /*!
+        \brief readProcessed
+        Service form - fill HistoryData results for each node to read
+        \param server
+        \param details aggregate type per node, range and interval
+        \param nodesToReadSize
+        \param nodesToRead
+        \param results allocated array of nodesToReadSize results
+    */
+    void readProcessed(Server& server,
+                       const UA_ReadProcessedDetails& details,
+                       size_t nodesToReadSize,
+                       const UA_HistoryReadValueId* nodesToRead,
+                       UA_HistoryReadResult* results);
+};
+
+}  // namespace Open62541
+
+#endif  // HISTORYAGGREGATES_H
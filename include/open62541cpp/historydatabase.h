@@ -13,6 +13,8 @@
 */
 
 #include <open62541cpp/open62541objects.h>
+#include <open62541cpp/memoryreport.h>
+#include <algorithm>
 namespace Open62541 {
 
 class Server;
@@ -279,6 +281,20 @@ private:
     UA_HistoryDataBackend _database;  // the database structure
     //
     // Define the callbacks
+    /*!
+        \brief toContinuationPoint
+        The stack takes ownership of the continuation point so it must be a heap copy
+        \param s
+        \param b
+    */
+    static void toContinuationPoint(const std::string& s, UA_ByteString* b)
+    {
+        UA_ByteString_init(b);
+        if (!s.empty() && (UA_ByteString_allocBuffer(b, s.size()) == UA_STATUSCODE_GOOD)) {
+            memcpy(b->data, s.data(), s.size());
+        }
+    }
+
     static void _deleteMembers(UA_HistoryDataBackend* backend)
     {
         if (backend && backend->context) {
@@ -350,7 +366,7 @@ private:
                                                   in,
                                                   out,
                                                   result);
-            *outContinuationPoint = UA_BYTESTRING(const_cast<char*>(out.c_str()));
+            toContinuationPoint(out, outContinuationPoint);
             return ret;
         }
         return UA_STATUSCODE_GOOD;  // ignore
@@ -530,7 +546,7 @@ private:
                                                   out,
                                                   providedValues,
                                                   values);
-            *outContinuationPoint = UA_BYTESTRING(const_cast<char*>(out.c_str()));
+            toContinuationPoint(out, outContinuationPoint);
             return ret;
         }
         return 0;
@@ -659,9 +675,207 @@ private:
         return 0;
     }
     //
+    bool _interpolate = false;  // interpolation rather than binary search in getDateTimeMatch
+
 public:
     HistoryDataBackend() { memset(&_database, 0, sizeof(_database)); }
 
+    /*!
+        \brief historyKey
+        \param v
+        \return the timestamp a value is stored under - source, server or now
+    */
+    static UA_DateTime historyKey(const UA_DataValue& v)
+    {
+        if (v.hasSourceTimestamp)
+            return v.sourceTimestamp;
+        if (v.hasServerTimestamp)
+            return v.serverTimestamp;
+        return UA_DateTime_now();
+    }
+
+    /*!
+        \brief historyOrder
+        Order a batch of values for a merge - values without a source timestamp get BADINVALIDTIMESTAMP
+        and repeats of a timestamp within the batch BADENTRYEXISTS
+        \param values
+        \param n
+        \param results set for the values left out
+        \return indexes of the values to store, in time order
+    */
+    static std::vector<size_t> historyOrder(const UA_DataValue* values, size_t n, UA_StatusCode* results)
+    {
+        std::vector<size_t> order;
+        order.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            results[i] = UA_STATUSCODE_GOOD;
+            if (values[i].hasSourceTimestamp)
+                order.push_back(i);
+            else
+                results[i] = UA_STATUSCODE_BADINVALIDTIMESTAMP;
+        }
+        std::stable_sort(order.begin(), order.end(), [values](size_t a, size_t b) {
+            return values[a].sourceTimestamp < values[b].sourceTimestamp;
+        });
+        size_t k = 0;
+        for (size_t i = 0; i < order.size(); i++) {
+            if ((k > 0) && (values[order[i]].sourceTimestamp == values[order[k - 1]].sourceTimestamp))
+                results[order[i]] = UA_STATUSCODE_BADENTRYEXISTS;  // the first one wins
+            else
+                order[k++] = order[i];
+        }
+        order.resize(k);
+        return order;
+    }
+
+    /*!
+        \brief fromBackend
+        \param b backend structure
+        \return the C++ backend behind the structure, nullptr if it is not one of these
+    */
+    static HistoryDataBackend* fromBackend(const UA_HistoryDataBackend& b)
+    {
+        return (b.context && (b.serverSetHistoryData == _serverSetHistoryData))
+                   ? static_cast<HistoryDataBackend*>(b.context)
+                   : nullptr;
+    }
+
+    /*!
+        \brief searchTime
+        Find the first of n time ordered values at or after (or strictly after) a timestamp.
+        Interpolation search suits regularly sampled data - it falls back to bisection after a few probes
+        \param n number of values
+        \param t timestamp
+        \param after true for the first value after t, false for the first value not before t
+        \param timeAt function returning the timestamp of value i
+        \param interpolate use interpolation search
+        \return index, n if there is none
+    */
+    template <typename F>
+    static size_t searchTime(size_t n, UA_DateTime t, bool after, F timeAt, bool interpolate = false)
+    {
+        size_t lo  = 0;
+        size_t hi  = n;  // the answer lies in [lo, hi]
+        int probes = interpolate ? 8 : 0;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if ((probes > 0) && ((hi - lo) > 16)) {
+                probes--;
+                UA_DateTime a = timeAt(lo);
+                UA_DateTime b = timeAt(hi - 1);
+                if (t <= a)
+                    mid = lo;
+                else if ((t > b) || (b <= a))
+                    mid = hi - 1;
+                else
+                    mid = lo + size_t((double(t - a) / double(b - a)) * double(hi - 1 - lo));
+            }
+            UA_DateTime m = timeAt(mid);
+            if (after ? (m <= t) : (m < t))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    /*!
+        \brief matchIndex
+        Apply a match strategy given the bounds of a timestamp in n time ordered values
+        \param n number of values
+        \param lower first value not before the timestamp
+        \param upper first value after the timestamp
+        \param strategy
+        \return index, n if there is no match
+    */
+    static size_t matchIndex(size_t n, size_t lower, size_t upper, const MatchStrategy strategy)
+    {
+        switch (strategy) {
+            case MATCH_EQUAL:
+                return (lower < upper) ? lower : n;
+            case MATCH_EQUAL_OR_AFTER:
+                return lower;
+            case MATCH_AFTER:
+                return upper;
+            case MATCH_EQUAL_OR_BEFORE:
+                return (upper > 0) ? upper - 1 : n;
+            case MATCH_BEFORE:
+                return (lower > 0) ? lower - 1 : n;
+            default:
+                break;
+        }
+        return n;
+    }
+
+    /*!
+        \brief matchTime
+        getDateTimeMatch over any time ordered store
+        \param n number of values
+        \param t timestamp
+        \param strategy
+        \param timeAt function returning the timestamp of value i
+        \param interpolate use interpolation search
+        \return index, n if there is no match
+    */
+    template <typename F>
+    static size_t matchTime(size_t n, UA_DateTime t, const MatchStrategy strategy, F timeAt, bool interpolate = false)
+    {
+        size_t lower = searchTime(n, t, false, timeAt, interpolate);
+        size_t upper = lower;
+        while ((upper < n) && (timeAt(upper) == t))
+            upper++;  // duplicates are rare - no second search
+        return matchIndex(n, lower, upper, strategy);
+    }
+
+    /*!
+        \brief readContinuation
+        Continuation points of the index based backends hold the count of values already returned
+        \param in continuation point
+        \param skip set to the count
+        \return false if the continuation point is not one of ours
+    */
+    static bool readContinuation(const std::string& in, size_t& skip)
+    {
+        skip = 0;
+        if (in.empty())
+            return true;
+        if (in.size() != sizeof(skip))
+            return false;
+        memcpy(&skip, in.data(), sizeof(skip));
+        return true;
+    }
+    /*!
+        \brief writeContinuation
+        \param out continuation point
+        \param next count of values returned so far
+    */
+    static void writeContinuation(std::string& out, size_t next)
+    {
+        out.assign(reinterpret_cast<const char*>(&next), sizeof(next));
+    }
+
+    /*!
+        \brief setInterpolation
+        Use interpolation search in the default getDateTimeMatch
+        \param f
+    */
+    void setInterpolation(bool f) { _interpolate = f; }
+    bool interpolation() const { return _interpolate; }
+
+    /*!
+        \brief indexSize
+        Number of values held for a node in time order. Together with timeAt this gives getDateTimeMatch
+        an O(log n) search without the backend implementing it
+        \return values
+    */
+    virtual size_t indexSize(Context& /*c*/) { return 0; }
+    /*!
+        \brief timeAt
+        \param index
+        \return the key timestamp of the value at index
+    */
+    virtual UA_DateTime timeAt(Context& /*c*/, size_t /*index*/) { return 0; }
+
     void setMemory(size_t nodes = 100, size_t size = 1000000) { _database = UA_HistoryDataBackend_Memory(nodes, size); }
 
     /*!
@@ -705,6 +919,14 @@ public:
     */
     virtual void deleteMembers() {}
 
+    /*!
+        \brief memoryUsage
+        Add the history held as "history" - one item per node with detail. Register with
+        Server::addMemorySource to include it in the server's report
+        \param r
+    */
+    virtual void memoryUsage(MemoryReport& /*r*/) {}
+
     /*  This function sets a DataValue for a node in the historical data storage.
 
         server is the server the node lives in.
@@ -768,9 +990,12 @@ public:
         nodeId is the node id of the node for which the matching value shall be found.
         timestamp is the timestamp of the requested index.
         strategy is the matching strategy which shall be applied in finding the index. */
-    virtual size_t getDateTimeMatch(Context& c, const UA_DateTime /*timestamp*/, const MatchStrategy /*strategy*/)
+    virtual size_t getDateTimeMatch(Context& c, const UA_DateTime timestamp, const MatchStrategy strategy)
     {
-        return 0;
+        size_t n = indexSize(c);
+        if (!n)
+            return 0;
+        return matchTime(n, timestamp, strategy, [this, &c](size_t i) { return timeAt(c, i); }, _interpolate);
     }
 
     /*  This function is part of the low level HistoryRead API. It returns the
@@ -886,6 +1111,23 @@ public:
         \return
     */
     virtual UA_StatusCode insertDataValue(Context& /*c*/, const UA_DataValue* /*value*/) { return 0; }
+    /*!
+        \brief insertDataValues
+        Bulk insert of values in any order. The default inserts them one at a time - backends override
+        this to sort and merge the whole batch in one pass
+        \param c
+        \param values
+        \param n number of values
+        \param results set to the status of each value
+        \return status of the call
+    */
+    virtual UA_StatusCode insertDataValues(Context& c, const UA_DataValue* values, size_t n, UA_StatusCode* results)
+    {
+        for (size_t i = 0; i < n; i++) {
+            results[i] = insertDataValue(c, &values[i]);
+        }
+        return UA_STATUSCODE_GOOD;
+    }
     /*!
         \brief replaceDataValue
         \return
@@ -908,7 +1150,7 @@ public:
 
 class HistoryDatabase
 {
-
+public:
     struct Context {
         Server& server;
         NodeId sessionId;
@@ -917,6 +1159,7 @@ class HistoryDatabase
         Context(UA_Server* s, const UA_NodeId* sId, void* sContext, const UA_NodeId* nId);
     };
 
+private:
     UA_HistoryDatabase _database;
     //
     static void _deleteMembers(UA_HistoryDatabase* hdb)
@@ -1034,10 +1277,24 @@ class HistoryDatabase
     }
 
 public:
-    HistoryDatabase() {}
+    HistoryDatabase() { memset(&_database, 0, sizeof(_database)); }
 
     virtual ~HistoryDatabase() {}
 
+    /*!
+        \brief initialise
+        map to class methods
+    */
+    void initialise()
+    {
+        _database.context           = this;
+        _database.clear             = _deleteMembers;
+        _database.setValue          = _setValue;
+        _database.readRaw           = _readRaw;
+        _database.updateData        = _updateData;
+        _database.deleteRawModified = _deleteRawModified;
+    }
+
     UA_HistoryDatabase& database() { return _database; }
 
     virtual void deleteMembers() {}
@@ -1121,6 +1378,7 @@ protected:
     UA_HistoryDatabase _database;
     UA_HistoryDataBackend _backend;
     UA_HistoryDataGathering _gathering;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
 
 public:
     Historian()
@@ -1140,6 +1398,20 @@ public:
     UA_HistoryDataGathering& gathering() { return _gathering; }
     UA_HistoryDataBackend& backend() { return _backend; }
 
+    /*!
+        \brief setGathering
+        Replace the gathering, rebuilding the default database around it - call before the server uses the database
+        e.g. historian.setGathering(batched.gathering())
+        \param g
+    */
+    void setGathering(const UA_HistoryDataGathering& g)
+    {
+        if (_database.context && _database.clear)
+            _database.clear(&_database);  // also clears the old gathering
+        _gathering = g;
+        _database  = UA_HistoryDatabase_default(_gathering);
+    }
+
     bool setUpdateNode(NodeId& nodeId,
                        Server& server,
                        size_t responseSize = 100,
@@ -1155,6 +1427,32 @@ public:
                      size_t responseSize = 100,
                      size_t pollInterval = 1000,
                      void* context       = nullptr);
+
+    /*!
+        \brief reserve
+        Preallocate backend storage for a number of nodes - nothing by default. The stack's gathering table
+        is sized by the numberNodes argument of the historian, so make that the node count too
+        \param nodes
+    */
+    virtual void reserve(size_t /*nodes*/) {}
+    /*!
+        \brief registerNodes
+        Register many nodes with one setting - storage is reserved for them all first
+        \param nodes
+        \param server
+        \param strategy how values are gathered
+        \param responseSize
+        \param pollInterval
+        \param context
+        \return nodes registered - lastError holds the first failure
+    */
+    size_t registerNodes(const std::vector<NodeId>& nodes,
+                         Server& server,
+                         UA_HistorizingUpdateStrategy strategy = UA_HISTORIZINGUPDATESTRATEGY_VALUESET,
+                         size_t responseSize                   = 100,
+                         size_t pollInterval                   = 1000,
+                         void* context                         = nullptr);
+    UA_StatusCode lastError() const { return _lastError; }
 };
 
 /*!
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef HISTORYREADER_H
+#define HISTORYREADER_H
+#include <open62541cpp/open62541client.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The HistoryReader class
+    Pull style reader of raw history for one or more nodes. Values are read a page at a time, following
+    the server's continuation points, so memory is bounded by two pages whatever the range. Several nodes
+    are batched into each HistoryRead request and, with prefetch on, the next page is requested as soon as
+    the current one is handed out so the round trip overlaps with the caller's processing.
+
+        Open62541::HistoryReader r(client, nodes, start, end, 1000);
+        Open62541::HistoryReader::Value v;
+        while (r.next(v))
+            write(nodes[v.node], v.value);
+
+    By default next() pumps the client (runIterate) while it waits. If another thread already runs the
+    client call setPump(false) and next() just waits for the completion.
+    The reader must not outlive the client. Continuation points still held are released on destruction
+*/
+class UA_EXPORT HistoryReader
+{
+public:
+    /*!
+        \brief The Value struct
+        A history value and the index of its node in the node list
+    */
+    struct Value {
+        size_t node = 0;
+        DataValue value;
+    };
+
+private:
+    struct State;  // shared with the completions of requests in flight
+    std::shared_ptr<State> _state;
+    std::vector<Value> _current;  // page being handed out
+    size_t _position   = 0;
+    bool _prefetch     = true;
+    bool _pump         = true;
+    unsigned _timeout  = 30000;  // ms to wait for a page
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    bool fill();
+
+public:
+    /*!
+        \brief HistoryReader
+        \param client connected client
+        \param nodes nodes to read
+        \param startTime start of range
+        \param endTime end of range
+        \param pageSize values per node per request - numValuesPerNode
+        \param nodesPerRequest nodes batched into one request
+        \param returnBounds return bounding values
+        \param timestampsToReturn
+    */
+    HistoryReader(Client& client,
+                  const std::vector<NodeId>& nodes,
+                  UA_DateTime startTime,
+                  UA_DateTime endTime,
+                  unsigned pageSize                        = 1000,
+                  size_t nodesPerRequest                   = 16,
+                  bool returnBounds                        = false,
+                  UA_TimestampsToReturn timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH);
+    virtual ~HistoryReader();
+
+    /*!
+        \brief next
+        \param v set to the next value
+        \return false at the end of the history or on error - check lastOK()
+    */
+    bool next(Value& v);
+    /*!
+        \brief nextPage
+        Hand out the rest of the current page, fetching a page if it is empty
+        \param page set to the values
+        \return false at the end of the history or on error
+    */
+    bool nextPage(std::vector<Value>& page);
+    /*!
+        \brief cancel
+        Stop reading and release the continuation points held by the server
+    */
+    void cancel();
+
+    /*!
+        \brief setPrefetch
+        \param f request the next page while the current one is consumed
+    */
+    void setPrefetch(bool f) { _prefetch = f; }
+    bool prefetch() const { return _prefetch; }
+    /*!
+        \brief setPump
+        \param f run the client while waiting - false if another thread runs it
+    */
+    void setPump(bool f) { _pump = f; }
+    bool pump() const { return _pump; }
+    /*!
+        \brief setTimeout
+        \param ms time to wait for a page
+    */
+    void setTimeout(unsigned ms) { _timeout = ms; }
+    unsigned timeout() const { return _timeout; }
+
+    /*!
+        \brief status
+        \param node index into the node list
+        \return the last result status of the node
+    */
+    UA_StatusCode status(size_t node) const;
+    /*!
+        \brief requests
+        \return HistoryRead requests sent
+    */
+    size_t requests() const;
+    /*!
+        \brief valuesRead
+        \return values received
+    */
+    uint64_t valuesRead() const;
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // HISTORYREADER_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef INSTANCETEMPLATE_H
+#define INSTANCETEMPLATE_H
+#include <open62541cpp/open62541objects.h>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The InstanceTemplate class
+    Flattened copy of the mandatory children of an object type, its supertypes included, taken once by
+    browsing the type. instantiate() stamps an instance out of it: the object and every child are added with
+    UA_Server_addNode_begin from the prebuilt attributes, then finished leaves first. When the stack finishes
+    the instance it finds the children already in place, so the type is not walked and copied per instance.
+    Children get server assigned ids in the namespace of their parent. As when the stack copies a type, each
+    child shares the node context of its instance declaration and keeps its data source or value callbacks.
+    Rebuild the template after the type changes, its bindings included
+*/
+class UA_EXPORT InstanceTemplate
+{
+public:
+    static constexpr size_t Root = size_t(~size_t(0));  //!< parent of the top level children - the instance
+
+    /*!
+        \brief The Entry struct
+        One child - entries are ordered so a parent comes before its children
+    */
+    struct Entry {
+        size_t parent          = Root;
+        UA_NodeClass nodeClass = UA_NODECLASS_UNSPECIFIED;
+        NodeId referenceType;
+        NodeId typeDefinition;
+        QualifiedName browseName;
+        VariableAttributes variable;  // variables
+        ObjectAttributes object;      // objects
+        // bindings of the instance declaration - given to every instance of it
+        void* context                  = nullptr;  // not owned - usually a NodeContext
+        UA_ValueSource valueSource     = UA_VALUESOURCE_DATA;
+        UA_DataSource dataSource       = {nullptr, nullptr};
+        UA_ValueCallback valueCallback = {nullptr, nullptr};
+    };
+
+private:
+    NodeId _typeId;
+    std::vector<Entry> _entries;
+    bool _valid = false;
+
+    void collect(UA_Server* s, const UA_NodeId& node, size_t parent);
+
+public:
+    /*!
+        \brief build
+        Browse the type - takes the server lock
+        \param s server
+        \param typeId object type
+        \return true on success
+    */
+    bool build(Server& s, const NodeId& typeId);
+
+    /*!
+        \brief instantiate
+        Add an instance - call with the server write lock held
+        \param s server
+        \param requestedId requested id of the instance - null for a server assigned id
+        \param parent
+        \param referenceType from the parent
+        \param browseName
+        \param attr object attributes of the instance
+        \param context node context of the instance
+        \param out set to the id of the instance - may be null
+        \return status code - a partly built instance is deleted
+    */
+    UA_StatusCode instantiate(UA_Server* s,
+                              const UA_NodeId& requestedId,
+                              const UA_NodeId& parent,
+                              const UA_NodeId& referenceType,
+                              const UA_QualifiedName& browseName,
+                              const UA_ObjectAttributes& attr,
+                              void* context,
+                              UA_NodeId* out);
+
+    /*!
+        \brief clear
+    */
+    void clear()
+    {
+        _entries.clear();
+        _valid = false;
+    }
+
+    bool valid() const { return _valid; }
+    const NodeId& typeId() const { return _typeId; }
+    size_t size() const { return _entries.size(); }
+    const std::vector<Entry>& entries() const { return _entries; }
+};
+
+}  // namespace Open62541
+#endif  // INSTANCETEMPLATE_H
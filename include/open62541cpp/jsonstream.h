@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+#include <open62541cpp/open62541objects.h>
+#include <stdint.h>
+
+namespace Open62541 {
+
+/*!
+    \brief The JsonWriter class
+    Streaming JSON writer - text is appended straight to a buffer that is kept between documents, so
+    writing a document once the buffer has grown to size makes no allocations. Separators are inserted
+    as values and keys are written; the caller keeps the objects and arrays balanced.
+    Variants are written in the reversible form of OPC UA Part 6 - {"Type":<built in type id>,"Body":..,
+    "Dimensions":[..]} - so the type survives a round trip through JsonReader::variant
+*/
+class UA_EXPORT JsonWriter
+{
+    std::string _buffer;
+    std::vector<bool> _empty;  // per open object or array - nothing written in it yet
+    bool _key = false;         // a key has been written and waits for its value
+
+    void separator();
+    void escaped(const char* s, size_t n);
+    bool body(const void* p, const UA_DataType* t);
+
+public:
+    /*!
+        \brief JsonWriter
+        \param reserve initial buffer size
+    */
+    explicit JsonWriter(size_t reserve = 4096) { _buffer.reserve(reserve); }
+
+    /*!
+        \brief clear
+        Start a new document - the buffer keeps its capacity
+    */
+    void clear()
+    {
+        _buffer.clear();
+        _empty.clear();
+        _key = false;
+    }
+    /*!
+        \brief str
+        \return the document so far
+    */
+    const std::string& str() const { return _buffer; }
+    const char* data() const { return _buffer.data(); }
+    size_t size() const { return _buffer.size(); }
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    /*!
+        \brief key
+        Member name - the next value written is its value
+        \param k
+        \param n length of k
+        \return *this
+    */
+    JsonWriter& key(const char* k, size_t n);
+    JsonWriter& key(const char* k) { return key(k, strlen(k)); }
+    JsonWriter& key(const std::string& k) { return key(k.data(), k.size()); }
+    JsonWriter& null();
+    JsonWriter& boolean(bool f);
+    JsonWriter& number(int64_t v);
+    JsonWriter& number(uint64_t v);
+    JsonWriter& number(int v) { return number(int64_t(v)); }
+    JsonWriter& number(unsigned v) { return number(uint64_t(v)); }
+    /*!
+        \brief number
+        Shortest text that reads back to the same double - NaN and infinities are written as the strings
+        "NaN", "Infinity" and "-Infinity" as in Part 6
+        \param v
+        \return *this
+    */
+    JsonWriter& number(double v);
+    JsonWriter& string(const char* s, size_t n);
+    JsonWriter& string(const char* s) { return string(s, strlen(s)); }
+    JsonWriter& string(const std::string& s) { return string(s.data(), s.size()); }
+    JsonWriter& string(const UA_String& s) { return string(reinterpret_cast<const char*>(s.data), s.length); }
+    /*!
+        \brief raw
+        Append a value that is already JSON text
+        \param s
+        \param n
+        \return *this
+    */
+    JsonWriter& raw(const char* s, size_t n);
+
+    /*!
+        \brief variant
+        Write a variant as {"Type":..,"Body":..} - arrays of a built in type are written element by element
+        straight from the variant's data. Boolean, the integer and floating point types, StatusCode, String,
+        ByteString (base64) and DateTime (ISO 8601) are supported
+        \param v
+        \return false if the type is not supported - the body is written as null
+    */
+    bool variant(const UA_Variant& v);
+    bool variant(const Variant& v) { return variant(*v.constRef()); }
+    /*!
+        \brief scalar
+        Write the body of one built in value
+        \param p value
+        \param t its type
+        \return false if the type is not supported - null is written
+    */
+    bool scalar(const void* p, const UA_DataType* t);
+};
+
+/*!
+    \brief The JsonReader class
+    Pull parser over a JSON document held by the caller - there is no DOM, values are read straight into
+    the caller's variables and strings into a buffer the caller reuses. Any syntax error stops the reader;
+    ok() is then false and every further read fails.
+    Objects are read with beginObject() followed by member() until it returns false, arrays with
+    beginArray() and element() in the same way
+*/
+class UA_EXPORT JsonReader
+{
+public:
+    enum class Type { Invalid, Object, Array, String, Number, Boolean, Null };
+
+private:
+    const char* _p   = nullptr;
+    const char* _end = nullptr;
+    bool _ok         = true;
+    std::vector<bool> _first;  // per open object or array - no member read yet
+
+    void space();
+    bool fail()
+    {
+        _ok = false;
+        return false;
+    }
+    bool expect(char c);
+    bool literal(const char* s, size_t n);
+    bool numberText(char* b, size_t n);
+    bool array(const UA_DataType* t, UA_Variant& v);
+    bool value(const UA_DataType* t, void* p);
+
+public:
+    JsonReader() {}
+    /*!
+        \brief JsonReader
+        \param s document - not copied, must outlive the reader
+        \param n length
+    */
+    JsonReader(const char* s, size_t n) { reset(s, n); }
+    explicit JsonReader(const std::string& s) { reset(s.data(), s.size()); }
+    explicit JsonReader(const std::string&&) = delete;  // the document must outlive the reader
+
+    /*!
+        \brief reset
+        Start reading another document
+        \param s
+        \param n
+    */
+    void reset(const char* s, size_t n)
+    {
+        _p   = s;
+        _end = s + n;
+        _ok  = (s != nullptr) || !n;
+        _first.clear();
+    }
+    /*!
+        \brief ok
+        \return false after a syntax error
+    */
+    bool ok() const { return _ok; }
+    /*!
+        \brief atEnd
+        \return true if only white space is left
+    */
+    bool atEnd();
+    /*!
+        \brief peek
+        \return the type of the next value
+    */
+    Type peek();
+
+    bool beginObject();
+    /*!
+        \brief member
+        Move to the next member of the object being read
+        \param key set to its name
+        \return false at the end of the object
+    */
+    bool member(std::string& key);
+    bool beginArray();
+    /*!
+        \brief element
+        Move to the next element of the array being read
+        \return false at the end of the array
+    */
+    bool element();
+
+    bool null();
+    bool boolean(bool& f);
+    bool number(double& v);  // also takes "NaN", "Infinity" and "-Infinity"
+    bool number(int64_t& v);
+    bool number(uint64_t& v);
+    bool string(std::string& s);
+    /*!
+        \brief skip
+        Step over the next value, of any type
+        \return false on a syntax error
+    */
+    bool skip();
+
+    /*!
+        \brief variant
+        Read a variant written by JsonWriter::variant - members may come in any order
+        \param v set to the value - cleared first
+        \return false on a syntax error or an unsupported type
+    */
+    bool variant(UA_Variant& v);
+    bool variant(Variant& v) { return variant(*v.ref()); }
+};
+
+}  // namespace Open62541
+
+#endif  // JSONSTREAM_H
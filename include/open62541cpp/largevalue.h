@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef LARGEVALUE_H
+#define LARGEVALUE_H
+#include <open62541cpp/open62541client.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The LargeValue class
+    Reads and writes values too big for one message - multi megabyte arrays and ByteStrings - in IndexRange
+    chunks. Several chunks are kept in flight so the transfer runs at the channel's bandwidth rather than one
+    round trip per chunk, and each request stays small so other requests on the channel are not held up
+    behind it. Read chunks are copied straight into a caller supplied buffer.
+
+        std::vector<UA_Float> table(1 << 22);
+        size_t n = 0;
+        Open62541::LargeValue v(client);
+        if (v.read(node, &UA_TYPES[UA_TYPES_FLOAT], table.data(), table.size(), n))
+            table.resize(n);
+
+    Values are one dimensional arrays of a fixed size type - numbers, DateTime, Guid - or a scalar ByteString
+    or String, which the server ranges by byte. The value is not read atomically: if it changes during a
+    transfer the chunks may come from different versions. Writes only replace elements - the variable must
+    already hold an array at least as long, as a range cannot grow a value.
+    By default the calls pump the client (runIterate) while they wait. If another thread already runs the
+    client call setPump(false). The object must not outlive the client
+*/
+class UA_EXPORT LargeValue
+{
+    struct State;  // shared with the completions of requests in flight
+    Client& _client;
+    size_t _chunkBytes = 256 * 1024;
+    unsigned _inFlight = 4;
+    bool _pump         = true;
+    unsigned _timeout  = 30000;  // ms to wait for a chunk
+    size_t _requests   = 0;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    bool transfer(const std::shared_ptr<State>& st);
+    static bool send(const std::shared_ptr<State>& st, size_t chunk);
+
+public:
+    /*!
+        \brief LargeValue
+        \param client connected client
+        \param chunkBytes bytes per request - keep well under the channel's message size
+        \param inFlight requests outstanding at once
+    */
+    LargeValue(Client& client, size_t chunkBytes = 256 * 1024, unsigned inFlight = 4);
+    LargeValue(const LargeValue&) = delete;
+    LargeValue& operator=(const LargeValue&) = delete;
+    virtual ~LargeValue() {}
+
+    /*!
+        \brief read
+        \param node variable to read
+        \param type element type - UA_TYPES_BYTESTRING or UA_TYPES_STRING for a scalar read by byte
+        \param buffer receives the elements
+        \param capacity elements the buffer holds
+        \param length set to the elements read
+        \return false on error - BADOUTOFRANGE if the value does not fit the buffer, BADTYPEMISMATCH if it
+        does not hold the type
+    */
+    bool read(const NodeId& node, const UA_DataType* type, void* buffer, size_t capacity, size_t& length);
+    /*!
+        \brief write
+        \param node variable to write
+        \param type element type - UA_TYPES_BYTESTRING or UA_TYPES_STRING for a scalar written by byte
+        \param data elements to write
+        \param length elements in data
+        \param offset index of the first element replaced
+        \return false on error - chunks written before the error stay written
+    */
+    bool write(const NodeId& node, const UA_DataType* type, const void* data, size_t length, size_t offset = 0);
+
+    /*!
+        \brief setChunkBytes
+        \param n bytes per request - rounded down to whole elements
+    */
+    void setChunkBytes(size_t n) { _chunkBytes = n ? n : 1; }
+    size_t chunkBytes() const { return _chunkBytes; }
+    /*!
+        \brief setInFlight
+        \param n requests outstanding at once
+    */
+    void setInFlight(unsigned n) { _inFlight = n ? n : 1; }
+    unsigned inFlight() const { return _inFlight; }
+    /*!
+        \brief setPump
+        \param f run the client while waiting - false if another thread runs it
+    */
+    void setPump(bool f) { _pump = f; }
+    bool pump() const { return _pump; }
+    /*!
+        \brief setTimeout
+        \param ms time to wait for the next chunk to complete
+    */
+    void setTimeout(unsigned ms) { _timeout = ms; }
+    unsigned timeout() const { return _timeout; }
+
+    size_t requests() const { return _requests; }  // chunk requests sent
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // LARGEVALUE_H
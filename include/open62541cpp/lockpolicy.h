@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef LOCKPOLICY_H
+#define LOCKPOLICY_H
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+//
+// The lock types used by the Server, Client, PropertyTree and the other shared structures - chosen for the
+// whole build by the UA_CPP_LOCK_POLICY CMake option, which defines one of:
+//
+//  (none)                      boost::shared_mutex - the default
+//  UA_CPP_LOCK_POLICY_STD      std::shared_timed_mutex
+//  UA_CPP_LOCK_POLICY_SPIN     SpinSharedMutex - for short critical sections on few cores
+//  UA_CPP_LOCK_POLICY_NONE     NullMutex - single threaded applications; the locks compile to nothing
+//
+// UA_CPP_LOCK_PROFILING replaces the default policy with the profiled lock types - see LockProfiler.
+// The policy changes the layout of every class holding a ReadWriteMutex, so applications must be built with
+// the same definitions as the library
+//
+#if defined(UA_CPP_LOCK_POLICY_STD) + defined(UA_CPP_LOCK_POLICY_SPIN) + defined(UA_CPP_LOCK_POLICY_NONE) > 1
+#error "Define at most one UA_CPP_LOCK_POLICY"
+#endif
+#if defined(UA_CPP_LOCK_PROFILING) && \
+    (defined(UA_CPP_LOCK_POLICY_STD) || defined(UA_CPP_LOCK_POLICY_SPIN) || defined(UA_CPP_LOCK_POLICY_NONE))
+#error "UA_CPP_LOCK_PROFILING profiles the default lock policy only"
+#endif
+
+#if defined(UA_CPP_LOCK_PROFILING)
+#include <open62541cpp/lockprofiler.h>
+#elif defined(UA_CPP_LOCK_POLICY_STD) || defined(UA_CPP_LOCK_POLICY_SPIN)
+#include <shared_mutex>
+#elif !defined(UA_CPP_LOCK_POLICY_NONE)
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+#endif
+
+namespace Open62541 {
+
+/*!
+    \brief The NullMutex class
+    Shared mutex that does nothing - for builds with one thread
+*/
+class NullMutex
+{
+public:
+    NullMutex() = default;
+    NullMutex(const NullMutex&) = delete;
+    NullMutex& operator=(const NullMutex&) = delete;
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+    void lock_shared() {}
+    void unlock_shared() {}
+    bool try_lock_shared() { return true; }
+};
+
+/*!
+    \brief The NullLock class
+    Read or write lock of a NullMutex - holds no state, so the compiler removes it entirely
+*/
+class NullLock
+{
+public:
+    NullLock() = default;
+    explicit NullLock(NullMutex&) {}
+    template <typename Tag>
+    NullLock(NullMutex&, Tag)  // deferred, adopted or try - all the same
+    {
+    }
+    void lock() {}
+    void unlock() {}
+    bool try_lock() { return true; }
+    bool owns_lock() const { return true; }
+    explicit operator bool() const { return true; }
+};
+
+/*!
+    \brief The SpinSharedMutex class
+    Reader writer spin lock in one atomic word - the top bit is the writer, the rest count readers. Waiters
+    yield after a short spin. Writers are not preferred, so a steady stream of readers can hold a writer off;
+    use it where critical sections are a few hundred instructions at most
+*/
+class SpinSharedMutex
+{
+    static constexpr uint32_t Writer = 0x80000000u;
+    std::atomic<uint32_t> _state{0};
+
+    static void pause(unsigned& n)
+    {
+        if (++n > 64) {
+            n = 0;
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    SpinSharedMutex() = default;
+    SpinSharedMutex(const SpinSharedMutex&) = delete;
+    SpinSharedMutex& operator=(const SpinSharedMutex&) = delete;
+
+    bool try_lock()
+    {
+        uint32_t s = 0;
+        return _state.compare_exchange_strong(s, Writer, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+    void lock()
+    {
+        unsigned n = 0;
+        while (!try_lock()) {
+            while (_state.load(std::memory_order_relaxed))
+                pause(n);
+        }
+    }
+    void unlock() { _state.store(0, std::memory_order_release); }
+
+    bool try_lock_shared()
+    {
+        uint32_t s = _state.load(std::memory_order_relaxed);
+        return !(s & Writer) &&
+               _state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+    void lock_shared()
+    {
+        unsigned n = 0;
+        while (!try_lock_shared())
+            pause(n);
+    }
+    void unlock_shared() { _state.fetch_sub(1, std::memory_order_release); }
+};
+
+#if defined(UA_CPP_LOCK_PROFILING)
+typedef ProfiledMutex ReadWriteMutex;
+typedef ProfiledReadLock ReadLock;
+typedef ProfiledWriteLock WriteLock;
+typedef boost::defer_lock_t DeferLock;
+#elif defined(UA_CPP_LOCK_POLICY_STD)
+typedef std::shared_timed_mutex ReadWriteMutex;
+typedef std::shared_lock<ReadWriteMutex> ReadLock;
+typedef std::unique_lock<ReadWriteMutex> WriteLock;
+typedef std::defer_lock_t DeferLock;
+#elif defined(UA_CPP_LOCK_POLICY_SPIN)
+typedef SpinSharedMutex ReadWriteMutex;
+typedef std::shared_lock<ReadWriteMutex> ReadLock;
+typedef std::unique_lock<ReadWriteMutex> WriteLock;
+typedef std::defer_lock_t DeferLock;
+#elif defined(UA_CPP_LOCK_POLICY_NONE)
+typedef NullMutex ReadWriteMutex;
+typedef NullLock ReadLock;
+typedef NullLock WriteLock;
+typedef std::defer_lock_t DeferLock;
+#else
+typedef boost::shared_mutex ReadWriteMutex;
+typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+typedef boost::defer_lock_t DeferLock;
+#endif
+
+}  // namespace Open62541
+
+#endif  // LOCKPOLICY_H
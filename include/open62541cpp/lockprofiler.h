@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef LOCKPROFILER_H
+#define LOCKPROFILER_H
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define UA_CPP_NOINLINE __attribute__((noinline))
+#define UA_CPP_CALL_SITE() __builtin_return_address(0)
+#else
+#define UA_CPP_NOINLINE
+#define UA_CPP_CALL_SITE() nullptr
+#endif
+
+namespace Open62541 {
+
+/*!
+    \brief The LockProfiler class
+    Wait and hold times of ProfiledMutex locks, by mutex and acquiring call site.
+    Contended acquisitions are always recorded; uncontended ones one in sampleRate() per thread, so the
+    fast path costs a try_lock and a thread local counter. Hold times are kept for exclusive locks only.
+    The profiled lock types replace ReadWriteMutex, ReadLock and WriteLock when the library and its users are
+    built with UA_CPP_LOCK_PROFILING defined - see propertytree.h. Call sites are reported as module and offset;
+    link with -rdynamic for function names or resolve the offsets with addr2line
+*/
+class LockProfiler
+{
+public:
+    /*!
+        \brief The Site struct
+        Totals of one call site of one mutex
+    */
+    struct Site {
+        const void* mutex   = nullptr;
+        const void* site    = nullptr;  // return address in the function that took the lock
+        bool shared         = false;
+        uint64_t samples    = 0;  // recorded acquisitions
+        uint64_t contended  = 0;  // acquisitions that had to wait
+        uint64_t waitNs     = 0;
+        uint64_t maxWaitNs  = 0;
+        uint64_t holdNs     = 0;
+        uint64_t maxHoldNs  = 0;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    /*!
+        \brief record
+        \param mutex
+        \param site
+        \param shared
+        \param contended
+        \param waitNs
+        \param holdNs
+    */
+    static void record(const void* mutex, const void* site, bool shared, bool contended, uint64_t waitNs,
+                       uint64_t holdNs);
+    /*!
+        \brief sample
+        \return true if this uncontended acquisition of the calling thread is to be recorded
+    */
+    static bool sample();
+    /*!
+        \brief setSampleRate
+        \param n record one in n uncontended acquisitions - 0 records none
+    */
+    static void setSampleRate(unsigned n);
+    static unsigned sampleRate();
+    /*!
+        \brief setName
+        \param mutex
+        \param name shown in the report in place of the address
+    */
+    static void setName(const void* mutex, const std::string& name);
+    /*!
+        \brief sites
+        \param out set to a copy of the totals
+    */
+    static void sites(std::vector<Site>& out);
+    /*!
+        \brief report
+        Write the call sites with the most wait time first
+        \param os
+        \param top number of sites to list - 0 for all
+    */
+    static void report(std::ostream& os, size_t top = 20);
+    /*!
+        \brief reset
+    */
+    static void reset();
+    /*!
+        \brief pendingSite
+        Call site handed from a profiled lock to the mutex it is about to lock
+        \return reference to the thread's pending site
+    */
+    static const void*& pendingSite();
+    /*!
+        \brief takeSite
+        \param fallback used if no lock set a site
+        \return pending site - cleared
+    */
+    static const void* takeSite(const void* fallback)
+    {
+        const void*& p = pendingSite();
+        const void* s  = p ? p : fallback;
+        p              = nullptr;
+        return s;
+    }
+    static uint64_t since(Clock::time_point t)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count());
+    }
+};
+
+/*!
+    \brief The ProfiledMutex class
+    A boost::shared_mutex that reports to the LockProfiler
+*/
+class ProfiledMutex
+{
+    boost::shared_mutex _m;
+    // state of the exclusive owner
+    LockProfiler::Clock::time_point _acquired;
+    const void* _site = nullptr;
+    uint64_t _waitNs  = 0;
+    bool _contended   = false;
+    bool _sampled     = false;
+
+public:
+    ProfiledMutex() = default;
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    UA_CPP_NOINLINE void lock()
+    {
+        const void* site = LockProfiler::takeSite(UA_CPP_CALL_SITE());
+        uint64_t wait    = 0;
+        bool contended   = !_m.try_lock();
+        if (contended) {
+            LockProfiler::Clock::time_point t = LockProfiler::Clock::now();
+            _m.lock();
+            wait = LockProfiler::since(t);
+        }
+        else if (!LockProfiler::sample()) {
+            _sampled = false;
+            return;
+        }
+        _sampled   = true;
+        _site      = site;
+        _waitNs    = wait;
+        _contended = contended;
+        _acquired  = LockProfiler::Clock::now();
+    }
+
+    UA_CPP_NOINLINE bool try_lock()
+    {
+        if (!_m.try_lock())
+            return false;  // the pending site is left for the lock() that usually follows
+        const void* site = LockProfiler::takeSite(UA_CPP_CALL_SITE());
+        _sampled = LockProfiler::sample();
+        if (_sampled) {
+            _site      = site;
+            _waitNs    = 0;
+            _contended = false;
+            _acquired  = LockProfiler::Clock::now();
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        if (!_sampled) {
+            _m.unlock();
+            return;
+        }
+        const uint64_t hold  = LockProfiler::since(_acquired);
+        const void* site     = _site;
+        const uint64_t wait  = _waitNs;
+        const bool contended = _contended;
+        _sampled             = false;
+        _m.unlock();
+        LockProfiler::record(this, site, false, contended, wait, hold);  // outside the lock
+    }
+
+    UA_CPP_NOINLINE void lock_shared()
+    {
+        const void* site = LockProfiler::takeSite(UA_CPP_CALL_SITE());
+        if (_m.try_lock_shared()) {
+            if (LockProfiler::sample())
+                LockProfiler::record(this, site, true, false, 0, 0);
+            return;
+        }
+        LockProfiler::Clock::time_point t = LockProfiler::Clock::now();
+        _m.lock_shared();
+        LockProfiler::record(this, site, true, true, LockProfiler::since(t), 0);
+    }
+
+    UA_CPP_NOINLINE bool try_lock_shared()
+    {
+        if (!_m.try_lock_shared())
+            return false;
+        const void* site = LockProfiler::takeSite(UA_CPP_CALL_SITE());
+        if (LockProfiler::sample())
+            LockProfiler::record(this, site, true, false, 0, 0);
+        return true;
+    }
+
+    void unlock_shared() { _m.unlock_shared(); }
+};
+
+/*!
+    \brief The ProfiledWriteLock class
+    Exclusive lock that tells the mutex where it was taken
+*/
+class ProfiledWriteLock : public boost::unique_lock<ProfiledMutex>
+{
+public:
+    UA_CPP_NOINLINE explicit ProfiledWriteLock(ProfiledMutex& m)
+        : boost::unique_lock<ProfiledMutex>(m, boost::defer_lock)
+    {
+        LockProfiler::pendingSite() = UA_CPP_CALL_SITE();
+        lock();
+    }
+    UA_CPP_NOINLINE ProfiledWriteLock(ProfiledMutex& m, boost::defer_lock_t)
+        : boost::unique_lock<ProfiledMutex>(m, boost::defer_lock)
+    {
+        LockProfiler::pendingSite() = UA_CPP_CALL_SITE();  // taken by the first lock or try_lock
+    }
+};
+
+/*!
+    \brief The ProfiledReadLock class
+    Shared lock that tells the mutex where it was taken
+*/
+class ProfiledReadLock : public boost::shared_lock<ProfiledMutex>
+{
+public:
+    UA_CPP_NOINLINE explicit ProfiledReadLock(ProfiledMutex& m)
+        : boost::shared_lock<ProfiledMutex>(m, boost::defer_lock)
+    {
+        LockProfiler::pendingSite() = UA_CPP_CALL_SITE();
+        lock();
+    }
+    UA_CPP_NOINLINE ProfiledReadLock(ProfiledMutex& m, boost::defer_lock_t)
+        : boost::shared_lock<ProfiledMutex>(m, boost::defer_lock)
+    {
+        LockProfiler::pendingSite() = UA_CPP_CALL_SITE();
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // LOCKPROFILER_H
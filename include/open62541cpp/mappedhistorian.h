@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef MAPPEDHISTORIAN_H
+#define MAPPEDHISTORIAN_H
+#include <open62541cpp/historydatabase.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Open62541 {
+
+/*!
+    \brief The MappedHistoryBackend class
+    Persistent history store. Values are appended as records to fixed size memory mapped segment files
+    in a directory. Each node has an in memory time index of record positions so a read goes straight
+    to the mapped page holding the record. Removed and replaced values are marked deleted in place.
+    When the current segment is full a new one is started and segments older than the retention period,
+    or beyond the segment limit, are dropped whole
+*/
+class UA_EXPORT MappedHistoryBackend : public HistoryDataBackend
+{
+public:
+    /*!
+        \brief The RecordHeader struct
+        Followed by the binary encoded node id and data value. Records are 8 byte aligned
+    */
+    struct RecordHeader {
+        UA_UInt32 magic;        // set last - a record without it is incomplete
+        UA_UInt32 length;       // total record length
+        UA_DateTime time;       // history key timestamp
+        UA_UInt32 flags;        // Deleted
+        UA_UInt16 nodeLength;   // bytes of encoded node id
+        UA_UInt16 reserved;
+        UA_UInt32 valueLength;  // bytes of encoded data value
+        UA_UInt32 reserved2;
+    };
+    enum { Magic = 0x43455248 /* HREC */, Deleted = 1 };
+
+    /*!
+        \brief The Segment struct
+        One mapped file
+    */
+    struct Segment {
+        UA_UInt32 id = 0;
+        std::string path;
+        boost::interprocess::file_mapping file;
+        boost::interprocess::mapped_region region;
+        size_t used       = 0;  // bytes of records
+        size_t live       = 0;  // records not deleted
+        UA_DateTime first = 0;  // key time range of the records
+        UA_DateTime last  = 0;
+        UA_Byte* data() { return static_cast<UA_Byte*>(region.get_address()); }
+        size_t capacity() const { return region.get_size(); }
+    };
+    typedef std::shared_ptr<Segment> SegmentRef;  // held by the indexing threads of openAsync as well
+
+    /*!
+        \brief The Entry struct
+        Position of one value
+    */
+    struct Entry {
+        UA_DateTime time;
+        UA_UInt32 segment;
+        UA_UInt32 offset;
+    };
+    typedef std::vector<Entry> TimeIndex;  // sorted by time
+    typedef UnorderedNodeIdMap<TimeIndex> Index;
+
+private:
+    /*!
+        \brief The ScanCounts struct
+        What a scan found - published to the segment under the lock
+    */
+    struct ScanCounts {
+        size_t used       = 0;
+        size_t live       = 0;
+        UA_DateTime first = 0;
+        UA_DateTime last  = 0;
+    };
+    //
+    std::mutex _mutex;
+    std::condition_variable _loaded;  // signalled as each segment loaded by openAsync is merged
+    std::string _directory;
+    size_t _segmentSize     = 64 * 1024 * 1024;
+    UA_DateTime _retention  = 0;  // 0 - keep everything
+    size_t _maxSegments     = 0;  // 0 - no limit
+    std::map<UA_UInt32, SegmentRef> _segments;
+    Index _index;
+    DataValue _current;  // the value returned by getDataValue
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+    //
+    std::vector<std::thread> _loaders;  // indexing threads of openAsync
+    std::atomic<size_t> _pending{0};    // segments still being indexed
+    std::atomic<bool> _stopLoading{false};
+
+    std::string segmentPath(UA_UInt32 id) const;
+    bool openSegment(UA_UInt32 id, bool create, bool index = true);
+    bool scan(Segment& s, Index& index, ScanCounts& counts);
+    void load(std::vector<SegmentRef> segments);
+    void merge(Segment& s, Index& part, const ScanCounts& counts);
+    void stopLoading();
+    void writeManifest();
+    Segment* writable(size_t length);
+    bool append(const UA_NodeId& node, const UA_DataValue& v, Entry& e);
+    const RecordHeader* header(const Entry& e);
+    bool decode(const Entry& e, UA_DataValue& v);
+    void markDeleted(const Entry& e);
+    void dropSegment(UA_UInt32 id);
+    void retain();
+    TimeIndex* timeIndex(const NodeId& n) { return _index.value(*n.constRef()); }
+    TimeIndex::iterator find(TimeIndex& t, UA_DateTime time);
+    void insert(TimeIndex& t, const Entry& e);
+    UA_StatusCode store(const NodeId& node, const UA_DataValue* value, bool replace, bool insert);
+
+public:
+    /*!
+        \brief MappedHistoryBackend
+        \param directory where the segment files are held - must exist
+        \param segmentSize bytes per segment file
+    */
+    MappedHistoryBackend(const std::string& directory, size_t segmentSize = 64 * 1024 * 1024);
+    virtual ~MappedHistoryBackend();
+
+    /*!
+        \brief open
+        Map the existing segments and rebuild the time index, or start the first segment
+        \return true on success
+    */
+    bool open();
+    /*!
+        \brief openAsync
+        Map the existing segments and index them on worker threads, returning at once so the server can start
+        serving live data. Values written meanwhile go to a new segment; a history read sees the records
+        indexed so far, and a value replaced before its record is indexed keeps the newer write. HistoryUpdate
+        requests are refused with BadResourceUnavailable until loading completes, as their checks for existing
+        values would miss the records not yet indexed. Retention, and dropping segments emptied by deletes, wait
+        for loading to complete
+        \param threads indexing threads - 0 for one per hardware thread
+        \return true if the segments mapped
+    */
+    bool openAsync(unsigned threads = 0);
+    /*!
+        \brief loading
+        \return true while openAsync is still indexing
+    */
+    bool loading() const { return _pending > 0; }
+    size_t pendingSegments() const { return _pending; }
+    /*!
+        \brief waitLoaded
+        \param timeoutMs 0 waits for as long as it takes
+        \return true if loading completed
+    */
+    bool waitLoaded(unsigned timeoutMs = 0);
+    /*!
+        \brief reserve
+        Preallocate the time index for a number of nodes - before registering many nodes at once
+        \param nodes
+    */
+    void reserve(size_t nodes);
+    /*!
+        \brief close
+        Flush and unmap all segments
+    */
+    void close();
+    /*!
+        \brief flush
+        Write dirty pages back to the files
+        \param async schedule the write rather than wait for it
+    */
+    void flush(bool async = true);
+    /*!
+        \brief isOpen
+        \return true if open
+    */
+    bool isOpen();
+
+    /*!
+        \brief setRetention
+        Segments holding only values older than this are dropped when a segment is started
+        \param t age in UA_DateTime units, 0 keeps everything
+    */
+    void setRetention(UA_DateTime t) { _retention = t; }
+    UA_DateTime retention() const { return _retention; }
+    /*!
+        \brief setMaxSegments
+        \param n segment files to keep, 0 for no limit
+    */
+    void setMaxSegments(size_t n) { _maxSegments = n; }
+    size_t maxSegments() const { return _maxSegments; }
+    /*!
+        \brief applyRetention
+        Drop expired segments now
+    */
+    void applyRetention();
+
+    /*!
+        \brief size
+        \param n
+        \return values held for a node
+    */
+    size_t size(const NodeId& n);
+    /*!
+        \brief segmentCount
+        \return mapped segment files
+    */
+    size_t segmentCount();
+    /*!
+        \brief memoryUsage
+        The in memory time index as "history" and the mapped segments as "historyMapped" - the segments are
+        file backed pages the system can reclaim, not heap
+        \param r
+    */
+    virtual void memoryUsage(MemoryReport& r);
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+
+    // HistoryDataBackend low level interface
+    virtual UA_StatusCode serverSetHistoryData(Context& c, bool historizing, const UA_DataValue* value);
+    virtual size_t getDateTimeMatch(Context& c, const UA_DateTime timestamp, const MatchStrategy strategy);
+    virtual size_t getEnd(Context& c);
+    virtual size_t lastIndex(Context& c);
+    virtual size_t firstIndex(Context& c);
+    virtual size_t resultSize(Context& c, size_t startIndex, size_t endIndex);
+    virtual UA_StatusCode copyDataValues(Context& c,
+                                         size_t startIndex,
+                                         size_t endIndex,
+                                         UA_Boolean reverse,
+                                         size_t valueSize,
+                                         UA_NumericRange range,
+                                         UA_Boolean releaseContinuationPoints,
+                                         std::string& in,
+                                         std::string& out,
+                                         size_t* providedValues,
+                                         UA_DataValue* values);
+    virtual const UA_DataValue* getDataValue(Context& c, size_t index);
+    virtual UA_Boolean boundSupported(Context& /*c*/) { return UA_TRUE; }
+    virtual UA_Boolean timestampsToReturnSupported(Context& /*c*/, const UA_TimestampsToReturn /*t*/)
+    {
+        return UA_TRUE;
+    }
+    virtual UA_StatusCode insertDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode insertDataValues(Context& c, const UA_DataValue* values, size_t n, UA_StatusCode* results);
+    virtual UA_StatusCode replaceDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode updateDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode removeDataValue(Context& c, UA_DateTime startTimestamp, UA_DateTime endTimestamp);
+};
+
+/*!
+    \brief The MappedHistorian class
+    The default gathering and database with a persistent memory mapped backend
+*/
+class UA_EXPORT MappedHistorian : public Historian
+{
+    MappedHistoryBackend _store;
+
+public:
+    /*!
+        \brief MappedHistorian
+        \param directory segment directory - call open() before use
+        \param numberNodes initial size of the gathering table
+        \param segmentSize bytes per segment file
+    */
+    MappedHistorian(const std::string& directory,
+                    size_t numberNodes  = 100,
+                    size_t segmentSize  = 64 * 1024 * 1024);
+    virtual ~MappedHistorian() { memset(&_backend, 0, sizeof(_backend)); }
+    /*!
+        \brief open
+        \return true if the store opened
+    */
+    bool open() { return _store.open(); }
+    /*!
+        \brief openAsync
+        \param threads indexing threads - 0 for one per hardware thread
+        \return true if the segments mapped - see MappedHistoryBackend::openAsync
+    */
+    bool openAsync(unsigned threads = 0) { return _store.openAsync(threads); }
+    virtual void reserve(size_t nodes) { _store.reserve(nodes); }
+    /*!
+        \brief store
+        \return the backend
+    */
+    MappedHistoryBackend& store() { return _store; }
+};
+
+}  // namespace Open62541
+
+#endif  // MAPPEDHISTORIAN_H
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef MEMORYREPORT_H
+#define MEMORYREPORT_H
+#include <open62541cpp/open62541objects.h>
+#include <functional>
+#include <iosfwd>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The MemoryReport class
+    Bytes and object counts held by each subsystem - filled by Server::memoryReport(), Client::memoryReport()
+    and the memory sources registered with them. Figures are estimates made from container sizes and element
+    sizes when the report is asked for - nothing is tracked on the allocation paths, so keeping the report
+    available costs nothing. Container overheads are those of a typical 64 bit standard library; what user
+    data such as node contexts point to is not counted.
+    Each subsystem adds one total - an item with an empty name. With detail() set, subsystems that can also
+    add one item per part, e.g. the history of each node
+*/
+class UA_EXPORT MemoryReport
+{
+public:
+    /*!
+        \brief The Item struct
+    */
+    struct Item {
+        std::string subsystem;
+        std::string name;  // the part - empty for the subsystem total
+        size_t bytes   = 0;
+        size_t objects = 0;
+    };
+    typedef std::function<void(MemoryReport&)> Source;
+
+    // per element overheads of the standard containers - estimates
+    static constexpr size_t MapNode  = 4 * sizeof(void*);  // std::map and std::set: colour, parent and children
+    static constexpr size_t HashNode = 3 * sizeof(void*);  // unordered containers: next, hash and bucket slot
+
+private:
+    std::vector<Item> _items;
+    bool _detail = false;
+
+public:
+    /*!
+        \brief MemoryReport
+        \param detail add the parts of the subsystems as well as their totals
+    */
+    explicit MemoryReport(bool detail = false)
+        : _detail(detail)
+    {
+    }
+
+    bool detail() const { return _detail; }
+    const std::vector<Item>& items() const { return _items; }
+    void clear() { _items.clear(); }
+
+    /*!
+        \brief add
+        \param subsystem
+        \param bytes
+        \param objects
+        \param name part of the subsystem - empty for its total
+    */
+    void add(const std::string& subsystem, size_t bytes, size_t objects, const std::string& name = std::string());
+    /*!
+        \brief bytes
+        \param subsystem
+        \return total bytes of the subsystem - 0 if it is not in the report
+    */
+    size_t bytes(const std::string& subsystem) const;
+    /*!
+        \brief objects
+        \param subsystem
+        \return total objects of the subsystem
+    */
+    size_t objects(const std::string& subsystem) const;
+    /*!
+        \brief totalBytes
+        \return bytes of every subsystem
+    */
+    size_t totalBytes() const;
+    /*!
+        \brief report
+        \param os one line per item, totals first, largest first
+    */
+    void report(std::ostream& os) const;
+
+    /*!
+        \brief addNodes
+        Publish a server's report under a folder - a folder per subsystem reported now, plus Total, holding
+        Bytes and Objects variables that take a fresh report when read
+        \param server
+        \param parent node the Memory folder is added to
+        \param nameSpaceIndex of the new nodes
+        \return true on success
+    */
+    static bool addNodes(Server& server, const NodeId& parent, int nameSpaceIndex = 1);
+
+    //
+    // heap held by values - what the value points to, not the value itself
+    //
+    static size_t heapOf(const std::string& s) { return (s.capacity() > 15) ? s.capacity() + 1 : 0; }
+    static size_t heapOf(const UA_NodeId& n);
+    static size_t heapOf(const UA_Variant& v);
+    static size_t heapOf(const UA_DataValue& v) { return v.hasValue ? heapOf(v.value) : 0; }
+    template <typename T>
+    static size_t heapOf(const std::vector<T>& v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // MEMORYREPORT_H
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef METHODBINDING_H
+#define METHODBINDING_H
+#include <open62541cpp/open62541objects.h>
+#include <tuple>
+#include <utility>
+
+namespace Open62541 {
+
+//
+// Typed marshalling of method arguments straight between UA_Variant and C++ values - no Variant wrappers.
+// method_arg<T> handles one value:
+//   holder  - decoded input, referring into the request where the type allows
+//   assign  - write an output or input slot, in place when it already holds a fixed size scalar of the type
+//   declare - fill in the UA_Argument describing it
+// Supported types are those with a ua_type_traits mapping, std::string and UA_Variant (any type)
+//
+template <typename T, typename Enable = void>
+struct method_arg;
+
+template <typename T>
+struct method_arg<T,
+                  typename std::enable_if<ua_type_traits<T>::is_ua_type && !std::is_same<T, UA_Variant>::value>::type> {
+    struct holder {
+        const T* _p = nullptr;
+        bool decode(const UA_Variant& v)
+        {
+            _p = (UA_Variant_isScalar(&v) && ua_type_traits<T>::accepts(v.type)) ? static_cast<const T*>(v.data)
+                                                                                  : nullptr;
+            return _p != nullptr;
+        }
+        const T& get() const { return *_p; }
+    };
+    static UA_StatusCode assign(const T& x, UA_Variant* v)
+    {
+        if (ua_type_traits<T>::is_fixed_size && UA_Variant_isScalar(v) && (v->type == ua_type_traits<T>::type()) &&
+            (v->storageType == UA_VARIANT_DATA)) {
+            *static_cast<T*>(v->data) = x;  // reuse the slot
+            return UA_STATUSCODE_GOOD;
+        }
+        UA_Variant_clear(v);
+        return UA_Variant_setScalarCopy(v, &x, ua_type_traits<T>::type());
+    }
+    static void declare(UA_Argument& a)
+    {
+        a.dataType  = ua_type_traits<T>::type()->typeId;
+        a.valueRank = -1;  // scalar
+    }
+    static bool decode(const UA_Variant& v, T& x)
+    {
+        holder h;
+        return h.decode(v) && (ua_copy(&h.get(), &x) == UA_STATUSCODE_GOOD);
+    }
+};
+
+template <>
+struct method_arg<std::string> {
+    struct holder {
+        std::string _s;
+        bool decode(const UA_Variant& v)
+        {
+            if (!UA_Variant_isScalar(&v) || !ua_type_traits<UA_String>::accepts(v.type))
+                return false;
+            const UA_String* s = static_cast<const UA_String*>(v.data);
+            _s.assign(reinterpret_cast<const char*>(s->data), s->length);
+            return true;
+        }
+        const std::string& get() const { return _s; }
+    };
+    static UA_StatusCode assign(const std::string& x, UA_Variant* v)
+    {
+        UA_Variant_clear(v);
+        UA_String s;
+        s.length = x.size();
+        s.data   = (UA_Byte*)(x.data());
+        return UA_Variant_setScalarCopy(v, &s, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    static void declare(UA_Argument& a)
+    {
+        a.dataType  = UA_TYPES[UA_TYPES_STRING].typeId;
+        a.valueRank = -1;
+    }
+    static bool decode(const UA_Variant& v, std::string& x)
+    {
+        holder h;
+        if (!h.decode(v))
+            return false;
+        x = std::move(h._s);
+        return true;
+    }
+};
+
+template <>
+struct method_arg<UA_Variant> {
+    struct holder {
+        const UA_Variant* _p = nullptr;
+        bool decode(const UA_Variant& v)
+        {
+            _p = &v;
+            return true;
+        }
+        const UA_Variant& get() const { return *_p; }
+    };
+    static UA_StatusCode assign(const UA_Variant& x, UA_Variant* v)
+    {
+        UA_Variant_clear(v);
+        return UA_Variant_copy(&x, v);
+    }
+    static void declare(UA_Argument& a)
+    {
+        a.dataType  = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATATYPE);
+        a.valueRank = -2;  // any
+    }
+    static bool decode(const UA_Variant& v, UA_Variant& x)
+    {
+        UA_Variant_clear(&x);
+        return UA_Variant_copy(&v, &x) == UA_STATUSCODE_GOOD;
+    }
+};
+
+template <typename T>
+using method_arg_t = method_arg<typename std::decay<T>::type>;
+
+/*!
+    \brief method_results
+    Outputs of a bound method - void for none, std::tuple for several, otherwise one
+*/
+template <typename R>
+struct method_results {
+    static constexpr size_t size = 1;
+    static UA_StatusCode assign(const R& r, UA_Variant* out) { return method_arg_t<R>::assign(r, out); }
+    static void declare(UA_Argument* a) { method_arg_t<R>::declare(a[0]); }
+};
+
+template <>
+struct method_results<void> {
+    static constexpr size_t size = 0;
+    static void declare(UA_Argument*) {}
+};
+
+template <typename... Outs>
+struct method_results<std::tuple<Outs...>> {
+    static constexpr size_t size = sizeof...(Outs);
+    static UA_StatusCode assign(const std::tuple<Outs...>& r, UA_Variant* out)
+    {
+        return assign(r, out, std::index_sequence_for<Outs...>());
+    }
+    static void declare(UA_Argument* a)
+    {
+        int dummy[] = {0, (method_arg_t<Outs>::declare(a[0]), a++, 0)...};
+        (void)dummy;
+    }
+
+private:
+    template <size_t... I>
+    static UA_StatusCode assign(const std::tuple<Outs...>& r, UA_Variant* out, std::index_sequence<I...>)
+    {
+        UA_StatusCode ret = UA_STATUSCODE_GOOD;
+        int dummy[]       = {
+            0, (ret = (ret == UA_STATUSCODE_GOOD) ? method_arg_t<Outs>::assign(std::get<I>(r), out + I) : ret, 0)...};
+        (void)dummy;
+        return ret;
+    }
+};
+
+/*!
+    \brief MethodBinding
+    Compile time signature of a method - MethodBinding<double(int, std::string)>::call decodes the inputs into
+    the parameters, calls the function and encodes the result into the output slots given by the stack
+*/
+template <typename Sig>
+struct MethodBinding;
+
+template <typename R, typename... Args>
+struct MethodBinding<R(Args...)> {
+    static constexpr size_t inputs  = sizeof...(Args);
+    static constexpr size_t outputs = method_results<R>::size;
+
+    /*!
+        \brief declare
+        Size the argument lists and type the entries not already declared - the lists keep the one spare
+        entry ServerMethod allocates
+        \param in
+        \param out
+    */
+    static void declare(ArgumentList& in, ArgumentList& out)
+    {
+        declareList(in, inputs, "Input", [](UA_Argument* a) {
+            int dummy[] = {0, (method_arg_t<Args>::declare(a[0]), a++, 0)...};
+            (void)dummy;
+        });
+        declareList(out, outputs, "Output", [](UA_Argument* a) { method_results<R>::declare(a); });
+    }
+
+    /*!
+        \brief call
+        \param f function taking Args and returning R
+        \param inputSize
+        \param input
+        \param outputSize
+        \param output
+        \return status code
+    */
+    template <typename F>
+    static UA_StatusCode call(F& f, size_t inputSize, const UA_Variant* input, size_t outputSize, UA_Variant* output)
+    {
+        if (inputSize < inputs)
+            return UA_STATUSCODE_BADARGUMENTSMISSING;
+        if (inputSize > inputs)
+            return UA_STATUSCODE_BADTOOMANYARGUMENTS;
+        if (outputSize < outputs)
+            return UA_STATUSCODE_BADINTERNALERROR;
+        return invoke(f, input, output, std::index_sequence_for<Args...>(), std::is_void<R>());
+    }
+
+private:
+    template <typename D>
+    static void declareList(ArgumentList& l, size_t n, const char* name, D d)
+    {
+        std::vector<UA_Argument> typed(n);
+        for (auto& a : typed) {
+            UA_Argument_init(&a);
+        }
+        if (n)
+            d(typed.data());
+        if (l.size() < (n + 1))
+            l.resize(n + 1);
+        for (size_t i = 0; i < n; i++) {
+            if (UA_NodeId_isNull(&l[i].dataType)) {
+                if (l[i].name.length == 0) {
+                    l[i].name = UA_STRING((char*)name);  // constant - ArgumentList does not own its strings
+                }
+                l[i].dataType  = typed[i].dataType;
+                l[i].valueRank = typed[i].valueRank;
+            }
+        }
+    }
+
+    template <typename F, size_t... I>
+    static UA_StatusCode invoke(F& f, const UA_Variant* input, UA_Variant*, std::index_sequence<I...>, std::true_type)
+    {
+        std::tuple<typename method_arg_t<Args>::holder...> h;
+        bool ok     = true;
+        int dummy[] = {0, (ok = ok && std::get<I>(h).decode(input[I]), 0)...};
+        (void)dummy;
+        if (!ok)
+            return UA_STATUSCODE_BADTYPEMISMATCH;
+        f(std::get<I>(h).get()...);
+        return UA_STATUSCODE_GOOD;
+    }
+
+    template <typename F, size_t... I>
+    static UA_StatusCode invoke(F& f,
+                                const UA_Variant* input,
+                                UA_Variant* output,
+                                std::index_sequence<I...>,
+                                std::false_type)
+    {
+        std::tuple<typename method_arg_t<Args>::holder...> h;
+        bool ok     = true;
+        int dummy[] = {0, (ok = ok && std::get<I>(h).decode(input[I]), 0)...};
+        (void)dummy;
+        if (!ok)
+            return UA_STATUSCODE_BADTYPEMISMATCH;
+        return method_results<R>::assign(f(std::get<I>(h).get()...), output);
+    }
+};
+
+/*!
+    \brief The MethodCallBatch class
+    Preallocated set of method calls sent in one Call service by Client::callMethods. Inputs are encoded once
+    by add() and rewritten in place by set(), so a call repeated at a high rate does not allocate for fixed size
+    scalar arguments. The last response is kept until the next call or clear()
+*/
+class UA_EXPORT MethodCallBatch
+{
+    std::vector<UA_CallMethodRequest> _requests;
+    UA_CallResponse _response;
+
+    template <size_t... I, typename... Args>
+    static UA_StatusCode assign(UA_Variant* v, std::index_sequence<I...>, const Args&... args)
+    {
+        UA_StatusCode ret = UA_STATUSCODE_GOOD;
+        int dummy[] = {0, (ret = (ret == UA_STATUSCODE_GOOD) ? method_arg_t<Args>::assign(args, v + I) : ret, 0)...};
+        (void)dummy;
+        return ret;
+    }
+
+public:
+    MethodCallBatch() { UA_CallResponse_init(&_response); }
+    MethodCallBatch(const MethodCallBatch&) = delete;
+    MethodCallBatch& operator=(const MethodCallBatch&) = delete;
+    ~MethodCallBatch() { clear(); }
+
+    /*!
+        \brief add
+        \param objectId
+        \param methodId
+        \param args inputs
+        \return index of the call
+    */
+    template <typename... Args>
+    size_t add(const NodeId& objectId, const NodeId& methodId, const Args&... args)
+    {
+        UA_CallMethodRequest r;
+        UA_CallMethodRequest_init(&r);
+        UA_NodeId_copy(objectId.constRef(), &r.objectId);
+        UA_NodeId_copy(methodId.constRef(), &r.methodId);
+        if (sizeof...(Args)) {
+            r.inputArguments =
+                static_cast<UA_Variant*>(UA_Array_new(sizeof...(Args), &UA_TYPES[UA_TYPES_VARIANT]));
+            r.inputArgumentsSize = sizeof...(Args);
+            assign(r.inputArguments, std::index_sequence_for<Args...>(), args...);
+        }
+        _requests.push_back(r);
+        return _requests.size() - 1;
+    }
+
+    /*!
+        \brief set
+        Rewrite the inputs of a call - the number of inputs must match add()
+        \param i call index
+        \param args inputs
+        \return false if the index or the number of inputs is wrong
+    */
+    template <typename... Args>
+    bool set(size_t i, const Args&... args)
+    {
+        if ((i >= _requests.size()) || (_requests[i].inputArgumentsSize != sizeof...(Args)))
+            return false;
+        return assign(_requests[i].inputArguments, std::index_sequence_for<Args...>(), args...) ==
+               UA_STATUSCODE_GOOD;
+    }
+
+    size_t size() const { return _requests.size(); }
+    UA_CallMethodRequest* requests() { return _requests.data(); }
+
+    /*!
+        \brief setResponse
+        \param r response - ownership is taken
+    */
+    void setResponse(UA_CallResponse& r)
+    {
+        UA_CallResponse_clear(&_response);
+        _response = r;
+        UA_CallResponse_init(&r);
+    }
+
+    /*!
+        \brief status
+        \param i call index
+        \return status of the call - bad if there was no result
+    */
+    UA_StatusCode status(size_t i) const
+    {
+        if (_response.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+            return _response.responseHeader.serviceResult;
+        return (i < _response.resultsSize) ? _response.results[i].statusCode : UA_STATUSCODE_BADNOTHINGTODO;
+    }
+
+    /*!
+        \brief result
+        Decode an output of a call
+        \param i call index
+        \param n output index
+        \param v value - a UA type must not own anything as it is overwritten by a deep copy
+        \return true if the call succeeded and the output is of type T
+    */
+    template <typename T>
+    bool result(size_t i, size_t n, T& v) const
+    {
+        if ((status(i) != UA_STATUSCODE_GOOD) || (n >= _response.results[i].outputArgumentsSize))
+            return false;
+        return method_arg_t<T>::decode(_response.results[i].outputArguments[n], v);
+    }
+
+    /*!
+        \brief response
+        \return last response
+    */
+    const UA_CallResponse& response() const { return _response; }
+
+    /*!
+        \brief clear
+        Remove every call
+    */
+    void clear()
+    {
+        for (auto& r : _requests) {
+            UA_CallMethodRequest_clear(&r);
+        }
+        _requests.clear();
+        UA_CallResponse_clear(&_response);
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // METHODBINDING_H
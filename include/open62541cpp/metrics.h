@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <chrono>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The Metrics class
+    Always on counters and latency histograms for the hot paths - data source reads and writes, method calls,
+    subscription notifications, browses, waits for the Server and Client locks, timer callbacks and the client
+    iterations that renew a secure channel.
+    Each thread records into a shard of its own with relaxed atomics, so recording never contends; a
+    snapshot sums the shards. Latencies go into power of two buckets from 1 us. Recording costs two clock
+    reads and a few stores and can be switched off at run time with setEnabled(false).
+    The figures can be read with snapshot() or published as variables with addNodes()
+*/
+class UA_EXPORT Metrics
+{
+public:
+    enum Probe {
+        DataSourceRead = 0,
+        DataSourceWrite,
+        MethodCall,
+        Notification,
+        Browse,
+        LockWait,
+        TimerCallback,
+        ChannelRenewal,
+        ProbeCount
+    };
+    enum { Buckets = 24 };  // bucket 0 under 1 us, bucket i under 2^i us, the last takes the rest
+
+    /*!
+        \brief The Stats struct
+        Totals of one probe
+    */
+    struct Stats {
+        UA_UInt64 count   = 0;
+        UA_UInt64 totalNs = 0;
+        UA_UInt64 maxNs   = 0;
+        UA_UInt64 buckets[Buckets] = {};
+
+        double meanUs() const { return count ? double(totalNs) / double(count) / 1000.0 : 0.0; }
+        /*!
+            \brief percentileUs
+            \param p fraction - 0.99 for the 99th percentile
+            \return upper bound of the bucket holding the percentile in us
+        */
+        double percentileUs(double p) const;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    static std::atomic<bool> _enabled;
+
+public:
+    /*!
+        \brief record
+        \param p probe
+        \param ns latency
+    */
+    static void record(Probe p, UA_UInt64 ns);
+    /*!
+        \brief snapshot
+        \param p probe
+        \param s set to the totals since start or the last reset
+    */
+    static void snapshot(Probe p, Stats& s);
+    /*!
+        \brief reset
+        Start the totals again - counts made meanwhile by other threads may land either side of the reset
+    */
+    static void reset();
+    static void setEnabled(bool f) { _enabled.store(f, std::memory_order_relaxed); }
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+    static const char* name(Probe p);
+
+    /*!
+        \brief addNodes
+        Publish the metrics under a folder - one folder per probe holding Count, MeanUs, P99Us and MaxUs
+        variables, read live through a data source
+        \param server
+        \param parent node the Metrics folder is added to
+        \param nameSpaceIndex of the new nodes
+        \return true on success
+    */
+    static bool addNodes(Server& server, const NodeId& parent, int nameSpaceIndex = 1);
+
+    /*!
+        \brief The Scope class
+        Records the time from construction to destruction
+    */
+    class Scope
+    {
+        Probe _probe;
+        Clock::time_point _start;
+        bool _on;
+
+    public:
+        explicit Scope(Probe p)
+            : _probe(p)
+            , _on(Metrics::enabled())
+        {
+            if (_on)
+                _start = Clock::now();
+        }
+        ~Scope()
+        {
+            if (_on) {
+                Metrics::record(_probe,
+                                UA_UInt64(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start)
+                                              .count()));
+            }
+        }
+    };
+
+    /*!
+        \brief The TimedLock class
+        A lock that records how long it waited. Uncontended acquisitions take the fast path and are not timed
+    */
+    template <typename L>
+    class TimedLock : public L
+    {
+    public:
+        template <typename M>
+        explicit TimedLock(M& m)
+            : L(m, DeferLock())
+        {
+            if (!this->try_lock()) {
+                Scope s(LockWait);
+                this->lock();
+            }
+        }
+    };
+};
+
+}  // namespace Open62541
+
+#endif  // METRICS_H
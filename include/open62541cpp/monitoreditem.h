@@ -12,6 +12,9 @@
 #ifndef MONITOREDITEM_H
 #define MONITOREDITEM_H
 #include <open62541cpp/open62541objects.h>
+#include <open62541cpp/subscriptionvaluecache.h>
+#include <open62541cpp/changefilter.h>
+#include <atomic>
 
 namespace Open62541 {
 
@@ -21,17 +24,37 @@ class ClientSubscription;
 typedef std::function<void(ClientSubscription&, UA_DataValue*)> monitorItemFunc;
 // call back for an event
 typedef std::function<void(ClientSubscription&, VariantArray&)> monitorEventFunc;
+// Callback for a data change shared with other sinks - no copy per sink
+typedef std::function<void(ClientSubscription&, const SharedDataValue&)> monitorSharedFunc;
 /*!
     \brief The MonitoredItem class
     This is a single monitored event. Monitored events are associated (owned) by subscriptions
 */
 class UA_EXPORT MonitoredItem
 {
+    friend class ClientSubscription;  // bulk creation sets the response and callbacks directly
+
 private:
     ClientSubscription& _sub;  // parent subscription
 protected:
     MonitoredItemCreateResult _response;  // response
     UA_StatusCode _lastError = 0;
+    //
+    // definition - kept so the item can be recreated on a new session
+    NodeId _nodeId;
+    UA_TimestampsToReturn _ts = UA_TIMESTAMPSTORETURN_BOTH;
+    double _samplingInterval  = 250.0;
+    UA_UInt32 _queueSize      = 1;
+    //
+    // load seen by the adaptive mode of the subscription
+    UA_UInt32 _generation = 0;  // publish _perPublish counts
+    UA_UInt32 _perPublish = 0;
+    UA_UInt32 _peak       = 0;  // most notifications in one publish since the last adjustment
+    bool _overflow        = false;
+    //
+    std::unique_ptr<ChangeFilter> _changeFilter;  // client side filter of data changes - null if none
+    std::atomic<bool> _removeFilter{false};       // the filter is to be dropped by the iterate thread
+    std::atomic<bool> _retired{false};            // deleted from the subscription - no longer dispatched
 
     /* Callback for the deletion of a MonitoredItem */
     static void deleteMonitoredItemCallback(UA_Client* client,
@@ -73,6 +96,12 @@ public:
         \return last error code
     */
     UA_StatusCode lastError() const { return _lastError; }
+    /*!
+        \brief retire
+        Stop dispatching notifications - set when the item is deleted from its subscription
+    */
+    void retire() { _retired = true; }
+    bool retired() const { return _retired; }
 
     /*!
      * \brief subscription
@@ -99,6 +128,12 @@ public:
      * \param eventFields
      */
     virtual void eventNotification(size_t /*nEventFields*/, UA_Variant* /*eventFields*/) {}
+    /*!
+        \brief flushEvents
+        Passes on events the item holds back to deliver together - called once the client iteration completes
+        for items queued with ClientSubscription::queueEventFlush
+    */
+    virtual void flushEvents() {}
     //
     /*!
         \brief remove
@@ -111,6 +146,67 @@ public:
     */
     UA_UInt32 id() { return _response.get().monitoredItemId; }
 
+    /*!
+        \brief changeFilter
+        The client side filter of data changes, created on first use - set it up before the item is created or
+        on the iterate thread. Values it drops are counted and go no further - not to batches, queues, the value
+        cache or the handler
+        \return the filter
+    */
+    ChangeFilter& changeFilter()
+    {
+        _removeFilter = false;
+        if (!_changeFilter)
+            _changeFilter.reset(new ChangeFilter());
+        return *_changeFilter;
+    }
+
+    /*!
+        \brief hasChangeFilter
+        \return true if data changes are filtered
+    */
+    bool hasChangeFilter() const { return _changeFilter && !_removeFilter; }
+
+    /*!
+        \brief removeChangeFilter
+        Pass every data change again. Callable from any thread - the filter is dropped by the iterate thread, at
+        the next data change or subscription flush, and a value it holds back is delivered first
+    */
+    void removeChangeFilter() { _removeFilter = true; }
+
+    /*!
+        \brief releaseHeld
+        Dispatches the value held back by the change filter once its interval has passed - iterate thread only
+        \param now monotonic time
+        \return true if nothing is held any longer
+    */
+    bool releaseHeld(UA_DateTime now);
+
+    /*!
+        \brief nodeId
+        \return the monitored node
+    */
+    const NodeId& nodeId() const { return _nodeId; }
+
+    /*!
+        \brief invalidate
+        Forgets the server side item without deleting it - used when the session it lived on has gone
+    */
+    virtual void invalidate() { _response.null(); }
+
+    /*!
+        \brief isDataChange
+        \return true for data change items - these are recreated in bulk
+    */
+    virtual bool isDataChange() const { return false; }
+
+    /*!
+        \brief recreate
+        Creates the item again from its stored definition
+        \return true on success
+    */
+    virtual bool recreate() { return false; }
+
 protected:
     /*!
      * \brief setMonitoringMode
@@ -136,6 +232,26 @@ protected:
 class MonitoredItemDataChange : public MonitoredItem
 {
     monitorItemFunc _func;  // lambda for callback
+    std::vector<monitorSharedFunc> _sinks;         // share each value
+    SubscriptionValueCache::EntryRef _cacheEntry;  // set if the client has a value cache
+    friend class ClientSubscription;
+
+protected:
+    /*!
+        \brief attachCache
+        Starts feeding the client's value cache, if it has one
+    */
+    void attachCache();
+
+    /*!
+        \brief updateCache
+        \param value new value
+    */
+    void updateCache(const UA_DataValue* value)
+    {
+        if (_cacheEntry && value)
+            SubscriptionValueCache::update(*_cacheEntry, *value);
+    }
 
 public:
     /*!
@@ -161,14 +277,61 @@ public:
         \param f functor
     */
     void setFunction(monitorItemFunc f) { _func = f; }
+    /*!
+        \brief addSink
+        Add a handler that shares each value with the value cache and the other sinks - the value is taken
+        from the notification once, after the functor, and never copied
+        \param f sink
+    */
+    void addSink(monitorSharedFunc f) { _sinks.push_back(std::move(f)); }
+
     /*!
         \brief dataChangeNotification
         \param value new value
     */
     virtual void dataChangeNotification(UA_DataValue* value)
     {
+        if (_sinks.empty()) {
+            updateCache(value);
+            if (_func)
+                _func(subscription(), value);  // invoke functor
+            return;
+        }
         if (_func)
-            _func(subscription(), value);  // invoke functor
+            _func(subscription(), value);
+        if (!value)
+            return;
+        const SharedDataValue shared = SharedDataValue::adopt(*value);  // the stack clears what is left
+        if (_cacheEntry)
+            SubscriptionValueCache::update(*_cacheEntry, shared);
+        for (auto& f : _sinks)
+            f(subscription(), shared);
+    }
+
+    /*!
+        \brief ~MonitoredItemDataChange
+    */
+    virtual ~MonitoredItemDataChange() { SubscriptionValueCache::detach(_cacheEntry); }
+
+    /*!
+        \brief remove
+        \return true on success
+    */
+    virtual bool remove()
+    {
+        SubscriptionValueCache::detach(_cacheEntry);
+        _cacheEntry.reset();
+        return MonitoredItem::remove();
+    }
+
+    /*!
+        \brief invalidate
+    */
+    virtual void invalidate()
+    {
+        if (_cacheEntry)
+            SubscriptionValueCache::invalidate(*_cacheEntry);
+        MonitoredItem::invalidate();
     }
 
     /*!
@@ -178,6 +341,21 @@ public:
         \return true on success
     */
     bool addDataChange(NodeId& n, UA_TimestampsToReturn ts = UA_TIMESTAMPSTORETURN_BOTH);
+
+    /*!
+        \brief setSampling
+        Requested parameters used by addDataChange and by recovery
+        \param samplingInterval milliseconds
+        \param queueSize server side queue size
+    */
+    void setSampling(double samplingInterval, UA_UInt32 queueSize)
+    {
+        _samplingInterval = samplingInterval;
+        _queueSize        = queueSize;
+    }
+
+    virtual bool isDataChange() const { return true; }
+    virtual bool recreate() { return addDataChange(_nodeId, _ts); }
 };
 
 typedef std::unique_ptr<MonitoredItem> MonitoredItemPtr;
@@ -247,6 +425,8 @@ public:
     */
     virtual bool addEvent(NodeId& n, UA_TimestampsToReturn ts = UA_TIMESTAMPSTORETURN_BOTH);
 
+    virtual bool recreate() { return addEvent(_nodeId, _ts); }
+
     /*!
      * \brief monitorItem
      * \return
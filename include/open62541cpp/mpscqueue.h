@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace Open62541 {
+
+/*!
+    \brief The MpscQueue class
+    Bounded lock free ring buffer for any number of producer threads and one consumer thread. Each slot carries
+    a sequence number so producers claim slots with a single compare and swap on the tail and publish them
+    independently. The capacity is rounded up to a power of two.
+    \param T slot type - moved in and out
+*/
+template <typename T>
+class MpscQueue
+{
+    static constexpr size_t CacheLine = 64;
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T value;
+    };
+    std::vector<Slot> _slots;
+    size_t _mask = 0;
+    alignas(CacheLine) std::atomic<size_t> _head{0};  // next slot to read - written by the consumer
+    alignas(CacheLine) std::atomic<size_t> _tail{0};  // next slot to claim - shared by the producers
+
+public:
+    /*!
+        \brief MpscQueue
+        \param capacity minimum number of slots
+    */
+    explicit MpscQueue(size_t capacity = 1024)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        _slots = std::vector<Slot>(n);
+        for (size_t i = 0; i < n; i++)
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        _mask = n - 1;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /*!
+        \brief push
+        Producer side - any thread
+        \param v value to move in
+        \return false if full - v is untouched
+    */
+    bool push(T& v)
+    {
+        size_t t = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s              = _slots[t & _mask];
+            const size_t seq     = s.seq.load(std::memory_order_acquire);
+            const ptrdiff_t diff = ptrdiff_t(seq) - ptrdiff_t(t);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(v);
+                    s.seq.store(t + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;  // the consumer has not freed this slot yet
+            }
+            else {
+                t = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /*!
+        \brief pop
+        Consumer side
+        \param v set to the oldest published value
+        \return false if empty or the oldest slot is claimed but not yet written
+    */
+    bool pop(T& v)
+    {
+        const size_t h = _head.load(std::memory_order_relaxed);
+        Slot& s        = _slots[h & _mask];
+        if (s.seq.load(std::memory_order_acquire) != h + 1)
+            return false;
+        v = std::move(s.value);
+        s.seq.store(h + _mask + 1, std::memory_order_release);
+        _head.store(h + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+        \brief size
+        \return approximate number of queued values
+    */
+    size_t size() const
+    {
+        const size_t t = _tail.load(std::memory_order_acquire);
+        const size_t h = _head.load(std::memory_order_acquire);
+        return t > h ? t - h : 0;
+    }
+
+    /*!
+        \brief empty
+        \return true if nothing is queued
+    */
+    bool empty() const { return size() == 0; }
+
+    /*!
+        \brief capacity
+        \return number of slots
+    */
+    size_t capacity() const { return _mask + 1; }
+    size_t memoryUsage() const { return _slots.capacity() * sizeof(Slot); }  //!< bytes of the slots
+};
+
+}  // namespace Open62541
+
+#endif  // MPSCQUEUE_H
@@ -12,6 +12,9 @@
 #ifndef NODECONTEXT_H
 #define NODECONTEXT_H
 #include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 namespace Open62541 {
 /*!
     \brief The NodeContext class
@@ -30,6 +33,7 @@ public:
     typedef std::function<void(Server&, NodeId&, const UA_NumericRange*, const UA_DataValue*)> ValueFunc;
     typedef std::function<bool(Server&, NodeId&, const UA_NumericRange*, const UA_DataValue&)> ConstDataFunc;
     typedef std::function<void(Server&, NodeId&, const UA_NumericRange*, const UA_DataValue&)> ConstValueFunc;
+    typedef std::function<bool(Server&, const UA_NodeId&, const UA_NumericRange*, UA_DataValue&)> DataViewFunc;
 
 protected:
     UA_StatusCode _lastError;
@@ -38,6 +42,41 @@ protected:
     ConstDataFunc _writeData;
     ValueFunc _readValue;
     ConstValueFunc _writeValue;
+    DataViewFunc _readDataView;
+
+private:
+    // Write coalescing - off unless a window is set
+    struct PendingWrite {
+        DataValue value;
+        UA_DateTime first = 0;       // time of the first write merged into this entry
+        bool dataSource   = false;   // deliver to writeData, otherwise writeValue
+    };
+    UA_DateTime _coalesceWindow = 0;  // in UA_DateTime units
+    Server* _coalesceServer     = nullptr;
+    UnorderedNodeIdMap<PendingWrite> _pending;
+    std::mutex _pendingMutex;
+    bool coalesceWrite(Server& server, const UA_NodeId& node, const UA_DataValue& value, bool dataSource);
+    //
+    // Data source read cache - per node, off unless cacheReads is called
+    struct CachedRead {
+        DataValue value;
+        UA_DateTime when   = 0;  // monotonic time of the read
+        UA_DateTime maxAge = 0;  // in UA_DateTime units
+        bool valid         = false;
+        bool loading       = false;  // a backend read is in flight
+        size_t generation  = 0;      // bumped by each completed read
+        size_t epoch       = 0;      // bumped by invalidateRead - a read started before is not kept
+    };
+    UnorderedNodeIdMap<CachedRead> _readCache;
+    std::mutex _readCacheMutex;
+    std::condition_variable _readCacheCond;
+    std::atomic<size_t> _readCacheSize{0};
+    std::atomic<size_t> _cacheHits{0};
+    std::atomic<size_t> _cacheMisses{0};
+    bool readSource(Server& server, const UA_NodeId& node, const UA_NumericRange* range, UA_DataValue& value);
+    bool readCached(Server& server, const UA_NodeId& node, UA_DataValue& value);
+
+public:
 
 public:
     //
@@ -82,13 +121,93 @@ public:
     /*!
      * \brief ~NodeContext
      */
-    virtual ~NodeContext() {}
+    virtual ~NodeContext();
 
     // accessors
     void setReadData(DataFunc f) { _readData = f; }
     void setWriteData(ConstDataFunc f) { _writeData = f; }
     void setReadValue(ValueFunc f) { _readValue = f; }
     void setWriteValue(ConstValueFunc f) { _writeValue = f; }
+    void setReadDataView(DataViewFunc f) { _readDataView = f; }
+
+    /*!
+        \brief setCoalesceWindow
+        Opt in write coalescing. Whole value writes to the same node within the window are merged and only the
+        last value is passed to writeData / writeValue, from Server::flushCoalescedWrites() in the server loop.
+        Writes with an index range are never coalesced. The client sees the write succeed when it is queued.
+        A derived context that opts in must call stopCoalescing() from its destructor - by the time the base
+        destructor runs a flush in the server loop could call the derived handlers of a half destroyed object
+        \param ms window in milliseconds - 0 turns coalescing off (pending writes are still flushed)
+    */
+    void setCoalesceWindow(unsigned ms) { _coalesceWindow = UA_DATETIME_MSEC * UA_DateTime(ms); }
+
+    /*!
+        \brief stopCoalescing
+        Turn coalescing off and unregister from the server, waiting for a flush in progress, then deliver the
+        merged writes still pending on the calling thread. Call from the destructor of a derived context
+    */
+    void stopCoalescing();
+
+    /*!
+        \brief coalescing
+        \return true if write coalescing is on
+    */
+    bool coalescing() const { return _coalesceWindow > 0; }
+
+    /*!
+        \brief cacheReads
+        Opt a data source node in to read caching. Reads within the node's MinimumSamplingInterval of the last
+        backend read are answered from the cache, and reads that miss while a backend read is in flight wait
+        for it rather than starting another. Reads with an index range and value callbacks are not cached.
+        Call outside the server's callbacks - the interval is read from the node
+        \param server
+        \param node
+        \return true if the interval could be read
+    */
+    bool cacheReads(Server& server, const NodeId& node);
+
+    /*!
+        \brief setCacheAge
+        Cache a node's reads with an explicit age in place of its MinimumSamplingInterval
+        \param node
+        \param ms 0 still collapses concurrent reads into one
+    */
+    void setCacheAge(const NodeId& node, double ms);
+
+    /*!
+        \brief uncacheReads
+        \param node
+    */
+    void uncacheReads(const NodeId& node);
+
+    /*!
+        \brief invalidateRead
+        Drop a node's cached value - done on each write through writeDataSource
+        \param node
+    */
+    void invalidateRead(const UA_NodeId& node);
+
+    size_t cacheHits() const { return _cacheHits; }
+    size_t cacheMisses() const { return _cacheMisses; }
+
+    /*!
+        \brief flushWrites
+        Deliver merged writes whose window has expired
+        \param server
+        \param force deliver everything pending regardless of the window
+        \return number of writes delivered
+    */
+    size_t flushWrites(Server& server, bool force = false);
+
+    /*!
+        \brief pendingWrites
+        \return number of nodes with a merged write waiting
+    */
+    size_t pendingWrites()
+    {
+        std::lock_guard<std::mutex> l(_pendingMutex);
+        return _pending.size();
+    }
 
     /*!
         \brief lastError
@@ -195,6 +314,7 @@ public:
     //
     /*!
         \brief readData
+        Called inside a ScopedArena - Arena::current() can be used for temporaries
         \param node
         \param range
         \param value
@@ -207,6 +327,73 @@ public:
         return false;
     }
 
+    /*!
+        \brief hasReadDataView
+        \return true if data source reads go through readDataView rather than readData
+        Override to true with readDataView in derived classes
+    */
+    virtual bool hasReadDataView() const { return bool(_readDataView); }
+
+    /*!
+        \brief readDataView
+        Fast path data source read - no NodeId wrapper is built. Use publishScalar / publishArray to hand out
+        caller owned buffers without copying them into the data value
+        \param server
+        \param node view of the node id - only valid for the call
+        \param range can be null
+        \param value
+        \return true on success
+    */
+    virtual bool readDataView(Server& server, const UA_NodeId& node, const UA_NumericRange* range, UA_DataValue& value)
+    {
+        if (_readDataView)
+            return _readDataView(server, node, range, value);
+        return false;
+    }
+
+    /*!
+        \brief publishScalar
+        Reference a scalar owned by the caller - it is not copied or freed by the stack.
+        The data must stay valid and unchanged until the service response has been encoded
+        \param value data value to fill
+        \param p pointer to the data
+        \param type data type
+        \return error code
+    */
+    static UA_StatusCode publishScalar(UA_DataValue& value, void* p, const UA_DataType* type);
+
+    /*!
+        \brief publishArray
+        Reference an array owned by the caller - as publishScalar. With a range the selected part is copied
+        \param value data value to fill
+        \param p pointer to the first element
+        \param n number of elements
+        \param type data type
+        \param range can be null
+        \return error code
+    */
+    static UA_StatusCode publishArray(UA_DataValue& value,
+                                      void* p,
+                                      size_t n,
+                                      const UA_DataType* type,
+                                      const UA_NumericRange* range = nullptr);
+
+    /*!
+        \brief publishArray
+        Typed version of publishArray
+        \param value data value to fill
+        \param p pointer to the first element
+        \param n number of elements
+        \param range can be null
+        \return error code
+    */
+    template <typename T>
+    static UA_StatusCode publishArray(UA_DataValue& value, const T* p, size_t n, const UA_NumericRange* range = nullptr)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "publishArray needs a type with ua_type_traits");
+        return publishArray(value, const_cast<T*>(p), n, ua_type_traits<T>::type(), range);
+    }
+
     /*!
         \brief writeData
         \param server
@@ -333,14 +520,78 @@ public:
                                    const UA_DataValue* data);
 };
 
+/*!
+ * \brief The NodeContextRegistry class
+ * Handle based registry of node contexts. Handles index a table of chunks so find() is two atomic loads
+ * with no lock. Registration and the name index take locks. Handles of removed contexts are reused.
+ */
+class UA_EXPORT NodeContextRegistry
+{
+public:
+    typedef uint32_t Handle;
+    static constexpr Handle InvalidHandle = 0;
+
+private:
+    static constexpr size_t ChunkBits = 8;
+    static constexpr size_t ChunkSize = size_t(1) << ChunkBits;
+    static constexpr size_t MaxChunks = 1024;  // up to 256k registered contexts
+    typedef std::atomic<NodeContext*> Slot;
+    static std::atomic<Slot*> _chunks[MaxChunks];
+    static std::mutex _mutex;  // registration
+    static Handle _next;       // next never used handle
+    // function statics - contexts often self register from static constructors in other translation units
+    static std::vector<Handle>& freeList();
+    static ReadWriteMutex& nameMutex();
+    static std::unordered_map<std::string, Handle>& names();  // name shim
+
+public:
+    /*!
+     * \brief add
+     * \param c context to register
+     * \param name optional name - replaces any context already registered with the name
+     * \return handle or InvalidHandle if the table is full
+     */
+    static Handle add(NodeContext* c, const std::string& name = "");
+    /*!
+     * \brief remove
+     * \param h handle to release
+     * \param name name the handle was registered under - only removed from the index if it still maps to h
+     */
+    static void remove(Handle h, const std::string& name = "");
+    /*!
+     * \brief find
+     * \param h
+     * \return context or nullptr
+     */
+    static NodeContext* find(Handle h)
+    {
+        if ((h == InvalidHandle) || ((h >> ChunkBits) >= MaxChunks))
+            return nullptr;
+        Slot* c = _chunks[h >> ChunkBits].load(std::memory_order_acquire);
+        return c ? c[h & (ChunkSize - 1)].load(std::memory_order_acquire) : nullptr;
+    }
+    /*!
+     * \brief handle
+     * \param name
+     * \return handle registered under the name or InvalidHandle
+     */
+    static Handle handle(const std::string& name);
+    /*!
+     * \brief find
+     * \param name
+     * \return context or nullptr - nothing is inserted for unknown names
+     */
+    static NodeContext* find(const std::string& name) { return find(handle(name)); }
+};
+
 /*!
  * \brief The RegisteredNodeContext class
  * Can be used to setup stock call backs
  */
 class RegisteredNodeContext : public NodeContext
 {
-    typedef std::map<std::string, NodeContext*> NodeContextMap;  // map of contexts
-    static NodeContextMap _map;  // map of registered contexts - typically a static instance is used to self register
+    NodeContextRegistry::Handle _handle = NodeContextRegistry::InvalidHandle;
+
 public:
     /*!
      * \brief RegisteredNodeContext
@@ -349,22 +600,34 @@ public:
     RegisteredNodeContext(const std::string& n)
         : NodeContext(n)
     {
-        _map[n] = this;  // self register
+        _handle = NodeContextRegistry::add(this, n);  // self register
     }
     /*!
      * \brief ~RegisteredNodeContext
      */
     virtual ~RegisteredNodeContext()
     {
-        _map.erase(name());  // deregister on delete
+        NodeContextRegistry::remove(_handle, name());  // deregister on delete
     }
 
+    /*!
+     * \brief handle
+     * \return registry handle - keep this rather than the name for fast lookups
+     */
+    NodeContextRegistry::Handle handle() const { return _handle; }
+
     /*!
      * \brief findRef
      * \param s
      * \return
      */
-    static NodeContext* findRef(const std::string& s) { return _map[s]; }
+    static NodeContext* findRef(const std::string& s) { return NodeContextRegistry::find(s); }
+    /*!
+     * \brief findRef
+     * \param h
+     * \return
+     */
+    static NodeContext* findRef(NodeContextRegistry::Handle h) { return NodeContextRegistry::find(h); }
 };
 
 }  // namespace Open62541
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef NODESET_H
+#define NODESET_H
+#include <open62541cpp/open62541objects.h>
+#include <iosfwd>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The NodeSetImporter class
+    Loads a NodeSet2 XML model (Part 6 F) into a running server. The file is read as a stream of elements -
+    there is no document tree - so memory grows with the references of the model, not the size of the file.
+    Each node goes into the nodestore as soon as its element closes, as ServerSnapshot::load does. Its
+    references are kept until the end of the file and then added in one pass, so a reference may name a node
+    that comes later. Reference types go through the server so it records their supertypes.
+    Namespaces are added by URI and indexes remapped; aliases are resolved. Values of the built in types
+    and their ListOf arrays are loaded; ExtensionObject values and DataType definitions are skipped and counted.
+    Nodes that exist already - namespace zero for one - are skipped. Takes the server lock throughout, so
+    import before the server runs or expect other clients to wait
+*/
+class UA_EXPORT NodeSetImporter
+{
+    Server& _server;
+    size_t _nodes       = 0;
+    size_t _references  = 0;
+    size_t _skipped     = 0;  // nodes or references the server refused
+    size_t _unsupported = 0;  // values and definitions not loaded
+    size_t _line        = 0;  // of a syntax error
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+public:
+    /*!
+        \brief NodeSetImporter
+        \param s server the nodes are added to
+    */
+    explicit NodeSetImporter(Server& s)
+        : _server(s)
+    {
+    }
+    NodeSetImporter(const NodeSetImporter&) = delete;
+    NodeSetImporter& operator=(const NodeSetImporter&) = delete;
+
+    /*!
+        \brief load
+        \param in NodeSet2 XML
+        \return true if the document was read to the end - see skipped() and unsupported()
+    */
+    bool load(std::istream& in);
+    /*!
+        \brief load
+        \param file NodeSet2 XML file
+        \return true if the file was read to the end
+    */
+    bool load(const std::string& file);
+
+    size_t nodes() const { return _nodes; }              //!< nodes added
+    size_t references() const { return _references; }    //!< references added
+    size_t skipped() const { return _skipped; }          //!< nodes and references not added
+    size_t unsupported() const { return _unsupported; }  //!< values and definitions not loaded
+    size_t errorLine() const { return _line; }           //!< line of a syntax error
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+/*!
+    \brief The NodeSetExporter class
+    Writes the nodes of a server above namespace zero as NodeSet2 XML. Nodes are written one at a time
+    straight to the stream, so the model is never held in memory as a document. Every reference of an
+    exported node is listed on it. Values of the built in types are written; other values are left out and
+    counted
+*/
+class UA_EXPORT NodeSetExporter
+{
+    Server& _server;
+    size_t _nodes       = 0;
+    size_t _unsupported = 0;  // values not written
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+public:
+    /*!
+        \brief NodeSetExporter
+        \param s server whose nodes are written
+    */
+    explicit NodeSetExporter(Server& s)
+        : _server(s)
+    {
+    }
+    NodeSetExporter(const NodeSetExporter&) = delete;
+    NodeSetExporter& operator=(const NodeSetExporter&) = delete;
+
+    /*!
+        \brief save
+        Write every node above namespace zero - takes the server lock
+        \param out
+        \return true if the stream took it all
+    */
+    bool save(std::ostream& out);
+    /*!
+        \brief save
+        \param file replaced once it is written
+        \return true on success
+    */
+    bool save(const std::string& file);
+
+    size_t nodes() const { return _nodes; }              //!< nodes written
+    size_t unsupported() const { return _unsupported; }  //!< values not written
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // NODESET_H
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef NODESTORE_H
+#define NODESTORE_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The Nodestore class
+    C++ base for an open62541 nodestore plugin (UA_Nodestore). Each virtual is one entry of the plugin table and
+    keeps its contract - see open62541/plugin/nodestore.h. Give an instance to the Server(Nodestore&, ...)
+    constructor; it must outlive the server, which calls clear() as it is deleted
+*/
+class UA_EXPORT Nodestore
+{
+public:
+    virtual ~Nodestore() {}
+
+    /*!
+        \brief plug
+        Point a plugin table at this store
+        \param ns
+    */
+    void plug(UA_Nodestore& ns);
+
+    /*!
+        \brief clear
+        Delete every node - the store may be used again
+    */
+    virtual void clear() = 0;
+    /*!
+        \brief newNode
+        \param nodeClass
+        \return a zeroed node of the class, not yet in the store
+    */
+    virtual UA_Node* newNode(UA_NodeClass nodeClass) = 0;
+    /*!
+        \brief deleteNode
+        Delete a node from newNode or getNodeCopy that was not inserted
+        \param node
+    */
+    virtual void deleteNode(UA_Node* node) = 0;
+    /*!
+        \brief getNode
+        \param nodeId
+        \return the node, held until releaseNode - null if absent
+    */
+    virtual const UA_Node* getNode(const UA_NodeId& nodeId) = 0;
+    /*!
+        \brief releaseNode
+        \param node from getNode
+    */
+    virtual void releaseNode(const UA_Node* node) = 0;
+    /*!
+        \brief getNodeCopy
+        \param nodeId
+        \param outNode set to an editable copy for replaceNode
+        \return status
+    */
+    virtual UA_StatusCode getNodeCopy(const UA_NodeId& nodeId, UA_Node** outNode) = 0;
+    /*!
+        \brief insertNode
+        Take ownership of a node - a numeric id of 0 asks for a fresh id in its namespace
+        \param node
+        \param addedNodeId set to the id used if not null
+        \return status - the node is deleted on failure
+    */
+    virtual UA_StatusCode insertNode(UA_Node* node, UA_NodeId* addedNodeId) = 0;
+    /*!
+        \brief replaceNode
+        Replace the node a copy was taken from - fails if it was replaced meanwhile
+        \param node from getNodeCopy - always taken
+        \return status
+    */
+    virtual UA_StatusCode replaceNode(UA_Node* node) = 0;
+    /*!
+        \brief removeNode
+        \param nodeId
+        \return status
+    */
+    virtual UA_StatusCode removeNode(const UA_NodeId& nodeId) = 0;
+    /*!
+        \brief getReferenceTypeId
+        \param index reference type index given to a ReferenceType node as it was inserted
+        \return its node id or null
+    */
+    virtual const UA_NodeId* getReferenceTypeId(UA_Byte index) = 0;
+    /*!
+        \brief iterate
+        \param visitor called for each node
+        \param context passed to the visitor
+    */
+    virtual void iterate(UA_NodestoreVisitor visitor, void* context) = 0;
+};
+
+/*!
+    \brief The NumericNodestore class
+    Nodestore for large address spaces with dense numeric node ids. Numeric ids below a limit are found by
+    direct index into an array per namespace - no hashing and no comparison - and all other ids through a hash
+    table. Nodes are held in slabs of fixed size entries rather than one allocation each, so a million nodes
+    cost a few thousand allocations and lie close together in memory. Fresh ids are handed out densely from
+    the lowest free id of the namespace.
+    Lookups share a lock and may run from several threads; changes are exclusive
+*/
+class UA_EXPORT NumericNodestore : public Nodestore
+{
+    struct Entry {
+        UA_Node node;                     // first - a node pointer is its entry
+        Entry* orig     = nullptr;        // the entry a copy was taken from
+        Entry* nextFree = nullptr;        // free list link
+        std::atomic<UA_UInt32> state{0};  // holders of getNode, plus Deleted once out of the index
+    };
+    enum : UA_UInt32 { Deleted = 0x80000000u };
+    struct Namespace {
+        std::vector<Entry*> direct;  // by numeric id
+        UA_UInt32 next = 1;          // lowest id that may be free
+    };
+
+    mutable ReadWriteMutex _mutex;  // the index
+    std::vector<Namespace> _namespaces;
+    UnorderedNodeIdMap<Entry*> _hashed;
+    UA_UInt32 _directLimit = 1u << 24;
+    size_t _size           = 0;
+    size_t _direct         = 0;
+    UA_NodeId _referenceTypeIds[UA_REFERENCETYPESET_MAX];
+    UA_Byte _referenceTypes = 0;
+    //
+    std::mutex _allocMutex;  // the slabs
+    std::vector<std::unique_ptr<Entry[]>> _slabs;
+    size_t _slabSize = 4096;
+    Entry* _free     = nullptr;
+    size_t _used     = 0;
+
+    Entry* allocate();
+    void recycle(Entry* e);
+    void retire(Entry* e);
+    static Entry* entry(const UA_Node* n) { return reinterpret_cast<Entry*>(const_cast<UA_Node*>(n)); }
+    Entry* find(const UA_NodeId& id) const;
+    Entry** slot(const UA_NodeId& id, bool create);
+    void erase(const UA_NodeId& id);
+    bool assignId(UA_NodeId& id);
+
+public:
+    /*!
+        \brief NumericNodestore
+        \param directLimit numeric ids below this are indexed directly - larger ones are hashed
+        \param slabSize entries allocated at a time
+    */
+    NumericNodestore(UA_UInt32 directLimit = 1u << 24, size_t slabSize = 4096);
+    virtual ~NumericNodestore();
+    NumericNodestore(const NumericNodestore&) = delete;
+    NumericNodestore& operator=(const NumericNodestore&) = delete;
+
+    void clear() override;
+    UA_Node* newNode(UA_NodeClass nodeClass) override;
+    void deleteNode(UA_Node* node) override;
+    const UA_Node* getNode(const UA_NodeId& nodeId) override;
+    void releaseNode(const UA_Node* node) override;
+    UA_StatusCode getNodeCopy(const UA_NodeId& nodeId, UA_Node** outNode) override;
+    UA_StatusCode insertNode(UA_Node* node, UA_NodeId* addedNodeId) override;
+    UA_StatusCode replaceNode(UA_Node* node) override;
+    UA_StatusCode removeNode(const UA_NodeId& nodeId) override;
+    const UA_NodeId* getReferenceTypeId(UA_Byte index) override;
+    void iterate(UA_NodestoreVisitor visitor, void* context) override;
+
+    /*!
+        \brief size
+        \return nodes in the store
+    */
+    size_t size() const
+    {
+        ReadLock l(_mutex);
+        return _size;
+    }
+    /*!
+        \brief directCount
+        \return nodes found by direct index
+    */
+    size_t directCount() const
+    {
+        ReadLock l(_mutex);
+        return _direct;
+    }
+    /*!
+        \brief bytes
+        \return memory held by the slabs and the direct arrays
+    */
+    size_t bytes();
+};
+
+}  // namespace Open62541
+
+#endif  // NODESTORE_H
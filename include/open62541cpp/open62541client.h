@@ -13,6 +13,19 @@
 #define OPEN62541CLIENT_H
 #include <open62541cpp/open62541objects.h>
 #include <open62541cpp/clientsubscription.h>
+#include <open62541cpp/timerwheel.h>
+#include <open62541cpp/methodbinding.h>
+#include <open62541cpp/discoverycache.h>
+#include <open62541cpp/browsecache.h>
+#include <open62541cpp/metrics.h>
+#include <open62541cpp/mpscqueue.h>
+#include <open62541cpp/memoryreport.h>
+#include <open62541cpp/trafficrecorder.h>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
 
 /*
     OPC nodes are just data objects they do not need to be in a property tree
@@ -39,7 +52,7 @@ public:
 // dictionary of subscriptions associated with a Client
 typedef std::shared_ptr<ClientSubscription> ClientSubscriptionRef;
 //
-typedef std::map<UA_UInt32, ClientSubscriptionRef> ClientSubscriptionMap;
+typedef SnapshotMap<UA_UInt32, ClientSubscriptionRef> ClientSubscriptionMap;  // read without locking
 //
 /*!
     \brief The Client class
@@ -54,6 +67,10 @@ class Client
 {
 
 public:
+    // locks taken in the scope of the client record their wait time - see Metrics::TimedLock
+    typedef Metrics::TimedLock<Open62541::WriteLock> WriteLock;
+    typedef Metrics::TimedLock<Open62541::ReadLock> ReadLock;
+
     enum ConnectionType { NONE, CONNECTION, ASYNC, SECURE, SECUREASYNC };
 
     /*!
@@ -64,6 +81,8 @@ public:
         Client* _client = nullptr;
         UA_UInt64 _id   = 0;
         bool _oneShot   = false;
+        UA_DateTime _due    = 0;  // next expiry on the monotonic clock - 0 if not known
+        UA_DateTime _period = 0;
         std::function<void(Timer&)> _handler;
 
     public:
@@ -75,7 +94,13 @@ public:
             , _handler(func)
         {
         }
-        virtual ~Timer() { UA_Client_removeCallback(_client->client(), _id); }
+        virtual ~Timer()
+        {
+            if (TimerWheel::isWheelId(_id))
+                _client->_wheel.cancel(_id);
+            else
+                UA_Client_removeCallback(_client->client(), _id);
+        }
         virtual void handle()
         {
             if (_handler)
@@ -85,6 +110,18 @@ public:
         UA_UInt64 id() const { return _id; }
         void setId(UA_UInt64 i) { _id = i; }
         bool oneShot() const { return _oneShot; }
+        /*!
+            \brief setDue
+            \param due first expiry
+            \param period repeat interval - 0 for a one shot
+        */
+        void setDue(UA_DateTime due, UA_DateTime period = 0)
+        {
+            _due    = due;
+            _period = period;
+        }
+        UA_DateTime due() const { return _due; }
+        void rearm(UA_DateTime now) { _due = _period ? now + _period : 0; }
     };
 
     typedef std::unique_ptr<Timer> TimerPtr;
@@ -92,8 +129,67 @@ public:
 private:
     UA_Client* _client = nullptr;
     ReadWriteMutex _mutex;
+    PathCache _pathCache{false};  // resolved browse paths - opt in
+    PathCache _translateCache;    // translatePaths results - cleared per session
+    DiscoveryCacheRef _discovery;  // shared discovery results - kept alive while the client uses them
+    BrowseCache* _browseCache  = nullptr;  // browse results - not owned
+    //
+    // server namespace array - read once per session
+    std::mutex _namespaceMutex;
+    std::vector<std::string> _namespaces;
+    bool _namespacesKnown = false;
+    //
+    // operation limits for batched reads and writes - read from the server once per connection
+    bool _limitsKnown            = false;
+    UA_UInt32 _maxNodesPerRead   = 0;  // 0 = no limit
+    UA_UInt32 _maxNodesPerWrite  = 0;
+    UA_UInt32 _maxMonitoredItemsPerCall = 0;
+    UA_UInt32 _maxBatch          = 0;  // client side cap - 0 = none
+
+public:
+    /*!
+        \brief AsyncHandler
+        Completion for a request sent with sendAsync. Called once with the service result and the decoded
+        response, which is only valid for the duration of the call
+    */
+    typedef std::function<void(UA_StatusCode, void*)> AsyncHandler;
+
+private:
+    std::mutex _asyncMutex;
+    std::map<UA_UInt32, AsyncHandler> _asyncHandlers;  // outstanding requests by request id
+    std::atomic<std::thread::id> _asyncHandlerThread{};  // the thread running a sendAsync handler, if any
     //
     ClientSubscriptionMap _subscriptions;
+    std::vector<std::pair<UA_UInt32, ClientSubscriptionRef>> _suspended;  // old id and subscription to recreate
+    bool _autoRecover    = false;
+    bool _recoverPending = false;
+    SubscriptionValueCache* _valueCache = nullptr;  // not owned
+    //
+    // registered nodes - keyed by the id registered, which is also the caller's handle
+    struct Registration {
+        NodeId node;     // the id registered
+        NodeId current;  // the id the server gave it for this session
+    };
+    typedef std::shared_ptr<const Registration> RegistrationRef;
+    typedef std::unordered_map<UA_NodeId, RegistrationRef, NodeIdHash, NodeIdEqual> RegisterIndex;  // keys in values
+    std::shared_ptr<const RegisterIndex> _registered = std::make_shared<const RegisterIndex>();  // atomic_load
+    std::mutex _registerMutex;  // serialises changes - readers take a snapshot
+    std::shared_ptr<const RegisterIndex> registered() const { return std::atomic_load(&_registered); }
+    void publishRegistered(const std::shared_ptr<RegisterIndex>& m)
+    {
+        std::atomic_store(&_registered, std::shared_ptr<const RegisterIndex>(m));
+    }
+    bool _reregisterPending = false;
+    //
+    std::map<std::string, MemoryReport::Source> _memorySources;  // structures not owned - see memoryReport
+    std::mutex _memoryMutex;
+    std::atomic<TrafficRecorder*> _recorder{nullptr};  // not owned
+    //
+    // secure channel renewal - estimated, the stack does not publish its schedule
+    std::atomic<UA_DateTime> _nextRenewal{0};  // monotonic - 0 while no channel is open
+    std::atomic<UA_DateTime> _lastRenewal{0};  // monotonic - when the last renewal was sent
+    std::atomic<size_t> _renewals{0};
+    std::atomic<UA_UInt64> _lastRenewalNs{0};  // duration of the iteration that sent it
     //
     // Track states to trigger notifications of changes
     UA_SecureChannelState _lastSecureChannelState = UA_SECURECHANNELSTATE_CLOSED;
@@ -101,7 +197,18 @@ private:
     //
     ConnectionType _connectionType = ConnectionType::NONE;
 
+    TimerWheel _wheel;                        // timers driven by one repeated callback - before _timerMap
+    unsigned _wheelTick        = 0;           // 0 = timers go to the C library scheduler
+    bool _wheelGrouped         = true;        // batch repeating timers of the same interval
+    UA_UInt64 _wheelCallbackId = 0;           // the driving repeated callback
     std::map<UA_UInt64, TimerPtr> _timerMap;  // one map per client
+    //
+    // event driven run mode
+    MpscQueue<std::function<void(Client&)>> _commands{1024};  // posted from any thread - run by the loop
+    int _wakeFd[2]       = {-1, -1};  // self pipe - a byte written wakes runEvents
+    int _socketFd        = -1;        // connection socket captured when the stack opens it
+    unsigned _idleWaitMs = 1000;      // longest block with nothing due
+    UA_ConnectClientConnection _initConnection = nullptr;  // the stack's connection factory
 
     // status
     UA_SecureChannelState _channelState = UA_SECURECHANNELSTATE_CLOSED;
@@ -117,6 +224,17 @@ private:
                               UA_SecureChannelState channelState,
                               UA_SessionState sessionState,
                               UA_StatusCode connectStatus);
+    /*!
+        \brief renewalPeriod
+        \return three quarters of the requested channel lifetime - when the stack renews
+    */
+    UA_DateTime renewalPeriod() const;
+    /*!
+        \brief renewingIterate
+        Run an iteration the stack renews the channel in and time it
+        \param interval
+    */
+    void renewingIterate(uint32_t interval);
     /*!
         \brief asyncConnectCallback
         \param client
@@ -143,6 +261,7 @@ private:
         if (data) {
             Timer* t = static_cast<Timer*>(data);
             if (t) {
+                t->rearm(UA_DateTime_nowMonotonic());
                 t->handle();
                 if (t->oneShot()) {
                     // Potential risk of the client disappearing
@@ -152,11 +271,64 @@ private:
         }
     }
 
+    static void wheelCallback(UA_Client* /*client*/, void* data)
+    {
+        if (data) {
+            static_cast<Client*>(data)->_wheel.advance(UA_DateTime_nowMonotonic());
+        }
+    }
+
+    /*!
+        \brief handleTimer
+        \param id wheel timer to run - ignored if it no longer exists
+    */
+    void handleTimer(UA_UInt64 id)
+    {
+        auto i = _timerMap.find(id);
+        if (i != _timerMap.end()) {
+            bool oneShot = i->second->oneShot();
+            Metrics::Scope timing(Metrics::TimerCallback);
+            i->second->handle();
+            if (oneShot) {
+                _timerMap.erase(id);  // handle() may already have removed it
+            }
+        }
+    }
+
+    /*!
+        \brief addWheelTimerEvent
+        \param delayMs
+        \param intervalMs zero for a one shot
+        \param callbackId set to the wheel id
+        \param func
+        \return true on success
+    */
+    bool addWheelTimerEvent(unsigned delayMs,
+                            unsigned intervalMs,
+                            UA_UInt64& callbackId,
+                            std::function<void(Timer&)> func)
+    {
+        callbackId = 0;
+        if (!_wheelCallbackId) {
+            _lastError =
+                UA_Client_addRepeatedCallback(_client, Client::wheelCallback, this, _wheelTick, &_wheelCallbackId);
+            if (!lastOK()) {
+                _wheelCallbackId = 0;
+                return false;
+            }
+        }
+        callbackId = _wheel.add(delayMs, intervalMs, [this](UA_UInt64 id) { handleTimer(id); }, _wheelGrouped);
+        _timerMap[callbackId] = TimerPtr(new Timer(this, callbackId, intervalMs == 0, func));
+        _lastError            = UA_STATUSCODE_GOOD;
+        return true;
+    }
+
 public:
     // must connect to have a valid client
     Client()
         : _client(nullptr)
     {
+        openWake();
     }
 
     /*!
@@ -169,6 +341,7 @@ public:
             disconnect();
             UA_Client_delete(_client);
         }
+        closeWake();
     }
 
     /*!
@@ -184,13 +357,40 @@ public:
 
     /*!
      * \brief runIterate
+     * Call without holding mutex(). The client lock is taken for the stack iteration only, so the follow up
+     * requests (subscription adjustment, recovery, registration) take it per request like any other service
      * \param interval
      * \return
      */
     bool runIterate(uint32_t interval = 100)
     {
         if (_client && (_connectStatus == UA_STATUSCODE_GOOD)) {
-            _lastError = UA_Client_run_iterate(_client, interval);
+            // a sendAsync handler pumping the client already holds the lock
+            const bool nested = (_asyncHandlerThread.load() == std::this_thread::get_id());
+            {
+                std::unique_ptr<WriteLock> l;
+                if (!nested)
+                    l.reset(new WriteLock(_mutex));
+                if (renewalDue()) {
+                    renewingIterate(interval);  // the stack renews the channel in this iteration
+                }
+                else {
+                    _lastError = UA_Client_run_iterate(_client, interval);
+                }
+            }
+            ClientSubscriptionMap::MapRef current = _subscriptions.snapshot();
+            for (auto& s : *current) {
+                if (s.second) {
+                    s.second->flushNotifications();  // batched data changes from this iteration
+                    s.second->adapt(!nested);
+                }
+            }
+            if (_reregisterPending && (_sessionState == UA_SESSIONSTATE_ACTIVATED)) {
+                reregisterNodes(!nested);
+            }
+            if (_recoverPending && (_sessionState == UA_SESSIONSTATE_ACTIVATED)) {
+                recoverSubscriptions(!nested);  // outside the stack's callbacks - services can be called
+            }
             return lastOK();
         }
         return false;
@@ -206,22 +406,133 @@ public:
             ;  // runs until disconnect
         return true;
     }
+
+    /*!
+        \brief runEvents
+        Event driven alternative to run(). Blocks on the connection socket and the wake pipe until the next
+        timer is due, so an idle client does not poll and posted commands run as soon as they are queued.
+        \return true on success
+    */
+    bool runEvents()
+    {
+        while (runWait() && process())
+            ;  // runs until disconnect
+        return true;
+    }
+
+    /*!
+        \brief runWait
+        One event driven iteration - wait for the socket, a wake up or the next deadline, then run posted
+        commands and service the connection without blocking
+        \param maxWaitMs upper bound on the wait - 0 for the idle wait
+        \return false once disconnected
+    */
+    bool runWait(unsigned maxWaitMs = 0);
+
+    /*!
+        \brief nextDeadline
+        \param capMs the longest wait to allow
+        \return milliseconds until the next timer is due, at most capMs
+    */
+    unsigned nextDeadline(unsigned capMs) const;
+
+    /*!
+        \brief setIdleWait
+        Longest runWait blocks with no timer due. Bounds the delay of the stack's own housekeeping such as
+        secure channel renewal and request timeouts
+        \param ms
+    */
+    void setIdleWait(unsigned ms) { _idleWaitMs = ms ? ms : 1; }
+    unsigned idleWait() const { return _idleWaitMs; }
+
+    /*!
+        \brief postCommand
+        Queue a function to run on the thread pumping the client and wake it. Lock free, callable from any thread
+        \param fn
+        \return false if the queue is full (the function is not run)
+    */
+    bool postCommand(std::function<void(Client&)> fn)
+    {
+        if (!_commands.push(fn))
+            return false;
+        wake();
+        return true;
+    }
+
+    /*!
+        \brief wake
+        Wake a blocked runWait - callable from any thread
+    */
+    void wake();
+
+    /*!
+        \brief runCommands
+        \return number of posted commands run
+    */
+    size_t runCommands();
+
+private:
+    void openWake();
+    void closeWake();
+    void drainWake();
+    void captureConnection();
+    static UA_Connection initConnection(UA_ConnectionConfig config,
+                                        UA_String endpointUrl,
+                                        UA_UInt32 timeout,
+                                        const UA_Logger* logger);
+    /*!
+        \brief browseChanged
+        Invalidate the cached browses of a node changed through this object
+        \param n node
+        \param inverse references to or from it have gone
+    */
+    void browseChanged(const NodeId& n, bool inverse = false)
+    {
+        if (_browseCache)
+            _browseCache->invalidate(n, inverse);
+    }
+    //
+    // recording of the single node services - the requests are built only when recording
+    void recordRead(TrafficRecorder& r,
+                    TrafficRecorder::Clock::time_point start,
+                    const UA_NodeId& nodeId,
+                    UA_AttributeId attributeId);
+    void recordWrite(TrafficRecorder& r,
+                     TrafficRecorder::Clock::time_point start,
+                     const UA_NodeId& nodeId,
+                     UA_AttributeId attributeId,
+                     const void* in,
+                     const UA_DataType* inDataType);
+    void recordCall(TrafficRecorder& r,
+                    TrafficRecorder::Clock::time_point start,
+                    const UA_NodeId& objectId,
+                    const UA_NodeId& methodId,
+                    const VariantList& in);
+
+public:
     /*!
      * \brief initialise
      */
     void initialise()
     {
         if (_client) {
-            disconnect();
+            disconnect(true);
             UA_Client_delete(_client);
-            _client = nullptr;
+            _client          = nullptr;
+            _wheelCallbackId = 0;  // removed with the client
         }
         _client = UA_Client_new();
+        // a fresh client has no history - stale state would make a reconnect look failed
+        _channelState  = UA_SECURECHANNELSTATE_CLOSED;
+        _sessionState  = UA_SESSIONSTATE_CLOSED;
+        _connectStatus = UA_STATUSCODE_GOOD;
+        _limitsKnown   = false;
         if (_client) {
             UA_ClientConfig_setDefault(UA_Client_getConfig(_client));  // initalise the client structure
             UA_Client_getConfig(_client)->clientContext                  = this;
             UA_Client_getConfig(_client)->stateCallback                  = stateCallback;
             UA_Client_getConfig(_client)->subscriptionInactivityCallback = subscriptionInactivityCallback;
+            captureConnection();  // socket for runWait
         }
     }
     /*!
@@ -255,6 +566,91 @@ public:
         \return map of subscriptions
     */
     ClientSubscriptionMap& subscriptions() { return _subscriptions; }
+
+    /*!
+        \brief setAutoRecover
+        When set, subscriptions survive a lost session or a reconnect through this object. Their definitions
+        are kept and they are recreated - monitored items in bulk - once a new session is activated.
+        OPC UA TransferSubscriptions is not used as the stack drops its local subscription state with the
+        session, so a transferred subscription could not be dispatched.
+        Recovered subscriptions get new ids - see subscriptionRecovered
+        \param on enable recovery
+    */
+    void setAutoRecover(bool on) { _autoRecover = on; }
+
+    /*!
+        \brief autoRecover
+        \return true if subscriptions are recovered
+    */
+    bool autoRecover() const { return _autoRecover; }
+
+    /*!
+        \brief suspendSubscriptions
+        Detaches the subscriptions from the current session, keeping their definitions
+    */
+    void suspendSubscriptions();
+
+    /*!
+        \brief recoverSubscriptions
+        Recreates suspended subscriptions - called from runIterate once a session is active
+        \param lock take the client lock per request
+        \return true if every subscription was recreated - failures stay suspended
+    */
+    bool recoverSubscriptions(bool lock = true);
+
+    /*!
+        \brief suspendedSubscriptions
+        \return number of subscriptions waiting to be recreated
+    */
+    size_t suspendedSubscriptions() const { return _suspended.size(); }
+
+    /*!
+        \brief subscriptionRecovered
+        Called when a suspended subscription has been recreated
+        \param oldId id on the lost session
+        \param newId id on the new session
+    */
+    virtual void subscriptionRecovered(UA_UInt32 /*oldId*/, UA_UInt32 /*newId*/) {}
+
+    /*!
+        \brief setValueCache
+        Data change items created after this feed the cache - it must outlive them
+        \param c cache or null
+    */
+    void setValueCache(SubscriptionValueCache* c) { _valueCache = c; }
+
+    /*!
+        \brief valueCache
+        \return the value cache or null
+    */
+    SubscriptionValueCache* valueCache() const { return _valueCache; }
+
+    /*!
+        \brief readValueCached
+        Serves a subscribed node from the value cache, reading from the server only if the cached value is
+        missing or stale
+        \param nodeId node to read
+        \param out value
+        \param allowStale return a stale cached value instead of reading
+        \return true on success
+    */
+    bool readValueCached(const NodeId& nodeId, DataValue& out, bool allowStale = false)
+    {
+        if (_valueCache) {
+            SubscriptionValueCache::Freshness f = _valueCache->read(nodeId, out);
+            if ((f == SubscriptionValueCache::Freshness::Fresh) ||
+                (allowStale && (f == SubscriptionValueCache::Freshness::Stale))) {
+                _lastError = UA_STATUSCODE_GOOD;
+                return true;
+            }
+        }
+        std::vector<NodeId> n(1, nodeId);
+        std::vector<DataValue> v;
+        if (!readValues(n, v))
+            return false;
+        out = v[0];
+        return true;
+    }
     /*!
         \brief addSubscription
         \param newId receives Id of created subscription
@@ -270,8 +666,8 @@ public:
         }
         //
         if (c->create()) {
-            newId                  = c->id();
-            subscriptions()[newId] = c;
+            newId = c->id();
+            subscriptions().set(newId, c);
             return true;
         }
         //
@@ -285,23 +681,25 @@ public:
     */
     bool removeSubscription(UA_UInt32 Id)
     {
-        subscriptions().erase(Id);  // remove from dictionary implicit delete
+        subscriptions().erase(Id);  // remove from dictionary - deleted once no reader holds it
         return true;
     }
 
     /*!
         \brief subscription
+        The pointer is valid until the subscription is removed - use it on the thread running the client and
+        removing subscriptions, or hold a subscriptionRef
         \param Id
         \return pointer to subscription object or null
     */
-    ClientSubscription* subscription(UA_UInt32 Id)
-    {
-        if (subscriptions().find(Id) != subscriptions().end()) {
-            ClientSubscriptionRef& c = subscriptions()[Id];
-            return c.get();
-        }
-        return nullptr;
-    }
+    ClientSubscription* subscription(UA_UInt32 Id) { return subscriptions().find(Id).get(); }
+
+    /*!
+        \brief subscriptionRef
+        \param Id
+        \return the subscription, kept while the reference is held - callable from any thread
+    */
+    ClientSubscriptionRef subscriptionRef(UA_UInt32 Id) { return subscriptions().find(Id); }
 
     //
     // Connection state handlers
@@ -363,6 +761,10 @@ public:
     */
     bool getEndpoints(const std::string& serverUrl, EndpointDescriptionArray& list)
     {
+        if (_discovery) {
+            _lastError = _discovery->getEndpoints(serverUrl, list);
+            return lastOK();
+        }
         if (!_client)
             return false;
         WriteLock l(_mutex);
@@ -390,6 +792,10 @@ public:
                      StringArray& localeIds,
                      ApplicationDescriptionArray& registeredServers)
     {
+        if (_discovery && (serverUris.length() == 0) && (localeIds.length() == 0)) {
+            _lastError = _discovery->findServers(serverUrl, registeredServers);
+            return lastOK();
+        }
         if (!_client)
             return false;
         WriteLock l(_mutex);
@@ -420,6 +826,11 @@ public:
                               StringArray& serverCapabilityFilter,
                               ServerOnNetworkArray& serverOnNetwork)
     {
+        if (_discovery && (startingRecordId == 0) && (maxRecordsToReturn == 0) &&
+            (serverCapabilityFilter.length() == 0)) {
+            _lastError = _discovery->findServersOnNetwork(serverUrl, serverOnNetwork);
+            return lastOK();
+        }
         if (!_client)
             return false;
         WriteLock l(_mutex);
@@ -445,8 +856,15 @@ public:
     {
         if (!_client)
             return false;
+        NodeId current;
+        if (translate(*nodeId, current))
+            nodeId = current.constRef();
         WriteLock l(_mutex);
+        TrafficRecorder* r = recorder();
+        const auto start   = TrafficRecorder::startTime(r);
         _lastError = __UA_Client_readAttribute(_client, nodeId, attributeId, out, outDataType);
+        if (r)
+            recordRead(*r, start, *nodeId, attributeId);
         return lastOK();
     }
 
@@ -465,8 +883,15 @@ public:
     {
         if (!_client)
             return false;
+        NodeId current;
+        if (translate(*nodeId, current))
+            nodeId = current.constRef();
         WriteLock l(_mutex);
+        TrafficRecorder* r = recorder();
+        const auto start   = TrafficRecorder::startTime(r);
         _lastError = __UA_Client_writeAttribute(_client, nodeId, attributeId, in, inDataType);
+        if (r)
+            recordWrite(*r, start, *nodeId, attributeId, in, inDataType);
         return lastOK();
     }
 
@@ -631,14 +1056,22 @@ public:
         \brief disconnect
         \return
     */
-    bool disconnect()
+    bool disconnect(bool keepSubscriptions = false)
     {
         WriteLock l(_mutex);
         if (!_client)
             throw std::runtime_error("Null client");
-        // close subscriptions
-        subscriptions().clear();
+        // close subscriptions - or keep their definitions for the next session
+        if (keepSubscriptions && _autoRecover) {
+            suspendSubscriptions();
+        }
+        else {
+            subscriptions().clear();
+            _suspended.clear();
+            _recoverPending = false;
+        }
         _timerMap.clear();  // remove timer objects
+        _limitsKnown    = false;
         _lastError      = UA_Client_disconnect(_client);
         _connectionType = ConnectionType::NONE;
         return lastOK();
@@ -653,6 +1086,7 @@ public:
         if (!_client)
             throw std::runtime_error("Null client");
         _timerMap.clear();  // remove timer objects
+        _limitsKnown    = false;
         _lastError      = UA_Client_disconnectAsync(_client);
         _connectionType = ConnectionType::NONE;
         return lastOK();
@@ -676,9 +1110,43 @@ public:
 
     /*!
         \brief manuallyRenewSecureChannel
-        \return
+        open62541 1.2 cannot be told to renew early - the stack renews at three quarters of the channel lifetime
+        in whichever iteration runs next. When that point has passed this runs the iteration now, without
+        waiting on the socket, so a background thread takes the renewal instead of the next request
+        \return true if a renewal was due and the iteration succeeded
+    */
+    bool manuallyRenewSecureChannel()
+    {
+        if (!renewalDue())
+            return false;
+        WriteLock l(_mutex);
+        return runIterate(0);
+    }
+
+    /*!
+        \brief nextRenewal
+        Estimated from the requested channel lifetime - the server may revise it down
+        \return monotonic time (UA_DateTime_nowMonotonic) the channel is next renewed - 0 if none is open
+    */
+    UA_DateTime nextRenewal() const { return _nextRenewal; }
+    /*!
+        \brief renewalDue
+        \return true if the estimated renewal point has passed and no iteration has run since
     */
-    bool manuallyRenewSecureChannel() { return false; }
+    bool renewalDue() const
+    {
+        const UA_DateTime next = _nextRenewal;
+        return next && (UA_DateTime_nowMonotonic() >= next);
+    }
+    /*!
+        \brief renewing
+        Requests sent now may wait on a renewal - see ClientPool::setRenewalGuard
+        \param ms window either side of a renewal
+        \return true if within ms before the next estimated renewal or ms after the last one was sent
+    */
+    bool renewing(UA_UInt32 ms) const;
+    size_t renewals() const { return _renewals; }                // renewals seen by runIterate
+    UA_UInt64 lastRenewalNs() const { return _lastRenewalNs; }  // also recorded as Metrics::ChannelRenewal
 
     /*!  Gets a list of endpoints of a server
 
@@ -703,17 +1171,81 @@ public:
         @return Indicates whether the operation succeeded or returns an error code */
     int namespaceGetIndex(const std::string& namespaceUri)
     {
-        WriteLock l(_mutex);
         if (!_client)
             throw std::runtime_error("Null client");
-        int namespaceIndex = 0;
-        UA_String s        = toUA_String(namespaceUri);
-        if (UA_Client_NamespaceGetIndex(_client, &s, (UA_UInt16*)(&namespaceIndex)) == UA_STATUSCODE_GOOD) {
-            return namespaceIndex;
+        // from the cached array - read again once if the URI is not there as namespaces can be added
+        for (int pass = 0; pass < 2; pass++) {
+            std::vector<std::string> a;
+            if (!namespaceArray(a, pass > 0))
+                break;
+            auto i = std::find(a.begin(), a.end(), namespaceUri);
+            if (i != a.end())
+                return int(i - a.begin());
         }
         return -1;  // value
     }
 
+    /*!
+        \brief namespaceArray
+        The server's namespace array - read once per session
+        \param uris set to the namespace URIs by index
+        \param refresh read it again
+        \return true on success
+    */
+    bool namespaceArray(std::vector<std::string>& uris, bool refresh = false);
+
+    /*!
+        \brief translatePaths
+        Resolve many browse paths with batched TranslateBrowsePathsToNodeIds requests rather than a browse per
+        level. Elements are browse names, optionally prefixed "<namespace index>:", followed through hierarchical
+        references. Results are cached for the session (see translateCache) and a path with a cached prefix is
+        only translated from the end of the prefix
+        \param start node the paths start from
+        \param paths
+        \param results the node at the end of each path - null where it was not found
+        \param nameSpace namespace of elements without a prefix
+        \return true if every path was resolved
+    */
+    bool translatePaths(const NodeId& start,
+                        const std::vector<Path>& paths,
+                        std::vector<NodeId>& results,
+                        UA_UInt16 nameSpace = 0);
+    /*!
+        \brief translateCache
+        \return the translatePaths result cache
+    */
+    PathCache& translateCache() { return _translateCache; }
+
+    /*!
+        \brief memoryReport
+        Add the estimated memory held by the client's own structures - subscriptions, monitored items, timers,
+        outstanding asynchronous requests, the path caches, registered nodes and posted commands - then that
+        of each memory source. Subscriptions and timers belong to the loop, so call it from the loop thread,
+        e.g. through postCommand()
+        \param r report added to
+    */
+    void memoryReport(MemoryReport& r);
+    /*!
+        \brief addMemorySource
+        Include a structure the client does not own in memoryReport(), e.g. a value cache
+        \param name replaces a source of the same name
+        \param f adds to the report - called with no client lock held
+    */
+    void addMemorySource(const std::string& name, MemoryReport::Source f);
+    /*!
+        \brief removeMemorySource
+        \param name
+    */
+    void removeMemorySource(const std::string& name);
+
+    /*!
+        \brief setRecorder
+        Record the client's requests and data changes - see TrafficRecorder
+        \param r open recorder - not owned; nullptr to stop recording
+    */
+    void setRecorder(TrafficRecorder* r) { _recorder.store(r); }
+    TrafficRecorder* recorder() const { return _recorder.load(std::memory_order_relaxed); }
+
     /*!
         \brief browseName
         \param nodeId
@@ -745,8 +1277,85 @@ public:
             throw std::runtime_error("Null client");
         QualifiedName newBrowseName(nameSpaceIndex, name);
         UA_Client_writeBrowseNameAttribute(_client, nodeId, newBrowseName);
+        _pathCache.clear();
+        browseChanged(nodeId);
     }
 
+    /*!
+        \brief pathCache
+        Memo used by nodeIdFromPath, createFolderPath and getChild. Off by default as changes made by other
+        clients are not seen - only deletes and renames through this object clear it
+        \return path cache
+    */
+    PathCache& pathCache() { return _pathCache; }
+
+    /*!
+        \brief setDiscoveryCache
+        Answer getEndpoints, and unfiltered findServers / findServersOnNetwork, from a shared cache rather than
+        a round trip under the client lock. The client holds a reference so the cache lives as long as it is used
+        \param c cache - null to go to the network every time
+    */
+    void setDiscoveryCache(const DiscoveryCacheRef& c) { _discovery = c; }
+    DiscoveryCacheRef discoveryCache() const { return _discovery; }
+
+    /*!
+        \brief setBrowseCache
+        Serve browseVisit - and so browseTree, browseChildren and ClientNodeTree - and ClientBrowser from a
+        cache of browse results. Nodes added, deleted or renamed through this object are invalidated; for
+        changes made by others call BrowseCache::watch or rely on its time to live. The cache is cleared when a
+        session is activated and must outlive the client
+        \param c cache - null to browse the server every time
+    */
+    void setBrowseCache(BrowseCache* c) { _browseCache = c; }
+    BrowseCache* browseCache() const { return _browseCache; }
+
+    /*!
+        \brief setTimerWheel
+        Route addTimedEvent and addRepeatedTimerEvent through a timer wheel driven by one repeated callback
+        instead of one C library callback each. Times are rounded up to the tick. Only changed while no wheel
+        timers exist
+        \param tickMs wheel resolution - 0 returns to the C library scheduler
+        \param grouped batch repeating timers of the same interval - a new timer first fires with its group
+        \return true if changed
+    */
+    bool setTimerWheel(unsigned tickMs, bool grouped = true)
+    {
+        if (_wheel.size() > 0)
+            return false;
+        if (_wheelCallbackId && _client) {
+            if (tickMs == 0) {
+                UA_Client_removeCallback(_client, _wheelCallbackId);
+                _wheelCallbackId = 0;
+            }
+            else {
+                UA_Client_changeRepeatedCallbackInterval(_client, _wheelCallbackId, tickMs);
+            }
+        }
+        if (tickMs)
+            _wheel.setTick(tickMs);
+        _wheelTick    = tickMs;
+        _wheelGrouped = grouped;
+        return true;
+    }
+
+    /*!
+        \brief timerWheel
+        \return the wheel - for statistics
+    */
+    TimerWheel& timerWheel() { return _wheel; }
+
+    /*!
+        \brief browseVisit
+        Streaming browse - references are passed to the visitor as each Browse / BrowseNext response arrives,
+        nothing is materialised. Return BrowseStop from the visitor to end the walk early; outstanding
+        continuation points are released. Uses an explicit stack and visits each node once
+        \param start node to browse from - not itself visited
+        \param visit called for each accepted reference
+        \param options depth, node class, reference type and namespace filters
+        \return true on success
+    */
+    bool browseVisit(const NodeId& start, BrowseVisitor visit, const BrowseOptions& options = BrowseOptions());
+
     /*!
         \brief browseTree
         \param nodeId
@@ -782,6 +1391,21 @@ public:
         \return  true on success
     */
     bool browseChildren(UA_NodeId& nodeId, NodeIdMap& m);
+    /*!
+        \brief browseTree
+        browse and create a hashed set of node ids - no string conversion
+        \param nodeId
+        \param s set to fill
+        \return true on success
+    */
+    bool browseTree(NodeId& nodeId, NodeIdSet& s);
+    /*!
+        \brief browseChildren
+        \param nodeId
+        \param s set to fill
+        \return  true on success
+    */
+    bool browseChildren(UA_NodeId& nodeId, NodeIdSet& s);
 
     /*!
         \brief NodeIdFromPath get the node id from the path of browse names in the given namespace. Tests for node
@@ -848,6 +1472,130 @@ public:
         return lastOK();
     }
 
+    /*!
+        \brief operationLimits
+        Reads MaxNodesPerRead and MaxNodesPerWrite from the server capabilities, once per connection.
+        A server that does not publish them is treated as having no limit
+        \param maxRead set to the read limit - 0 if none
+        \param maxWrite set to the write limit - 0 if none
+        \param refresh read again even if already known
+    */
+    void operationLimits(UA_UInt32& maxRead, UA_UInt32& maxWrite, bool refresh = false);
+
+    /*!
+        \brief setMaxBatch
+        Client side cap on the number of nodes sent in one Read or Write request - the smaller of this and
+        the server limit is used
+        \param n nodes per request - 0 to use the server limit only
+    */
+    void setMaxBatch(UA_UInt32 n) { _maxBatch = n; }
+
+    /*!
+        \brief maxMonitoredItemsPerCall
+        \return server limit on monitored items per CreateMonitoredItems request, capped by maxBatch - 0 if none
+    */
+    UA_UInt32 maxMonitoredItemsPerCall()
+    {
+        UA_UInt32 r = 0;
+        UA_UInt32 w = 0;
+        operationLimits(r, w);
+        UA_UInt32 n = _maxMonitoredItemsPerCall;
+        if ((_maxBatch > 0) && ((n == 0) || (_maxBatch < n)))
+            n = _maxBatch;
+        return n;
+    }
+
+    /*!
+        \brief maxBatch
+        \return client side cap on nodes per request
+    */
+    UA_UInt32 maxBatch() const { return _maxBatch; }
+
+    /*!
+        \brief registerNodes
+        RegisterNodes service - the server may serve registered nodes faster, typically through short numeric
+        ids for long string ids. The nodes are their own handles: the read and write calls, single and batched,
+        send a registered node as the id the server returned for it. That holds across reconnects - after a new
+        session is activated runIterate registers the nodes again and uses the ids the server returns then. Not
+        for monitored items or other services
+        \param nodes nodes to register - left as they are, they are the handles
+        \return true on success
+    */
+    bool registerNodes(std::vector<NodeId>& nodes);
+    /*!
+        \brief unregisterNodes
+        \param handles nodes given to registerNodes
+        \return true on success
+    */
+    bool unregisterNodes(std::vector<NodeId>& handles);
+    /*!
+        \brief reregisterNodes
+        Register every node again in the current session - done automatically after a reconnect
+        \param lock take the client lock
+        \return true on success
+    */
+    bool reregisterNodes(bool lock = true);
+    /*!
+        \brief registeredNodes
+        \return number of handles held
+    */
+    size_t registeredNodes() const { return registered()->size(); }
+    /*!
+        \brief translate
+        Lock free - looks the node up in a snapshot of the registrations
+        \param handle a node id, registered or not
+        \param current set to the id to send if it differs from handle
+        \return true if current is set
+    */
+    bool translate(const UA_NodeId& handle, NodeId& current);
+
+    /*!
+        \brief readAttributes
+        Batched read - many ReadValueIds are packed into each Read request, chunked to the operation limits.
+        Results are in input order. Existing entries in results are reused
+        \param nodesToRead what to read - shallow copied into the requests
+        \param results one data value per entry - check each status
+        \param timestamps timestamps to return
+        \return true if every read succeeded
+    */
+    bool readAttributes(const std::vector<UA_ReadValueId>& nodesToRead,
+                        std::vector<DataValue>& results,
+                        UA_TimestampsToReturn timestamps = UA_TIMESTAMPSTORETURN_BOTH);
+
+    /*!
+        \brief readAttributes
+        Batched read of one attribute from many nodes
+        \param nodeIds nodes to read
+        \param attributeId attribute to read from each
+        \param results one data value per node
+        \return true if every read succeeded
+    */
+    bool readAttributes(const std::vector<NodeId>& nodeIds, UA_AttributeId attributeId, std::vector<DataValue>& results);
+
+    /*!
+        \brief readValues
+        Batched read of the value attribute
+        \param nodeIds nodes to read
+        \param results one data value per node
+        \param timestamps timestamps to return
+        \return true if every read succeeded
+    */
+    bool readValues(const std::vector<NodeId>& nodeIds,
+                    std::vector<DataValue>& results,
+                    UA_TimestampsToReturn timestamps = UA_TIMESTAMPSTORETURN_BOTH);
+
+    /*!
+        \brief writeValues
+        Batched write of the value attribute, chunked to the operation limits
+        \param nodeIds nodes to write
+        \param values one value per node
+        \param results one status code per node, in input order
+        \return true if every write succeeded
+    */
+    bool writeValues(const std::vector<NodeId>& nodeIds,
+                     const std::vector<Variant>& values,
+                     std::vector<UA_StatusCode>& results);
+
     // Attribute access generated from the docs
     /*!
         \brief readNodeIdAttribute
@@ -980,6 +1728,29 @@ public:
     {
         return readAttribute(nodeId, UA_ATTRIBUTEID_VALUE, outValue, &UA_TYPES[UA_TYPES_VARIANT]);
     }
+
+    /*!
+        \brief readValueAttribute
+        Typed read of a fixed size scalar - fails if the node holds a different type
+        \param nodeId
+        \param outValue
+        \return  true on success
+    */
+    template <typename T>
+    typename std::enable_if<ua_type_traits<T>::is_fixed_size, bool>::type readValueAttribute(NodeId& nodeId,
+                                                                                               T& outValue)
+    {
+        Variant v;
+        if (readValueAttribute(nodeId, v)) {
+            const T* p = v.view<T>();
+            if (p) {
+                outValue = *p;
+                return true;
+            }
+            _lastError = UA_STATUSCODE_BADTYPEMISMATCH;
+        }
+        return false;
+    }
     /*!
         \brief readDataTypeAttribute
         \param nodeId
@@ -1117,6 +1888,8 @@ public:
     */
     bool setBrowseNameAttribute(NodeId& nodeId, QualifiedName& newBrowseName)
     {
+        _pathCache.clear();
+        browseChanged(nodeId);
         return writeAttribute(nodeId, UA_ATTRIBUTEID_BROWSENAME, &newBrowseName, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
     }
     /*!
@@ -1219,6 +1992,22 @@ public:
     {
         return writeAttribute(nodeId, UA_ATTRIBUTEID_VALUE, newValue, &UA_TYPES[UA_TYPES_VARIANT]);
     }
+
+    /*!
+        \brief setValueAttribute
+        Typed write - the data type is chosen at compile time
+        \param nodeId
+        \param newValue
+        \return  true on success
+    */
+    template <typename T>
+    typename std::enable_if<ua_type_traits<T>::is_ua_type && !std::is_same<T, UA_Variant>::value, bool>::type
+    setValueAttribute(NodeId& nodeId, const T& newValue)
+    {
+        Variant v;
+        v.set(newValue);
+        return setValueAttribute(nodeId, v);
+    }
     /*!
         \brief setDataTypeAttribute
         \param nodeId
@@ -1364,15 +2153,26 @@ public:
         if (!_client)
             throw std::runtime_error("Null client");
         _lastError = UA_Client_deleteNode(_client, nodeId, UA_Boolean(deleteReferences));
+        _pathCache.clear();
+        browseChanged(nodeId, true);
         return lastOK();
     }
 
     /*!
         \brief deleteTree
-        \param nodeId
+        \param nodeId node to be deleted with its children - see deleteTrees
         \return   true on success
     */
-    bool deleteTree(NodeId& nodeId);  // recursive delete
+    bool deleteTree(NodeId& nodeId) { return deleteTrees(std::vector<NodeId>(1, nodeId)); }
+    /*!
+        \brief deleteTrees
+        Delete nodes and their hierarchical descendants in the same namespace. The subtrees are gathered with
+        one browse per node, then deleted children first with DeleteNodes requests of up to 1000 nodes - the
+        server removes the references. Nodes in namespace 0 are not deleted
+        \param roots
+        \return true if every node was deleted
+    */
+    bool deleteTrees(const std::vector<NodeId>& roots);
 
     /*!
         \brief Client::deleteChildren
@@ -1395,13 +2195,40 @@ public:
         if (!_client)
             throw std::runtime_error("Null client");
         _lastError = UA_STATUSCODE_GOOD;
+        TrafficRecorder* r = recorder();
+        const auto start   = TrafficRecorder::startTime(r);
         _lastError = UA_Client_call(_client, objectId, methodId, in.size(), in.data(), &outputSize, &output);
+        if (r)
+            recordCall(*r, start, *objectId.constRef(), *methodId.constRef(), in);
         if (_lastError == UA_STATUSCODE_GOOD) {
             out.set(output, outputSize);
         }
         return lastOK();
     }
 
+    /*!
+        \brief callMethods
+        Send every call of a batch in one Call service - the results are kept in the batch
+        \param batch calls built with MethodCallBatch::add and set
+        \return true if the service succeeded - check each call with batch.status()
+    */
+    bool callMethods(MethodCallBatch& batch)
+    {
+        WriteLock l(_mutex);
+        if (!_client)
+            throw std::runtime_error("Null client");
+        UA_CallRequest request;
+        UA_CallRequest_init(&request);
+        request.methodsToCall     = batch.requests();  // shallow - owned by the batch
+        request.methodsToCallSize = batch.size();
+        TrafficRecorder::Scope trace(recorder(), TrafficRecorder::Call, &request, &UA_TYPES[UA_TYPES_CALLREQUEST]);
+        UA_CallResponse response = UA_Client_Service_call(_client, request);
+        _lastError               = response.responseHeader.serviceResult;
+        trace.done(_lastError);
+        batch.setResponse(response);
+        return lastOK();
+    }
+
     /*!
         \brief process
         \return   true on success
@@ -1442,6 +2269,7 @@ public:
                                                    browseName,
                                                    attr,
                                                    outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1474,6 +2302,7 @@ public:
                                              typeDefinition,
                                              attr,
                                              outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1503,6 +2332,7 @@ public:
                                                  browseName,
                                                  attr,
                                                  outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1532,6 +2362,7 @@ public:
                                            browseName,
                                            attr,
                                            outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1561,6 +2392,7 @@ public:
                                                     browseName,
                                                     attr,
                                                     outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1590,6 +2422,7 @@ public:
                                                browseName,
                                                attr,
                                                outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
     /*!
@@ -1619,6 +2452,7 @@ public:
                                              browseName,
                                              attr,
                                              outNewNodeId.isNull() ? nullptr : outNewNodeId.ref());
+        browseChanged(parentNodeId);
         return lastOK();
     }
 
@@ -1668,6 +2502,100 @@ public:
                               const UA_DataType* /*responseType*/)
     {
     }
+
+    /*!
+        \brief sendAsync
+        Sends any service request without waiting. The handler is looked up by request id when the response
+        arrives, so no subclassing or correlation is needed. Responses are dispatched from runIterate / run,
+        so something must be pumping the client. Handlers may send further async requests but must not
+        make blocking calls on this client. On disconnect outstanding handlers are called with BADSHUTDOWN
+        \param request request structure - encoded before this returns so may be shallow and on the stack
+        \param requestType type of request
+        \param responseType type of response
+        \param handler completion
+        \param requestId set to the request id if not null
+        \return true if the request was sent - the handler is only ever called if it was
+    */
+    bool sendAsync(const void* request,
+                   const UA_DataType* requestType,
+                   const UA_DataType* responseType,
+                   AsyncHandler handler,
+                   UA_UInt32* requestId = nullptr);
+
+    /*!
+        \brief pendingAsync
+        \return number of requests sent with sendAsync still waiting for a response
+    */
+    size_t pendingAsync()
+    {
+        std::lock_guard<std::mutex> l(_asyncMutex);
+        return _asyncHandlers.size();
+    }
+
+    /*!
+        \brief readValueAsync
+        \param nodeId node to read
+        \param done called with the status and the value
+        \return true if sent
+    */
+    bool readValueAsync(const NodeId& nodeId, std::function<void(UA_StatusCode, DataValue&)> done);
+
+    /*!
+        \brief readValueAsync
+        \param nodeId node to read
+        \return future data value - a failed send or service sets the status in the data value
+    */
+    std::future<DataValue> readValueAsync(const NodeId& nodeId);
+
+    /*!
+        \brief writeValueAsync
+        \param nodeId node to write
+        \param value value to write - copied into the request before this returns
+        \param done called with the write status
+        \return true if sent
+    */
+    bool writeValueAsync(const NodeId& nodeId, const Variant& value, std::function<void(UA_StatusCode)> done);
+
+    /*!
+        \brief writeValueAsync
+        \param nodeId node to write
+        \param value value to write
+        \return future write status
+    */
+    std::future<UA_StatusCode> writeValueAsync(const NodeId& nodeId, const Variant& value);
+
+    /*!
+        \brief callMethodAsync
+        \param objectId object owning the method
+        \param methodId method to call
+        \param in input arguments
+        \param done called with the call status and the output arguments
+        \return true if sent
+    */
+    bool callMethodAsync(const NodeId& objectId,
+                         const NodeId& methodId,
+                         const VariantList& in,
+                         std::function<void(UA_StatusCode, VariantCallResult&)> done);
+
+    /*!
+        \brief historyReadRawAsync
+        Continuation points are followed internally - done is called once with all the values
+        \param n node to read
+        \param startTime start of range
+        \param endTime end of range
+        \param numValuesPerNode values per response - 0 for the server default
+        \param done called with the status and the values
+        \param returnBounds return bounding values
+        \param timestampsToReturn timestamps to return
+        \return true if the first request was sent
+    */
+    bool historyReadRawAsync(const NodeId& n,
+                             UA_DateTime startTime,
+                             UA_DateTime endTime,
+                             unsigned numValuesPerNode,
+                             std::function<void(UA_StatusCode, std::vector<DataValue>&)> done,
+                             bool returnBounds                        = false,
+                             UA_TimestampsToReturn timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH);
     /*!
         \brief historicalIterator
         \return
@@ -1768,6 +2696,38 @@ public:
         _lastError = UA_Client_HistoryUpdate_update(_client, n.constRef(), const_cast<UA_DataValue*>(&value));
         return lastOK();
     }
+    /*!
+        \brief historyUpdate
+        Update the history of a node with many values - the values are sorted by source timestamp and
+        sent batchSize at a time, one HistoryUpdate request per batch, rather than one request per value
+        \param n node
+        \param performInsertReplace UA_PERFORMUPDATETYPE_INSERT, _REPLACE or _UPDATE
+        \param values values in any order
+        \param batchSize values per request
+        \param results if not null set to the status of each value, in the order given
+        \return true if every request was serviced - the value results may still be bad
+    */
+    bool historyUpdate(const NodeId& n,
+                       UA_PerformUpdateType performInsertReplace,
+                       const std::vector<DataValue>& values,
+                       size_t batchSize                    = 1000,
+                       std::vector<UA_StatusCode>* results = nullptr);
+    /*!
+        \brief historyUpdateInsert
+        Bulk insert
+        \param n
+        \param values
+        \param batchSize
+        \param results
+        \return
+    */
+    bool historyUpdateInsert(const NodeId& n,
+                             const std::vector<DataValue>& values,
+                             size_t batchSize                    = 1000,
+                             std::vector<UA_StatusCode>* results = nullptr)
+    {
+        return historyUpdate(n, UA_PERFORMUPDATETYPE_INSERT, values, batchSize, results);
+    }
     /*!
         \brief historyUpdateDeleteRaw
         \param n
@@ -1797,9 +2757,13 @@ public:
      */
     bool addTimedEvent(unsigned msDelay, UA_UInt64& callbackId, std::function<void(Timer&)> func)
     {
+        if (_client && _wheelTick) {
+            return addWheelTimerEvent(msDelay, 0, callbackId, func);
+        }
         if (_client) {
             UA_DateTime date = UA_DateTime_nowMonotonic() + (UA_DATETIME_MSEC * msDelay);
             TimerPtr t(new Timer(this, 0, true, func));
+            t->setDue(date);
             _lastError = UA_Client_addTimedCallback(_client, Client::clientCallback, t.get(), date, &callbackId);
             t->setId(callbackId);
             _timerMap[callbackId] = std::move(t);
@@ -1825,8 +2789,13 @@ public:
 
     bool addRepeatedTimerEvent(UA_Double interval_ms, UA_UInt64& callbackId, std::function<void(Timer&)> func)
     {
+        if (_client && _wheelTick) {
+            return addWheelTimerEvent(unsigned(interval_ms), unsigned(interval_ms), callbackId, func);
+        }
         if (_client) {
             TimerPtr t(new Timer(this, 0, false, func));
+            t->setDue(UA_DateTime_nowMonotonic() + UA_DateTime(interval_ms * UA_DATETIME_MSEC),
+                      UA_DateTime(interval_ms * UA_DATETIME_MSEC));
             _lastError =
                 UA_Client_addRepeatedCallback(_client, Client::clientCallback, t.get(), interval_ms, &callbackId);
             t->setId(callbackId);
@@ -1844,8 +2813,18 @@ public:
      */
     bool changeRepeatedTimerInterval(UA_UInt64 callbackId, UA_Double interval_ms)
     {
+        if (TimerWheel::isWheelId(callbackId)) {
+            _lastError = _wheel.changeInterval(callbackId, unsigned(interval_ms)) ? UA_STATUSCODE_GOOD
+                                                                                   : UA_STATUSCODE_BADNOTFOUND;
+            return lastOK();
+        }
         if (_client) {
             _lastError = UA_Client_changeRepeatedCallbackInterval(_client, callbackId, interval_ms);
+            auto i     = _timerMap.find(callbackId);
+            if (lastOK() && (i != _timerMap.end())) {
+                const UA_DateTime period = UA_DateTime(interval_ms * UA_DATETIME_MSEC);
+                i->second->setDue(UA_DateTime_nowMonotonic() + period, period);
+            }
             return lastOK();
         }
         return false;
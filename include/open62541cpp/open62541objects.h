@@ -83,7 +83,11 @@
 #endif
 //
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <memory>
 #include <iostream>
@@ -101,6 +105,106 @@
 // If the template is the base of a class it is exported
 //
 namespace Open62541 {
+//
+// Map C++ types to their UA_TYPES entry at compile time
+// Some C types are aliases (UA_DateTime is UA_Int64, UA_StatusCode is UA_UInt32, UA_ByteString is UA_String)
+// so accepts() allows the aliased data types as well
+// is_builtin - one of the OPC UA builtin types
+// is_fixed_size - no pointer members, can be copied with memcpy and needs no clear
+//
+template <typename T>
+struct ua_type_traits {
+    static constexpr bool is_ua_type    = false;
+    static constexpr bool is_builtin    = false;
+    static constexpr bool is_fixed_size = false;
+};
+
+#define UA_TYPE_TRAITS(T, I, ALT, FIXED)                                                             \
+    template <>                                                                                    \
+    struct ua_type_traits<T> {                                                                     \
+        static constexpr bool is_ua_type    = true;                                                \
+        static constexpr bool is_builtin    = (I <= UA_TYPES_DIAGNOSTICINFO);                      \
+        static constexpr bool is_fixed_size = FIXED;                                               \
+        static constexpr int index          = I;                                                   \
+        static const UA_DataType* type() { return &UA_TYPES[I]; }                                  \
+        static bool accepts(const UA_DataType* t) { return (t == type()) || (t == &UA_TYPES[ALT]); } \
+    };
+
+UA_TYPE_TRAITS(UA_Boolean, UA_TYPES_BOOLEAN, UA_TYPES_BOOLEAN, true)
+UA_TYPE_TRAITS(UA_SByte, UA_TYPES_SBYTE, UA_TYPES_SBYTE, true)
+UA_TYPE_TRAITS(UA_Byte, UA_TYPES_BYTE, UA_TYPES_BYTE, true)
+UA_TYPE_TRAITS(UA_Int16, UA_TYPES_INT16, UA_TYPES_INT16, true)
+UA_TYPE_TRAITS(UA_UInt16, UA_TYPES_UINT16, UA_TYPES_UINT16, true)
+UA_TYPE_TRAITS(UA_Int32, UA_TYPES_INT32, UA_TYPES_INT32, true)
+UA_TYPE_TRAITS(UA_UInt32, UA_TYPES_UINT32, UA_TYPES_STATUSCODE, true)
+UA_TYPE_TRAITS(UA_Int64, UA_TYPES_INT64, UA_TYPES_DATETIME, true)
+UA_TYPE_TRAITS(UA_UInt64, UA_TYPES_UINT64, UA_TYPES_UINT64, true)
+UA_TYPE_TRAITS(UA_Float, UA_TYPES_FLOAT, UA_TYPES_FLOAT, true)
+UA_TYPE_TRAITS(UA_Double, UA_TYPES_DOUBLE, UA_TYPES_DOUBLE, true)
+UA_TYPE_TRAITS(UA_Guid, UA_TYPES_GUID, UA_TYPES_GUID, true)
+UA_TYPE_TRAITS(UA_String, UA_TYPES_STRING, UA_TYPES_BYTESTRING, false)
+UA_TYPE_TRAITS(UA_NodeId, UA_TYPES_NODEID, UA_TYPES_NODEID, false)
+UA_TYPE_TRAITS(UA_ExpandedNodeId, UA_TYPES_EXPANDEDNODEID, UA_TYPES_EXPANDEDNODEID, false)
+UA_TYPE_TRAITS(UA_QualifiedName, UA_TYPES_QUALIFIEDNAME, UA_TYPES_QUALIFIEDNAME, false)
+UA_TYPE_TRAITS(UA_LocalizedText, UA_TYPES_LOCALIZEDTEXT, UA_TYPES_LOCALIZEDTEXT, false)
+UA_TYPE_TRAITS(UA_Variant, UA_TYPES_VARIANT, UA_TYPES_VARIANT, false)
+UA_TYPE_TRAITS(UA_DataValue, UA_TYPES_DATAVALUE, UA_TYPES_DATAVALUE, false)
+UA_TYPE_TRAITS(UA_Argument, UA_TYPES_ARGUMENT, UA_TYPES_ARGUMENT, false)
+UA_TYPE_TRAITS(UA_BrowsePathResult, UA_TYPES_BROWSEPATHRESULT, UA_TYPES_BROWSEPATHRESULT, false)
+
+/*!
+    \brief ua_copy
+    Deep copy of n values - plain memcpy for fixed size types
+    \param src source values
+    \param dst destination values - must not own anything
+    \param n number of values
+    \return status code
+*/
+template <typename T>
+inline typename std::enable_if<ua_type_traits<T>::is_fixed_size, UA_StatusCode>::type
+ua_copy(const T* src, T* dst, size_t n = 1)
+{
+    memcpy(dst, src, sizeof(T) * n);
+    return UA_STATUSCODE_GOOD;
+}
+
+template <typename T>
+inline typename std::enable_if<!ua_type_traits<T>::is_fixed_size, UA_StatusCode>::type
+ua_copy(const T* src, T* dst, size_t n = 1)
+{
+    static_assert(ua_type_traits<T>::is_ua_type, "ua_copy needs a type with a UA_TYPES mapping");
+    UA_StatusCode ret = UA_STATUSCODE_GOOD;
+    for (size_t i = 0; (i < n) && (ret == UA_STATUSCODE_GOOD); i++) {
+        ret = UA_copy(src + i, dst + i, ua_type_traits<T>::type());
+    }
+    return ret;
+}
+
+/*!
+    \brief The ArraySpan class
+    Non-owning view of a contiguous array of UA values - valid only while the owner is unchanged
+*/
+template <typename T>
+class ArraySpan
+{
+    const T* _data = nullptr;
+    size_t _size   = 0;
+
+public:
+    ArraySpan() = default;
+    ArraySpan(const T* d, size_t n)
+        : _data(d)
+        , _size(n)
+    {
+    }
+    const T* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _size; }
+    const T& operator[](size_t i) const { return _data[i]; }
+};
+
 //
 // Base wrapper for most C open62541 object types
 // use unique_ptr
@@ -118,7 +222,7 @@ protected:
         void operator()(T* r) { UA_delete(r, data_type); }
     };
 
-    std::unique_ptr<T, Deleter> _d;  // shared pointer - there is no copy on change
+    std::unique_ptr<T, Deleter> _d;  // owned - copies are deep, SharedValue shares one value
 
 private:
     void init()
@@ -129,6 +233,20 @@ private:
         _d = std::unique_ptr<T, Deleter>(static_cast<T*>(UA_new(data_type)), Deleter());
     }
 
+    /*!
+        \brief reuse
+        Clears existing storage for reuse - only allocates if there is none (eg after a move)
+    */
+    void reuse()
+    {
+        if (_d) {
+            UA_clear(_d.get(), data_type);
+        }
+        else {
+            _d = std::unique_ptr<T, Deleter>(static_cast<T*>(UA_new(data_type)), Deleter());
+        }
+    }
+
 public:
     explicit TypeBase(T* t)
         : _d(t, Deleter())
@@ -153,14 +271,14 @@ public:
 
     T* clearRef()
     {
-        clear();
+        reuse();
         return _d.get();
     }
 
     TypeBase(const T& t)
     {
         init();
-        UA_copy(t, _d.get(), data_type);
+        UA_copy(&t, _d.get(), data_type);
     }
 
     TypeBase(const TypeBase<T, TYPES_ARRAY_INDEX>& t)
@@ -169,20 +287,77 @@ public:
         UA_copy(t._d.get(), _d.get(), data_type);
     }
 
+    /*!
+        \brief TypeBase
+        Move constructor - takes the storage, no allocation or copy. The source is left without storage
+        (isEmpty) - it may be destroyed or refilled by assignment, clearRef, null or assignFrom
+    */
+    TypeBase(TypeBase<T, TYPES_ARRAY_INDEX>&& t) noexcept
+        : _d(std::move(t._d))
+    {
+    }
+
+    // assignment reuses the existing storage - a deep copy but no new allocation
     TypeBase<T, TYPES_ARRAY_INDEX>& operator=(const TypeBase<T, TYPES_ARRAY_INDEX>& t)
     {
-        init();
-        UA_copy(t._d.get(), _d.get(), data_type);
+        if (this != &t) {
+            reuse();
+            UA_copy(t._d.get(), _d.get(), data_type);
+        }
         return *this;
     }
 
     TypeBase<T, TYPES_ARRAY_INDEX>& operator=(const T& t)
     {
-        init();
-        UA_copy(&t, _d.get(), data_type);
+        if (&t != _d.get()) {
+            reuse();
+            UA_copy(&t, _d.get(), data_type);
+        }
         return *this;
     }
 
+    /*!
+        \brief operator =
+        Move assignment - swaps the storage, the old contents are released with the source
+    */
+    TypeBase<T, TYPES_ARRAY_INDEX>& operator=(TypeBase<T, TYPES_ARRAY_INDEX>&& t) noexcept
+    {
+        _d.swap(t._d);
+        return *this;
+    }
+
+    /*!
+        \brief adopt
+        Takes the members of a C structure by shallow copy (steals them). The source is reinitialised
+        so it no longer owns anything. Existing storage is reused.
+        \param t structure to take ownership of
+    */
+    void adopt(T& t)
+    {
+        reuse();
+        *(_d.get()) = t;  // shallow copy - C structs
+        UA_init(&t, data_type);
+    }
+
+    /*!
+        \brief adopt
+        \param t structure to take ownership of
+    */
+    void adopt(T&& t) { adopt(t); }
+
+    /*!
+        \brief assignInPlace
+        Deep copy into the already allocated storage
+        \param t source
+    */
+    void assignInPlace(const T& t) { *this = t; }
+
+    /*!
+        \brief isEmpty
+        \return true if there is no managed storage (eg moved from)
+    */
+    bool isEmpty() const { return !_d; }
+
     void clear()
     {
         if (_d) {
@@ -192,20 +367,126 @@ public:
 
     void null()
     {
-        clear();
+        reuse();
         UA_init(_d.get(), data_type);
     }
 
     void assignTo(T& v)
     {
         clear();
-        UA_copy(_d.get(), &v, data_type);
+        if (_d)
+            UA_copy(_d.get(), &v, data_type);
+        else
+            UA_init(&v, data_type);
     }
     void assignFrom(const T& v)
     {
-        clear();
+        reuse();
         UA_copy(&v, _d.get(), data_type);
     }
+
+    //
+    // UA binary encoding - straight from / into the wrapped value, no intermediate representation
+    //
+    /*!
+        \brief encodedSize
+        \return size of the UA binary encoding - pass it on to encode to skip sizing again
+    */
+    size_t encodedSize() const { return UA_calcSizeBinary(_d.get(), data_type); }
+
+    /*!
+        \brief encode
+        Encode into a byte string. A buffer of exactly the encoded size is reused, so encoding values of the
+        same size - e.g. a stream of fixed type DataValues - allocates once
+        \param out buffer - reallocated only when the size differs
+        \param size encoded size if known - 0 to compute it
+        \return status code
+    */
+    UA_StatusCode encode(UA_ByteString& out, size_t size = 0) const
+    {
+        if (size == 0)
+            size = encodedSize();
+        if (out.length != size) {
+            UA_ByteString_clear(&out);
+            UA_StatusCode ret = UA_ByteString_allocBuffer(&out, size);
+            if (ret != UA_STATUSCODE_GOOD)
+                return ret;
+        }
+        return UA_encodeBinary(_d.get(), data_type, &out);  // a non empty buffer is used as is
+    }
+
+    /*!
+        \brief encodeInto
+        Encode into caller memory - nothing is allocated
+        \param buffer
+        \param capacity of the buffer
+        \param written set to the number of bytes encoded
+        \return status code - UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED if the buffer is too small
+    */
+    UA_StatusCode encodeInto(UA_Byte* buffer, size_t capacity, size_t& written) const
+    {
+        written = 0;
+        if (!buffer || (capacity == 0))
+            return UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        UA_ByteString view;
+        view.data         = buffer;
+        view.length       = capacity;
+        UA_StatusCode ret = UA_encodeBinary(_d.get(), data_type, &view);
+        if (ret == UA_STATUSCODE_GOOD)
+            written = view.length;  // set to the encoded length
+        return ret;
+    }
+
+    /*!
+        \brief encodeInto
+        Encode onto the end of a vector - grown only when its capacity is too small
+        \param out
+        \param size encoded size if known - 0 to compute it
+        \return status code
+    */
+    UA_StatusCode encodeInto(std::vector<UA_Byte>& out, size_t size = 0) const
+    {
+        if (size == 0)
+            size = encodedSize();
+        const size_t start = out.size();
+        out.resize(start + size);
+        size_t written    = 0;
+        UA_StatusCode ret = encodeInto(out.data() + start, size, written);
+        out.resize(start + written);
+        return ret;
+    }
+
+    /*!
+        \brief decodeFrom
+        Decode into the existing storage - the previous value is released first
+        \param in encoded bytes
+        \param offset start in the buffer, advanced past the value - null to start at 0
+        \return status code - the value is left empty on failure
+    */
+    UA_StatusCode decodeFrom(const UA_ByteString& in, size_t* offset = nullptr)
+    {
+        reuse();
+        size_t o          = 0;
+        UA_StatusCode ret = UA_decodeBinary(&in, offset ? offset : &o, _d.get(), data_type, nullptr);
+        if (ret != UA_STATUSCODE_GOOD)
+            UA_init(_d.get(), data_type);  // the decoder has cleared what it made
+        return ret;
+    }
+
+    /*!
+        \brief decodeFrom
+        \param data encoded bytes - not copied
+        \param length
+        \param offset as above
+        \return status code
+    */
+    UA_StatusCode decodeFrom(const UA_Byte* data, size_t length, size_t* offset = nullptr)
+    {
+        UA_ByteString view;
+        view.data   = const_cast<UA_Byte*>(data);
+        view.length = length;
+        return decodeFrom(view, offset);
+    }
 };
 //
 // Repeated for each type but cannot use C++ templates because we must also wrap the C function calls for each type
@@ -285,8 +566,13 @@ public:
         UA_ByteString_copy(&s, &_s);
     }
 
+    ByteString() { UA_ByteString_init(&_s); }
+
     ~ByteString() { UA_ByteString_clear(&_s); }
 
+    UA_ByteString& get() { return _s; }
+    const UA_ByteString& get() const { return _s; }
+
     operator const UA_ByteString&() { return _s; }
     operator const UA_ByteString*() { return &_s; }
     operator UA_ByteString*() { return &_s; }
@@ -308,6 +594,97 @@ public:
     std::string toStdString() { return std::string((char*)(_s.data), _s.length); }
 };
 
+/*!
+    \brief The InternedString class
+    Handle to an immutable string held by a StringPool. Cheap to copy, never owns or frees the data.
+    The UA_String can be passed by shallow copy to any open62541 call that copies its arguments
+*/
+class UA_EXPORT InternedString
+{
+    const UA_String* _s = nullptr;
+
+public:
+    InternedString() = default;
+    explicit InternedString(const UA_String* s)
+        : _s(s)
+    {
+    }
+    /*!
+        \brief get
+        \return the pooled string - empty if null
+    */
+    const UA_String& get() const
+    {
+        static const UA_String empty = {0, nullptr};
+        return _s ? *_s : empty;
+    }
+    operator const UA_String&() const { return get(); }
+    bool isNull() const { return _s == nullptr; }
+    size_t length() const { return get().length; }
+    std::string toStdString() const { return std::string((const char*)(get().data), get().length); }
+    // pooled strings are unique so identity is equality
+    bool operator==(const InternedString& o) const { return _s == o._s; }
+    bool operator!=(const InternedString& o) const { return _s != o._s; }
+};
+
+/*!
+    \brief The StringPool class
+    Thread safe string interning pool. Each distinct string is stored once and lives as long as the pool
+*/
+class UA_EXPORT StringPool
+{
+    mutable ReadWriteMutex _mutex;
+    std::unordered_map<std::string, UA_String> _map;  // value points into the key - nodes do not move
+
+public:
+    StringPool() {}
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    /*!
+        \brief intern
+        \param s string to add
+        \return handle to the pooled copy
+    */
+    InternedString intern(const std::string& s);
+    /*!
+        \brief intern
+        \param s characters
+        \param n number of characters
+        \return handle to the pooled copy
+    */
+    InternedString intern(const char* s, size_t n) { return intern(std::string(s, n)); }
+    /*!
+        \brief intern
+        \param s null terminated string
+        \return handle to the pooled copy
+    */
+    InternedString intern(const char* s) { return intern(std::string(s)); }
+    /*!
+        \brief size
+        \return number of pooled strings
+    */
+    size_t size() const
+    {
+        ReadLock l(_mutex);
+        return _map.size();
+    }
+    /*!
+        \brief global
+        \return process wide pool
+    */
+    static StringPool& global();
+};
+
+/*!
+    \brief intern
+    \param s
+    \return string from the global pool
+*/
+inline InternedString intern(const std::string& s)
+{
+    return StringPool::global().intern(s);
+}
+
 template <typename T, const UA_UInt32 I>
 /*!
        \brief The Array class
@@ -321,14 +698,28 @@ template <typename T, const UA_UInt32 I>
 
 class Array
 {
-    T* _data       = nullptr;
-    size_t _length = 0;
+    T* _data         = nullptr;
+    size_t _length   = 0;
+    size_t _capacity = 0;  // elements allocated - below _length when filled through lengthRef / dataRef
+
+    /*!
+        \brief grow
+        \param n elements needed
+        \return true if there is room for n
+    */
+    bool grow(size_t n)
+    {
+        if (n <= _capacity)
+            return true;
+        return reserve(std::max(n, _capacity ? _capacity * 2 : size_t(4)));
+    }
 
 public:
     Array() { release(); }
     Array(T* data, size_t len)
         : _data(data)
         , _length(len)
+        , _capacity(len)
     {
         // shallow copy
     }
@@ -341,13 +732,50 @@ public:
         }
     }
 
+    /*!
+        \brief Array
+        Deep copy
+    */
+    Array(const Array& a) { setListCopy(a._length, a._data); }
+
+    /*!
+        \brief Array
+        Move - takes the storage, the source is left empty
+    */
+    Array(Array&& a) noexcept
+        : _data(a._data)
+        , _length(a._length)
+        , _capacity(a._capacity)
+    {
+        a.release();
+    }
+
+    Array& operator=(const Array& a)
+    {
+        if (&a != this)
+            setListCopy(a._length, a._data);
+        return *this;
+    }
+
+    Array& operator=(Array&& a) noexcept
+    {
+        if (&a != this) {
+            clear();
+            _data     = a._data;
+            _length   = a._length;
+            _capacity = a._capacity;
+            a.release();
+        }
+        return *this;
+    }
+
     virtual ~Array() { clear(); }
 
     /*!
      * \brief dataType
      * \return
      */
-    const UA_DataType* dataType() { return &UA_TYPES[I]; }
+    const UA_DataType* dataType() const { return &UA_TYPES[I]; }
     /*!
         \brief allocate
         \param len
@@ -355,8 +783,125 @@ public:
     void allocate(size_t len)
     {
         clear();
-        _data   = (T*)(UA_Array_new(len, dataType()));
-        _length = len;
+        _data     = (T*)(UA_Array_new(len, dataType()));
+        _length   = len;
+        _capacity = len;
+    }
+
+    /*!
+        \brief reserve
+        Make room for n elements without changing the length - elements are moved bitwise, which is safe for
+        UA types as they do not point into themselves
+        \param n capacity
+        \return true on success
+    */
+    bool reserve(size_t n)
+    {
+        if (n <= std::max(_capacity, _length))  // capacity is not tracked when filled through lengthRef / dataRef
+            return true;
+        T* old = (_data == UA_EMPTY_ARRAY_SENTINEL) ? nullptr : _data;
+        T* p   = static_cast<T*>(UA_realloc(old, n * sizeof(T)));
+        if (!p)
+            return false;
+        memset(p + _length, 0, (n - _length) * sizeof(T));  // zero is the initialised state of UA types
+        _data     = p;
+        _capacity = n;
+        return true;
+    }
+
+    /*!
+        \brief capacity
+        \return elements allocated
+    */
+    size_t capacity() const { return _capacity; }
+
+    /*!
+        \brief push_back
+        Append a deep copy
+        \param v
+        \return true on success
+    */
+    bool push_back(const T& v)
+    {
+        if (!grow(_length + 1))
+            return false;
+        if (ua_copy(&v, _data + _length, 1) != UA_STATUSCODE_GOOD)
+            return false;
+        _length++;
+        return true;
+    }
+
+    /*!
+        \brief push_back
+        Append by taking the contents of v - nothing is copied and v is left initialised
+        \param v
+        \return true on success
+    */
+    bool push_back(T&& v)
+    {
+        if (!grow(_length + 1))
+            return false;
+        _data[_length++] = v;
+        UA_init(&v, dataType());
+        return true;
+    }
+
+    /*!
+        \brief emplace_back
+        Append an initialised element to fill in place
+        \return the element - throws if it cannot be allocated
+    */
+    T& emplace_back()
+    {
+        if (!grow(_length + 1))
+            throw std::bad_alloc();
+        T& v = _data[_length++];
+        UA_init(&v, dataType());
+        return v;
+    }
+
+    /*!
+        \brief pop_back
+        Remove and clear the last element
+    */
+    void pop_back()
+    {
+        if (_length)
+            UA_clear(_data + --_length, dataType());
+    }
+
+    /*!
+        \brief shrink_to_fit
+        Free the unused capacity
+    */
+    void shrink_to_fit()
+    {
+        if (_capacity == _length)
+            return;
+        if (_length == 0) {
+            clear();
+            return;
+        }
+        T* p = static_cast<T*>(UA_realloc(_data, _length * sizeof(T)));
+        if (p) {
+            _data     = p;
+            _capacity = _length;
+        }
+    }
+
+    /*!
+        \brief detach
+        Hand the array to C code - to a response or a variant - as data and length, freed with
+        UA_Array_delete. No longer managed
+        \param len set to the length
+        \return the data
+    */
+    T* detach(size_t& len)
+    {
+        T* d = _data;
+        len  = _length;
+        release();
+        return d;
     }
 
     /*!
@@ -365,8 +910,9 @@ public:
     */
     void release()
     {
-        _length = 0;
-        _data   = nullptr;
+        _length   = 0;
+        _capacity = 0;
+        _data     = nullptr;
     }
 
     virtual void clearFunc(T*) {}
@@ -376,14 +922,31 @@ public:
     void clear()
     {
         if (_length && _data) {
-            T* p = _data;
-            for (size_t i = 0; i < _length; i++, p++) {
-                clearFunc(p);
+            if (!ua_type_traits<T>::is_fixed_size) {  // fixed size types own nothing
+                T* p = _data;
+                for (size_t i = 0; i < _length; i++, p++) {
+                    clearFunc(p);
+                }
             }
-            UA_Array_delete(_data, _length, dataType());
         }
-        _length = 0;
-        _data   = nullptr;
+        if (_data)
+            UA_Array_delete(_data, _length, dataType());  // frees reserved capacity as well
+        _length   = 0;
+        _capacity = 0;
+        _data     = nullptr;
+    }
+
+    /*!
+        \brief setListCopy
+        Deep copy of the given values - memcpy for fixed size types
+        \param len
+        \param data
+        \return true on success
+    */
+    bool setListCopy(size_t len, const T* data)
+    {
+        allocate(len);
+        return (len == 0) || (_data && (ua_copy(data, _data, len) == UA_STATUSCODE_GOOD));
     }
 
     /*!
@@ -405,13 +968,20 @@ public:
     void setList(size_t len, T* data)
     {
         clear();
-        _length = len;
-        _data   = data;
+        _length   = len;
+        _capacity = len;
+        _data     = data;
     }
 
     // Accessors
     size_t length() const { return _length; }
+    size_t size() const { return _length; }
+    bool empty() const { return _length == 0; }
     T* data() const { return _data; }
+    T& operator[](size_t i) { return _data[i]; }
+    const T& operator[](size_t i) const { return _data[i]; }
+    T* begin() const { return _data; }
+    T* end() const { return _data + _length; }
     //
     size_t* lengthRef() { return &_length; }
     T** dataRef() { return &_data; }
@@ -635,7 +1205,8 @@ public:
     bool isNull() const { return UA_NodeId_isNull(constRef()); }
 
     // equality
-    bool operator==(const NodeId& n) { return UA_NodeId_equal(_d.get(), n._d.get()); }
+    bool operator==(const NodeId& n) const { return UA_NodeId_equal(_d.get(), n._d.get()); }
+    bool operator!=(const NodeId& n) const { return !UA_NodeId_equal(_d.get(), n._d.get()); }
     /* Returns a non-cryptographic hash for the NodeId */
     unsigned hash() const { return UA_NodeId_hash(constRef()); }
 
@@ -720,48 +1291,179 @@ UA_EXPORT std::string toString(const UA_NodeId& n);
 /*!
     \brief The UANodeIdList class
 */
-class UA_EXPORT UANodeIdList : public std::vector<UA_NodeId>
+class UA_EXPORT UANodeIdList : public Array<UA_NodeId, UA_TYPES_NODEID>
 {
 public:
     UANodeIdList() {}
-    virtual ~UANodeIdList()
+    void put(const UA_NodeId& n) { push_back(n); }  // deep copy
+};
+
+/*!
+    \brief The NodeIdMap class
+*/
+class UA_EXPORT NodeIdMap : public std::map<std::string, UA_NodeId>
+{
+public:
+    NodeIdMap() {}  // set of nodes not in a tree
+    virtual ~NodeIdMap()
     {
-        for (int i = 0; i < int(size()); i++) {
-            UA_NodeId_clear(&(at(i)));  // delete members
+        // delete node data
+        for (auto i = begin(); i != end(); i++) {
+            UA_NodeId& n = i->second;
+            UA_NodeId_clear(&n);
         }
+        clear();
     }
     void put(UA_NodeId& n)
     {
         UA_NodeId i;  // deep copy
         UA_NodeId_init(&i);
         UA_NodeId_copy(&n, &i);
-        push_back(i);
+        const std::string s = Open62541::toString(i);
+        insert(std::pair<std::string, UA_NodeId>(s, i));
     }
 };
 
 /*!
-    \brief The NodeIdMap class
+    \brief The NodeIdHash struct
+    Hash functor for unordered containers - uses the C library hash, no string conversion
 */
-class UA_EXPORT NodeIdMap : public std::map<std::string, UA_NodeId>
+struct NodeIdHash {
+    size_t operator()(const UA_NodeId& n) const { return UA_NodeId_hash(&n); }
+    size_t operator()(const NodeId& n) const { return n.hash(); }
+};
+
+/*!
+    \brief The NodeIdEqual struct
+*/
+struct NodeIdEqual {
+    bool operator()(const UA_NodeId& a, const UA_NodeId& b) const { return UA_NodeId_equal(&a, &b); }
+    bool operator()(const NodeId& a, const NodeId& b) const { return a == b; }
+};
+
+/*!
+    \brief The NodeIdSet class
+    Hashed set of node ids - an alternative to NodeIdMap / UANodeIdList that does not stringify the keys
+    The set owns deep copies of its members
+*/
+class UA_EXPORT NodeIdSet : public std::unordered_set<UA_NodeId, NodeIdHash, NodeIdEqual>
 {
 public:
-    NodeIdMap() {}  // set of nodes not in a tree
-    virtual ~NodeIdMap()
+    NodeIdSet() {}
+    NodeIdSet(const NodeIdSet&) = delete;
+    NodeIdSet& operator=(const NodeIdSet&) = delete;
+    virtual ~NodeIdSet() { clearAll(); }
+    /*!
+        \brief put
+        \param n node id to add
+        \return true if added, false if already present
+    */
+    bool put(const UA_NodeId& n)
+    {
+        if (find(n) != end())
+            return false;
+        UA_NodeId i;  // deep copy
+        UA_NodeId_init(&i);
+        UA_NodeId_copy(&n, &i);
+        insert(i);
+        return true;
+    }
+    /*!
+        \brief contains
+        \param n
+        \return true if present
+    */
+    bool contains(const UA_NodeId& n) const { return find(n) != end(); }
+    /*!
+        \brief remove
+        \param n node id to remove
+    */
+    void remove(const UA_NodeId& n)
+    {
+        auto i = find(n);
+        if (i != end()) {
+            UA_NodeId k = *i;  // shallow - take the members before erasing
+            erase(i);
+            UA_NodeId_clear(&k);
+        }
+    }
+    /*!
+        \brief clearAll
+        Delete all members
+    */
+    void clearAll()
+    {
+        for (auto i = begin(); i != end(); i++) {
+            UA_NodeId_clear(const_cast<UA_NodeId*>(&(*i)));
+        }
+        clear();
+    }
+};
+
+/*!
+    \brief The UnorderedNodeIdMap class
+    Hashed map keyed on node id. The map owns deep copies of the keys
+*/
+template <typename T>
+class UnorderedNodeIdMap : public std::unordered_map<UA_NodeId, T, NodeIdHash, NodeIdEqual>
+{
+    typedef std::unordered_map<UA_NodeId, T, NodeIdHash, NodeIdEqual> Base;
+
+public:
+    UnorderedNodeIdMap() {}
+    UnorderedNodeIdMap(const UnorderedNodeIdMap&) = delete;
+    UnorderedNodeIdMap& operator=(const UnorderedNodeIdMap&) = delete;
+    virtual ~UnorderedNodeIdMap() { clearAll(); }
+    /*!
+        \brief put
+        \param n key
+        \param v value
+        \return reference to the stored value
+    */
+    T& put(const UA_NodeId& n, const T& v = T())
     {
-        // delete node data
-        for (auto i = begin(); i != end(); i++) {
-            UA_NodeId& n = i->second;
-            UA_NodeId_clear(&n);
+        auto i = Base::find(n);
+        if (i != Base::end()) {
+            i->second = v;
+            return i->second;
         }
-        clear();
+        UA_NodeId k;  // deep copy
+        UA_NodeId_init(&k);
+        UA_NodeId_copy(&n, &k);
+        return Base::emplace(k, v).first->second;
     }
-    void put(UA_NodeId& n)
+    /*!
+        \brief value
+        \param n key
+        \return pointer to value or nullptr
+    */
+    T* value(const UA_NodeId& n)
     {
-        UA_NodeId i;  // deep copy
-        UA_NodeId_init(&i);
-        UA_NodeId_copy(&n, &i);
-        const std::string s = Open62541::toString(i);
-        insert(std::pair<std::string, UA_NodeId>(s, i));
+        auto i = Base::find(n);
+        return (i != Base::end()) ? &i->second : nullptr;
+    }
+    /*!
+        \brief remove
+        \param n key
+    */
+    void remove(const UA_NodeId& n)
+    {
+        auto i = Base::find(n);
+        if (i != Base::end()) {
+            UA_NodeId k = i->first;
+            Base::erase(i);
+            UA_NodeId_clear(&k);
+        }
+    }
+    /*!
+        \brief clearAll
+    */
+    void clearAll()
+    {
+        for (auto i = Base::begin(); i != Base::end(); i++) {
+            UA_NodeId_clear(const_cast<UA_NodeId*>(&(i->first)));
+        }
+        Base::clear();
     }
 };
 
@@ -936,7 +1638,26 @@ inline std::string toString(UA_String& r)
 std::string variantToString(UA_Variant& v);
 class UA_EXPORT Variant : public TypeBase<UA_Variant, UA_TYPES_VARIANT>
 {
+    //
+    // Builtin scalars (Boolean to Double, DateTime and StatusCode) are held in this buffer rather than on the heap.
+    // The variant data points here and is marked UA_VARIANT_DATA_NODELETE so the stack never frees it
+    //
+    UA_UInt64 _inline = 0;
+
+    /*!
+        \brief fixInline
+        After a move or copy of the wrapped structure repoint inline data at this object's buffer
+        \param src the object the structure came from
+    */
+    void fixInline(const Variant& src)
+    {
+        if (_d && (_d->data == static_cast<const void*>(&src._inline))) {
+            _d->data = &_inline;
+        }
+    }
+
 public:
+    using TypeBase<UA_Variant, UA_TYPES_VARIANT>::assignFrom;
     // It would be nice to template but ...
 
     //
@@ -947,6 +1668,77 @@ public:
         : TypeBase(UA_Variant_new())
     {
     }
+
+    /*!
+        \brief Variant
+        Copy - inline scalars stay inline, anything else is deep copied
+        \param v
+    */
+    Variant(const Variant& v)
+        : TypeBase(UA_Variant_new())
+    {
+        assignFrom(v);
+    }
+
+    /*!
+        \brief Variant
+        Move - takes the storage, inline scalars are carried across
+        \param v
+    */
+    Variant(Variant&& v) noexcept
+        : TypeBase(std::move(v))
+        , _inline(v._inline)
+    {
+        fixInline(v);
+    }
+
+    Variant& operator=(const Variant& v)
+    {
+        if (this != &v) {
+            if (!_d) {
+                _d.reset(UA_Variant_new());
+            }
+            assignFrom(v);
+        }
+        return *this;
+    }
+
+    Variant& operator=(Variant&& v) noexcept
+    {
+        if (this != &v) {
+            _d.swap(v._d);
+            std::swap(_inline, v._inline);
+            fixInline(v);
+            v.fixInline(*this);
+        }
+        return *this;
+    }
+    /*!
+        \brief Variant
+        Deep copy of a C variant
+        \param v
+    */
+    Variant(const UA_Variant& v)
+        : TypeBase(UA_Variant_new())
+    {
+        UA_Variant_copy(&v, ref());
+    }
+
+    /*!
+        \brief Variant
+        Scalar of any type with a UA_TYPES mapping - the data type is chosen at compile time.
+        The explicit overloads below take precedence where they match exactly
+        \param v
+    */
+    template <typename T,
+              typename = typename std::enable_if<ua_type_traits<T>::is_ua_type &&
+                                                 !std::is_same<T, UA_Variant>::value>::type>
+    Variant(const T& v)
+        : TypeBase(UA_Variant_new())
+    {
+        set(v);
+    }
+
     /*!
         \brief uaVariant
         \param v
@@ -970,13 +1762,13 @@ public:
     Variant(UA_UInt64 v)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &v, &UA_TYPES[UA_TYPES_UINT64]);
+        setScalarInline(&v, &UA_TYPES[UA_TYPES_UINT64]);
     }
 
     Variant(UA_UInt16 v)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &v, &UA_TYPES[UA_TYPES_UINT16]);
+        setScalarInline(&v, &UA_TYPES[UA_TYPES_UINT16]);
     }
 
     Variant(UA_String& v)
@@ -999,7 +1791,7 @@ public:
     Variant(int a)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &a, &UA_TYPES[UA_TYPES_INT32]);
+        setScalarInline(&a, &UA_TYPES[UA_TYPES_INT32]);
     }
 
     /*!
@@ -1009,7 +1801,7 @@ public:
     Variant(unsigned a)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &a, &UA_TYPES[UA_TYPES_UINT32]);
+        setScalarInline(&a, &UA_TYPES[UA_TYPES_UINT32]);
     }
 
     /*!
@@ -1019,7 +1811,7 @@ public:
     Variant(double a)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &a, &UA_TYPES[UA_TYPES_DOUBLE]);
+        setScalarInline(&a, &UA_TYPES[UA_TYPES_DOUBLE]);
     }
 
     /*!
@@ -1029,7 +1821,7 @@ public:
     Variant(bool a)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &a, &UA_TYPES[UA_TYPES_BOOLEAN]);
+        setScalarInline(&a, &UA_TYPES[UA_TYPES_BOOLEAN]);
     }
 
     /*!
@@ -1039,21 +1831,97 @@ public:
     Variant(UA_DateTime t)
         : TypeBase(UA_Variant_new())
     {
-        UA_Variant_setScalarCopy((UA_Variant*)ref(), &t, &UA_TYPES[UA_TYPES_DATETIME]);
+        setScalarInline(&t, &UA_TYPES[UA_TYPES_DATETIME]);
+    }
+
+    /*!
+        \brief set
+        Set a scalar - inline for builtin fixed size types otherwise a deep copy
+        \param v value
+        \return true on success
+    */
+    template <typename T>
+    bool set(const T& v)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "set<T> needs a type with a UA_TYPES mapping");
+        return setScalarInline(&v, ua_type_traits<T>::type());
+    }
+
+    /*!
+        \brief setArrayCopy
+        Set an array from values of a mapped type
+        \param a array
+        \param n number of elements
+        \return true on success
+    */
+    template <typename T>
+    bool setArrayCopy(const T* a, size_t n)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "setArrayCopy<T> needs a type with a UA_TYPES mapping");
+        return setArrayCopy(a, n, ua_type_traits<T>::type());
     }
 
     /*!
         cast to a type supported by UA
+        For types with a UA_TYPES mapping the type is checked and T() returned on mismatch
     */
     template <typename T>
     T value()
+    {
+        return value<T>(std::integral_constant<bool, ua_type_traits<T>::is_ua_type>());
+    }
+
+private:
+    template <typename T>
+    T value(std::true_type)
+    {
+        const T* p = view<T>();
+        return p ? *p : T();
+    }
+    template <typename T>
+    T value(std::false_type)
     {
         if (!UA_Variant_isEmpty((UA_Variant*)ref())) {
-            return *((T*)ref()->data);  // cast to a value - to do Type checking needed
+            return *((T*)ref()->data);  // cast to a value - no type mapping to check against
         }
         return T();
     }
 
+public:
+
+    /*!
+        \brief view
+        Type checked access to a scalar value without copying
+        \return pointer to the value or nullptr if the variant does not hold a scalar of type T
+    */
+    template <typename T>
+    const T* view() const
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "view<T> needs a type with a UA_TYPES mapping");
+        const UA_Variant* v = constRef();
+        if (v && UA_Variant_isScalar(v) && ua_type_traits<T>::accepts(v->type)) {
+            return static_cast<const T*>(v->data);
+        }
+        return nullptr;
+    }
+
+    /*!
+        \brief span
+        Type checked access to array data without copying
+        \return span over the array, empty if the variant does not hold an array of type T
+    */
+    template <typename T>
+    ArraySpan<T> span() const
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "span<T> needs a type with a UA_TYPES mapping");
+        const UA_Variant* v = constRef();
+        if (v && !UA_Variant_isScalar(v) && (v->arrayLength > 0) && (v->data > UA_EMPTY_ARRAY_SENTINEL) &&
+            ua_type_traits<T>::accepts(v->type)) {
+            return ArraySpan<T>(static_cast<const T*>(v->data), v->arrayLength);
+        }
+        return ArraySpan<T>();
+    }
+
     /*!
         \brief empty
         \return
@@ -1070,6 +1938,59 @@ public:
             }
         }
     }
+
+    /*!
+        \brief isInlineType
+        \param type
+        \return true if values of the type can be held inline
+    */
+    static bool isInlineType(const UA_DataType* type)
+    {
+        return type && (type->memSize <= sizeof(UA_UInt64)) &&
+               (((type >= &UA_TYPES[UA_TYPES_BOOLEAN]) && (type <= &UA_TYPES[UA_TYPES_DOUBLE])) ||
+                (type == &UA_TYPES[UA_TYPES_DATETIME]) || (type == &UA_TYPES[UA_TYPES_STATUSCODE]));
+    }
+
+    /*!
+        \brief isInline
+        \return true if the value is held in the wrapper's buffer
+    */
+    bool isInline() const { return _d && (_d->data == static_cast<const void*>(&_inline)); }
+
+    /*!
+        \brief setScalarInline
+        Sets a scalar value without a heap allocation if the type allows, otherwise falls back to a copy
+        \param p pointer to value
+        \param type data type
+        \return true on success
+    */
+    bool setScalarInline(const void* p, const UA_DataType* type)
+    {
+        clear();
+        if (isInlineType(type)) {
+            memcpy(&_inline, p, type->memSize);
+            UA_Variant_setScalar(ref(), &_inline, type);
+            ref()->storageType = UA_VARIANT_DATA_NODELETE;
+            return true;
+        }
+        return UA_Variant_setScalarCopy(ref(), p, type) == UA_STATUSCODE_GOOD;
+    }
+
+    /*!
+        \brief assignFrom
+        Deep copy, inline scalars are kept inline
+        \param v source
+    */
+    void assignFrom(const Variant& v)
+    {
+        if (v.isInline()) {
+            setScalarInline(v.constRef()->data, v.constRef()->type);
+        }
+        else {
+            clear();
+            UA_Variant_copy(v.constRef(), ref());
+        }
+    }
     //
     //
     bool isScalar() const { return UA_Variant_isScalar(constRef()); }
@@ -1117,6 +2038,24 @@ public:
 
 TYPEDEF_ARRAY(Variant, UA_TYPES_VARIANT)
 
+/*!
+    \brief The DataValue class
+*/
+class UA_EXPORT DataValue : public TypeBase<UA_DataValue, UA_TYPES_DATAVALUE>
+{
+public:
+    using TypeBase<UA_DataValue, UA_TYPES_DATAVALUE>::operator=;
+    bool hasValue() const { return ref()->hasValue; }
+    const UA_Variant& value() const { return ref()->value; }
+    /*!
+        \brief status
+        \return status code - GOOD if the data value does not carry one
+    */
+    UA_StatusCode status() const { return ref()->hasStatus ? ref()->status : UA_STATUSCODE_GOOD; }
+    UA_DateTime sourceTimestamp() const { return ref()->hasSourceTimestamp ? ref()->sourceTimestamp : 0; }
+    UA_DateTime serverTimestamp() const { return ref()->hasServerTimestamp ? ref()->serverTimestamp : 0; }
+};
+
 /*!
     \brief The QualifiedName class
 */
@@ -1140,12 +2079,144 @@ public:
     UA_String& name() { return ref()->name; }
 };
 
+/*!
+    \brief makeQualifiedName
+    Non-owning qualified name from an interned string - no allocation. Do not clear the result
+    \param ns namespace index
+    \param s interned name
+    \return shallow qualified name
+*/
+inline UA_QualifiedName makeQualifiedName(UA_UInt16 ns, const InternedString& s)
+{
+    UA_QualifiedName q;
+    q.namespaceIndex = ns;
+    q.name           = s.get();
+    return q;
+}
+
+/*!
+    \brief makeLocalizedText
+    Non-owning en_US localised text from an interned string - no allocation. Do not clear the result
+    \param s interned text
+    \return shallow localised text
+*/
+inline UA_LocalizedText makeLocalizedText(const InternedString& s)
+{
+    UA_LocalizedText t;
+    t.locale = UA_STRING((char*)"en_US");
+    t.text   = s.get();
+    return t;
+}
+
 //
 /*!
     \brief Path
 */
 typedef std::vector<std::string> Path;
 
+/*!
+    \brief The PathCache class
+    Memo of resolved browse paths - (start node, path prefix) to node id. Only successful resolutions are
+    stored, so adding nodes never makes an entry stale. The owner must clear() when nodes are deleted or renamed
+*/
+class UA_EXPORT PathCache
+{
+    mutable ReadWriteMutex _mutex;
+    std::unordered_map<std::string, NodeId> _map;
+    bool _enabled   = true;
+    size_t _maxSize = 1000000;  // the cache is emptied rather than grown past this
+
+    static void makeKey(const UA_NodeId& start, const Path& path, std::string& key, std::vector<size_t>& ends);
+
+public:
+    PathCache(bool enabled = true)
+        : _enabled(enabled)
+    {
+    }
+    /*!
+        \brief find
+        Look up the longest cached prefix of the path
+        \param start
+        \param path
+        \param nodeId set to the node at the end of the prefix if one is found
+        \return number of path elements resolved - 0 if nothing is cached
+    */
+    size_t find(const UA_NodeId& start, const Path& path, NodeId& nodeId) const;
+    /*!
+        \brief put
+        \param start
+        \param path
+        \param n length of the prefix resolved
+        \param nodeId node at the end of the prefix
+    */
+    void put(const UA_NodeId& start, const Path& path, size_t n, const UA_NodeId& nodeId);
+    /*!
+        \brief clear
+        Invalidate everything
+    */
+    void clear()
+    {
+        WriteLock l(_mutex);
+        _map.clear();
+    }
+    size_t size() const
+    {
+        ReadLock l(_mutex);
+        return _map.size();
+    }
+    bool enabled() const { return _enabled; }
+    void setEnabled(bool f)
+    {
+        _enabled = f;
+        if (!f)
+            clear();
+    }
+    void setMaxSize(size_t n) { _maxSize = n; }
+};
+
+/*!
+    \brief The BrowseAction enum
+    Returned by browse visitors to steer the walk
+*/
+enum BrowseAction {
+    BrowseStop = 0,     //!< end the walk
+    BrowseContinue,     //!< visit this node's children as well
+    BrowseSkipChildren  //!< carry on but do not descend into this node
+};
+
+/*!
+    \brief BrowseVisitor
+    Called for each reference found - the reference description is only valid for the call
+    \param reference
+    \param parent node the reference was found on
+    \param depth 1 for children of the start node
+*/
+typedef std::function<BrowseAction(const UA_ReferenceDescription& reference, const UA_NodeId& parent, size_t depth)>
+    BrowseVisitor;
+
+/*!
+    \brief The BrowseOptions struct
+    Filters for iterative browsing
+*/
+struct UA_EXPORT BrowseOptions {
+    size_t maxDepth             = 0;  //!< 0 is unlimited, 1 is the children of the start node only
+    UA_UInt32 nodeClassMask     = 0;  //!< UA_NodeClass bits - 0 for all classes
+    UA_NodeId referenceTypeId   = UA_NODEID_NULL;  //!< null follows every forward reference
+    bool includeSubtypes        = true;
+    int nameSpace               = -1;  //!< only nodes in this namespace, -1 for any
+    UA_UInt16 minNameSpace      = 0;   //!< skip nodes in a lower namespace
+    UA_UInt32 maxReferences     = 0;   //!< per browse call - 0 lets the server decide
+    /*!
+        \brief accept
+        \param n
+        \return true if the node passes the namespace filters
+    */
+    bool accept(const UA_NodeId& n) const
+    {
+        return (n.namespaceIndex >= minNameSpace) && ((nameSpace < 0) || (n.namespaceIndex == nameSpace));
+    }
+};
+
 /*!
     \brief The BrowseItem struct
 */
@@ -1170,6 +2241,45 @@ struct UA_EXPORT BrowseItem {
     }
 };
 
+/*!
+    \brief The BrowseView class
+    A reference in a browse result held by the browser - nothing is copied. Valid until the browser's next
+    browse or its destruction. The browse name is only made a std::string when asked for
+*/
+class UA_EXPORT BrowseView
+{
+    const UA_ReferenceDescription* _r = nullptr;
+
+public:
+    explicit BrowseView(const UA_ReferenceDescription& r)
+        : _r(&r)
+    {
+    }
+    const UA_ReferenceDescription& reference() const { return *_r; }
+    const UA_NodeId& childId() const { return _r->nodeId.nodeId; }
+    const UA_NodeId& referenceTypeId() const { return _r->referenceTypeId; }
+    const UA_String& browseName() const { return _r->browseName.name; }
+    int nameSpace() const { return _r->browseName.namespaceIndex; }
+    const UA_LocalizedText& displayName() const { return _r->displayName; }
+    UA_NodeClass nodeClass() const { return _r->nodeClass; }
+    /*!
+        \brief nameIs
+        \param s
+        \return true if the browse name is s - compared in place
+    */
+    bool nameIs(const std::string& s) const
+    {
+        const UA_String& n = browseName();
+        return (n.length == s.size()) && ((n.length == 0) || (memcmp(n.data, s.data(), n.length) == 0));
+    }
+    std::string name() const
+    {
+        return std::string(reinterpret_cast<const char*>(browseName().data), browseName().length);
+    }
+    BrowseItem item() const { return BrowseItem(name(), nameSpace(), childId(), referenceTypeId()); }
+};
+typedef std::vector<BrowseView> BrowseViewList;
+
 //
 // Helper containers
 //
@@ -1296,6 +2406,20 @@ public:
     {
         UA_Variant_copy(v, &get().value);  // deep copy the variant - do not know life times
     }
+    /*!
+        \brief setTypedValue
+        Set a scalar value and the matching data type - resolved at compile time
+        \param v value
+    */
+    template <typename T>
+    void setTypedValue(const T& v)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "setTypedValue<T> needs a type with a UA_TYPES mapping");
+        UA_Variant_clear(&get().value);
+        UA_Variant_setScalarCopy(&get().value, &v, ua_type_traits<T>::type());
+        get().dataType  = ua_type_traits<T>::type()->typeId;
+        get().valueRank = -1;  // scalar
+    }
     void setValueRank(int i) { get().valueRank = i; }
 
     void setHistorizing(bool f = true)
@@ -1602,22 +2726,19 @@ public:
 };
 
 //
-#if 0
-class UA_EXPORT PubSubConnectionConfig : public TypeBase<UA_PubSubConnectionConfig, UA_TYPES_PUBSUBCONNECTIONCONFIG> {
-public:
-};
-#endif
+// PubSub configuration is wrapped by ServerPubSub - see pubsub.h
 //
 // Nodes in a browsable / addressable property tree
 //
 typedef NodePath<std::string> UAPath;
-typedef PropertyTree<std::string, NodeId>::PropertyNode UANode;
+typedef PropertyTree<std::string, NodeId, PooledNodeStorage>::PropertyNode UANode;
 //
 /*!
     \brief The UANodeTree class
+    Nodes are pooled - make them with createChild, not new
 */
 
-class UA_EXPORT UANodeTree : public PropertyTree<std::string, NodeId>
+class UA_EXPORT UANodeTree : public PropertyTree<std::string, NodeId, PooledNodeStorage>
 {
 
     NodeId _parent;  // note parent node
@@ -1962,12 +3083,59 @@ class UA_EXPORT BrowserBase
 {
 protected:
     BrowseList _list;
+    //
+    // view mode - the browse results are kept and views() points into them rather than copying into list()
+    bool _viewMode = false;
+    std::vector<UA_BrowseResult> _results;  // owns what the views point at
+    BrowseViewList _views;
     static UA_StatusCode browseIter(UA_NodeId childId, UA_Boolean isInverse, UA_NodeId referenceTypeId, void* handle);
+    /*!
+        \brief adopt
+        Keep a result so views can point into it - r is left empty
+        \param r
+    */
+    void adopt(UA_BrowseResult& r)
+    {
+        _results.push_back(r);  // the reference array does not move
+        UA_BrowseResult_init(&r);
+    }
+    /*!
+        \brief clearResults
+        Free the kept results - the containers keep their capacity for the next browse
+    */
+    void clearResults()
+    {
+        _views.clear();
+        for (auto& r : _results)
+            UA_BrowseResult_clear(&r);
+        _results.clear();
+    }
 
 public:
     BrowserBase() = default;
-    virtual ~BrowserBase() { _list.clear(); }
+    virtual ~BrowserBase()
+    {
+        _list.clear();
+        clearResults();
+    }
     BrowseList& list() { return _list; }
+    /*!
+        \brief setViewMode
+        Deliver results as views() of the browse results instead of as list() items - no per reference copies
+        \param f
+    */
+    void setViewMode(bool f) { _viewMode = f; }
+    bool viewMode() const { return _viewMode; }
+    const BrowseViewList& views() const { return _views; }
+    /*!
+        \brief findView
+        \param s browse name
+        \return first view with the name or views().end()
+    */
+    BrowseViewList::const_iterator findView(const std::string& s) const
+    {
+        return std::find_if(_views.begin(), _views.end(), [&s](const BrowseView& v) { return v.nameIs(s); });
+    }
     virtual void browse(UA_NodeId /*start*/) {}
     virtual bool browseName(NodeId& /*n*/, std::string& /*s*/, int& /*i*/) { return false; }
 
@@ -1997,8 +3165,6 @@ template <typename T>
 class Browser : public BrowserBase
 {
     T& _obj;
-    // browser call back
-    BrowseList _list;
     //
 public:
     Browser(T& c)
@@ -2014,5 +3180,45 @@ public:
 std::string timestampToString(UA_DateTime date);
 std::string dataValueToString(UA_DataValue* value);
 std::string variantToString(UA_Variant& v);
+//
+// Appending versions - the caller's buffer is reused so there is no allocation once it has grown
+//
+/*!
+    \brief timestampToString
+    \param date
+    \param out string to append to
+*/
+void timestampToString(UA_DateTime date, std::string& out);
+/*!
+    \brief dataValueToString
+    \param value
+    \param out string to append to
+*/
+void dataValueToString(const UA_DataValue& value, std::string& out);
+/*!
+    \brief variantToString
+    \param v
+    \param out string to append to
+*/
+void variantToString(const UA_Variant& v, std::string& out);
+/*!
+    \brief dataValuesToString
+    Batch format of an array of data values
+    \param values
+    \param n number of values
+    \param out string to append to
+    \param separator placed between values
+*/
+void dataValuesToString(const UA_DataValue* values, size_t n, std::string& out, const char* separator = "\n");
 }  // namespace Open62541
+
+namespace std {
+/*!
+    \brief hash specialisation so NodeId can be used directly as an unordered container key
+*/
+template <>
+struct hash<Open62541::NodeId> {
+    size_t operator()(const Open62541::NodeId& n) const { return n.hash(); }
+};
+}  // namespace std
 #endif  // OPEN62541OBJECTS_H
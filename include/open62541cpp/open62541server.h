@@ -12,10 +12,27 @@
 #ifndef OPEN62541SERVER_H
 #define OPEN62541SERVER_H
 #include <open62541cpp/open62541objects.h>
+#include <open62541cpp/attributetraits.h>
+#include <atomic>
+#include <set>
+#include <thread>
 #include <open62541cpp/nodecontext.h>
 #include <open62541cpp/servermethod.h>
 #include <open62541cpp/serverrepeatedcallback.h>
 #include <open62541cpp/condition.h>
+#include <open62541cpp/alarmfilter.h>
+#include <open62541cpp/workerpool.h>
+#include <open62541cpp/permissioncache.h>
+#include <open62541cpp/timerwheel.h>
+#include <open62541cpp/pubsub.h>
+#include <open62541cpp/metrics.h>
+#include <open62541cpp/startuptrace.h>
+#include <open62541cpp/mpscqueue.h>
+#include <open62541cpp/writefilter.h>
+#include <open62541cpp/threadconfig.h>
+#include <open62541cpp/sessionlimiter.h>
+#include <open62541cpp/nodestore.h>
+#include <open62541cpp/memoryreport.h>
 
 namespace Open62541 {
 
@@ -30,6 +47,9 @@ namespace Open62541 {
 
 class HistoryDataGathering;
 class HistoryDataBackend;
+class RoleAccessControl;
+class PollScheduler;
+class ServerAggregator;
 
 /*!
     \brief The Server class
@@ -38,6 +58,12 @@ class UA_EXPORT Server
 {
 
 public:
+    // locks taken in the scope of the server record their wait time - see Metrics::TimedLock
+    typedef Metrics::TimedLock<Open62541::WriteLock> WriteLock;
+    typedef Metrics::TimedLock<Open62541::ReadLock> ReadLock;
+    // builds a deferred subtree - see addLazyNode
+    typedef std::function<bool(Server&)> LazyBuilder;
+
     /*!
      * \brief The Timer class - used for timed events
      */
@@ -57,7 +83,9 @@ public:
             , _handler(func)
         {
         }
-        virtual ~Timer() { UA_Server_removeCallback(_server->server(), _id); }
+        // the server removes the scheduled callback on the loop thread before dropping the timer - a pool
+        // handler may hold the last reference so nothing is removed here
+        virtual ~Timer() {}
         virtual void handle()
         {
             if (_handler)
@@ -70,22 +98,95 @@ public:
     };
 
 protected:
-    UA_StatusCode _lastError = 0;
+    std::atomic<UA_StatusCode> _lastError{0};  // written by concurrent readers
 
 private:
     //
-    typedef std::unique_ptr<Timer> TimerPtr;
+    typedef std::shared_ptr<Timer> TimerPtr;  // shared so a running handler keeps its timer
     std::map<UA_UInt64, TimerPtr> _timerMap;  // one map per client
-    UA_Server* _server       = nullptr;       // assume one server per application
+    std::recursive_mutex _timerMutex;         // guards _timerMap - handlers may add or remove timers
+    WorkerPool _workers;                      // optional pool for process() and timer handlers
+    TimerWheel _wheel;                        // timers driven by one repeated callback - opt in
+    unsigned _wheelTick        = 0;           // 0 = timers go to the C library scheduler
+    bool _wheelGrouped         = true;        // batch repeating timers of the same interval
+    UA_UInt64 _wheelCallbackId = 0;           // the driving repeated callback
+    size_t _workerThreads = 0;
+    ThreadConfig _loopConfig;  // applied by start() to the calling thread
+    std::atomic<bool> _processPending{false};  // at most one process() queued or running on the pool
+    std::atomic<bool> _asyncPending{false};    // async operations to drain from the loop - no pool running
+    UnorderedNodeIdMap<WorkerPool::Lane> _methodLanes;  // async method priorities - Control if not listed
+    std::mutex _methodLaneMutex;
+    /*!
+        \brief The Command struct
+        Work posted to the server loop - either a function or a value write
+    */
+    struct Command {
+        std::function<void(Server&)> fn;
+        NodeId node;
+        Variant value;
+    };
+    MpscQueue<Command> _commands{4096};         // posted from any thread - drained by the server loop
+    std::atomic<bool> _commandsPending{false};  // skip the iterate wait while set
+    std::recursive_mutex _coalesceMutex;  // held while flushing so a context cannot go mid flush
+    std::set<NodeContext*> _coalescing;   // contexts with write coalescing in use
+    PathCache _pathCache;                // resolved browse paths - cleared by the node destructor hook
+    PermissionCache _permissionCache{false};  // access control decisions - opt in
+    WriteFilter _writeFilter;                 // write only on change - opt in
+    StartupTrace _startup;                    // address space build timings - until initialise returns
+    std::unordered_map<NodeId, LazyBuilder> _lazy;  // subtrees built on first browse, by their root
+    std::mutex _lazyMutex;
+    std::atomic<size_t> _lazyCount{0};
+    RoleAccessControl* _roleAccess  = nullptr;  // declarative access control - replaces the access virtuals
+    PollScheduler* _pollScheduler   = nullptr;  // demand driven polling - fed by monitoredItemRegister
+    ServerAggregator* _aggregator   = nullptr;  // shared downstream subscriptions - fed by monitoredItemRegister
+    SessionLimiter* _sessionLimiter = nullptr;  // per session admission control - opt in
+    std::map<const void*, std::function<void(const NodeId&)>> _sessionClosed;  // by owner - see addSessionClosed
+    std::mutex _sessionClosedMutex;  // held while the functions run so an owner cannot go mid call
+    // plugin hooks the session limiter wraps
+    decltype(UA_AccessControl::getUserAccessLevel) _nextAccessLevel = nullptr;
+    decltype(UA_AccessControl::getUserExecutable) _nextExecutable   = nullptr;
+    std::unordered_map<std::string, NodeContext*> _contexts;  // per instance named contexts
+    std::mutex _contextMutex;
+    std::map<std::string, MemoryReport::Source> _memorySources;  // structures not owned - see memoryReport
+    std::mutex _memoryMutex;
+    UA_Server* _server       = nullptr;
     UA_ServerConfig* _config = nullptr;
-    UA_Boolean _running      = false;
+    std::atomic<bool> _running{false};  // stop() may come from another thread
+    std::atomic<bool> _stopped{false};  // stop() was called - never cleared, so a start() not yet begun returns
+    std::atomic<std::thread::id> _loopThread{};  // thread running start() - the only one that may remove timers
     ReadWriteMutex _mutex;
+    //
+    // Attribute reads only need shared access to the wrapper lock when the stack serialises access itself.
+    // Without UA_MULTITHREADING the nodestore is not safe for concurrent readers so reads stay exclusive.
+#if UA_MULTITHREADING >= 100
+    typedef ReadLock AttributeReadLock;
+#else
+    typedef WriteLock AttributeReadLock;
+#endif
     std::string _customHostName;
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
-    std::map<unsigned, ConditionPtr> _conditionMap;  // Conditions - SCADA Alarm state handling by any other name
+    ConditionManager _conditions;  // Conditions - SCADA Alarm state handling by any other name
+    AlarmFloodFilter* _alarmFilter = nullptr;  // rate limits condition events - not owned
+#endif
+#ifdef UA_ENABLE_PUBSUB
+    ServerPubSub _pubSub{*this};  // PubSub connections, writers and readers
 #endif
+    //
+    // Registry of servers keyed by UA_Server pointer - callbacks resolve their owner by scanning a small fixed
+    // table with atomic loads, no lock and no insertion. Servers beyond the table go to an overflow map.
+    struct RegistryEntry {
+        std::atomic<UA_Server*> key{nullptr};
+        std::atomic<Server*> server{nullptr};
+    };
+    static constexpr size_t RegistrySize = 16;
+    static RegistryEntry _registry[RegistrySize];
     typedef std::map<UA_Server*, Server*> ServerMap;
-    static ServerMap _serverMap;                      // Map of servers key by UA_Server pointer
+    static ServerMap _serverMap;            // overflow - only used when more than RegistrySize servers are running
+    static std::atomic<bool> _hasOverflow;  // _serverMap is not empty - a miss skips the lock when clear
+    static std::mutex _registryMutex;       // serialises registration and guards _serverMap
+    static void registerServer(UA_Server* s, Server* p);
+    static void unregisterServer(UA_Server* s);
+    static Server* findServerOverflow(UA_Server* s);
     std::map<UA_UInt64, std::string> _discoveryList;  // set of discovery servers this server has registered with
     std::vector<UA_UsernamePasswordLogin> _logins;    // set of permitted  logins
     //
@@ -95,15 +196,74 @@ private:
         if (data) {
             Timer* t = static_cast<Timer*>(data);
             if (t) {
-                t->handle();
-                if (t->oneShot()) {
-                    // Potential risk of the client disappearing
-                    t->server()->_timerMap.erase(t->id());
+                Server* s    = t->server();
+                UA_UInt64 id = t->id();
+                // on the pool the timer is looked up again by id as it may have been removed in the meantime
+                if (!s->post([s, id] { s->handleTimer(id); })) {
+                    s->handleTimer(id);
                 }
             }
         }
     }
 
+    static void wheelCallback(UA_Server*, void* data)
+    {
+        if (data) {
+            Server* s = static_cast<Server*>(data);
+            s->_wheel.advance(UA_DateTime_nowMonotonic());
+        }
+    }
+
+    /*!
+        \brief startTimerWheel
+        Register the repeated callback driving the wheel - once per server
+        \return true if the wheel is running
+    */
+    bool startTimerWheel();
+
+    /*!
+        \brief addWheelTimerEvent
+        Add a Timer to _timerMap driven by the wheel - its handler runs on the pool when there is one
+        \param delayMs
+        \param intervalMs zero for a one shot
+        \param callbackId set to the wheel id
+        \param func
+        \return true on success
+    */
+    bool addWheelTimerEvent(unsigned delayMs,
+                            unsigned intervalMs,
+                            UA_UInt64& callbackId,
+                            std::function<void(Timer&)> func);
+
+    /*!
+        \brief handleTimer
+        The handler is called without _timerMutex held so it may add and remove timers, itself included,
+        from any thread
+        \param id timer to run - ignored if it no longer exists
+    */
+    void handleTimer(UA_UInt64 id)
+    {
+        TimerPtr t;
+        {
+            std::lock_guard<std::recursive_mutex> l(_timerMutex);
+            auto i = _timerMap.find(id);
+            if (i == _timerMap.end())
+                return;
+            t = i->second;
+        }
+        {
+            Metrics::Scope timing(Metrics::TimerCallback);
+            t->handle();
+        }
+        if (t->oneShot()) {
+            std::lock_guard<std::recursive_mutex> l(_timerMutex);
+            auto i = _timerMap.find(id);
+            if ((i != _timerMap.end()) && (i->second == t)) {
+                _timerMap.erase(i);  // handle() may already have removed it
+            }
+        }
+    }
+
     // Lifecycle call backs
     /* Can be NULL. May replace the nodeContext */
     static UA_StatusCode constructor(UA_Server* server,
@@ -119,6 +279,18 @@ private:
                            void* sessionContext,
                            const UA_NodeId* nodeId,
                            void* nodeContext);
+    /*!
+        \brief The DeferredDestructor struct
+        Destructor call recorded by a bulk delete - the caches are updated for the batch once it is deleted and the
+        lock released
+    */
+    struct DeferredDestructor {
+        NodeId node;
+        NodeId type;  // of a type lifecycle destructor - null for the node destructor
+        NodeContext* context = nullptr;
+    };
+    static std::vector<DeferredDestructor>*& deferredDestructors();  // this thread's batch - null if none
+    void runDestructors(std::vector<DeferredDestructor>& d, const NodeIdSet* done = nullptr);
     //
 
     /* Can be NULL. Called during recursive node instantiation. While mandatory
@@ -310,8 +482,43 @@ private:
 
 public:
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
-    ConditionPtr& findCondition(const UA_NodeId* condition) { return _conditionMap[UA_NodeId_hash(condition)]; }
-    ConditionPtr& findCondition(UA_UInt32 n) { return _conditionMap[n]; }
+    /*!
+        \brief findCondition
+        \param condition
+        \return the condition object - null if the node is not a condition of this server. Never inserts
+    */
+    ConditionPtr findCondition(const UA_NodeId* condition) { return _conditions.find(*condition); }
+    /*!
+        \brief findCondition
+        Look up by UA_NodeId_hash of the condition node - a scan, kept for compatibility
+        \param n
+        \return the condition object or null
+    */
+    ConditionPtr findCondition(UA_UInt32 n)
+    {
+        NodeId match;
+        _conditions.forEach([&](Condition& c) {
+            if (match.isNull() && (UA_NodeId_hash(c.condition().constRef()) == n))
+                match = c.condition();
+        });
+        return _conditions.find(match);
+    }
+    /*!
+        \brief conditions
+        \return the condition registry - indexed by condition and source node with a list of active conditions
+    */
+    ConditionManager& conditions() { return _conditions; }
+    /*!
+        \brief setAlarmFilter
+        Pass condition events through a flood filter - deadband, shelving and per source rate limits
+        \param f filter or nullptr to emit every event. The filter is not owned
+    */
+    void setAlarmFilter(AlarmFloodFilter* f) { _alarmFilter = f; }
+    /*!
+        \brief alarmFilter
+        \return the flood filter or nullptr
+    */
+    AlarmFloodFilter* alarmFilter() const { return _alarmFilter; }
 #endif
 
 public:
@@ -349,6 +556,35 @@ public:
         }
     }
 
+    /*!
+        \brief Server
+        Server holding its address space in a C++ nodestore. The store is plugged in before the server is
+        created, so namespace zero is loaded into it
+        \param store must outlive the server - cleared as the server is deleted
+        \param port
+        \param certificate
+    */
+    Server(Nodestore& store, int port = 4840, const UA_ByteString& certificate = UA_BYTESTRING_NULL)
+    {
+        UA_ServerConfig config;
+        memset(&config, 0, sizeof(config));
+        store.plug(config.nodestore);
+        UA_ServerConfig_setMinimal(&config, port, &certificate);
+        if (config.nodestore.context != &store) {
+            // a default store was set up anyway - drop it for ours
+            if (config.nodestore.clear) config.nodestore.clear(config.nodestore.context);
+            store.plug(config.nodestore);
+        }
+        _server = UA_Server_newWithConfig(&config);
+        if (_server) {
+            _config = UA_Server_getConfig(_server);
+            if (_config) {
+                _config->nodeLifecycle.constructor = constructor;  // set up the node global lifecycle
+                _config->nodeLifecycle.destructor  = destructor;
+            }
+        }
+    }
+
     /*!
         \brief ~Server
     */
@@ -363,9 +599,55 @@ public:
 
     /*!
      * \brief asyncOperationNotify
-     * Callback handler
+     * Callback handler - called on the network thread when an async operation is queued. The default runs
+     * the queue with runAsyncOperations() on the worker pool, or from the server loop when there is no pool.
+     * Overrides that do not call it must take the operations themselves
      */
-    virtual void asyncOperationNotify() {}
+    virtual void asyncOperationNotify() { dispatchAsyncOperations(); }
+
+    /*!
+        \brief dispatchAsyncOperations
+        Post a job draining the async operation queue to the worker pool's Control lane. The drain hands each
+        call on to the lane of its method, so slow methods run side by side and a bulk export does not hold up
+        a control call. Without a running pool the queue is drained after the next loop iteration
+    */
+    void dispatchAsyncOperations()
+    {
+        if (!post([this] { runAsyncOperations(); }, WorkerPool::Control)) {
+            _asyncPending = true;
+        }
+    }
+
+    /*!
+        \brief runAsyncOperations
+        Take queued async method calls and post each to the worker pool in its method's lane, or run them here
+        when the pool is not running. Each result is posted back to the stack.
+        Safe from any thread when open62541 is built with UA_MULTITHREADING >= 100
+        \return number of operations taken
+    */
+    size_t runAsyncOperations();
+
+    /*!
+        \brief setMethodLane
+        \param method async method node
+        \param lane worker pool priority of its calls
+    */
+    void setMethodLane(const NodeId& method, WorkerPool::Lane lane)
+    {
+        std::lock_guard<std::mutex> l(_methodLaneMutex);
+        _methodLanes.put(method, lane);
+    }
+    /*!
+        \brief methodLane
+        \param method
+        \return the lane of the method's calls
+    */
+    WorkerPool::Lane methodLane(const UA_NodeId& method)
+    {
+        std::lock_guard<std::mutex> l(_methodLaneMutex);
+        WorkerPool::Lane* p = _methodLanes.value(method);
+        return p ? *p : WorkerPool::Control;
+    }
 
     /*!
      * \brief enableasyncOperationNotify
@@ -378,6 +660,7 @@ public:
 
     /*!
      * \brief monitoredItemRegister
+     * Passes value monitoring to the poll scheduler, if any - call the base when overriding
      * \param sessionId
      * \param sessionContext
      * \param nodeId
@@ -385,14 +668,12 @@ public:
      * \param attibuteId
      * \param removed
      */
-    virtual void monitoredItemRegister(const UA_NodeId* /*sessionId*/,
-                                       void* /*sessionContext*/,
-                                       const UA_NodeId* /*nodeId*/,
-                                       void* /*nodeContext*/,
-                                       uint32_t /*attibuteId*/,
-                                       bool /*removed*/)
-    {
-    }
+    virtual void monitoredItemRegister(const UA_NodeId* sessionId,
+                                       void* sessionContext,
+                                       const UA_NodeId* nodeId,
+                                       void* nodeContext,
+                                       uint32_t attibuteId,
+                                       bool removed);
 
     /*!
      * \brief setMonitoredItemRegister
@@ -403,6 +684,32 @@ public:
             _config->monitoredItemRegisterCallback = Server::monitoredItemRegisterCallback;
     }
 
+    /*!
+        \brief setPollScheduler
+        Called by PollScheduler - enables the monitored item register hook
+        \param p scheduler or null
+    */
+    void setPollScheduler(PollScheduler* p)
+    {
+        _pollScheduler = p;
+        if (p)
+            setMonitoredItemRegister();
+    }
+    PollScheduler* pollScheduler() const { return _pollScheduler; }
+
+    /*!
+        \brief setAggregator
+        Called by ServerAggregator - enables the monitored item register hook
+        \param a aggregator or null
+    */
+    void setAggregator(ServerAggregator* a)
+    {
+        _aggregator = a;
+        if (a)
+            setMonitoredItemRegister();
+    }
+    ServerAggregator* aggregator() const { return _aggregator; }
+
     /*!
      * \brief createOptionalChild
      * \return true if child is to be created
@@ -543,7 +850,16 @@ public:
         \param s
         \return
     */
-    static Server* findServer(UA_Server* s) { return _serverMap[s]; }
+    static Server* findServer(UA_Server* s)
+    {
+        if (!s)
+            return nullptr;
+        for (size_t i = 0; i < RegistrySize; i++) {
+            if (_registry[i].key.load(std::memory_order_acquire) == s)
+                return _registry[i].server.load(std::memory_order_relaxed);
+        }
+        return findServerOverflow(s);
+    }
     //
     // Discovery
     //
@@ -645,6 +961,175 @@ public:
     */
     virtual void process() {}  // called between server loop iterations - hook thread event processing
 
+    /*!
+        \brief addCoalescingContext
+        Called by a node context the first time it merges a write
+        \param c
+    */
+    void addCoalescingContext(NodeContext* c)
+    {
+        std::lock_guard<std::recursive_mutex> l(_coalesceMutex);
+        _coalescing.insert(c);
+    }
+
+    /*!
+        \brief removeCoalescingContext
+        \param c
+    */
+    void removeCoalescingContext(NodeContext* c)
+    {
+        std::lock_guard<std::recursive_mutex> l(_coalesceMutex);
+        _coalescing.erase(c);
+    }
+
+    /*!
+        \brief addSessionClosed
+        Call a function with the session id whenever a session closes - for per session state held outside
+        the stack. It runs on the server loop thread from within the stack, so it must not call back into the
+        server - use postWrite or postCommand for that
+        \param owner key for removeSessionClosed - one function per owner
+        \param fn
+    */
+    void addSessionClosed(const void* owner, std::function<void(const NodeId&)> fn)
+    {
+        std::lock_guard<std::mutex> l(_sessionClosedMutex);
+        _sessionClosed[owner] = std::move(fn);
+    }
+
+    /*!
+        \brief removeSessionClosed
+        Waits for a running call of the owner's function to return
+        \param owner
+    */
+    void removeSessionClosed(const void* owner)
+    {
+        std::lock_guard<std::mutex> l(_sessionClosedMutex);
+        _sessionClosed.erase(owner);
+    }
+
+    /*!
+        \brief flushCoalescedWrites
+        Batched delivery of merged writes - called from the server loop after each iteration
+        \param force deliver everything regardless of the coalescing window
+        \return number of writes delivered
+    */
+    size_t flushCoalescedWrites(bool force = false);
+
+    /*!
+        \brief setWorkerThreads
+        Worker mode - set before start(). With n > 0 process() and timer handlers run on a pool of n threads
+        instead of the network loop. At most one process() call is in flight at a time.
+        Jobs run without the server lock held - use the locking Server methods to touch the address space.
+        Concurrent access to the stack from workers is only safe when open62541 is built with
+        UA_MULTITHREADING >= 100, otherwise jobs must confine themselves to application data.
+        Data source and value callbacks stay on the network thread as the stack needs their result synchronously.
+        \param n number of threads - 0 is the classic single threaded loop
+    */
+    void setWorkerThreads(size_t n) { _workerThreads = n; }
+
+    /*!
+        \brief workerThreads
+        \return configured number of worker threads
+    */
+    size_t workerThreads() const { return _workerThreads; }
+
+    /*!
+        \brief setLoopThreadConfig
+        Placement of the network loop - start() applies it to the thread it is called on, so isolate the loop
+        by calling start() from a dedicated thread (see ServerThreads)
+        \param c
+    */
+    void setLoopThreadConfig(const ThreadConfig& c) { _loopConfig = c; }
+    const ThreadConfig& loopThreadConfig() const { return _loopConfig; }
+
+    /*!
+        \brief setWorkerThreadConfig
+        Placement of the worker pool threads - set before start()
+        \param c
+    */
+    void setWorkerThreadConfig(const ThreadConfig& c) { _workers.setThreadConfig(c); }
+
+    /*!
+        \brief post
+        Queue application work on the worker pool
+        \param job
+        \param lane priority class - see WorkerPool::setLane for weights and thread caps
+        \return true if queued, false if the pool is not running (the job is not run)
+    */
+    bool post(WorkerPool::Job job, WorkerPool::Lane lane = WorkerPool::Interactive)
+    {
+        return _workers.post(std::move(job), lane);
+    }
+
+    /*!
+        \brief postCommand
+        Queue a function to run on the server loop thread between network iterations - the only thread where the
+        stack may be used without taking the server lock. Lock free, callable from any thread.
+        \param fn
+        \return false if the queue is full (the function is not run)
+    */
+    bool postCommand(std::function<void(Server&)> fn)
+    {
+        Command c;
+        c.fn = std::move(fn);
+        return pushCommand(c);
+    }
+
+    /*!
+        \brief postWrite
+        Queue a value write to be applied on the server loop thread. Lock free, callable from any thread.
+        \param node
+        \param value
+        \return false if the queue is full (the write is dropped)
+    */
+    bool postWrite(const NodeId& node, const Variant& value)
+    {
+        Command c;
+        c.node  = node;
+        c.value = value;
+        return pushCommand(c);
+    }
+
+    /*!
+        \brief commandsQueued
+        \return approximate number of posted commands not yet run
+    */
+    size_t commandsQueued() const { return _commands.size(); }
+
+    /*!
+        \brief runCommands
+        Drain posted commands - called from the server loop
+        \param limit maximum to run in one batch - 0 for all
+        \return number run
+    */
+    size_t runCommands(size_t limit = 0);
+
+private:
+    bool pushCommand(Command& c)
+    {
+        if (!_commands.push(c))
+            return false;
+        _commandsPending.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        \brief writeValueLocked
+        One value of a batch write, through the write filter - the lock is held
+        \param nodeId
+        \param value
+        \return status code
+    */
+    UA_StatusCode writeValueLocked(const UA_NodeId& nodeId, const UA_Variant& value);
+
+public:
+
+    /*!
+        \brief workers
+        \return the worker pool
+    */
+    WorkerPool& workers() { return _workers; }
+
     /*!
         \brief terminate
     */
@@ -691,6 +1176,51 @@ public:
     */
     static NodeContext* findContext(const std::string& s);
 
+    /*!
+        \brief findContext
+        \param h registry handle - lock free
+        \return registered context or nullptr
+    */
+    static NodeContext* findContext(NodeContextRegistry::Handle h);
+
+    /*!
+        \brief addContext
+        Register a context with this server only - instances sharing a process keep separate names
+        \param name
+        \param c not owned - remove before deleting
+    */
+    void addContext(const std::string& name, NodeContext* c)
+    {
+        std::lock_guard<std::mutex> l(_contextMutex);
+        _contexts[name] = c;
+    }
+
+    /*!
+        \brief removeContext
+        \param name
+    */
+    void removeContext(const std::string& name)
+    {
+        std::lock_guard<std::mutex> l(_contextMutex);
+        _contexts.erase(name);
+    }
+
+    /*!
+        \brief context
+        \param name
+        \return this server's context of that name, else the process wide registered one
+    */
+    NodeContext* context(const std::string& name)
+    {
+        {
+            std::lock_guard<std::mutex> l(_contextMutex);
+            auto i = _contexts.find(name);
+            if (i != _contexts.end())
+                return i->second;
+        }
+        return findContext(name);
+    }
+
     /* Careful! The user has to ensure that the destructor callbacks still work. */
     /*!
         \brief setNodeContext
@@ -712,14 +1242,16 @@ public:
         \param attributeId
         \param v data pointer
         \return true on success
+        Readers share the server lock when open62541 is built with UA_MULTITHREADING >= 100
     */
     bool readAttribute(const UA_NodeId* nodeId, UA_AttributeId attributeId, void* v)
     {
         if (!server())
             return false;
-        WriteLock l(_mutex);
-        _lastError = __UA_Server_read(_server, nodeId, attributeId, v);
-        return lastOK();
+        AttributeReadLock l(_mutex);
+        UA_StatusCode ret = __UA_Server_read(_server, nodeId, attributeId, v);
+        _lastError        = ret;
+        return ret == UA_STATUSCODE_GOOD;
     }
 
     /*!
@@ -738,24 +1270,97 @@ public:
         if (!server())
             return false;
         WriteLock l(_mutex);
-        _lastError = __UA_Server_write(_server, nodeId, attributeId, attr_type, attr) == UA_STATUSCODE_GOOD;
+        _lastError = __UA_Server_write(_server, nodeId, attributeId, attr_type, attr);
         return lastOK();
     }
+
+    /*!
+        \brief read
+        Typed read of an attribute - the output type is fixed at compile time by attribute_traits and the stack
+        decodes straight into it, no variant. For attribute reads in tight loops, e.g. in a NodeContext
+            UA_Byte level;
+            server.read<UA_ATTRIBUTEID_ACCESSLEVEL>(node, level);
+        \param nodeId
+        \param out set to the attribute
+        \return true on success
+    */
+    template <UA_AttributeId A>
+    bool read(const NodeId& nodeId, typename attribute_traits<A>::value_type& out)
+    {
+        return readAttribute(nodeId.constRef(), A, attribute_traits<A>::target(out));
+    }
+    /*!
+        \brief read
+        \param nodeId
+        \return the attribute - default initialised on failure, see lastOK()
+    */
+    template <UA_AttributeId A>
+    typename attribute_traits<A>::value_type read(const NodeId& nodeId)
+    {
+        typename attribute_traits<A>::value_type v{};
+        read<A>(nodeId, v);
+        return v;
+    }
+    /*!
+        \brief write
+        Typed write of an attribute - the data type is fixed at compile time by attribute_traits
+        \param nodeId
+        \param value
+        \return true on success
+    */
+    template <UA_AttributeId A>
+    bool write(const NodeId& nodeId, const typename attribute_traits<A>::value_type& value)
+    {
+        return writeAttribute(nodeId.constRef(), A, attribute_traits<A>::type(), attribute_traits<A>::source(value));
+    }
     /*!
         \brief mutex
         \return server mutex
     */
     ReadWriteMutex& mutex()
     {
-        return _mutex;  // access mutex - most accesses need a write lock
+        return _mutex;  // access mutex - mutations need a write lock, attribute reads share it when the stack is
+                        // built with UA_MULTITHREADING
     }
 
     /*!
         \brief deleteTree
-        \param nodeId node to be delted with its children
+        \param nodeId node to be deleted with its children - see deleteTrees
+        \return true on success
+    */
+    bool deleteTree(const NodeId& nodeId) { return deleteTrees(std::vector<NodeId>(1, nodeId)); }
+    /*!
+        \brief deleteTrees
+        Delete nodes and their hierarchical descendants in the same namespace as a batch. The subtrees are
+        gathered with one browse per node, reading every reference, then deleted children first under one
+        write lock. Only the references from nodes outside the batch are removed one by one - those between
+        nodes of the batch go with the nodes. Node destructors, and the type lifecycle destructors set through
+        NodeContext, run before the nodes are removed and without the lock; the cache updates are made once for
+        the batch after the lock is released. Nodes in namespace 0 are not deleted
+        \param roots
+        \return true if every node was deleted
+    */
+    bool deleteTrees(const std::vector<NodeId>& roots);
+    /*!
+        \brief deferTypeDestructor
+        Used by NodeContext::typeDestructor - holds back a type destructor while deleteTrees deletes
+        \param node
+        \param type
+        \param context
+        \return true if deferred - false if the destructor is to run now
+    */
+    bool deferTypeDestructor(const UA_NodeId& node, const UA_NodeId& type, NodeContext* context);
+    /*!
+        \brief browseVisit
+        Iterative browse from a node - an explicit stack so deep hierarchies cannot overflow the call stack and
+        each node is visited once. Browse names and node classes come back with the references so no per node
+        attribute reads are made. The server lock is only held for each browse call, not across the visitor
+        \param start node to browse from - not itself visited
+        \param visit called for each accepted reference
+        \param options depth, node class, reference type and namespace filters
         \return true on success
     */
-    bool deleteTree(const NodeId& nodeId);
+    bool browseVisit(const NodeId& start, BrowseVisitor visit, const BrowseOptions& options = BrowseOptions());
     /*!
         \brief browseTree
         \param nodeId  start point
@@ -793,6 +1398,21 @@ public:
         \return true on success
     */
     bool browseChildren(const UA_NodeId& nodeId, NodeIdMap& m);
+    /*!
+        \brief browseTree
+        browse and create a hashed set of node ids - no string conversion
+        \param nodeId
+        \param s set to fill
+        \return true on success
+    */
+    bool browseTree(const NodeId& nodeId, NodeIdSet& s);
+    /*!
+        \brief browseChildren
+        \param nodeId parent of children to browse
+        \param s set to fill
+        \return true on success
+    */
+    bool browseChildren(const UA_NodeId& nodeId, NodeIdSet& s);
 
     /*  A simplified TranslateBrowsePathsToNodeIds based on the
         SimpleAttributeOperand type (Part 4, 7.4.4.5).
@@ -837,12 +1457,88 @@ public:
         }
         return ret;
     }
+    /*!
+        \brief saveSnapshot
+        Write the address space above namespace zero with its current values - see ServerSnapshot
+        \param path
+        \return true on success
+    */
+    bool saveSnapshot(const std::string& path);
+    /*!
+        \brief loadSnapshot
+        Restore a saved address space before the server runs, in place of building it again - node contexts
+        must be registered under the names they had when saved
+        \param path
+        \return true if the snapshot was loaded whole
+    */
+    bool loadSnapshot(const std::string& path);
     //
     /*!
         \brief serverConfig
         \return  server configuration
     */
     UA_ServerConfig& serverConfig() { return *UA_Server_getConfig(server()); }
+
+#ifdef UA_ENABLE_PUBSUB
+    /*!
+        \brief pubSub
+        \return the PubSub configuration of the server
+    */
+    ServerPubSub& pubSub() { return _pubSub; }
+#endif
+
+    /*!
+        \brief startupTrace
+        \return timings of the address space build - traced until initialise() returns
+    */
+    StartupTrace& startupTrace() { return _startup; }
+
+    /*!
+        \brief memoryReport
+        Add the estimated memory held by the server's own structures - timers, posted commands, the path
+        cache, lazy subtrees, named contexts and conditions - then that of each memory source.
+        The nodestore and sessions belong to the C stack and are not included
+        \param r report added to
+    */
+    void memoryReport(MemoryReport& r);
+    /*!
+        \brief addMemorySource
+        Include a structure the server does not own in memoryReport(), e.g. a history backend:
+            server.addMemorySource("history", [&](MemoryReport& r) { backend.memoryUsage(r); });
+        \param name replaces a source of the same name
+        \param f adds to the report - called with no server lock held
+    */
+    void addMemorySource(const std::string& name, MemoryReport::Source f);
+    /*!
+        \brief removeMemorySource
+        \param name
+    */
+    void removeMemorySource(const std::string& name);
+
+    /*!
+        \brief addLazyNode
+        Defer building the children of a node until a client first browses it. The first browse queues the
+        builder with postCommand, as nodes must not be added while the stack serves the Browse, so it returns
+        what exists then and later browses see the children. The builder runs once. Browses made through this
+        object do not trigger it; call materialize() first
+        \param node root of the subtree - must exist
+        \param build adds the subtree
+    */
+    void addLazyNode(const NodeId& node, LazyBuilder build);
+    /*!
+        \brief materialize
+        Build a lazy subtree now
+        \param node
+        \return false if the node was not lazy or its builder failed
+    */
+    bool materialize(const NodeId& node);
+    /*!
+        \brief materializeAll
+        Build every lazy subtree, including those added while building - e.g. from a worker once up
+        \return number built
+    */
+    size_t materializeAll();
+    size_t lazyPending() const { return _lazyCount; }
     //
 
     /*!
@@ -876,6 +1572,8 @@ public:
         attr.setExecutable();
         //
         QualifiedName qn(nameSpaceIndex, browseName);
+        NodeId created;  // an async method needs its id even if the caller does not
+        UA_NodeId* out = newNode.isNull() ? (method->async() ? created.notNull().ref() : nullptr) : newNode.ref();
         {
             WriteLock l(mutex());
             _lastError = UA_Server_addMethodNode(_server,
@@ -890,7 +1588,12 @@ public:
                                                  method->out().size() - 1,
                                                  method->out().data(),
                                                  (void*)(method),  // method context is reference to the call handler
-                                                 newNode.isNull() ? nullptr : newNode.ref());
+                                                 out);
+            if (lastOK() && method->async()) {
+                setMethodLane(NodeId(*out), method->lane());
+                _lastError = UA_Server_setMethodNodeAsync(_server, *out, UA_TRUE);
+                _config->asyncOperationNotifyCallback = Server::asyncOperationNotifyCallback;
+            }
         }
         return lastOK();
     }
@@ -907,11 +1610,17 @@ public:
         if (!_server)
             throw std::runtime_error("Null server");
         QualifiedName outBrowseName;
-        if (UA_Server_readBrowseName(_server, nodeId, outBrowseName) == UA_STATUSCODE_GOOD) {
+        UA_StatusCode ret;
+        {
+            AttributeReadLock l(_mutex);
+            ret = UA_Server_readBrowseName(_server, nodeId, outBrowseName);
+        }
+        _lastError = ret;
+        if (ret == UA_STATUSCODE_GOOD) {
             s  = toString(outBrowseName.get().name);
             ns = outBrowseName.get().namespaceIndex;
         }
-        return lastOK();
+        return ret == UA_STATUSCODE_GOOD;
     }
 
     /*!
@@ -927,8 +1636,58 @@ public:
         QualifiedName newBrowseName(nameSpaceIndex, name);
         WriteLock l(_mutex);
         UA_Server_writeBrowseName(_server, nodeId, newBrowseName);
+        _pathCache.clear();
     }
 
+    /*!
+        \brief pathCache
+        Memo used by nodeIdFromPath, createFolderPath and getChild. It is cleared whenever a node is deleted
+        or renamed through this object. Disable it if browse names are written directly to the stack
+        \return path cache
+    */
+    PathCache& pathCache() { return _pathCache; }
+
+    /*!
+        \brief permissionCache
+        Memo of the decisions of getUserRightsMask, getUserAccessLevel, getUserExecutable and allowBrowseNode
+        per session and node. Disabled by default - enable it when those decisions only change with roles, and
+        invalidate it when they do. Sessions are dropped when they close and nodes when they are deleted
+        \return permission cache
+    */
+    PermissionCache& permissionCache() { return _permissionCache; }
+
+    /*!
+        \brief setTimerWheel
+        Route addTimedEvent, addRepeatedTimerEvent and ServerRepeatedCallback through a timer wheel driven by
+        one repeated callback instead of one C library callback each. Times are rounded up to the tick.
+        Only changed while no wheel timers exist
+        \param tickMs wheel resolution - 0 returns to the C library scheduler
+        \param grouped batch repeating timers of the same interval - a new timer first fires with its group
+        \return true if changed
+    */
+    bool setTimerWheel(unsigned tickMs, bool grouped = true);
+
+    /*!
+        \brief timerWheelEnabled
+        \return true if timers go to the wheel
+    */
+    bool timerWheelEnabled() const { return _wheelTick != 0; }
+
+    /*!
+        \brief timerWheel
+        \return the wheel - for statistics
+    */
+    TimerWheel& timerWheel() { return _wheel; }
+
+    /*!
+        \brief addWheelTimer
+        \param delayMs until the first expiry
+        \param intervalMs repeat interval - zero for a one shot
+        \param func handler - called on the network thread with the wheel locked
+        \return timer id or 0 if the wheel is not enabled
+    */
+    UA_UInt64 addWheelTimer(unsigned delayMs, unsigned intervalMs, TimerWheel::Handler func);
+
     /*!
         \brief NodeIdFromPath get the node id from the path of browse names in the given namespace. Tests for node
        existance \param path \param nodeId \return true on success
@@ -969,6 +1728,22 @@ public:
                    NodeId& newNode    = NodeId::Null,
                    int nameSpaceIndex = 0);
 
+    /*!
+        \brief addFolder
+        As addFolder but takes an interned name - the browse and display names are not copied
+        \param parent parent node
+        \param childName interned browse name of child node
+        \param nodeId  assigned node id or NodeId::Null for auto assign
+        \param newNode receives new node if not null
+        \param nameSpaceIndex name space index of new node, if non-zero otherwise namespace of parent
+        \return true on success
+    */
+    bool addFolder(const NodeId& parent,
+                   const InternedString& childName,
+                   const NodeId& nodeId,
+                   NodeId& newNode    = NodeId::Null,
+                   int nameSpaceIndex = 0);
+
     /*!
         \brief addVariable
         \param parent
@@ -984,6 +1759,22 @@ public:
                      NodeContext* c     = nullptr,
                      int nameSpaceIndex = 0);
 
+    /*!
+        \brief addVariable
+        As addVariable but takes an interned name - names and value are passed without intermediate copies
+        \param parent
+        \param childName interned browse name
+        \param value initial value
+        \return true on success
+    */
+    bool addVariable(const NodeId& parent,
+                     const InternedString& childName,
+                     const Variant& value,
+                     const NodeId& nodeId,
+                     NodeId& newNode    = NodeId::Null,
+                     NodeContext* c     = nullptr,
+                     int nameSpaceIndex = 0);
+
     template <typename T>
     /*!
         \brief addVariable
@@ -1003,7 +1794,7 @@ public:
                      NodeId& newNode    = NodeId::Null,
                      int nameSpaceIndex = 0)
     {
-        NodeContext* cp = findContext(c);
+        NodeContext* cp = context(c);
         if (cp) {
             Variant v((T()));
             return addVariable(parent, childName, v, nodeId, newNode, cp, nameSpaceIndex);
@@ -1045,7 +1836,7 @@ public:
                                NodeId& newNode    = NodeId::Null,
                                int nameSpaceIndex = 0)
     {
-        NodeContext* cp = findContext(c);
+        NodeContext* cp = context(c);
         if (cp) {
             Variant v((T()));
             return addHistoricalVariable(parent, childName, v, nodeId, newNode, cp, nameSpaceIndex);
@@ -1110,9 +1901,10 @@ public:
 
         // outValue is managed by caller - transfer to output value
         value.null();
-        WriteLock l(_mutex);
-        UA_Server_readValue(_server, nodeId, value.ref());
-        return lastOK();
+        AttributeReadLock l(_mutex);
+        UA_StatusCode ret = UA_Server_readValue(_server, nodeId, value.ref());
+        _lastError        = ret;
+        return ret == UA_STATUSCODE_GOOD;
     }
     /*!
         \brief deleteNode
@@ -1157,7 +1949,7 @@ public:
         if (!server())
             return false;
 
-        WriteLock l(_mutex);
+        AttributeReadLock l(_mutex);
         result.get() = UA_Server_translateBrowsePathToNodeIds(_server, path);
         return result.get().statusCode == UA_STATUSCODE_GOOD;
     }
@@ -1290,6 +2082,33 @@ public:
     {
         return readAttribute(nodeId, UA_ATTRIBUTEID_VALUE, outValue);
     }
+
+    /*!
+        \brief readValue
+        Typed read of a fixed size scalar - fails if the node holds a different type
+        \param nodeId
+        \param outValue
+        \return true on success
+    */
+    template <typename T>
+    typename std::enable_if<ua_type_traits<T>::is_fixed_size, bool>::type readValue(const NodeId& nodeId,
+                                                                                      T& outValue)
+    {
+        UA_Variant v;  // on the stack - only the stack's copy of the value is allocated
+        UA_Variant_init(&v);
+        bool ret = readAttribute(nodeId.constRef(), UA_ATTRIBUTEID_VALUE, &v);
+        if (ret) {
+            if (UA_Variant_isScalar(&v) && ua_type_traits<T>::accepts(v.type)) {
+                outValue = *static_cast<const T*>(v.data);
+            }
+            else {
+                _lastError = UA_STATUSCODE_BADTYPEMISMATCH;
+                ret        = false;
+            }
+        }
+        UA_Variant_clear(&v);
+        return ret;
+    }
     /*!
         \brief readDataType
         \param nodeId
@@ -1447,11 +2266,91 @@ public:
     {
         if (!server())
             return false;
-
+        if (_writeFilter.enabled())
+            return writeValueOnChange(nodeId, value);
         return UA_STATUSCODE_GOOD ==
                (_lastError =
                     __UA_Server_write(_server, nodeId, UA_ATTRIBUTEID_VALUE, &UA_TYPES[UA_TYPES_VARIANT], value));
     }
+
+    /*!
+        \brief writeValueOnChange
+        Write through the write filter - skipped with a good status if the node's value would not change
+        \param nodeId
+        \param value
+        \return true if written or skipped
+    */
+    bool writeValueOnChange(const NodeId& nodeId, const Variant& value);
+
+    /*!
+        \brief writeValue
+        Typed write - the data type is chosen at compile time
+        \param nodeId
+        \param value
+        \return true on success
+    */
+    template <typename T>
+    typename std::enable_if<ua_type_traits<T>::is_ua_type && !std::is_same<T, UA_Variant>::value, bool>::type
+    writeValue(const NodeId& nodeId, const T& value)
+    {
+        if (!ua_type_traits<T>::is_fixed_size || _writeFilter.enabled()) {
+            Variant v;
+            v.set(value);
+            return writeValue(nodeId, v);
+        }
+        if (!server())
+            return false;
+        UA_Variant v;  // shallow - the stack copies the value
+        UA_Variant_init(&v);
+        UA_Variant_setScalar(&v, const_cast<T*>(&value), ua_type_traits<T>::type());
+        return UA_STATUSCODE_GOOD ==
+               (_lastError = __UA_Server_write(_server, nodeId, UA_ATTRIBUTEID_VALUE, &UA_TYPES[UA_TYPES_VARIANT], &v));
+    }
+    /*!
+        \brief readValues
+        Batch read of the value attribute - the server lock is taken once for the whole batch.
+        Existing entries in results are reused so repeated polls of the same tag set do not reallocate
+        \param nodeIds nodes to read
+        \param results one data value per node id - check each status
+        \param timestamps timestamps to return
+        \return true if every read succeeded
+    */
+    bool readValues(const std::vector<NodeId>& nodeIds,
+                    std::vector<DataValue>& results,
+                    UA_TimestampsToReturn timestamps = UA_TIMESTAMPSTORETURN_BOTH);
+
+    /*!
+        \brief writeFilter
+        Write only on change - writeValue and writeValues skip values equal to the last one written to the node.
+        Off until enabled with setDefault or setNode
+        \return the filter
+    */
+    WriteFilter& writeFilter() { return _writeFilter; }
+
+    /*!
+        \brief writeValues
+        Batch write of the value attribute - the server lock is taken once for the whole batch
+        \param nodeIds nodes to write
+        \param values one value per node id
+        \param results one status code per node id
+        \return true if every write succeeded
+    */
+    bool writeValues(const std::vector<NodeId>& nodeIds,
+                     const std::vector<Variant>& values,
+                     std::vector<UA_StatusCode>& results);
+
+    /*!
+        \brief writeValues
+        Batch write from plain arrays - for callers that keep their values in their own storage, such as
+        variants pointing into an array of samples, so no wrapper is built per value
+        \param n number of values
+        \param nodeIds nodes to write
+        \param values one value per node id - copied by the write
+        \param results one status code per node id
+        \return true if every write succeeded
+    */
+    bool writeValues(size_t n, const UA_NodeId* nodeIds, const UA_Variant* values, UA_StatusCode* results);
+
     /*!
         \brief writeDataType
         \param nodeId
@@ -1957,12 +2856,48 @@ public:
         if (!server())
             return false;
 
+        StartupTrace::Scope trace(_startup, "addInstance");
         ObjectAttributes oAttr;
         oAttr.setDefault();
         oAttr.setDisplayName(n);
         QualifiedName qn(parent.nameSpaceIndex(), n);
         return addObjectNode(requestedNewNodeId, parent, NodeId::Organizes, qn, typeId, oAttr, nodeId, context);
     }
+
+    /*!
+        \brief Open62541::Server::addInstance
+        As addInstance but takes an interned name - nothing is allocated for the names
+        \param n interned browse / display name
+        \param parent
+        \param nodeId
+        \return true on success
+    */
+    bool addInstance(const InternedString& n,
+                     const NodeId& requestedNewNodeId,
+                     const NodeId& parent,
+                     const NodeId& typeId,
+                     NodeId& nodeId       = NodeId::Null,
+                     NodeContext* context = nullptr)
+    {
+        if (!server())
+            return false;
+
+        StartupTrace::Scope trace(_startup, "addInstance");
+        UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;  // shallow - not cleared
+        oAttr.displayName         = makeLocalizedText(n);
+        UA_QualifiedName qn       = makeQualifiedName(parent.nameSpaceIndex(), n);
+        WriteLock l(_mutex);
+        _lastError = UA_Server_addObjectNode(_server,
+                                             requestedNewNodeId,
+                                             parent,
+                                             NodeId::Organizes,
+                                             qn,
+                                             typeId,
+                                             oAttr,
+                                             context,
+                                             nodeId.isNull() ? nullptr : nodeId.clearRef());
+        return lastOK();
+    }
     //
     //
     //
@@ -2137,9 +3072,70 @@ public:
         ac->allowHistoryUpdateDeleteRawModified = Server::allowHistoryUpdateDeleteRawModifiedHandler;
         ac->allowHistoryUpdateUpdateData        = Server::allowHistoryUpdateUpdateDataHandler;
         ac->allowTransferSubscription           = Server::allowTransferSubscriptionHandler;
+        ac->closeSession                        = Server::closeSessionHandler;
         ac->clear                               = Server::clearAccesControlHandler;
         ac->context                             = (void*)this;
+        if (ac->getUserAccessLevel != Server::getUserAccessLevelHandler)
+            _nextAccessLevel = ac->getUserAccessLevel;
+        if (ac->getUserExecutable != Server::getUserExecutableHandler)
+            _nextExecutable = ac->getUserExecutable;
+        if (_roleAccess) {
+            ac->getUserAccessLevel = Server::getUserAccessLevelHandler;
+            ac->getUserRightsMask  = Server::getUserRightsMaskHandler;
+            ac->getUserExecutable  = Server::getUserExecutableHandler;
+        }
+        else if (_sessionLimiter) {
+            ac->getUserAccessLevel = Server::getUserAccessLevelHandler;  // charged then passed to the plugin
+            ac->getUserExecutable  = Server::getUserExecutableHandler;
+        }
+        else {
+            if (_nextAccessLevel)
+                ac->getUserAccessLevel = _nextAccessLevel;
+            if (_nextExecutable)
+                ac->getUserExecutable = _nextExecutable;
+        }
     }
+
+    /*!
+        \brief setRoleAccess
+        Hand session activation and the node access checks to a role based access control object instead of the
+        access control virtuals. Call after enableSimpleLogin if user name logins are wanted - that publishes the
+        user token policies. The object must outlive the server or be removed first
+        \param r access control object or nullptr to go back to the virtuals
+    */
+    void setRoleAccess(RoleAccessControl* r)
+    {
+        _roleAccess = r;
+        if (_config)
+            setAccessControl(&_config->accessControl);
+    }
+    /*!
+        \brief roleAccess
+        \return the role based access control object or nullptr
+    */
+    RoleAccessControl* roleAccess() const { return _roleAccess; }
+
+    /*!
+        \brief setSessionLimiter
+        Charge browse, read and call operations to the session's budget in SessionLimiter, rejecting them when it
+        is spent, and cap the method calls a session runs at once. Async method calls are counted from when they
+        are queued, together, as the stack runs them without their session. The admin session is never limited.
+        The object must outlive the server or be removed first
+        \param l limiter or nullptr for none
+    */
+    void setSessionLimiter(SessionLimiter* l)
+    {
+        _sessionLimiter = l;
+        if (_config)
+            setAccessControl(&_config->accessControl);
+    }
+    SessionLimiter* sessionLimiter() const { return _sessionLimiter; }
+    /*!
+        \brief limiterFor
+        \param sessionId
+        \return the limiter if operations of this session are limited, otherwise nullptr
+    */
+    SessionLimiter* limiterFor(const UA_NodeId* sessionId) const;
     //
     // Access control
     //
@@ -2362,9 +3358,7 @@ public:
         if (lastOK()) {
             // create the condition object
             ConditionPtr c(new T(*this, outConditionId, conditionSource));
-            outCondition       = c.get();
-            unsigned key       = UA_NodeId_hash(outConditionId.clearRef());
-            _conditionMap[key] = std::move(c);  // servers own the condition objects
+            outCondition = _conditions.add(std::move(c));  // servers own the condition objects
             return true;
         }
         return false;
@@ -2374,7 +3368,12 @@ public:
      * \brief deleteCondition
      * \param c
      */
-    void deleteCondition(const NodeId& c) { _conditionMap.erase(UA_NodeId_hash(c.ref())); }
+    void deleteCondition(const NodeId& c)
+    {
+        if (_alarmFilter)
+            _alarmFilter->forget(c);
+        _conditions.remove(c);
+    }
 #endif
     /*!
      * \brief setConditionTwoStateVariableCallback
@@ -2388,8 +3387,8 @@ public:
                                               UA_TwoStateVariableCallbackType callbackType,
                                               bool removeBranch = false)
     {
-        ConditionPtr& c = findCondition(condition);  // conditions are bound to servers - possible for the same node id
-                                                     // to be used in different servers
+        ConditionPtr c = findCondition(condition);  // conditions are bound to servers - possible for the same
+                                                    // node id to be used in different servers
         if (c) {
             return c->setCallback(callbackType, removeBranch);
         }
@@ -2471,8 +3470,12 @@ public:
     bool addTimedEvent(unsigned msDelay, UA_UInt64& callbackId, std::function<void(Timer&)> func)
     {
         if (_server) {
-            UA_DateTime dt = UA_DateTime_nowMonotonic() + (UA_DATETIME_MSEC * msDelay);
+            if (timerWheelEnabled()) {
+                return addWheelTimerEvent(msDelay, 0, callbackId, func);
+            }
+            std::lock_guard<std::recursive_mutex> l(_timerMutex);
             TimerPtr t(new Timer(this, 0, true, func));
+            UA_DateTime dt = UA_DateTime_nowMonotonic() + (UA_DATETIME_MSEC * msDelay);
             _lastError = UA_Server_addTimedCallback(_server, Server::timerCallback, t.get(), dt, &callbackId);
             t->setId(callbackId);
             _timerMap[callbackId] = std::move(t);
@@ -2499,6 +3502,10 @@ public:
     bool addRepeatedTimerEvent(UA_Double interval_ms, UA_UInt64& callbackId, std::function<void(Timer&)> func)
     {
         if (_server) {
+            if (timerWheelEnabled()) {
+                return addWheelTimerEvent(unsigned(interval_ms), unsigned(interval_ms), callbackId, func);
+            }
+            std::lock_guard<std::recursive_mutex> l(_timerMutex);
             TimerPtr t(new Timer(this, 0, false, func));
             _lastError =
                 UA_Server_addRepeatedCallback(_server, Server::timerCallback, t.get(), interval_ms, &callbackId);
@@ -2517,6 +3524,11 @@ public:
      */
     bool changeRepeatedTimerInterval(UA_UInt64 callbackId, UA_Double interval_ms)
     {
+        if (TimerWheel::isWheelId(callbackId)) {
+            _lastError = _wheel.changeInterval(callbackId, unsigned(interval_ms)) ? UA_STATUSCODE_GOOD
+                                                                                   : UA_STATUSCODE_BADNOTFOUND;
+            return lastOK();
+        }
         if (_server) {
             _lastError = UA_Server_changeRepeatedCallbackInterval(_server, callbackId, interval_ms);
             return lastOK();
@@ -2524,11 +3536,29 @@ public:
         return false;
     }
     /*!
-     * \brief UA_Client_removeCallback
-     * \param client
+     * \brief removeTimerEvent
+     * The stack scheduler is only changed on the loop thread - from any other thread while the server runs the
+     * removal is posted and takes effect when the command runs. A handler already running on the pool is not
+     * waited for and may finish after this returns.
      * \param callbackId
      */
-    void removeTimerEvent(UA_UInt64 callbackId) { _timerMap.erase(callbackId); }
+    void removeTimerEvent(UA_UInt64 callbackId)
+    {
+        if (TimerWheel::isWheelId(callbackId)) {
+            _wheel.cancel(callbackId);  // before _timerMutex - wheel handlers take it
+        }
+        else if (_running && (_loopThread.load() != std::this_thread::get_id())) {
+            if (!postCommand([callbackId](Server& s) { s.removeTimerEvent(callbackId); })) {
+                _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;  // queue full - the timer is left running
+            }
+            return;
+        }
+        else if (_server) {
+            UA_Server_removeCallback(_server, callbackId);
+        }
+        std::lock_guard<std::recursive_mutex> l(_timerMutex);
+        _timerMap.erase(callbackId);  // handleTimer ignores ids no longer in the map
+    }
 
     //
     // Publish Subscribe Support - To be added when it is finished
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef PARALLELHISTORY_H
+#define PARALLELHISTORY_H
+#include <open62541cpp/historydatabase.h>
+#include <open62541cpp/workerpool.h>
+#include <atomic>
+
+namespace Open62541 {
+
+/*!
+    \brief The ParallelHistoryDatabase class
+    History database whose raw reads of many nodes run concurrently. Access, historizing and backend
+    checks are made for every node on the server thread, then the backend queries are spread over a
+    worker pool and the call returns once every node's result is in place - results are written
+    straight into their slot so the order is that of the request.
+    Value writes, updates and deletes go to the stack's default database around the same gathering.
+    The backends must allow concurrent reads - calls into a backend that serialises its reads
+    still run one at a time.
+
+        Open62541::ParallelHistoryDatabase db(historian.gathering());
+        server.setHistoryDatabase(db.database());
+        server.workers().start(8);
+*/
+class UA_EXPORT ParallelHistoryDatabase : public HistoryDatabase
+{
+    UA_HistoryDatabase _default;        // writes, updates and deletes
+    UA_HistoryDataGathering _gathering; // shallow copy - node settings
+    WorkerPool* _pool    = nullptr;     // nullptr - the server's pool
+    size_t _threshold    = 2;           // nodes in a request before it is spread
+    std::atomic<uint64_t> _parallelReads{0};
+    std::atomic<uint64_t> _serialReads{0};
+
+public:
+    /*!
+        \brief The Read struct
+        One node of a raw read, checked and ready for its backend
+    */
+    struct Read {
+        const UA_HistoryReadValueId* item = nullptr;
+        UA_HistoryReadResult* result      = nullptr;
+        UA_HistoryData* data              = nullptr;
+        UA_HistoryDataBackend backend;  // shallow
+        size_t maxSize = 0;
+        UA_NumericRange range;
+        Read()
+        {
+            memset(&backend, 0, sizeof(backend));
+            range.dimensionsSize = 0;
+            range.dimensions     = nullptr;
+        }
+    };
+
+    /*!
+        \brief ParallelHistoryDatabase
+        \param gathering the gathering the nodes are registered with - e.g. historian.gathering()
+    */
+    ParallelHistoryDatabase(const UA_HistoryDataGathering& gathering);
+    virtual ~ParallelHistoryDatabase();
+
+    /*!
+        \brief setWorkerPool
+        \param p pool to run reads on, nullptr for the server's pool - reads run on the calling thread
+        if the pool is not running
+    */
+    void setWorkerPool(WorkerPool* p) { _pool = p; }
+    WorkerPool* workerPool() const { return _pool; }
+    /*!
+        \brief setParallelThreshold
+        \param n requests with fewer nodes are read on the calling thread
+    */
+    void setParallelThreshold(size_t n) { _threshold = n ? n : 1; }
+    size_t parallelThreshold() const { return _threshold; }
+
+    // metrics
+    uint64_t parallelReads() const { return _parallelReads; }
+    uint64_t serialReads() const { return _serialReads; }
+
+    /*!
+        \brief readHistory
+        The stack's default raw read over a backend's low level interface - the same paging and
+        continuation points - usable from any thread
+        \return status of the node's read
+    */
+    static UA_StatusCode readHistory(UA_Server* server,
+                                     const UA_NodeId* sessionId,
+                                     void* sessionContext,
+                                     const UA_HistoryDataBackend& backend,
+                                     const UA_ReadRawModifiedDetails& details,
+                                     UA_TimestampsToReturn timestampsToReturn,
+                                     UA_Boolean releaseContinuationPoints,
+                                     size_t maxSize,
+                                     UA_NumericRange range,
+                                     const UA_NodeId* nodeId,
+                                     const UA_ByteString* continuationPoint,
+                                     UA_ByteString* outContinuationPoint,
+                                     UA_HistoryData* result);
+
+    // HistoryDatabase
+    virtual void deleteMembers();
+    virtual void setValue(Context& c, UA_Boolean historizing, const UA_DataValue* value);
+    virtual void readRaw(Context& c,
+                         const UA_RequestHeader* requestHeader,
+                         const UA_ReadRawModifiedDetails* historyReadDetails,
+                         UA_TimestampsToReturn timestampsToReturn,
+                         UA_Boolean releaseContinuationPoints,
+                         size_t nodesToReadSize,
+                         const UA_HistoryReadValueId* nodesToRead,
+                         UA_HistoryReadResponse* response,
+                         UA_HistoryData* const* const historyData);
+    virtual void updateData(Context& c,
+                            const UA_RequestHeader* requestHeader,
+                            const UA_UpdateDataDetails* details,
+                            UA_HistoryUpdateResult* result);
+    virtual void deleteRawModified(Context& c,
+                                   const UA_RequestHeader* requestHeader,
+                                   const UA_DeleteRawModifiedDetails* details,
+                                   UA_HistoryUpdateResult* result);
+};
+
+}  // namespace Open62541
+
+#endif  // PARALLELHISTORY_H
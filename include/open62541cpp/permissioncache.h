@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef PERMISSIONCACHE_H
+#define PERMISSIONCACHE_H
+#include <open62541cpp/open62541objects.h>
+#include <memory>
+#include <unordered_map>
+
+namespace Open62541 {
+
+/*!
+    \brief The PermissionCache class
+    Memo of access control decisions keyed on (session, node, operation) so repeated browse and read checks
+    are a hash probe instead of a virtual call into the server's handlers.
+    Each session has a table of decisions. Sessions bound to the same profile - e.g. a role name, set when the
+    session is activated - share one table, and a table may carry a compiled default per operation that
+    answers for every node without an entry. Decisions are only as fresh as the last invalidation: call
+    invalidate(), invalidateSession() or invalidateProfile() when roles or node permissions change
+*/
+class UA_EXPORT PermissionCache
+{
+public:
+    /*!
+        \brief The Operation enum
+    */
+    enum Operation {
+        RightsMask = 0,  //!< getUserRightsMask
+        AccessLevel,     //!< getUserAccessLevel
+        Executable,      //!< getUserExecutable
+        Browse,          //!< allowBrowseNode
+        OperationCount
+    };
+
+    /*!
+        \brief The Table class
+        Decisions of one session or profile
+    */
+    class UA_EXPORT Table
+    {
+        struct Entry {
+            UA_UInt32 known = 0;  // bit per operation
+            UA_UInt32 value[OperationCount] = {};
+        };
+        mutable ReadWriteMutex _mutex;
+        UnorderedNodeIdMap<Entry> _entries;
+        UA_UInt32 _defaults = 0;  // bit per operation with a compiled default
+        UA_UInt32 _default[OperationCount] = {};
+
+    public:
+        Table() {}
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+        /*!
+            \brief find
+            \param node
+            \param op
+            \param v set to the decision
+            \return true if the node has an entry for op or op has a default
+        */
+        bool find(const UA_NodeId& node, Operation op, UA_UInt32& v) const;
+        /*!
+            \brief put
+            \param node
+            \param op
+            \param v decision
+            \param maxEntries the table is emptied rather than grown past this
+        */
+        void put(const UA_NodeId& node, Operation op, UA_UInt32 v, size_t maxEntries = SIZE_MAX);
+        /*!
+            \brief setDefault
+            Compiled decision for nodes without an entry
+            \param op
+            \param v
+        */
+        void setDefault(Operation op, UA_UInt32 v);
+        void clearDefault(Operation op);
+        /*!
+            \brief remove
+            \param node
+        */
+        void remove(const UA_NodeId& node);
+        /*!
+            \brief clear
+            Drop every entry - defaults are kept unless all is set
+            \param all
+        */
+        void clear(bool all = false);
+        size_t size() const
+        {
+            ReadLock l(_mutex);
+            return _entries.size();
+        }
+    };
+    typedef std::shared_ptr<Table> TableRef;
+
+private:
+    mutable ReadWriteMutex _mutex;  // guards the session and profile maps
+    UnorderedNodeIdMap<TableRef> _sessions;
+    std::unordered_map<std::string, TableRef> _profiles;
+    bool _enabled      = true;
+    size_t _maxEntries = 100000;  // per table
+
+    TableRef sessionTable(const UA_NodeId& session) const;
+
+public:
+    PermissionCache(bool enabled = true)
+        : _enabled(enabled)
+    {
+    }
+    PermissionCache(const PermissionCache&) = delete;
+    PermissionCache& operator=(const PermissionCache&) = delete;
+
+    /*!
+        \brief find
+        \param session
+        \param node
+        \param op
+        \param v set to the cached decision
+        \return true if a decision is cached - false if not or the cache is disabled
+    */
+    bool find(const UA_NodeId& session, const UA_NodeId& node, Operation op, UA_UInt32& v) const;
+    /*!
+        \brief put
+        Record a decision - the session's table is created if it has none
+        \param session
+        \param node
+        \param op
+        \param v
+    */
+    void put(const UA_NodeId& session, const UA_NodeId& node, Operation op, UA_UInt32 v);
+
+    /*!
+        \brief table
+        \param session
+        \param create make a table for the session if it has none
+        \return the session's table or nullptr
+    */
+    TableRef table(const UA_NodeId& session, bool create = true);
+    /*!
+        \brief profile
+        Get or create the shared table of a profile - e.g. to compile its defaults before any session is bound
+        \param name
+        \return the table
+    */
+    TableRef profile(const std::string& name);
+    /*!
+        \brief setProfile
+        Bind a session to a profile's table - typically called from activateSession once the user's roles are
+        known. The session's own decisions are discarded
+        \param session
+        \param name
+    */
+    void setProfile(const UA_NodeId& session, const std::string& name);
+    /*!
+        \brief removeProfile
+        Drop a profile - sessions bound to it keep its table until they close or are invalidated
+        \param name
+    */
+    void removeProfile(const std::string& name);
+    /*!
+        \brief removeSession
+        Forget a session - called when it closes
+        \param session
+    */
+    void removeSession(const UA_NodeId& session);
+
+    /*!
+        \brief invalidate
+        Drop every cached decision - compiled defaults are kept
+    */
+    void invalidate();
+    /*!
+        \brief invalidateSession
+        Drop the decisions of a session - e.g. after its user's roles change. A session bound to a profile is
+        unbound from it so its next checks go to the handlers
+        \param session
+    */
+    void invalidateSession(const UA_NodeId& session);
+    /*!
+        \brief invalidateProfile
+        Drop the decisions shared by a profile's sessions - compiled defaults are kept
+        \param name
+    */
+    void invalidateProfile(const std::string& name);
+    /*!
+        \brief invalidateNode
+        Drop every session's decisions for a node - e.g. when its permissions change or it is deleted
+        \param node
+    */
+    void invalidateNode(const UA_NodeId& node);
+    /*!
+        \brief clear
+        Forget all sessions and profiles
+    */
+    void clear();
+
+    size_t sessions() const
+    {
+        ReadLock l(_mutex);
+        return _sessions.size();
+    }
+    bool enabled() const { return _enabled; }
+    void setEnabled(bool f)
+    {
+        _enabled = f;
+        if (!f)
+            clear();
+    }
+    size_t maxEntries() const { return _maxEntries; }
+    void setMaxEntries(size_t n) { _maxEntries = n ? n : 1; }
+};
+
+}  // namespace Open62541
+
+#endif  // PERMISSIONCACHE_H
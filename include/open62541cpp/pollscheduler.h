@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/servercallbackgroup.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The PollScheduler class
+    Demand driven device polling. Nodes are added with the function that refreshes them from the device and
+    are only polled while a monitored item is sampling their value, as reported by the server's monitored
+    item register hook. Polled nodes share one ServerCallbackGroup per interval.
+    open62541 does not pass the sampling interval to the hook, so a node is polled at the interval it was
+    added with - typically its MinimumSamplingInterval - or a faster one given to request().
+    Changes are applied on the server loop thread through Server::postCommand, never inside the stack's
+    callback. Create after the server, destroy before it and not while its loop is running
+*/
+class UA_EXPORT PollScheduler
+{
+public:
+    /*!
+        \brief PollFunc
+        Read the device and write the node - runs on the server thread
+    */
+    typedef std::function<void(Server&, const NodeId&)> PollFunc;
+
+private:
+    struct Entry {
+        unsigned interval  = 1000;  // ms - as added
+        unsigned requested = 0;     // ms - faster rate asked for, 0 if none
+        size_t monitors    = 0;     // monitored items sampling the value
+        unsigned group     = 0;     // interval of the group polling it - 0 if idle
+        UA_UInt64 member   = 0;
+        bool queued        = false;  // an apply is posted
+        bool removed       = false;  // erased once polling has stopped
+        std::shared_ptr<PollFunc> func;
+    };
+    Server& _server;
+    size_t _phases = 10;
+    mutable std::mutex _mutex;
+    UnorderedNodeIdMap<Entry> _entries;
+    std::map<unsigned, std::unique_ptr<ServerCallbackGroup>> _groups;  // by interval - loop thread only
+    std::shared_ptr<PollScheduler*> _self;                            // expires with the scheduler
+    std::atomic<size_t> _polls{0};
+    std::atomic<size_t> _active{0};
+
+    void schedule(const UA_NodeId& node);
+    void apply(const NodeId& node);
+    void poll(const NodeId& node);
+
+public:
+    /*!
+        \brief PollScheduler
+        Installs itself as the server's monitored item register handler
+        \param s server
+        \param phases per group - see ServerCallbackGroup
+    */
+    PollScheduler(Server& s, size_t phases = 10);
+    PollScheduler(const PollScheduler&) = delete;
+    PollScheduler& operator=(const PollScheduler&) = delete;
+    virtual ~PollScheduler();
+
+    /*!
+        \brief add
+        \param node
+        \param intervalMs poll interval while monitored
+        \param func
+        \return false if already added
+    */
+    bool add(const NodeId& node, unsigned intervalMs, PollFunc func);
+    /*!
+        \brief remove
+        \param node
+        \return false if not known
+    */
+    bool remove(const NodeId& node);
+    /*!
+        \brief request
+        \param node
+        \param intervalMs faster interval to poll at while monitored - 0 to go back to the added interval
+        \return false if not known
+    */
+    bool request(const NodeId& node, unsigned intervalMs);
+    /*!
+        \brief monitored
+        Called by the server as monitored items on the node's value are created and deleted
+        \param node
+        \param removed
+    */
+    void monitored(const UA_NodeId& node, bool removed);
+
+    /*!
+        \brief size
+        \return number of nodes added
+    */
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _entries.size();
+    }
+    /*!
+        \brief active
+        \return number of nodes being polled
+    */
+    size_t active() const { return _active; }
+    /*!
+        \brief polls
+        \return device polls made
+    */
+    size_t polls() const { return _polls; }
+};
+
+}  // namespace Open62541
+
+#endif  // POLLSCHEDULER_H
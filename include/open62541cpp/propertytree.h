@@ -24,15 +24,19 @@
 #include <algorithm>
 #include <ostream>
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
 
-// Mutexs
+#include <open62541cpp/lockpolicy.h>
+
+// Mutexs - ReadWriteMutex, ReadLock and WriteLock are set by the lock policy of the build - see lockpolicy.h
 //
 namespace Open62541 {
 
-typedef boost::shared_mutex ReadWriteMutex;
-typedef boost::shared_lock<boost::shared_mutex> ReadLock;
-typedef boost::unique_lock<boost::shared_mutex> WriteLock;
-
 // a tree is an addressable set of nodes
 // objects of type T must have an assignment operator
 //
@@ -88,12 +92,189 @@ public:
     }
 };
 
-template <typename K, typename T>
+/*!
+    \brief The FlatChildMap class
+    Children of a node as a vector kept sorted by key - the subset of the std::map interface the tree uses.
+    Iteration is in key order over contiguous storage and there is no allocation per child
+*/
+template <typename K, typename V>
+class FlatChildMap
+{
+public:
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    std::vector<value_type> _v;
+    iterator lower(const K& k)
+    {
+        if (_v.empty() || (_v.back().first < k))
+            return _v.end();  // appending in order is the usual case
+        return std::lower_bound(_v.begin(), _v.end(), k, [](const value_type& a, const K& b) { return a.first < b; });
+    }
+
+public:
+    iterator begin() { return _v.begin(); }
+    iterator end() { return _v.end(); }
+    const_iterator begin() const { return _v.begin(); }
+    const_iterator end() const { return _v.end(); }
+    size_t size() const { return _v.size(); }
+    bool empty() const { return _v.empty(); }
+    void clear() { _v.clear(); }
+    void reserve(size_t n) { _v.reserve(n); }
+    iterator find(const K& k)
+    {
+        iterator i = lower(k);
+        return ((i != _v.end()) && !(k < i->first)) ? i : _v.end();
+    }
+    size_t count(const K& k) { return (find(k) != _v.end()) ? 1 : 0; }
+    V& operator[](const K& k)
+    {
+        iterator i = lower(k);
+        if ((i == _v.end()) || (k < i->first))
+            i = _v.insert(i, value_type(k, V()));
+        return i->second;
+    }
+    size_t erase(const K& k)
+    {
+        iterator i = find(k);
+        if (i == _v.end())
+            return 0;
+        _v.erase(i);
+        return 1;
+    }
+    iterator erase(iterator i) { return _v.erase(i); }
+};
+
+/*!
+    \brief The NodeSlab class
+    Fixed size blocks carved from slabs for the nodes of pooled trees. Freed blocks are reused, slabs are
+    never returned - the pool of each node type is shared by every tree of that type
+*/
+template <size_t Size, size_t Align>
+class NodeSlab
+{
+    union Slot {
+        Slot* next;
+        typename std::aligned_storage<Size, Align>::type storage;
+    };
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Slot[]>> _slabs;
+    Slot* _free      = nullptr;
+    size_t _slabSize = 256;  // doubles up to a limit as the pool grows
+    size_t _capacity = 0;
+    size_t _inUse    = 0;
+
+    NodeSlab() {}
+
+public:
+    /*!
+        \brief instance
+        Never destroyed - trees in static storage may outlive it otherwise
+        \return the pool for this block size
+    */
+    static NodeSlab& instance()
+    {
+        static NodeSlab* s = new NodeSlab();
+        return *s;
+    }
+    /*!
+        \brief allocate
+        \return uninitialised block
+    */
+    void* allocate()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (!_free) {
+            Slot* b = new Slot[_slabSize];
+            for (size_t i = 0; i < _slabSize; i++) {
+                b[i].next = (i + 1 < _slabSize) ? &b[i + 1] : nullptr;
+            }
+            _slabs.emplace_back(b);
+            _free = b;
+            _capacity += _slabSize;
+            if (_slabSize < 65536)
+                _slabSize *= 2;
+        }
+        Slot* s = _free;
+        _free   = s->next;
+        _inUse++;
+        return s;
+    }
+    /*!
+        \brief deallocate
+        \param p block from allocate
+    */
+    void deallocate(void* p)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Slot* s = static_cast<Slot*>(p);
+        s->next = _free;
+        _free   = s;
+        _inUse--;
+    }
+    size_t capacity() const { return _capacity; }
+    size_t inUse() const { return _inUse; }
+};
+
+/*!
+    \brief The HeapNodeStorage struct
+    Storage policy - each node allocated with new and children held in a std::map
+*/
+struct HeapNodeStorage {
+    template <typename K, typename N>
+    using ChildMap = std::map<K, N*>;
+    template <typename N, typename... A>
+    static N* create(A&&... a)
+    {
+        return new N(std::forward<A>(a)...);
+    }
+    template <typename N>
+    static void destroy(N* n)
+    {
+        delete n;
+    }
+};
+
+/*!
+    \brief The PooledNodeStorage struct
+    Storage policy - nodes carved from a NodeSlab and children held in a sorted vector. Nodes of a pooled
+    tree must be made with createChild or Node::create, never with new
+*/
+struct PooledNodeStorage {
+    template <typename K, typename N>
+    using ChildMap = FlatChildMap<K, N*>;
+    template <typename N, typename... A>
+    static N* create(A&&... a)
+    {
+        NodeSlab<sizeof(N), alignof(N)>& pool = NodeSlab<sizeof(N), alignof(N)>::instance();
+        void* p                                = pool.allocate();
+        try {
+            return new (p) N(std::forward<A>(a)...);
+        }
+        catch (...) {
+            pool.deallocate(p);
+            throw;
+        }
+    }
+    template <typename N>
+    static void destroy(N* n)
+    {
+        if (n) {
+            n->~N();
+            NodeSlab<sizeof(N), alignof(N)>::instance().deallocate(n);
+        }
+    }
+};
+
+template <typename K, typename T, typename Storage_ = HeapNodeStorage>
 class Node
 {
 public:
-    typedef std::map<K, Node*> ChildMap;
+    typedef typename Storage_::template ChildMap<K, Node> ChildMap;
     typedef NodePath<K> Path;
+    typedef Storage_ Storage;
 
 private:
     // the name of the node
@@ -104,6 +285,9 @@ private:
     Node* _parent = nullptr;
     //
     ChildMap _children;
+    // change tracking - set by the tree
+    uint64_t _version        = 0;  // last change to the data or children of this node
+    uint64_t _subtreeVersion = 0;  // last change anywhere in the subtree
     //
 public:
     class NodeIteratorFunc
@@ -127,6 +311,23 @@ public:
     {
     }
 
+    /*!
+        \brief create
+        Make a node with the tree's storage policy
+        \return new node
+    */
+    template <typename... A>
+    static Node* create(A&&... a)
+    {
+        return Storage_::template create<Node>(std::forward<A>(a)...);
+    }
+    /*!
+        \brief destroy
+        Release a node made by create, with its subtree
+        \param n
+    */
+    static void destroy(Node* n) { Storage_::destroy(n); }
+
     /*!
         \brief ~Node
     */
@@ -148,7 +349,7 @@ public:
             Node* n = i->second;
             if (n) {
                 n->_parent = nullptr;
-                delete n;
+                destroy(n);
             }
         }
         _children.clear();
@@ -177,26 +378,39 @@ public:
         \param s
         \return
     */
-    Node* child(const K& s) { return _children[s]; }
+    Node* child(const K& s)
+    {
+        auto i = _children.find(s);
+        return (i != _children.end()) ? i->second : nullptr;
+    }
 
     /*!
         \brief hasChild
         \param s
         \return
     */
-    bool hasChild(const K& s) { return _children[s] != nullptr; }
+    bool hasChild(const K& s) { return child(s) != nullptr; }
     /*!
         \brief addChild
+        Replaces any child of the same name. A node still held by another parent is moved
         \param key
         \param n
     */
     void addChild(Node* n)
     {
-        if (hasChild(n->name())) {
-            delete _children[n->name()];
-            _children.erase(n->name());
+        Node* o = n->_parent;
+        if (o && (o != this)) {
+            auto i = o->_children.find(n->name());
+            if ((i != o->_children.end()) && (i->second == n))
+                o->_children.erase(i);  // detach - the old parent must not destroy it
+        }
+        Node*& c = _children[n->name()];
+        if (c && (c != n)) {
+            c->_parent = nullptr;  // already detached
+            destroy(c);
         }
-        _children[n->name()] = n;
+        c          = n;
+        n->_parent = this;
     }
 
     /*!
@@ -209,7 +423,7 @@ public:
     {
         if (!p)
             p = this;
-        Node* n = new Node(s, p);
+        Node* n = create(s, p);
         addChild(n);
         return n;
     }
@@ -220,11 +434,11 @@ public:
     */
     void removeChild(const K& s)
     {
-        if (hasChild(s)) {
-            Node* n = child(s);  // take the child node
+        Node* n = child(s);  // take the child node
+        if (n) {
             _children.erase(s);
-            if (n)
-                delete n;
+            n->_parent = nullptr;
+            destroy(n);
         }
     }
     // accessors
@@ -243,6 +457,29 @@ public:
         \return
     */
     Node* parent() const { return _parent; }
+    /*!
+        \brief version
+        \return tree version of the last change to the data or children of this node, 0 if never tracked
+    */
+    uint64_t version() const { return _version; }
+    /*!
+        \brief subtreeVersion
+        \return tree version of the last change in this subtree
+    */
+    uint64_t subtreeVersion() const { return _subtreeVersion; }
+    /*!
+        \brief setVersion
+        Mark the node changed - the subtree version of the parents up to, not including, top follows
+        \param v
+        \param top
+    */
+    void setVersion(uint64_t v, const Node* top = nullptr)
+    {
+        _version = v;
+        for (Node* n = this; n && (n != top); n = n->_parent) {
+            n->_subtreeVersion = v;
+        }
+    }
     /*!
         \brief setParent
         \param p
@@ -334,7 +571,7 @@ public:
         Node* p = find(path);
 
         if (p) {
-            delete p;
+            destroy(p);  // detaches from its parent
         }
     }
 
@@ -408,7 +645,7 @@ public:
         is >> n;
         if (n > 0) {
             for (int i = 0; i < n; i++) {
-                Node* o = new Node();
+                Node* o = create();
                 o->read(is);  // recurse
                 addChild(o);  // add subtree to children
             }
@@ -427,7 +664,7 @@ public:
         n->setData(data());
         if (children().size() > 0) {
             for (auto i = children().begin(); i != children().end(); i++) {
-                Node* c = new Node();
+                Node* c = create(i->first, n);
                 n->addChild(c);        // add the child
                 i->second->copyTo(c);  // now recurse
             }
@@ -435,22 +672,350 @@ public:
     }
 };
 /*!
+    \brief The PathIndex class
+    Full path hash to node index for a PropertyTree - a complete path resolves with one probe instead of a
+    child lookup per element. A probe is checked against the names up the node's parents, so a hash
+    collision costs a compare, never a wrong node. Nodes must leave the tree through the tree (remove,
+    clear) while it is indexed, or the index is left holding them
+*/
+template <typename K, typename N>
+class PathIndex
+{
+    std::unordered_multimap<size_t, N*> _map;
 
+    static bool matches(const N* n, const NodePath<K>& p, const N* root)
+    {
+        for (auto i = p.rbegin(); i != p.rend(); i++) {
+            if (!n || (n == root) || !(n->name() == *i))
+                return false;
+            n = n->parent();
+        }
+        return n == root;
+    }
+
+public:
+    /*!
+        \brief combine
+        \param h hash of the parent path
+        \param k child name
+        \return hash of the child path
+    */
+    static size_t combine(size_t h, const K& k) { return h ^ (std::hash<K>()(k) + 0x9e3779b9 + (h << 6) + (h >> 2)); }
+    /*!
+        \brief hashOf
+        \param p path
+        \return path hash - pass to the PropertyTree overloads that take one to skip hashing a path again
+    */
+    static size_t hashOf(const NodePath<K>& p)
+    {
+        size_t h = 0;
+        for (auto i = p.begin(); i != p.end(); i++) {
+            h = combine(h, *i);
+        }
+        return h;
+    }
+    /*!
+        \brief hashOf
+        \param n node
+        \param root root of the tree
+        \return hash of the path of n from root
+    */
+    static size_t hashOf(const N* n, const N* root)
+    {
+        return (!n || (n == root)) ? 0 : combine(hashOf(n->parent(), root), n->name());
+    }
+    /*!
+        \brief find
+        \param p path
+        \param h hash of p
+        \param root
+        \return node or nullptr if not indexed
+    */
+    N* find(const NodePath<K>& p, size_t h, const N* root) const
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (matches(i->second, p, root))
+                return i->second;
+        }
+        return nullptr;
+    }
+    /*!
+        \brief insert
+        \param h path hash
+        \param n
+    */
+    void insert(size_t h, N* n)
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (i->second == n)
+                return;
+        }
+        _map.emplace(h, n);
+    }
+    /*!
+        \brief insertTree
+        Index a node and its subtree
+        \param h path hash of n
+        \param n
+    */
+    void insertTree(size_t h, N* n)
+    {
+        insert(h, n);
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second)
+                insertTree(combine(h, i->first), i->second);
+        }
+    }
+    /*!
+        \brief eraseTree
+        Drop a node and its subtree
+        \param h path hash of n
+        \param n
+    */
+    void eraseTree(size_t h, N* n)
+    {
+        auto r = _map.equal_range(h);
+        for (auto i = r.first; i != r.second; i++) {
+            if (i->second == n) {
+                _map.erase(i);
+                break;
+            }
+        }
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second)
+                eraseTree(combine(h, i->first), i->second);
+        }
+    }
+    /*!
+        \brief build
+        Index every node below root
+        \param root
+    */
+    void build(N* root)
+    {
+        _map.clear();
+        for (auto i = root->children().begin(); i != root->children().end(); i++) {
+            if (i->second)
+                insertTree(combine(0, i->first), i->second);
+        }
+    }
+    void clear() { _map.clear(); }
+    size_t size() const { return _map.size(); }
+};
+
+/*!
+    \brief The PropertyTree class
+    Locking is per branch - a subtree of the root. Operations hold the tree mutex shared and the lock of
+    the branch they touch, so writers to different branches run in parallel and readers only wait for
+    writers to their own branch. Making or removing a branch, clear, read and iterateNodes hold the tree
+    mutex exclusively. Branches share BranchLocks locks by the hash of their name
+    \param Storage storage policy of the nodes - HeapNodeStorage or PooledNodeStorage
 */
-template <typename K, typename T>
+template <typename K, typename T, typename Storage = HeapNodeStorage>
 class PropertyTree
 {
+public:
+    enum { BranchLocks = 32 };  // power of two
+
+private:
     mutable ReadWriteMutex _mutex;
-    bool _changed = false;
+    mutable ReadWriteMutex _branch[BranchLocks];
+    std::atomic<bool> _changed{false};
+    std::atomic<uint64_t> _version{0};  // change counter - node versions are taken from it
+    std::atomic<uint32_t> _dirty{0};    // bit per branch lock set when a branch under it changes
 
 public:
     T _defaultData;
-    typedef Node<K, T> PropertyNode;
+    typedef Node<K, T, Storage> PropertyNode;
     typedef NodePath<K> Path;
+    typedef PathIndex<K, PropertyNode> Index;
+    /*!
+        \brief The ChangeKind enum
+        Reported by applyDiff
+    */
+    enum class ChangeKind { Added, Removed, Modified };
+    // kind, path of the node, the node - for Removed it is deleted after the call
+    typedef std::function<void(ChangeKind, const Path&, PropertyNode*)> ChangeFunc;
 
 private:
-    PropertyNode _empty;  // empty node
-    PropertyNode _root;   // the root node
+    PropertyNode _empty;          // empty node
+    PropertyNode _root;           // the root node
+    Index _index[BranchLocks];    // full path index when enabled - one per branch lock
+    bool _indexed = false;
+
+    static const Path& toPath(const Path& p) { return p; }
+    static Path toPath(const K& s)
+    {
+        Path p;
+        p.toList(s);
+        return p;
+    }
+    static size_t branch(const K& k) { return std::hash<K>()(k) & (BranchLocks - 1); }
+    // name of the branch holding n
+    const K& branchOf(PropertyNode* n) const
+    {
+        while (n->parent() && (n->parent() != &_root)) {
+            n = n->parent();
+        }
+        return n->name();
+    }
+    // caller holds the tree lock shared and the branch lock, or the tree lock exclusively
+    PropertyNode* lookup(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return nullptr;
+        if (_indexed) {
+            PropertyNode* n = _index[branch(path.front())].find(path, h, &_root);
+            if (n)
+                return n;  // nodes added through the node API are not indexed - walk for those
+        }
+        return _root.find(path);
+    }
+    // caller holds the branch lock exclusively or the tree lock exclusively
+    PropertyNode* addPath(const Path& path, size_t h)
+    {
+        PropertyNode* n = lookup(path, h);
+        if (!n) {
+            n = _root.add(path);
+            if (_indexed) {
+                // index the path and any parents made on the way
+                Index& x        = _index[branch(path.front())];
+                PropertyNode* c = n;
+                size_t hc       = h;
+                for (auto i = path.rbegin(); (i != path.rend()) && c && (c != &_root); i++) {
+                    x.insert(hc, c);
+                    c  = c->parent();
+                    hc = Index::hashOf(c, &_root);
+                }
+            }
+        }
+        return n;
+    }
+    // caller holds the tree lock and every branch lock
+    static void memoryOf(PropertyNode* n, size_t& bytes, size_t& objects)
+    {
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            bytes += sizeof(PropertyNode) + sizeof(std::pair<K, PropertyNode*>) + 4 * sizeof(void*);
+            objects++;
+            if (i->second)
+                memoryOf(i->second, bytes, objects);
+        }
+    }
+    // caller holds the tree lock exclusively
+    void buildIndex()
+    {
+        for (size_t i = 0; i < BranchLocks; i++) {
+            _index[i].clear();
+        }
+        if (_indexed) {
+            for (auto i = _root.children().begin(); i != _root.children().end(); i++) {
+                if (i->second)
+                    _index[branch(i->first)].insertTree(Index::combine(0, i->first), i->second);
+            }
+        }
+    }
+    // record a change to n in branch b - caller holds the branch or tree lock exclusively
+    void touch(PropertyNode* n, const K& b)
+    {
+        uint64_t v = ++_version;
+        n->setVersion(v, (n == &_root) ? nullptr : &_root);  // the root only changes under the tree lock
+        _dirty |= (1u << branch(b));
+    }
+    // caller holds the tree lock exclusively
+    void touchAll()
+    {
+        _root.setVersion(++_version);
+        _dirty = ~0u;
+    }
+    // mark a copied subtree as new at v
+    static void stamp(PropertyNode* n, uint64_t v)
+    {
+        n->setVersion(v, n);
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second)
+                stamp(i->second, v);
+        }
+        n->setVersion(v, n->parent());
+    }
+    static void changedSince(PropertyNode* n, uint64_t v, const std::function<void(PropertyNode*)>& f, size_t& count)
+    {
+        if (n->version() > v) {
+            f(n);
+            count++;
+        }
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second && (i->second->subtreeVersion() > v))
+                changedSince(i->second, v, f, count);
+        }
+    }
+    // make d match s - caller holds this tree exclusively and s shared
+    void diff(PropertyNode* d, PropertyNode* s, Path& p, size_t h, const ChangeFunc& f, size_t& count)
+    {
+        const K& b = p.empty() ? K() : p.front();
+        if (!(d->data() == s->data())) {
+            d->setData(s->data());
+            touch(d, b);
+            count++;
+            if (f)
+                f(ChangeKind::Modified, p, d);
+        }
+        // removed
+        std::vector<K> gone;
+        for (auto i = d->children().begin(); i != d->children().end(); i++) {
+            if (i->second && !s->child(i->first))
+                gone.push_back(i->first);
+        }
+        for (auto& k : gone) {
+            PropertyNode* c = d->child(k);
+            size_t hc       = Index::combine(h, k);
+            p.push_back(k);
+            count++;
+            if (f)
+                f(ChangeKind::Removed, p, c);
+            if (_indexed)
+                _index[branch(p.front())].eraseTree(hc, c);
+            p.pop_back();
+            d->removeChild(k);
+            touch(d, p.empty() ? k : b);
+        }
+        // added or changed
+        for (auto i = s->children().begin(); i != s->children().end(); i++) {
+            if (!i->second)
+                continue;
+            size_t hc        = Index::combine(h, i->first);
+            PropertyNode* dc = d->child(i->first);
+            p.push_back(i->first);
+            if (!dc) {
+                dc = d->createChild(i->first);
+                i->second->copyTo(dc);
+                uint64_t v = ++_version;
+                stamp(dc, v);
+                d->setVersion(v, (d == &_root) ? nullptr : &_root);
+                _dirty |= (1u << branch(p.front()));
+                if (_indexed)
+                    _index[branch(p.front())].insertTree(hc, dc);
+                count++;
+                if (f)
+                    f(ChangeKind::Added, p, dc);
+            }
+            else if ((dc->subtreeVersion() == 0) || !s->children().empty() || !dc->children().empty() ||
+                     !(dc->data() == i->second->data())) {
+                diff(dc, i->second, p, hc, f, count);
+            }
+            p.pop_back();
+        }
+    }
+    // hold every branch shared - tree lock first then branches in order, as everywhere else
+    void lockBranches(std::vector<ReadLock>& l) const
+    {
+        l.reserve(BranchLocks);
+        for (size_t i = 0; i < BranchLocks; i++) {
+            l.emplace_back(_branch[i]);
+        }
+    }
+
 public:
     /*!
         \brief PropertyTree
@@ -468,9 +1033,16 @@ public:
 
     /*!
         \brief mutex
+        Held exclusively this excludes every operation, held shared it excludes only the tree wide ones
         \return
     */
     ReadWriteMutex& mutex() { return _mutex; }
+    /*!
+        \brief branchMutex
+        \param name name of a child of the root
+        \return the lock of the branch
+    */
+    ReadWriteMutex& branchMutex(const K& name) const { return _branch[branch(name)]; }
     /*!
         \brief changed
         \return
@@ -492,23 +1064,147 @@ public:
     {
         WriteLock l(_mutex);
         _root.clear();
+        buildIndex();
+        touchAll();
         setChanged();
     }
 
     /*!
+        \brief version
+        \return the change counter - compare with node versions or pass to changedSince
+    */
+    uint64_t version() const { return _version; }
+    /*!
+        \brief dirtyBranches
+        \return bit per branch lock, set when a branch under that lock changed since clearDirty
+    */
+    uint32_t dirtyBranches() const { return _dirty; }
+    /*!
+        \brief branchDirty
+        \param name name of a child of the root
+        \return true if the branch may have changed since clearDirty
+    */
+    bool branchDirty(const K& name) const { return (_dirty & (1u << branch(name))) != 0; }
+    /*!
+        \brief clearDirty
+    */
+    void clearDirty() { _dirty = 0; }
 
+    /*!
+        \brief changedSince
+        Visit the nodes changed after version v, skipping unchanged subtrees. Removed nodes are not seen
+        \param v a previous version()
+        \param f visitor
+        \return nodes visited
     */
-    template <typename P>
-    T& get(const P& path)
+    size_t changedSince(uint64_t v, const std::function<void(PropertyNode*)>& f)
     {
         ReadLock l(_mutex);
-        auto* p = _root.find(path);
-        if (p) {
-            return p->data();
+        std::vector<ReadLock> b;
+        lockBranches(b);
+        size_t count = 0;
+        changedSince(&_root, v, f, count);  // branch changes stop below the root
+        return count;
+    }
+
+    /*!
+        \brief applyDiff
+        Make this tree match src, changing only what differs so unchanged nodes, and pointers to them, are
+        kept. Each difference is reported - an added subtree once, at its root
+        \param src e.g. a fresh browse of the same address space
+        \param f optional change report
+        \return number of changes
+    */
+    size_t applyDiff(PropertyTree& src, const ChangeFunc& f = ChangeFunc())
+    {
+        size_t count = 0;
+        if (&src != this) {
+            ReadLock ls(src._mutex);
+            std::vector<ReadLock> b;
+            src.lockBranches(b);
+            WriteLock l(_mutex);
+            Path p;
+            diff(&_root, &src._root, p, 0, f, count);
+        }
+        if (count)
+            setChanged();
+        return count;
+    }
+
+    /*!
+        \brief setIndexed
+        Enable or disable the full path index. Enabling indexes the current tree
+        \param f
+    */
+    void setIndexed(bool f = true)
+    {
+        WriteLock l(_mutex);
+        _indexed = f;
+        buildIndex();
+    }
+    /*!
+        \brief indexed
+        \return true if the full path index is enabled
+    */
+    bool indexed() const { return _indexed; }
+    /*!
+        \brief memoryUsage
+        Estimate of the nodes - each node and its entry in its parent, taking the entry as a map node. What the
+        data and names point to is not counted
+        \param bytes
+        \param objects set to the number of nodes
+    */
+    void memoryUsage(size_t& bytes, size_t& objects)
+    {
+        ReadLock l(_mutex);
+        std::vector<ReadLock> b;
+        lockBranches(b);
+        bytes   = sizeof(*this);
+        objects = 0;
+        memoryOf(&_root, bytes, objects);
+    }
+    /*!
+        \brief pathHash
+        \param path
+        \return hash for the overloads taking a precomputed hash
+    */
+    static size_t pathHash(const Path& path) { return Index::hashOf(path); }
+    /*!
+        \brief pathHash
+        \param path separated path string
+        \return hash for the overloads taking a precomputed hash
+    */
+    static size_t pathHash(const K& path) { return Index::hashOf(toPath(path)); }
+
+    /*!
+        \brief get
+        \param path
+        \param h pathHash(path)
+        \return data or the default
+    */
+    T& get(const Path& path, size_t h)
+    {
+        if (!path.empty()) {
+            ReadLock l(_mutex);
+            ReadLock b(branchMutex(path.front()));
+            auto* p = lookup(path, h);
+            if (p) {
+                return p->data();
+            }
         }
         return _defaultData;
     }
 
+    /*!
+
+    */
+    template <typename P>
+    T& get(const P& path)
+    {
+        const Path& p = toPath(path);
+        return get(p, pathHash(p));
+    }
+
     /*!
         \brief root
         \return
@@ -527,8 +1223,22 @@ public:
     template <typename P>
     PropertyNode* node(const P& path)
     {
+        const Path& p = toPath(path);
+        return node(p, pathHash(p));
+    }
+    /*!
+        \brief node
+        \param path
+        \param h pathHash(path)
+        \return node or nullptr
+    */
+    PropertyNode* node(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return nullptr;
         ReadLock l(_mutex);
-        return _root.find(path);
+        ReadLock b(branchMutex(path.front()));
+        return lookup(path, h);
     }
 
     /*!
@@ -537,14 +1247,36 @@ public:
     template <typename P>
     PropertyNode* set(const P& path, const T& d)
     {
-        auto p = _root.find(path);
-        if (!p) {
-            WriteLock l(_mutex);
-            p = _root.add(path);
+        const Path& p = toPath(path);
+        return set(p, pathHash(p), d);
+    }
+    /*!
+        \brief set
+        Set the data of a node, creating the path as required
+        \param path
+        \param h pathHash(path)
+        \param d
+        \return the node
+    */
+    PropertyNode* set(const Path& path, size_t h, const T& d)
+    {
+        if (path.empty())
+            return nullptr;
+        PropertyNode* p = nullptr;
+        {
+            ReadLock l(_mutex);
+            WriteLock b(branchMutex(path.front()));
+            if (_root.hasChild(path.front())) {  // the root is not changed while the tree lock is shared
+                p = addPath(path, h);
+                p->setData(d);
+                touch(p, path.front());
+            }
         }
-        if (p) {
-            WriteLock l(_mutex);
+        if (!p) {
+            WriteLock l(_mutex);  // a new branch
+            p = addPath(path, h);
             p->setData(d);
+            touch(p, path.front());
         }
         setChanged();
         return p;
@@ -556,8 +1288,16 @@ public:
     template <typename P>
     bool exists(const P& path)
     {
-        return _root.find(path) != nullptr;
+        const Path& p = toPath(path);
+        return exists(p, pathHash(p));
     }
+    /*!
+        \brief exists
+        \param path
+        \param h pathHash(path)
+        \return true if the node exists
+    */
+    bool exists(const Path& path, size_t h) { return node(path, h) != nullptr; }
 
     /*!
 
@@ -565,9 +1305,39 @@ public:
     template <typename P>
     void remove(const P& path)
     {
-        WriteLock l(_mutex);
+        const Path& p = toPath(path);
+        remove(p, pathHash(p));
+    }
+    /*!
+        \brief remove
+        \param path
+        \param h pathHash(path)
+    */
+    void remove(const Path& path, size_t h)
+    {
+        if (path.empty())
+            return;
+        auto f = [&]() {
+            PropertyNode* n = lookup(path, h);
+            if (n) {
+                if (_indexed)
+                    _index[branch(path.front())].eraseTree(h, n);
+                PropertyNode* parent = n->parent();
+                PropertyNode::destroy(n);  // detaches from its parent
+                if (parent)
+                    touch(parent, path.front());
+            }
+        };
+        if (path.size() == 1) {
+            WriteLock l(_mutex);  // removing a branch changes the root
+            f();
+        }
+        else {
+            ReadLock l(_mutex);
+            WriteLock b(branchMutex(path.front()));
+            f();
+        }
         setChanged();
-        _root.remove(path);
     }
 
     /*!
@@ -597,9 +1367,13 @@ public:
     */
     T& getChild(PropertyNode* node, const K& s, T& def)
     {
-        ReadLock l(_mutex);
-        if (node && node->hasChild(s)) {
-            return node->child(s)->data();
+        if (node) {
+            ReadLock l(_mutex);
+            ReadLock b(branchMutex((node == &_root) ? s : branchOf(node)));
+            PropertyNode* c = node->child(s);
+            if (c) {
+                return c->data();
+            }
         }
         return def;
     }
@@ -613,14 +1387,28 @@ public:
     void setChild(PropertyNode* node, const K& s, const T& v)
     {
         if (node) {
-            WriteLock l(_mutex);
-            if (node->hasChild(s)) {
-
-                node->child(s)->setData(v);
+            auto f = [&]() {
+                PropertyNode* c = node->child(s);
+                const K& b = (node == &_root) ? s : branchOf(node);
+                if (c) {
+                    c->setData(v);
+                }
+                else {
+                    c = node->createChild(s);
+                    c->setData(v);
+                    if (_indexed)
+                        _index[branch(b)].insert(Index::hashOf(c, &_root), c);
+                }
+                touch(c, b);
+            };
+            if (node == &_root) {
+                WriteLock l(_mutex);
+                f();
             }
             else {
-                PropertyNode* c = node->createChild(s);
-                c->setData(v);
+                ReadLock l(_mutex);
+                WriteLock b(branchMutex(branchOf(node)));
+                f();
             }
             setChanged();
         }
@@ -644,6 +1432,8 @@ public:
     void write(S& os)
     {
         ReadLock l(_mutex);
+        std::vector<ReadLock> b;
+        lockBranches(b);
         _root.write(os);
     }
 
@@ -655,6 +1445,8 @@ public:
     {
         WriteLock l(_mutex);
         _root.read(is);
+        buildIndex();
+        touchAll();
         setChanged();
     }
 
@@ -665,7 +1457,12 @@ public:
     void copyTo(PropertyTree& dest)
     {
         ReadLock l(_mutex);
+        std::vector<ReadLock> b;
+        lockBranches(b);
+        WriteLock d(dest._mutex);
         _root.copyTo(&dest._root);
+        dest.buildIndex();
+        dest.touchAll();
         dest.setChanged();
     }
 
@@ -677,11 +1474,15 @@ public:
     */
     int listChildren(const P& path, std::vector<K>& l)
     {
-        auto i = node(path);
-        if (i) {
+        const Path& p = toPath(path);
+        if (!p.empty()) {
             ReadLock lx(_mutex);
-            for (auto j = i->children().begin(); j != i->children().end(); j++) {
-                l.push_back(j->first);
+            ReadLock b(branchMutex(p.front()));
+            auto i = lookup(p, pathHash(p));
+            if (i) {
+                for (auto j = i->children().begin(); j != i->children().end(); j++) {
+                    l.push_back(j->first);
+                }
             }
         }
         return l.size();
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef PUBSUB_H
+#define PUBSUB_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/nodecontext.h>
+
+#ifdef UA_ENABLE_PUBSUB
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The PubSubFieldContext class
+    Serves a realtime DataSetField buffer as the value of its variable node. Reads return the buffer and
+    writes go into it, so a client sees and sets exactly what the publisher sends
+*/
+class UA_EXPORT PubSubFieldContext : public NodeContext
+{
+    UA_DataValue* _value = nullptr;  // owned by ServerPubSub
+
+public:
+    explicit PubSubFieldContext(UA_DataValue* v)
+        : NodeContext("PubSubField")
+        , _value(v)
+    {
+    }
+
+    bool readData(Server& server, NodeId& node, const UA_NumericRange* range, UA_DataValue& value) override;
+    bool writeData(Server& server, NodeId& node, const UA_NumericRange* range, const UA_DataValue& value) override;
+};
+
+/*!
+    \brief The ServerPubSub class
+    PubSub configuration of a server - connections, published data sets, writer groups and data set writers on
+    the publisher side, reader groups and data set readers on the subscriber side. UDP multicast UADP is
+    available with UA_ENABLE_PUBSUB and Ethernet UADP with UA_ENABLE_PUBSUB_ETH_UADP. Add the transport
+    layers before the server is started.
+    Realtime publishing: add the fields with addRealtimeField() and the writer group with fixedSize set. The
+    fields are sent from buffers owned by this object, the message layout is fixed and frozen with
+    freezeWriterGroup() so every field sits at the same offset in each message and the stack only patches the
+    values in place. setFieldValue() updates a buffer; bindField() makes the variable node read and write it.
+    addBoundField() goes further and sends a field straight from C++ memory. With a frozen fixed size writer
+    group a publish cycle encodes the bound values at their precomputed offsets and sends - no allocation and
+    no lock of this wrapper. Writes to bound memory are not synchronised with the publisher; use
+    RealtimeSettings::beforePublish to update it on the publish thread when values must not tear.
+    Call the methods with the server running or configured - the server lock is taken by each call.
+    Everything is dropped when the server terminates
+*/
+class UA_EXPORT ServerPubSub
+{
+public:
+    static constexpr const char* UdpUadpProfile = "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp";
+    static constexpr const char* EthUadpProfile = "http://opcfoundation.org/UA-Profile/Transport/pubsub-eth-uadp";
+
+    /*!
+        \brief The Binding struct
+        A realtime field published straight from C++ memory. The address is taken once when the field is added
+        and the stack encodes from it every cycle - nothing is copied into an intermediate buffer or allocated.
+        Only fixed size types can be bound. The memory must outlive the field
+    */
+    struct Binding {
+        std::string alias;
+        NodeId variable;  // node the field describes
+        void* data              = nullptr;
+        const UA_DataType* type = nullptr;
+        size_t length           = 0;  // array length - 0 for a scalar
+
+        template <typename T>
+        static Binding scalar(const std::string& alias, const NodeId& variable, T* p)
+        {
+            static_assert(ua_type_traits<T>::is_fixed_size, "only fixed size types can be bound");
+            Binding b;
+            b.alias    = alias;
+            b.variable = variable;
+            b.data     = p;
+            b.type     = ua_type_traits<T>::type();
+            return b;
+        }
+        template <typename T>
+        static Binding array(const std::string& alias, const NodeId& variable, T* p, size_t n)
+        {
+            Binding b = scalar(alias, variable, p);
+            b.length  = n;
+            return b;
+        }
+        /*!
+            \brief member
+            Bind a member of a struct instance - e.g. member("Pos", node, axis, &Axis::position)
+        */
+        template <typename S, typename T>
+        static Binding member(const std::string& alias, const NodeId& variable, S& s, T S::*m)
+        {
+            return scalar(alias, variable, &(s.*m));
+        }
+    };
+
+#ifdef UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING
+    /*!
+        \brief The RealtimeSettings struct
+        Publish threads - used when the stack is built with UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING, which
+        hands every writer group publish cycle to a thread of its own sleeping to absolute deadlines
+    */
+    struct RealtimeSettings {
+        int priority = 0;  // SCHED_FIFO priority - 0 leaves the default policy
+        int cpu      = -1;  // CPU the threads are pinned to - negative for none
+        std::function<void()> beforePublish;  // runs on the publish thread just before each send
+    };
+#endif
+
+private:
+    /*!
+        \brief The RealtimeField struct
+        Static value source of a fixed size field - boxed so the stack can hold pointers into it
+    */
+    struct RealtimeField {
+        NodeId field;
+        NodeId variable;
+        UA_DataValue value;
+        UA_DataValue* source = nullptr;  // the stack is given &source
+        std::unique_ptr<PubSubFieldContext> context;
+        RealtimeField() { UA_DataValue_init(&value); }
+        ~RealtimeField() { UA_DataValue_clear(&value); }
+    };
+    //
+    Server& _server;
+    std::vector<std::unique_ptr<RealtimeField>> _fields;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    RealtimeField* findField(const NodeId& field);
+    bool addStaticField(const NodeId& dataSet,
+                        const std::string& alias,
+                        const NodeId& variable,
+                        std::unique_ptr<RealtimeField> f,
+                        NodeId& id);
+
+public:
+    explicit ServerPubSub(Server& s)
+        : _server(s)
+    {
+    }
+    ServerPubSub(const ServerPubSub&) = delete;
+    ServerPubSub& operator=(const ServerPubSub&) = delete;
+    virtual ~ServerPubSub() = default;
+
+    /*!
+        \brief addUdpTransport
+        Add the UDP multicast transport layer to the server configuration
+        \return true on success
+    */
+    bool addUdpTransport();
+#ifdef UA_ENABLE_PUBSUB_ETH_UADP
+    /*!
+        \brief addEthernetTransport
+        Add the raw Ethernet transport layer to the server configuration
+        \return true on success
+    */
+    bool addEthernetTransport();
+#endif
+
+    /*!
+        \brief addConnection
+        \param name
+        \param profile transport profile - UdpUadpProfile or EthUadpProfile
+        \param url address - opc.udp://224.0.0.22:4840/ or opc.eth://01-00-5E-00-00-01
+        \param networkInterface interface name - may be empty
+        \param publisherId
+        \param id set to the connection id
+        \return true on success
+    */
+    bool addConnection(const std::string& name,
+                       const std::string& profile,
+                       const std::string& url,
+                       const std::string& networkInterface,
+                       UA_UInt16 publisherId,
+                       NodeId& id);
+    bool removeConnection(const NodeId& id);
+
+    /*!
+        \brief addPublishedDataSet
+        \param name
+        \param id set to the data set id
+        \return true on success
+    */
+    bool addPublishedDataSet(const std::string& name, NodeId& id);
+    bool removePublishedDataSet(const NodeId& id);
+
+    /*!
+        \brief addField
+        Field sampled from a variable node each publish
+        \param dataSet published data set
+        \param alias field name
+        \param variable node
+        \param id set to the field id
+        \return true on success
+    */
+    bool addField(const NodeId& dataSet, const std::string& alias, const NodeId& variable, NodeId& id);
+    /*!
+        \brief addRealtimeField
+        Field sent from a buffer owned by this object - needed by fixed size writer groups
+        \param dataSet published data set
+        \param alias field name
+        \param variable node the field describes
+        \param initial value - sets the encoded type and size, which must not change afterwards
+        \param id set to the field id
+        \return true on success
+    */
+    bool addRealtimeField(const NodeId& dataSet,
+                          const std::string& alias,
+                          const NodeId& variable,
+                          const Variant& initial,
+                          NodeId& id);
+    /*!
+        \brief addBoundField
+        Realtime field sent from C++ memory - see Binding
+        \param dataSet published data set
+        \param b binding
+        \param id set to the field id
+        \return true on success
+    */
+    bool addBoundField(const NodeId& dataSet, const Binding& b, NodeId& id);
+    /*!
+        \brief addBoundFields
+        Bind the members of a struct, or any set of variables, in message order
+        \param dataSet published data set
+        \param b bindings
+        \param ids set to the field ids
+        \return true if all were added
+    */
+    bool addBoundFields(const NodeId& dataSet, const std::vector<Binding>& b, std::vector<NodeId>& ids);
+    bool removeField(const NodeId& id);
+    /*!
+        \brief setFieldValue
+        Update the buffer of a realtime field - same type and size as the initial value. The publisher does not
+        take the server lock, so from another thread a publish cycle may see the value part written - use
+        RealtimeSettings::beforePublish where that matters
+        \param field
+        \param v
+        \return true on success
+    */
+    bool setFieldValue(const NodeId& field, const Variant& v);
+    /*!
+        \brief bindField
+        Make the variable node of a realtime field read and write the field buffer
+        \param field
+        \return true on success
+    */
+    bool bindField(const NodeId& field);
+
+    /*!
+        \brief addWriterGroup
+        \param connection
+        \param name
+        \param interval publishing interval in ms
+        \param writerGroupId
+        \param fixedSize realtime fixed message layout - fields must be realtime fields
+        \param id set to the writer group id
+        \return true on success
+    */
+    bool addWriterGroup(const NodeId& connection,
+                        const std::string& name,
+                        UA_Duration interval,
+                        UA_UInt16 writerGroupId,
+                        bool fixedSize,
+                        NodeId& id);
+    bool removeWriterGroup(const NodeId& id);
+    /*!
+        \brief freezeWriterGroup
+        Fix the message layout - the group and its writers cannot be changed until unfrozen
+        \param id
+        \return true on success
+    */
+    bool freezeWriterGroup(const NodeId& id);
+    bool unfreezeWriterGroup(const NodeId& id);
+    bool setWriterGroupOperational(const NodeId& id);
+    bool setWriterGroupDisabled(const NodeId& id);
+
+    /*!
+        \brief addDataSetWriter
+        \param writerGroup
+        \param dataSet published data set
+        \param name
+        \param dataSetWriterId
+        \param keyFrameCount
+        \param id set to the writer id
+        \return true on success
+    */
+    bool addDataSetWriter(const NodeId& writerGroup,
+                          const NodeId& dataSet,
+                          const std::string& name,
+                          UA_UInt16 dataSetWriterId,
+                          UA_UInt32 keyFrameCount,
+                          NodeId& id);
+    bool removeDataSetWriter(const NodeId& id);
+
+    /*!
+        \brief addReaderGroup
+        \param connection
+        \param name
+        \param id set to the reader group id
+        \return true on success
+    */
+    bool addReaderGroup(const NodeId& connection, const std::string& name, NodeId& id);
+    bool removeReaderGroup(const NodeId& id);
+    bool setReaderGroupOperational(const NodeId& id);
+    bool setReaderGroupDisabled(const NodeId& id);
+
+    /*!
+        \brief The ReaderField struct
+        One field of the data set a reader expects
+    */
+    struct ReaderField {
+        std::string name;
+        const UA_DataType* type = nullptr;
+        NodeId target;  // variable written with the received value
+    };
+
+    /*!
+        \brief addDataSetReader
+        Reader of the messages of one data set writer - received fields are written to the target variables
+        \param readerGroup
+        \param name
+        \param publisherId
+        \param writerGroupId
+        \param dataSetWriterId
+        \param fields expected fields in message order
+        \param context optional - value callbacks of the target variables are routed to it
+        \param id set to the reader id
+        \return true on success
+    */
+    bool addDataSetReader(const NodeId& readerGroup,
+                          const std::string& name,
+                          UA_UInt16 publisherId,
+                          UA_UInt16 writerGroupId,
+                          UA_UInt16 dataSetWriterId,
+                          const std::vector<ReaderField>& fields,
+                          NodeContext* context,
+                          NodeId& id);
+    bool removeDataSetReader(const NodeId& id);
+
+#ifdef UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING
+    /*!
+        \brief setRealtimeSettings
+        Applies to publish threads started afterwards - set before writer groups are made operational
+        \param s
+    */
+    static void setRealtimeSettings(const RealtimeSettings& s);
+#endif
+
+    /*!
+        \brief clear
+        Drop the realtime buffers - call once the server is gone
+    */
+    void clear() { _fields.clear(); }
+
+    Server& server() { return _server; }
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+#endif  // UA_ENABLE_PUBSUB
+
+#endif  // PUBSUB_H
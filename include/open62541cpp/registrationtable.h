@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef REGISTRATIONTABLE_H
+#define REGISTRATIONTABLE_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/timerwheel.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Open62541 {
+
+/*!
+    \brief The RegistrationTable class
+    Servers registered with an LDS, keyed by server URI. A registration expires when the server does not
+    register again within the timeout - expiry runs on a timer wheel, so re-registering is O(1) however many
+    servers there are. Capabilities and name locales are indexed for filtered FindServers queries, and the
+    encoded servers array of a FindServers response is cached per filter until the table changes.
+    The table is safe to use from any thread; drive expiry with advance()
+*/
+class UA_EXPORT RegistrationTable
+{
+public:
+    /*!
+        \brief The Registration struct
+    */
+    struct Registration {
+        std::string serverUri;
+        std::string productUri;
+        std::vector<std::pair<std::string, std::string>> names;  // locale, text
+        UA_ApplicationType serverType = UA_APPLICATIONTYPE_SERVER;
+        std::string gatewayServerUri;
+        std::vector<std::string> discoveryUrls;
+        std::vector<std::string> capabilities;
+        UA_DateTime lastSeen = 0;
+        UA_UInt64 timer      = 0;  // expiry timer
+    };
+
+    /*!
+        \brief The Filter struct
+        FindServers filter. Names are returned in the first requested locale a server has, else its first name
+    */
+    struct Filter {
+        std::vector<std::string> serverUris;    // empty for all
+        std::vector<std::string> localeIds;     // preferred name locales
+        std::vector<std::string> capabilities;  // every one must be offered
+        bool requireLocale = false;             // only servers with a name in one of localeIds
+
+        std::string key() const;
+    };
+
+    typedef std::shared_ptr<const std::vector<UA_Byte>> EncodedRef;
+
+private:
+    mutable std::mutex _mutex;
+    TimerWheel _wheel{1000};
+    std::unordered_map<std::string, Registration> _servers;
+    std::unordered_map<std::string, std::unordered_set<std::string>> _byCapability;
+    std::unordered_map<std::string, std::unordered_set<std::string>> _byLocale;
+    std::unordered_map<std::string, std::string> _byDiscoveryUrl;  // discovery URL to server URI
+    std::unordered_map<std::string, EncodedRef> _encoded;          // by filter key - cleared on change
+    unsigned _timeout    = 600;  // seconds
+    size_t _encodedLimit = 64;
+    std::atomic<unsigned> _generation{0};
+
+    void index(const Registration& r);
+    void unindex(const Registration& r);
+    void removeLocked(const std::string& serverUri);
+    void changed();
+    void describe(const Registration& r, const Filter& f, UA_ApplicationDescription& d) const;
+    void select(const Filter& f, std::vector<const Registration*>& out) const;
+
+public:
+    RegistrationTable() = default;
+    RegistrationTable(const RegistrationTable&) = delete;
+    RegistrationTable& operator=(const RegistrationTable&) = delete;
+    virtual ~RegistrationTable() { _wheel.clear(); }
+
+    /*!
+        \brief setTimeout
+        \param seconds a registration expires this long after it was last renewed - 0 never expires
+    */
+    void setTimeout(unsigned seconds) { _timeout = seconds; }
+    unsigned timeout() const { return _timeout; }
+
+    /*!
+        \brief registerServer
+        Add or renew a registration - an offline server is removed
+        \param s as given to the register server callback
+    */
+    void registerServer(const UA_RegisteredServer& s);
+    /*!
+        \brief serverOnNetwork
+        Take the capabilities of an mDNS announced server - matched by discovery URL
+        \param s
+        \param isServerAnnounce false when the server has gone
+    */
+    void serverOnNetwork(const UA_ServerOnNetwork& s, bool isServerAnnounce);
+    /*!
+        \brief setCapabilities
+        \param serverUri
+        \param capabilities
+        \return false if not registered
+    */
+    bool setCapabilities(const std::string& serverUri, const std::vector<std::string>& capabilities);
+    /*!
+        \brief remove
+        \param serverUri
+        \return false if not registered
+    */
+    bool remove(const std::string& serverUri);
+    /*!
+        \brief find
+        \param serverUri
+        \param r set to a copy
+        \return false if not registered
+    */
+    bool find(const std::string& serverUri, Registration& r) const;
+
+    /*!
+        \brief findServers
+        \param f filter
+        \param out matching servers
+    */
+    void findServers(const Filter& f, ApplicationDescriptionArray& out) const;
+    /*!
+        \brief encodedServers
+        Binary encoding of the servers array of a FindServersResponse - the part after the response header.
+        Built once per filter and shared until the table changes
+        \param f filter
+        \return encoded array - null if encoding failed
+    */
+    EncodedRef encodedServers(const Filter& f);
+
+    /*!
+        \brief advance
+        Expire registrations - call periodically, e.g. from a repeated callback of the LDS
+        \param now monotonic time
+        \return number expired
+    */
+    size_t advance(UA_DateTime now = UA_DateTime_nowMonotonic());
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _servers.size();
+    }
+    unsigned generation() const { return _generation; }
+};
+}  // namespace Open62541
+
+#endif  // REGISTRATIONTABLE_H
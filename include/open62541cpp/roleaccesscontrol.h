@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef ROLEACCESSCONTROL_H
+#define ROLEACCESSCONTROL_H
+#include <open62541cpp/open62541objects.h>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The RoleAccessControl class
+    Declarative role based access control for a Server - see Server::setRoleAccess.
+    Users are given roles, and roles are granted (or denied) permissions on a namespace, a subtree of the
+    hierarchy or a single node. compile() resolves the subtrees against the address space once and builds, per
+    role, a permission mask for every node named by a rule, indexed by a dense node handle. Sessions are bound to
+    the union of their user's roles when activated, so each access check is a session lookup, a node handle look
+    up and an array index.
+    Rules combine without precedence: a role's permissions on a node are the union of the grants that cover it
+    less the union of its denies. A user has the union of the permissions of their roles.
+    Nodes not covered by any subtree or node rule - including nodes added after compile() - get the namespace
+    rules. Call compile() again after adding nodes that should inherit subtree rules
+*/
+class UA_EXPORT RoleAccessControl
+{
+public:
+    /*!
+        \brief The Permission enum
+        Bits of the OPC UA PermissionType (Part 3 8.55)
+    */
+    enum Permission : UA_UInt32 {
+        Browse               = 0x00001,
+        ReadRolePermissions  = 0x00002,
+        WriteAttribute       = 0x00004,
+        WriteRolePermissions = 0x00008,
+        WriteHistorizing     = 0x00010,
+        Read                 = 0x00020,
+        Write                = 0x00040,
+        ReadHistory          = 0x00080,
+        InsertHistory        = 0x00100,
+        ModifyHistory        = 0x00200,
+        DeleteHistory        = 0x00400,
+        ReceiveEvents        = 0x00800,
+        Call                 = 0x01000,
+        AddReference         = 0x02000,
+        RemoveReference      = 0x04000,
+        DeleteNode           = 0x08000,
+        AddNode              = 0x10000,
+        //
+        None     = 0,
+        ReadOnly = Browse | Read | ReadHistory | ReceiveEvents,
+        Operate  = ReadOnly | Write | Call,
+        All      = 0x1FFFF
+    };
+
+    enum { MaxRoles = 64 };  // role sets are bit sets
+
+    /*!
+        \brief The Scope enum
+    */
+    enum Scope {
+        NamespaceScope = 0,  //!< every node in a namespace
+        SubtreeScope,        //!< a node and everything below it through hierarchical references
+        NodeScope            //!< a single node
+    };
+
+    /*!
+        \brief The Rule struct
+    */
+    struct Rule {
+        size_t role = 0;
+        Scope scope = NodeScope;
+        NodeId node;                // subtree root or node
+        UA_UInt16 nameSpace   = 0;  // NamespaceScope
+        UA_UInt32 permissions = 0;
+        bool deny             = false;
+    };
+
+private:
+    typedef uint64_t RoleSet;
+    //
+    // compiled rules - immutable once published, replaced by compile()
+    struct Compiled {
+        UnorderedNodeIdMap<UA_UInt32> handles;           // node to index in the role masks
+        std::vector<std::vector<UA_UInt32>> roleMasks;   // per role, per handle
+        std::vector<std::vector<UA_UInt32>> nameSpaces;  // per role, per namespace index
+    };
+    typedef std::shared_ptr<const Compiled> CompiledRef;
+    //
+    // permissions of one set of roles - shared by every session with that set
+    struct Profile {
+        CompiledRef compiled;
+        std::vector<UA_UInt32> masks;       // per handle
+        std::vector<UA_UInt32> nameSpaces;  // per namespace index
+        UA_UInt32 permissions(const UA_NodeId& n) const;
+    };
+    typedef std::shared_ptr<const Profile> ProfileRef;
+    //
+    struct User {
+        std::string password;
+        RoleSet roles = 0;
+    };
+    //
+    mutable ReadWriteMutex _mutex;
+    std::vector<std::string> _roles;
+    std::vector<Rule> _rules;
+    std::map<std::string, User> _users;
+    RoleSet _anonymous = 0;  // roles of anonymous sessions - none denies anonymous access
+    CompiledRef _compiled;
+    std::unordered_map<RoleSet, ProfileRef> _profiles;
+    UnorderedNodeIdMap<ProfileRef> _sessions;
+    std::unique_ptr<Compiled> compileRules(Server* server, const std::vector<Rule>& rules, size_t roles) const;
+    ProfileRef profile(RoleSet roles);  // call with _mutex held exclusively
+    bool roleSet(const std::vector<std::string>& names, RoleSet& s) const;
+    void addRule(size_t role, Scope scope, const UA_NodeId& node, UA_UInt16 ns, UA_UInt32 permissions, bool deny);
+
+public:
+    RoleAccessControl() {}
+    RoleAccessControl(const RoleAccessControl&) = delete;
+    RoleAccessControl& operator=(const RoleAccessControl&) = delete;
+    virtual ~RoleAccessControl() {}
+
+    /*!
+        \brief addRole
+        \param name
+        \return index of the role - existing roles are returned as is - or MaxRoles if there are too many
+    */
+    size_t addRole(const std::string& name);
+    /*!
+        \brief role
+        \param name
+        \return index of the role or MaxRoles if not known
+    */
+    size_t role(const std::string& name) const;
+    /*!
+        \brief addUser
+        \param name
+        \param password
+        \param roles names of the user's roles - added if not known
+        \return false if there are too many roles
+    */
+    bool addUser(const std::string& name, const std::string& password, const std::vector<std::string>& roles);
+    void removeUser(const std::string& name);
+    /*!
+        \brief setAnonymousRoles
+        \param roles roles of anonymous sessions - empty to refuse anonymous sessions
+        \return false if there are too many roles
+    */
+    bool setAnonymousRoles(const std::vector<std::string>& roles);
+
+    /*!
+        \brief grantNamespace
+        \param role index
+        \param ns namespace index
+        \param permissions Permission bits
+    */
+    void grantNamespace(size_t role, UA_UInt16 ns, UA_UInt32 permissions)
+    {
+        addRule(role, NamespaceScope, UA_NODEID_NULL, ns, permissions, false);
+    }
+    void grantSubtree(size_t role, const UA_NodeId& root, UA_UInt32 permissions)
+    {
+        addRule(role, SubtreeScope, root, 0, permissions, false);
+    }
+    void grantNode(size_t role, const UA_NodeId& node, UA_UInt32 permissions)
+    {
+        addRule(role, NodeScope, node, 0, permissions, false);
+    }
+    void denyNamespace(size_t role, UA_UInt16 ns, UA_UInt32 permissions)
+    {
+        addRule(role, NamespaceScope, UA_NODEID_NULL, ns, permissions, true);
+    }
+    void denySubtree(size_t role, const UA_NodeId& root, UA_UInt32 permissions)
+    {
+        addRule(role, SubtreeScope, root, 0, permissions, true);
+    }
+    void denyNode(size_t role, const UA_NodeId& node, UA_UInt32 permissions)
+    {
+        addRule(role, NodeScope, node, 0, permissions, true);
+    }
+    /*!
+        \brief clearRules
+        Remove every rule - takes effect at the next compile()
+    */
+    void clearRules();
+
+    /*!
+        \brief compile
+        Resolve the rules against the address space and rebuild the permission tables of every bound session.
+        Subtrees are browsed without holding this object's lock, so checks carry on against the previous
+        tables meanwhile
+        \param server used to browse subtrees - if null subtree rules only cover their root
+        \return true on success
+    */
+    bool compile(Server* server);
+
+    /*!
+        \brief authenticate
+        \param user
+        \param password
+        \return true if the user is known and the password matches
+    */
+    bool authenticate(const std::string& user, const std::string& password) const;
+    /*!
+        \brief bindSession
+        Give a session its user's roles
+        \param session
+        \param user
+        \return false if the user is not known
+    */
+    bool bindSession(const UA_NodeId& session, const std::string& user);
+    /*!
+        \brief bindAnonymous
+        \param session
+        \return false if anonymous sessions are refused
+    */
+    bool bindAnonymous(const UA_NodeId& session);
+    void unbindSession(const UA_NodeId& session);
+    /*!
+        \brief activateSession
+        Authenticate a session from its identity token and bind it - anonymous and user name tokens are accepted
+        \param session
+        \param token
+        \return UA_STATUSCODE_GOOD or the reason the session is refused
+    */
+    virtual UA_StatusCode activateSession(const UA_NodeId& session, const UA_ExtensionObject* token);
+
+    /*!
+        \brief permissions
+        \param session
+        \param node
+        \return Permission bits of the session on the node - None for unbound sessions
+    */
+    UA_UInt32 permissions(const UA_NodeId& session, const UA_NodeId& node) const;
+    /*!
+        \brief userPermissions
+        For audits - the permissions a user would have on a node
+        \param user
+        \param node
+        \return Permission bits
+    */
+    UA_UInt32 userPermissions(const std::string& user, const UA_NodeId& node);
+    /*!
+        \brief accessLevel
+        \param session
+        \param node
+        \return UA_ACCESSLEVELMASK bits granted to the session
+    */
+    UA_Byte accessLevel(const UA_NodeId& session, const UA_NodeId& node) const;
+    /*!
+        \brief rightsMask
+        \param session
+        \param node
+        \return write mask - all attributes with WriteAttribute, none otherwise
+    */
+    UA_UInt32 rightsMask(const UA_NodeId& session, const UA_NodeId& node) const
+    {
+        return (permissions(session, node) & WriteAttribute) ? 0xFFFFFFFF : 0;
+    }
+    bool allowed(const UA_NodeId& session, const UA_NodeId& node, UA_UInt32 p) const
+    {
+        return (permissions(session, node) & p) == p;
+    }
+
+    /*!
+        \brief print
+        List roles, users and rules - for audit
+        \param os
+    */
+    void print(std::ostream& os) const;
+};
+
+}  // namespace Open62541
+
+#endif  // ROLEACCESSCONTROL_H
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERAGGREGATOR_H
+#define SERVERAGGREGATOR_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/nodecontext.h>
+#include <open62541cpp/clientpool.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The ServerAggregator class
+    Mounts the address spaces of downstream servers into one Server. Each mount is a folder whose contents are
+    mirrored from a node on the downstream server once a client first browses it (see Server::addLazyNode), so
+    nothing is loaded until it is used - the first browse queues the mirror and later browses see it. Objects become folders browsed through in turn; variables become
+    data source variables whose reads and writes are routed to the downstream server over a session from the
+    ClientPool. A browse of a downstream server that is not connected mirrors nothing and is retried by the next
+    browse. Enable the NodeContext read cache (cacheReads) on busy mirrored variables to bound upstream reads.
+    Mirrored node ids are strings in the aggregator's namespace - "<mount>|<downstream node id>".
+    Subscriptions are shared: while any server side monitored item samples a mirrored variable, one downstream
+    monitored item feeds it and reads are served from the last value received. It is removed when the last
+    server side item goes. open62541 does not tell the register hook the sampling interval asked for, so each
+    feed samples at the aggregator's interval.
+    Create after the server and pool; destroy after the server
+*/
+class UA_EXPORT ServerAggregator : public NodeContext
+{
+    struct Mount {
+        std::string endpoint;
+        std::string name;
+    };
+    struct Mirror {
+        size_t mount = 0;
+        NodeId remote;
+    };
+    struct Feed {
+        std::mutex mutex;  // all members but remote and mount
+        DataValue value;
+        bool valid   = false;  // value is live
+        bool pending = false;  // an attach is posted
+        bool closed  = false;  // last user gone
+        NodeId remote;
+        size_t mount = 0;
+        ClientRef client;  // session holding the downstream item
+        UA_UInt32 subscription = 0;
+        unsigned item          = 0;
+    };
+    typedef std::shared_ptr<Feed> FeedRef;
+    class FeedItem;
+
+    Server& _server;
+    ClientPool& _pool;
+    UA_UInt16 _nameSpace = 1;
+    std::mutex _mutex;
+    std::vector<Mount> _mounts;
+    UnorderedNodeIdMap<Mirror> _mirrors;  // local node to downstream node
+    UnorderedNodeIdMap<std::pair<FeedRef, size_t>> _feeds;  // shared downstream items and their users
+    std::mutex _subscriptionMutex;
+    std::map<Client*, UA_UInt32> _subscriptions;  // the aggregator's subscription on each session
+    double _samplingInterval = 1000.0;
+    std::atomic<size_t> _shared{0};
+    std::atomic<size_t> _expanded{0};
+    std::atomic<size_t> _reads{0};
+    std::atomic<size_t> _writes{0};
+    std::atomic<size_t> _failures{0};
+
+    bool expand(Server& server, const NodeId& local);
+    void defer(const NodeId& local);
+    NodeId localId(const std::string& mount, const UA_NodeId& remote) const;
+    void start(const FeedRef& f);
+    void attach(Client& c, const FeedRef& f);
+
+public:
+    /*!
+        \brief ServerAggregator
+        \param s server to mount into
+        \param pool sessions to the downstream servers - endpoints are added by mount()
+        \param nameSpace namespace of the mirrored nodes
+    */
+    ServerAggregator(Server& s, ClientPool& pool, UA_UInt16 nameSpace);
+    ServerAggregator(const ServerAggregator&) = delete;
+    ServerAggregator& operator=(const ServerAggregator&) = delete;
+    /*!
+        \brief ~ServerAggregator
+        Unhooks from the server so monitored item registrations no longer reach it
+    */
+    virtual ~ServerAggregator();
+
+    /*!
+        \brief mount
+        \param endpoint downstream server url - added to the pool if not already there
+        \param name browse name of the mount folder - unique per aggregator
+        \param parent node the mount folder is added under
+        \param remoteRoot downstream node mirrored by the folder
+        \return false if the folder could not be added
+    */
+    bool mount(const std::string& endpoint,
+               const std::string& name,
+               const NodeId& parent     = NodeId::Objects,
+               const NodeId& remoteRoot = NodeId::Objects);
+
+    /*!
+        \brief resolve
+        Route other services - e.g. method calls - the way reads are routed
+        \param local mirrored node
+        \param client set to a connected session to its server - null if none is up
+        \param remote set to the downstream node id
+        \return false if the node is not mirrored
+    */
+    bool resolve(const UA_NodeId& local, ClientRef& client, NodeId& remote);
+
+    /*!
+        \brief setSamplingInterval
+        \param ms sampling interval of downstream items added from now on
+    */
+    void setSamplingInterval(double ms) { _samplingInterval = ms; }
+    double samplingInterval() const { return _samplingInterval; }
+
+    /*!
+        \brief monitored
+        Called by the server as monitored items on a node's value are created and deleted
+        \param node
+        \param removed
+    */
+    void monitored(const UA_NodeId& node, bool removed);
+
+    /*!
+        \brief readData
+        Serve the shared subscription's value or read the downstream value
+    */
+    bool readData(Server& server, NodeId& node, const UA_NumericRange* range, UA_DataValue& value) override;
+    /*!
+        \brief writeData
+        Write the downstream value - index ranges are not passed on
+    */
+    bool writeData(Server& server, NodeId& node, const UA_NumericRange* range, const UA_DataValue& value) override;
+
+    size_t mounts()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _mounts.size();
+    }
+    size_t mirrored()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _mirrors.size();
+    }
+    size_t feeds()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _feeds.size();
+    }
+    size_t expanded() const { return _expanded; }  // downstream browses made
+    size_t shared() const { return _shared; }      // reads served from a shared subscription
+    size_t reads() const { return _reads; }
+    size_t writes() const { return _writes; }
+    size_t failures() const { return _failures; }  // operations with no connected session or a failed call
+};
+
+}  // namespace Open62541
+
+#endif  // SERVERAGGREGATOR_H
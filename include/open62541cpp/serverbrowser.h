@@ -12,6 +12,7 @@
 #ifndef SERVERBROWSER_H
 #define SERVERBROWSER_H
 #include <open62541cpp/open62541objects.h>
+#include <open62541cpp/metrics.h>
 namespace Open62541 {
 // browsing object
 /*!
@@ -36,11 +37,45 @@ public:
     */
     void browse(UA_NodeId start)
     {
+        Metrics::Scope timing(Metrics::Browse);
         list().clear();
-        {
+        clearResults();
+        if (viewMode()) {
+            browseViews(start);
+        }
+        else {
             UA_Server_forEachChildNodeCall(obj().server(), start, browseIter, (void*)this);
         }
     }
+
+private:
+    /*!
+        \brief browseViews
+        One browse returning the browse names with the references - no per child reads and no copies
+        \param start
+    */
+    void browseViews(const UA_NodeId& start)
+    {
+        UA_BrowseDescription bd;
+        UA_BrowseDescription_init(&bd);
+        bd.nodeId          = start;  // shallow
+        bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+        bd.includeSubtypes = true;
+        bd.resultMask      = UA_BROWSERESULTMASK_ALL;
+        UA_BrowseResult r  = UA_Server_browse(obj().server(), 0, &bd);
+        while (r.statusCode == UA_STATUSCODE_GOOD) {
+            for (size_t i = 0; i < r.referencesSize; i++)
+                _views.emplace_back(r.references[i]);
+            UA_ByteString cp    = r.continuationPoint;
+            r.continuationPoint = UA_BYTESTRING_NULL;
+            adopt(r);
+            if (cp.length == 0)
+                break;
+            r = UA_Server_browseNext(obj().server(), UA_FALSE, &cp);
+            UA_ByteString_clear(&cp);
+        }
+        UA_BrowseResult_clear(&r);
+    }
 };
 
 }  // namespace Open62541
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERCALLBACKGROUP_H
+#define SERVERCALLBACKGROUP_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The ServerCallbackGroup class
+    Runs many callbacks of the same interval from one repeated server callback. The interval is split into
+    phases and each member is placed in the least loaded phase, so a thousand 1000 ms callbacks become one
+    callback every 1000 / phases ms running a thousand / phases members rather than a thousand at one instant.
+    Members run in the order they joined their phase, with the group locked - they may add and remove
+    members. remove() waits for a running phase to finish.
+    A thread safe group posts each phase to the server worker pool (see Server::setWorkerThreads) and runs it
+    inline when the pool is not running. Phases still run one at a time; a phase is skipped, and counted as
+    an overrun, when a whole interval of phases is already queued.
+    Destroy the group before its server
+*/
+class UA_EXPORT ServerCallbackGroup
+{
+public:
+    typedef std::function<void()> Func;
+
+private:
+    struct Member {
+        UA_UInt64 id = 0;
+        Func func;
+    };
+    struct Where {
+        size_t phase = 0;
+        size_t index = 0;
+    };
+    //
+    Server& _server;
+    unsigned _interval = 1000;  // ms
+    std::vector<std::vector<std::unique_ptr<Member>>> _phases;  // boxed - a running member must not move
+    std::unordered_map<UA_UInt64, Where> _where;
+    std::vector<size_t> _dead;  // phases with members removed while running
+    mutable std::recursive_mutex _mutex;
+    UA_UInt64 _nextId = 1;
+    UA_UInt64 _id     = 0;  // driving callback
+    size_t _next      = 0;  // phase run by the next tick
+    bool _running     = false;
+    bool _threadSafe  = false;
+    //
+    std::mutex _jobMutex;
+    std::condition_variable _jobCond;
+    size_t _queued = 0;  // phases posted to the pool and not finished
+    std::atomic<size_t> _overruns{0};
+    std::atomic<size_t> _ticks{0};
+
+    static void callbackFunction(UA_Server* server, void* data);
+    void tick();
+    void runPhase(size_t phase);
+    void purge();
+
+protected:
+    UA_StatusCode _lastError = 0;
+
+public:
+    /*!
+        \brief ServerCallbackGroup
+        \param s server
+        \param interval of every member in ms
+        \param phases number of slots the interval is split into - clamped so a slot is at least 1 ms
+    */
+    ServerCallbackGroup(Server& s, unsigned interval, size_t phases = 10);
+    ServerCallbackGroup(const ServerCallbackGroup&) = delete;
+    ServerCallbackGroup& operator=(const ServerCallbackGroup&) = delete;
+    /*!
+        \brief ~ServerCallbackGroup
+        Stops the group and waits for queued phases
+    */
+    virtual ~ServerCallbackGroup();
+
+    /*!
+        \brief start
+        \return true if the driving callback was added
+    */
+    bool start();
+    /*!
+        \brief stop
+        \return true if it was running
+    */
+    bool stop();
+
+    /*!
+        \brief add
+        \param func member callback
+        \return member id
+    */
+    UA_UInt64 add(Func func);
+    /*!
+        \brief remove
+        \param id member
+        \return false if not known
+    */
+    bool remove(UA_UInt64 id);
+
+    /*!
+        \brief setThreadSafe
+        \param f true if the members may run on the worker pool - they must then lock what they touch
+    */
+    void setThreadSafe(bool f) { _threadSafe = f; }
+    bool threadSafe() const { return _threadSafe; }
+
+    unsigned interval() const { return _interval; }
+    size_t phases() const { return _phases.size(); }
+    size_t size() const
+    {
+        std::lock_guard<std::recursive_mutex> l(_mutex);
+        return _where.size();
+    }
+    size_t ticks() const { return _ticks; }
+    size_t overruns() const { return _overruns; }
+    UA_UInt64 id() const { return _id; }
+    Server& server() { return _server; }
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+/*!
+    \brief ServerCallbackGroupRef
+*/
+typedef std::shared_ptr<ServerCallbackGroup> ServerCallbackGroupRef;
+}  // namespace Open62541
+
+#endif  // SERVERCALLBACKGROUP_H
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERFILETYPE_H
+#define SERVERFILETYPE_H
+#include <open62541cpp/serverobjecttype.h>
+#include <open62541cpp/servermethod.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The ServerFileType class
+    Serves files on disk as instances of the standard FileType (Part 5 C.2), so any client that knows FileType
+    - see ClientFile - can download and upload them. The methods of FileType are shared by all its instances,
+    so one ServerFileType per server binds them once and routes each call by object to its file.
+    Files opened for reading only are memory mapped and each Read is one copy from the mapping into the
+    response; writes go straight to the file at the handle's position. Reads return up to setMaxChunk bytes
+    per call - the server's and client's message size limits must allow that much. By default Read and Write
+    are async, so a large transfer runs on the server worker pool (Bulk lane) and does not hold up other
+    sessions - see ServerMethod::setAsync.
+    Needs open62541 built with the full namespace zero (UA_NAMESPACE_ZERO=FULL), which holds FileType.
+    A handle belongs to the session that opened it - other sessions get BadInvalidArgument from Close,
+    GetPosition and SetPosition, and from Read and Write unless they are async (the stack makes async calls
+    as its own session). The handles of a session are closed when the session closes
+*/
+class UA_EXPORT ServerFileType : public ServerObjectType
+{
+public:
+    enum Mode { Read = 1, Write = 2, EraseExisting = 4, Append = 8 };  // Open's mode bits
+
+private:
+    struct File {
+        std::string path;
+        bool writable = false;
+        NodeId size;       // the instance's Size variable
+        NodeId openCount;  // the instance's OpenCount variable
+        size_t opens = 0;
+        bool writing = false;  // open with Write - exclusive
+    };
+    struct Handle {
+        std::mutex mutex;  // position and fd - calls on one handle may run on several workers
+        NodeId object;
+        NodeId session;  // the opener's
+        UA_Byte mode        = 0;
+        int fd              = -1;
+        const UA_Byte* map  = nullptr;  // read only handles
+        size_t mapped       = 0;
+        UA_UInt64 position  = 0;
+        ~Handle();
+    };
+    typedef std::shared_ptr<Handle> HandleRef;
+
+    std::mutex _mutex;
+    UnorderedNodeIdMap<File> _files;
+    std::map<UA_UInt32, HandleRef> _handles;
+    UA_UInt32 _nextHandle = 1;
+    size_t _maxHandles    = 256;
+    size_t _maxChunk      = 16 * 1024 * 1024;
+    bool _async           = true;
+    bool _bound           = false;
+    std::vector<std::unique_ptr<ServerMethod>> _methods;  // Open Close Read Write GetPosition SetPosition
+    std::atomic<uint64_t> _bytesRead{0};
+    std::atomic<uint64_t> _bytesWritten{0};
+
+    HandleRef handle(UA_UInt32 id, const UA_NodeId* session);
+    void opened(const NodeId& object, UA_UInt64 size);
+    void sessionClosed(const NodeId& session);
+    UA_StatusCode open(const UA_NodeId* session,
+                       const UA_NodeId* object,
+                       size_t n,
+                       const UA_Variant* in,
+                       UA_Variant* out);
+    UA_StatusCode close(const UA_NodeId* session, const UA_NodeId* object, size_t n, const UA_Variant* in);
+    UA_StatusCode read(const UA_NodeId* session, size_t n, const UA_Variant* in, UA_Variant* out);
+    UA_StatusCode write(const UA_NodeId* session, size_t n, const UA_Variant* in);
+    UA_StatusCode getPosition(const UA_NodeId* session, size_t n, const UA_Variant* in, UA_Variant* out);
+    UA_StatusCode setPosition(const UA_NodeId* session, size_t n, const UA_Variant* in);
+
+public:
+    /*!
+        \brief ServerFileType
+        \param s server holding the full namespace zero
+        \param async run Read and Write on the server worker pool
+    */
+    ServerFileType(Server& s, bool async = true);
+    /*!
+        \brief ~ServerFileType
+        Closes every handle and unbinds the methods - destroy before the server
+    */
+    virtual ~ServerFileType();
+    ServerFileType(const ServerFileType&) = delete;
+    ServerFileType& operator=(const ServerFileType&) = delete;
+
+    /*!
+        \brief bind
+        Set the FileType method callbacks - called by the first addFile
+        \return false if the server has no FileType
+    */
+    bool bind();
+
+    /*!
+        \brief addFile
+        \param name browse and display name
+        \param parent node the FileType object is added under
+        \param path file served - created on the first write if it does not exist
+        \param writable clients may open it for writing
+        \param nodeId set to the new object
+        \param requestNodeId
+        \return true on success
+    */
+    bool addFile(const std::string& name,
+                 const NodeId& parent,
+                 const std::string& path,
+                 bool writable               = false,
+                 NodeId& nodeId              = NodeId::Null,
+                 const NodeId& requestNodeId = NodeId::Null);
+    /*!
+        \brief removeFile
+        Close the file's handles and delete its object
+        \param object
+        \return false if the object is not a file of this type
+    */
+    bool removeFile(const NodeId& object);
+
+    /*!
+        \brief setMaxChunk
+        \param bytes most bytes a Read returns whatever length is asked for
+    */
+    void setMaxChunk(size_t bytes) { _maxChunk = bytes ? bytes : 1; }
+    size_t maxChunk() const { return _maxChunk; }
+    /*!
+        \brief setMaxHandles
+        \param n handles open at once across all files and sessions
+    */
+    void setMaxHandles(size_t n) { _maxHandles = n; }
+
+    size_t files()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _files.size();
+    }
+    size_t handles()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _handles.size();
+    }
+    uint64_t bytesRead() const { return _bytesRead; }
+    uint64_t bytesWritten() const { return _bytesWritten; }
+};
+
+}  // namespace Open62541
+
+#endif  // SERVERFILETYPE_H
@@ -13,6 +13,8 @@
 #define SERVERMETHOD_H
 #include <open62541cpp/open62541objects.h>
 #include <open62541cpp/nodecontext.h>
+#include <open62541cpp/methodbinding.h>
+#include <open62541cpp/workerpool.h>
 
 namespace Open62541 {
 
@@ -38,6 +40,15 @@ class UA_EXPORT ServerMethod : public NodeContext
 public:
     typedef std::function<UA_StatusCode(Server&, const UA_NodeId*, size_t, const UA_Variant*, size_t, UA_Variant*)>
         MethodFunc;
+    // as MethodFunc with the calling session before the object - the server's own session when the call is async
+    typedef std::function<UA_StatusCode(Server&,
+                                        const UA_NodeId*,
+                                        const UA_NodeId*,
+                                        size_t,
+                                        const UA_Variant*,
+                                        size_t,
+                                        UA_Variant*)>
+        SessionMethodFunc;
     static UA_StatusCode methodCallback(UA_Server* server,
                                         const UA_NodeId* sessionId,
                                         void* sessionContext,
@@ -52,7 +63,10 @@ public:
 
 protected:
     UA_StatusCode _lastError;
-    MethodFunc _func;  // lambda
+    MethodFunc _func;                // lambda
+    SessionMethodFunc _sessionFunc;  // lambda told the session - takes precedence over _func
+    bool _async = false;             // run off the network thread
+    WorkerPool::Lane _lane = WorkerPool::Control;  // worker pool priority of async calls
 public:
     /*!
         \brief ServerMethod
@@ -80,6 +94,54 @@ public:
      */
     void setFunction(MethodFunc f) { _func = f; }
 
+    /*!
+     * \brief setSessionFunction
+     * \param f called with the session id - async calls are made by the stack as its own session
+     */
+    void setSessionFunction(SessionMethodFunc f) { _sessionFunc = f; }
+
+    /*!
+        \brief bind
+        Set a typed function - for example bind<double(int, std::string)>(f). Inputs are decoded from the
+        request straight into the parameters and the result, or each member of a std::tuple result, is encoded
+        into the output slots. The argument lists are sized and typed from the signature unless in() and out()
+        already declare them. Call before the method is added. Inputs of the wrong type or number fail the
+        call without calling f
+        \param f callable with the signature Sig
+    */
+    template <typename Sig, typename F>
+    void bind(F f)
+    {
+        MethodBinding<Sig>::declare(_in, _out);
+        _func = [f](Server&, const UA_NodeId*, size_t inputSize, const UA_Variant* input, size_t outputSize,
+                    UA_Variant* output) mutable {
+            return MethodBinding<Sig>::call(f, inputSize, input, outputSize, output);
+        };
+    }
+
+    /*!
+        \brief setAsync
+        Set before the method is added. An async method is queued by the stack and run on the server worker
+        pool (see Server::setWorkerThreads) so a slow call does not hold up other sessions. The function then
+        runs off the network thread and must lock what it touches. Needs open62541 built with
+        UA_MULTITHREADING >= 100
+        \param f true for async
+    */
+    void setAsync(bool f) { _async = f; }
+    /*!
+        \brief async
+        \return true if calls are queued to the worker pool
+    */
+    bool async() const { return _async; }
+    /*!
+        \brief setLane
+        Priority of async calls on the worker pool - Control by default, set Bulk for long running exports so an
+        operator command is not queued behind them. Set before the method is added
+        \param l
+    */
+    void setLane(WorkerPool::Lane l) { _lane = l; }
+    WorkerPool::Lane lane() const { return _lane; }
+
     /*!
         \brief in
         \return
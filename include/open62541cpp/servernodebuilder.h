@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERNODEBUILDER_H
+#define SERVERNODEBUILDER_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/open62541server.h>
+
+namespace Open62541 {
+
+/*!
+    \brief The ServerNodeBuilder class
+    Stages folders, objects and variables and adds them to the server in one pass under a single write lock.
+    Items refer to their parent either by a node id already in the server or by the reference returned when
+    the parent was staged, so parents inside the batch are resolved without browsing.
+    Use instead of ServerNodeTree::addFolderNode / addValueNode or repeated Server::addVariable calls when
+    building large models
+*/
+class UA_EXPORT ServerNodeBuilder
+{
+public:
+    typedef size_t Ref;                             //!< index of a staged item
+    static constexpr Ref External = Ref(~size_t(0));  //!< parent is an existing node
+
+    enum Kind { FolderNode, ObjectNode, VariableNode };
+
+    /*!
+        \brief The Item struct
+        A staged node
+    */
+    struct Item {
+        Kind kind         = FolderNode;
+        Ref parent        = External;
+        NodeId parentId;                               // used when parent is External
+        NodeId requestedId;                            // numeric 0 lets the server assign the id
+        NodeId typeId;                                 // object type - objects only
+        std::string name;                              // browse and display name
+        Variant value;                                 // variables only
+        NodeContext* context = nullptr;
+        UA_StatusCode status = UA_STATUSCODE_GOOD;
+        NodeId result;                                 // node id assigned by the server after build()
+        UANode* treeNode     = nullptr;                // set from addTree - gets the result on build
+    };
+
+private:
+    Server& _server;
+    int _nameSpace = 2;
+    std::vector<Item> _items;
+    std::unordered_map<std::string, Ref> _paths;  // folder path to staged folder - used by addPath
+    size_t _built  = 0;                            // items already added to the server
+    size_t _failed = 0;
+
+    Ref stage(Kind k, Ref parent, const NodeId& parentId, const std::string& name, const NodeId& nodeId);
+    UA_StatusCode addItem(Item& i);
+
+public:
+    /*!
+        \brief ServerNodeBuilder
+        \param s server
+        \param ns namespace new nodes are created in
+    */
+    ServerNodeBuilder(Server& s, int ns = 2)
+        : _server(s)
+        , _nameSpace(ns)
+    {
+    }
+
+    /*!
+        \brief reserve
+        Pre size the staging area
+        \param n expected number of items
+    */
+    void reserve(size_t n) { _items.reserve(n); }
+
+    /*!
+        \brief addFolder
+        \param parent existing node
+        \param name
+        \param nodeId requested node id - null for a server assigned id
+        \return reference to the staged folder
+    */
+    Ref addFolder(const NodeId& parent, const std::string& name, const NodeId& nodeId = NodeId::Null)
+    {
+        return stage(FolderNode, External, parent, name, nodeId);
+    }
+    /*!
+        \brief addFolder
+        \param parent staged parent
+        \param name
+        \param nodeId requested node id - null for a server assigned id
+        \return reference to the staged folder
+    */
+    Ref addFolder(Ref parent, const std::string& name, const NodeId& nodeId = NodeId::Null)
+    {
+        return stage(FolderNode, parent, NodeId::Null, name, nodeId);
+    }
+
+    /*!
+        \brief addObject
+        \param parent existing node
+        \param name
+        \param typeId object type
+        \param nodeId requested node id
+        \param c optional node context
+        \return reference to the staged object
+    */
+    Ref addObject(const NodeId& parent,
+                  const std::string& name,
+                  const NodeId& typeId,
+                  const NodeId& nodeId = NodeId::Null,
+                  NodeContext* c       = nullptr);
+    /*!
+        \brief addObject
+        \param parent staged parent
+        \param name
+        \param typeId object type
+        \param nodeId requested node id
+        \param c optional node context
+        \return reference to the staged object
+    */
+    Ref addObject(Ref parent,
+                  const std::string& name,
+                  const NodeId& typeId,
+                  const NodeId& nodeId = NodeId::Null,
+                  NodeContext* c       = nullptr);
+
+    /*!
+        \brief addVariable
+        \param parent existing node
+        \param name
+        \param value initial value - sets the data type
+        \param nodeId requested node id
+        \param c optional node context
+        \return reference to the staged variable
+    */
+    Ref addVariable(const NodeId& parent,
+                    const std::string& name,
+                    const Variant& value,
+                    const NodeId& nodeId = NodeId::Null,
+                    NodeContext* c       = nullptr);
+    /*!
+        \brief addVariable
+        \param parent staged parent
+        \param name
+        \param value initial value - sets the data type
+        \param nodeId requested node id
+        \param c optional node context
+        \return reference to the staged variable
+    */
+    Ref addVariable(Ref parent,
+                    const std::string& name,
+                    const Variant& value,
+                    const NodeId& nodeId = NodeId::Null,
+                    NodeContext* c       = nullptr);
+
+    /*!
+        \brief addPath
+        Stage a variable at the end of a path of folders below root. Folders are staged once and shared
+        between paths with a common prefix
+        \param root existing node the path starts from
+        \param path folders then the variable name
+        \param value
+        \param c optional node context
+        \return reference to the staged variable - External if the path is empty
+    */
+    Ref addPath(const NodeId& root, const UAPath& path, const Variant& value, NodeContext* c = nullptr);
+
+    /*!
+        \brief addTree
+        Stage the children of a UANodeTree node as folders below an existing node. A child's data is used as
+        the requested node id and is set to the assigned node id by build()
+        \param parent existing node
+        \param n tree node whose children are staged - must outlive build()
+        \return number of items staged
+    */
+    size_t addTree(const NodeId& parent, UANode* n);
+
+    /*!
+        \brief build
+        Add all staged items not yet built - one write lock for the whole batch
+        \return true if every item was added
+    */
+    bool build();
+
+    /*!
+        \brief clear
+        Discard staged items and results
+    */
+    void clear()
+    {
+        _items.clear();
+        _paths.clear();
+        _built  = 0;
+        _failed = 0;
+    }
+
+    size_t size() const { return _items.size(); }
+    size_t failed() const { return _failed; }
+    const Item& item(Ref r) const { return _items.at(r); }
+    /*!
+        \brief nodeId
+        \param r
+        \return node id of a built item - null if not built or it failed
+    */
+    const NodeId& nodeId(Ref r) const { return _items.at(r).result; }
+};
+
+}  // namespace Open62541
+#endif  // SERVERNODEBUILDER_H
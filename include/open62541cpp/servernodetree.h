@@ -23,6 +23,8 @@ class UA_EXPORT ServerNodeTree : public UANodeTree
     Server& _server;     // server
     int _nameSpace = 2;  // sname space index we create nodes in
 public:
+    // fills a lazy folder - base is the path of the folder
+    typedef std::function<void(ServerNodeTree&, const UAPath&)> LazyFill;
     /*!
         \brief setNameSpace
         \param i
@@ -48,6 +50,22 @@ public:
      * \brief ~ServerNodeTree
      */
     virtual ~ServerNodeTree();
+    /*!
+        \brief resync
+        Browse again into a scratch tree and apply only the differences to this one
+        \param f optional report of added, removed and modified nodes
+        \return number of changes, 0 also if the browse failed
+    */
+    size_t resync(const ChangeFunc& f = ChangeFunc());
+    /*!
+        \brief addLazyFolder
+        Create the folders of a path now and defer what goes under the last one until a client first browses
+        it - see Server::addLazyNode. The fill runs on the server's network thread, so the tree must outlive it
+        \param path folder path from the tree root
+        \param fill adds the subtree, e.g. with setNodeValue on paths under base
+        \return true if the folder exists and the fill was registered
+    */
+    bool addLazyFolder(UAPath& path, LazyFill fill);
     /*!
         \brief addFolderNode
         \param parent
@@ -12,6 +12,7 @@
 #ifndef SERVEROBJECTTYPE_H
 #define SERVEROBJECTTYPE_H
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/instancetemplate.h>
 namespace Open62541 {
 
 /*!
@@ -27,6 +28,7 @@ class UA_EXPORT ServerObjectType
 
     NodeId _typeId;
     int _nameSpace = 2;
+    InstanceTemplate _template;  // flattened type - built on first use by addInstances
 
 public:
     /*!
@@ -317,6 +319,56 @@ public:
                              NodeId& nodeId,
                              const NodeId& requestNodeId = NodeId::Null,
                              NodeContext* context        = nullptr);
+
+    /*!
+        \brief addInstance
+        Interned name version - use when creating many instances with the same names
+        \param n
+        \param parent
+        \param nodeId
+        \return
+    */
+    bool addInstance(const InternedString& n,
+                     const NodeId& parent,
+                     NodeId& nodeId,
+                     const NodeId& requestNodeId = NodeId::Null,
+                     NodeContext* context        = nullptr)
+    {
+        bool ret = _server.addInstance(n, requestNodeId, parent, _typeId, nodeId, context);
+        UAPRINTLASTERROR(_server.lastError());
+        return ret;
+    }
+
+    /*!
+        \brief instanceTemplate
+        \return the flattened type used by addInstances - built on first use
+    */
+    InstanceTemplate& instanceTemplate()
+    {
+        if (!_template.valid() || !(_template.typeId() == _typeId))
+            _template.build(_server, _typeId);
+        return _template;
+    }
+    /*!
+        \brief invalidateTemplate
+        Call after changing the type once instances have been added with addInstances
+    */
+    void invalidateTemplate() { _template.clear(); }
+
+    /*!
+        \brief addInstances
+        Add many instances under one server write lock, each stamped out of the instance template rather than
+        by the stack walking the type. Instances are named as with addInstance and organised by parent
+        \param names browse and display names
+        \param parent
+        \param nodeIds set to the ids of the instances - null where one failed
+        \param context node context given to every instance
+        \return true if every instance was added
+    */
+    bool addInstances(const std::vector<std::string>& names,
+                      const NodeId& parent,
+                      std::vector<NodeId>& nodeIds,
+                      NodeContext* context = nullptr);
 };
 
 }  // namespace Open62541
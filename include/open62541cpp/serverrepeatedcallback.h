@@ -15,6 +15,7 @@
 namespace Open62541 {
 
 class ServerRepeatedCallback;
+class ServerCallbackGroup;
 typedef std::function<void(ServerRepeatedCallback&)> ServerRepeatedCallbackFunc;
 
 /*!
@@ -23,8 +24,9 @@ typedef std::function<void(ServerRepeatedCallback&)> ServerRepeatedCallbackFunc;
 class UA_EXPORT ServerRepeatedCallback
 {
     Server& _server;  // parent server
-    UA_UInt32 _interval = 1000;
-    UA_UInt64 _id       = 0;
+    UA_UInt32 _interval         = 1000;
+    UA_UInt64 _id               = 0;
+    ServerCallbackGroup* _group = nullptr;  // runs in the group's batch instead of its own callback - not owned
 
     ServerRepeatedCallbackFunc _func;  // functior to handle event
 
@@ -58,6 +60,26 @@ public:
     */
     bool start();
 
+    /*!
+        \brief setGroup
+        Run as a member of a group, at the group's interval and phase - set while stopped. The group must
+        outlive the callback
+        \param g group or nullptr for a callback of its own
+        \return false if started
+    */
+    bool setGroup(ServerCallbackGroup* g)
+    {
+        if (_id != 0)
+            return false;
+        _group = g;
+        return true;
+    }
+    /*!
+        \brief group
+        \return group or nullptr
+    */
+    ServerCallbackGroup* group() const { return _group; }
+
     /*!
         \brief changeInterval
         \param i
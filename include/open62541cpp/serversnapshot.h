@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERSNAPSHOT_H
+#define SERVERSNAPSHOT_H
+#include <open62541cpp/open62541objects.h>
+#include <cstdint>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The ServerSnapshot class
+    Binary image of the address space of a server above namespace zero - nodes, their attributes and current
+    values, their references and the names of their node contexts. The file is a header, the namespace URIs,
+    one record per node and an index of record offsets:
+
+        Header | namespace URIs | Record | Record | ... | UA_UInt64 offset[count]
+
+    Everything after a record header is UA binary. Records are 8 byte aligned.
+    load() maps the file and inserts the nodes straight into the nodestore, so no type checks or constructors
+    run per node, then adds the references. Contexts are found again by name (Server::context) and their
+    data source, value callback, type lifecycle and method bindings restored. Load into a server that holds
+    namespace zero only - nodes already present are skipped. Namespace indexes are remapped by URI in node
+    ids, browse names, data types and references, but not inside values
+*/
+class UA_EXPORT ServerSnapshot
+{
+public:
+    enum { Magic = 0x504e5353 /* SSNP */, Version = 1 };
+    enum Binding { DataSource = 1, ValueCallback = 2, TypeLifecycle = 4, Method = 8 };  // restored on load
+    /*!
+        \brief The Header struct
+    */
+    struct Header {
+        UA_UInt32 magic;
+        UA_UInt32 version;
+        UA_UInt64 count;        // records
+        UA_UInt64 indexOffset;  // of the offset array
+        UA_UInt32 namespaces;   // URIs following the header - from namespace 1
+        UA_UInt32 reserved;
+    };
+    /*!
+        \brief The Record struct
+        Followed by the node id, context name, bindings, common attributes, class attributes and references
+    */
+    struct Record {
+        UA_UInt32 length;  // of this record, padded to 8 bytes
+        UA_UInt32 nodeClass;
+    };
+
+private:
+    Server& _server;
+    std::vector<UA_Byte> _image;
+    std::vector<UA_UInt64> _index;
+    size_t _nodes      = 0;
+    size_t _references = 0;
+    size_t _skipped    = 0;
+    std::vector<std::string> _unbound;  // context names not found on load
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    bool record(const UA_Node* node);
+
+public:
+    /*!
+        \brief ServerSnapshot
+        \param s server saved or loaded
+    */
+    explicit ServerSnapshot(Server& s)
+        : _server(s)
+    {
+    }
+    ServerSnapshot(const ServerSnapshot&) = delete;
+    ServerSnapshot& operator=(const ServerSnapshot&) = delete;
+
+    /*!
+        \brief save
+        Write every node above namespace zero - takes the server lock
+        \param file replaced once the image is written
+        \return true on success
+    */
+    bool save(const std::string& file);
+    /*!
+        \brief load
+        Add the nodes of a snapshot - call before the server runs
+        \param file
+        \return true if the file was valid - see skipped() and unbound()
+    */
+    bool load(const std::string& file);
+
+    size_t nodes() const { return _nodes; }            //!< nodes saved or loaded
+    size_t references() const { return _references; }  //!< references saved or added
+    size_t skipped() const { return _skipped; }        //!< nodes or references that could not be saved or loaded
+    const std::vector<std::string>& unbound() const { return _unbound; }  //!< context names not found on load
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // SERVERSNAPSHOT_H
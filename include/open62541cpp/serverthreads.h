@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SERVERTHREADS_H
+#define SERVERTHREADS_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/threadconfig.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The ServerThreads class
+    Runs several independent servers in one process, each start() loop on its own thread, optionally pinned to
+    a CPU (see ThreadConfig). Servers share no lock and no map: callbacks find their server through a fixed lock free table
+    (16 entries before an overflow map is used) and named contexts can be kept per server with
+    Server::addContext. Each server needs its own port and should own the nodes of its shard of the
+    namespace. Talk to a running server from other threads with Server::postCommand
+*/
+class UA_EXPORT ServerThreads
+{
+    struct Entry {
+        Server* server = nullptr;
+        ThreadConfig config;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<Entry>> _entries;
+    bool _running = false;
+
+public:
+    ServerThreads() {}
+    ServerThreads(const ServerThreads&) = delete;
+    ServerThreads& operator=(const ServerThreads&) = delete;
+    /*!
+        \brief ~ServerThreads
+        Stops and joins the servers
+    */
+    virtual ~ServerThreads() { stop(); }
+
+    /*!
+        \brief add
+        \param s server - not owned, configured and not yet started
+        \param cpu core to pin the loop to, -1 for none. Pinning is only done on Linux
+        \return false once started
+    */
+    bool add(Server& s, int cpu = -1);
+    /*!
+        \brief add
+        \param s server - not owned, configured and not yet started
+        \param c placement of the server's loop thread
+        \return false once started
+    */
+    bool add(Server& s, const ThreadConfig& c);
+    /*!
+        \brief start
+        Start a thread per server running Server::start()
+        \return false if already running
+    */
+    bool start();
+    /*!
+        \brief stop
+        Ask each server to stop and wait for its loop to finish
+    */
+    void stop();
+    bool running() const { return _running; }
+    size_t size() const { return _entries.size(); }
+    /*!
+        \brief server
+        \param i
+        \return the i'th server added
+    */
+    Server& server(size_t i) { return *_entries[i]->server; }
+};
+
+}  // namespace Open62541
+
+#endif  // SERVERTHREADS_H
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SESSIONLIMITER_H
+#define SESSIONLIMITER_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The SessionLimiter class
+    Admission control per session. Each session has a token bucket refilled at its rate and charged one token per
+    node operation, and a cap on concurrently running method calls. With a server capacity set, the capacity is
+    shared between the open sessions in proportion to their weights, so a bulk tool with a low weight cannot take
+    the budget of an HMI session. A rejected operation fails with an access denied or too many operations status.
+    Enforced by the server's access control hooks (see Server::setSessionLimiter), which the stack also calls when
+    sampling monitored items - allow for subscriptions in the rates.
+    Only sessions opened through open() are admitted, so set the limiter before clients connect; operations of
+    unknown or closed sessions are refused without adding an entry for them
+*/
+class UA_EXPORT SessionLimiter
+{
+public:
+    /*!
+        \brief The Operation enum
+    */
+    enum Operation {
+        Browse = 0,  //!< allowBrowseNode
+        Read,        //!< getUserAccessLevel - value reads, writes and monitored item samples
+        Call,        //!< getUserExecutable
+        OperationCount
+    };
+
+    /*!
+        \brief The Limits struct
+    */
+    struct Limits {
+        double rate         = 0.0;  //!< operations per second - 0 for no own limit
+        double burst        = 0.0;  //!< bucket size - 0 for one second of the rate
+        unsigned concurrent = 0;    //!< method calls running at once - 0 for no limit
+        double weight       = 1.0;  //!< share of the server capacity
+    };
+
+private:
+    struct Session {
+        Limits limits;
+        bool own           = false;  // limits set for this session
+        double tokens      = -1.0;   // negative until first use - starts full
+        UA_DateTime last   = 0;
+        unsigned running   = 0;
+    };
+    mutable std::mutex _mutex;
+    UnorderedNodeIdMap<Session> _sessions;
+    Limits _default;
+    double _capacity       = 0.0;  // operations per second shared by weight - 0 for none
+    double _totalWeight    = 0.0;
+    unsigned _asyncRunning = 0;    // async method calls queued to the worker pool and not yet done
+    std::atomic<size_t> _admitted[OperationCount];
+    std::atomic<size_t> _rejected[OperationCount];
+    std::atomic<size_t> _busy{0};
+    std::atomic<size_t> _unknown{0};
+
+    Session& session(const UA_NodeId& id);
+    double rate(const Session& s) const;
+
+public:
+    SessionLimiter();
+    SessionLimiter(const SessionLimiter&) = delete;
+    SessionLimiter& operator=(const SessionLimiter&) = delete;
+    virtual ~SessionLimiter() {}
+
+    /*!
+        \brief setDefaultLimits
+        Limits of sessions without their own
+        \param l
+    */
+    void setDefaultLimits(const Limits& l);
+    const Limits& defaultLimits() const { return _default; }
+    /*!
+        \brief setLimits
+        \param id session - e.g. set from Server::activateSession for known bulk clients
+        \param l
+    */
+    void setLimits(const UA_NodeId& id, const Limits& l);
+    /*!
+        \brief setCapacity
+        \param opsPerSecond server wide budget split between the sessions by weight - 0 for none
+    */
+    void setCapacity(double opsPerSecond);
+    double capacity() const { return _capacity; }
+
+    /*!
+        \brief open
+        \param id session activated
+    */
+    void open(const UA_NodeId& id);
+    /*!
+        \brief close
+        \param id session closed
+    */
+    void close(const UA_NodeId& id);
+
+    /*!
+        \brief admit
+        \param id session
+        \param op
+        \param cost tokens to take
+        \return false if the session is over its rate or not open
+    */
+    bool admit(const UA_NodeId& id, Operation op, double cost = 1.0);
+    /*!
+        \brief enter
+        \param id session
+        \return false if the session is at its concurrency limit or not open - otherwise call leave when done
+    */
+    bool enter(const UA_NodeId& id);
+    /*!
+        \brief leave
+        \param id session
+    */
+    void leave(const UA_NodeId& id);
+    /*!
+        \brief enterAsync
+        Take a slot for an async method call from when it is queued until it completes. open62541 1.2 runs queued
+        calls without their session, so they are counted together against the default concurrency limit
+        \return false at the limit - otherwise call leaveAsync when done
+    */
+    bool enterAsync();
+    /*!
+        \brief leaveAsync
+    */
+    void leaveAsync();
+
+    /*!
+        \brief The Slot class
+        Concurrency slot held for a scope
+    */
+    class Slot
+    {
+        SessionLimiter* _limiter;
+        const UA_NodeId* _id;
+        bool _ok;
+
+    public:
+        Slot(SessionLimiter* l, const UA_NodeId* id)
+            : _limiter(l)
+            , _id(id)
+            , _ok(!l || !id || l->enter(*id))
+        {
+        }
+        ~Slot()
+        {
+            if (_ok && _limiter && _id)
+                _limiter->leave(*_id);
+        }
+        bool ok() const { return _ok; }
+    };
+
+    size_t admitted(Operation op) const { return _admitted[op]; }
+    size_t rejected(Operation op) const { return _rejected[op]; }
+    size_t busy() const { return _busy; }        // calls refused at the concurrency limit
+    size_t unknown() const { return _unknown; }  // operations refused for sessions not open
+    size_t sessions() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _sessions.size();
+    }
+    /*!
+        \brief resetCounts
+    */
+    void resetCounts();
+};
+
+}  // namespace Open62541
+
+#endif  // SESSIONLIMITER_H
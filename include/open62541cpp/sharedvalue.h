@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SHAREDVALUE_H
+#define SHAREDVALUE_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+
+namespace Open62541 {
+
+/*!
+    \brief The SharedValue class
+    Immutable, reference counted UA value. Copies share one value - handing a large array to several
+    consumers costs a reference count increment each, not a deep copy. The value is cleared when the last
+    copy goes. mutate() is the escape hatch: it copies the value first if it is shared (copy on write).
+    Reference counting is atomic, so copies may be passed between threads; a single SharedValue object that
+    is written by one thread and read by another needs load() and store().
+    Copies are cheap enough to store by value in containers and in a PropertyTree
+*/
+template <typename T, int I>
+class SharedValue
+{
+    template <typename, int>
+    friend class SharedValue;
+
+    /*!
+        \brief The Holder struct
+        One allocation for the count and the value
+    */
+    struct Holder {
+        T value;
+        Holder() { UA_init(&value, &UA_TYPES[I]); }
+        ~Holder() { UA_clear(&value, &UA_TYPES[I]); }
+        Holder(const Holder&) = delete;
+        Holder& operator=(const Holder&) = delete;
+    };
+    std::shared_ptr<const T> _p;
+
+    static std::shared_ptr<T> create()
+    {
+        auto h = std::make_shared<Holder>();
+        return std::shared_ptr<T>(h, &h->value);  // aliasing - the count is the holder's
+    }
+
+public:
+    SharedValue() = default;
+
+    /*!
+        \brief SharedValue
+        Share a member of another shared value - e.g. the variant of a shared data value - with no copy
+        \param owner value that holds the member
+        \param member member of the owner's value
+    */
+    template <typename U, int J>
+    SharedValue(const SharedValue<U, J>& owner, const T* member)
+        : _p(owner._p, member)
+    {
+    }
+
+    /*!
+        \brief copyOf
+        \param v value
+        \return shared deep copy of v
+    */
+    static SharedValue copyOf(const T& v)
+    {
+        SharedValue s;
+        std::shared_ptr<T> p = create();
+        UA_copy(&v, p.get(), &UA_TYPES[I]);
+        s._p = std::move(p);
+        return s;
+    }
+
+    /*!
+        \brief adopt
+        Take the contents of v - nothing is copied and v is left empty
+        \param v value
+        \return shared value
+    */
+    static SharedValue adopt(T& v)
+    {
+        SharedValue s;
+        std::shared_ptr<T> p = create();
+        *p                   = v;
+        UA_init(&v, &UA_TYPES[I]);
+        s._p = std::move(p);
+        return s;
+    }
+
+    /*!
+        \brief load
+        Atomic read of a shared value another thread may store to
+        \param s
+        \return a copy sharing the value
+    */
+    static SharedValue load(const SharedValue& s)
+    {
+        SharedValue r;
+        r._p = std::atomic_load(&s._p);
+        return r;
+    }
+
+    /*!
+        \brief store
+        Atomic replacement of a shared value other threads may load
+        \param s
+        \param v new value
+    */
+    static void store(SharedValue& s, SharedValue v) { std::atomic_store(&s._p, std::move(v._p)); }
+
+    bool isNull() const { return !_p; }
+    explicit operator bool() const { return _p != nullptr; }
+    const T& get() const { return *_p; }
+    const T* operator->() const { return _p.get(); }
+    const T& operator*() const { return *_p; }
+    long useCount() const { return _p.use_count(); }  //!< copies sharing the value
+    void reset() { _p.reset(); }
+
+    /*!
+        \brief mutate
+        Copy on write - the value is copied first unless this is the only copy. Not for an object other
+        threads load from
+        \return the value to change
+    */
+    T& mutate()
+    {
+        if (!_p || (_p.use_count() > 1)) {
+            std::shared_ptr<T> p = create();
+            if (_p)
+                UA_copy(_p.get(), p.get(), &UA_TYPES[I]);
+            _p = std::move(p);
+        }
+        return const_cast<T&>(*_p);  // created non const by create()
+    }
+};
+
+typedef SharedValue<UA_Variant, UA_TYPES_VARIANT> SharedVariant;
+typedef SharedValue<UA_DataValue, UA_TYPES_DATAVALUE> SharedDataValue;
+
+/*!
+    \brief sharedVariant
+    \param d shared data value
+    \return its variant, sharing the data value's count - null if d is null
+*/
+inline SharedVariant sharedVariant(const SharedDataValue& d)
+{
+    return d ? SharedVariant(d, &d->value) : SharedVariant();
+}
+
+}  // namespace Open62541
+
+#endif  // SHAREDVALUE_H
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SNAPSHOTMAP_H
+#define SNAPSHOTMAP_H
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The SnapshotMap class
+    Map read far more often than it is changed, safe to use from any thread. Readers take an immutable
+    snapshot without locking and keep it - and so the values in it - alive for as long as they hold it.
+    Writers copy the map, change the copy and publish it, serialised by a mutex; a change costs a copy of the
+    map, so it suits tables of subscriptions and monitored items that change at human rather than data rates.
+    A value taken out of the map is destroyed when the last snapshot holding it goes
+*/
+template <typename K, typename V>
+class SnapshotMap
+{
+public:
+    typedef std::map<K, V> Map;
+    typedef std::shared_ptr<const Map> MapRef;
+
+private:
+    MapRef _map;
+    std::mutex _mutex;  // serialises writers
+    std::atomic<size_t> _version{0};
+
+    void publish(const std::shared_ptr<Map>& m)
+    {
+        std::atomic_store(&_map, MapRef(m));
+        _version++;
+    }
+
+public:
+    SnapshotMap()
+        : _map(std::make_shared<const Map>())
+    {
+    }
+    SnapshotMap(const SnapshotMap&) = delete;
+    SnapshotMap& operator=(const SnapshotMap&) = delete;
+
+    /*!
+        \brief snapshot
+        \return the current map - iterate it rather than the SnapshotMap
+    */
+    MapRef snapshot() const { return std::atomic_load(&_map); }
+
+    /*!
+        \brief find
+        \param k
+        \return the value or a default constructed one
+    */
+    V find(const K& k) const
+    {
+        MapRef m = snapshot();
+        auto i   = m->find(k);
+        return (i != m->end()) ? i->second : V();
+    }
+    bool contains(const K& k) const { return snapshot()->count(k) > 0; }
+
+    /*!
+        \brief set
+        Add or replace a value
+        \param k
+        \param v
+    */
+    void set(const K& k, V v)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        auto m = std::make_shared<Map>(*snapshot());
+        (*m)[k] = std::move(v);
+        publish(m);
+    }
+
+    /*!
+        \brief take
+        Remove a value
+        \param k
+        \return the value removed or a default constructed one
+    */
+    V take(const K& k)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        MapRef current = snapshot();
+        auto i         = current->find(k);
+        if (i == current->end())
+            return V();
+        V v    = i->second;
+        auto m = std::make_shared<Map>(*current);
+        m->erase(k);
+        publish(m);
+        return v;
+    }
+    bool erase(const K& k)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        MapRef current = snapshot();
+        if (current->count(k) == 0)
+            return false;
+        auto m = std::make_shared<Map>(*current);
+        m->erase(k);
+        publish(m);
+        return true;
+    }
+
+    /*!
+        \brief takeAll
+        Empty the map
+        \return what it held
+    */
+    MapRef takeAll()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        MapRef current = snapshot();
+        if (!current->empty())
+            publish(std::make_shared<Map>());
+        return current;
+    }
+    void clear() { takeAll(); }
+
+    size_t size() const { return snapshot()->size(); }
+    bool empty() const { return snapshot()->empty(); }
+    /*!
+        \brief version
+        \return changes made - a reader can tell whether a snapshot it holds is still current
+    */
+    size_t version() const { return _version; }
+};
+
+}  // namespace Open62541
+
+#endif  // SNAPSHOTMAP_H
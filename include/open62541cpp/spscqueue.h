@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace Open62541 {
+
+/*!
+    \brief The SpscQueue class
+    Bounded lock free ring buffer for exactly one producer thread and one consumer thread. Storage is
+    allocated once; the capacity is rounded up to a power of two. Head and tail live on separate cache
+    lines so the two sides do not false share.
+    \param T slot type - moved in and out
+*/
+template <typename T>
+class SpscQueue
+{
+    static constexpr size_t CacheLine = 64;
+    std::vector<T> _slots;
+    size_t _mask = 0;
+    alignas(CacheLine) std::atomic<size_t> _head{0};  // next slot to read - written by the consumer
+    alignas(CacheLine) std::atomic<size_t> _tail{0};  // next slot to write - written by the producer
+
+public:
+    /*!
+        \brief SpscQueue
+        \param capacity minimum number of slots
+    */
+    explicit SpscQueue(size_t capacity = 1024)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        _slots.resize(n);
+        _mask = n - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /*!
+        \brief push
+        Producer side
+        \param v value to move in
+        \return false if full - v is untouched
+    */
+    bool push(T& v)
+    {
+        const size_t t = _tail.load(std::memory_order_relaxed);
+        if ((t - _head.load(std::memory_order_acquire)) > _mask)
+            return false;
+        _slots[t & _mask] = std::move(v);
+        _tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        \brief pop
+        Consumer side
+        \param v set to the oldest value
+        \return false if empty
+    */
+    bool pop(T& v)
+    {
+        const size_t h = _head.load(std::memory_order_relaxed);
+        if (h == _tail.load(std::memory_order_acquire))
+            return false;
+        v = std::move(_slots[h & _mask]);
+        _head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        \brief size
+        \return approximate number of queued values
+    */
+    size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+
+    /*!
+        \brief empty
+        \return true if nothing is queued
+    */
+    bool empty() const { return size() == 0; }
+
+    /*!
+        \brief capacity
+        \return number of slots
+    */
+    size_t capacity() const { return _mask + 1; }
+};
+
+}  // namespace Open62541
+
+#endif  // SPSCQUEUE_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Open62541 {
+
+/*!
+    \brief The StartupTrace class
+    Time spent in each phase of building the address space - counts, totals and maxima by phase name.
+    A server traces from construction until initialise() returns; once finished the scopes cost one atomic load
+*/
+class StartupTrace
+{
+public:
+    /*!
+        \brief The Phase struct
+    */
+    struct Phase {
+        std::string name;
+        size_t count    = 0;
+        uint64_t ns     = 0;
+        uint64_t maxNs  = 0;
+    };
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    mutable std::mutex _mutex;
+    std::vector<Phase> _phases;  // in order of first use
+    std::atomic<bool> _active{true};
+
+public:
+    /*!
+        \brief The Scope class
+        Times a phase from construction to destruction
+    */
+    class Scope
+    {
+        StartupTrace& _trace;
+        const char* _name;
+        bool _on;
+        Clock::time_point _start;
+
+    public:
+        Scope(StartupTrace& t, const char* name)
+            : _trace(t)
+            , _name(name)
+            , _on(t.active())
+        {
+            if (_on)
+                _start = Clock::now();
+        }
+        ~Scope()
+        {
+            if (_on)
+                _trace.record(
+                    _name,
+                    uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count()));
+        }
+    };
+
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+    /*!
+        \brief setActive
+        \param f false to stop tracing - true to trace again, e.g. around a later bulk load
+    */
+    void setActive(bool f) { _active = f; }
+    /*!
+        \brief record
+        \param name phase - nested phases are counted in each
+        \param ns
+    */
+    void record(const char* name, uint64_t ns);
+    /*!
+        \brief phases
+        \param out set to a copy of the phases
+    */
+    void phases(std::vector<Phase>& out) const;
+    /*!
+        \brief report
+        \param os one line per phase
+    */
+    void report(std::ostream& os) const;
+    void clear()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _phases.clear();
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // STARTUPTRACE_H
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef STOREFORWARD_H
+#define STOREFORWARD_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/monitoreditem.h>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The StoreForward class
+    Disk buffer for values on their way to a sink - a historian, a cloud link - that may be unreachable for
+    hours. Values are appended, typically straight from subscription notifications (see feed()), packed into
+    blocks and each block compressed and appended to the current segment file in a directory. Blocks are
+    delivered oldest first in batches by drain() and a segment file is deleted once all its blocks have been
+    accepted by the sink. When the files reach the size bound the oldest segment is dropped, so an outage
+    longer than the buffer loses its oldest values rather than its newest.
+    Delivery is at least once - blocks accepted by a sink just before a crash may be delivered again
+*/
+class UA_EXPORT StoreForward
+{
+public:
+    /*!
+        \brief The Record struct
+        One buffered value
+    */
+    struct Record {
+        NodeId node;
+        DataValue value;
+    };
+    /*!
+        \brief Sink
+        Deliver a batch, oldest first - false if it could not be delivered and is to be kept
+    */
+    typedef std::function<bool(const std::vector<Record>& batch)> Sink;
+
+    /*!
+        \brief The BlockHeader struct
+        Followed by the compressed records
+    */
+    struct BlockHeader {
+        UA_UInt32 magic;   // SFBK
+        UA_UInt32 count;   // records in the block
+        UA_UInt32 raw;     // bytes of records before compression
+        UA_UInt32 packed;  // bytes following the header
+    };
+    enum { Magic = 0x4B424653 /* SFBK */ };
+
+private:
+    struct Segment {
+        size_t bytes   = 0;
+        size_t records = 0;
+    };
+    typedef std::pair<UA_UInt32, size_t> Position;  // segment id and offset
+
+    std::mutex _mutex;
+    std::string _directory;
+    size_t _segmentSize = 16 * 1024 * 1024;
+    size_t _maxBytes    = 1024 * 1024 * 1024;
+    size_t _blockSize   = 64 * 1024;
+    std::map<UA_UInt32, Segment> _segments;
+    std::ofstream _tail;          // the segment appended to
+    Position _head{0, 0};         // next block to deliver
+    size_t _headRecords = 0;      // records of the head segment already delivered
+    std::vector<UA_Byte> _block;  // records not yet written
+    size_t _blockRecords = 0;
+    size_t _bytes        = 0;  // bytes in the segment files
+    bool _open           = false;
+    std::mutex _drainMutex;  // one drain at a time
+    std::ifstream _reader;   // the segment being delivered
+    UA_UInt32 _readerSegment = 0;
+    std::atomic<size_t> _appended{0};
+    std::atomic<size_t> _delivered{0};
+    std::atomic<size_t> _dropped{0};
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    std::string segmentPath(UA_UInt32 id) const;
+    void writeManifest();
+    bool scan(UA_UInt32 id, Segment& s);
+    bool openTail(UA_UInt32 id);
+    bool writeBlock();
+    void retain();
+    bool readBlock(Position& p, size_t& consumed, std::vector<Record>& out);
+    void commit(const Position& to, size_t consumed);
+
+public:
+    /*!
+        \brief StoreForward
+        \param directory where the segment files are held - must exist
+        \param maxBytes bound on the segment files - the oldest segment is dropped beyond it
+        \param segmentSize bytes per segment file before a new one is started
+    */
+    StoreForward(const std::string& directory,
+                 size_t maxBytes    = 1024 * 1024 * 1024,
+                 size_t segmentSize = 16 * 1024 * 1024);
+    virtual ~StoreForward();
+    StoreForward(const StoreForward&) = delete;
+    StoreForward& operator=(const StoreForward&) = delete;
+
+    /*!
+        \brief open
+        Find the segments left by an earlier run and resume from its last delivered block
+        \return true on success
+    */
+    bool open();
+    /*!
+        \brief close
+        Write the pending block and close the files
+    */
+    void close();
+    bool isOpen()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _open;
+    }
+
+    /*!
+        \brief setBlockSize
+        \param bytes records are compressed and written in blocks of about this size
+    */
+    void setBlockSize(size_t bytes) { _blockSize = std::max<size_t>(bytes, 1024); }
+
+    /*!
+        \brief append
+        Buffer a value - from any thread
+        \param node
+        \param value
+        \return false if not open or the value could not be encoded or written
+    */
+    bool append(const NodeId& node, const UA_DataValue& value);
+    /*!
+        \brief flush
+        Write the pending block now - e.g. from a timer so a quiet buffer still reaches the disk
+        \return false on a write error
+    */
+    bool flush();
+    /*!
+        \brief feed
+        \param node the monitored node
+        \return a monitored item function appending the node's notifications - see ClientSubscription::addMonitorNodeId
+    */
+    monitorItemFunc feed(const NodeId& node);
+
+    /*!
+        \brief drain
+        Deliver buffered values to a sink in batches until the buffer is empty or the sink refuses a batch.
+        Values appended while draining are delivered too
+        \param sink
+        \param batchSize records per batch - whole blocks are delivered so batches may be larger
+        \param maxBatches stop after this many batches - 0 for no limit
+        \return records delivered
+    */
+    size_t drain(Sink sink, size_t batchSize = 1000, size_t maxBatches = 0);
+
+    /*!
+        \brief backlog
+        \return records buffered and not yet delivered
+    */
+    size_t backlog();
+    /*!
+        \brief bytes
+        \return bytes in the segment files
+    */
+    size_t bytes()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _bytes;
+    }
+    size_t appended() const { return _appended; }
+    size_t delivered() const { return _delivered; }
+    size_t dropped() const { return _dropped; }  // records lost to the size bound
+
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+
+    /*!
+        \brief compress
+        Byte oriented LZ77 - literal runs and back references within 64KiB
+        \param in
+        \param length
+        \param out appended to
+    */
+    static void compress(const UA_Byte* in, size_t length, std::vector<UA_Byte>& out);
+    /*!
+        \brief expand
+        \param in
+        \param length
+        \param out appended to
+        \param limit bytes expected
+        \return false if the input is corrupt
+    */
+    static bool expand(const UA_Byte* in, size_t length, std::vector<UA_Byte>& out, size_t limit);
+};
+
+}  // namespace Open62541
+
+#endif  // STOREFORWARD_H
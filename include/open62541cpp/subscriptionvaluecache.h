@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef SUBSCRIPTIONVALUECACHE_H
+#define SUBSCRIPTIONVALUECACHE_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/sharedvalue.h>
+#include <atomic>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The SubscriptionValueCache class
+    Last value cache fed by data change monitored items. Reads never block: the node index is an immutable
+    snapshot replaced when a node is first attached, and each value is an immutable shared data value
+    swapped on update. May be shared by several clients
+*/
+class UA_EXPORT SubscriptionValueCache
+{
+public:
+    /*!
+        \brief The Freshness enum
+        Result of a cache read
+    */
+    enum class Freshness { Fresh, Stale, Missing };
+
+    /*!
+        \brief The Entry struct
+        One cached node - monitored items hold a reference so updates need no lookup
+    */
+    struct Entry {
+        NodeId node;
+        SharedDataValue value;                 // only accessed with SharedDataValue::load / store
+        std::atomic<UA_DateTime> received{0};  // local time of the last update
+        std::atomic<unsigned> subscribers{0};  // live monitored items feeding this entry
+        std::atomic<bool> valid{false};        // false once the feeding session has gone
+    };
+    typedef std::shared_ptr<Entry> EntryRef;
+
+private:
+    typedef std::unordered_map<UA_NodeId, EntryRef, NodeIdHash, NodeIdEqual> Index;  // keys point into entries
+    std::shared_ptr<const Index> _index;
+    std::mutex _mutex;  // serialises attach
+    std::atomic<UA_DateTime> _maxAge{0};  // 0 - values never go stale while subscribed
+
+    std::shared_ptr<const Index> index() const { return std::atomic_load(&_index); }
+
+public:
+    /*!
+        \brief SubscriptionValueCache
+    */
+    SubscriptionValueCache()
+        : _index(std::make_shared<const Index>())
+    {
+    }
+
+    /*!
+        \brief setMaxAge
+        \param ms values not updated within this time are reported stale - 0 to disable
+    */
+    void setMaxAge(unsigned ms) { _maxAge = UA_DateTime(ms) * UA_DATETIME_MSEC; }
+
+    /*!
+        \brief attach
+        Called when a monitored item starts feeding a node
+        \param n node
+        \return the entry to update
+    */
+    EntryRef attach(const NodeId& n);
+
+    /*!
+        \brief detach
+        Called when a monitored item stops feeding a node - the last value stays readable as stale
+        \param e entry
+    */
+    static void detach(const EntryRef& e);
+
+    /*!
+        \brief update
+        Publishes a new value - copies it
+        \param e entry
+        \param v value
+    */
+    static void update(Entry& e, const UA_DataValue& v);
+
+    /*!
+        \brief update
+        Publishes a new value - shares it, no copy
+        \param e entry
+        \param v value
+    */
+    static void update(Entry& e, const SharedDataValue& v);
+
+    /*!
+        \brief invalidate
+        Marks an entry stale until its next update - used when the session feeding it is lost
+        \param e entry
+    */
+    static void invalidate(Entry& e) { e.valid = false; }
+
+    /*!
+        \brief read
+        \param n node
+        \param out set to the cached value if there is one
+        \param received set to the local time of the last update if not null
+        \return freshness of the value
+    */
+    Freshness read(const NodeId& n, DataValue& out, UA_DateTime* received = nullptr) const;
+
+    /*!
+        \brief read
+        \param n node
+        \param out set to share the cached value if there is one - no copy
+        \param received set to the local time of the last update if not null
+        \return freshness of the value
+    */
+    Freshness read(const NodeId& n, SharedDataValue& out, UA_DateTime* received = nullptr) const;
+
+    /*!
+        \brief find
+        \param n node
+        \return entry or null
+    */
+    EntryRef find(const NodeId& n) const;
+
+    /*!
+        \brief size
+        \return number of nodes cached
+    */
+    size_t size() const { return index()->size(); }
+};
+
+}  // namespace Open62541
+
+#endif  // SUBSCRIPTIONVALUECACHE_H
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef TAGIMAGE_H
+#define TAGIMAGE_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/nodecontext.h>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <atomic>
+#include <memory>
+
+namespace Open62541 {
+
+class Server;
+
+/*!
+    \brief The TagImage class
+    Table of tag values in a named shared memory segment, so producers in other processes on the host write
+    values at memory speed and the server reads them on demand - no IPC per update.
+    The server process creates the segment and defines the tags; producers open it by name, find their tags
+    and write them. Each tag is a fixed size slot holding a scalar or an array of a pointer free type - numbers,
+    booleans, date times, guids. A slot is guarded by a sequence lock: the writer makes the sequence odd, writes,
+    then makes it even again; readers copy the slot and retry if the sequence was odd or moved. Nothing blocks
+    and a reader never sees a torn value. Each slot must have one writer at a time.
+    Variables bound with bind() or added with addNodes() read their slot as a data source, so monitored items
+    sample the image at their sampling interval
+*/
+class UA_EXPORT TagImage
+{
+public:
+    enum { Magic = 0x47415455 /* UTAG */, Version = 1, NameSize = 40, Array = 1 };
+
+    /*!
+        \brief The Header struct
+        Start of the segment - one cache line
+    */
+    struct Header {
+        UA_UInt32 magic;
+        UA_UInt32 version;
+        UA_UInt32 slots;               // capacity
+        UA_UInt32 stride;              // bytes of each slot, value included
+        UA_UInt32 valueSize;           // bytes of value in each slot
+        std::atomic<UA_UInt32> count;  // tags defined - slots below it are in use
+        UA_Byte reserved[40];
+    };
+    /*!
+        \brief The Slot struct
+        One tag - followed by valueSize bytes of value. The name, type and flags are set when the tag is defined
+        and do not change; the rest is written under the sequence
+    */
+    struct Slot {
+        std::atomic<UA_UInt32> sequence;  // odd while being written
+        UA_UInt16 type;                   // index into UA_TYPES
+        UA_UInt16 flags;                  // Array
+        UA_UInt32 length;                 // elements of an array
+        UA_StatusCode status;
+        UA_DateTime sourceTimestamp;      // 0 for none
+        char name[NameSize];              // null terminated
+    };
+
+private:
+    boost::interprocess::shared_memory_object _shm;
+    boost::interprocess::mapped_region _region;
+    std::string _name;
+    Header* _header = nullptr;
+    bool _owner     = false;  // created the segment - removes it on close
+    bool _writable  = false;
+    std::atomic<size_t> _retries{0};  // reads repeated because a write was in progress
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+    std::vector<std::unique_ptr<NodeContext>> _contexts;  // of the bound nodes
+
+    Slot* slot(size_t i) const
+    {
+        return reinterpret_cast<Slot*>(reinterpret_cast<UA_Byte*>(_header) + sizeof(Header) + i * _header->stride);
+    }
+    static UA_Byte* valueOf(Slot* s) { return reinterpret_cast<UA_Byte*>(s) + sizeof(Slot); }
+
+public:
+    TagImage() = default;
+    TagImage(const TagImage&) = delete;
+    TagImage& operator=(const TagImage&) = delete;
+    ~TagImage() { close(); }
+
+    /*!
+        \brief create
+        Make a new segment - one of the same name is replaced. Done by the server process
+        \param name segment name
+        \param slots tags it can hold
+        \param valueSize bytes of value per tag - 8 holds any numeric scalar
+        \return true on success
+    */
+    bool create(const std::string& name, size_t slots, size_t valueSize = 8);
+    /*!
+        \brief open
+        Map an existing segment - done by producers
+        \param name
+        \param writable false to only read it
+        \return true on success
+    */
+    bool open(const std::string& name, bool writable = true);
+    /*!
+        \brief close
+        Unmap the segment - the creator also removes its name, producers keep their mappings. Bound nodes
+        then fail their reads; close while the server is not reading them
+    */
+    void close();
+    bool isOpen() const { return _header != nullptr; }
+    const std::string& name() const { return _name; }
+
+    /*!
+        \brief define
+        Add a tag - by the creator, from one thread, before the producers look for it
+        \param tag name - at most NameSize - 1 bytes
+        \param type a pointer free type of UA_TYPES
+        \param arrayLength most elements written - 0 for a scalar
+        \return slot index or -1 if full, the tag exists, or the type or size does not fit
+    */
+    int define(const std::string& tag, const UA_DataType* type, size_t arrayLength = 0);
+    /*!
+        \brief find
+        \param tag
+        \return slot index or -1
+    */
+    int find(const std::string& tag) const;
+    size_t count() const { return _header ? _header->count.load(std::memory_order_acquire) : 0; }
+    size_t capacity() const { return _header ? _header->slots : 0; }
+    std::string tagName(size_t i) const;
+    const UA_DataType* tagType(size_t i) const;
+
+    /*!
+        \brief write
+        Publish a value - lock free, by the slot's one writer
+        \param i slot
+        \param data scalar or first element
+        \param length elements - ignored for a scalar, for an array as many as fit the slot
+        \param sourceTimestamp 0 for none
+        \param status
+        \return false if the slot is not defined or the value does not fit
+    */
+    bool write(size_t i,
+               const void* data,
+               size_t length               = 1,
+               UA_DateTime sourceTimestamp = 0,
+               UA_StatusCode status        = UA_STATUSCODE_GOOD);
+    /*!
+        \brief writeScalar
+        Typed form of write
+        \param i slot
+        \param v value - must be the defined type
+        \param sourceTimestamp 0 for none
+        \return false on a type mismatch
+    */
+    template <typename T>
+    bool writeScalar(size_t i, const T& v, UA_DateTime sourceTimestamp = 0)
+    {
+        static_assert(ua_type_traits<T>::is_ua_type, "TagImage::writeScalar needs a type with ua_type_traits");
+        return (tagType(i) == ua_type_traits<T>::type()) && write(i, &v, 1, sourceTimestamp);
+    }
+    /*!
+        \brief read
+        Copy a consistent value out of a slot
+        \param i slot
+        \param value set to a copy - with the source timestamp if one was written
+        \return false if not defined or a consistent copy could not be made
+    */
+    bool read(size_t i, UA_DataValue& value);
+    /*!
+        \brief sequence
+        \param i slot
+        \return even number moved on by 2 each write - to tell whether a tag has changed
+    */
+    UA_UInt32 sequence(size_t i) const;
+
+    /*!
+        \brief bind
+        Make a slot the data source of a variable node - the node must have no context of its own
+        \param server
+        \param node variable
+        \param i slot
+        \return true on success
+    */
+    bool bind(Server& server, NodeId& node, size_t i);
+    /*!
+        \brief addNodes
+        Add a variable per defined tag under a folder, bound to its slot - node ids are "<folder>.<tag>" strings
+        \param server
+        \param parent node the folder is added to
+        \param folder browse name of the folder
+        \param nameSpaceIndex of the new nodes
+        \return true on success
+    */
+    bool addNodes(Server& server, const NodeId& parent, const std::string& folder, int nameSpaceIndex = 1);
+
+    size_t retries() const { return _retries; }
+    UA_StatusCode lastError() const { return _lastError; }
+    bool lastOK() const { return _lastError == UA_STATUSCODE_GOOD; }
+};
+
+}  // namespace Open62541
+
+#endif  // TAGIMAGE_H
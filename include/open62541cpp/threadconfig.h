@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef THREADCONFIG_H
+#define THREADCONFIG_H
+#include <string>
+#include <vector>
+
+namespace Open62541 {
+
+/*!
+    \brief The ThreadConfig struct
+    Placement of a library owned thread - applied by the thread to itself as it starts. Every field defaults
+    to leaving the thread as the system created it. Applied on Linux only; elsewhere apply() does nothing
+*/
+struct ThreadConfig {
+    std::string name;       //!< thread name - pools append the thread index. Truncated to 15 characters
+    std::vector<int> cpus;  //!< CPUs the thread may run on - empty for any
+    int priority = 0;       //!< SCHED_FIFO priority - 0 leaves the default policy, needs the privilege
+    int numaNode = -1;      //!< NUMA node to prefer for memory the thread allocates - negative for default
+
+    /*!
+        \brief empty
+        \return true if there is nothing to apply
+    */
+    bool empty() const { return name.empty() && cpus.empty() && (priority <= 0) && (numaNode < 0); }
+
+    /*!
+        \brief apply
+        Configure the calling thread - best effort, every part is tried
+        \param index thread number within a pool - appended to the name when non negative
+        \return true if everything requested was applied
+    */
+    bool apply(int index = -1) const;
+};
+
+}  // namespace Open62541
+
+#endif  // THREADCONFIG_H
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef TIEREDHISTORIAN_H
+#define TIEREDHISTORIAN_H
+#include <open62541cpp/historyaggregates.h>
+#include <deque>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The TieredHistoryBackend class
+    In memory history with tiered retention. Tier 0 holds the raw values, each further tier holds
+    rollups - a summary per fixed interval - of a coarser resolution. Every tier has its own retention
+    so memory is bounded by the retention over the interval of each tier rather than by a count of
+    raw values, e.g. raw values for an hour, minute rollups for 30 days and hourly rollups for ever.
+    Rollups are built as the values arrive, so there is no downsampling pass as data ages out; values
+    older than a tier's retention are dropped from the front of the tier on each write.
+
+    The stack's reads see one time ordered history per node - the raw values, preceded by the rollups of
+    each coarser tier from before the oldest value of the next finer one - so a read of a long span gets
+    the finest resolution still held for each part of it. read() instead picks the single tier best
+    suited to a span.
+    Rollups report the tier's aggregate, timestamped with the interval start and a calculated status.
+    The newest rollup of a tier summarises its interval so far
+*/
+class UA_EXPORT TieredHistoryBackend : public HistoryDataBackend
+{
+public:
+    /*!
+        \brief The Tier struct
+        Resolution and retention of one tier
+    */
+    struct Tier {
+        UA_DateTime interval  = 0;  // rollup interval - 0 for the raw tier
+        UA_DateTime retention = 0;  // age beyond which values are dropped - 0 to keep everything
+        size_t maxValues      = 0;  // cap on values per node - 0 for no cap
+        HistoryAggregates::Aggregate aggregate = HistoryAggregates::Aggregate::Average;
+        Tier() {}
+        Tier(UA_DateTime i, UA_DateTime r, size_t m = 0)
+            : interval(i)
+            , retention(r)
+            , maxValues(m)
+        {
+        }
+    };
+
+    /*!
+        \brief The Bucket struct
+        One rollup interval
+    */
+    struct Bucket {
+        UA_DateTime start = 0;
+        HistoryAggregates::Summary summary;
+    };
+
+private:
+    /*!
+        \brief The Series struct
+        The tiers of one node
+    */
+    struct Series {
+        std::deque<DataValue> raw;                 // tier 0 in time order
+        std::vector<std::deque<Bucket>> rollups;  // tiers 1.. in time order
+    };
+
+    /*!
+        \brief The View struct
+        The part of each tier in the merged history, coarsest first
+    */
+    struct View {
+        std::vector<size_t> count;   // leading values of the tier in the view
+        std::vector<size_t> offset;  // view index of the first of them
+        size_t size = 0;
+    };
+
+    std::mutex _mutex;
+    std::vector<Tier> _tiers;
+    UnorderedNodeIdMap<Series> _series;
+    DataValue _current;  // rollup returned by getDataValue
+    uint64_t _dropped = 0;
+
+    Series* series(const NodeId& n, bool create = false);
+    static UA_DateTime bucketStart(UA_DateTime t, UA_DateTime interval);
+    UA_DateTime keyOf(const Series& s, size_t tier, size_t i) const;
+    size_t tierSize(const Series& s, size_t tier) const;
+    size_t lowerBound(const Series& s, size_t tier, UA_DateTime t) const;
+    void view(const Series& s, View& v) const;
+    bool locate(const View& v, size_t index, size_t& tier, size_t& i) const;
+    void valueOf(const Series& s, size_t tier, size_t i, UA_DataValue& d) const;
+    void roll(Series& s, UA_DateTime t, const UA_DataValue& v);
+    void rebuild(Series& s, UA_DateTime from, UA_DateTime to);
+    void retain(Series& s, UA_DateTime now);
+    UA_StatusCode store(const NodeId& n, const UA_DataValue& v, bool replace, bool insert);
+    static size_t bytesOf(const Series& s);
+
+public:
+    /*!
+        \brief TieredHistoryBackend
+        \param tiers the first is the raw tier, the rest in increasing interval - see standardTiers()
+    */
+    TieredHistoryBackend(const std::vector<Tier>& tiers = standardTiers());
+    virtual ~TieredHistoryBackend() {}
+
+    /*!
+        \brief standardTiers
+        \return raw for an hour, minute rollups for 30 days, hourly rollups thereafter
+    */
+    static std::vector<Tier> standardTiers();
+
+    /*!
+        \brief tiers
+        \return the tier configuration
+    */
+    const std::vector<Tier>& tiers() const { return _tiers; }
+    /*!
+        \brief setRetention
+        \param tier
+        \param retention age beyond which values are dropped, 0 for none
+        \param maxValues cap on values per node, 0 for none
+    */
+    void setRetention(size_t tier, UA_DateTime retention, size_t maxValues = 0);
+    /*!
+        \brief setAggregate
+        \param tier rollup tier
+        \param a Average, Minimum, Maximum, Count, StandardDeviation or Variance
+    */
+    void setAggregate(size_t tier, HistoryAggregates::Aggregate a);
+    /*!
+        \brief applyRetention
+        Drop aged values from every node now - writes only trim the node written
+    */
+    void applyRetention();
+
+    /*!
+        \brief read
+        Read a span from the finest tier that still holds its start and, if maxValues is set, has no
+        more than maxValues values in it - the coarsest tier otherwise
+        \param n node
+        \param start
+        \param end
+        \param maxValues 0 for no limit
+        \param out values in time order
+        \return the tier read
+    */
+    size_t read(const NodeId& n, UA_DateTime start, UA_DateTime end, size_t maxValues, std::vector<DataValue>& out);
+
+    /*!
+        \brief size
+        \param n node
+        \param tier
+        \return values held in the tier
+    */
+    size_t size(const NodeId& n, size_t tier = 0);
+    /*!
+        \brief nodeCount
+        \return nodes with history
+    */
+    size_t nodeCount();
+    /*!
+        \brief memoryUsed
+        \return approximate bytes held
+    */
+    size_t memoryUsed();
+    /*!
+        \brief memoryUsage
+        \param r
+    */
+    virtual void memoryUsage(MemoryReport& r);
+    /*!
+        \brief dropped
+        \return values and rollups dropped by retention
+    */
+    uint64_t dropped() const { return _dropped; }
+    /*!
+        \brief clearNode
+        \param n
+    */
+    void clearNode(const NodeId& n);
+    /*!
+        \brief clearAll
+    */
+    void clearAll();
+
+    // HistoryDataBackend
+    virtual UA_StatusCode serverSetHistoryData(Context& c, bool historizing, const UA_DataValue* value);
+    virtual size_t getDateTimeMatch(Context& c, const UA_DateTime timestamp, const MatchStrategy strategy);
+    virtual size_t getEnd(Context& c);
+    virtual size_t lastIndex(Context& c);
+    virtual size_t firstIndex(Context& c);
+    virtual size_t resultSize(Context& c, size_t startIndex, size_t endIndex);
+    virtual UA_StatusCode copyDataValues(Context& c,
+                                         size_t startIndex,
+                                         size_t endIndex,
+                                         UA_Boolean reverse,
+                                         size_t valueSize,
+                                         UA_NumericRange range,
+                                         UA_Boolean releaseContinuationPoints,
+                                         std::string& in,
+                                         std::string& out,
+                                         size_t* providedValues,
+                                         UA_DataValue* values);
+    virtual const UA_DataValue* getDataValue(Context& c, size_t index);
+    virtual UA_Boolean boundSupported(Context& /*c*/) { return UA_TRUE; }
+    virtual UA_Boolean timestampsToReturnSupported(Context& /*c*/, const UA_TimestampsToReturn /*t*/)
+    {
+        return UA_TRUE;
+    }
+    virtual UA_StatusCode insertDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode replaceDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode updateDataValue(Context& c, const UA_DataValue* value);
+    virtual UA_StatusCode removeDataValue(Context& c, UA_DateTime startTimestamp, UA_DateTime endTimestamp);
+};
+
+/*!
+    \brief The TieredMemoryHistorian class
+    The default gathering and database with a tiered retention backend - a bounded replacement for
+    MemoryHistorian that keeps long range history at reduced resolution
+*/
+class UA_EXPORT TieredMemoryHistorian : public Historian
+{
+    TieredHistoryBackend _store;
+
+public:
+    /*!
+        \brief TieredMemoryHistorian
+        \param numberNodes initial size of the gathering table
+        \param tiers retention tiers
+    */
+    TieredMemoryHistorian(size_t numberNodes                             = 100,
+                          const std::vector<TieredHistoryBackend::Tier>& tiers = TieredHistoryBackend::standardTiers());
+    /*!
+        \brief ~TieredMemoryHistorian
+        The backend is owned here, not by the C memory backend
+    */
+    virtual ~TieredMemoryHistorian() { memset(&_backend, 0, sizeof(_backend)); }
+    /*!
+        \brief store
+        \return the backend
+    */
+    TieredHistoryBackend& store() { return _store; }
+};
+
+}  // namespace Open62541
+
+#endif  // TIEREDHISTORIAN_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+#include <open62541cpp/open62541objects.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Open62541 {
+
+/*!
+    \brief The TimerWheel class
+    Hierarchical timer wheel - four levels of 256 slots - driven by one repeated callback calling advance().
+    Adding, cancelling and expiring a timer is O(1) whatever the number of timers. Repeating timers may be
+    grouped by interval: a group is one wheel entry holding a batch of timers that all fire on the same tick,
+    so thousands of timers with the same period cost one wheel entry each period. A timer that joins an
+    existing group first fires with the group - within one interval, not exactly one interval after it was
+    added.
+    Handlers are called with the wheel locked (the lock is recursive) so they may add and cancel timers, and
+    cancel() waits for a running handler to finish. Times are in milliseconds rounded up to whole ticks.
+    Ids have IdFlag set so they can be told apart from C library callback ids
+*/
+class UA_EXPORT TimerWheel
+{
+public:
+    typedef std::function<void(UA_UInt64)> Handler;  // called with the timer id
+    enum : UA_UInt64 { IdFlag = 0x8000000000000000ull };
+    enum { Levels = 4, SlotBits = 8, Slots = 1 << SlotBits };
+
+    static bool isWheelId(UA_UInt64 id) { return (id & IdFlag) != 0; }
+
+private:
+    // intrusive circular list link - a slot head is a node linked to itself
+    struct Node {
+        Node* prev         = this;
+        Node* next         = this;
+        UA_UInt64 expiry   = 0;  // tick
+        bool group         = false;
+        bool empty() const { return next == this; }
+        bool linked() const { return next != this; }
+        void unlink()
+        {
+            prev->next = next;
+            next->prev = prev;
+            prev = next = this;
+        }
+        void append(Node* n)  // n goes before this - at the tail when this is a head
+        {
+            n->prev       = prev;
+            n->next       = this;
+            prev->next    = n;
+            prev          = n;
+        }
+    };
+    struct Group;
+    struct Timer : Node {
+        UA_UInt64 id       = 0;
+        UA_UInt64 interval = 0;  // ticks - zero for one shot
+        Handler func;
+        Group* owner   = nullptr;
+        size_t index   = 0;  // in owner's members
+        bool cancelled = false;
+    };
+    struct Group : Node {
+        UA_UInt64 interval = 0;
+        std::vector<Timer*> members;
+        bool firing = false;
+        Group() { group = true; }
+    };
+    //
+    mutable std::recursive_mutex _mutex;
+    Node _slots[Levels][Slots];
+    std::unordered_map<UA_UInt64, std::unique_ptr<Timer>> _timers;
+    std::unordered_map<UA_UInt64, std::unique_ptr<Group>> _groups;  // keyed on interval in ticks
+    std::vector<UA_UInt64> _dead;                                    // cancelled while handlers were running
+    unsigned _tickMs   = 10;
+    UA_UInt64 _now     = 0;  // last tick processed
+    UA_UInt64 _nextId  = 1;
+    int _firing        = 0;
+    size_t _fired      = 0;
+    size_t _batches    = 0;  // group expiries
+
+    UA_UInt64 ticks(unsigned ms) const { return ms ? (UA_UInt64(ms) + _tickMs - 1) / _tickMs : 1; }
+    UA_UInt64 tickOf(UA_DateTime now) const { return UA_UInt64(now / (UA_DateTime(_tickMs) * UA_DATETIME_MSEC)); }
+    void insert(Node* n);
+    void tick();
+    void cascade(int level);
+    void fire(Timer* t);
+    void fire(Group* g);
+    void join(Timer* t, UA_UInt64 interval, UA_UInt64 delay);
+    void leave(Timer* t);
+    void purge();
+
+public:
+    /*!
+        \brief TimerWheel
+        \param tickMs resolution
+    */
+    TimerWheel(unsigned tickMs = 10);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    virtual ~TimerWheel() { clear(); }
+
+    /*!
+        \brief setTick
+        \param ms resolution - only changed while the wheel is empty
+        \return true if changed
+    */
+    bool setTick(unsigned ms);
+    unsigned tickMs() const { return _tickMs; }
+    /*!
+        \brief mutex
+        Held while handlers run - take it before any lock the handlers take
+        \return wheel lock
+    */
+    std::recursive_mutex& mutex() { return _mutex; }
+
+    /*!
+        \brief add
+        \param delayMs until the first expiry
+        \param intervalMs repeat interval - zero for a one shot timer
+        \param func handler
+        \param grouped batch with the other repeating timers of the same interval
+        \return timer id
+    */
+    UA_UInt64 add(unsigned delayMs, unsigned intervalMs, Handler func, bool grouped = false);
+    /*!
+        \brief cancel
+        \param id
+        \return false if not known
+    */
+    bool cancel(UA_UInt64 id);
+    /*!
+        \brief changeInterval
+        \param id repeating timer
+        \param intervalMs
+        \return false if not known or a one shot
+    */
+    bool changeInterval(UA_UInt64 id, unsigned intervalMs);
+    /*!
+        \brief advance
+        Expire every timer due up to now - call from one repeated callback at the tick interval
+        \param now monotonic time
+        \return number of handlers called
+    */
+    size_t advance(UA_DateTime now);
+    /*!
+        \brief clear
+        Cancel every timer
+    */
+    void clear();
+
+    size_t size() const
+    {
+        std::lock_guard<std::recursive_mutex> l(_mutex);
+        return _timers.size() - _dead.size();
+    }
+    size_t groups() const
+    {
+        std::lock_guard<std::recursive_mutex> l(_mutex);
+        return _groups.size();
+    }
+    size_t fired() const { return _fired; }
+    size_t batches() const { return _batches; }
+};
+
+}  // namespace Open62541
+
+#endif  // TIMERWHEEL_H
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef TRAFFICRECORDER_H
+#define TRAFFICRECORDER_H
+#include <open62541cpp/open62541objects.h>
+#include <chrono>
+#include <cstdio>
+#include <iosfwd>
+#include <mutex>
+
+namespace Open62541 {
+
+class Client;
+class Server;
+
+/*!
+    \brief The TrafficRecorder class
+    Records a client's traffic to a binary file for replay with TrafficReplayer - the requests of the Read,
+    Write, Call, Browse and TranslateBrowsePaths services sent through Client::readAttribute,
+    writeAttribute, readValues, writeValues, browse, callMethod, callMethods and translatePaths, and the data
+    changes its monitored items receive. The file is a header then one record per request or notification:
+
+        Header | Record | body | Record | body | ...
+
+    A request body is the request encoded with UA_encodeBinary; a data change body is the monitored node id
+    then the data value. Records hold the time since recording started, the service latency and the service
+    result. Attach a recorder with Client::setRecorder - with none attached the hooks cost a null test
+*/
+class UA_EXPORT TrafficRecorder
+{
+public:
+    enum { Magic = 0x52544155 /* UATR */, Version = 1 };
+    enum Kind { Read = 1, Write, Call, Browse, Translate, DataChange, KindCount };
+    typedef std::chrono::steady_clock Clock;
+
+    /*!
+        \brief The Header struct
+    */
+    struct Header {
+        UA_UInt32 magic;
+        UA_UInt32 version;
+        UA_DateTime started;  // wall clock time recording started
+    };
+    /*!
+        \brief The Record struct
+        Followed by length bytes of body
+    */
+    struct Record {
+        UA_UInt32 length;  // of the body
+        UA_Byte kind;
+        UA_Byte reserved;
+        UA_UInt16 reserved2;
+        UA_StatusCode status;  // service result - good for data changes
+        UA_UInt32 reserved3;
+        UA_UInt64 timeNs;     // since recording started
+        UA_UInt64 latencyNs;  // of the service - 0 for data changes
+    };
+
+private:
+    std::mutex _mutex;
+    std::FILE* _file = nullptr;
+    Clock::time_point _start;
+    std::vector<UA_Byte> _buffer;  // encoding space - reused
+    size_t _records          = 0;
+    size_t _bytes            = 0;
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    void write(Kind k,
+               Clock::time_point at,
+               UA_UInt64 latencyNs,
+               UA_StatusCode status,
+               const void* a,
+               const UA_DataType* ta,
+               const void* b         = nullptr,
+               const UA_DataType* tb = nullptr);
+
+public:
+    TrafficRecorder() = default;
+    TrafficRecorder(const TrafficRecorder&) = delete;
+    TrafficRecorder& operator=(const TrafficRecorder&) = delete;
+    ~TrafficRecorder() { close(); }
+
+    /*!
+        \brief open
+        Start recording to a new file - a file already open is closed first
+        \param path
+        \return true on success
+    */
+    bool open(const std::string& path);
+    /*!
+        \brief close
+        Flush and close the file
+    */
+    void close();
+    bool isOpen()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _file != nullptr;
+    }
+    size_t records() const { return _records; }
+    size_t bytes() const { return _bytes; }  //!< written, headers included
+    UA_StatusCode lastError() const { return _lastError; }
+
+    /*!
+        \brief request
+        Record a request - a no op if no file is open
+        \param k service
+        \param request the request as sent
+        \param type its type
+        \param start when the request was sent
+        \param status service result
+    */
+    void request(Kind k, const void* request, const UA_DataType* type, Clock::time_point start, UA_StatusCode status);
+    /*!
+        \brief dataChange
+        Record a notification of a monitored item
+        \param node monitored node
+        \param value
+    */
+    void dataChange(const UA_NodeId& node, const UA_DataValue& value);
+
+    static const char* name(Kind k);
+    static Clock::time_point startTime(const TrafficRecorder* r) { return r ? Clock::now() : Clock::time_point(); }
+
+    /*!
+        \brief The Scope class
+        Times a service call and records its request - nothing is done when the recorder is null
+    */
+    class Scope
+    {
+        TrafficRecorder* _r;
+        Kind _kind;
+        const void* _request;
+        const UA_DataType* _type;
+        Clock::time_point _start;
+
+    public:
+        Scope(TrafficRecorder* r, Kind k, const void* request, const UA_DataType* type)
+            : _r(r)
+            , _kind(k)
+            , _request(request)
+            , _type(type)
+        {
+            if (_r)
+                _start = Clock::now();
+        }
+        /*!
+            \brief done
+            \param status service result
+        */
+        void done(UA_StatusCode status)
+        {
+            if (_r) {
+                _r->request(_kind, _request, _type, _start, status);
+                _r = nullptr;
+            }
+        }
+    };
+};
+
+/*!
+    \brief The TrafficReplayer class
+    Replays a file written by TrafficRecorder and compares latencies with those recorded. Against a Client
+    the recorded requests are sent again; against a Server the written values and the recorded data changes
+    are written to its nodes, reproducing the value load its subscribers saw.
+    Records are sent at the recorded times divided by the speed - 1 as recorded, 10 ten times as fast, 0 as
+    fast as they can be sent. Replay runs on the calling thread - the client services are synchronous, a
+    server must be running on another thread
+*/
+class UA_EXPORT TrafficReplayer
+{
+public:
+    /*!
+        \brief The Entry struct
+    */
+    struct Entry {
+        TrafficRecorder::Kind kind = TrafficRecorder::Read;
+        UA_StatusCode status       = UA_STATUSCODE_GOOD;
+        UA_UInt64 timeNs           = 0;
+        UA_UInt64 latencyNs        = 0;
+        std::vector<UA_Byte> body;
+    };
+    /*!
+        \brief The Stats struct
+        Totals of one kind of record
+    */
+    struct Stats {
+        size_t count         = 0;
+        size_t failed        = 0;  // replayed with a bad service result
+        UA_UInt64 recordedNs = 0;
+        UA_UInt64 replayedNs = 0;
+        UA_UInt64 maxNs      = 0;  // longest replay
+        double recordedMeanUs() const { return count ? double(recordedNs) / double(count) / 1000.0 : 0.0; }
+        double replayedMeanUs() const { return count ? double(replayedNs) / double(count) / 1000.0 : 0.0; }
+        double deltaUs() const { return replayedMeanUs() - recordedMeanUs(); }
+    };
+
+private:
+    std::vector<Entry> _entries;
+    Stats _stats[TrafficRecorder::KindCount];
+    double _speed            = 1.0;
+    UA_UInt64 _elapsedNs     = 0;  // of the last replay
+    UA_StatusCode _lastError = UA_STATUSCODE_GOOD;
+
+    void wait(TrafficRecorder::Clock::time_point start, const Entry& e) const;
+    void add(const Entry& e, UA_UInt64 ns, UA_StatusCode status);
+    UA_StatusCode send(Client& c, const Entry& e, UA_UInt64& ns);
+
+public:
+    /*!
+        \brief load
+        Read a recording - replaces the one loaded
+        \param path
+        \return true on success
+    */
+    bool load(const std::string& path);
+    const std::vector<Entry>& entries() const { return _entries; }
+    /*!
+        \brief setSpeed
+        \param s multiple of the recorded rate - 0 for no waits
+    */
+    void setSpeed(double s) { _speed = (s > 0.0) ? s : 0.0; }
+    double speed() const { return _speed; }
+
+    /*!
+        \brief replay
+        Send the recorded requests - data changes are skipped, the server makes them
+        \param client connected client
+        \return true if every request got the service result recorded for it
+    */
+    bool replay(Client& client);
+    /*!
+        \brief replay
+        Write the recorded values to the server's nodes - each Write request and data change is one write of
+        its values; other requests are skipped
+        \param server running server
+        \return true if every write succeeded
+    */
+    bool replay(Server& server);
+
+    const Stats& stats(TrafficRecorder::Kind k) const { return _stats[k]; }
+    UA_UInt64 elapsedNs() const { return _elapsedNs; }
+    UA_StatusCode lastError() const { return _lastError; }
+    /*!
+        \brief report
+        \param os one line per kind replayed - count, failures, recorded and replayed mean latency and the delta
+    */
+    void report(std::ostream& os) const;
+};
+
+}  // namespace Open62541
+
+#endif  // TRAFFICRECORDER_H
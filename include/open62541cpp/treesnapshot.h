@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef TREESNAPSHOT_H
+#define TREESNAPSHOT_H
+#include <open62541cpp/open62541objects.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+
+namespace Open62541 {
+
+/*!
+    \brief The TreeSnapshot class
+    Compact binary image of a PropertyTree whose values are UA types - e.g. a UANodeTree. The file is a
+    header, one record per node in depth first order and a path hash index sorted by hash:
+
+        Header | Record (root) | Record | ... | IndexEntry[count]
+
+    A record holds the node's full path as length prefixed segments and its value encoded with
+    UA_encodeBinary. Records are 8 byte aligned and each holds the length of its subtree, so the next
+    sibling of a node is found without visiting its descendants.
+    Writing takes each branch's lock shared in turn; the image is built in memory and written in one go.
+    A saved image is opened with TreeSnapshotView, which maps the file and answers lookups from the
+    index without decoding the rest of the tree, or loaded back into a tree with load()
+*/
+class UA_EXPORT TreeSnapshot
+{
+public:
+    enum { Magic = 0x504e5354 /* TSNP */, Version = 1 };
+    /*!
+        \brief The Header struct
+    */
+    struct Header {
+        UA_UInt32 magic;
+        UA_UInt32 version;
+        UA_UInt64 count;        // records
+        UA_UInt64 indexOffset;  // of the IndexEntry array
+        UA_UInt32 typeId;       // numeric ns0 type id of the values
+        UA_UInt32 reserved;
+    };
+    /*!
+        \brief The Record struct
+        Followed by the path - a UA_UInt16 length and the bytes of each segment - then the value
+    */
+    struct Record {
+        UA_UInt32 length;       // of this record, padded to 8 bytes
+        UA_UInt32 valueLength;  // bytes of the encoded value
+        UA_UInt64 subtree;      // bytes of this record and its descendants
+        UA_UInt16 depth;        // path segments - 0 for the root
+        UA_UInt16 reserved;
+        UA_UInt32 pathLength;   // bytes of the path
+    };
+    /*!
+        \brief The IndexEntry struct
+    */
+    struct IndexEntry {
+        UA_UInt64 hash;    // pathHash of the record's path
+        UA_UInt64 offset;  // of the record from the start of the file
+    };
+
+private:
+    std::vector<UA_Byte> _image;
+    std::vector<IndexEntry> _index;
+    const UA_DataType* _type = nullptr;
+    bool _ok                 = true;
+
+    size_t beginRecord(const UAPath& path, const void* value);
+    void endRecord(size_t offset);
+
+    template <typename N>
+    void add(N* n, UAPath& path)
+    {
+        size_t r = beginRecord(path, n->data().constRef());
+        for (auto i = n->children().begin(); i != n->children().end(); i++) {
+            if (i->second) {
+                path.push_back(i->first);
+                add(i->second, path);
+                path.pop_back();
+            }
+        }
+        endRecord(r);
+    }
+
+public:
+    /*!
+        \brief pathHash
+        FNV-1a of the path segments - stable between runs and builds
+        \param path
+        \return
+    */
+    static UA_UInt64 pathHash(const UAPath& path);
+    static UA_UInt64 pathHash(const char* p, size_t n, size_t depth);  // of an encoded path
+
+    /*!
+        \brief TreeSnapshot
+        \param type type of the tree's values
+    */
+    explicit TreeSnapshot(const UA_DataType* type = &UA_TYPES[UA_TYPES_NODEID])
+        : _type(type)
+    {
+    }
+
+    /*!
+        \brief build
+        Build the image of a tree - values must be TypeBase wrappers of type
+        \param tree
+        \return false if a value could not be encoded
+    */
+    template <typename T, typename S>
+    bool build(PropertyTree<std::string, T, S>& tree)
+    {
+        typedef typename PropertyTree<std::string, T, S>::PropertyNode PropertyNode;
+        clear();
+        UAPath path;
+        ReadLock l(tree.mutex());
+        PropertyNode& root = tree.root();
+        size_t r           = beginRecord(path, root.data().constRef());
+        for (auto i = root.children().begin(); i != root.children().end(); i++) {
+            if (i->second) {
+                ReadLock b(tree.branchMutex(i->first));
+                path.push_back(i->first);
+                add(i->second, path);
+                path.pop_back();
+            }
+        }
+        endRecord(r);
+        return finish();
+    }
+
+    /*!
+        \brief save
+        Build the image of a tree and write it to a file
+        \param file
+        \param tree
+        \return false on an encoding or file error
+    */
+    template <typename T, typename S>
+    bool save(const std::string& file, PropertyTree<std::string, T, S>& tree)
+    {
+        return build(tree) && write(file);
+    }
+
+    /*!
+        \brief load
+        Replace a tree with the image in a file - see also TreeSnapshotView
+        \param file
+        \param tree
+        \param type type of the values
+        \return false if the file is not a valid image of that type
+    */
+    template <typename T, typename S>
+    static bool load(const std::string& file,
+                     PropertyTree<std::string, T, S>& tree,
+                     const UA_DataType* type = &UA_TYPES[UA_TYPES_NODEID]);
+
+    void clear();
+    bool finish();
+    /*!
+        \brief write
+        \param file
+        \return false if the image could not be written
+    */
+    bool write(const std::string& file) const;
+    /*!
+        \brief image
+        \return the built image
+    */
+    const std::vector<UA_Byte>& image() const { return _image; }
+};
+
+/*!
+    \brief The TreeSnapshotView class
+    Read only view of a snapshot file - the file is memory mapped and lookups go through its hash
+    index, so only the records asked for are ever decoded. Safe to share between threads once open
+*/
+class UA_EXPORT TreeSnapshotView
+{
+    boost::interprocess::file_mapping _file;
+    boost::interprocess::mapped_region _region;
+    const UA_Byte* _data                   = nullptr;
+    size_t _size                           = 0;
+    const TreeSnapshot::Header* _header    = nullptr;
+    const TreeSnapshot::IndexEntry* _index = nullptr;
+    const UA_DataType* _type               = nullptr;
+
+    bool samePath(const TreeSnapshot::Record* r, const UAPath& path) const;
+    bool valid(UA_UInt64 offset) const;
+
+public:
+    TreeSnapshotView() {}
+    TreeSnapshotView(const TreeSnapshotView&) = delete;
+    TreeSnapshotView& operator=(const TreeSnapshotView&) = delete;
+    ~TreeSnapshotView() { close(); }
+
+    /*!
+        \brief open
+        Map a snapshot and check its header and index
+        \param file
+        \return false if the file is not a valid snapshot
+    */
+    bool open(const std::string& file);
+    /*!
+        \brief open
+        View an image held in memory - e.g. TreeSnapshot::image() - that must outlive the view
+        \param data
+        \param size
+        \return false if it is not a valid snapshot
+    */
+    bool open(const UA_Byte* data, size_t size);
+    void close();
+    bool isOpen() const { return _header != nullptr; }
+    /*!
+        \brief size
+        \return nodes in the snapshot
+    */
+    size_t size() const { return _header ? size_t(_header->count) : 0; }
+    /*!
+        \brief type
+        \return type of the values or nullptr if not a built in ns0 type
+    */
+    const UA_DataType* type() const { return _type; }
+
+    /*!
+        \brief find
+        \param path empty for the root
+        \return the record or nullptr
+    */
+    const TreeSnapshot::Record* find(const UAPath& path) const;
+    bool exists(const UAPath& path) const { return find(path) != nullptr; }
+    /*!
+        \brief decode
+        \param r record
+        \param v set to the record's value - initialised memory of type()
+        \return true on success
+    */
+    bool decode(const TreeSnapshot::Record* r, void* v) const;
+    /*!
+        \brief get
+        \param path
+        \param v value wrapper of type() - e.g. NodeId
+        \return false if there is no such node or it could not be decoded
+    */
+    template <typename T>
+    bool get(const UAPath& path, T& v) const
+    {
+        const TreeSnapshot::Record* r = find(path);
+        if (!r)
+            return false;
+        v.null();
+        return decode(r, v.ref());
+    }
+    /*!
+        \brief path
+        \param r
+        \param p set to the record's path
+    */
+    void path(const TreeSnapshot::Record* r, UAPath& p) const;
+    /*!
+        \brief children
+        \param path
+        \param names set to the names of the node's children in order
+        \return false if there is no such node
+    */
+    bool children(const UAPath& path, std::vector<std::string>& names) const;
+    /*!
+        \brief first
+        \return the root record - the rest follow in depth first order
+    */
+    const TreeSnapshot::Record* first() const;
+    /*!
+        \brief next
+        \param r
+        \return the record after r in depth first order or nullptr at the end
+    */
+    const TreeSnapshot::Record* next(const TreeSnapshot::Record* r) const;
+    /*!
+        \brief nextSibling
+        \param r
+        \return the record after r's subtree or nullptr at the end
+    */
+    const TreeSnapshot::Record* nextSibling(const TreeSnapshot::Record* r) const;
+};
+
+/*!
+    \brief TreeSnapshot::load
+*/
+template <typename T, typename S>
+bool TreeSnapshot::load(const std::string& file, PropertyTree<std::string, T, S>& tree, const UA_DataType* type)
+{
+    TreeSnapshotView v;
+    if (!v.open(file) || (v.type() != type))
+        return false;
+    tree.clear();
+    UAPath p;
+    for (const Record* r = v.first(); r; r = v.next(r)) {
+        T d;
+        d.null();
+        if (!v.decode(r, d.ref()))
+            return false;
+        v.path(r, p);
+        if (p.empty())
+            tree.root().setData(d);
+        else
+            tree.set(p, d);
+    }
+    return true;
+}
+
+}  // namespace Open62541
+
+#endif  // TREESNAPSHOT_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include <open62541cpp/open62541objects.h>
+#include <open62541cpp/threadconfig.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace Open62541 {
+
+/*!
+    \brief The WorkerPool class
+    Fixed set of threads running posted jobs. Jobs are queued in priority lanes, FIFO within a lane. Workers
+    take from the highest lane that has jobs and credit left; each lane gets its weight in credits per round so
+    lower lanes are slowed, not starved. A lane can be capped to fewer threads than the pool so long running bulk
+    jobs always leave a thread for control work. Jobs run without any server lock held.
+*/
+class UA_EXPORT WorkerPool
+{
+public:
+    typedef std::function<void()> Job;
+
+    /*!
+        \brief The Lane enum
+        Priority classes - highest first
+    */
+    enum Lane {
+        Control = 0,  //!< operator commands and control writes
+        Interactive,  //!< HMI reads and general work - the default
+        Bulk,         //!< history exports, mass browse and other long jobs
+        LaneCount
+    };
+
+private:
+    struct LaneState {
+        std::deque<Job> jobs;
+        unsigned weight   = 1;  // jobs per round
+        unsigned credit   = 1;
+        size_t maxThreads = 0;  // 0 for no cap
+        size_t busy       = 0;
+    };
+    std::vector<std::thread> _threads;
+    ThreadConfig _threadConfig;
+    LaneState _lanes[LaneCount];
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _running = false;
+
+    void worker();
+    int next();  // lane to take from or -1 - called with the mutex held
+    bool runnable(size_t i) const
+    {
+        const LaneState& l = _lanes[i];
+        return !l.jobs.empty() && (!l.maxThreads || (l.busy < l.maxThreads));
+    }
+
+public:
+    WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool() { stop(); }
+
+    /*!
+        \brief setThreadConfig
+        Name, affinity, priority and NUMA placement of the pool threads - takes effect on the next start
+        \param c
+    */
+    void setThreadConfig(const ThreadConfig& c) { _threadConfig = c; }
+    const ThreadConfig& threadConfig() const { return _threadConfig; }
+
+    /*!
+        \brief start
+        \param n number of threads
+        \return true on success
+    */
+    bool start(size_t n);
+
+    /*!
+        \brief stop
+        Runs the jobs already queued then joins the threads
+    */
+    void stop();
+
+    /*!
+        \brief setLane
+        \param lane
+        \param weight jobs taken from the lane per round while lower lanes wait - at least 1
+        \param maxThreads most threads running the lane's jobs at once - 0 for no cap
+    */
+    void setLane(Lane lane, unsigned weight, size_t maxThreads = 0);
+
+    /*!
+        \brief post
+        \param job
+        \param lane priority class
+        \return false if the pool is not running - the job is not queued
+    */
+    bool post(Job job, Lane lane = Interactive);
+
+    /*!
+        \brief running
+        \return true if the pool is accepting jobs
+    */
+    bool running() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _running;
+    }
+
+    /*!
+        \brief size
+        \return number of threads
+    */
+    size_t size() const { return _threads.size(); }
+
+    /*!
+        \brief pending
+        \return number of queued jobs not yet started
+    */
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        size_t n = 0;
+        for (const auto& i : _lanes)
+            n += i.jobs.size();
+        return n;
+    }
+    /*!
+        \brief pending
+        \param lane
+        \return number of jobs queued in the lane
+    */
+    size_t pending(Lane lane) const
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _lanes[lane].jobs.size();
+    }
+};
+
+}  // namespace Open62541
+
+#endif  // WORKERPOOL_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#ifndef WRITEFILTER_H
+#define WRITEFILTER_H
+#include <open62541cpp/open62541objects.h>
+#include <atomic>
+#include <mutex>
+
+namespace Open62541 {
+
+/*!
+    \brief The WriteFilter class
+    Write only on change. Remembers the last value written to each filtered node so an identical write - or one
+    within the node's deadband for Float and Double values - can be dropped before it reaches the stack.
+    Numbers compare bitwise, other fixed size types member by member, strings by content; other types always pass.
+    The remembered value is only what was written through the filter: writes from clients or by other paths
+    are not seen, so forget() a node whenever it may have been changed elsewhere
+*/
+class UA_EXPORT WriteFilter
+{
+    struct Entry {
+        bool rule       = false;  // node has its own setting
+        bool on         = false;
+        double deadband = 0.0;
+        bool known      = false;  // last holds a value
+        Variant last;
+    };
+    mutable std::mutex _mutex;
+    UnorderedNodeIdMap<Entry> _entries;
+    bool _defaultOn     = false;
+    double _defaultBand = 0.0;
+    size_t _rulesOn     = 0;  // entries with their own setting switched on
+    std::atomic<bool> _enabled{false};  // any rule or default on - the fast path when unused
+    std::atomic<size_t> _skipped{0};
+    std::atomic<size_t> _passed{0};
+
+    void update();
+
+public:
+    WriteFilter() {}
+    WriteFilter(const WriteFilter&) = delete;
+    WriteFilter& operator=(const WriteFilter&) = delete;
+
+    /*!
+        \brief setDefault
+        Server wide setting for nodes without their own - switching it off drops their remembered values
+        \param on
+        \param deadband absolute - applies to Float and Double values
+    */
+    void setDefault(bool on, double deadband = 0.0);
+    /*!
+        \brief setNode
+        \param node
+        \param on false to always write this node even with the default on - drops its remembered value
+        \param deadband absolute - applies to Float and Double values
+    */
+    void setNode(const UA_NodeId& node, bool on, double deadband = 0.0);
+    /*!
+        \brief clearNode
+        Remove a node's setting and remembered value
+        \param node
+    */
+    void clearNode(const UA_NodeId& node);
+    /*!
+        \brief clearNodes
+        clearNode for a batch of nodes under one lock
+        \param nodes
+    */
+    void clearNodes(const std::vector<UA_NodeId>& nodes);
+    /*!
+        \brief forget
+        Drop the remembered value so the next write always goes through
+        \param node
+    */
+    void forget(const UA_NodeId& node);
+    /*!
+        \brief clear
+        Remove all settings and values
+    */
+    void clear();
+    /*!
+        \brief enabled
+        \return true if any node may be filtered
+    */
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+    /*!
+        \brief changed
+        \param node
+        \param value about to be written - remembered if the write should go ahead
+        \return true to write, false to skip
+    */
+    bool changed(const UA_NodeId& node, const UA_Variant& value);
+    /*!
+        \brief same
+        \param a
+        \param b
+        \param deadband
+        \return true if b would not change a
+    */
+    static bool same(const UA_Variant& a, const UA_Variant& b, double deadband = 0.0);
+    size_t skipped() const { return _skipped; }
+    size_t passed() const { return _passed; }
+};
+
+}  // namespace Open62541
+
+#endif  // WRITEFILTER_H
@@ -21,6 +21,8 @@ set(CMAKE_CXX_STANDARD_REQUIRED ON)
 set(CMAKE_CXX_EXTENSIONS OFF)
 SET(CMAKE_C_FLAGS "-march=armv8-a -mtune=cortex-a53 -mfpu=crypto-neon-fp-armv8 ${CMAKE_C_FLAGS}")
 SET(CMAKE_CXX_FLAGS "-march=armv8-a -mtune=cortex-a53 -mfpu=crypto-neon-fp-armv8 ${CMAKE_CXX_FLAGS}")
+#
+# Single threaded gateways can drop the locks - add -DUA_CPP_LOCK_POLICY=NONE to the cmake command line
 
 # Define the sysroot path for the RaspberryPi distribution in our tools folder
 SET(CMAKE_SYSROOT ${PIROOT}) 
@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/alarmfilter.h>
+#include <open62541cpp/open62541server.h>
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+
+/*!
+    \brief Open62541::AlarmFloodFilter::AlarmFloodFilter
+    \param s
+*/
+Open62541::AlarmFloodFilter::AlarmFloodFilter(Server& s)
+    : _server(s)
+    , _timer(s, [this](ServerTimedCallback&) { tick(); })
+{
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::~AlarmFloodFilter
+*/
+Open62541::AlarmFloodFilter::~AlarmFloodFilter()
+{
+    if (_server.alarmFilter() == this)
+        _server.setAlarmFilter(nullptr);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::conditionLimits
+    \param condition
+    \param source
+    \return the limits that apply to a condition's deadband
+*/
+const Open62541::AlarmFloodFilter::Limits& Open62541::AlarmFloodFilter::conditionLimits(const UA_NodeId& condition,
+                                                                                         const UA_NodeId& source) const
+{
+    auto i = _conditionLimits.find(condition);
+    return (i != _conditionLimits.end()) ? i->second : sourceLimits(source);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::sourceLimits
+    \param source
+    \return the limits that apply to a source's flood window
+*/
+const Open62541::AlarmFloodFilter::Limits& Open62541::AlarmFloodFilter::sourceLimits(const UA_NodeId& source) const
+{
+    auto i = _sourceLimits.find(source);
+    return (i != _sourceLimits.end()) ? i->second : _defaults;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::isShelved
+    \param n
+    \param now
+    \return true if shelved - expired shelving is removed
+*/
+bool Open62541::AlarmFloodFilter::isShelved(const UA_NodeId& n, UA_DateTime now)
+{
+    auto i = _shelved.find(n);
+    if (i == _shelved.end())
+        return false;
+    if (i->second && (now >= i->second)) {
+        _shelved.remove(n);
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::decide
+    \param condition
+    \param source
+    \param now monotonic time
+    \param release a held event whose deadband has ended - or is being flushed
+    \param summaries flood windows closed by this event
+    \return the decision
+*/
+Open62541::AlarmFloodFilter::Decision Open62541::AlarmFloodFilter::decide(const UA_NodeId& condition,
+                                                                          const UA_NodeId& source,
+                                                                          UA_DateTime now,
+                                                                          bool release,
+                                                                          std::vector<Summary>& summaries)
+{
+    ConditionState* cs = _conditions.value(condition);
+    if (!cs)
+        cs = &_conditions.put(condition);
+    //
+    if (isShelved(condition, now) || isShelved(source, now)) {
+        cs->due = 0;
+        _pending.remove(condition);
+        _statistics.shelved++;
+        return Shelved;
+    }
+    //
+    const Limits& lc = conditionLimits(condition, source);
+    if (!release && lc.deadband && cs->lastEmit) {
+        const UA_DateTime end = cs->lastEmit + UA_DateTime(lc.deadband) * UA_DATETIME_MSEC;
+        if (now < end) {
+            _statistics.held++;
+            if (lc.trailing) {
+                cs->due = end;
+                _pending.put(condition);
+                arm(end);
+            }
+            return Held;
+        }
+    }
+    //
+    const Limits& ls = sourceLimits(source);
+    if (ls.floodCount) {
+        SourceState* ss = _sources.value(source);
+        if (!ss)
+            ss = &_sources.put(source);
+        const UA_DateTime w = UA_DateTime(ls.floodWindow ? ls.floodWindow : 1) * UA_DATETIME_MSEC;
+        if ((now - ss->windowStart) >= w) {
+            closeWindow(source, *ss, summaries);
+            ss->windowStart = now;
+            ss->window++;
+            ss->count = 0;
+        }
+        if (++ss->count > ls.floodCount) {
+            if (!ss->suppressed++)
+                arm(ss->windowStart + w);  // the summary goes out when the window closes
+            if (cs->window != ss->window) {
+                cs->window = ss->window;
+                ss->conditions++;
+            }
+            cs->due = 0;
+            _pending.remove(condition);
+            _statistics.suppressed++;
+            return Suppressed;
+        }
+    }
+    //
+    cs->lastEmit = now;
+    cs->due      = 0;
+    _pending.remove(condition);
+    if (release)
+        _statistics.released++;
+    else
+        _statistics.emitted++;
+    return Emit;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::closeWindow
+    \param source
+    \param s
+    \param summaries
+*/
+void Open62541::AlarmFloodFilter::closeWindow(const UA_NodeId& source, SourceState& s, std::vector<Summary>& summaries)
+{
+    if (s.suppressed) {
+        Summary m;
+        m.source     = source;
+        m.suppressed = s.suppressed;
+        m.conditions = s.conditions;
+        summaries.push_back(m);
+        _statistics.summaries++;
+    }
+    s.suppressed = 0;
+    s.conditions = 0;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::nextDeadline
+    \return the earliest held event or flood window end - zero if none
+*/
+UA_DateTime Open62541::AlarmFloodFilter::nextDeadline() const
+{
+    UA_DateTime d = 0;
+    for (const UA_NodeId& n : _pending) {
+        auto i = _conditions.find(n);
+        if ((i != _conditions.end()) && i->second.due && (!d || (i->second.due < d)))
+            d = i->second.due;
+    }
+    for (auto i = _sources.begin(); i != _sources.end(); i++) {
+        if (i->second.suppressed) {
+            const Limits& l     = sourceLimits(i->first);
+            const UA_DateTime e = i->second.windowStart +
+                                  UA_DateTime(l.floodWindow ? l.floodWindow : 1) * UA_DATETIME_MSEC;
+            if (!d || (e < d))
+                d = e;
+        }
+    }
+    return d;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::arm
+    Record a deadline unless an earlier one is set. The timer takes the server mutex, so it is moved by
+    applyArm once the filter is unlocked
+    \param due
+*/
+void Open62541::AlarmFloodFilter::arm(UA_DateTime due)
+{
+    if (_armed && (_armed <= due))
+        return;
+    _armed = due;
+    _rearm = true;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::applyArm
+*/
+void Open62541::AlarmFloodFilter::applyArm()
+{
+    std::lock_guard<std::mutex> a(_armMutex);
+    UA_DateTime due = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (!_rearm)
+            return;
+        _rearm = false;
+        due    = _armed;
+    }
+    _timer.stop();
+    _timer.setInterval(due);
+    _timer.start();
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::tick
+    Release the held events that are due and close the flood windows that have ended
+*/
+void Open62541::AlarmFloodFilter::tick()
+{
+    std::vector<NodeId> release;
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _armed                = 0;
+        const UA_DateTime now = UA_DateTime_nowMonotonic();
+        for (const UA_NodeId& n : _pending) {
+            ConditionState* cs = _conditions.value(n);
+            if (cs && cs->due && (cs->due <= now)) {
+                cs->due = 0;
+                release.push_back(NodeId(n));
+            }
+        }
+        for (auto i = _sources.begin(); i != _sources.end(); i++) {
+            if (i->second.suppressed) {
+                const Limits& ls    = sourceLimits(i->first);
+                const UA_DateTime w = UA_DateTime(ls.floodWindow ? ls.floodWindow : 1) * UA_DATETIME_MSEC;
+                if ((now - i->second.windowStart) >= w)
+                    closeWindow(i->first, i->second, summaries);
+            }
+        }
+        const UA_DateTime d = nextDeadline();
+        if (d)
+            arm(d);
+    }
+    fire(release, summaries);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::fire
+    Emit released events and flood summaries - called without the filter locked
+    \param release conditions whose held event is to be emitted
+    \param summaries
+*/
+void Open62541::AlarmFloodFilter::fire(const std::vector<NodeId>& release, std::vector<Summary>& summaries)
+{
+    for (const NodeId& n : release) {
+        ConditionPtr c = _server.conditions().find(n);
+        if (!c)
+            continue;  // deleted while held
+        Decision d = Held;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            d = decide(n, c->conditionSource(), UA_DateTime_nowMonotonic(), true, summaries);
+        }
+        if (d == Emit)
+            UA_Server_triggerConditionEvent(_server.server(), c->condition(), c->conditionSource(), nullptr);
+    }
+    for (const Summary& m : summaries) {
+        floodSummary(m.source, m.suppressed, m.conditions);
+    }
+    applyArm();
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::setDefaultLimits
+    \param l
+*/
+void Open62541::AlarmFloodFilter::setDefaultLimits(const Limits& l)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _defaults = l;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::setSourceLimits
+    \param source
+    \param l
+*/
+void Open62541::AlarmFloodFilter::setSourceLimits(const UA_NodeId& source, const Limits& l)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _sourceLimits.put(source, l);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::setConditionLimits
+    \param condition
+    \param l
+*/
+void Open62541::AlarmFloodFilter::setConditionLimits(const UA_NodeId& condition, const Limits& l)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _conditionLimits.put(condition, l);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::clearLimits
+    \param n
+*/
+void Open62541::AlarmFloodFilter::clearLimits(const UA_NodeId& n)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _conditionLimits.remove(n);
+    _sourceLimits.remove(n);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::shelve
+    \param n
+    \param ms
+*/
+void Open62541::AlarmFloodFilter::shelve(const UA_NodeId& n, unsigned ms)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _shelved.put(n, ms ? (UA_DateTime_nowMonotonic() + UA_DateTime(ms) * UA_DATETIME_MSEC) : 0);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::unshelve
+    \param n
+*/
+void Open62541::AlarmFloodFilter::unshelve(const UA_NodeId& n)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _shelved.remove(n);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::shelved
+    \param n
+    \return
+*/
+bool Open62541::AlarmFloodFilter::shelved(const UA_NodeId& n)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    return isShelved(n, UA_DateTime_nowMonotonic());
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::admit
+    \param c
+    \return
+*/
+Open62541::AlarmFloodFilter::Decision Open62541::AlarmFloodFilter::admit(Condition& c)
+{
+    std::vector<Summary> summaries;
+    Decision d = Emit;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        d = decide(c.condition(), c.conditionSource(), UA_DateTime_nowMonotonic(), false, summaries);
+    }
+    applyArm();
+    for (const Summary& m : summaries) {
+        floodSummary(m.source, m.suppressed, m.conditions);
+    }
+    return d;
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::forget
+    \param condition
+*/
+void Open62541::AlarmFloodFilter::forget(const UA_NodeId& condition)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _pending.remove(condition);
+    _conditions.remove(condition);
+    _conditionLimits.remove(condition);
+    _shelved.remove(condition);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::flush
+*/
+void Open62541::AlarmFloodFilter::flush()
+{
+    std::vector<NodeId> release;
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        for (const UA_NodeId& n : _pending) {
+            ConditionState* cs = _conditions.value(n);
+            if (cs && cs->due) {
+                cs->due = 0;
+                release.push_back(NodeId(n));
+            }
+        }
+        for (auto i = _sources.begin(); i != _sources.end(); i++) {
+            closeWindow(i->first, i->second, summaries);
+            i->second.windowStart = 0;  // the next event opens a new window
+        }
+    }
+    fire(release, summaries);
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::reset
+*/
+void Open62541::AlarmFloodFilter::reset()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _pending.clearAll();
+    _conditions.clearAll();
+    _sources.clearAll();
+    _statistics = Statistics();
+}
+
+/*!
+    \brief Open62541::AlarmFloodFilter::floodSummary
+    \param source
+    \param suppressed
+    \param conditions
+*/
+void Open62541::AlarmFloodFilter::floodSummary(const NodeId& source, size_t suppressed, size_t conditions)
+{
+    const std::string msg = "Alarm flood: " + std::to_string(suppressed) + " events from " +
+                            std::to_string(conditions) + " conditions suppressed";
+    NodeId id;
+    if (_server.setUpEvent(id, NodeId::BaseEventType, msg, toString(source), _summarySeverity)) {
+        _server.triggerEvent(id, source);
+    }
+}
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/arena.h>
+#include <algorithm>
+
+// innermost scoped arena for each thread
+static thread_local Open62541::Arena* _currentArena = nullptr;
+
+/*!
+    \brief alignedOffset
+    \param base start of block
+    \param used bytes already used
+    \param align required alignment
+    \return offset of the next aligned address
+*/
+static inline size_t alignedOffset(const char* base, size_t used, size_t align)
+{
+    uintptr_t a = (reinterpret_cast<uintptr_t>(base) + used + align - 1) & ~(uintptr_t(align) - 1);
+    return size_t(a - reinterpret_cast<uintptr_t>(base));
+}
+
+/*!
+    \brief Open62541::Arena::allocate
+    \param n
+    \param align
+    \return pointer to memory
+*/
+void* Open62541::Arena::allocate(size_t n, size_t align)
+{
+    if (n == 0)
+        n = 1;
+    while (_current < _blocks.size()) {
+        Block& b      = _blocks[_current];
+        size_t offset = alignedOffset(b.data.get(), b.used, align);
+        if ((offset + n) <= b.size) {
+            b.used = offset + n;
+            return b.data.get() + offset;
+        }
+        if ((_current + 1) == _blocks.size())
+            break;
+        _current++;  // blocks after the current one are always empty
+    }
+    //
+    // need a new block - oversized requests get a block of their own
+    Block b;
+    b.size = std::max(_blockSize, n + align);
+    b.data.reset(new char[b.size]);
+    size_t offset = alignedOffset(b.data.get(), 0, align);
+    b.used        = offset + n;
+    void* p = b.data.get() + offset;
+    _blocks.push_back(std::move(b));
+    _current = _blocks.size() - 1;
+    return p;
+}
+
+/*!
+    \brief Open62541::Arena::rewind
+    \param m
+*/
+void Open62541::Arena::rewind(const Mark& m)
+{
+    // clear the UA structures in reverse order of creation
+    while (_cleanup.size() > m.cleanup) {
+        Cleanup& c = _cleanup.back();
+        char* p    = static_cast<char*>(c.p);
+        for (size_t i = 0; i < c.count; i++, p += c.type->memSize) {
+            UA_clear(p, c.type);
+        }
+        _cleanup.pop_back();
+    }
+    //
+    if (_blocks.empty())
+        return;
+    for (size_t i = m.block + 1; i < _blocks.size(); i++) {
+        _blocks[i].used = 0;
+    }
+    if (m.block < _blocks.size()) {
+        _blocks[m.block].used = m.used;
+        _current              = m.block;
+    }
+}
+
+/*!
+    \brief Open62541::Arena::used
+    \return
+*/
+size_t Open62541::Arena::used() const
+{
+    size_t n = 0;
+    for (const Block& b : _blocks)
+        n += b.used;
+    return n;
+}
+
+/*!
+    \brief Open62541::Arena::capacity
+    \return
+*/
+size_t Open62541::Arena::capacity() const
+{
+    size_t n = 0;
+    for (const Block& b : _blocks)
+        n += b.size;
+    return n;
+}
+
+/*!
+    \brief Open62541::Arena::threadArena
+    \return
+*/
+Open62541::Arena& Open62541::Arena::threadArena()
+{
+    static thread_local Arena a;
+    return a;
+}
+
+/*!
+    \brief Open62541::Arena::current
+    \return
+*/
+Open62541::Arena* Open62541::Arena::current()
+{
+    return _currentArena;
+}
+
+/*!
+    \brief Open62541::Arena::setCurrent
+    \param a
+*/
+void Open62541::Arena::setCurrent(Arena* a)
+{
+    _currentArena = a;
+}
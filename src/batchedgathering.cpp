@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/batchedgathering.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <chrono>
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::BatchedHistoryGathering
+    \param initialNodeIdStoreSize
+    \param capacity
+    \param policy
+*/
+Open62541::BatchedHistoryGathering::BatchedHistoryGathering(size_t initialNodeIdStoreSize,
+                                                            size_t capacity,
+                                                            OverflowPolicy policy)
+    : _default(UA_HistoryDataGathering_Default(initialNodeIdStoreSize))
+    , _queue(capacity)
+    , _policy(policy)
+{
+    initialise();
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::~BatchedHistoryGathering
+*/
+Open62541::BatchedHistoryGathering::~BatchedHistoryGathering() { deleteMembers(); }
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::deleteMembers
+    Called by the server when its history database is cleared
+*/
+void Open62541::BatchedHistoryGathering::deleteMembers()
+{
+    stop(false);  // the server is going so queued samples have nowhere to go
+    if (_default.context && _default.deleteMembers) {
+        _default.deleteMembers(&_default);
+    }
+    _default.context = nullptr;
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::registerNodeId
+    \return status
+*/
+UA_StatusCode Open62541::BatchedHistoryGathering::registerNodeId(Context& c, const UA_HistorizingNodeIdSettings setting)
+{
+    if (!_default.context)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    return _default.registerNodeId(c.server.server(), _default.context, c.nodeId.constRef(), setting);
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::stopPoll
+    \return status
+*/
+UA_StatusCode Open62541::BatchedHistoryGathering::stopPoll(Context& c)
+{
+    if (!_default.context)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    return _default.stopPoll(c.server.server(), _default.context, c.nodeId.constRef());
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::startPoll
+    \return status
+*/
+UA_StatusCode Open62541::BatchedHistoryGathering::startPoll(Context& c)
+{
+    if (!_default.context)
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    return _default.startPoll(c.server.server(), _default.context, c.nodeId.constRef());
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::updateNodeIdSetting
+    \return true if updated
+*/
+UA_Boolean Open62541::BatchedHistoryGathering::updateNodeIdSetting(Context& c,
+                                                                  const UA_HistorizingNodeIdSettings setting)
+{
+    if (!_default.context)
+        return UA_FALSE;
+    return _default.updateNodeIdSetting(c.server.server(), _default.context, c.nodeId.constRef(), setting);
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::getHistorizingSetting
+    \return settings or nullptr
+*/
+const UA_HistorizingNodeIdSettings* Open62541::BatchedHistoryGathering::getHistorizingSetting(Context& c)
+{
+    if (!_default.context)
+        return nullptr;
+    return _default.getHistorizingSetting(c.server.server(), _default.context, c.nodeId.constRef());
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::setValue
+    Queue the sample - when the ring is full the writer either drops it, waits for the flush thread or,
+    with no flush thread, writes a batch itself
+    \param c
+    \param historizing
+    \param value
+*/
+void Open62541::BatchedHistoryGathering::setValue(Context& c, UA_Boolean historizing, const UA_DataValue* value)
+{
+    if (!value || !_default.context)
+        return;
+    UA_Server* server                       = c.server.server();
+    const UA_HistorizingNodeIdSettings* set = _default.getHistorizingSetting(server, _default.context, c.nodeId.constRef());
+    if (!set || (set->historizingUpdateStrategy != UA_HISTORIZINGUPDATESTRATEGY_VALUESET) ||
+        !set->historizingBackend.serverSetHistoryData)
+        return;
+    //
+    Sample e;
+    e.server      = server;
+    e.backend     = set->historizingBackend;
+    e.historizing = historizing;
+    UA_NodeId_copy(c.nodeId.constRef(), &e.nodeId);
+    UA_NodeId_copy(c.sessionId.constRef(), &e.sessionId);
+    UA_DataValue_copy(value, &e.value);
+    //
+    std::unique_lock<std::mutex> l(_producerMutex);
+    bool pushed = _queue.push(e);
+    while (!pushed) {
+        if ((_policy == OverflowPolicy::DropNewest) && _running) {
+            break;
+        }
+        if (_running) {
+            std::this_thread::yield();  // the flush thread is draining
+        }
+        else {
+            writeBatch(_batchSize);  // back pressure the writer
+        }
+        pushed = _queue.push(e);
+    }
+    l.unlock();
+    if (!pushed) {
+        _dropped++;
+        e.clear();
+        return;
+    }
+    _queued++;
+    size_t n = _queue.size();
+    size_t h = _highWater;
+    while ((n > h) && !_highWater.compare_exchange_weak(h, n)) {
+    }
+    if (_running && (n >= _batchSize)) {
+        std::lock_guard<std::mutex> w(_waitMutex);
+        _wake.notify_one();
+    }
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::writeBatch
+    \param maxSamples
+    \return samples written
+*/
+size_t Open62541::BatchedHistoryGathering::writeBatch(size_t maxSamples)
+{
+    std::lock_guard<std::mutex> l(_consumerMutex);
+    _batch.clear();
+    Sample e;
+    while ((_batch.size() < maxSamples) && _queue.pop(e)) {
+        _batch.push_back(e);  // ownership passes to the batch
+    }
+    if (_batch.empty())
+        return 0;
+    // group by node so each backend sees runs of one node in time order
+    std::stable_sort(_batch.begin(), _batch.end(), [](const Sample& a, const Sample& b) {
+        return UA_NodeId_order(&a.nodeId, &b.nodeId) == UA_ORDER_LESS;
+    });
+    for (Sample& s : _batch) {
+        s.backend.serverSetHistoryData(s.server,
+                                       s.backend.context,
+                                       &s.sessionId,
+                                       nullptr,
+                                       &s.nodeId,
+                                       s.historizing,
+                                       &s.value);
+        s.clear();
+    }
+    size_t n = _batch.size();
+    _batch.clear();
+    _written += n;
+    _batches++;
+    return n;
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::discard
+    Free queued samples without writing them
+*/
+void Open62541::BatchedHistoryGathering::discard()
+{
+    std::lock_guard<std::mutex> l(_consumerMutex);
+    Sample e;
+    while (_queue.pop(e)) {
+        e.clear();
+        _dropped++;
+    }
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::flush
+    \param maxSamples
+    \return samples written
+*/
+size_t Open62541::BatchedHistoryGathering::flush(size_t maxSamples)
+{
+    size_t total = 0;
+    for (;;) {
+        size_t n = _batchSize;
+        if (maxSamples) {
+            if (total >= maxSamples)
+                break;
+            n = std::min(n, maxSamples - total);
+        }
+        size_t w = writeBatch(n);
+        if (!w)
+            break;
+        total += w;
+    }
+    return total;
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::run
+*/
+void Open62541::BatchedHistoryGathering::run()
+{
+    while (_running) {
+        {
+            std::unique_lock<std::mutex> l(_waitMutex);
+            _wake.wait_for(l, std::chrono::milliseconds(_interval), [this] {
+                return !_running || (_queue.size() >= _batchSize);
+            });
+        }
+        flush();
+    }
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::start
+    \param intervalMs
+    \return true if started
+*/
+bool Open62541::BatchedHistoryGathering::start(unsigned intervalMs)
+{
+    if (_running)
+        return false;
+    _interval = intervalMs ? intervalMs : 1;
+    _running  = true;
+    try {
+        _thread = std::thread([this] {
+            _threadConfig.apply();
+            run();
+        });
+    }
+    catch (...) {
+        _running = false;
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::BatchedHistoryGathering::stop
+    \param flushRemaining
+*/
+void Open62541::BatchedHistoryGathering::stop(bool flushRemaining)
+{
+    {
+        std::lock_guard<std::mutex> l(_waitMutex);
+        _running = false;
+    }
+    _wake.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+    if (flushRemaining)
+        flush();
+    else
+        discard();
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/browsecache.h>
+#include <open62541cpp/open62541client.h>
+
+/*!
+    \brief Open62541::BrowseCache::keyOf
+    \param d
+    \return shallow key of a browse description
+*/
+Open62541::BrowseCache::Key Open62541::BrowseCache::keyOf(const UA_BrowseDescription& d)
+{
+    Key k;
+    k.node            = d.nodeId;
+    k.referenceType   = d.referenceTypeId;
+    k.nodeClassMask   = d.nodeClassMask;
+    k.resultMask      = d.resultMask;
+    k.direction       = d.browseDirection;
+    k.includeSubtypes = d.includeSubtypes;
+    return k;
+}
+
+/*!
+    \brief Open62541::BrowseCache::purge
+    Drop expired entries - called with the lock held
+    \param now monotonic
+*/
+void Open62541::BrowseCache::purge(UA_DateTime now)
+{
+    for (auto i = _entries.begin(); i != _entries.end();) {
+        if (i->second->expires <= now)
+            i = _entries.erase(i);
+        else
+            ++i;
+    }
+}
+
+/*!
+    \brief Open62541::BrowseCache::find
+    \param d
+    \return result or null
+*/
+Open62541::BrowseCache::ResultRef Open62541::BrowseCache::find(const UA_BrowseDescription& d)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _entries.find(keyOf(d));
+    if (i != _entries.end()) {
+        if (i->second->expires > UA_DateTime_nowMonotonic()) {
+            _hits++;
+            return i->second;
+        }
+        _entries.erase(i);
+    }
+    _misses++;
+    return ResultRef();
+}
+
+/*!
+    \brief Open62541::BrowseCache::put
+    \param d
+    \param references
+    \return entry
+*/
+Open62541::BrowseCache::ResultRef Open62541::BrowseCache::put(const UA_BrowseDescription& d,
+                                                              std::vector<UA_ReferenceDescription>& references)
+{
+    EntryRef e       = std::make_shared<Result>();
+    e->node          = d.nodeId;  // deep copies - the key points at these
+    e->referenceType = d.referenceTypeId;
+    e->references.swap(references);
+    const UA_DateTime now = UA_DateTime_nowMonotonic();
+    e->expires            = now + _ttl;
+    Key k                 = keyOf(d);
+    k.node                = *e->node.constRef();
+    k.referenceType       = *e->referenceType.constRef();
+    //
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_entries.size() >= _maxEntries) {
+        purge(now);
+        if (_entries.size() >= _maxEntries)
+            _entries.clear();
+    }
+    _entries.erase(k);  // the old key points into the entry it replaces
+    _entries.emplace(k, e);
+    return e;
+}
+
+/*!
+    \brief Open62541::BrowseCache::invalidate
+    \param n
+    \param inverse
+*/
+void Open62541::BrowseCache::invalidate(const NodeId& n, bool inverse)
+{
+    const UA_NodeId& id = *n.constRef();
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto i = _entries.begin(); i != _entries.end();) {
+        bool drop = UA_NodeId_equal(&i->first.node, &id) ||
+                    (inverse && (i->first.direction != UA_BROWSEDIRECTION_FORWARD));
+        for (size_t j = 0; !drop && (j < i->second->references.size()); j++) {
+            drop = UA_NodeId_equal(&i->second->references[j].nodeId.nodeId, &id);
+        }
+        if (drop)
+            i = _entries.erase(i);
+        else
+            ++i;
+    }
+}
+
+/*!
+    \brief Open62541::BrowseCache::invalidateAll
+*/
+void Open62541::BrowseCache::invalidateAll()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _entries.clear();
+}
+
+/*!
+    \brief Open62541::BrowseCache::modelChanged
+    \param fields
+*/
+void Open62541::BrowseCache::modelChanged(const VariantArray& fields)
+{
+    if ((fields.length() < 1) || !UA_Variant_hasScalarType(&fields[0], &UA_TYPES[UA_TYPES_NODEID]))
+        return;
+    const UA_NodeId* type = static_cast<const UA_NodeId*>(fields[0].data);
+    if (type->namespaceIndex != 0)
+        return;
+    if (type->identifier.numeric == UA_NS0ID_GENERALMODELCHANGEEVENTTYPE) {
+        const UA_Variant* changes = (fields.length() > 1) ? &fields[1] : nullptr;
+        if (changes && (changes->type == &UA_TYPES[UA_TYPES_MODELCHANGESTRUCTUREDATATYPE])) {
+            const UA_ModelChangeStructureDataType* c =
+                static_cast<const UA_ModelChangeStructureDataType*>(changes->data);
+            const size_t n = UA_Variant_isScalar(changes) ? 1 : changes->arrayLength;
+            bool all       = false;
+            for (size_t i = 0; !all && (i < n); i++) {
+                // the other end of a reference change is not reported. A deleted reference is still in the
+                // entries browsing from it, and the inverse browses of its target are dropped. An added one is
+                // in no entry yet, so a forward browse of a source other than the affected node cannot be found
+                all = (c[i].verb & UA_MODELCHANGESTRUCTUREVERBMASK_REFERENCEADDED) != 0;
+                if (!all) {
+                    const bool references = (c[i].verb & UA_MODELCHANGESTRUCTUREVERBMASK_REFERENCEDELETED) != 0;
+                    invalidate(NodeId(c[i].affected), references);
+                }
+            }
+            if (all)
+                invalidateAll();
+            _invalidations++;
+            return;
+        }
+    }
+    else if (type->identifier.numeric != UA_NS0ID_BASEMODELCHANGEEVENTTYPE) {
+        return;  // not a model change
+    }
+    invalidateAll();  // the changes are not known
+    _invalidations++;
+}
+
+/*!
+    \brief Open62541::BrowseCache::watch
+    \param c
+    \param publishingIntervalMs
+    \return true if subscribed
+*/
+bool Open62541::BrowseCache::watch(Client& c, double publishingIntervalMs)
+{
+    unwatch();
+    CreateSubscriptionRequest settings;
+    settings.get()                             = UA_CreateSubscriptionRequest_default();
+    settings.get().requestedPublishingInterval = publishingIntervalMs;
+    UA_UInt32 id                               = 0;
+    if (!c.addSubscription(id, &settings))
+        return false;
+    ClientSubscription* s = c.subscription(id);
+    auto f                = [this](ClientSubscription&, VariantArray& fields) { modelChanged(fields); };
+    MonitoredItemEvent* e = new MonitoredItemEvent(f, *s);
+    e->setMonitorItem(NodeId::Server, 2);
+    e->setClause(0, "EventType");
+    e->setClause(1, "Changes", UA_ATTRIBUTEID_VALUE, NodeId(0, UA_NS0ID_GENERALMODELCHANGEEVENTTYPE));
+    NodeId server(NodeId::Server);
+    if (!e->addEvent(server)) {
+        delete e;
+        c.removeSubscription(id);
+        return false;
+    }
+    MonitoredItemRef m(e);
+    s->addMonitorItem(m);
+    _client         = &c;
+    _subscriptionId = id;
+    invalidateAll();  // changes made before the subscription were not seen
+    return true;
+}
+
+/*!
+    \brief Open62541::BrowseCache::unwatch
+*/
+void Open62541::BrowseCache::unwatch()
+{
+    if (_client && _subscriptionId)
+        _client->removeSubscription(_subscriptionId);
+    _client         = nullptr;
+    _subscriptionId = 0;
+}
+
+/*!
+    \brief Open62541::BrowseCache::size
+    \return entries
+*/
+size_t Open62541::BrowseCache::size() const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _entries.size();
+}
+
+/*!
+    \brief Open62541::BrowseCache::memoryUsage
+    \return bytes - the strings of the references are taken as 32 bytes each
+*/
+size_t Open62541::BrowseCache::memoryUsage() const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t b = 0;
+    for (const auto& i : _entries) {
+        const Result& r = *i.second;
+        b += MemoryReport::HashNode + sizeof(i) + 2 * sizeof(void*) + sizeof(Result) +
+             MemoryReport::heapOf(*r.node.constRef()) + MemoryReport::heapOf(*r.referenceType.constRef()) +
+             r.references.capacity() * (sizeof(UA_ReferenceDescription) + 32);
+    }
+    return b;
+}
@@ -10,3 +10,278 @@
  * A PARTICULAR PURPOSE.
  */
 #include <open62541cpp/clientbrowser.h>
+
+/*!
+    \brief Open62541::ClientBrowser::~ClientBrowser
+*/
+Open62541::ClientBrowser::~ClientBrowser()
+{
+    detachOutstanding();
+    list().clear();
+    releaseResults();
+}
+
+/*!
+    \brief Open62541::ClientBrowser::detachOutstanding
+    Forget the requests still in flight - their late callbacks are ignored
+*/
+void Open62541::ClientBrowser::detachOutstanding()
+{
+    for (Request* r : _outstanding) {
+        r->browser = nullptr;  // freed by the callback when the client completes or cancels it
+    }
+    _outstanding.clear();
+    _inFlight = 0;
+}
+
+/*!
+    \brief Open62541::ClientBrowser::releaseResults
+*/
+void Open62541::ClientBrowser::releaseResults()
+{
+    _visited.clear();  // before what it points at
+    clearResults();
+    for (auto& c : _continue) {
+        UA_ByteString_clear(&c.first);
+    }
+    _continue.clear();
+    _frontier.clear();
+    _starts.clear();
+    _cached.clear();
+}
+
+/*!
+    \brief Open62541::ClientBrowser::describe
+    \param d set to browse a node's children - the description the browse cache is keyed by
+    \param node shallow
+*/
+void Open62541::ClientBrowser::describe(UA_BrowseDescription& d, const NodeId& node)
+{
+    UA_BrowseDescription_init(&d);
+    d.nodeId          = node.get();  // shallow
+    d.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    d.includeSubtypes = true;
+    d.resultMask      = UA_BROWSERESULTMASK_ALL;
+}
+
+/*!
+    \brief Open62541::ClientBrowser::browseCallback
+    Called from UA_Client_run_iterate for each response
+    \param userdata request
+    \param response UA_BrowseResponse or UA_BrowseNextResponse
+*/
+void Open62541::ClientBrowser::browseCallback(UA_Client* /*client*/,
+                                              void* userdata,
+                                              UA_UInt32 /*requestId*/,
+                                              void* response)
+{
+    std::unique_ptr<Request> r(static_cast<Request*>(userdata));
+    if (!r || !r->browser)
+        return;
+    ClientBrowser* b = r->browser;
+    b->_outstanding.erase(r.get());
+    b->_inFlight--;
+    if (!response)
+        return;
+    UA_ResponseHeader* h = nullptr;
+    UA_BrowseResult* results = nullptr;
+    size_t n                 = 0;
+    if (r->next) {
+        UA_BrowseNextResponse* p = static_cast<UA_BrowseNextResponse*>(response);
+        h                        = &p->responseHeader;
+        results                  = p->results;
+        n                        = p->resultsSize;
+    }
+    else {
+        UA_BrowseResponse* p = static_cast<UA_BrowseResponse*>(response);
+        h                    = &p->responseHeader;
+        results              = p->results;
+        n                    = p->resultsSize;
+    }
+    if (h->serviceResult != UA_STATUSCODE_GOOD) {
+        b->_lastError = h->serviceResult;
+        return;
+    }
+    BrowseCache* cache = b->obj().browseCache();
+    if (cache && !r->next && (n == 1) && (results[0].statusCode == UA_STATUSCODE_GOOD) &&
+        (results[0].continuationPoint.length == 0)) {
+        // complete in one page - the browser takes the references so the cache gets copies
+        std::vector<UA_ReferenceDescription> v(results[0].referencesSize);
+        for (size_t i = 0; i < v.size(); i++) {
+            UA_ReferenceDescription_copy(&results[0].references[i], &v[i]);
+        }
+        UA_BrowseDescription d;
+        describe(d, r->node);
+        cache->put(d, v);
+    }
+    for (size_t i = 0; i < n; i++) {
+        b->handleResult(results[i], r->depth);
+    }
+}
+
+/*!
+    \brief Open62541::ClientBrowser::handleResult
+    Takes ownership of the result's members
+    \param r
+    \param depth of the browsed node
+*/
+void Open62541::ClientBrowser::handleResult(UA_BrowseResult& r, size_t depth)
+{
+    if (r.statusCode != UA_STATUSCODE_GOOD) {
+        _lastError = r.statusCode;
+        return;
+    }
+    handleReferences(r.references, r.referencesSize, depth);
+    if (r.continuationPoint.length > 0) {
+        _continue.emplace_back(r.continuationPoint, depth);  // take it
+        r.continuationPoint = UA_BYTESTRING_NULL;
+    }
+    adopt(r);  // take the references
+}
+
+/*!
+    \brief Open62541::ClientBrowser::handleReferences
+    Add the references of a node to the list or views and its children to the frontier - the references must
+    outlive the results
+    \param references
+    \param n
+    \param depth of the browsed node
+*/
+void Open62541::ClientBrowser::handleReferences(const UA_ReferenceDescription* references, size_t n, size_t depth)
+{
+    for (size_t i = 0; i < n; i++) {
+        const UA_ReferenceDescription& rd = references[i];
+        if ((rd.nodeId.serverIndex != 0) || !_visited.insert(rd.nodeId.nodeId).second)
+            continue;
+        if (_viewMode) {
+            _views.emplace_back(rd);
+        }
+        else {
+            list().push_back(BrowseItem(toString(rd.browseName.name),
+                                        rd.browseName.namespaceIndex,
+                                        rd.nodeId.nodeId,
+                                        rd.referenceTypeId));  // shallow - the result is kept
+        }
+        if ((_maxDepth == 0) || (depth + 1 < _maxDepth)) {
+            _frontier.emplace_back(NodeId(rd.nodeId.nodeId), depth + 1);
+        }
+    }
+}
+
+/*!
+    \brief Open62541::ClientBrowser::send
+    Issue one request - called with the client lock held
+    \param next send a BrowseNext for the oldest continuation point
+    \return true if sent
+*/
+bool Open62541::ClientBrowser::send(bool next)
+{
+    Request* r = new Request;
+    r->browser = this;
+    r->next    = next;
+    UA_UInt32 id       = 0;
+    UA_StatusCode ret  = UA_STATUSCODE_GOOD;
+    if (next) {
+        std::pair<UA_ByteString, size_t> c = _continue.front();
+        _continue.pop_front();
+        r->depth = c.second;
+        UA_BrowseNextRequest req;
+        UA_BrowseNextRequest_init(&req);
+        req.continuationPoints     = &c.first;  // shallow
+        req.continuationPointsSize = 1;
+        ret                        = __UA_Client_AsyncService(obj().client(),
+                                       &req,
+                                       &UA_TYPES[UA_TYPES_BROWSENEXTREQUEST],
+                                       browseCallback,
+                                       &UA_TYPES[UA_TYPES_BROWSENEXTRESPONSE],
+                                       r,
+                                       &id);
+        UA_ByteString_clear(&c.first);  // the request has been encoded
+    }
+    else {
+        std::pair<NodeId, size_t> f = std::move(_frontier.front());
+        _frontier.pop_front();
+        r->depth = f.second;
+        r->node  = std::move(f.first);
+        UA_BrowseDescription bd;
+        describe(bd, r->node);
+        if (BrowseCache* cache = obj().browseCache()) {
+            BrowseCache::ResultRef c = cache->find(bd);
+            if (c) {
+                delete r;  // answered without a request
+                _cached.push_back(c);
+                handleReferences(c->references.data(), c->references.size(), f.second);
+                return true;
+            }
+        }
+        UA_BrowseRequest req;
+        UA_BrowseRequest_init(&req);
+        req.nodesToBrowse     = &bd;
+        req.nodesToBrowseSize = 1;
+        ret                   = __UA_Client_AsyncService(obj().client(),
+                                       &req,
+                                       &UA_TYPES[UA_TYPES_BROWSEREQUEST],
+                                       browseCallback,
+                                       &UA_TYPES[UA_TYPES_BROWSERESPONSE],
+                                       r,
+                                       &id);
+    }
+    if (ret != UA_STATUSCODE_GOOD) {
+        delete r;
+        _lastError = ret;
+        return false;
+    }
+    _outstanding.insert(r);
+    _inFlight++;
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientBrowser::browse
+    \param starts
+    \param maxDepth
+    \return true on success
+*/
+bool Open62541::ClientBrowser::browse(const std::vector<NodeId>& starts, size_t maxDepth)
+{
+    Metrics::Scope timing(Metrics::Browse);
+    detachOutstanding();  // left by a failed browse
+    list().clear();
+    releaseResults();
+    _lastError = UA_STATUSCODE_GOOD;
+    if (!obj().client())
+        return false;
+    _maxDepth = maxDepth;
+    _starts = starts;
+    for (const NodeId& n : _starts) {
+        if (_visited.insert(n.get()).second)
+            _frontier.emplace_back(n, 0);
+    }
+    while ((_lastError == UA_STATUSCODE_GOOD) && (!_frontier.empty() || !_continue.empty() || (_inFlight > 0))) {
+        WriteLock l(obj().mutex());
+        // continuation points first - they hold server resources
+        while ((_inFlight < _pipelineDepth) && !_continue.empty()) {
+            if (!send(true))
+                break;
+        }
+        while ((_inFlight < _pipelineDepth) && !_frontier.empty()) {
+            if (!send(false))
+                break;
+        }
+        if (_inFlight > 0) {
+            UA_StatusCode ret = UA_Client_run_iterate(obj().client(), 10);  // responses arrive via browseCallback
+            if (ret != UA_STATUSCODE_GOOD)
+                _lastError = ret;
+        }
+    }
+    // after an error let the requests already sent complete - their results are discarded with the next browse
+    UA_StatusCode ret = UA_STATUSCODE_GOOD;
+    while ((_inFlight > 0) && (ret == UA_STATUSCODE_GOOD)) {
+        WriteLock l(obj().mutex());
+        ret = UA_Client_run_iterate(obj().client(), 10);
+    }
+    if (_inFlight > 0) {
+        detachOutstanding();  // the client failed - these will not complete in this browse
+    }
+    return _lastError == UA_STATUSCODE_GOOD;
+}
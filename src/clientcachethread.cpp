@@ -10,6 +10,50 @@
  * A PARTICULAR PURPOSE.
  */
 #include <open62541cpp/clientcachethread.h>
+#include <chrono>
+
+/*!
+    \brief Open62541::ClientCacheThread::worker
+    \param index which share of the clients this thread drives
+*/
+void Open62541::ClientCacheThread::worker(unsigned index)
+{
+    std::vector<ClientRef> all;
+    std::vector<ClientRef> mine;
+    unsigned generation = _cache.generation() + 1;  // force the first snapshot
+    while (_running) {
+        if (generation != _cache.generation()) {
+            generation = _cache.generation();
+            _cache.snapshot(all);
+            mine.clear();
+            for (size_t i = index; i < all.size(); i += _threadCount) {
+                mine.push_back(all[i]);
+            }
+            all.clear();
+        }
+        //
+        bool waited = false;
+        if (!mine.empty()) {
+            // split the interval between the clients - each waits on its own socket for its slice
+            const unsigned slice = std::max(1U, unsigned(_interval / mine.size()));
+            for (auto& c : mine) {
+                if (!_running)
+                    break;
+                if ((c->getConnectStatus() == UA_STATUSCODE_GOOD) &&
+                    (c->getChannelState() != UA_SECURECHANNELSTATE_CLOSED)) {
+                    c->runIterate(slice);
+                    waited = true;
+                }
+                c->process();
+            }
+        }
+        if (!waited && _running) {
+            // nothing to wait on - sleep rather than spin, stop() wakes us
+            std::unique_lock<std::mutex> l(_waitMutex);
+            _wake.wait_for(l, std::chrono::milliseconds(_interval), [this] { return !_running; });
+        }
+    }
+}
 
 /*!
     \brief Open62541::ClientCacheThread::start
@@ -17,16 +61,19 @@
 */
 bool Open62541::ClientCacheThread::start()
 {
-
+    if (_running)
+        return true;
+    _running = true;
     try {
-        _thread = std::thread([this] {
-            _running = true;
-            while (_running) {
-                _cache.process();
-            }
-        });
+        for (unsigned i = 0; i < _threadCount; i++) {
+            _threads.emplace_back([this, i] {
+                _threadConfig.apply(int(i));
+                worker(i);
+            });
+        }
     }
     catch (...) {
+        stop();
         return false;
     }
     return true;
@@ -38,7 +85,15 @@ bool Open62541::ClientCacheThread::start()
 */
 bool Open62541::ClientCacheThread::stop()
 {
-    _running = false;
-    _thread.join();
+    {
+        std::lock_guard<std::mutex> l(_waitMutex);
+        _running = false;
+    }
+    _wake.notify_all();
+    for (auto& t : _threads) {
+        if (t.joinable())
+            t.join();
+    }
+    _threads.clear();
     return true;
 }
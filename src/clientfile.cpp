@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/clientfile.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace Open62541 {
+/*!
+    \brief The ClientFile::Segment struct
+    Walks one handle through Open, SetPosition, Read or Write until its range is done, then Close. Only the
+    completion of its one call in flight touches it
+*/
+struct ClientFile::Segment {
+    enum Phase { Opening, Positioning, Transferring, Closing, Done };
+    Phase phase        = Opening;
+    UA_UInt32 handle   = 0;
+    UA_UInt64 position = 0;
+    UA_UInt64 end      = 0;
+    size_t pending     = 0;  // bytes of the Write in flight
+};
+
+/*!
+    \brief The ClientFile::State struct
+    Shared between a transfer and the completions of its calls, so a completion arriving after a transfer
+    has timed out is harmless - it only closes its handle once cancelled is set
+*/
+struct ClientFile::State {
+    typedef std::shared_ptr<Segment> SegmentRef;
+    Client* client = nullptr;
+    NodeId object;
+    bool writing          = false;
+    UA_Byte* buffer       = nullptr;  // download into
+    const UA_Byte* source = nullptr;  // upload from
+    size_t chunk          = 1;
+    std::vector<SegmentRef> segments;
+    //
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t active       = 0;  // segments not Done
+    size_t calls        = 0;  // calls completed
+    bool cancelled      = false;
+    UA_StatusCode error = UA_STATUSCODE_GOOD;
+
+    void fail(UA_StatusCode s)
+    {
+        if (error == UA_STATUSCODE_GOOD)
+            error = s;
+    }
+    static void next(const std::shared_ptr<State>& st, const SegmentRef& sg);
+    void completed(Segment& sg, UA_StatusCode s, VariantCallResult& out);
+    void finished();
+};
+}  // namespace Open62541
+
+/*!
+    \brief Open62541::ClientFile::State::next
+    Send the segment's next call
+    \param st
+    \param sg
+*/
+void Open62541::ClientFile::State::next(const std::shared_ptr<State>& st, const SegmentRef& sg)
+{
+    // shallow - the arguments are encoded before callMethodAsync returns
+    Segment& s = *sg;
+    UA_Byte mode;
+    UA_Int32 length;
+    UA_ByteString data;
+    VariantList in(2);
+    UA_Variant_init(&in[0]);
+    UA_Variant_init(&in[1]);
+    UA_Variant_setScalar(&in[0], &s.handle, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_UInt32 method = 0;
+    switch (s.phase) {
+        case Segment::Opening:
+            mode = st->writing ? UA_Byte(2 | 4) : UA_Byte(1);  // Write | EraseExisting or Read
+            UA_Variant_setScalar(&in[0], &mode, &UA_TYPES[UA_TYPES_BYTE]);
+            in.resize(1);
+            method = UA_NS0ID_FILETYPE_OPEN;
+            break;
+        case Segment::Positioning:
+            UA_Variant_setScalar(&in[1], &s.position, &UA_TYPES[UA_TYPES_UINT64]);
+            method = UA_NS0ID_FILETYPE_SETPOSITION;
+            break;
+        case Segment::Transferring:
+            if (st->writing) {
+                s.pending   = size_t(std::min<UA_UInt64>(st->chunk, s.end - s.position));
+                data.length = s.pending;
+                data.data   = const_cast<UA_Byte*>(st->source + s.position);
+                UA_Variant_setScalar(&in[1], &data, &UA_TYPES[UA_TYPES_BYTESTRING]);
+                method = UA_NS0ID_FILETYPE_WRITE;
+            }
+            else {
+                length = UA_Int32(std::min<UA_UInt64>(st->chunk, s.end - s.position));
+                UA_Variant_setScalar(&in[1], &length, &UA_TYPES[UA_TYPES_INT32]);
+                method = UA_NS0ID_FILETYPE_READ;
+            }
+            break;
+        case Segment::Closing:
+            in.resize(1);
+            method = UA_NS0ID_FILETYPE_CLOSE;
+            break;
+        default:
+            return;
+    }
+    auto handler = [st, sg](UA_StatusCode status, VariantCallResult& out) {
+        st->completed(*sg, status, out);
+        if (sg->phase == Segment::Done)
+            st->finished();
+        else
+            next(st, sg);
+    };
+    if (!st->client->callMethodAsync(st->object, NodeId(0, method), in, handler)) {
+        {
+            std::lock_guard<std::mutex> l(st->mutex);
+            st->fail((st->client->lastError() != UA_STATUSCODE_GOOD) ? st->client->lastError()
+                                                                     : UA_STATUSCODE_BADCOMMUNICATIONERROR);
+        }
+        s.phase = Segment::Done;  // a handle left open is released when the session closes
+        st->finished();
+    }
+}
+
+/*!
+    \brief Open62541::ClientFile::State::completed
+    Take a call's result and move the segment on
+    \param sg
+    \param s call status
+    \param out output arguments
+*/
+void Open62541::ClientFile::State::completed(Segment& sg, UA_StatusCode s, VariantCallResult& out)
+{
+    std::lock_guard<std::mutex> l(mutex);
+    calls++;
+    if (sg.phase == Segment::Closing) {
+        sg.phase = Segment::Done;
+        return;
+    }
+    const UA_Variant* v = (out.size() > 0) ? out.data() : nullptr;
+    if ((s == UA_STATUSCODE_GOOD) && (!cancelled || (sg.phase == Segment::Opening))) {
+        switch (sg.phase) {
+            case Segment::Opening:
+                if (v && UA_Variant_hasScalarType(v, &UA_TYPES[UA_TYPES_UINT32])) {
+                    sg.handle = *static_cast<UA_UInt32*>(v->data);
+                    sg.phase  = sg.position ? Segment::Positioning : Segment::Transferring;
+                }
+                else {
+                    fail(UA_STATUSCODE_BADUNEXPECTEDERROR);
+                    sg.phase = Segment::Done;
+                }
+                break;
+            case Segment::Positioning:
+                sg.phase = Segment::Transferring;
+                break;
+            case Segment::Transferring:
+                if (writing) {
+                    sg.position += sg.pending;
+                }
+                else if (v && UA_Variant_hasScalarType(v, &UA_TYPES[UA_TYPES_BYTESTRING])) {
+                    const UA_ByteString* b = static_cast<const UA_ByteString*>(v->data);
+                    const size_t n         = size_t(std::min<UA_UInt64>(b->length, sg.end - sg.position));
+                    if (n == 0) {
+                        fail(UA_STATUSCODE_BADOUTOFRANGE);  // the file is shorter than its Size
+                    }
+                    else {
+                        memcpy(buffer + sg.position, b->data, n);
+                        sg.position += n;
+                    }
+                }
+                else {
+                    fail(UA_STATUSCODE_BADTYPEMISMATCH);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    else if (s != UA_STATUSCODE_GOOD) {
+        fail(s);
+    }
+    if ((sg.phase == Segment::Transferring) && (sg.position >= sg.end))
+        sg.phase = Segment::Closing;
+    if ((error != UA_STATUSCODE_GOOD) || cancelled) {
+        sg.phase = ((sg.phase != Segment::Opening) && (sg.phase != Segment::Done)) ? Segment::Closing
+                                                                                  : Segment::Done;
+    }
+}
+
+/*!
+    \brief Open62541::ClientFile::State::finished
+    A segment is done
+*/
+void Open62541::ClientFile::State::finished()
+{
+    std::lock_guard<std::mutex> l(mutex);
+    if (active)
+        active--;
+    done.notify_all();
+}
+
+/*!
+    \brief Open62541::ClientFile::ClientFile
+    \param client
+    \param object
+    \param chunk
+    \param parallel
+*/
+Open62541::ClientFile::ClientFile(Client& client, const NodeId& object, size_t chunk, unsigned parallel)
+    : _client(client)
+    , _object(object)
+{
+    setChunk(chunk);
+    setParallel(parallel);
+}
+
+/*!
+    \brief Open62541::ClientFile::run
+    Start every segment and wait until all are done
+    \param st
+    \return true on success
+*/
+bool Open62541::ClientFile::run(const std::shared_ptr<State>& st)
+{
+    State& s   = *st;
+    s.client   = &_client;
+    s.object   = _object;
+    s.chunk    = _chunk;
+    s.active   = s.segments.size();
+    _lastError = UA_STATUSCODE_GOOD;
+    for (auto& sg : s.segments)
+        State::next(st, sg);
+    //
+    std::unique_lock<std::mutex> l(s.mutex);
+    size_t calls     = s.calls;
+    auto deadline    = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout);
+    while (s.active) {
+        if (_pump) {
+            l.unlock();
+            const bool ok = _client.runIterate(10);
+            l.lock();
+            if (!ok) {
+                s.fail((_client.lastError() != UA_STATUSCODE_GOOD) ? _client.lastError()
+                                                                     : UA_STATUSCODE_BADCONNECTIONCLOSED);
+                break;
+            }
+        }
+        else {
+            s.done.wait_for(l, std::chrono::milliseconds(10));
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (s.calls != calls) {
+            calls     = s.calls;
+            deadline  = now + std::chrono::milliseconds(_timeout);
+        }
+        else if (now > deadline) {
+            s.fail(UA_STATUSCODE_BADTIMEOUT);
+            break;
+        }
+    }
+    s.cancelled = true;  // completions still in flight must not touch the buffer
+    _lastError  = s.error;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ClientFile::size
+    \param n
+    \return true on success
+*/
+bool Open62541::ClientFile::size(UA_UInt64& n)
+{
+    std::vector<NodeId> results;
+    if (!_client.translatePaths(_object, {Path{"0:Size"}}, results) || results.empty() || results[0].isNull()) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        return false;
+    }
+    Variant v;
+    if (!_client.readValueAttribute(results[0], v)) {
+        _lastError = _client.lastError();
+        return false;
+    }
+    if (!UA_Variant_hasScalarType(v.constRef(), &UA_TYPES[UA_TYPES_UINT64])) {
+        _lastError = UA_STATUSCODE_BADTYPEMISMATCH;
+        return false;
+    }
+    n          = *static_cast<UA_UInt64*>(v.constRef()->data);
+    _lastError = UA_STATUSCODE_GOOD;
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientFile::download
+    \param data
+    \return true on success
+*/
+bool Open62541::ClientFile::download(std::vector<UA_Byte>& data)
+{
+    data.clear();
+    UA_UInt64 total = 0;
+    if (!size(total))
+        return false;
+    if (!total)
+        return true;
+    data.resize(size_t(total));
+    auto st    = std::make_shared<State>();
+    st->buffer = data.data();
+    // contiguous segments of whole chunks - each handle reads its own range in order
+    const UA_UInt64 chunks = (total + _chunk - 1) / _chunk;
+    const UA_UInt64 n      = std::min<UA_UInt64>(_parallel, chunks);
+    UA_UInt64 start        = 0;
+    for (UA_UInt64 i = 0; i < n; i++) {
+        auto sg      = std::make_shared<Segment>();
+        sg->position = start;
+        sg->end      = std::min(total, start + ((chunks * (i + 1)) / n - (chunks * i) / n) * _chunk);
+        start        = sg->end;
+        st->segments.push_back(sg);
+    }
+    if (!run(st)) {
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientFile::download
+    \param path
+    \return true on success
+*/
+bool Open62541::ClientFile::download(const std::string& path)
+{
+    std::vector<UA_Byte> data;
+    if (!download(data))
+        return false;
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()))) {
+        _lastError = UA_STATUSCODE_BADNOTWRITABLE;
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientFile::upload
+    \param data
+    \param length
+    \return true on success
+*/
+bool Open62541::ClientFile::upload(const UA_Byte* data, size_t length)
+{
+    auto st     = std::make_shared<State>();
+    st->writing = true;
+    st->source  = data;
+    auto sg     = std::make_shared<Segment>();
+    sg->end     = length;
+    st->segments.push_back(sg);
+    return run(st);
+}
+
+/*!
+    \brief Open62541::ClientFile::upload
+    \param path
+    \return true on success
+*/
+bool Open62541::ClientFile::upload(const std::string& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        _lastError = UA_STATUSCODE_BADNOTREADABLE;
+        return false;
+    }
+    std::vector<UA_Byte> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return upload(data.data(), data.size());
+}
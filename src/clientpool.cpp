@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/clientpool.h>
+
+/*!
+    \brief Open62541::ClientPool::ClientPool
+    \param threads
+    \param sessionsPerEndpoint
+*/
+Open62541::ClientPool::ClientPool(unsigned threads, unsigned sessionsPerEndpoint)
+    : _endpoints(std::make_shared<const EndpointMap>())
+    , _threadCount(threads ? threads : 1)
+    , _sessionsPerEndpoint(sessionsPerEndpoint ? sessionsPerEndpoint : 1)
+{
+    _connect = [](Client& c, const std::string& url) { return c.connectAsync(url); };
+}
+
+/*!
+    \brief Open62541::ClientPool::~ClientPool
+*/
+Open62541::ClientPool::~ClientPool()
+{
+    stop();
+}
+
+/*!
+    \brief Open62541::ClientPool::add
+    \param endpoint
+    \param sessions
+    \return true if added
+*/
+bool Open62541::ClientPool::add(const std::string& endpoint, unsigned sessions)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    EndpointMapRef current = endpoints();
+    if (current->find(endpoint) != current->end())
+        return false;
+    auto e   = std::make_shared<Endpoint>();
+    e->url   = endpoint;
+    e->shard = unsigned(std::hash<std::string>()(endpoint) % _threadCount);
+    const unsigned n = sessions ? sessions : _sessionsPerEndpoint;
+    for (unsigned i = 0; i < n; i++) {
+        std::unique_ptr<Session> s(new Session);
+        s->client = std::make_shared<Client>();
+        e->sessions.push_back(std::move(s));
+    }
+    // copy on write - readers keep using the old table until they next look
+    auto m = std::make_shared<EndpointMap>(*current);
+    (*m)[endpoint] = e;
+    std::atomic_store(&_endpoints, EndpointMapRef(m));
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientPool::remove
+    \param endpoint
+    \return true if removed
+*/
+bool Open62541::ClientPool::remove(const std::string& endpoint)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    EndpointMapRef current = endpoints();
+    if (current->find(endpoint) == current->end())
+        return false;
+    auto m = std::make_shared<EndpointMap>(*current);
+    m->erase(endpoint);
+    std::atomic_store(&_endpoints, EndpointMapRef(m));
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientPool::find
+    \param endpoint
+    \return connected session or null
+*/
+Open62541::ClientRef Open62541::ClientPool::find(const std::string& endpoint) const
+{
+    EndpointMapRef m = endpoints();
+    auto i           = m->find(endpoint);
+    if (i == m->end())
+        return ClientRef();
+    Endpoint& e          = *(i->second);
+    const size_t n       = e.sessions.size();
+    const unsigned start = e.next++;
+    Session* renewing    = nullptr;  // up but near a channel renewal - used if nothing better is up
+    for (size_t k = 0; k < n; k++) {
+        Session& s = *e.sessions[(start + k) % n];
+        if (!s.up)
+            continue;
+        if (!_renewalGuard || !s.client->renewing(_renewalGuard))
+            return s.client;
+        if (!renewing)
+            renewing = &s;
+    }
+    return renewing ? renewing->client : ClientRef();
+}
+
+/*!
+    \brief Open62541::ClientPool::sessions
+    \param endpoint
+    \param clients
+*/
+void Open62541::ClientPool::sessions(const std::string& endpoint, std::vector<ClientRef>& clients) const
+{
+    clients.clear();
+    EndpointMapRef m = endpoints();
+    auto i           = m->find(endpoint);
+    if (i != m->end()) {
+        for (auto& s : i->second->sessions)
+            clients.push_back(s->client);
+    }
+}
+
+/*!
+    \brief Open62541::ClientPool::connected
+    \param endpoint
+    \return sessions up
+*/
+unsigned Open62541::ClientPool::connected(const std::string& endpoint) const
+{
+    unsigned n       = 0;
+    EndpointMapRef m = endpoints();
+    auto i           = m->find(endpoint);
+    if (i != m->end()) {
+        for (auto& s : i->second->sessions) {
+            if (s->up)
+                n++;
+        }
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::ClientPool::failed
+    Schedules a reconnect with exponential backoff
+    \param s
+    \param now
+*/
+void Open62541::ClientPool::failed(Session& s, Clock::time_point now)
+{
+    s.up         = false;
+    s.connecting = false;
+    s.backoff    = (s.backoff.count() == 0) ? _minBackoff : std::min(_maxBackoff, s.backoff * 2);
+    s.nextAttempt = now + s.backoff;
+    try {
+        s.client->disconnect(true);  // keeps subscriptions if the client recovers them
+    }
+    catch (...) {
+        // never connected - nothing to close
+    }
+}
+
+/*!
+    \brief Open62541::ClientPool::service
+    Health check, connect and pump one session
+    \param e
+    \param s
+    \param now
+    \param slice
+    \param waited set if this session waited on its socket
+*/
+void Open62541::ClientPool::service(Endpoint& e, Session& s, Clock::time_point now, unsigned slice, bool& waited)
+{
+    Client& c = *s.client;
+    if (!s.up && !s.connecting) {
+        if (now < s.nextAttempt)
+            return;  // backing off
+        s.started = now;
+        bool ok   = false;
+        try {
+            ok = _connect(c, e.url);
+        }
+        catch (...) {
+            ok = false;
+        }
+        if (!ok) {
+            failed(s, now);
+            return;
+        }
+        s.connecting = true;
+    }
+    //
+    c.runCommands();  // work posted to this session - e.g. subscription changes
+    if (s.connecting || s.up || (c.getChannelState() != UA_SECURECHANNELSTATE_CLOSED)) {
+        c.runIterate(slice);  // takes the client lock for the iteration only
+        waited = true;
+    }
+    c.process();
+    //
+    const bool active = (c.getSessionState() == UA_SESSIONSTATE_ACTIVATED);
+    if (c.getConnectStatus() != UA_STATUSCODE_GOOD) {
+        failed(s, now);
+    }
+    else if (s.connecting) {
+        if (active) {
+            s.connecting = false;
+            s.backoff    = std::chrono::milliseconds(0);
+            s.up         = true;
+        }
+        else if ((now - s.started) > _connectTimeout) {
+            failed(s, now);
+        }
+    }
+    else if (s.up && !active) {
+        failed(s, now);  // session dropped
+    }
+}
+
+/*!
+    \brief Open62541::ClientPool::worker
+    \param index shard served by this thread
+*/
+void Open62541::ClientPool::worker(unsigned index)
+{
+    EndpointMapRef table;
+    std::vector<EndpointRef> mine;
+    while (_running) {
+        EndpointMapRef current = endpoints();
+        if (current != table) {
+            table = current;
+            mine.clear();
+            for (auto& i : *table) {
+                if (i.second->shard == index)
+                    mine.push_back(i.second);
+            }
+        }
+        //
+        size_t n = 0;
+        for (auto& e : mine)
+            n += e->sessions.size();
+        bool waited = false;
+        if (n > 0) {
+            const unsigned slice = std::max(1U, unsigned(_interval / n));
+            for (auto& e : mine) {
+                for (auto& s : e->sessions) {
+                    if (!_running)
+                        break;
+                    service(*e, *s, Clock::now(), slice, waited);
+                }
+            }
+        }
+        if (!waited && _running) {
+            std::unique_lock<std::mutex> l(_waitMutex);
+            _wake.wait_for(l, std::chrono::milliseconds(_interval), [this] { return !_running; });
+        }
+    }
+}
+
+/*!
+    \brief Open62541::ClientPool::start
+    \return true on success
+*/
+bool Open62541::ClientPool::start()
+{
+    if (_running)
+        return true;
+    _running = true;
+    try {
+        for (unsigned i = 0; i < _threadCount; i++) {
+            _threads.emplace_back([this, i] {
+                _threadConfig.apply(int(i));
+                worker(i);
+            });
+        }
+    }
+    catch (...) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientPool::stop
+*/
+void Open62541::ClientPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(_waitMutex);
+        _running = false;
+    }
+    _wake.notify_all();
+    for (auto& t : _threads) {
+        if (t.joinable())
+            t.join();
+    }
+    _threads.clear();
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/clientreconnector.h>
+#include <algorithm>
+
+/*!
+    \brief Open62541::ClientReconnector::ClientReconnector
+    \param cache
+    \param maxParallel
+*/
+Open62541::ClientReconnector::ClientReconnector(ClientCache& cache, unsigned maxParallel)
+    : _cache(cache)
+    , _maxParallel(maxParallel ? maxParallel : 1)
+    , _random(std::random_device()())
+{
+    _connect = [](Client& c, const std::string& url) {
+        UA_Client* client = c.client();  // before the lock - client() takes it
+        WriteLock l(c.mutex());
+        const bool ok = UA_Client_connectAsync(client, url.c_str()) == UA_STATUSCODE_GOOD;
+        c.setConnectionType(ok ? Client::ASYNC : Client::NONE);
+        return ok;
+    };
+}
+
+/*!
+    \brief Open62541::ClientReconnector::setPriority
+    \param endpoint
+    \param priority
+*/
+void Open62541::ClientReconnector::setPriority(const std::string& endpoint, int priority)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _priorities[endpoint] = priority;
+    _prioritiesChanged    = true;
+}
+
+/*!
+    \brief Open62541::ClientReconnector::sync
+    Follow clients added to and removed from the cache
+*/
+void Open62541::ClientReconnector::sync()
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (_prioritiesChanged) {
+            for (auto& i : _entries) {
+                auto p             = _priorities.find(i.first);
+                i.second->priority = (p != _priorities.end()) ? p->second : 0;
+            }
+            _prioritiesChanged = false;
+        }
+    }
+    const unsigned g = _cache.generation();
+    if (_synced && (g == _generation))
+        return;
+    _synced     = true;
+    _generation = g;
+    std::map<std::string, ClientRef> clients;
+    _cache.snapshot(clients);
+    for (auto i = _entries.begin(); i != _entries.end();) {
+        auto c = clients.find(i->first);
+        if ((c == clients.end()) || (c->second != i->second->client)) {
+            if (i->second->connecting)
+                _connecting--;
+            if (i->second->up)
+                _up--;
+            i = _entries.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+    for (auto& c : clients) {
+        if (_entries.find(c.first) != _entries.end())
+            continue;
+        EntryRef e(new Entry);
+        e->client = c.second;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            auto p      = _priorities.find(c.first);
+            e->priority = (p != _priorities.end()) ? p->second : 0;
+        }
+        if (c.second->getSessionState() == UA_SESSIONSTATE_ACTIVATED)
+            connected(*e);  // connected before it was handed over - watched from now on
+        _entries[c.first] = std::move(e);
+    }
+}
+
+/*!
+    \brief Open62541::ClientReconnector::jittered
+    \param d
+    \return d scaled by a random factor between 1 - jitter and 1
+*/
+std::chrono::milliseconds Open62541::ClientReconnector::jittered(std::chrono::milliseconds d)
+{
+    double j = 0.0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        j = _jitter;
+    }
+    std::uniform_real_distribution<double> u(1.0 - j, 1.0);
+    return std::chrono::milliseconds(std::chrono::milliseconds::rep(double(d.count()) * u(_random)));
+}
+
+/*!
+    \brief Open62541::ClientReconnector::connected
+    Note the session is up and keep the endpoint the stack selected for the next attempt
+    \param e
+*/
+void Open62541::ClientReconnector::connected(Entry& e)
+{
+    e.up      = true;
+    e.backoff = std::chrono::milliseconds(0);
+    _up++;
+    UA_Client* c = e.client->client();
+    if (!c)
+        return;
+    WriteLock l(e.client->mutex());
+    const UA_ClientConfig* config = UA_Client_getConfig(c);
+    if (config->endpoint.endpointUrl.length > 0) {
+        UA_EndpointDescription_clear(&e.endpoint);
+        UA_UserTokenPolicy_clear(&e.policy);
+        e.known = (UA_EndpointDescription_copy(&config->endpoint, &e.endpoint) == UA_STATUSCODE_GOOD) &&
+                  (UA_UserTokenPolicy_copy(&config->userTokenPolicy, &e.policy) == UA_STATUSCODE_GOOD);
+    }
+}
+
+/*!
+    \brief Open62541::ClientReconnector::failed
+    Schedule the next attempt with exponential backoff
+    \param e
+    \param now
+*/
+void Open62541::ClientReconnector::failed(Entry& e, Clock::time_point now)
+{
+    if (e.connecting) {
+        e.connecting = false;
+        _connecting--;
+    }
+    if (e.up) {
+        e.up = false;
+        _up--;
+    }
+    _failures++;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        e.backoff = (e.backoff.count() == 0) ? _minBackoff : std::min(_maxBackoff, e.backoff * 2);
+    }
+    e.nextAttempt = now + jittered(e.backoff);
+    try {
+        e.client->disconnect(true);  // keeps subscriptions if the client recovers them
+    }
+    catch (...) {
+        // never connected - nothing to close
+    }
+}
+
+/*!
+    \brief Open62541::ClientReconnector::dropped
+    A session that was up went away - retry after a random part of the first backoff so the clients dropped
+    by one outage come back spread out
+    \param e
+    \param now
+*/
+void Open62541::ClientReconnector::dropped(Entry& e, Clock::time_point now)
+{
+    e.up      = false;
+    e.backoff = std::chrono::milliseconds(0);
+    _up--;
+    std::chrono::milliseconds first;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        first = _minBackoff;
+    }
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> u(0, first.count());
+    e.nextAttempt = now + std::chrono::milliseconds(u(_random));
+}
+
+/*!
+    \brief Open62541::ClientReconnector::start
+    \param url
+    \param e
+    \param now
+    \return true if the attempt started
+*/
+bool Open62541::ClientReconnector::start(const std::string& url, Entry& e, Clock::time_point now)
+{
+    ConnectFunc f;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        f = _connect;
+    }
+    e.started = now;
+    _attempts++;
+    bool ok = false;
+    try {
+        e.client->initialise();  // a fresh stack client - subscriptions are kept for recovery
+        UA_Client* c = e.client->client();
+        if (c && f) {
+            if (e.known) {
+                // the stack skips endpoint discovery for a preset endpoint
+                UA_ClientConfig* config = UA_Client_getConfig(c);
+                UA_EndpointDescription_clear(&config->endpoint);
+                UA_UserTokenPolicy_clear(&config->userTokenPolicy);
+                UA_EndpointDescription_copy(&e.endpoint, &config->endpoint);
+                UA_UserTokenPolicy_copy(&e.policy, &config->userTokenPolicy);
+                _presets++;
+            }
+            ok = f(*e.client, url);
+        }
+    }
+    catch (...) {
+        ok = false;
+    }
+    if (!ok) {
+        failed(e, now);
+        return false;
+    }
+    e.connecting = true;
+    _connecting++;
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientReconnector::process
+    \return handshakes started
+*/
+size_t Open62541::ClientReconnector::process()
+{
+    sync();
+    const Clock::time_point now = Clock::now();
+    std::chrono::milliseconds timeout;
+    unsigned maxParallel = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        timeout     = _connectTimeout;
+        maxParallel = _maxParallel;
+    }
+    std::vector<std::pair<const std::string*, Entry*>> waiting;
+    for (auto& i : _entries) {
+        Entry& e  = *i.second;
+        Client& c = *e.client;
+        if (e.connecting) {
+            c.runIterate(0);  // advance the handshake without waiting
+            if (c.getConnectStatus() != UA_STATUSCODE_GOOD) {
+                failed(e, now);
+            }
+            else if (c.getSessionState() == UA_SESSIONSTATE_ACTIVATED) {
+                e.connecting = false;
+                _connecting--;
+                connected(e);
+            }
+            else if ((now - e.started) > timeout) {
+                failed(e, now);
+            }
+        }
+        else if (e.up && (c.getSessionState() != UA_SESSIONSTATE_ACTIVATED)) {
+            dropped(e, now);
+        }
+        if (!e.up && !e.connecting && (now >= e.nextAttempt))
+            waiting.push_back(std::make_pair(&i.first, &e));
+    }
+    if (_connecting >= maxParallel)
+        return 0;
+    // highest priority first, then the longest waiting
+    std::sort(waiting.begin(), waiting.end(), [](const std::pair<const std::string*, Entry*>& a,
+                                                 const std::pair<const std::string*, Entry*>& b) {
+        if (a.second->priority != b.second->priority)
+            return a.second->priority > b.second->priority;
+        return a.second->nextAttempt < b.second->nextAttempt;
+    });
+    size_t started = 0;
+    for (auto& w : waiting) {
+        if (_connecting >= maxParallel)
+            break;
+        if (start(*w.first, *w.second, now))
+            started++;
+    }
+    return started;
+}
@@ -53,6 +53,10 @@ Open62541::ClientSubscription::ClientSubscription(Client& c)
 */
 Open62541::ClientSubscription::~ClientSubscription()
 {
+    for (auto& n : _batch)
+        UA_DataValue_clear(&n.value);  // never dispatched
+    _batch.clear();
+    _retired.clear();
     if (id()) {
         _map.clear();  // delete all monitored items
         if (_client.client())
@@ -76,3 +80,337 @@ bool Open62541::ClientSubscription::create()
     }
     return false;
 }
+
+/*!
+    \brief Open62541::ClientSubscription::dataChangeNotifications
+    \param notifications
+    \param n
+*/
+void Open62541::ClientSubscription::dataChangeNotifications(DataChangeNotification* notifications, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (notifications[i].item && !notifications[i].item->retired())
+            notifications[i].item->dataChangeNotification(&notifications[i].value);
+    }
+}
+
+/*!
+    \brief Open62541::ClientSubscription::createItems
+    \param items
+    \param lock
+    \param results set to the create status per item
+    \return number created
+*/
+size_t Open62541::ClientSubscription::createItems(const std::vector<MonitoredItemDataChange*>& items,
+                                                  bool lock,
+                                                  std::vector<UA_StatusCode>& results)
+{
+    results.assign(items.size(), UA_STATUSCODE_BADINVALIDARGUMENT);
+    if (items.empty() || !_client.client() || (id() == 0))
+        return 0;
+    size_t batch = _client.maxMonitoredItemsPerCall();
+    if (batch == 0)
+        batch = 1000;  // no published limit - keep each request to a sensible size
+    //
+    std::vector<UA_MonitoredItemCreateRequest> requests(std::min(batch, items.size()));
+    std::vector<void*> contexts(requests.size());
+    std::vector<UA_Client_DataChangeNotificationCallback> callbacks(requests.size(),
+                                                                    MonitoredItem::dataChangeNotificationCallback);
+    std::vector<UA_Client_DeleteMonitoredItemCallback> deleteCallbacks(requests.size(),
+                                                                       MonitoredItem::deleteMonitoredItemCallback);
+    size_t created = 0;
+    for (size_t offset = 0; offset < items.size(); offset += batch) {
+        const size_t n = std::min(batch, items.size() - offset);
+        // one timestamp setting per request - items are grouped by the first in each chunk
+        const UA_TimestampsToReturn ts = items[offset]->_ts;
+        for (size_t i = 0; i < n; i++) {
+            MonitoredItemDataChange* m = items[offset + i];
+            // shallow - the node ids are only encoded
+            requests[i] = UA_MonitoredItemCreateRequest_default(*m->_nodeId.constRef());
+            requests[i].requestedParameters.samplingInterval = m->_samplingInterval;
+            requests[i].requestedParameters.queueSize        = m->_queueSize;
+            contexts[i]                                      = static_cast<MonitoredItem*>(m);
+        }
+        UA_CreateMonitoredItemsRequest req;
+        UA_CreateMonitoredItemsRequest_init(&req);
+        req.subscriptionId     = id();
+        req.timestampsToReturn = ts;
+        req.itemsToCreate      = requests.data();
+        req.itemsToCreateSize  = n;
+        UA_CreateMonitoredItemsResponse resp;
+        {
+            std::unique_ptr<WriteLock> l;
+            if (lock)
+                l.reset(new WriteLock(_client.mutex()));
+            resp = UA_Client_MonitoredItems_createDataChanges(_client.client(),
+                                                              req,
+                                                              contexts.data(),
+                                                              callbacks.data(),
+                                                              deleteCallbacks.data());
+        }
+        UA_StatusCode s = resp.responseHeader.serviceResult;
+        if ((s == UA_STATUSCODE_GOOD) && (resp.resultsSize != n))
+            s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+        for (size_t i = 0; i < n; i++) {
+            results[offset + i] = (s == UA_STATUSCODE_GOOD) ? resp.results[i].statusCode : s;
+            if (results[offset + i] == UA_STATUSCODE_GOOD) {
+                items[offset + i]->_response.adopt(resp.results[i]);
+                items[offset + i]->attachCache();
+                created++;
+            }
+        }
+        UA_CreateMonitoredItemsResponse_clear(&resp);
+    }
+    return created;
+}
+
+/*!
+    \brief Open62541::ClientSubscription::createDataChanges
+    \param items
+    \param nodes
+    \param ids
+    \param samplingInterval
+    \param queueSize
+    \param ts
+    \return number created
+*/
+size_t Open62541::ClientSubscription::createDataChanges(std::vector<MonitoredItemDataChange*>& items,
+                                                        const std::vector<NodeId>& nodes,
+                                                        std::vector<unsigned>& ids,
+                                                        double samplingInterval,
+                                                        UA_UInt32 queueSize,
+                                                        UA_TimestampsToReturn ts)
+{
+    ids.assign(nodes.size(), 0);
+    if ((items.size() != nodes.size()) || !_client.client() || (id() == 0)) {
+        for (auto m : items)
+            delete m;
+        items.clear();
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return 0;
+    }
+    for (size_t i = 0; i < items.size(); i++) {
+        items[i]->_nodeId = nodes[i];
+        items[i]->_ts     = ts;
+        items[i]->setSampling(samplingInterval, queueSize);
+    }
+    std::vector<UA_StatusCode> results;
+    size_t created = createItems(items, true, results);
+    _lastError     = UA_STATUSCODE_GOOD;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (results[i] == UA_STATUSCODE_GOOD) {
+            MonitoredItemRef r(items[i]);
+            ids[i] = addMonitorItem(r);
+        }
+        else {
+            if (_lastError == UA_STATUSCODE_GOOD)
+                _lastError = results[i];
+            delete items[i];  // never registered - nothing to delete on the server
+        }
+    }
+    items.clear();
+    return created;
+}
+
+/*!
+    \brief Open62541::ClientSubscription::invalidate
+*/
+void Open62541::ClientSubscription::invalidate()
+{
+    MonitoredItemMap::MapRef all = _map.snapshot();  // held - items deleted meanwhile stay valid
+    for (auto& i : *all) {
+        if (i.second)
+            i.second->invalidate();
+    }
+    _response.null();
+}
+
+/*!
+    \brief Open62541::ClientSubscription::recover
+    \param lock
+    \return true if the subscription was created again
+*/
+bool Open62541::ClientSubscription::recover(bool lock)
+{
+    if (id() == 0) {
+        std::unique_ptr<WriteLock> l;
+        if (lock)
+            l.reset(new WriteLock(_client.mutex()));
+        if (!create())
+            return false;
+    }
+    // data change items in bulk - the timestamp setting is per request so group by it
+    std::map<int, std::vector<MonitoredItemDataChange*>> groups;
+    std::vector<MonitoredItem*> others;
+    MonitoredItemMap::MapRef all = _map.snapshot();
+    for (auto& i : *all) {
+        MonitoredItem* m = i.second.get();
+        if (!m || (m->id() != 0))
+            continue;
+        if (m->isDataChange())
+            groups[int(m->_ts)].push_back(static_cast<MonitoredItemDataChange*>(m));
+        else
+            others.push_back(m);
+    }
+    _lastError = UA_STATUSCODE_GOOD;
+    std::vector<UA_StatusCode> results;
+    for (auto& g : groups) {
+        createItems(g.second, lock, results);
+        for (auto s : results) {
+            if ((s != UA_STATUSCODE_GOOD) && (_lastError == UA_STATUSCODE_GOOD))
+                _lastError = s;
+        }
+    }
+    for (auto m : others) {
+        std::unique_ptr<WriteLock> l;
+        if (lock)
+            l.reset(new WriteLock(_client.mutex()));
+        if (!m->recreate() && (_lastError == UA_STATUSCODE_GOOD))
+            _lastError = UA_STATUSCODE_BADMONITOREDITEMIDINVALID;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ClientSubscription::adapt
+    \param lock
+*/
+void Open62541::ClientSubscription::adapt(bool lock)
+{
+    if (!_adaptive)
+        return;
+    if (_load.perPublish) {  // one publish response per iteration as a rule - more only when they back up
+        _load.publishPeak = std::max(_load.publishPeak, _load.perPublish);
+        _load.perPublish  = 0;
+        _load.generation++;
+    }
+    const UA_DateTime now = UA_DateTime_nowMonotonic();
+    if (!_load.start)
+        _load.start = now;
+    if ((now - _load.start) < UA_DateTime(_limits.window * UA_DATETIME_MSEC) || !_client.client() || (id() == 0))
+        return;
+    //
+    // queues - grow those that overflowed or filled, shrink those that use a quarter or less
+    const double interval = _response.get().revisedPublishingInterval;
+    std::map<int, std::vector<std::pair<MonitoredItem*, UA_UInt32>>> resize;  // by timestamps to return
+    bool saturated = false;  // an item needs more than the largest queue
+    bool quiet     = true;   // every queue has room for half as many values again
+    MonitoredItemMap::MapRef all = _map.snapshot();
+    for (auto& i : *all) {
+        MonitoredItem* m = i.second.get();
+        if (!m || !m->isDataChange() || (m->id() == 0))
+            continue;
+        UA_UInt32 q = m->_response.get().revisedQueueSize;
+        if (!q)
+            q = m->_queueSize;
+        UA_UInt32 n = q;
+        if (m->_overflow || (m->_peak >= q)) {
+            n = std::min(std::max(q * 2, m->_peak * 2), _limits.maxQueueSize);
+            if (n <= q)
+                saturated = true;
+        }
+        else if ((m->_peak * 4 <= q) && (q > _limits.minQueueSize)) {
+            n = std::max(std::max(m->_peak * 2, UA_UInt32(1)), _limits.minQueueSize);
+        }
+        if (m->_peak * 3 > n * 2)
+            quiet = false;
+        if (n != q)
+            resize[int(m->_ts)].push_back(std::make_pair(m, n));
+        m->_peak     = 0;
+        m->_overflow = false;
+    }
+    //
+    // publishing interval - shorter only when the queues can grow no more, and not while responses back up,
+    // as a shorter interval then only adds traffic. Longer only when nothing was lost and the queues have room
+    const double excess = double(_load.maxDelay - _load.minDelay) / UA_DATETIME_MSEC;
+    double next         = interval;
+    if (saturated && (excess <= interval))
+        next = std::max(interval / 2, _limits.minPublishingInterval);
+    else if (quiet && !_load.overflows && (excess <= interval))
+        next = std::min(interval * 1.5, _limits.maxPublishingInterval);
+    UA_UInt32 maxNotifications = _settings.get().maxNotificationsPerPublish;
+    if (maxNotifications && (_load.publishPeak >= maxNotifications)) {
+        maxNotifications = (_limits.maxNotificationsPerPublish == 0)
+                               ? 0
+                               : std::min(maxNotifications * 2, _limits.maxNotificationsPerPublish);
+    }
+    // before the lock - the limits may still have to be read from the server
+    size_t batch = _client.maxMonitoredItemsPerCall();
+    if (batch == 0)
+        batch = 1000;
+    //
+    std::unique_ptr<WriteLock> l;
+    if (lock)
+        l.reset(new WriteLock(_client.mutex()));
+    if ((next != interval) || (maxNotifications != _settings.get().maxNotificationsPerPublish)) {
+        UA_ModifySubscriptionRequest req;
+        UA_ModifySubscriptionRequest_init(&req);
+        req.subscriptionId              = id();
+        req.requestedPublishingInterval = next;
+        req.requestedLifetimeCount      = _settings.get().requestedLifetimeCount;
+        req.requestedMaxKeepAliveCount  = _settings.get().requestedMaxKeepAliveCount;
+        req.maxNotificationsPerPublish  = maxNotifications;
+        req.priority                    = _settings.get().priority;
+        UA_ModifySubscriptionResponse resp = UA_Client_Subscriptions_modify(_client.client(), req);
+        if (resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+            // kept in the settings so recover() creates the subscription as it is now
+            _settings.get().requestedPublishingInterval = next;
+            _settings.get().maxNotificationsPerPublish  = maxNotifications;
+            _response.get().revisedPublishingInterval   = resp.revisedPublishingInterval;
+            _response.get().revisedLifetimeCount        = resp.revisedLifetimeCount;
+            _response.get().revisedMaxKeepAliveCount    = resp.revisedMaxKeepAliveCount;
+            _load.adjustments++;
+        }
+        else {
+            _lastError = resp.responseHeader.serviceResult;
+        }
+        UA_ModifySubscriptionResponse_clear(&resp);
+    }
+    //
+    for (auto& g : resize) {
+        auto& items = g.second;
+        for (size_t offset = 0; offset < items.size(); offset += batch) {
+            const size_t n = std::min(batch, items.size() - offset);
+            std::vector<UA_MonitoredItemModifyRequest> modify(n);
+            for (size_t i = 0; i < n; i++) {
+                MonitoredItem* m = items[offset + i].first;
+                UA_MonitoredItemModifyRequest_init(&modify[i]);
+                modify[i].monitoredItemId                      = m->id();
+                modify[i].requestedParameters.samplingInterval = m->_samplingInterval;
+                modify[i].requestedParameters.queueSize        = items[offset + i].second;
+                modify[i].requestedParameters.discardOldest    = true;
+                // the client handle is filled in by the stack
+            }
+            UA_ModifyMonitoredItemsRequest req;
+            UA_ModifyMonitoredItemsRequest_init(&req);
+            req.subscriptionId     = id();
+            req.timestampsToReturn = UA_TimestampsToReturn(g.first);
+            req.itemsToModify      = modify.data();  // shallow - not cleared
+            req.itemsToModifySize  = n;
+            UA_ModifyMonitoredItemsResponse resp = UA_Client_MonitoredItems_modify(_client.client(), req);
+            if ((resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) && (resp.resultsSize == n)) {
+                for (size_t i = 0; i < n; i++) {
+                    if (resp.results[i].statusCode != UA_STATUSCODE_GOOD)
+                        continue;
+                    MonitoredItem* m                           = items[offset + i].first;
+                    m->_queueSize                              = items[offset + i].second;
+                    m->_response.get().revisedQueueSize        = resp.results[i].revisedQueueSize;
+                    m->_response.get().revisedSamplingInterval = resp.results[i].revisedSamplingInterval;
+                    _load.adjustments++;
+                }
+            }
+            else {
+                _lastError = resp.responseHeader.serviceResult;
+            }
+            UA_ModifyMonitoredItemsResponse_clear(&resp);
+        }
+    }
+    //
+    _load.totalOverflows += _load.overflows;
+    _load.start         = now;
+    _load.publishPeak   = 0;
+    _load.notifications = 0;
+    _load.overflows     = 0;
+    _load.minDelay      = 0;  // clock offset is measured afresh so drift does not read as delay
+    _load.maxDelay      = 0;
+}
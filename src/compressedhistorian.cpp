@@ -0,0 +1,951 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/compressedhistorian.h>
+#include <algorithm>
+#include <type_traits>
+
+//
+// Bit stream helpers - most significant bit first
+//
+static void writeBits(std::vector<UA_Byte>& b, unsigned& freeBits, UA_UInt64 v, unsigned n)
+{
+    while (n) {
+        if (!freeBits) {
+            b.push_back(0);
+            freeBits = 8;
+        }
+        unsigned take = std::min(n, freeBits);
+        UA_Byte bits  = UA_Byte((v >> (n - take)) & ((1u << take) - 1));
+        b.back() |= UA_Byte(bits << (freeBits - take));
+        freeBits -= take;
+        n -= take;
+    }
+}
+
+/*!
+    \brief The BitReader class
+*/
+class BitReader
+{
+    const std::vector<UA_Byte>& _b;
+    size_t _pos = 0;  // bit position
+
+public:
+    BitReader(const std::vector<UA_Byte>& b)
+        : _b(b)
+    {
+    }
+    UA_UInt64 read(unsigned n)
+    {
+        UA_UInt64 r = 0;
+        while (n) {
+            size_t i       = _pos >> 3;
+            unsigned avail = 8 - unsigned(_pos & 7);
+            unsigned take  = std::min(n, avail);
+            UA_Byte b      = (i < _b.size()) ? _b[i] : 0;
+            r              = (r << take) | ((b >> (avail - take)) & ((1u << take) - 1));
+            _pos += take;
+            n -= take;
+        }
+        return r;
+    }
+    bool bit() { return read(1) != 0; }
+};
+
+#if defined(__GNUC__)
+static inline int leadingZeros(UA_UInt64 x) { return __builtin_clzll(x); }
+static inline int trailingZeros(UA_UInt64 x) { return __builtin_ctzll(x); }
+#else
+static inline int leadingZeros(UA_UInt64 x)
+{
+    int n = 0;
+    for (UA_UInt64 m = UA_UInt64(1) << 63; !(x & m); m >>= 1)
+        n++;
+    return n;
+}
+static inline int trailingZeros(UA_UInt64 x)
+{
+    int n = 0;
+    for (; !(x & 1); x >>= 1)
+        n++;
+    return n;
+}
+#endif
+
+static inline UA_UInt64 zigzag(UA_Int64 v) { return (UA_UInt64(v) << 1) ^ UA_UInt64(v >> 63); }
+static inline UA_Int64 unzigzag(UA_UInt64 z) { return UA_Int64(z >> 1) ^ -UA_Int64(z & 1); }
+
+//
+// Numeric scalars are held as 64 bit patterns - integers widened, floats as doubles so the XOR has trailing zeros
+//
+template <typename T>
+static UA_UInt64 intToBits(const void* p)
+{
+    T v = *static_cast<const T*>(p);
+    return std::is_signed<T>::value ? UA_UInt64(UA_Int64(v)) : UA_UInt64(v);
+}
+template <typename T>
+static void intFromBits(UA_UInt64 b, void* p)
+{
+    *static_cast<T*>(p) = T(b);
+}
+static UA_UInt64 floatToBits(const void* p)
+{
+    double d = *static_cast<const UA_Float*>(p);
+    UA_UInt64 b;
+    memcpy(&b, &d, sizeof(b));
+    return b;
+}
+static void floatFromBits(UA_UInt64 b, void* p)
+{
+    double d;
+    memcpy(&d, &b, sizeof(d));
+    *static_cast<UA_Float*>(p) = UA_Float(d);
+}
+static UA_UInt64 doubleToBits(const void* p)
+{
+    UA_UInt64 b;
+    memcpy(&b, p, sizeof(b));
+    return b;
+}
+static void doubleFromBits(UA_UInt64 b, void* p) { memcpy(p, &b, sizeof(b)); }
+
+struct NumericCodec {
+    int index;
+    UA_UInt64 (*toBits)(const void*);
+    void (*fromBits)(UA_UInt64, void*);
+};
+
+static const NumericCodec numericCodecs[] = {
+    {UA_TYPES_DOUBLE, doubleToBits, doubleFromBits},
+    {UA_TYPES_FLOAT, floatToBits, floatFromBits},
+    {UA_TYPES_INT32, intToBits<UA_Int32>, intFromBits<UA_Int32>},
+    {UA_TYPES_UINT32, intToBits<UA_UInt32>, intFromBits<UA_UInt32>},
+    {UA_TYPES_INT64, intToBits<UA_Int64>, intFromBits<UA_Int64>},
+    {UA_TYPES_UINT64, intToBits<UA_UInt64>, intFromBits<UA_UInt64>},
+    {UA_TYPES_INT16, intToBits<UA_Int16>, intFromBits<UA_Int16>},
+    {UA_TYPES_UINT16, intToBits<UA_UInt16>, intFromBits<UA_UInt16>},
+    {UA_TYPES_SBYTE, intToBits<UA_SByte>, intFromBits<UA_SByte>},
+    {UA_TYPES_BYTE, intToBits<UA_Byte>, intFromBits<UA_Byte>},
+    {UA_TYPES_BOOLEAN, intToBits<UA_Boolean>, intFromBits<UA_Boolean>},
+    {UA_TYPES_DATETIME, intToBits<UA_DateTime>, intFromBits<UA_DateTime>},
+    {UA_TYPES_STATUSCODE, intToBits<UA_StatusCode>, intFromBits<UA_StatusCode>}};
+
+static const NumericCodec* numericCodec(const UA_DataType* t)
+{
+    if (t) {
+        for (const NumericCodec& c : numericCodecs) {
+            if (t == &UA_TYPES[c.index])
+                return &c;
+        }
+    }
+    return nullptr;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::CompressedHistoryBackend
+    \param blockSize
+*/
+Open62541::CompressedHistoryBackend::CompressedHistoryBackend(size_t blockSize)
+{
+    setBlockSize(blockSize);
+    initialise();
+    database().getHistoryData = nullptr;  // the default database then uses the low level interface
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::column
+    \param n
+    \param create
+    \return column or nullptr
+*/
+Open62541::CompressedHistoryBackend::Column* Open62541::CompressedHistoryBackend::column(const NodeId& n, bool create)
+{
+    Column* c = _columns.value(*n.constRef());
+    if (!c && create) {
+        c = &_columns.put(*n.constRef());
+    }
+    return c;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::append
+    \param blocks
+    \param t timestamp - not before the last sample
+    \param s status
+    \param v value or nullptr
+*/
+void Open62541::CompressedHistoryBackend::append(std::vector<Block>& blocks,
+                                                 UA_DateTime t,
+                                                 UA_StatusCode s,
+                                                 const UA_Variant* v)
+{
+    const NumericCodec* codec = (v && UA_Variant_isScalar(v) && v->data) ? numericCodec(v->type) : nullptr;
+    Block* b                  = blocks.empty() ? nullptr : &blocks.back();
+    if (b) {
+        // a numeric block only takes values of its own type
+        bool mismatch = v && b->valueCount && !b->raw && (!codec || (v->type != b->type));
+        if (mismatch || (b->count >= _blockSize)) {
+            b->times.shrink_to_fit();  // sealed
+            b->values.shrink_to_fit();
+            b->raw_values.shrink_to_fit();
+            b->status.shrink_to_fit();
+            b = nullptr;
+        }
+    }
+    if (!b) {
+        size_t start = blocks.empty() ? 0 : blocks.back().start + blocks.back().count;
+        blocks.emplace_back();
+        b        = &blocks.back();
+        b->start = start;
+    }
+    //
+    // timestamp - delta of delta, zig zag encoded into prefixed buckets 0 / 10 / 110 / 1110 / 1111
+    if (b->count == 0) {
+        b->first = t;
+    }
+    else {
+        UA_Int64 delta = t - b->last;
+        UA_UInt64 z    = zigzag(delta - b->prevDelta);
+        b->prevDelta   = delta;
+        if (z == 0) {
+            writeBits(b->times, b->timesFree, 0, 1);
+        }
+        else if (z < (UA_UInt64(1) << 7)) {
+            writeBits(b->times, b->timesFree, 0x2, 2);
+            writeBits(b->times, b->timesFree, z, 7);
+        }
+        else if (z < (UA_UInt64(1) << 14)) {
+            writeBits(b->times, b->timesFree, 0x6, 3);
+            writeBits(b->times, b->timesFree, z, 14);
+        }
+        else if (z < (UA_UInt64(1) << 32)) {
+            writeBits(b->times, b->timesFree, 0xE, 4);
+            writeBits(b->times, b->timesFree, z, 32);
+        }
+        else {
+            writeBits(b->times, b->timesFree, 0xF, 4);
+            writeBits(b->times, b->timesFree, z, 64);
+        }
+    }
+    b->last = t;
+    //
+    // status - run length
+    bool hasValue = (v != nullptr);
+    if (!b->status.empty() && (b->status.back().status == s) && (b->status.back().hasValue == hasValue)) {
+        b->status.back().count++;
+    }
+    else {
+        StatusRun r;
+        r.status   = s;
+        r.hasValue = hasValue;
+        r.count    = 1;
+        b->status.push_back(r);
+    }
+    //
+    // value - XOR against the previous value
+    if (v) {
+        if (b->valueCount == 0) {
+            b->raw  = (codec == nullptr);
+            b->type = codec ? v->type : nullptr;
+        }
+        if (b->raw) {
+            b->raw_values.emplace_back(*v);
+        }
+        else {
+            UA_UInt64 bits = codec->toBits(v->data);
+            if (b->valueCount == 0) {
+                writeBits(b->values, b->valuesFree, bits, 64);
+            }
+            else {
+                UA_UInt64 x = bits ^ b->prevBits;
+                if (!x) {
+                    writeBits(b->values, b->valuesFree, 0, 1);
+                }
+                else {
+                    int lead  = std::min(leadingZeros(x), 31);
+                    int trail = trailingZeros(x);
+                    if ((b->leading >= 0) && (lead >= b->leading) && (trail >= b->trailing)) {
+                        // fits the previous window
+                        writeBits(b->values, b->valuesFree, 0x2, 2);
+                        writeBits(b->values, b->valuesFree, x >> b->trailing, 64 - b->leading - b->trailing);
+                    }
+                    else {
+                        int sig = 64 - lead - trail;
+                        writeBits(b->values, b->valuesFree, 0x3, 2);
+                        writeBits(b->values, b->valuesFree, UA_UInt64(lead), 5);
+                        writeBits(b->values, b->valuesFree, UA_UInt64(sig - 1), 6);
+                        writeBits(b->values, b->valuesFree, x >> trail, sig);
+                        b->leading  = lead;
+                        b->trailing = trail;
+                    }
+                }
+            }
+            b->prevBits = bits;
+        }
+        b->valueCount++;
+    }
+    b->count++;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::append
+    \param blocks
+    \param v
+*/
+void Open62541::CompressedHistoryBackend::append(std::vector<Block>& blocks, const UA_DataValue& v)
+{
+    append(blocks, historyKey(v), v.hasStatus ? v.status : UA_STATUSCODE_GOOD, v.hasValue ? &v.value : nullptr);
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::renumber
+    \param c
+    \param from first block whose start may be wrong
+*/
+void Open62541::CompressedHistoryBackend::renumber(Column& c, size_t from)
+{
+    size_t start = (from > 0 && from <= c.blocks.size()) ? c.blocks[from - 1].start + c.blocks[from - 1].count : 0;
+    if (from > c.blocks.size())
+        from = c.blocks.size();
+    for (size_t i = from; i < c.blocks.size(); i++) {
+        c.blocks[i].start = start;
+        start += c.blocks[i].count;
+    }
+    c.size = start;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::rewrite
+    Replace a run of blocks with the encoding of a sorted run of samples
+    \param c
+    \param block first block
+    \param count blocks replaced
+    \param samples
+*/
+void Open62541::CompressedHistoryBackend::rewrite(Column& c,
+                                                  size_t block,
+                                                  size_t count,
+                                                  std::vector<DataValue>& samples)
+{
+    std::vector<Block> nb;
+    for (DataValue& s : samples) {
+        append(nb, *s.constRef());
+    }
+    c.blocks.erase(c.blocks.begin() + block, c.blocks.begin() + block + count);
+    c.blocks.insert(c.blocks.begin() + block,
+                    std::make_move_iterator(nb.begin()),
+                    std::make_move_iterator(nb.end()));
+    renumber(c, block);
+    c.invalidate();
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::times
+    \param c
+    \param block
+    \return decoded timestamps of a block
+*/
+const std::vector<UA_DateTime>& Open62541::CompressedHistoryBackend::times(Column& c, size_t block)
+{
+    if (c.timesBlock != block) {
+        const Block& b = c.blocks[block];
+        c.decodedTimes.resize(b.count);
+        if (b.count) {
+            BitReader r(b.times);
+            UA_DateTime t  = b.first;
+            UA_Int64 delta = 0;
+            c.decodedTimes[0] = t;
+            for (size_t i = 1; i < b.count; i++) {
+                UA_UInt64 z = 0;
+                if (!r.bit())
+                    z = 0;
+                else if (!r.bit())
+                    z = r.read(7);
+                else if (!r.bit())
+                    z = r.read(14);
+                else if (!r.bit())
+                    z = r.read(32);
+                else
+                    z = r.read(64);
+                delta += unzigzag(z);
+                t += delta;
+                c.decodedTimes[i] = t;
+            }
+        }
+        c.timesBlock = block;
+    }
+    return c.decodedTimes;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::values
+    \param c
+    \param block
+    \return decoded data values of a block
+*/
+const std::vector<Open62541::DataValue>& Open62541::CompressedHistoryBackend::values(Column& c, size_t block)
+{
+    if (c.valuesBlock != block) {
+        const Block& b                   = c.blocks[block];
+        const std::vector<UA_DateTime>& t = times(c, block);
+        const NumericCodec* codec        = numericCodec(b.type);
+        c.decoded.clear();
+        c.decoded.resize(b.count);
+        BitReader r(b.values);
+        UA_UInt64 bits = 0;
+        int lead       = 0;
+        int trail      = 0;
+        size_t i       = 0;
+        size_t vi      = 0;  // value index
+        for (const StatusRun& s : b.status) {
+            for (UA_UInt32 j = 0; (j < s.count) && (i < b.count); j++, i++) {
+                UA_DataValue& d      = *c.decoded[i].ref();
+                d.hasSourceTimestamp = true;
+                d.sourceTimestamp    = t[i];
+                d.hasServerTimestamp = true;
+                d.serverTimestamp    = t[i];
+                if (s.status != UA_STATUSCODE_GOOD) {
+                    d.hasStatus = true;
+                    d.status    = s.status;
+                }
+                if (!s.hasValue)
+                    continue;
+                if (b.raw) {
+                    d.hasValue = (UA_Variant_copy(b.raw_values[vi].constRef(), &d.value) == UA_STATUSCODE_GOOD);
+                }
+                else if (codec) {
+                    if (vi == 0) {
+                        bits = r.read(64);
+                    }
+                    else if (r.bit()) {
+                        if (r.bit()) {
+                            lead    = int(r.read(5));
+                            int sig = int(r.read(6)) + 1;
+                            trail   = 64 - lead - sig;
+                        }
+                        bits ^= r.read(unsigned(64 - lead - trail)) << trail;
+                    }
+                    void* p = UA_new(b.type);
+                    if (p) {
+                        codec->fromBits(bits, p);
+                        UA_Variant_setScalar(&d.value, p, b.type);
+                        d.hasValue = true;
+                    }
+                }
+                vi++;
+            }
+        }
+        c.valuesBlock = block;
+    }
+    return c.decoded;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::blockOf
+    \param c
+    \param index
+    \return block holding a node index
+*/
+size_t Open62541::CompressedHistoryBackend::blockOf(const Column& c, size_t index) const
+{
+    auto i = std::upper_bound(c.blocks.begin(), c.blocks.end(), index, [](size_t n, const Block& b) {
+        return n < b.start;
+    });
+    return size_t(i - c.blocks.begin()) - 1;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::lowerBound
+    \param c
+    \param t
+    \return index of the first sample not before t, or the column size
+*/
+size_t Open62541::CompressedHistoryBackend::lowerBound(Column& c, UA_DateTime t)
+{
+    auto i = std::lower_bound(c.blocks.begin(), c.blocks.end(), t, [](const Block& b, UA_DateTime v) {
+        return b.last < v;
+    });
+    if (i == c.blocks.end())
+        return c.size;
+    size_t block                       = size_t(i - c.blocks.begin());
+    const std::vector<UA_DateTime>& ts = times(c, block);
+    return i->start + searchTime(ts.size(), t, false, [&ts](size_t n) { return ts[n]; }, interpolation());
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::upperBound
+    \param c
+    \param t
+    \return index of the first sample after t, or the column size
+*/
+size_t Open62541::CompressedHistoryBackend::upperBound(Column& c, UA_DateTime t)
+{
+    auto i = std::upper_bound(c.blocks.begin(), c.blocks.end(), t, [](UA_DateTime v, const Block& b) {
+        return v < b.last;
+    });
+    if (i == c.blocks.end())
+        return c.size;
+    size_t block                       = size_t(i - c.blocks.begin());
+    const std::vector<UA_DateTime>& ts = times(c, block);
+    return i->start + searchTime(ts.size(), t, true, [&ts](size_t n) { return ts[n]; }, interpolation());
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::store
+    \param c
+    \param v
+    \param replace allow an existing sample with the same timestamp to be replaced
+    \param insert allow a new sample to be added
+    \return true if stored
+*/
+bool Open62541::CompressedHistoryBackend::store(Column& c, const UA_DataValue& v, bool replace, bool insert)
+{
+    UA_DateTime t = historyKey(v);
+    if (c.blocks.empty() || (t > c.blocks.back().last)) {
+        // the usual case - append to the open block without decoding
+        if (!insert)
+            return false;
+        size_t last = c.blocks.size() - 1;
+        append(c.blocks, v);
+        c.size++;
+        if (c.valuesBlock == last)
+            c.valuesBlock = SIZE_MAX;
+        if (c.timesBlock == last)
+            c.timesBlock = SIZE_MAX;
+        return true;
+    }
+    //
+    // out of order - decode the block, merge and re-encode
+    auto i = std::lower_bound(c.blocks.begin(), c.blocks.end(), t, [](const Block& b, UA_DateTime x) {
+        return b.last < x;
+    });
+    size_t block                       = size_t(i - c.blocks.begin());
+    const std::vector<UA_DateTime>& ts = times(c, block);
+    size_t pos                         = size_t(std::lower_bound(ts.begin(), ts.end(), t) - ts.begin());
+    bool exists                        = (pos < ts.size()) && (ts[pos] == t);
+    if ((exists && !replace) || (!exists && !insert))
+        return false;
+    std::vector<DataValue> samples = values(c, block);
+    DataValue d;
+    UA_DataValue_copy(&v, d.ref());
+    if (exists)
+        samples[pos] = d;
+    else
+        samples.insert(samples.begin() + pos, d);
+    rewrite(c, block, 1, samples);
+    return true;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::size
+    \param n
+    \return samples
+*/
+size_t Open62541::CompressedHistoryBackend::size(const NodeId& n)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* c = column(n);
+    return c ? c->size : 0;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::nodeCount
+    \return nodes
+*/
+size_t Open62541::CompressedHistoryBackend::nodeCount()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _columns.size();
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::memoryUsed
+    \return bytes
+*/
+size_t Open62541::CompressedHistoryBackend::memoryUsed()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = 0;
+    for (auto& i : _columns) {
+        n += bytesOf(i.second);
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::bytesOf
+    \param c
+    \return bytes held by a column
+*/
+size_t Open62541::CompressedHistoryBackend::bytesOf(const Column& c)
+{
+    size_t n = sizeof(Column);
+    for (const Block& b : c.blocks) {
+        n += sizeof(Block) + b.times.capacity() + b.values.capacity() + (b.status.capacity() * sizeof(StatusRun)) +
+             (b.raw_values.capacity() * sizeof(Variant));
+        for (const Variant& v : b.raw_values) {
+            n += sizeof(UA_Variant) + (v.constRef()->type ? v.constRef()->type->memSize : 0);
+        }
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::memoryUsage
+    \param r
+*/
+void Open62541::CompressedHistoryBackend::memoryUsage(MemoryReport& r)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = 0;
+    for (auto& i : _columns) {
+        const size_t b = bytesOf(i.second) + MemoryReport::HashNode + sizeof(UA_NodeId);
+        if (r.detail())
+            r.add("history", b, i.second.size, toString(i.first));
+        n += b;
+    }
+    r.add("history", n, _columns.size());
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::clearNode
+    \param n
+*/
+void Open62541::CompressedHistoryBackend::clearNode(const NodeId& n)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _columns.remove(*n.constRef());
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::clearAll
+*/
+void Open62541::CompressedHistoryBackend::clearAll()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _columns.clearAll();
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::serverSetHistoryData
+    \param c
+    \param value
+    \return status
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::serverSetHistoryData(Context& c,
+                                                                        bool /*historizing*/,
+                                                                        const UA_DataValue* value)
+{
+    if (!value)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::lock_guard<std::mutex> l(_mutex);
+    store(*column(c.nodeId, true), *value, true, true);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::getDateTimeMatch
+    \param c
+    \param timestamp
+    \param strategy
+    \return index or the end index if there is no match
+*/
+size_t Open62541::CompressedHistoryBackend::getDateTimeMatch(Context& c,
+                                                              const UA_DateTime timestamp,
+                                                              const MatchStrategy strategy)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    if (!p || !p->size)
+        return 0;
+    return matchIndex(p->size, lowerBound(*p, timestamp), upperBound(*p, timestamp), strategy);
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::getEnd
+    \param c
+    \return index after the last sample
+*/
+size_t Open62541::CompressedHistoryBackend::getEnd(Context& c)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    return p ? p->size : 0;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::lastIndex
+    \param c
+    \return index of the last sample
+*/
+size_t Open62541::CompressedHistoryBackend::lastIndex(Context& c)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    return (p && p->size) ? p->size - 1 : 0;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::firstIndex
+    \return 0
+*/
+size_t Open62541::CompressedHistoryBackend::firstIndex(Context& /*c*/) { return 0; }
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::resultSize
+    \param c
+    \param startIndex
+    \param endIndex
+    \return number of samples in the range including both ends
+*/
+size_t Open62541::CompressedHistoryBackend::resultSize(Context& c, size_t startIndex, size_t endIndex)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    if (!p || !p->size || (startIndex >= p->size) || (endIndex >= p->size))
+        return 0;
+    return (startIndex <= endIndex) ? endIndex - startIndex + 1 : startIndex - endIndex + 1;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::copyDataValues
+    Decodes each block in the range once. The continuation point is the count of values already returned
+    \return status
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::copyDataValues(Context& c,
+                                                                   size_t startIndex,
+                                                                   size_t endIndex,
+                                                                   UA_Boolean reverse,
+                                                                   size_t valueSize,
+                                                                   UA_NumericRange range,
+                                                                   UA_Boolean /*releaseContinuationPoints*/,
+                                                                   std::string& in,
+                                                                   std::string& out,
+                                                                   size_t* providedValues,
+                                                                   UA_DataValue* values)
+{
+    size_t skip = 0;
+    if (!readContinuation(in, skip))
+        return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p      = column(c.nodeId);
+    size_t counter = 0;
+    if (p && p->size && (reverse ? (startIndex >= endIndex) : (startIndex <= endIndex))) {
+        size_t total = reverse ? startIndex - endIndex + 1 : endIndex - startIndex + 1;
+        if (skip > total)
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        size_t index = reverse ? startIndex - skip : startIndex + skip;
+        for (size_t n = skip; (n < total) && (counter < valueSize) && (index < p->size); n++) {
+            size_t block              = blockOf(*p, index);
+            const UA_DataValue& s     = *this->values(*p, block)[index - p->blocks[block].start].constRef();
+            UA_DataValue& d           = values[counter];
+            if (range.dimensionsSize > 0) {
+                UA_DataValue v = s;  // shallow - everything but the value
+                v.hasValue     = false;
+                UA_Variant_init(&v.value);
+                UA_DataValue_copy(&v, &d);
+                if (s.hasValue)
+                    d.hasValue = (UA_Variant_copyRange(&s.value, &d.value, range) == UA_STATUSCODE_GOOD);
+            }
+            else {
+                UA_DataValue_copy(&s, &d);
+            }
+            counter++;
+            if (reverse) {
+                if (index == 0)
+                    break;
+                index--;
+            }
+            else {
+                index++;
+            }
+        }
+        if ((total - skip) > counter)
+            writeContinuation(out, skip + counter);
+    }
+    if (providedValues)
+        *providedValues = counter;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::getDataValue
+    The value stays valid until the node's history is next read or changed
+    \param c
+    \param index
+    \return data value or nullptr
+*/
+const UA_DataValue* Open62541::CompressedHistoryBackend::getDataValue(Context& c, size_t index)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    if (!p || (index >= p->size))
+        return nullptr;
+    size_t block = blockOf(*p, index);
+    return values(*p, block)[index - p->blocks[block].start].constRef();
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::insertDataValue
+    \return BADENTRYEXISTS if there is already a value at the timestamp
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::insertDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(*column(c.nodeId, true), *value, false, true) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADENTRYEXISTS;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::insertDataValues
+    The batch is sorted then merged with the blocks its time range covers, which are decoded and
+    re-encoded once - a batch after the last sample is appended without decoding anything
+    \return status of the call - each value's status is in results
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::insertDataValues(Context& c,
+                                                                    const UA_DataValue* values,
+                                                                    size_t n,
+                                                                    UA_StatusCode* results)
+{
+    if (!values || !results)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::vector<size_t> order = historyOrder(values, n, results);
+    if (order.empty())
+        return UA_STATUSCODE_GOOD;
+    std::lock_guard<std::mutex> l(_mutex);
+    Column& col      = *column(c.nodeId, true);
+    UA_DateTime from = values[order.front()].sourceTimestamp;
+    UA_DateTime to   = values[order.back()].sourceTimestamp;
+    if (col.blocks.empty() || (from > col.blocks.back().last)) {
+        for (size_t i : order) {
+            store(col, values[i], false, true);
+        }
+        return UA_STATUSCODE_GOOD;
+    }
+    //
+    // the blocks from the first holding a time at or after the start of the batch to the first holding
+    // one at or after its end - later values go after the last block
+    auto key = [](const Block& b, UA_DateTime x) { return b.last < x; };
+    size_t first = size_t(std::lower_bound(col.blocks.begin(), col.blocks.end(), from, key) - col.blocks.begin());
+    size_t last  = size_t(std::lower_bound(col.blocks.begin() + first, col.blocks.end(), to, key) - col.blocks.begin());
+    if (last == col.blocks.size())
+        last--;
+    std::vector<DataValue> merged;
+    merged.reserve(col.blocks[last].start + col.blocks[last].count - col.blocks[first].start + order.size());
+    size_t j = 0;
+    for (size_t b = first; b <= last; b++) {
+        const std::vector<UA_DateTime>& ts = times(col, b);
+        const std::vector<DataValue>& vs   = values(col, b);
+        for (size_t k = 0; k < vs.size(); k++) {
+            for (; (j < order.size()) && (values[order[j]].sourceTimestamp <= ts[k]); j++) {
+                if (values[order[j]].sourceTimestamp == ts[k]) {
+                    results[order[j]] = UA_STATUSCODE_BADENTRYEXISTS;
+                }
+                else {
+                    merged.emplace_back();
+                    UA_DataValue_copy(&values[order[j]], merged.back().ref());
+                }
+            }
+            merged.push_back(vs[k]);
+        }
+    }
+    for (; j < order.size(); j++) {
+        merged.emplace_back();
+        UA_DataValue_copy(&values[order[j]], merged.back().ref());
+    }
+    rewrite(col, first, last - first + 1, merged);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::replaceDataValue
+    \return BADNOENTRYEXISTS if there is no value at the timestamp
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::replaceDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    return (p && store(*p, *value, true, false)) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADNOENTRYEXISTS;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::updateDataValue
+    Insert or replace
+    \return status
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::updateDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    store(*column(c.nodeId, true), *value, true, true);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::CompressedHistoryBackend::removeDataValue
+    Removes samples from startTimestamp up to but not including endTimestamp, or at startTimestamp if they are equal
+    \return status
+*/
+UA_StatusCode Open62541::CompressedHistoryBackend::removeDataValue(Context& c,
+                                                                   UA_DateTime startTimestamp,
+                                                                   UA_DateTime endTimestamp)
+{
+    if (startTimestamp > endTimestamp)
+        return UA_STATUSCODE_BADTIMESTAMPNOTSUPPORTED;
+    std::lock_guard<std::mutex> l(_mutex);
+    Column* p = column(c.nodeId);
+    if (!p)
+        return UA_STATUSCODE_GOOD;
+    auto inRange = [startTimestamp, endTimestamp](UA_DateTime t) {
+        return (startTimestamp == endTimestamp) ? (t == startTimestamp)
+                                                : ((t >= startTimestamp) && (t < endTimestamp));
+    };
+    size_t block = 0;
+    while ((block < p->blocks.size()) && (p->blocks[block].last < startTimestamp))
+        block++;
+    while ((block < p->blocks.size()) &&
+           ((p->blocks[block].first < endTimestamp) || (p->blocks[block].first == startTimestamp))) {
+        const std::vector<DataValue>& v = values(*p, block);
+        std::vector<DataValue> kept;
+        kept.reserve(v.size());
+        for (const DataValue& d : v) {
+            if (!inRange(d.constRef()->sourceTimestamp))
+                kept.push_back(d);
+        }
+        if (kept.size() == v.size()) {
+            block++;
+            continue;
+        }
+        size_t before = p->blocks.size();
+        rewrite(*p, block, 1, kept);
+        block += (p->blocks.size() + 1) - before;  // blocks that replaced the old one
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::CompressedMemoryHistorian::CompressedMemoryHistorian
+    \param numberNodes
+    \param blockSize
+*/
+Open62541::CompressedMemoryHistorian::CompressedMemoryHistorian(size_t numberNodes, size_t blockSize)
+    : _store(blockSize)
+{
+    gathering() = UA_HistoryDataGathering_Default(numberNodes);
+    database()  = UA_HistoryDatabase_default(gathering());
+    backend()   = _store.database();
+}
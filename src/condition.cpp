@@ -1,8 +1,29 @@
 
 #include <open62541cpp/condition.h>
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/alarmfilter.h>
+#include <open62541cpp/memoryreport.h>
+#include <algorithm>
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
 
+namespace {
+/*!
+    \brief activeState
+    \param field
+    \param property
+    \param v value written
+    \return 1 or 0 if this is a write of ActiveState/Id, -1 if not
+*/
+int activeState(const std::string& field, const std::string& property, const Open62541::Variant& v)
+{
+    const UA_Variant* p = v.constRef();
+    if ((field == "ActiveState") && (property == "Id") && p && UA_Variant_isScalar(p) &&
+        (p->type == &UA_TYPES[UA_TYPES_BOOLEAN]))
+        return *static_cast<const UA_Boolean*>(p->data) ? 1 : 0;
+    return -1;
+}
+}  // namespace
+
 /*!
  * \brief Open62541::Condition::Condition
  * \param s
@@ -52,6 +73,9 @@ bool Open62541::Condition::setConditionVariableFieldProperty(const Variant& valu
     QualifiedName fn(_condition.nameSpaceIndex(), variableFieldName);
     QualifiedName pn(_condition.nameSpaceIndex(), variablePropertyName);
     _lastError = UA_Server_setConditionVariableFieldProperty(_server, _condition, value, fn, pn);
+    const int a = activeState(variableFieldName, variablePropertyName, value);
+    if (lastOK() && (a >= 0))
+        markActive(a != 0);
     return lastOK();
 }
 /*!
@@ -61,11 +85,135 @@ bool Open62541::Condition::setConditionVariableFieldProperty(const Variant& valu
  */
 bool Open62541::Condition::triggerConditionEvent(const std::string& outEventId)
 {
+    AlarmFloodFilter* f = _server.alarmFilter();
+    if (f && (f->admit(*this) != AlarmFloodFilter::Emit)) {
+        _lastError = UA_STATUSCODE_GOOD;  // filtered - not an error
+        return true;
+    }
     ByteString b(outEventId);
     _lastError = UA_Server_triggerConditionEvent(_server, _condition, _conditionSource, b);
     return lastOK();
 }
 
+/*!
+ * \brief Open62541::Condition::fieldNodeId
+ * \param field
+ * \param property
+ * \return
+ */
+const Open62541::NodeId* Open62541::Condition::fieldNodeId(const std::string& field, const std::string& property)
+{
+    std::string key = field;
+    if (!property.empty()) {
+        key += '\x1f';  // unit separator - not expected in browse names
+        key += property;
+    }
+    auto i = _fields.find(key);
+    if (i != _fields.end())
+        return &i->second;
+    //
+    UA_QualifiedName path[2];
+    path[0] = UA_QUALIFIEDNAME(_condition.nameSpaceIndex(), const_cast<char*>(field.c_str()));
+    path[1] = UA_QUALIFIEDNAME(_condition.nameSpaceIndex(), const_cast<char*>(property.c_str()));
+    UA_BrowsePathResult r =
+        UA_Server_browseSimplifiedBrowsePath(_server.server(), _condition, property.empty() ? 1 : 2, path);
+    const NodeId* ret = nullptr;
+    _lastError        = r.statusCode;
+    if ((r.statusCode == UA_STATUSCODE_GOOD) && (r.targetsSize > 0)) {
+        ret = &(_fields[key] = NodeId(r.targets[0].targetId.nodeId));
+    }
+    else if (lastOK()) {
+        _lastError = UA_STATUSCODE_BADNOMATCH;
+    }
+    UA_BrowsePathResult_clear(&r);
+    return ret;
+}
+
+/*!
+ * \brief Open62541::Condition::Transaction::stage
+ * \param n
+ * \param v
+ */
+void Open62541::Condition::Transaction::stage(const NodeId* n, const Variant& v)
+{
+    if (!n) {
+        _lastError = _c.lastError();
+        return;
+    }
+    for (auto& w : _writes) {
+        if (w.first == n) {  // cached ids are unique per field
+            w.second = v;
+            return;
+        }
+    }
+    _writes.emplace_back(n, v);
+}
+
+/*!
+ * \brief Open62541::Condition::Transaction::setField
+ * \param name
+ * \param v
+ * \return
+ */
+Open62541::Condition::Transaction& Open62541::Condition::Transaction::setField(const std::string& name,
+                                                                               const Variant& v)
+{
+    stage(_c.fieldNodeId(name), v);
+    return *this;
+}
+
+/*!
+ * \brief Open62541::Condition::Transaction::setProperty
+ * \param field
+ * \param property
+ * \param v
+ * \return
+ */
+Open62541::Condition::Transaction& Open62541::Condition::Transaction::setProperty(const std::string& field,
+                                                                                  const std::string& property,
+                                                                                  const Variant& v)
+{
+    stage(_c.fieldNodeId(field, property), v);
+    const int a = activeState(field, property, v);
+    if (a >= 0)
+        _active = a;
+    return *this;
+}
+
+/*!
+ * \brief Open62541::Condition::Transaction::commit
+ * \param trigger
+ * \return
+ */
+bool Open62541::Condition::Transaction::commit(bool trigger)
+{
+    if (lastOK()) {
+        UA_Server* s = _c.server().server();
+        for (auto& w : _writes) {
+            _lastError = UA_Server_writeValue(s, *w.first, w.second);
+            if (!lastOK())
+                break;
+        }
+        _eventId.clear();  // stays empty if the flood filter holds the event back
+        AlarmFloodFilter* f = _c.server().alarmFilter();
+        if (lastOK() && trigger && (!f || (f->admit(_c) == AlarmFloodFilter::Emit))) {
+            UA_ByteString id = UA_BYTESTRING_NULL;
+            _lastError       = UA_Server_triggerConditionEvent(s, _c.condition(), _c.conditionSource(), &id);
+            if (id.length)
+                _eventId.assign(reinterpret_cast<const char*>(id.data), id.length);
+            UA_ByteString_clear(&id);
+        }
+    }
+    if (lastOK() && (_active >= 0))
+        _c.markActive(_active != 0);
+    _writes.clear();
+    _active       = -1;
+    _c._lastError = _lastError;
+    const bool ok = lastOK();
+    _lastError    = UA_STATUSCODE_GOOD;
+    return ok;
+}
+
 /*!
  * \brief Open62541::Condition::addConditionOptionalField
  * \param conditionType
@@ -87,7 +235,7 @@ UA_StatusCode Open62541::Condition::twoStateVariableChangeEnabledStateCallback(U
 {
     Open62541::Server* s = Open62541::Server::findServer(server);
     if (s) {
-        ConditionPtr& c = s->findCondition(condition);
+        ConditionPtr c = s->findCondition(condition);
         if (c) {
             if (c->enteringEnabledState())
                 return UA_STATUSCODE_GOOD;
@@ -100,7 +248,7 @@ UA_StatusCode Open62541::Condition::twoStateVariableChangeAckedStateCallback(UA_
 {
     Open62541::Server* s = Open62541::Server::findServer(server);
     if (s) {
-        ConditionPtr& c = s->findCondition(condition);
+        ConditionPtr c = s->findCondition(condition);
         if (c) {
             if (c->enteringAckedState())
                 return UA_STATUSCODE_GOOD;
@@ -113,7 +261,7 @@ UA_StatusCode Open62541::Condition::twoStateVariableChangeConfirmedStateCallback
 {
     Open62541::Server* s = Open62541::Server::findServer(server);
     if (s) {
-        ConditionPtr& c = s->findCondition(condition);
+        ConditionPtr c = s->findCondition(condition);
         if (c) {
             if (c->enteringConfirmedState())
                 return UA_STATUSCODE_GOOD;
@@ -126,8 +274,9 @@ UA_StatusCode Open62541::Condition::twoStateVariableChangeActiveStateCallback(UA
 {
     Open62541::Server* s = Open62541::Server::findServer(server);
     if (s) {
-        ConditionPtr& c = s->findCondition(condition);
+        ConditionPtr c = s->findCondition(condition);
         if (c) {
+            c->markActive(true);
             if (c->enteringActiveState())
                 return UA_STATUSCODE_GOOD;
         }
@@ -184,4 +333,256 @@ bool Open62541::Condition::setCallback(UA_TwoStateVariableCallbackType callbackT
     }
     return lastOK();
 }
+/*!
+ * \brief Open62541::Condition::markActive
+ * \param f
+ */
+void Open62541::Condition::markActive(bool f) { _server.conditions().setActive(this, f); }
+
+/*!
+ * \brief Open62541::ConditionManager::unlink
+ * \param c
+ */
+void Open62541::ConditionManager::unlink(Condition* c)
+{
+    if (!c->_active)
+        return;
+    if (c->_activePrev)
+        c->_activePrev->_activeNext = c->_activeNext;
+    else
+        _activeHead = c->_activeNext;
+    if (c->_activeNext)
+        c->_activeNext->_activePrev = c->_activePrev;
+    c->_activePrev = c->_activeNext = nullptr;
+    c->_active                      = false;
+    _activeCount--;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::add
+ * \param c
+ * \return
+ */
+Open62541::Condition* Open62541::ConditionManager::add(ConditionPtr&& c)
+{
+    if (!c)
+        return nullptr;
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    remove(c->condition());
+    Condition* p = c.get();
+    UA_NodeId k;  // the map owns a deep copy of the key
+    UA_NodeId_init(&k);
+    UA_NodeId_copy(c->condition().constRef(), &k);
+    _conditions.emplace(k, std::move(c));
+    std::vector<Condition*>* v = _sources.value(p->conditionSource());
+    if (!v)
+        v = &_sources.put(p->conditionSource());
+    v->push_back(p);
+    return p;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::find
+ * \param condition
+ * \return
+ */
+Open62541::ConditionPtr Open62541::ConditionManager::find(const UA_NodeId& condition)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    auto i = _conditions.find(condition);
+    if (i != _conditions.end())
+        return i->second;
+    return ConditionPtr();
+}
+
+/*!
+ * \brief Open62541::ConditionManager::remove
+ * \param condition
+ * \return
+ */
+bool Open62541::ConditionManager::remove(const UA_NodeId& condition)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    auto i = _conditions.find(condition);
+    if (i == _conditions.end())
+        return false;
+    Condition* c = i->second.get();
+    if (c) {
+        unlink(c);
+        std::vector<Condition*>* v = _sources.value(c->conditionSource());
+        if (v) {
+            v->erase(std::remove(v->begin(), v->end(), c), v->end());
+            if (v->empty())
+                _sources.remove(c->conditionSource());
+        }
+    }
+    ConditionPtr p = std::move(i->second);  // destroyed once the indexes no longer refer to it
+    _conditions.remove(condition);
+    return true;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::memoryUsage
+ * \param r
+ */
+void Open62541::ConditionManager::memoryUsage(MemoryReport& r) const
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    size_t bytes = 0;
+    for (const auto& i : _conditions) {
+        size_t b = MemoryReport::HashNode + sizeof(i) + MemoryReport::heapOf(i.first);
+        if (i.second) {
+            b += sizeof(Condition);
+            for (const auto& f : i.second->_fields) {
+                b += MemoryReport::HashNode + sizeof(f) + MemoryReport::heapOf(f.first) +
+                     MemoryReport::heapOf(*f.second.constRef());
+            }
+        }
+        if (r.detail())
+            r.add("conditions", b, 1, toString(i.first));
+        bytes += b;
+    }
+    for (const auto& s : _sources) {
+        bytes += MemoryReport::HashNode + sizeof(s) + MemoryReport::heapOf(s.first) + MemoryReport::heapOf(s.second);
+    }
+    r.add("conditions", bytes, _conditions.size());
+}
+
+/*!
+ * \brief Open62541::ConditionManager::clear
+ */
+void Open62541::ConditionManager::clear()
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    while (_activeHead)
+        unlink(_activeHead);
+    _sources.clearAll();
+    std::vector<ConditionPtr> l2;  // destroy outside of the map - destructors call into the stack
+    l2.reserve(_conditions.size());
+    for (auto i = _conditions.begin(); i != _conditions.end(); i++) {
+        l2.push_back(std::move(i->second));
+    }
+    _conditions.clearAll();
+}
+
+/*!
+ * \brief Open62541::ConditionManager::setActive
+ * \param c
+ * \param f
+ */
+void Open62541::ConditionManager::setActive(Condition* c, bool f)
+{
+    if (!c)
+        return;
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    if (f == c->_active)
+        return;
+    if (f) {
+        ConditionPtr* p = _conditions.value(c->condition());
+        if (!p || p->get() != c)
+            return;  // removed while held by a caller of find - not to be listed again
+        c->_activePrev = nullptr;
+        c->_activeNext = _activeHead;
+        if (_activeHead)
+            _activeHead->_activePrev = c;
+        _activeHead = c;
+        c->_active  = true;
+        _activeCount++;
+    }
+    else {
+        unlink(c);
+    }
+}
+
+/*!
+ * \brief Open62541::ConditionManager::forEach
+ * \param f
+ * \return
+ */
+size_t Open62541::ConditionManager::forEach(const ConditionVisitor& f)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    size_t n = 0;
+    for (auto i = _conditions.begin(); i != _conditions.end(); i++) {
+        if (i->second) {
+            f(*i->second);
+            n++;
+        }
+    }
+    return n;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::forSource
+ * \param source
+ * \param f
+ * \return
+ */
+size_t Open62541::ConditionManager::forSource(const UA_NodeId& source, const ConditionVisitor& f)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    std::vector<Condition*>* v = _sources.value(source);
+    if (!v)
+        return 0;
+    for (Condition* c : *v) {
+        f(*c);
+    }
+    return v->size();
+}
+
+/*!
+ * \brief Open62541::ConditionManager::forEachActive
+ * \param f
+ * \return
+ */
+size_t Open62541::ConditionManager::forEachActive(const ConditionVisitor& f)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    size_t n = 0;
+    for (Condition* c = _activeHead; c;) {
+        Condition* next = c->_activeNext;  // the visitor may mark c inactive
+        f(*c);
+        n++;
+        c = next;
+    }
+    return n;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::forEachActive
+ * \param source
+ * \param f
+ * \return
+ */
+size_t Open62541::ConditionManager::forEachActive(const UA_NodeId& source, const ConditionVisitor& f)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    size_t n = 0;
+    for (Condition* c = _activeHead; c;) {
+        Condition* next = c->_activeNext;
+        if (UA_NodeId_equal(c->conditionSource().constRef(), &source)) {
+            f(*c);
+            n++;
+        }
+        c = next;
+    }
+    return n;
+}
+
+/*!
+ * \brief Open62541::ConditionManager::active
+ * \param l
+ * \param source
+ */
+void Open62541::ConditionManager::active(std::vector<Condition*>& l, const UA_NodeId& source)
+{
+    std::lock_guard<std::recursive_mutex> g(_mutex);
+    l.clear();
+    l.reserve(_activeCount);
+    const bool all = UA_NodeId_isNull(&source);
+    for (Condition* c = _activeHead; c; c = c->_activeNext) {
+        if (all || UA_NodeId_equal(c->conditionSource().constRef(), &source))
+            l.push_back(c);
+    }
+}
 #endif
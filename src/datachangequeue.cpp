@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/datachangequeue.h>
+#include <chrono>
+
+/*!
+    \brief Open62541::DataChangeQueue::~DataChangeQueue
+*/
+Open62541::DataChangeQueue::~DataChangeQueue()
+{
+    stop();
+    drain(false);
+}
+
+/*!
+    \brief Open62541::DataChangeQueue::drain
+    \param dispatch pass each value to the handler before freeing it
+*/
+void Open62541::DataChangeQueue::drain(bool dispatch)
+{
+    Entry e;
+    while (_queue.pop(e)) {
+        if (dispatch && _handler) {
+            try {
+                _handler(e.monId, e.value);
+            }
+            catch (...) {
+                // a failing handler must not stop the consumer
+            }
+            _delivered++;
+        }
+        UA_DataValue_clear(&e.value);
+    }
+}
+
+/*!
+    \brief Open62541::DataChangeQueue::consume
+*/
+void Open62541::DataChangeQueue::consume()
+{
+    while (_running) {
+        if (_queue.empty()) {
+            // announce the sleep then look again so a push in between is not missed - the timed wait covers
+            // the remaining window
+            _sleeping = true;
+            std::unique_lock<std::mutex> l(_waitMutex);
+            if (_queue.empty() && _running)
+                _wake.wait_for(l, std::chrono::milliseconds(10));
+            _sleeping = false;
+            continue;
+        }
+        drain(true);
+    }
+    drain(true);  // finish what was queued before stop
+}
+
+/*!
+    \brief Open62541::DataChangeQueue::start
+    \param h
+    \return true if started
+*/
+bool Open62541::DataChangeQueue::start(Handler h)
+{
+    if (_running || !h)
+        return false;
+    _handler = h;
+    _running = true;
+    try {
+        _thread = std::thread([this] {
+            _threadConfig.apply();
+            consume();
+        });
+    }
+    catch (...) {
+        _running = false;
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::DataChangeQueue::stop
+*/
+void Open62541::DataChangeQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(_waitMutex);
+        _running = false;
+    }
+    _wake.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+/*!
+    \brief Open62541::DataChangeQueue::push
+    \param monId
+    \param value
+    \return true if queued
+*/
+bool Open62541::DataChangeQueue::push(UA_UInt32 monId, UA_DataValue* value)
+{
+    Entry e;
+    e.monId = monId;
+    e.value = *value;  // shallow - ownership passes to the queue only if the push succeeds
+    bool queued = _queue.push(e);
+    while (!queued && (_policy == OverflowPolicy::Block) && _running) {
+        std::this_thread::yield();
+        queued = _queue.push(e);
+    }
+    if (!queued) {
+        _dropped++;
+        return false;  // the stack still owns and clears the value
+    }
+    UA_DataValue_init(value);
+    if (_sleeping) {
+        std::lock_guard<std::mutex> l(_waitMutex);
+        _wake.notify_one();
+    }
+    return true;
+}
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/derivedtags.h>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/historyaggregates.h>
+#include <open62541cpp/writefilter.h>
+#include <algorithm>
+#include <deque>
+#include <set>
+
+/*!
+    \brief Open62541::DerivedTags::DerivedTags
+    \param s
+*/
+Open62541::DerivedTags::DerivedTags(Server& s)
+    : NodeContext("DerivedTags")
+    , _server(s)
+    , _self(std::make_shared<Self>())
+{
+    _self->engine = this;
+}
+
+/*!
+    \brief Open62541::DerivedTags::~DerivedTags
+*/
+Open62541::DerivedTags::~DerivedTags()
+{
+    std::vector<NodeId> watched;
+    {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        watched.swap(_watched);
+    }
+    if (_server.server()) {
+        for (auto& n : watched) {
+            void* c = nullptr;
+            if ((UA_Server_getNodeContext(_server.server(), n.get(), &c) == UA_STATUSCODE_GOOD) && (c == this))
+                _server.setNodeContext(n, nullptr);  // later writes no longer reach this object
+        }
+    }
+    std::lock_guard<std::mutex> l(_self->mutex);  // waits for a batch in flight
+    _self->engine = nullptr;                      // posted batches become no-ops
+}
+
+/*!
+    \brief Open62541::DerivedTags::add
+    \param output
+    \param inputs
+    \param f
+    \param watch
+    \return
+*/
+bool Open62541::DerivedTags::add(const NodeId& output, const std::vector<NodeId>& inputs, Func f, bool watch)
+{
+    {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        if (_outputs.value(output.get()))
+            return false;
+        _outputs.put(output.get(), _tags.size());
+        _tags.emplace_back();
+        Tag& t   = _tags.back();
+        t.node   = output;
+        t.inputs = inputs;
+        t.func   = f;
+        _ordered = false;
+        _live++;
+    }
+    if (watch) {
+        for (const auto& i : inputs) {
+            this->watch(i);  // skips derived inputs, fails harmlessly for nodes with their own context
+        }
+    }
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _changed.push_back(output);  // compute it in the next batch
+    }
+    schedule();
+    return true;
+}
+
+/*!
+    \brief Open62541::DerivedTags::addNumeric
+    \param output
+    \param inputs
+    \param f
+    \param watch
+    \return
+*/
+bool Open62541::DerivedTags::addNumeric(const NodeId& output,
+                                        const std::vector<NodeId>& inputs,
+                                        NumericFunc f,
+                                        bool watch)
+{
+    return add(
+        output,
+        inputs,
+        [f](const std::vector<Variant>& in, Variant& result) {
+            std::vector<double> d(in.size());
+            UA_DataValue v;
+            UA_DataValue_init(&v);
+            v.hasValue = true;
+            for (size_t i = 0; i < in.size(); i++) {
+                v.value = in[i].get();  // shallow - not cleared
+                if (!HistoryAggregates::toDouble(v, d[i]))
+                    return false;
+            }
+            result = Variant(f(d));
+            return true;
+        },
+        watch);
+}
+
+/*!
+    \brief Open62541::DerivedTags::remove
+    \param output
+    \return
+*/
+bool Open62541::DerivedTags::remove(const NodeId& output)
+{
+    std::lock_guard<std::mutex> l(_graphMutex);
+    size_t* i = _outputs.value(output.get());
+    if (!i)
+        return false;
+    Tag& t    = _tags[*i];
+    t.removed = true;
+    t.func    = Func();
+    t.last.null();
+    _outputs.remove(output.get());
+    _ordered = false;
+    _live--;
+    return true;
+}
+
+/*!
+    \brief Open62541::DerivedTags::watch
+    \param input
+    \return
+*/
+bool Open62541::DerivedTags::watch(const NodeId& input)
+{
+    if (!_server.server())
+        return false;
+    {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        if (_outputs.value(input.get()))
+            return false;  // written by recompute - watching it would only schedule a redundant batch
+    }
+    void* c = nullptr;
+    if (UA_Server_getNodeContext(_server.server(), input.get(), &c) != UA_STATUSCODE_GOOD)
+        return false;
+    if (c && (c != this))
+        return false;
+    NodeId n(input);
+    if (!_server.setNodeContext(n, this) || !setValueCallback(_server, n))
+        return false;
+    if (!c) {
+        std::lock_guard<std::mutex> l(_graphMutex);
+        _watched.push_back(n);
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::DerivedTags::changed
+    \param input
+    \param value
+*/
+void Open62541::DerivedTags::changed(const UA_NodeId& input, const UA_Variant* value)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (value)
+            _inputs.put(input).assignFrom(*value);
+        else
+            _inputs.remove(input);
+        _changed.push_back(NodeId(input));
+    }
+    schedule();
+}
+
+/*!
+    \brief Open62541::DerivedTags::recomputeAll
+*/
+void Open62541::DerivedTags::recomputeAll()
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _all = true;
+    }
+    schedule();
+}
+
+/*!
+    \brief Open62541::DerivedTags::writeValue
+    \param node
+    \param range
+    \param value
+*/
+void Open62541::DerivedTags::writeValue(Server& /*server*/,
+                                        NodeId& node,
+                                        const UA_NumericRange* range,
+                                        const UA_DataValue& value)
+{
+    // a partial write leaves only part of the value known - read it back when needed
+    changed(node.get(), (!range && value.hasValue) ? &value.value : nullptr);
+}
+
+/*!
+    \brief Open62541::DerivedTags::schedule
+    Post one batch to the server loop - changes made before it runs join it
+*/
+void Open62541::DerivedTags::schedule()
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (_scheduled)
+            return;
+        _scheduled = true;
+    }
+    std::shared_ptr<Self> self = _self;
+    if (!_server.postCommand([self](Server&) {
+            std::lock_guard<std::mutex> l(self->mutex);
+            if (self->engine)
+                self->engine->recompute();
+        })) {
+        std::lock_guard<std::mutex> l(_mutex);
+        _scheduled = false;  // the next change tries again
+    }
+}
+
+/*!
+    \brief Open62541::DerivedTags::order
+    Rank the derived nodes by dependency - called with the graph mutex held. Nodes left unranked are on a cycle
+*/
+void Open62541::DerivedTags::order()
+{
+    _readers.clearAll();
+    std::vector<size_t> pending(_tags.size(), 0);
+    for (auto& t : _tags) {
+        t.readers.clear();
+    }
+    for (size_t i = 0; i < _tags.size(); i++) {
+        Tag& t = _tags[i];
+        t.sources.assign(t.inputs.size(), -1);
+        t.rank   = 0;
+        t.cyclic = false;
+        if (t.removed)
+            continue;
+        for (size_t k = 0; k < t.inputs.size(); k++) {
+            size_t* s = _outputs.value(t.inputs[k].get());
+            if (s) {
+                t.sources[k] = int(*s);
+                _tags[*s].readers.push_back(i);
+                pending[i]++;
+            }
+            else {
+                std::vector<size_t>* r = _readers.value(t.inputs[k].get());
+                if (!r)
+                    r = &_readers.put(t.inputs[k].get());
+                r->push_back(i);
+            }
+        }
+    }
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < _tags.size(); i++) {
+        if (!_tags[i].removed && !pending[i])
+            ready.push_back(i);
+    }
+    size_t ranked = 0;
+    while (!ready.empty()) {
+        const size_t i = ready.front();
+        ready.pop_front();
+        ranked++;
+        for (size_t r : _tags[i].readers) {
+            _tags[r].rank = std::max(_tags[r].rank, _tags[i].rank + 1);
+            if (--pending[r] == 0)
+                ready.push_back(r);
+        }
+    }
+    _cycles = 0;
+    if (ranked < _live) {
+        for (size_t i = 0; i < _tags.size(); i++) {
+            if (!_tags[i].removed && pending[i]) {
+                _tags[i].cyclic = true;
+                _cycles++;
+            }
+        }
+    }
+    _ordered = true;
+}
+
+/*!
+    \brief Open62541::DerivedTags::input
+    \param node plain input
+    \param value
+    \return true if the value is known
+*/
+bool Open62541::DerivedTags::input(const NodeId& node, Variant& value)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Variant* v = _inputs.value(node.get());
+        if (v) {
+            value = *v;
+            return true;
+        }
+    }
+    return _server.readValue(node, value);
+}
+
+/*!
+    \brief Open62541::DerivedTags::recompute
+    Run a batch - server loop thread
+*/
+void Open62541::DerivedTags::recompute()
+{
+    std::vector<NodeId> changed;
+    bool all = false;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        changed.swap(_changed);
+        all        = _all;
+        _all       = false;
+        _scheduled = false;
+    }
+    std::lock_guard<std::mutex> l(_graphMutex);
+    if (!_ordered)
+        order();
+    std::set<std::pair<unsigned, size_t>> work;  // by rank so each node runs after all its sources
+    if (all) {
+        for (size_t i = 0; i < _tags.size(); i++)
+            work.insert(std::make_pair(_tags[i].rank, i));
+    }
+    else {
+        for (const auto& n : changed) {
+            std::vector<size_t>* r = _readers.value(n.get());
+            if (r) {
+                for (size_t i : *r)
+                    work.insert(std::make_pair(_tags[i].rank, i));
+            }
+            size_t* i = _outputs.value(n.get());  // newly added
+            if (i)
+                work.insert(std::make_pair(_tags[*i].rank, *i));
+        }
+    }
+    std::vector<Variant> in;
+    while (!work.empty()) {
+        const size_t i = work.begin()->second;
+        work.erase(work.begin());
+        Tag& t = _tags[i];
+        if (t.removed || t.cyclic || !t.func)
+            continue;
+        in.resize(t.inputs.size());
+        bool ok = true;
+        for (size_t k = 0; ok && (k < t.inputs.size()); k++) {
+            if (t.sources[k] >= 0) {
+                const Tag& s = _tags[t.sources[k]];
+                ok           = s.known;
+                if (ok)
+                    in[k] = s.last;
+            }
+            else {
+                ok = input(t.inputs[k], in[k]);
+            }
+        }
+        Variant result;
+        if (!ok || !t.func(in, result))
+            continue;
+        if (t.known && WriteFilter::same(t.last.get(), result.get())) {
+            _unchanged++;
+            continue;  // nothing downstream changes either
+        }
+        t.last  = result;
+        t.known = true;
+        _server.writeValue(t.node, result);
+        _computed++;
+        for (size_t r : t.readers)
+            work.insert(std::make_pair(_tags[r].rank, r));
+    }
+    _batches++;
+}
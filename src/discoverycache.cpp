@@ -0,0 +1,437 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/discoverycache.h>
+
+namespace {
+/*!
+    \brief kindType
+    \param k
+    \return element type of the results of a kind
+*/
+const UA_DataType* kindType(int k)
+{
+    static const UA_DataType* t[3] = {&UA_TYPES[UA_TYPES_ENDPOINTDESCRIPTION],
+                                      &UA_TYPES[UA_TYPES_APPLICATIONDESCRIPTION],
+                                      &UA_TYPES[UA_TYPES_SERVERONNETWORK]};
+    return t[k];
+}
+}  // namespace
+
+/*!
+    \brief Open62541::DiscoveryCache::DiscoveryCache
+*/
+Open62541::DiscoveryCache::DiscoveryCache() {}
+
+/*!
+    \brief Open62541::DiscoveryCache::~DiscoveryCache
+*/
+Open62541::DiscoveryCache::~DiscoveryCache()
+{
+    stopRefresh();
+    std::lock_guard<std::mutex> l(_clientMutex);
+    for (UA_Client* c : _idle)
+        UA_Client_delete(c);
+    _idle.clear();
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::takeClient
+    \return an idle private client or a new one - null if none can be made
+*/
+UA_Client* Open62541::DiscoveryCache::takeClient()
+{
+    {
+        std::lock_guard<std::mutex> l(_clientMutex);
+        if (!_idle.empty()) {
+            UA_Client* c = _idle.back();
+            _idle.pop_back();
+            return c;
+        }
+    }
+    UA_Client* c = UA_Client_new();
+    if (c)
+        UA_ClientConfig_setDefault(UA_Client_getConfig(c));
+    return c;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::returnClient
+    \param c client from takeClient
+*/
+void Open62541::DiscoveryCache::returnClient(UA_Client* c)
+{
+    {
+        std::lock_guard<std::mutex> l(_clientMutex);
+        if (_idle.size() < _maxIdle) {
+            _idle.push_back(c);
+            return;
+        }
+    }
+    UA_Client_delete(c);
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::fetch
+    Network request through a private client of its own - called without the cache lock
+    \param k
+    \param url
+    \param data
+    \param length
+    \return status code
+*/
+UA_StatusCode Open62541::DiscoveryCache::fetch(Kind k, const std::string& url, void** data, size_t* length)
+{
+    *data             = nullptr;
+    *length           = 0;
+    UA_Client* client = takeClient();
+    if (!client)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_StatusCode ret = UA_STATUSCODE_BADINVALIDARGUMENT;
+    switch (k) {
+        case Endpoints:
+            ret = UA_Client_getEndpoints(client, url.c_str(), length, (UA_EndpointDescription**)(data));
+            break;
+        case Servers:
+            ret = UA_Client_findServers(client,
+                                        url.c_str(),
+                                        0,
+                                        nullptr,
+                                        0,
+                                        nullptr,
+                                        length,
+                                        (UA_ApplicationDescription**)(data));
+            break;
+        case ServersOnNetwork:
+            ret = UA_Client_findServersOnNetwork(client,
+                                                 url.c_str(),
+                                                 0,
+                                                 0,
+                                                 0,
+                                                 nullptr,
+                                                 length,
+                                                 (UA_ServerOnNetwork**)(data));
+            break;
+        default:
+            break;
+    }
+    returnClient(client);
+    return ret;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::get
+    \param k
+    \param url
+    \param data set to a copy owned by the caller
+    \param length
+    \return status of this call - also kept in lastError
+*/
+UA_StatusCode Open62541::DiscoveryCache::get(Kind k, const std::string& url, void** data, size_t* length)
+{
+    *data   = nullptr;
+    *length = 0;
+    std::unique_lock<std::mutex> l(_mutex);
+    auto& m = _entries[k];
+    EntryRef e;
+    for (;;) {
+        auto i = m.find(url);
+        if (i == m.end())
+            break;
+        e = i->second;
+        if (e->fetching) {
+            _fetched.wait(l);  // share the request already in flight
+            e.reset();
+            continue;
+        }
+        if ((e->status == UA_STATUSCODE_GOOD) && (e->expires > UA_DateTime_nowMonotonic())) {
+            e->used = true;
+            _hits++;
+            const UA_StatusCode s = UA_Array_copy(e->data, e->length, data, e->type);
+            if (s == UA_STATUSCODE_GOOD)
+                *length = e->length;
+            _lastError = s;
+            return s;
+        }
+        break;  // expired or failed - fetch again
+    }
+    //
+    if (!e) {
+        e       = std::make_shared<Entry>();
+        m[url]  = e;
+        e->type = kindType(k);
+    }
+    e->fetching = true;
+    _misses++;
+    l.unlock();
+    //
+    void* d           = nullptr;
+    size_t n          = 0;
+    UA_StatusCode ret = fetch(k, url, &d, &n);
+    //
+    l.lock();
+    if (e->data)
+        UA_Array_delete(e->data, e->length, e->type);
+    e->data     = d;
+    e->length   = n;
+    e->status   = ret;
+    e->expires  = UA_DateTime_nowMonotonic() + _ttl;
+    e->fetching = false;
+    e->used     = true;
+    _fetched.notify_all();  // an entry invalidated meanwhile is out of the map - this caller still gets the result
+    if (ret == UA_STATUSCODE_GOOD) {
+        ret = UA_Array_copy(e->data, e->length, data, e->type);
+        if (ret == UA_STATUSCODE_GOOD)
+            *length = e->length;
+    }
+    _lastError = ret;
+    return ret;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::getEndpoints
+    \param serverUrl
+    \param list
+    \return status code
+*/
+UA_StatusCode Open62541::DiscoveryCache::getEndpoints(const std::string& serverUrl, EndpointDescriptionArray& list)
+{
+    void* d  = nullptr;
+    size_t n = 0;
+    const UA_StatusCode s = get(Endpoints, serverUrl, &d, &n);
+    if (s != UA_STATUSCODE_GOOD)
+        return s;
+    list.setList(n, static_cast<UA_EndpointDescription*>(d));
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::findServers
+    \param serverUrl
+    \param registeredServers
+    \return status code
+*/
+UA_StatusCode Open62541::DiscoveryCache::findServers(const std::string& serverUrl,
+                                            ApplicationDescriptionArray& registeredServers)
+{
+    void* d  = nullptr;
+    size_t n = 0;
+    const UA_StatusCode s = get(Servers, serverUrl, &d, &n);
+    if (s != UA_STATUSCODE_GOOD)
+        return s;
+    registeredServers.setList(n, static_cast<UA_ApplicationDescription*>(d));
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::findServersOnNetwork
+    \param serverUrl
+    \param serverOnNetwork
+    \return status code
+*/
+UA_StatusCode Open62541::DiscoveryCache::findServersOnNetwork(const std::string& serverUrl,
+                                                     ServerOnNetworkArray& serverOnNetwork)
+{
+    void* d  = nullptr;
+    size_t n = 0;
+    const UA_StatusCode s = get(ServersOnNetwork, serverUrl, &d, &n);
+    if (s != UA_STATUSCODE_GOOD)
+        return s;
+    checkRecords(static_cast<UA_ServerOnNetwork*>(d), n);
+    serverOnNetwork.setList(n, static_cast<UA_ServerOnNetwork*>(d));
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::checkRecords
+    A server announced again gets a new mDNS record - drop what was cached for it
+    \param s
+    \param n
+*/
+void Open62541::DiscoveryCache::checkRecords(const UA_ServerOnNetwork* s, size_t n)
+{
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        for (size_t i = 0; i < n; i++) {
+            const std::string url = toString(s[i].discoveryUrl);
+            auto r                = _records.find(url);
+            if ((r != _records.end()) && (r->second != s[i].recordId))
+                changed.push_back(url);
+            _records[url] = s[i].recordId;
+        }
+    }
+    for (const std::string& u : changed) {
+        invalidate(u);
+    }
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::invalidate
+    \param serverUrl
+*/
+void Open62541::DiscoveryCache::invalidate(const std::string& serverUrl)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto& m : _entries) {
+        auto i = m.find(serverUrl);
+        if ((i != m.end()) && !i->second->fetching)  // an entry being fetched is refreshed anyway
+            m.erase(i);
+    }
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::invalidateAll
+*/
+void Open62541::DiscoveryCache::invalidateAll()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto& m : _entries) {
+        for (auto i = m.begin(); i != m.end();) {
+            if (i->second->fetching)
+                ++i;
+            else
+                i = m.erase(i);
+        }
+    }
+    _records.clear();
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::serverRegistered
+    \param s
+*/
+void Open62541::DiscoveryCache::serverRegistered(const UA_RegisteredServer* s)
+{
+    if (!s)
+        return;
+    for (size_t i = 0; i < s->discoveryUrlsSize; i++) {
+        invalidate(toString(s->discoveryUrls[i]));
+    }
+    std::lock_guard<std::mutex> l(_mutex);
+    _entries[Servers].clear();  // the LDS lists have changed - whichever LDS was asked
+    _entries[ServersOnNetwork].clear();
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::serverOnNetwork
+    \param s
+*/
+void Open62541::DiscoveryCache::serverOnNetwork(const UA_ServerOnNetwork* s)
+{
+    if (!s)
+        return;
+    invalidate(toString(s->discoveryUrl));
+    std::lock_guard<std::mutex> l(_mutex);
+    _entries[ServersOnNetwork].clear();
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::refresh
+    \return number refreshed
+*/
+size_t Open62541::DiscoveryCache::refresh()
+{
+    std::vector<std::pair<Kind, std::string>> due;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        const UA_DateTime soon = UA_DateTime_nowMonotonic() + _ttl / 4;
+        for (int k = 0; k < 3; k++) {
+            for (auto& i : _entries[k]) {
+                Entry& e = *i.second;
+                if (e.used && !e.fetching && (e.expires < soon))
+                    due.push_back(std::make_pair(Kind(k), i.first));
+            }
+        }
+    }
+    size_t ret = 0;
+    for (auto& d : due) {
+        void* data      = nullptr;
+        size_t n        = 0;
+        UA_StatusCode s = fetch(d.first, d.second, &data, &n);
+        std::lock_guard<std::mutex> l(_mutex);
+        auto i = _entries[d.first].find(d.second);
+        if ((s != UA_STATUSCODE_GOOD) || (i == _entries[d.first].end()) || i->second->fetching) {
+            if (data)
+                UA_Array_delete(data, n, kindType(d.first));
+            continue;  // a failed refresh leaves the entry to expire
+        }
+        Entry& e = *i->second;
+        if (e.data)
+            UA_Array_delete(e.data, e.length, e.type);
+        e.data    = data;
+        e.length  = n;
+        e.status  = s;
+        e.expires = UA_DateTime_nowMonotonic() + _ttl;
+        e.used    = false;  // refreshed again only if read before it next comes due
+        ret++;
+    }
+    return ret;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::refreshLoop
+    \param intervalMs
+*/
+void Open62541::DiscoveryCache::refreshLoop(unsigned intervalMs)
+{
+    std::unique_lock<std::mutex> l(_threadMutex);
+    while (_refreshing) {
+        _threadCond.wait_for(l, std::chrono::milliseconds(intervalMs));
+        if (!_refreshing)
+            break;
+        l.unlock();
+        refresh();
+        l.lock();
+    }
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::startRefresh
+    \param intervalMs
+    \return true if started
+*/
+bool Open62541::DiscoveryCache::startRefresh(unsigned intervalMs)
+{
+    std::lock_guard<std::mutex> l(_threadMutex);
+    if (_refreshing || (intervalMs == 0))
+        return false;
+    _refreshing = true;
+    _thread     = std::thread([this, intervalMs] {
+        _threadConfig.apply();
+        refreshLoop(intervalMs);
+    });
+    return true;
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::stopRefresh
+*/
+void Open62541::DiscoveryCache::stopRefresh()
+{
+    {
+        std::lock_guard<std::mutex> l(_threadMutex);
+        _refreshing = false;
+        _threadCond.notify_all();
+    }
+    if (_thread.joinable())
+        _thread.join();
+}
+
+/*!
+    \brief Open62541::DiscoveryCache::size
+    \return number of entries
+*/
+size_t Open62541::DiscoveryCache::size() const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _entries[0].size() + _entries[1].size() + _entries[2].size();
+}
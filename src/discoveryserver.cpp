@@ -38,16 +38,78 @@ Open62541::DiscoveryServer::DiscoveryServer(int port, const std::string& url)
                   state of the semaphore file. */
             // config.discoveryCleanupTimeout = 60*60;
         }
+        UA_Server_setRegisterServerCallback(_server, registerServerCallback, this);
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+        UA_Server_setServerOnNetworkCallback(_server, serverOnNetworkCallback, this);
+#endif
+        UA_Server_addRepeatedCallback(_server, expiryCallback, this, 1000.0, &_expiryCallbackId);
     }
 }
 
+/*!
+    \brief Open62541::DiscoveryServer::registerServerCallback
+    \param registeredServer
+    \param data
+*/
+void Open62541::DiscoveryServer::registerServerCallback(const UA_RegisteredServer* registeredServer, void* data)
+{
+    DiscoveryServer* p = static_cast<DiscoveryServer*>(data);
+    if (p && registeredServer)
+        p->_registrations.registerServer(*registeredServer);
+}
+
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+/*!
+    \brief Open62541::DiscoveryServer::serverOnNetworkCallback
+    \param serverOnNetwork
+    \param isServerAnnounce
+    \param data
+*/
+void Open62541::DiscoveryServer::serverOnNetworkCallback(const UA_ServerOnNetwork* serverOnNetwork,
+                                                         UA_Boolean isServerAnnounce,
+                                                         UA_Boolean /*isTxtReceived*/,
+                                                         void* data)
+{
+    DiscoveryServer* p = static_cast<DiscoveryServer*>(data);
+    if (p && serverOnNetwork)
+        p->_registrations.serverOnNetwork(*serverOnNetwork, isServerAnnounce);
+}
+#endif
+
+/*!
+    \brief Open62541::DiscoveryServer::expiryCallback
+    \param data
+*/
+void Open62541::DiscoveryServer::expiryCallback(UA_Server* /*server*/, void* data)
+{
+    DiscoveryServer* p = static_cast<DiscoveryServer*>(data);
+    if (p)
+        p->_registrations.advance();
+}
+
+/*!
+    \brief Open62541::DiscoveryServer::setRegistrationTimeout
+    \param seconds
+*/
+void Open62541::DiscoveryServer::setRegistrationTimeout(unsigned seconds)
+{
+    _registrations.setTimeout(seconds);
+#ifdef UA_ENABLE_DISCOVERY
+    if (_config)
+        _config->discoveryCleanupTimeout = seconds;  // the stack list expires alike
+#endif
+}
+
 /*!
     \brief Open62541::DiscoveryServer::~DiscoveryServer
 */
 Open62541::DiscoveryServer::~DiscoveryServer()
 {
-    if (_server)
+    if (_server) {
+        if (_expiryCallbackId)
+            UA_Server_removeRepeatedCallback(_server, _expiryCallbackId);
         UA_Server_delete(_server);
+    }
     if (_config)
         delete _config;
 }
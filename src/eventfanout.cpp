@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/eventfanout.h>
+#include <open62541cpp/open62541client.h>
+#include <algorithm>
+
+/*!
+    \brief The Open62541::EventFanout::Item class
+    The shared monitored item of a group - passes each event to every handler
+*/
+class Open62541::EventFanout::Item : public MonitoredItemEvent
+{
+    GroupPtr _group;  // kept while the item is - the fanout drops the group when the item is deleted
+
+public:
+    Item(const GroupPtr& g, ClientSubscription& s)
+        : MonitoredItemEvent(s)
+        , _group(g)
+    {
+    }
+
+    virtual void eventNotification(size_t nEventFields, UA_Variant* eventFields)
+    {
+        HandlersRef h = std::atomic_load(&_group->handlers);
+        _group->events++;
+        if (!h)
+            return;
+        VariantArray va;
+        va.setList(nEventFields, eventFields);  // decoded once, shared by the handlers
+        for (const auto& i : *h) {
+            i.second(subscription(), va);
+        }
+        va.release();
+    }
+};
+
+/*!
+    \brief Open62541::EventFanout::keyOf
+    \param node
+    \param select
+    \param where
+    \return the key of a filter - equal keys share an item
+*/
+std::string Open62541::EventFanout::keyOf(const NodeId& node, const Select& select, const UA_ContentFilter* where)
+{
+    std::string k = toString(*node.constRef());
+    for (const auto& c : select) {
+        k += '\n';
+        k += toString(*c.typeDefinition.constRef());
+        k += '|';
+        k += std::to_string(c.attributeId);
+        k += '|';
+        k += c.browsePath;
+    }
+    if (where && (where->elementsSize > 0)) {
+        const UA_DataType* t = &UA_TYPES[UA_TYPES_CONTENTFILTER];
+        UA_ByteString b;
+        UA_ByteString_init(&b);
+        if (UA_encodeBinary(where, t, &b) == UA_STATUSCODE_GOOD) {
+            k += "\nwhere|";
+            k.append(reinterpret_cast<const char*>(b.data), b.length);
+        }
+        UA_ByteString_clear(&b);
+    }
+    return k;
+}
+
+/*!
+    \brief Open62541::EventFanout::add
+    \param node
+    \param select
+    \param f
+    \param where
+    \return handler id or 0
+*/
+unsigned Open62541::EventFanout::add(const NodeId& node,
+                                     const Select& select,
+                                     monitorEventFunc f,
+                                     const UA_ContentFilter* where)
+{
+    _lastError = UA_STATUSCODE_GOOD;
+    if (!f || select.empty()) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return 0;
+    }
+    const std::string k = keyOf(node, select, where);
+    std::lock_guard<std::mutex> l(_mutex);
+    Group* g = nullptr;
+    auto i   = _groups.find(k);
+    if (i != _groups.end()) {
+        g = i->second.get();
+    }
+    else {
+        GroupPtr p(new Group);
+        p->key      = k;
+        p->handlers = std::make_shared<const Handlers>();
+        Item* m     = new Item(p, _subscription);
+        m->setMonitorItem(node, select.size());
+        for (size_t j = 0; j < select.size(); j++) {
+            const Clause& c = select[j];
+            StdStringArray path;
+            for (size_t b = 0, e = 0; b <= c.browsePath.size(); b = e + 1) {
+                e = c.browsePath.find('/', b);
+                if (e == std::string::npos)
+                    e = c.browsePath.size();
+                path.push_back(c.browsePath.substr(b, e - b));
+            }
+            m->setClause(j, path, c.attributeId, c.typeDefinition);
+        }
+        if (where)
+            UA_ContentFilter_copy(where, &m->monitorItem().filter()->whereClause);
+        NodeId n(node);
+        if (!m->addEvent(n)) {
+            _lastError = m->lastError();
+            delete m;
+            return 0;
+        }
+        MonitoredItemRef r(m);
+        p->item    = _subscription.addMonitorItem(r);
+        g          = p.get();
+        _groups[k] = std::move(p);
+    }
+    const unsigned id = ++_nextId;
+    auto h            = std::make_shared<Handlers>(*g->handlers);  // copy on write - dispatch may hold the old list
+    h->emplace_back(id, f);
+    std::atomic_store(&g->handlers, HandlersRef(h));
+    _handlers[id] = g;
+    return id;
+}
+
+/*!
+    \brief Open62541::EventFanout::remove
+    \param id
+    \return true if removed
+*/
+bool Open62541::EventFanout::remove(unsigned id)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _handlers.find(id);
+    if (i == _handlers.end())
+        return false;
+    Group* g = i->second;
+    _handlers.erase(i);
+    auto h = std::make_shared<Handlers>(*g->handlers);
+    h->erase(std::remove_if(h->begin(), h->end(), [id](const Handlers::value_type& v) { return v.first == id; }),
+             h->end());
+    if (h->empty()) {
+        _subscription.deleteMonitorItem(g->item);  // the item keeps its group until it is released
+        _groups.erase(g->key);
+    }
+    else {
+        std::atomic_store(&g->handlers, HandlersRef(h));
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::EventFanout::clear
+*/
+void Open62541::EventFanout::clear()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto& g : _groups) {
+        _subscription.deleteMonitorItem(g.second->item);
+    }
+    _groups.clear();
+    _handlers.clear();
+}
+
+/*!
+    \brief Open62541::EventFanout::refresh
+    \return true on success
+*/
+bool Open62541::EventFanout::refresh()
+{
+    UA_UInt32 subscriptionId = _subscription.id();
+    VariantList in(1);
+    UA_Variant_init(&in[0]);
+    UA_Variant_setScalar(&in[0], &subscriptionId, &UA_TYPES[UA_TYPES_UINT32]);  // shallow
+    NodeId object(0, UA_NS0ID_CONDITIONTYPE);
+    NodeId method(0, UA_NS0ID_CONDITIONTYPE_CONDITIONREFRESH);
+    VariantCallResult out;
+    Client& c  = _subscription.client();
+    bool ret   = c.callMethod(object, method, in, out);
+    _lastError = c.lastError();
+    return ret;
+}
+
+/*!
+    \brief Open62541::EventFanout::groups
+    \return shared items
+*/
+size_t Open62541::EventFanout::groups() const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _groups.size();
+}
+
+/*!
+    \brief Open62541::EventFanout::handlers
+    \return consumers
+*/
+size_t Open62541::EventFanout::handlers() const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _handlers.size();
+}
+
+/*!
+    \brief Open62541::EventFanout::events
+    \param id
+    \return events received by the group of the handler
+*/
+size_t Open62541::EventFanout::events(unsigned id) const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _handlers.find(id);
+    return (i != _handlers.end()) ? i->second->events.load() : 0;
+}
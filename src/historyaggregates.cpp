@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/historyaggregates.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <cmath>
+
+// historian info bits - the value was calculated or interpolated rather than stored
+static const UA_StatusCode HistorianCalculated   = 0x00000401;
+static const UA_StatusCode HistorianInterpolated = 0x00000402;
+
+static inline bool isGood(UA_StatusCode s) { return (s & 0xC0000000) == 0; }
+
+/*!
+    \brief The Open62541::HistoryAggregates::Cursor class
+    Walks the values of a node forward from a timestamp through the backend's low level interface
+*/
+class Open62541::HistoryAggregates::Cursor
+{
+    HistoryAggregates& _h;
+    UA_Server* _server;
+    const UA_NodeId& _node;
+    size_t _index = 0;
+    size_t _end   = 0;
+    size_t _last  = 0;
+    Sample _sample;
+    bool _loaded = false;
+
+    UA_HistoryDataBackend& b() { return _h._backend; }
+
+public:
+    Cursor(HistoryAggregates& h, UA_Server* server, const UA_NodeId& node, UA_DateTime from)
+        : _h(h)
+        , _server(server)
+        , _node(node)
+    {
+        _end   = b().getEnd(_server, b().context, &_h._session, nullptr, &_node);
+        _last  = b().lastIndex(_server, b().context, &_h._session, nullptr, &_node);
+        _index = b().getDateTimeMatch(_server, b().context, &_h._session, nullptr, &_node, from, MATCH_EQUAL_OR_AFTER);
+    }
+    /*!
+        \brief peek
+        \param s set to the value at the cursor
+        \return false at the end
+    */
+    bool peek(Sample& s)
+    {
+        if (!_loaded) {
+            if (_index == _end)
+                return false;
+            const UA_DataValue* v = b().getDataValue(_server, b().context, &_h._session, nullptr, &_node, _index);
+            if (!v) {
+                _index = _end;
+                return false;
+            }
+            _sample.time = HistoryDataBackend::historyKey(*v);
+            _sample.good = (!v->hasStatus || isGood(v->status)) && toDouble(*v, _sample.value);
+            _loaded      = true;
+            _h._rawValues++;
+        }
+        s = _sample;
+        return true;
+    }
+    /*!
+        \brief skip
+        Move past the value at the cursor
+    */
+    void skip()
+    {
+        _loaded = false;
+        if (_index != _end)
+            _index = (_index == _last) ? _end : _index + 1;
+    }
+    /*!
+        \brief before
+        \param server
+        \param t
+        \param s set to the last good value at or before t
+        \return true if found
+    */
+    static bool before(HistoryAggregates& h, UA_Server* server, const UA_NodeId& node, UA_DateTime t, Sample& s)
+    {
+        UA_HistoryDataBackend& b = h._backend;
+        size_t end               = b.getEnd(server, b.context, &h._session, nullptr, &node);
+        size_t first             = b.firstIndex(server, b.context, &h._session, nullptr, &node);
+        size_t i = b.getDateTimeMatch(server, b.context, &h._session, nullptr, &node, t, MATCH_EQUAL_OR_BEFORE);
+        for (int n = 0; (i != end) && (n < 16); n++) {  // step back over a few bad values
+            const UA_DataValue* v = b.getDataValue(server, b.context, &h._session, nullptr, &node, i);
+            if (!v)
+                break;
+            h._rawValues++;
+            if ((!v->hasStatus || isGood(v->status)) && toDouble(*v, s.value)) {
+                s.time = HistoryDataBackend::historyKey(*v);
+                s.good = true;
+                return true;
+            }
+            if (i == first)
+                break;
+            i--;
+        }
+        return false;
+    }
+};
+
+/*!
+    \brief Open62541::HistoryAggregates::HistoryAggregates
+    \param backend
+*/
+Open62541::HistoryAggregates::HistoryAggregates(const UA_HistoryDataBackend& backend)
+    : _backend(backend)
+{
+    UA_NodeId_init(&_session);
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::~HistoryAggregates
+*/
+Open62541::HistoryAggregates::~HistoryAggregates() {}
+
+/*!
+    \brief Open62541::HistoryAggregates::aggregateFromNodeId
+    \param n
+    \param a
+    \return true if supported
+*/
+bool Open62541::HistoryAggregates::aggregateFromNodeId(const UA_NodeId& n, Aggregate& a)
+{
+    if ((n.namespaceIndex != 0) || (n.identifierType != UA_NODEIDTYPE_NUMERIC))
+        return false;
+    switch (n.identifier.numeric) {
+        case UA_NS0ID_AGGREGATEFUNCTION_AVERAGE:
+            a = Aggregate::Average;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MINIMUM:
+            a = Aggregate::Minimum;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_MAXIMUM:
+            a = Aggregate::Maximum;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_COUNT:
+            a = Aggregate::Count;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_TIMEAVERAGE:
+            a = Aggregate::TimeAverage;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_INTERPOLATIVE:
+            a = Aggregate::Interpolative;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_STANDARDDEVIATIONSAMPLE:
+            a = Aggregate::StandardDeviation;
+            break;
+        case UA_NS0ID_AGGREGATEFUNCTION_VARIANCESAMPLE:
+            a = Aggregate::Variance;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::toDouble
+    \param v
+    \param d
+    \return true if the value is a numeric scalar
+*/
+bool Open62541::HistoryAggregates::toDouble(const UA_DataValue& v, double& d)
+{
+    if (!v.hasValue || !UA_Variant_isScalar(&v.value) || !v.value.data)
+        return false;
+    const UA_DataType* t = v.value.type;
+    const void* p        = v.value.data;
+    if (t == &UA_TYPES[UA_TYPES_DOUBLE])
+        d = *static_cast<const UA_Double*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_FLOAT])
+        d = *static_cast<const UA_Float*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_INT32])
+        d = *static_cast<const UA_Int32*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_UINT32])
+        d = *static_cast<const UA_UInt32*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_INT64])
+        d = double(*static_cast<const UA_Int64*>(p));
+    else if (t == &UA_TYPES[UA_TYPES_UINT64])
+        d = double(*static_cast<const UA_UInt64*>(p));
+    else if (t == &UA_TYPES[UA_TYPES_INT16])
+        d = *static_cast<const UA_Int16*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_UINT16])
+        d = *static_cast<const UA_UInt16*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_SBYTE])
+        d = *static_cast<const UA_SByte*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_BYTE])
+        d = *static_cast<const UA_Byte*>(p);
+    else if (t == &UA_TYPES[UA_TYPES_BOOLEAN])
+        d = *static_cast<const UA_Boolean*>(p) ? 1.0 : 0.0;
+    else
+        return false;
+    return true;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::interpolate
+    \return the value on the line a - b at t
+*/
+double Open62541::HistoryAggregates::interpolate(const Sample& a, const Sample& b, UA_DateTime t)
+{
+    if (b.time == a.time)
+        return b.value;
+    return a.value + (b.value - a.value) * (double(t - a.time) / double(b.time - a.time));
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::setRollupInterval
+    \param ms
+*/
+void Open62541::HistoryAggregates::setRollupInterval(UA_Double ms)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _rollup = (ms > 0) ? UA_DateTime(ms * UA_DATETIME_MSEC) : 0;
+    _rollups.clearAll();
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::invalidate
+    \param node
+    \param from
+    \param to
+*/
+void Open62541::HistoryAggregates::invalidate(const NodeId& node, UA_DateTime from, UA_DateTime to)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Rollups* r = _rollups.value(*node.constRef());
+    if (r && _rollup) {
+        auto i = r->lower_bound((from == UA_INT64_MIN) ? from : from - _rollup + 1);
+        while ((i != r->end()) && (i->first <= to))
+            i = r->erase(i);
+    }
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::invalidateAll
+*/
+void Open62541::HistoryAggregates::invalidateAll()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _rollups.clearAll();
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::summarise
+    Raw pass over [start, end)
+*/
+void Open62541::HistoryAggregates::summarise(UA_Server* server,
+                                             const UA_NodeId& node,
+                                             UA_DateTime start,
+                                             UA_DateTime end,
+                                             Summary& s)
+{
+    Cursor c(*this, server, node, start);
+    Sample v;
+    while (c.peek(v) && (v.time < end)) {
+        c.skip();
+        if (v.good)
+            s.add(v.time, v.value);
+        else
+            s.bad++;
+    }
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::summary
+    Summary of one rollup interval - from the cache or summarised and cached if the interval is closed
+    \return true if taken from the cache
+*/
+bool Open62541::HistoryAggregates::summary(UA_Server* server,
+                                           const UA_NodeId& node,
+                                           UA_DateTime start,
+                                           UA_DateTime end,
+                                           Summary& s)
+{
+    Rollups* r = _rollups.value(node);
+    if (r) {
+        auto i = r->find(start);
+        if (i != r->end()) {
+            s.merge(i->second);
+            _rollupsUsed++;
+            return true;
+        }
+    }
+    Summary n;
+    summarise(server, node, start, end, n);
+    s.merge(n);
+    // closed if a later value exists
+    Sample last;
+    Cursor c(*this, server, node, end);
+    if (c.peek(last)) {
+        if (!r)
+            r = &_rollups.put(node);
+        (*r)[start] = n;
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::setResult
+    Result of a summary based aggregate
+*/
+void Open62541::HistoryAggregates::setResult(DataValue& d, UA_DateTime t, Aggregate a, const Summary& s)
+{
+    UA_DataValue& r = *d.ref();
+    UA_DataValue_clear(&r);
+    r.hasSourceTimestamp = true;
+    r.sourceTimestamp    = t;
+    r.hasStatus          = true;
+    if (a == Aggregate::Count) {
+        UA_UInt32 n = UA_UInt32(s.count);
+        UA_Variant_setScalarCopy(&r.value, &n, &UA_TYPES[UA_TYPES_UINT32]);
+        r.hasValue = true;
+        r.status   = HistorianCalculated;
+        return;
+    }
+    if (!s.count) {
+        r.status = UA_STATUSCODE_BADNODATA;
+        return;
+    }
+    double v = 0.0;
+    switch (a) {
+        case Aggregate::Minimum:
+            v                 = s.minimum;
+            r.sourceTimestamp = s.minTime;
+            break;
+        case Aggregate::Maximum:
+            v                 = s.maximum;
+            r.sourceTimestamp = s.maxTime;
+            break;
+        case Aggregate::StandardDeviation:
+            v = std::sqrt(s.variance());
+            break;
+        case Aggregate::Variance:
+            v = s.variance();
+            break;
+        default:
+            v = s.mean;
+            break;
+    }
+    UA_Variant_setScalarCopy(&r.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    r.hasValue = true;
+    r.status   = s.bad ? UA_STATUSCODE_UNCERTAINDATASUBNORMAL : HistorianCalculated;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::processRaw
+    One forward pass over the raw values of [start, end)
+*/
+UA_StatusCode Open62541::HistoryAggregates::processRaw(UA_Server* server,
+                                                       const UA_NodeId& node,
+                                                       UA_DateTime start,
+                                                       UA_DateTime end,
+                                                       UA_DateTime interval,
+                                                       Aggregate a,
+                                                       std::vector<DataValue>& out)
+{
+    const bool weighted = (a == Aggregate::TimeAverage) || (a == Aggregate::Interpolative);
+    Sample prev;
+    bool hasPrev = weighted && Cursor::before(*this, server, node, start - 1, prev);
+    Cursor c(*this, server, node, start);
+    //
+    for (UA_DateTime is = start; is < end; is += interval) {
+        UA_DateTime ie = std::min(end, is + interval);
+        out.emplace_back();
+        DataValue& d = out.back();
+        Sample s;
+        //
+        if (a == Aggregate::Interpolative) {
+            // value at the interval start from its bounding values
+            while (c.peek(s) && !s.good && (s.time <= is))
+                c.skip();
+            UA_DataValue& r      = *d.ref();
+            r.hasSourceTimestamp = true;
+            r.sourceTimestamp    = is;
+            r.hasStatus          = true;
+            bool next            = c.peek(s) && s.good;
+            double v             = 0.0;
+            if (next && (s.time == is)) {
+                v        = s.value;
+                r.status = UA_STATUSCODE_GOOD;
+            }
+            else if (next && hasPrev) {
+                v        = interpolate(prev, s, is);
+                r.status = HistorianInterpolated;
+            }
+            else if (hasPrev) {
+                v        = prev.value;  // stepped extrapolation
+                r.status = UA_STATUSCODE_UNCERTAINDATASUBNORMAL | HistorianInterpolated;
+            }
+            else {
+                r.status = UA_STATUSCODE_BADNODATA;
+            }
+            if (r.status != UA_STATUSCODE_BADNODATA) {
+                UA_Variant_setScalarCopy(&r.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+                r.hasValue = true;
+            }
+            // move to the next interval keeping the last good value as the lower bound
+            while (c.peek(s) && (s.time < ie)) {
+                c.skip();
+                if (s.good) {
+                    prev    = s;
+                    hasPrev = true;
+                }
+            }
+            continue;
+        }
+        //
+        Summary sm;
+        double area         = 0.0;
+        UA_DateTime covered = 0;
+        auto segment        = [&](const Sample& p, const Sample& q) {
+            UA_DateTime t0 = std::max(p.time, is);
+            UA_DateTime t1 = std::min(q.time, ie);
+            if (t1 > t0) {
+                area += (interpolate(p, q, t0) + interpolate(p, q, t1)) * 0.5 * double(t1 - t0);
+                covered += t1 - t0;
+            }
+        };
+        while (c.peek(s) && (s.time < ie)) {
+            c.skip();
+            if (!s.good) {
+                sm.bad++;
+                continue;
+            }
+            sm.add(s.time, s.value);
+            if (weighted) {
+                if (hasPrev)
+                    segment(prev, s);
+                prev    = s;
+                hasPrev = true;
+            }
+        }
+        if (a == Aggregate::TimeAverage) {
+            if (hasPrev && c.peek(s) && s.good)
+                segment(prev, s);  // the part of the interval before the next value
+            UA_DataValue& r      = *d.ref();
+            r.hasSourceTimestamp = true;
+            r.sourceTimestamp    = is;
+            r.hasStatus          = true;
+            if (covered > 0) {
+                double v = area / double(covered);
+                UA_Variant_setScalarCopy(&r.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+                r.hasValue = true;
+                r.status   = (sm.bad || (covered < (ie - is))) ? UA_STATUSCODE_UNCERTAINDATASUBNORMAL
+                                                                : HistorianCalculated;
+            }
+            else {
+                r.status = UA_STATUSCODE_BADNODATA;
+            }
+        }
+        else {
+            setResult(d, is, a, sm);
+        }
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::processRollups
+    Build each interval from cached rollup summaries - partial rollups at the end of the range are raw
+*/
+UA_StatusCode Open62541::HistoryAggregates::processRollups(UA_Server* server,
+                                                           const UA_NodeId& node,
+                                                           UA_DateTime start,
+                                                           UA_DateTime end,
+                                                           UA_DateTime interval,
+                                                           Aggregate a,
+                                                           std::vector<DataValue>& out)
+{
+    for (UA_DateTime is = start; is < end; is += interval) {
+        UA_DateTime ie = std::min(end, is + interval);
+        Summary sm;
+        for (UA_DateTime b = is; b < ie; b += _rollup) {
+            if ((b + _rollup) <= ie)
+                summary(server, node, b, b + _rollup, sm);
+            else
+                summarise(server, node, b, ie, sm);
+        }
+        out.emplace_back();
+        setResult(out.back(), is, a, sm);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::readProcessed
+    \return status
+*/
+UA_StatusCode Open62541::HistoryAggregates::readProcessed(Server& server,
+                                                          const NodeId& node,
+                                                          UA_DateTime start,
+                                                          UA_DateTime end,
+                                                          UA_Double processingInterval,
+                                                          Aggregate a,
+                                                          std::vector<DataValue>& out)
+{
+    out.clear();
+    if (!_backend.getDateTimeMatch || !_backend.getDataValue || !_backend.getEnd || !_backend.lastIndex ||
+        !_backend.firstIndex)
+        return UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+    if ((start == end) || (processingInterval < 0))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    const bool reverse = end < start;
+    if (reverse)
+        std::swap(start, end);
+    UA_DateTime interval = UA_DateTime(processingInterval * UA_DATETIME_MSEC);
+    if (interval <= 0)
+        interval = end - start;
+    if (size_t((end - start - 1) / interval + 1) > _maxIntervals)
+        return UA_STATUSCODE_BADTOOMANYOPERATIONS;
+    //
+    std::lock_guard<std::mutex> l(_mutex);
+    UA_StatusCode ret = UA_STATUSCODE_GOOD;
+    const bool summarised = (a != Aggregate::TimeAverage) && (a != Aggregate::Interpolative);
+    if (summarised && _rollup && !(interval % _rollup) && !(start % _rollup))
+        ret = processRollups(server.server(), *node.constRef(), start, end, interval, a, out);
+    else
+        ret = processRaw(server.server(), *node.constRef(), start, end, interval, a, out);
+    if (reverse)
+        std::reverse(out.begin(), out.end());
+    return ret;
+}
+
+/*!
+    \brief Open62541::HistoryAggregates::readProcessed
+    \param server
+    \param details
+    \param nodesToReadSize
+    \param nodesToRead
+    \param results
+*/
+void Open62541::HistoryAggregates::readProcessed(Server& server,
+                                                 const UA_ReadProcessedDetails& details,
+                                                 size_t nodesToReadSize,
+                                                 const UA_HistoryReadValueId* nodesToRead,
+                                                 UA_HistoryReadResult* results)
+{
+    std::vector<DataValue> values;
+    for (size_t i = 0; i < nodesToReadSize; i++) {
+        UA_HistoryReadResult& r = results[i];
+        if (details.aggregateTypeSize != nodesToReadSize) {
+            r.statusCode = UA_STATUSCODE_BADAGGREGATELISTMISMATCH;
+            continue;
+        }
+        Aggregate a;
+        if (!aggregateFromNodeId(details.aggregateType[i], a)) {
+            r.statusCode = UA_STATUSCODE_BADAGGREGATENOTSUPPORTED;
+            continue;
+        }
+        NodeId n(nodesToRead[i].nodeId);
+        r.statusCode = readProcessed(server, n, details.startTime, details.endTime, details.processingInterval, a, values);
+        if (r.statusCode != UA_STATUSCODE_GOOD)
+            continue;
+        //
+        UA_HistoryData* h = UA_HistoryData_new();
+        if (!h) {
+            r.statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+            continue;
+        }
+        if (!values.empty()) {
+            h->dataValues = static_cast<UA_DataValue*>(UA_Array_new(values.size(), &UA_TYPES[UA_TYPES_DATAVALUE]));
+            if (!h->dataValues) {
+                UA_HistoryData_delete(h);
+                r.statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+                continue;
+            }
+            h->dataValuesSize = values.size();
+            for (size_t j = 0; j < values.size(); j++) {
+                UA_DataValue_copy(values[j].constRef(), &h->dataValues[j]);
+            }
+        }
+        UA_ExtensionObject_clear(&r.historyData);
+        r.historyData.encoding               = UA_EXTENSIONOBJECT_DECODED;
+        r.historyData.content.decoded.type   = &UA_TYPES[UA_TYPES_HISTORYDATA];
+        r.historyData.content.decoded.data   = h;
+    }
+}
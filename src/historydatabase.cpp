@@ -127,3 +127,39 @@ bool Open62541::Historian::setUserNode(NodeId& nodeId,
     return gathering().registerNodeId(server.server(), gathering().context, nodeId.ref(), setting) ==
            UA_STATUSCODE_GOOD;
 }
+
+/*!
+ * \brief Open62541::Historian::registerNodes
+ * \param nodes
+ * \param server
+ * \param strategy
+ * \param responseSize
+ * \param pollInterval
+ * \param context
+ * \return nodes registered
+ */
+size_t Open62541::Historian::registerNodes(const std::vector<NodeId>& nodes,
+                                           Server& server,
+                                           UA_HistorizingUpdateStrategy strategy,
+                                           size_t responseSize,
+                                           size_t pollInterval,
+                                           void* context)
+{
+    reserve(nodes.size());
+    UA_HistorizingNodeIdSettings setting;
+    setting.historizingBackend         = _backend;
+    setting.pollingInterval            = pollInterval;
+    setting.maxHistoryDataResponseSize = responseSize;
+    setting.historizingUpdateStrategy  = strategy;
+    setting.userContext                = context;
+    _lastError                         = UA_STATUSCODE_GOOD;
+    size_t n                           = 0;
+    for (const NodeId& node : nodes) {
+        UA_StatusCode rc = gathering().registerNodeId(server.server(), gathering().context, node.constRef(), setting);
+        if (rc == UA_STATUSCODE_GOOD)
+            n++;
+        else if (_lastError == UA_STATUSCODE_GOOD)
+            _lastError = rc;
+    }
+    return n;
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/historyreader.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace Open62541 {
+/*!
+    \brief The HistoryReader::State struct
+    Shared between the reader and the completions of its requests, so a completion arriving after the
+    reader has gone is harmless
+*/
+struct HistoryReader::State {
+    Client* client = nullptr;
+    UA_ReadRawModifiedDetails details;
+    UA_TimestampsToReturn timestamps = UA_TIMESTAMPSTORETURN_BOTH;
+    std::vector<NodeId> nodes;
+    std::vector<UA_StatusCode> status;      // per node
+    std::vector<std::string> continuation;  // per node - empty when there is none
+    std::deque<size_t> queue;               // nodes with more to read
+    std::vector<size_t> flight;             // nodes of the request in flight
+    size_t nodesPerRequest = 16;
+    //
+    std::mutex mutex;
+    std::condition_variable done;
+    bool inFlight           = false;
+    bool ready              = false;  // page holds a response
+    bool cancelled          = false;
+    UA_StatusCode error     = UA_STATUSCODE_GOOD;
+    std::vector<Value> page;
+    size_t requests         = 0;
+    uint64_t values         = 0;
+
+    static bool send(std::shared_ptr<State> st);
+    void completed(UA_StatusCode s, UA_HistoryReadResponse* r, std::vector<size_t>& release);
+    void release(const std::vector<size_t>& n);
+};
+}  // namespace Open62541
+
+/*!
+    \brief Open62541::HistoryReader::State::send
+    Request the next page of up to nodesPerRequest nodes
+    \param st
+    \return true if sent
+*/
+bool Open62541::HistoryReader::State::send(std::shared_ptr<State> st)
+{
+    std::vector<size_t> batch;
+    {
+        std::lock_guard<std::mutex> l(st->mutex);
+        if (st->inFlight || st->cancelled || st->queue.empty())
+            return false;
+        while ((batch.size() < st->nodesPerRequest) && !st->queue.empty()) {
+            batch.push_back(st->queue.front());
+            st->queue.pop_front();
+        }
+        st->flight   = batch;
+        st->inFlight = true;
+        st->ready    = false;
+        st->requests++;
+    }
+    // shallow - the request is encoded before sendAsync returns and the strings are not touched while in flight
+    std::vector<UA_HistoryReadValueId> items(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        UA_HistoryReadValueId_init(&items[i]);
+        items[i].nodeId                   = *st->nodes[batch[i]].constRef();
+        const std::string& cp             = st->continuation[batch[i]];
+        items[i].continuationPoint.length = cp.size();
+        items[i].continuationPoint.data   = cp.empty() ? nullptr : (UA_Byte*)cp.data();
+    }
+    UA_HistoryReadRequest req;
+    UA_HistoryReadRequest_init(&req);
+    req.historyReadDetails.encoding             = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    req.historyReadDetails.content.decoded.type = &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS];
+    req.historyReadDetails.content.decoded.data = &st->details;
+    req.timestampsToReturn                      = st->timestamps;
+    req.nodesToRead                             = items.data();
+    req.nodesToReadSize                         = items.size();
+    bool ok = st->client->sendAsync(&req,
+                                    &UA_TYPES[UA_TYPES_HISTORYREADREQUEST],
+                                    &UA_TYPES[UA_TYPES_HISTORYREADRESPONSE],
+                                    [st](UA_StatusCode s, void* response) {
+                                        std::vector<size_t> release;
+                                        st->completed(s, static_cast<UA_HistoryReadResponse*>(response), release);
+                                        if (!release.empty())
+                                            st->release(release);
+                                    });
+    if (!ok) {
+        std::lock_guard<std::mutex> l(st->mutex);
+        st->inFlight = false;
+        st->flight.clear();
+        st->queue.insert(st->queue.begin(), batch.begin(), batch.end());
+        st->error = st->client->lastError();
+        if (st->error == UA_STATUSCODE_GOOD)
+            st->error = UA_STATUSCODE_BADCOMMUNICATIONERROR;
+        st->done.notify_all();
+    }
+    return ok;
+}
+
+/*!
+    \brief Open62541::HistoryReader::State::completed
+    Take the values of a response into the page and keep the continuation points
+    \param s service status
+    \param r response
+    \param release set to nodes whose continuation points must be released
+*/
+void Open62541::HistoryReader::State::completed(UA_StatusCode s,
+                                                UA_HistoryReadResponse* r,
+                                                std::vector<size_t>& release)
+{
+    std::lock_guard<std::mutex> l(mutex);
+    std::vector<size_t> batch;
+    batch.swap(flight);
+    inFlight = false;
+    if ((s == UA_STATUSCODE_GOOD) && (!r || (r->resultsSize != batch.size())))
+        s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (s != UA_STATUSCODE_GOOD) {
+        error = s;
+        for (size_t n : batch) {
+            status[n] = s;
+            continuation[n].clear();
+        }
+    }
+    else {
+        std::vector<size_t> more;
+        for (size_t j = 0; j < batch.size(); j++) {
+            size_t n                = batch[j];
+            UA_HistoryReadResult& h = r->results[j];
+            status[n]               = h.statusCode;
+            const UA_ExtensionObject& e = h.historyData;
+            if (!cancelled && !UA_StatusCode_isBad(h.statusCode) && (e.encoding >= UA_EXTENSIONOBJECT_DECODED) &&
+                (e.content.decoded.type == &UA_TYPES[UA_TYPES_HISTORYDATA])) {
+                UA_HistoryData* d = static_cast<UA_HistoryData*>(e.content.decoded.data);
+                size_t base       = page.size();
+                page.resize(base + d->dataValuesSize);
+                for (size_t i = 0; i < d->dataValuesSize; i++) {
+                    page[base + i].node = n;
+                    page[base + i].value.adopt(d->dataValues[i]);
+                }
+                values += d->dataValuesSize;
+            }
+            if (!UA_StatusCode_isBad(h.statusCode) && (h.continuationPoint.length > 0)) {
+                continuation[n].assign((const char*)h.continuationPoint.data, h.continuationPoint.length);
+                if (cancelled)
+                    release.push_back(n);
+                else
+                    more.push_back(n);
+            }
+            else {
+                continuation[n].clear();
+            }
+        }
+        // the same nodes carry on first so a node's values stay close together
+        queue.insert(queue.begin(), more.begin(), more.end());
+    }
+    ready = true;
+    done.notify_all();
+}
+
+/*!
+    \brief Open62541::HistoryReader::State::release
+    Tell the server to drop the continuation points of nodes that will not be read further
+    \param n nodes
+*/
+void Open62541::HistoryReader::State::release(const std::vector<size_t>& n)
+{
+    std::vector<UA_HistoryReadValueId> items(n.size());
+    for (size_t i = 0; i < n.size(); i++) {
+        UA_HistoryReadValueId_init(&items[i]);
+        items[i].nodeId                   = *nodes[n[i]].constRef();
+        const std::string& cp             = continuation[n[i]];
+        items[i].continuationPoint.length = cp.size();
+        items[i].continuationPoint.data   = cp.empty() ? nullptr : (UA_Byte*)cp.data();
+    }
+    UA_HistoryReadRequest req;
+    UA_HistoryReadRequest_init(&req);
+    req.historyReadDetails.encoding             = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    req.historyReadDetails.content.decoded.type = &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS];
+    req.historyReadDetails.content.decoded.data = &details;
+    req.timestampsToReturn                      = timestamps;
+    req.releaseContinuationPoints               = UA_TRUE;
+    req.nodesToRead                             = items.data();
+    req.nodesToReadSize                         = items.size();
+    client->sendAsync(&req,
+                      &UA_TYPES[UA_TYPES_HISTORYREADREQUEST],
+                      &UA_TYPES[UA_TYPES_HISTORYREADRESPONSE],
+                      [](UA_StatusCode, void*) {});
+    for (size_t i : n)
+        continuation[i].clear();
+}
+
+/*!
+    \brief Open62541::HistoryReader::HistoryReader
+    \param client
+    \param nodes
+    \param startTime
+    \param endTime
+    \param pageSize
+    \param nodesPerRequest
+    \param returnBounds
+    \param timestampsToReturn
+*/
+Open62541::HistoryReader::HistoryReader(Client& client,
+                                        const std::vector<NodeId>& nodes,
+                                        UA_DateTime startTime,
+                                        UA_DateTime endTime,
+                                        unsigned pageSize,
+                                        size_t nodesPerRequest,
+                                        bool returnBounds,
+                                        UA_TimestampsToReturn timestampsToReturn)
+    : _state(std::make_shared<State>())
+{
+    State& s = *_state;
+    s.client = &client;
+    UA_ReadRawModifiedDetails_init(&s.details);
+    s.details.startTime        = startTime;
+    s.details.endTime          = endTime;
+    s.details.isReadModified   = false;
+    s.details.numValuesPerNode = (UA_UInt32)pageSize;
+    s.details.returnBounds     = returnBounds ? UA_TRUE : UA_FALSE;
+    s.timestamps               = timestampsToReturn;
+    s.nodes                    = nodes;
+    s.status.assign(nodes.size(), UA_STATUSCODE_GOOD);
+    s.continuation.resize(nodes.size());
+    s.nodesPerRequest = nodesPerRequest ? nodesPerRequest : 1;
+    for (size_t i = 0; i < nodes.size(); i++)
+        s.queue.push_back(i);
+}
+
+/*!
+    \brief Open62541::HistoryReader::~HistoryReader
+*/
+Open62541::HistoryReader::~HistoryReader() { cancel(); }
+
+/*!
+    \brief Open62541::HistoryReader::cancel
+*/
+void Open62541::HistoryReader::cancel()
+{
+    State& s = *_state;
+    std::vector<size_t> release;
+    {
+        std::lock_guard<std::mutex> l(s.mutex);
+        if (s.cancelled)
+            return;
+        s.cancelled = true;
+        s.queue.clear();
+        s.page.clear();
+        for (size_t i = 0; i < s.continuation.size(); i++) {
+            // a request in flight has used its continuation points - its completion releases the new ones
+            if (!s.continuation[i].empty() &&
+                (std::find(s.flight.begin(), s.flight.end(), i) == s.flight.end()))
+                release.push_back(i);
+        }
+    }
+    if (!release.empty())
+        s.release(release);
+    _current.clear();
+    _position = 0;
+}
+
+/*!
+    \brief Open62541::HistoryReader::fill
+    Make the next page current, waiting for it if need be, and prefetch the one after
+    \return false at the end or on error
+*/
+bool Open62541::HistoryReader::fill()
+{
+    State& s = *_state;
+    std::unique_lock<std::mutex> l(s.mutex);
+    if (s.cancelled)
+        return false;
+    if (!s.ready && !s.inFlight) {
+        if ((s.error != UA_STATUSCODE_GOOD) || s.queue.empty()) {
+            _lastError = s.error;
+            return false;
+        }
+        l.unlock();
+        State::send(_state);
+        l.lock();
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout);
+    while (!s.ready && s.inFlight) {
+        if (_pump) {
+            l.unlock();
+            bool ok = s.client->runIterate(10);
+            l.lock();
+            if (!ok && !s.ready) {
+                _lastError = s.client->lastError();
+                if (_lastError == UA_STATUSCODE_GOOD)
+                    _lastError = UA_STATUSCODE_BADCONNECTIONCLOSED;
+                return false;
+            }
+        }
+        else {
+            s.done.wait_for(l, std::chrono::milliseconds(10));
+        }
+        if (!s.ready && (std::chrono::steady_clock::now() > deadline)) {
+            _lastError = UA_STATUSCODE_BADTIMEOUT;
+            return false;  // still in flight - a later call carries on waiting
+        }
+    }
+    if (!s.ready) {
+        _lastError = s.error;  // the send failed
+        return false;
+    }
+    _current.clear();
+    _current.swap(s.page);
+    _position = 0;
+    s.ready   = false;
+    bool more = _prefetch && (s.error == UA_STATUSCODE_GOOD) && !s.queue.empty();
+    l.unlock();
+    if (more)
+        State::send(_state);
+    return true;
+}
+
+/*!
+    \brief Open62541::HistoryReader::next
+    \param v
+    \return true if a value was returned
+*/
+bool Open62541::HistoryReader::next(Value& v)
+{
+    while (_position >= _current.size()) {
+        if (!fill())
+            return false;
+    }
+    v = std::move(_current[_position++]);
+    return true;
+}
+
+/*!
+    \brief Open62541::HistoryReader::nextPage
+    \param page
+    \return true if values were returned
+*/
+bool Open62541::HistoryReader::nextPage(std::vector<Value>& page)
+{
+    page.clear();
+    while (_position >= _current.size()) {
+        if (!fill())
+            return false;
+    }
+    page.insert(page.end(),
+                std::make_move_iterator(_current.begin() + _position),
+                std::make_move_iterator(_current.end()));
+    _position = _current.size();
+    return true;
+}
+
+/*!
+    \brief Open62541::HistoryReader::status
+    \param node
+    \return status
+*/
+UA_StatusCode Open62541::HistoryReader::status(size_t node) const
+{
+    std::lock_guard<std::mutex> l(_state->mutex);
+    return (node < _state->status.size()) ? _state->status[node] : UA_STATUSCODE_BADINDEXRANGEINVALID;
+}
+
+/*!
+    \brief Open62541::HistoryReader::requests
+    \return requests sent
+*/
+size_t Open62541::HistoryReader::requests() const
+{
+    std::lock_guard<std::mutex> l(_state->mutex);
+    return _state->requests;
+}
+
+/*!
+    \brief Open62541::HistoryReader::valuesRead
+    \return values received
+*/
+uint64_t Open62541::HistoryReader::valuesRead() const
+{
+    std::lock_guard<std::mutex> l(_state->mutex);
+    return _state->values;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/instancetemplate.h>
+#include <open62541cpp/open62541server.h>
+
+namespace {
+/*!
+    \brief browseRefs
+    \param s
+    \param n node
+    \param ref ns0 reference type - subtypes included
+    \param dir
+    \return browse result - the caller clears it
+*/
+UA_BrowseResult browseRefs(UA_Server* s, const UA_NodeId& n, UA_UInt32 ref, UA_BrowseDirection dir)
+{
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId          = n;  // shallow - bd is not cleared
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, ref);
+    bd.includeSubtypes = true;
+    bd.browseDirection = dir;
+    bd.resultMask      = UA_BROWSERESULTMASK_ALL;
+    return UA_Server_browse(s, 0, &bd);
+}
+
+/*!
+    \brief isMandatory
+    \param s
+    \param n instance declaration
+    \return true if its modelling rule is Mandatory
+*/
+bool isMandatory(UA_Server* s, const UA_NodeId& n)
+{
+    UA_BrowseResult r = browseRefs(s, n, UA_NS0ID_HASMODELLINGRULE, UA_BROWSEDIRECTION_FORWARD);
+    const UA_NodeId mandatory = UA_NODEID_NUMERIC(0, UA_NS0ID_MODELLINGRULE_MANDATORY);
+    bool ret                  = false;
+    for (size_t i = 0; (i < r.referencesSize) && !ret; i++) {
+        ret = UA_NodeId_equal(&r.references[i].nodeId.nodeId, &mandatory);
+    }
+    UA_BrowseResult_clear(&r);
+    return ret;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::InstanceTemplate::collect
+    Append the mandatory children of a node and, depth first, theirs
+    \param s
+    \param node
+    \param parent entry of node - Root for the type
+*/
+void Open62541::InstanceTemplate::collect(UA_Server* s, const UA_NodeId& node, size_t parent)
+{
+    UA_BrowseResult r = browseRefs(s, node, UA_NS0ID_AGGREGATES, UA_BROWSEDIRECTION_FORWARD);
+    for (size_t i = 0; i < r.referencesSize; i++) {
+        const UA_ReferenceDescription& rd = r.references[i];
+        if ((rd.nodeClass != UA_NODECLASS_OBJECT) && (rd.nodeClass != UA_NODECLASS_VARIABLE))
+            continue;
+        if (!isMandatory(s, rd.nodeId.nodeId))
+            continue;
+        if (parent == Root) {
+            // a subtype overrides a child of the same name in its supertypes - the subtype is collected first
+            bool seen = false;
+            for (const Entry& e : _entries) {
+                if ((e.parent == Root) && UA_QualifiedName_equal(e.browseName.constRef(), &rd.browseName)) {
+                    seen = true;
+                    break;
+                }
+            }
+            if (seen)
+                continue;
+        }
+        Entry e;
+        e.parent         = parent;
+        e.nodeClass      = rd.nodeClass;
+        e.referenceType.assignInPlace(rd.referenceTypeId);
+        e.typeDefinition.assignInPlace(rd.typeDefinition.nodeId);
+        e.browseName.assignInPlace(rd.browseName);
+        const UA_NodeId& n = rd.nodeId.nodeId;
+        if (rd.nodeClass == UA_NODECLASS_VARIABLE) {
+            UA_VariableAttributes& a = e.variable.get();
+            a                        = UA_VariableAttributes_default;  // nothing allocated yet
+            UA_Server_readDisplayName(s, n, &a.displayName);
+            UA_Server_readDescription(s, n, &a.description);
+            UA_Server_readValue(s, n, &a.value);
+            UA_Server_readDataType(s, n, &a.dataType);
+            UA_Server_readValueRank(s, n, &a.valueRank);
+            UA_Server_readAccessLevel(s, n, &a.accessLevel);
+            UA_Server_readMinimumSamplingInterval(s, n, &a.minimumSamplingInterval);
+            UA_Server_readHistorizing(s, n, &a.historizing);
+            UA_Server_readWriteMask(s, n, &a.writeMask);
+            UA_Variant dims;
+            UA_Variant_init(&dims);
+            if ((UA_Server_readArrayDimensions(s, n, &dims) == UA_STATUSCODE_GOOD) &&
+                (dims.type == &UA_TYPES[UA_TYPES_UINT32]) && (dims.arrayLength > 0)) {
+                a.arrayDimensions     = static_cast<UA_UInt32*>(dims.data);  // take the array
+                a.arrayDimensionsSize = dims.arrayLength;
+                UA_Variant_init(&dims);
+            }
+            UA_Variant_clear(&dims);
+        }
+        else {
+            UA_ObjectAttributes& a = e.object.get();
+            a                      = UA_ObjectAttributes_default;
+            UA_Server_readDisplayName(s, n, &a.displayName);
+            UA_Server_readDescription(s, n, &a.description);
+            UA_Server_readEventNotifier(s, n, &a.eventNotifier);
+            UA_Server_readWriteMask(s, n, &a.writeMask);
+        }
+        UA_Nodestore& store = UA_Server_getConfig(s)->nodestore;
+        const UA_Node* decl = store.getNode(store.context, &n);
+        if (decl) {
+            e.context = decl->head.context;
+            if (rd.nodeClass == UA_NODECLASS_VARIABLE) {
+                e.valueSource = decl->variableNode.valueSource;
+                if (e.valueSource == UA_VALUESOURCE_DATASOURCE)
+                    e.dataSource = decl->variableNode.value.dataSource;
+                else
+                    e.valueCallback = decl->variableNode.value.data.callback;
+            }
+            store.releaseNode(store.context, decl);
+        }
+        _entries.push_back(std::move(e));
+        collect(s, n, _entries.size() - 1);
+    }
+    UA_BrowseResult_clear(&r);
+}
+
+/*!
+    \brief Open62541::InstanceTemplate::build
+    \param s
+    \param typeId
+    \return true on success
+*/
+bool Open62541::InstanceTemplate::build(Server& s, const NodeId& typeId)
+{
+    clear();
+    _typeId = typeId;
+    if (!s.server())
+        return false;
+    WriteLock l(s.mutex());
+    const UA_NodeId base = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE);
+    UA_NodeId t;
+    UA_NodeId_copy(typeId.constRef(), &t);
+    // the type then its supertypes - the instance gets the children of them all
+    while (!UA_NodeId_isNull(&t) && !UA_NodeId_equal(&t, &base)) {
+        collect(s.server(), t, Root);
+        UA_BrowseResult r = browseRefs(s.server(), t, UA_NS0ID_HASSUBTYPE, UA_BROWSEDIRECTION_INVERSE);
+        UA_NodeId_clear(&t);
+        if (r.referencesSize > 0)
+            UA_NodeId_copy(&r.references[0].nodeId.nodeId, &t);
+        UA_BrowseResult_clear(&r);
+    }
+    UA_NodeId_clear(&t);
+    _valid = true;
+    return true;
+}
+
+/*!
+    \brief Open62541::InstanceTemplate::instantiate
+    \param s
+    \param requestedId
+    \param parent
+    \param referenceType
+    \param browseName
+    \param attr
+    \param context
+    \param out
+    \return status code
+*/
+UA_StatusCode Open62541::InstanceTemplate::instantiate(UA_Server* s,
+                                                       const UA_NodeId& requestedId,
+                                                       const UA_NodeId& parent,
+                                                       const UA_NodeId& referenceType,
+                                                       const UA_QualifiedName& browseName,
+                                                       const UA_ObjectAttributes& attr,
+                                                       void* context,
+                                                       UA_NodeId* out)
+{
+    if (!_valid)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_NodeId root;
+    UA_NodeId_init(&root);
+    UA_StatusCode ret = UA_Server_addNode_begin(s,
+                                                UA_NODECLASS_OBJECT,
+                                                requestedId,
+                                                parent,
+                                                referenceType,
+                                                browseName,
+                                                _typeId,
+                                                &attr,
+                                                &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES],
+                                                context,
+                                                &root);
+    if (ret != UA_STATUSCODE_GOOD)
+        return ret;
+    //
+    std::vector<UA_NodeId> ids(_entries.size());
+    for (auto& i : ids) {
+        UA_NodeId_init(&i);
+    }
+    for (size_t i = 0; (i < _entries.size()) && (ret == UA_STATUSCODE_GOOD); i++) {
+        const Entry& e     = _entries[i];
+        const UA_NodeId& p = (e.parent == Root) ? root : ids[e.parent];
+        const UA_NodeId id = UA_NODEID_NUMERIC(p.namespaceIndex, 0);  // server assigned in the parent namespace
+        if (e.nodeClass == UA_NODECLASS_VARIABLE) {
+            ret = UA_Server_addNode_begin(s,
+                                          UA_NODECLASS_VARIABLE,
+                                          id,
+                                          p,
+                                          e.referenceType,
+                                          e.browseName,
+                                          e.typeDefinition,
+                                          e.variable.constRef(),
+                                          &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES],
+                                          e.context,
+                                          &ids[i]);
+            if (ret == UA_STATUSCODE_GOOD) {
+                if (e.valueSource == UA_VALUESOURCE_DATASOURCE)
+                    ret = UA_Server_setVariableNode_dataSource(s, ids[i], e.dataSource);
+                else if (e.valueCallback.onRead || e.valueCallback.onWrite)
+                    ret = UA_Server_setVariableNode_valueCallback(s, ids[i], e.valueCallback);
+            }
+        }
+        else {
+            ret = UA_Server_addNode_begin(s,
+                                          UA_NODECLASS_OBJECT,
+                                          id,
+                                          p,
+                                          e.referenceType,
+                                          e.browseName,
+                                          e.typeDefinition,
+                                          e.object.constRef(),
+                                          &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES],
+                                          e.context,
+                                          &ids[i]);
+        }
+    }
+    // leaves first so every node finds its children in place and none are copied from the type
+    for (size_t i = ids.size(); (i > 0) && (ret == UA_STATUSCODE_GOOD); i--) {
+        ret = UA_Server_addNode_finish(s, ids[i - 1]);
+    }
+    if (ret == UA_STATUSCODE_GOOD)
+        ret = UA_Server_addNode_finish(s, root);
+    //
+    if (ret != UA_STATUSCODE_GOOD) {
+        UA_Server_deleteNode(s, root, true);
+    }
+    else if (out) {
+        UA_NodeId_clear(out);
+        *out = root;  // handed over
+        UA_NodeId_init(&root);
+    }
+    UA_NodeId_clear(&root);
+    for (auto& i : ids) {
+        UA_NodeId_clear(&i);
+    }
+    return ret;
+}
@@ -0,0 +1,1069 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/jsonstream.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+static const char Base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*!
+    \brief builtInType
+    \param id built in type id as in Part 6
+    \return the supported data type with that id or nullptr
+*/
+static const UA_DataType* builtInType(int64_t id)
+{
+    static const int supported[] = {UA_TYPES_BOOLEAN,
+                                    UA_TYPES_SBYTE,
+                                    UA_TYPES_BYTE,
+                                    UA_TYPES_INT16,
+                                    UA_TYPES_UINT16,
+                                    UA_TYPES_INT32,
+                                    UA_TYPES_UINT32,
+                                    UA_TYPES_INT64,
+                                    UA_TYPES_UINT64,
+                                    UA_TYPES_FLOAT,
+                                    UA_TYPES_DOUBLE,
+                                    UA_TYPES_STRING,
+                                    UA_TYPES_DATETIME,
+                                    UA_TYPES_BYTESTRING,
+                                    UA_TYPES_STATUSCODE};
+    for (int i : supported) {
+        if (int64_t(UA_TYPES[i].typeId.identifier.numeric) == id)
+            return &UA_TYPES[i];
+    }
+    return nullptr;
+}
+
+/*!
+    \brief daysFromCivil
+    \return days since 1970-01-01 of a proleptic Gregorian date
+*/
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+    y -= (m <= 2);
+    const int64_t era  = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = unsigned(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + int64_t(doe) - 719468;
+}
+
+//
+// JsonWriter
+//
+
+/*!
+    \brief Open62541::JsonWriter::separator
+    Comma before the second and later values of a container - none after a key
+*/
+void Open62541::JsonWriter::separator()
+{
+    if (_key) {
+        _key = false;
+        return;
+    }
+    if (!_empty.empty()) {
+        if (_empty.back())
+            _empty.back() = false;
+        else
+            _buffer += ',';
+    }
+}
+
+/*!
+    \brief Open62541::JsonWriter::escaped
+    Append a quoted string - runs of plain characters are appended in one go
+*/
+void Open62541::JsonWriter::escaped(const char* s, size_t n)
+{
+    static const char hex[] = "0123456789abcdef";
+    _buffer += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+        _buffer.append(s + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':
+                _buffer += "\\\"";
+                break;
+            case '\\':
+                _buffer += "\\\\";
+                break;
+            case '\n':
+                _buffer += "\\n";
+                break;
+            case '\r':
+                _buffer += "\\r";
+                break;
+            case '\t':
+                _buffer += "\\t";
+                break;
+            case '\b':
+                _buffer += "\\b";
+                break;
+            case '\f':
+                _buffer += "\\f";
+                break;
+            default: {
+                char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                _buffer.append(u, 6);
+            } break;
+        }
+    }
+    _buffer.append(s + run, n - run);
+    _buffer += '"';
+}
+
+/*!
+    \brief Open62541::JsonWriter::beginObject
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::beginObject()
+{
+    separator();
+    _buffer += '{';
+    _empty.push_back(true);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::endObject
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::endObject()
+{
+    _buffer += '}';
+    if (!_empty.empty())
+        _empty.pop_back();
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::beginArray
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::beginArray()
+{
+    separator();
+    _buffer += '[';
+    _empty.push_back(true);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::endArray
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::endArray()
+{
+    _buffer += ']';
+    if (!_empty.empty())
+        _empty.pop_back();
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::key
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::key(const char* k, size_t n)
+{
+    separator();
+    escaped(k, n);
+    _buffer += ':';
+    _key = true;
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::null
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::null()
+{
+    separator();
+    _buffer.append("null", 4);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::boolean
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::boolean(bool f)
+{
+    separator();
+    if (f)
+        _buffer.append("true", 4);
+    else
+        _buffer.append("false", 5);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::number
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::number(int64_t v)
+{
+    separator();
+    char b[24];
+    char* e = b + sizeof(b);
+    char* p = e;
+    uint64_t u = (v < 0) ? (0 - uint64_t(v)) : uint64_t(v);
+    do {
+        *--p = char('0' + (u % 10));
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        *--p = '-';
+    _buffer.append(p, size_t(e - p));
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::number
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::number(uint64_t v)
+{
+    separator();
+    char b[24];
+    char* e = b + sizeof(b);
+    char* p = e;
+    do {
+        *--p = char('0' + (v % 10));
+        v /= 10;
+    } while (v);
+    _buffer.append(p, size_t(e - p));
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::number
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::number(double v)
+{
+    if (std::isnan(v))
+        return string("NaN", 3);
+    if (std::isinf(v))
+        return (v > 0) ? string("Infinity", 8) : string("-Infinity", 9);
+    separator();
+    char b[32];
+    int n = snprintf(b, sizeof(b), "%.15g", v);
+    if (strtod(b, nullptr) != v)
+        n = snprintf(b, sizeof(b), "%.17g", v);
+    _buffer.append(b, size_t(n));
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::string
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::string(const char* s, size_t n)
+{
+    separator();
+    escaped(s, n);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::raw
+    \return *this
+*/
+Open62541::JsonWriter& Open62541::JsonWriter::raw(const char* s, size_t n)
+{
+    separator();
+    _buffer.append(s, n);
+    return *this;
+}
+
+/*!
+    \brief Open62541::JsonWriter::body
+    \param p value
+    \param t type
+    \return false if not supported
+*/
+bool Open62541::JsonWriter::body(const void* p, const UA_DataType* t)
+{
+    if (t == &UA_TYPES[UA_TYPES_DOUBLE])
+        number(double(*static_cast<const UA_Double*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_FLOAT])
+        number(double(*static_cast<const UA_Float*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_INT32])
+        number(int64_t(*static_cast<const UA_Int32*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_UINT32])
+        number(uint64_t(*static_cast<const UA_UInt32*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_BOOLEAN])
+        boolean(*static_cast<const UA_Boolean*>(p));
+    else if (t == &UA_TYPES[UA_TYPES_STRING])
+        string(*static_cast<const UA_String*>(p));
+    else if (t == &UA_TYPES[UA_TYPES_INT16])
+        number(int64_t(*static_cast<const UA_Int16*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_UINT16])
+        number(uint64_t(*static_cast<const UA_UInt16*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_SBYTE])
+        number(int64_t(*static_cast<const UA_SByte*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_BYTE])
+        number(uint64_t(*static_cast<const UA_Byte*>(p)));
+    else if (t == &UA_TYPES[UA_TYPES_STATUSCODE])
+        number(uint64_t(*static_cast<const UA_StatusCode*>(p)));
+    else if ((t == &UA_TYPES[UA_TYPES_INT64]) || (t == &UA_TYPES[UA_TYPES_UINT64])) {
+        // 64 bit integers are strings in Part 6 - JSON numbers are doubles to most readers
+        char b[24];
+        int n = (t == &UA_TYPES[UA_TYPES_INT64])
+                    ? snprintf(b, sizeof(b), "%lld", (long long)(*static_cast<const UA_Int64*>(p)))
+                    : snprintf(b, sizeof(b), "%llu", (unsigned long long)(*static_cast<const UA_UInt64*>(p)));
+        string(b, size_t(n));
+    }
+    else if (t == &UA_TYPES[UA_TYPES_DATETIME]) {
+        UA_DateTime d         = *static_cast<const UA_DateTime*>(p);
+        UA_DateTimeStruct dts = UA_DateTime_toStruct(d);
+        long frac             = long(((d % UA_DATETIME_SEC) + UA_DATETIME_SEC) % UA_DATETIME_SEC);
+        char b[40];
+        int n = snprintf(b,
+                         sizeof(b),
+                         "%04d-%02u-%02uT%02u:%02u:%02u.%07ldZ",
+                         int(dts.year),
+                         unsigned(dts.month),
+                         unsigned(dts.day),
+                         unsigned(dts.hour),
+                         unsigned(dts.min),
+                         unsigned(dts.sec),
+                         frac);
+        string(b, size_t(n));
+    }
+    else if (t == &UA_TYPES[UA_TYPES_BYTESTRING]) {
+        const UA_ByteString& s = *static_cast<const UA_ByteString*>(p);
+        separator();
+        _buffer += '"';
+        size_t i = 0;
+        for (; i + 3 <= s.length; i += 3) {
+            uint32_t x = (uint32_t(s.data[i]) << 16) | (uint32_t(s.data[i + 1]) << 8) | s.data[i + 2];
+            char q[4]  = {Base64[x >> 18], Base64[(x >> 12) & 63], Base64[(x >> 6) & 63], Base64[x & 63]};
+            _buffer.append(q, 4);
+        }
+        if (i < s.length) {
+            uint32_t x = uint32_t(s.data[i]) << 16;
+            if (i + 1 < s.length)
+                x |= uint32_t(s.data[i + 1]) << 8;
+            char q[4] = {Base64[x >> 18], Base64[(x >> 12) & 63], (i + 1 < s.length) ? Base64[(x >> 6) & 63] : '=', '='};
+            _buffer.append(q, 4);
+        }
+        _buffer += '"';
+    }
+    else {
+        null();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonWriter::scalar
+    \return false if not supported
+*/
+bool Open62541::JsonWriter::scalar(const void* p, const UA_DataType* t)
+{
+    if (!p || !t) {
+        null();
+        return false;
+    }
+    return body(p, t);
+}
+
+/*!
+    \brief Open62541::JsonWriter::variant
+    \return false if not supported
+*/
+bool Open62541::JsonWriter::variant(const UA_Variant& v)
+{
+    beginObject();
+    if (!v.type) {
+        endObject();  // empty variant
+        return true;
+    }
+    key("Type", 4).number(uint64_t(v.type->typeId.identifier.numeric));
+    key("Body", 4);
+    bool ret = true;
+    if (UA_Variant_isScalar(&v)) {
+        ret = scalar(v.data, v.type);
+    }
+    else {
+        beginArray();
+        const char* p = static_cast<const char*>(v.data);
+        for (size_t i = 0; (i < v.arrayLength) && ret; i++, p += v.type->memSize) {
+            ret = body(p, v.type);
+        }
+        endArray();
+        if (v.arrayDimensionsSize > 1) {
+            key("Dimensions", 10).beginArray();
+            for (size_t i = 0; i < v.arrayDimensionsSize; i++) {
+                number(uint64_t(v.arrayDimensions[i]));
+            }
+            endArray();
+        }
+    }
+    endObject();
+    return ret;
+}
+
+//
+// JsonReader
+//
+
+/*!
+    \brief Open62541::JsonReader::space
+*/
+void Open62541::JsonReader::space()
+{
+    while ((_p < _end) && ((*_p == ' ') || (*_p == '\n') || (*_p == '\r') || (*_p == '\t')))
+        _p++;
+}
+
+/*!
+    \brief Open62541::JsonReader::expect
+    \return true if c is next - and consumed
+*/
+bool Open62541::JsonReader::expect(char c)
+{
+    space();
+    if ((_p < _end) && (*_p == c)) {
+        _p++;
+        return true;
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::JsonReader::literal
+    \return true if the literal was next - and consumed
+*/
+bool Open62541::JsonReader::literal(const char* s, size_t n)
+{
+    if (!_ok)
+        return false;
+    space();
+    if ((size_t(_end - _p) >= n) && !memcmp(_p, s, n)) {
+        _p += n;
+        return true;
+    }
+    return fail();
+}
+
+/*!
+    \brief Open62541::JsonReader::atEnd
+    \return true if only white space is left
+*/
+bool Open62541::JsonReader::atEnd()
+{
+    space();
+    return _p == _end;
+}
+
+/*!
+    \brief Open62541::JsonReader::peek
+    \return type of the next value
+*/
+Open62541::JsonReader::Type Open62541::JsonReader::peek()
+{
+    if (!_ok)
+        return Type::Invalid;
+    space();
+    if (_p == _end)
+        return Type::Invalid;
+    switch (*_p) {
+        case '{':
+            return Type::Object;
+        case '[':
+            return Type::Array;
+        case '"':
+            return Type::String;
+        case 't':
+        case 'f':
+            return Type::Boolean;
+        case 'n':
+            return Type::Null;
+        default:
+            break;
+    }
+    return ((*_p == '-') || ((*_p >= '0') && (*_p <= '9'))) ? Type::Number : Type::Invalid;
+}
+
+/*!
+    \brief Open62541::JsonReader::beginObject
+    \return false if an object is not next
+*/
+bool Open62541::JsonReader::beginObject()
+{
+    if (!_ok || !expect('{'))
+        return fail();
+    _first.push_back(true);
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::member
+    \return false at the end of the object
+*/
+bool Open62541::JsonReader::member(std::string& key)
+{
+    if (!_ok || _first.empty())
+        return fail();
+    if (expect('}')) {
+        _first.pop_back();
+        return false;
+    }
+    if (!_first.back() && !expect(','))
+        return fail();
+    _first.back() = false;
+    return string(key) && (expect(':') || fail());
+}
+
+/*!
+    \brief Open62541::JsonReader::beginArray
+    \return false if an array is not next
+*/
+bool Open62541::JsonReader::beginArray()
+{
+    if (!_ok || !expect('['))
+        return fail();
+    _first.push_back(true);
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::element
+    \return false at the end of the array
+*/
+bool Open62541::JsonReader::element()
+{
+    if (!_ok || _first.empty())
+        return fail();
+    if (expect(']')) {
+        _first.pop_back();
+        return false;
+    }
+    if (!_first.back() && !expect(','))
+        return fail();
+    _first.back() = false;
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::null
+    \return true if null was read
+*/
+bool Open62541::JsonReader::null() { return literal("null", 4); }
+
+/*!
+    \brief Open62541::JsonReader::boolean
+    \return true if a boolean was read
+*/
+bool Open62541::JsonReader::boolean(bool& f)
+{
+    if (!_ok)
+        return false;
+    space();
+    if ((_p < _end) && (*_p == 't')) {
+        f = true;
+        return literal("true", 4);
+    }
+    f = false;
+    return literal("false", 5);
+}
+
+/*!
+    \brief Open62541::JsonReader::numberText
+    Copy the text of the next number, terminated, for strtod and friends
+    \return false if a number is not next or it is too long
+*/
+bool Open62541::JsonReader::numberText(char* b, size_t n)
+{
+    if (peek() != Type::Number)
+        return fail();
+    size_t i = 0;
+    while ((_p < _end) && (i + 1 < n) &&
+           (((*_p >= '0') && (*_p <= '9')) || (*_p == '-') || (*_p == '+') || (*_p == '.') || (*_p == 'e') ||
+            (*_p == 'E'))) {
+        b[i++] = *_p++;
+    }
+    b[i] = 0;
+    return (i + 1 < n) || fail();
+}
+
+/*!
+    \brief Open62541::JsonReader::number
+    \return true if a number was read
+*/
+bool Open62541::JsonReader::number(double& v)
+{
+    if (peek() == Type::String) {
+        std::string s;
+        if (!string(s))
+            return false;
+        if (s == "NaN")
+            v = NAN;
+        else if (s == "Infinity")
+            v = HUGE_VAL;
+        else if (s == "-Infinity")
+            v = -HUGE_VAL;
+        else
+            return fail();
+        return true;
+    }
+    char b[64];
+    if (!numberText(b, sizeof(b)))
+        return false;
+    char* e = nullptr;
+    v       = strtod(b, &e);
+    return (e && !*e) || fail();
+}
+
+/*!
+    \brief Open62541::JsonReader::number
+    Integers may also be strings, as 64 bit integers are in Part 6
+    \return true if an integer was read
+*/
+bool Open62541::JsonReader::number(int64_t& v)
+{
+    char b[64];
+    std::string s;
+    const char* t = b;
+    if (peek() == Type::String) {
+        if (!string(s))
+            return false;
+        t = s.c_str();
+    }
+    else if (!numberText(b, sizeof(b)))
+        return false;
+    char* e = nullptr;
+    v       = strtoll(t, &e, 10);
+    if (e && *e) {
+        double d = strtod(t, &e);  // 1e3 or 5.0
+        if (!e || *e || (d != std::floor(d)))
+            return fail();
+        v = int64_t(d);
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::number
+    \return true if an unsigned integer was read
+*/
+bool Open62541::JsonReader::number(uint64_t& v)
+{
+    char b[64];
+    std::string s;
+    const char* t = b;
+    if (peek() == Type::String) {
+        if (!string(s))
+            return false;
+        t = s.c_str();
+    }
+    else if (!numberText(b, sizeof(b)))
+        return false;
+    if (*t == '-')
+        return fail();
+    char* e = nullptr;
+    v       = strtoull(t, &e, 10);
+    if (e && *e) {
+        double d = strtod(t, &e);
+        if (!e || *e || (d != std::floor(d)))
+            return fail();
+        v = uint64_t(d);
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::string
+    \param s set to the unescaped string - its capacity is reused
+    \return true if a string was read
+*/
+bool Open62541::JsonReader::string(std::string& s)
+{
+    if (!_ok || !expect('"'))
+        return fail();
+    s.clear();
+    const char* run = _p;
+    while (_p < _end) {
+        char c = *_p;
+        if (c == '"') {
+            s.append(run, size_t(_p - run));
+            _p++;
+            return true;
+        }
+        if (c != '\\') {
+            _p++;
+            continue;
+        }
+        s.append(run, size_t(_p - run));
+        if (++_p == _end)
+            break;
+        switch (*_p++) {
+            case '"':
+                s += '"';
+                break;
+            case '\\':
+                s += '\\';
+                break;
+            case '/':
+                s += '/';
+                break;
+            case 'n':
+                s += '\n';
+                break;
+            case 'r':
+                s += '\r';
+                break;
+            case 't':
+                s += '\t';
+                break;
+            case 'b':
+                s += '\b';
+                break;
+            case 'f':
+                s += '\f';
+                break;
+            case 'u': {
+                auto hex4 = [this](uint32_t& u) {
+                    if ((_end - _p) < 4)
+                        return false;
+                    u = 0;
+                    for (int i = 0; i < 4; i++) {
+                        char h = *_p++;
+                        u <<= 4;
+                        if ((h >= '0') && (h <= '9'))
+                            u |= uint32_t(h - '0');
+                        else if ((h >= 'a') && (h <= 'f'))
+                            u |= uint32_t(h - 'a' + 10);
+                        else if ((h >= 'A') && (h <= 'F'))
+                            u |= uint32_t(h - 'A' + 10);
+                        else
+                            return false;
+                    }
+                    return true;
+                };
+                uint32_t u = 0;
+                if (!hex4(u))
+                    return fail();
+                if ((u >= 0xD800) && (u < 0xDC00)) {
+                    // surrogate pair
+                    uint32_t l = 0;
+                    if (((_end - _p) < 2) || (_p[0] != '\\') || (_p[1] != 'u'))
+                        return fail();
+                    _p += 2;
+                    if (!hex4(l) || (l < 0xDC00) || (l > 0xDFFF))
+                        return fail();
+                    u = 0x10000 + ((u - 0xD800) << 10) + (l - 0xDC00);
+                }
+                // UTF-8
+                if (u < 0x80) {
+                    s += char(u);
+                }
+                else if (u < 0x800) {
+                    s += char(0xC0 | (u >> 6));
+                    s += char(0x80 | (u & 0x3F));
+                }
+                else if (u < 0x10000) {
+                    s += char(0xE0 | (u >> 12));
+                    s += char(0x80 | ((u >> 6) & 0x3F));
+                    s += char(0x80 | (u & 0x3F));
+                }
+                else {
+                    s += char(0xF0 | (u >> 18));
+                    s += char(0x80 | ((u >> 12) & 0x3F));
+                    s += char(0x80 | ((u >> 6) & 0x3F));
+                    s += char(0x80 | (u & 0x3F));
+                }
+            } break;
+            default:
+                return fail();
+        }
+        run = _p;
+    }
+    return fail();  // unterminated
+}
+
+/*!
+    \brief Open62541::JsonReader::skip
+    \return false on a syntax error
+*/
+bool Open62541::JsonReader::skip()
+{
+    std::string s;
+    switch (peek()) {
+        case Type::Object:
+            if (!beginObject())
+                return false;
+            while (member(s)) {
+                if (!skip())
+                    return false;
+            }
+            return _ok;
+        case Type::Array:
+            if (!beginArray())
+                return false;
+            while (element()) {
+                if (!skip())
+                    return false;
+            }
+            return _ok;
+        case Type::String:
+            return string(s);
+        case Type::Number: {
+            double d;
+            return number(d);
+        }
+        case Type::Boolean: {
+            bool f;
+            return boolean(f);
+        }
+        case Type::Null:
+            return null();
+        default:
+            break;
+    }
+    return fail();
+}
+
+/*!
+    \brief Open62541::JsonReader::value
+    Read one built in value into initialised memory of its type
+    \return false on error
+*/
+bool Open62541::JsonReader::value(const UA_DataType* t, void* p)
+{
+    if (t == &UA_TYPES[UA_TYPES_DOUBLE] || t == &UA_TYPES[UA_TYPES_FLOAT]) {
+        double d = 0.0;
+        if (!number(d))
+            return false;
+        if (t == &UA_TYPES[UA_TYPES_DOUBLE])
+            *static_cast<UA_Double*>(p) = d;
+        else
+            *static_cast<UA_Float*>(p) = UA_Float(d);
+        return true;
+    }
+    if (t == &UA_TYPES[UA_TYPES_BOOLEAN]) {
+        bool f = false;
+        if (!boolean(f))
+            return false;
+        *static_cast<UA_Boolean*>(p) = f;
+        return true;
+    }
+    if ((t == &UA_TYPES[UA_TYPES_STRING]) || (t == &UA_TYPES[UA_TYPES_BYTESTRING])) {
+        std::string s;
+        if (!string(s))
+            return false;
+        UA_String& r = *static_cast<UA_String*>(p);
+        if (t == &UA_TYPES[UA_TYPES_BYTESTRING]) {
+            // base64
+            std::string b;
+            uint32_t x = 0;
+            int bits   = 0;
+            for (char c : s) {
+                const char* q = (c == '=') ? nullptr : strchr(Base64, c);
+                if (!q || !c)
+                    continue;
+                x = (x << 6) | uint32_t(q - Base64);
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    b += char((x >> bits) & 0xFF);
+                }
+            }
+            s.swap(b);
+        }
+        if (!s.empty()) {
+            r.data = static_cast<UA_Byte*>(UA_malloc(s.size()));
+            if (!r.data)
+                return fail();
+            memcpy(r.data, s.data(), s.size());
+        }
+        r.length = s.size();
+        return true;
+    }
+    if (t == &UA_TYPES[UA_TYPES_DATETIME]) {
+        std::string s;
+        if (!string(s))
+            return false;
+        int y = 0, mo = 0, d = 0, h = 0, mi = 0, se = 0, n = 0;
+        if ((sscanf(s.c_str(), "%d-%d-%dT%d:%d:%d%n", &y, &mo, &d, &h, &mi, &se, &n) < 6) || (mo < 1) || (mo > 12) ||
+            (d < 1) || (d > 31))
+            return fail();
+        int64_t frac   = 0;
+        const char* fp = s.c_str() + n;
+        if (*fp == '.') {
+            int digits = 0;
+            for (fp++; (*fp >= '0') && (*fp <= '9'); fp++) {
+                if (digits++ < 7)
+                    frac = frac * 10 + (*fp - '0');
+            }
+            for (; digits < 7; digits++) {
+                frac *= 10;
+            }
+        }
+        int64_t secs = daysFromCivil(y, unsigned(mo), unsigned(d)) * 86400 + h * 3600 + mi * 60 + se;
+        *static_cast<UA_DateTime*>(p) = secs * UA_DATETIME_SEC + frac + UA_DATETIME_UNIX_EPOCH;
+        return true;
+    }
+    if ((t == &UA_TYPES[UA_TYPES_UINT64]) || (t == &UA_TYPES[UA_TYPES_UINT32]) || (t == &UA_TYPES[UA_TYPES_UINT16]) ||
+        (t == &UA_TYPES[UA_TYPES_BYTE]) || (t == &UA_TYPES[UA_TYPES_STATUSCODE])) {
+        uint64_t u = 0;
+        if (!number(u))
+            return false;
+        if (t == &UA_TYPES[UA_TYPES_UINT64])
+            *static_cast<UA_UInt64*>(p) = u;
+        else if (t == &UA_TYPES[UA_TYPES_UINT32])
+            *static_cast<UA_UInt32*>(p) = UA_UInt32(u);
+        else if (t == &UA_TYPES[UA_TYPES_UINT16])
+            *static_cast<UA_UInt16*>(p) = UA_UInt16(u);
+        else if (t == &UA_TYPES[UA_TYPES_BYTE])
+            *static_cast<UA_Byte*>(p) = UA_Byte(u);
+        else
+            *static_cast<UA_StatusCode*>(p) = UA_StatusCode(u);
+        return true;
+    }
+    int64_t i = 0;
+    if (!number(i))
+        return false;
+    if (t == &UA_TYPES[UA_TYPES_INT64])
+        *static_cast<UA_Int64*>(p) = i;
+    else if (t == &UA_TYPES[UA_TYPES_INT32])
+        *static_cast<UA_Int32*>(p) = UA_Int32(i);
+    else if (t == &UA_TYPES[UA_TYPES_INT16])
+        *static_cast<UA_Int16*>(p) = UA_Int16(i);
+    else if (t == &UA_TYPES[UA_TYPES_SBYTE])
+        *static_cast<UA_SByte*>(p) = UA_SByte(i);
+    else
+        return fail();
+    return true;
+}
+
+/*!
+    \brief Open62541::JsonReader::array
+    Count the elements then read them straight into the variant's array
+    \return false on error
+*/
+bool Open62541::JsonReader::array(const UA_DataType* t, UA_Variant& v)
+{
+    const char* start = _p;
+    size_t n          = 0;
+    if (!beginArray())
+        return false;
+    while (element()) {
+        if (!skip())
+            return false;
+        n++;
+    }
+    if (!_ok)
+        return false;
+    _p = start;
+    void* a = UA_Array_new(n, t);
+    if (!a && n)
+        return fail();
+    UA_Variant_setArray(&v, a, n, t);
+    beginArray();
+    char* p = static_cast<char*>(a);
+    while (element()) {
+        if (!value(t, p))
+            return false;
+        p += t->memSize;
+    }
+    return _ok;
+}
+
+/*!
+    \brief Open62541::JsonReader::variant
+    \return false on error
+*/
+bool Open62541::JsonReader::variant(UA_Variant& v)
+{
+    UA_Variant_clear(&v);
+    if (!beginObject())
+        return false;
+    std::string k;
+    int64_t id       = -1;
+    const char* body = nullptr;  // the body may come before the type
+    const char* dims = nullptr;
+    while (member(k)) {
+        if (k == "Type") {
+            if (!number(id))
+                return false;
+        }
+        else {
+            space();
+            if (k == "Body")
+                body = _p;
+            else if (k == "Dimensions")
+                dims = _p;
+            if (!skip())
+                return false;
+        }
+    }
+    if (!_ok)
+        return false;
+    if (id < 0)
+        return !body || fail();  // empty variant
+    const UA_DataType* t = builtInType(id);
+    if (!t || !body)
+        return fail();
+    const char* end = _p;
+    std::vector<bool> first;
+    first.swap(_first);  // the body is read as a document of its own
+    _p = body;
+    bool ret = false;
+    if (peek() == Type::Array) {
+        ret = array(t, v);
+        if (ret && dims) {
+            _p = dims;
+            std::vector<UA_UInt32> d;
+            if (beginArray()) {
+                uint64_t u = 0;
+                while (element() && number(u)) {
+                    d.push_back(UA_UInt32(u));
+                }
+            }
+            ret = _ok;
+            if (ret && (d.size() > 1)) {
+                v.arrayDimensions = static_cast<UA_UInt32*>(UA_Array_new(d.size(), &UA_TYPES[UA_TYPES_UINT32]));
+                if (v.arrayDimensions) {
+                    memcpy(v.arrayDimensions, d.data(), d.size() * sizeof(UA_UInt32));
+                    v.arrayDimensionsSize = d.size();
+                }
+            }
+        }
+    }
+    else {
+        void* p = UA_new(t);
+        if (p) {
+            UA_Variant_setScalar(&v, p, t);
+            ret = value(t, p);
+        }
+    }
+    _first.swap(first);
+    _p = end;
+    if (!ret) {
+        UA_Variant_clear(&v);
+        return fail();
+    }
+    return true;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/largevalue.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace Open62541 {
+/*!
+    \brief The LargeValue::State struct
+    Shared between the transfer and the completions of its requests, so a completion arriving after a
+    transfer has timed out is harmless - it is ignored once cancelled is set
+*/
+struct LargeValue::State {
+    Client* client = nullptr;
+    NodeId node;  // the id on the wire - registered handles translated
+    const UA_DataType* type = nullptr;
+    bool bytes              = false;  // a scalar ByteString or String ranged by byte
+    size_t elementSize      = 1;
+    size_t chunk            = 1;  // elements per request
+    bool reading            = true;
+    UA_Byte* buffer         = nullptr;  // read into
+    const UA_Byte* source   = nullptr;  // written from
+    size_t capacity         = 0;        // elements in buffer or source
+    size_t offset           = 0;        // first element written
+    //
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t next      = 0;                                    // next chunk to send
+    size_t end       = std::numeric_limits<size_t>::max();  // chunks from here are past the value
+    size_t inFlight  = 0;
+    size_t completed = 0;
+    size_t length    = 0;  // elements read
+    bool cancelled   = false;
+    UA_StatusCode error = UA_STATUSCODE_GOOD;
+
+    bool sendable() const { return (next < end) && (!reading || ((next * chunk) <= capacity)); }
+    void fail(UA_StatusCode s)
+    {
+        if (error == UA_STATUSCODE_GOOD)
+            error = s;
+    }
+    void readDone(size_t k, UA_StatusCode s, const UA_DataValue* v);
+    void writeDone(UA_StatusCode s);
+};
+}  // namespace Open62541
+
+/*!
+    \brief Open62541::LargeValue::State::readDone
+    Copy a chunk into the buffer - a short or empty chunk marks the end of the value
+    \param k chunk index
+    \param s service status
+    \param v result - null if the service failed
+*/
+void Open62541::LargeValue::State::readDone(size_t k, UA_StatusCode s, const UA_DataValue* v)
+{
+    std::lock_guard<std::mutex> l(mutex);
+    inFlight--;
+    completed++;
+    if (!cancelled) {
+        if (v && v->hasStatus)
+            s = v->status;
+        if (s == UA_STATUSCODE_BADINDEXRANGENODATA) {
+            end = std::min(end, k);  // starts past the end
+        }
+        else if (s != UA_STATUSCODE_GOOD) {
+            fail(s);
+        }
+        else {
+            const UA_Variant& var = v->value;
+            const void* data      = nullptr;
+            size_t n              = 0;
+            if (v->hasValue && (var.type != type)) {
+                fail(UA_STATUSCODE_BADTYPEMISMATCH);
+            }
+            else if (v->hasValue && bytes) {
+                if (UA_Variant_isScalar(&var)) {
+                    const UA_ByteString* b = static_cast<const UA_ByteString*>(var.data);
+                    n                      = b->length;
+                    data                   = b->data;
+                }
+                else {
+                    fail(UA_STATUSCODE_BADTYPEMISMATCH);
+                }
+            }
+            else if (v->hasValue) {
+                if (!UA_Variant_isScalar(&var) && (var.arrayDimensionsSize <= 1)) {
+                    n    = var.arrayLength;
+                    data = var.data;
+                }
+                else {
+                    fail(UA_STATUSCODE_BADTYPEMISMATCH);
+                }
+            }
+            const size_t first = k * chunk;
+            if (error != UA_STATUSCODE_GOOD) {
+                // type mismatch - nothing to copy
+            }
+            else if (n > chunk) {
+                fail(UA_STATUSCODE_BADINDEXRANGEINVALID);  // the range was ignored
+            }
+            else if (n == 0) {
+                end = std::min(end, k);
+            }
+            else if ((first + n) > capacity) {
+                fail(UA_STATUSCODE_BADOUTOFRANGE);  // the buffer is too small
+            }
+            else {
+                memcpy(buffer + first * elementSize, data, n * elementSize);
+                length += n;
+                if (n < chunk)
+                    end = std::min(end, k + 1);
+            }
+        }
+    }
+    done.notify_all();
+}
+
+/*!
+    \brief Open62541::LargeValue::State::writeDone
+    \param s status of the chunk's write
+*/
+void Open62541::LargeValue::State::writeDone(UA_StatusCode s)
+{
+    std::lock_guard<std::mutex> l(mutex);
+    inFlight--;
+    completed++;
+    if (!cancelled && (s != UA_STATUSCODE_GOOD))
+        fail(s);
+    done.notify_all();
+}
+
+/*!
+    \brief Open62541::LargeValue::send
+    Send one chunk's request
+    \param st
+    \param k chunk index
+    \return true if sent
+*/
+bool Open62541::LargeValue::send(const std::shared_ptr<State>& st, size_t k)
+{
+    const size_t first = k * st->chunk;
+    const size_t n     = st->reading ? st->chunk : std::min(st->chunk, st->capacity - first);
+    const size_t from  = st->offset + first;
+    // shallow - encoded before sendAsync returns
+    std::string range = std::to_string(from);
+    if (n > 1)
+        range += ":" + std::to_string(from + n - 1);
+    UA_String r;
+    r.length = range.size();
+    r.data   = (UA_Byte*)range.data();
+    if (st->reading) {
+        UA_ReadValueId rvi;
+        UA_ReadValueId_init(&rvi);
+        rvi.nodeId      = *st->node.constRef();
+        rvi.attributeId = UA_ATTRIBUTEID_VALUE;
+        rvi.indexRange  = r;
+        UA_ReadRequest req;
+        UA_ReadRequest_init(&req);
+        req.nodesToRead        = &rvi;
+        req.nodesToReadSize    = 1;
+        req.timestampsToReturn = UA_TIMESTAMPSTORETURN_NEITHER;
+        return st->client->sendAsync(&req,
+                                     &UA_TYPES[UA_TYPES_READREQUEST],
+                                     &UA_TYPES[UA_TYPES_READRESPONSE],
+                                     [st, k](UA_StatusCode s, void* response) {
+                                         UA_ReadResponse* rr   = static_cast<UA_ReadResponse*>(response);
+                                         const UA_DataValue* v = nullptr;
+                                         if (s == UA_STATUSCODE_GOOD) {
+                                             if (rr && (rr->resultsSize == 1))
+                                                 v = &rr->results[0];
+                                             else
+                                                 s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+                                         }
+                                         st->readDone(k, s, v);
+                                     });
+    }
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    wv.nodeId         = *st->node.constRef();
+    wv.attributeId    = UA_ATTRIBUTEID_VALUE;
+    wv.indexRange     = r;
+    wv.value.hasValue = true;
+    UA_ByteString b;
+    void* data = (void*)(st->source + first * st->elementSize);
+    if (st->bytes) {
+        b.length = n;
+        b.data   = static_cast<UA_Byte*>(data);
+        UA_Variant_setScalar(&wv.value.value, &b, st->type);
+    }
+    else {
+        UA_Variant_setArray(&wv.value.value, data, n, st->type);
+    }
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    req.nodesToWrite     = &wv;
+    req.nodesToWriteSize = 1;
+    return st->client->sendAsync(&req,
+                                 &UA_TYPES[UA_TYPES_WRITEREQUEST],
+                                 &UA_TYPES[UA_TYPES_WRITERESPONSE],
+                                 [st](UA_StatusCode s, void* response) {
+                                     UA_WriteResponse* wr = static_cast<UA_WriteResponse*>(response);
+                                     if (s == UA_STATUSCODE_GOOD)
+                                         s = (wr && (wr->resultsSize == 1)) ? wr->results[0]
+                                                                            : UA_STATUSCODE_BADUNEXPECTEDERROR;
+                                     st->writeDone(s);
+                                 });
+}
+
+/*!
+    \brief Open62541::LargeValue::transfer
+    Keep up to inFlight chunks outstanding until the value is done or an error stops it
+    \param st
+    \return true on success
+*/
+bool Open62541::LargeValue::transfer(const std::shared_ptr<State>& st)
+{
+    State& s = *st;
+    std::unique_lock<std::mutex> l(s.mutex);
+    size_t completed = s.completed;
+    auto deadline    = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout);
+    for (;;) {
+        while ((s.error == UA_STATUSCODE_GOOD) && (s.inFlight < _inFlight) && s.sendable()) {
+            const size_t k = s.next++;
+            s.inFlight++;
+            _requests++;
+            l.unlock();
+            const bool ok = send(st, k);
+            l.lock();
+            if (!ok) {
+                s.inFlight--;
+                s.fail((_client.lastError() != UA_STATUSCODE_GOOD) ? _client.lastError()
+                                                                     : UA_STATUSCODE_BADCOMMUNICATIONERROR);
+            }
+        }
+        if ((s.inFlight == 0) || (s.error != UA_STATUSCODE_GOOD))
+            break;
+        if (_pump) {
+            l.unlock();
+            const bool ok = _client.runIterate(10);
+            l.lock();
+            if (!ok) {
+                s.fail((_client.lastError() != UA_STATUSCODE_GOOD) ? _client.lastError()
+                                                                     : UA_STATUSCODE_BADCONNECTIONCLOSED);
+                break;
+            }
+        }
+        else {
+            s.done.wait_for(l, std::chrono::milliseconds(10));
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (s.completed != completed) {
+            completed = s.completed;
+            deadline  = now + std::chrono::milliseconds(_timeout);
+        }
+        else if (now > deadline) {
+            s.fail(UA_STATUSCODE_BADTIMEOUT);
+            break;
+        }
+    }
+    s.cancelled = true;  // completions still in flight must not touch the buffer
+    _lastError  = s.error;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::LargeValue::LargeValue
+    \param client
+    \param chunkBytes
+    \param inFlight
+*/
+Open62541::LargeValue::LargeValue(Client& client, size_t chunkBytes, unsigned inFlight)
+    : _client(client)
+    , _chunkBytes(chunkBytes ? chunkBytes : 1)
+    , _inFlight(inFlight ? inFlight : 1)
+{
+}
+
+/*!
+    \brief Open62541::LargeValue::read
+    \param node
+    \param type
+    \param buffer
+    \param capacity
+    \param length
+    \return true on success
+*/
+bool Open62541::LargeValue::read(const NodeId& node,
+                                 const UA_DataType* type,
+                                 void* buffer,
+                                 size_t capacity,
+                                 size_t& length)
+{
+    length    = 0;
+    auto st   = std::make_shared<State>();
+    st->bytes = (type == &UA_TYPES[UA_TYPES_BYTESTRING]) || (type == &UA_TYPES[UA_TYPES_STRING]);
+    if (!type || (!st->bytes && !type->pointerFree) || (!buffer && capacity)) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    NodeId current;
+    st->client      = &_client;
+    st->node        = _client.translate(node, current) ? current : node;
+    st->type        = type;
+    st->elementSize = st->bytes ? 1 : type->memSize;
+    st->chunk       = std::max<size_t>(_chunkBytes / st->elementSize, 1);
+    st->reading     = true;
+    st->buffer      = static_cast<UA_Byte*>(buffer);
+    st->capacity    = capacity;
+    const bool ok   = transfer(st);
+    length          = st->length;
+    return ok;
+}
+
+/*!
+    \brief Open62541::LargeValue::write
+    \param node
+    \param type
+    \param data
+    \param length
+    \param offset
+    \return true on success
+*/
+bool Open62541::LargeValue::write(const NodeId& node,
+                                  const UA_DataType* type,
+                                  const void* data,
+                                  size_t length,
+                                  size_t offset)
+{
+    auto st   = std::make_shared<State>();
+    st->bytes = (type == &UA_TYPES[UA_TYPES_BYTESTRING]) || (type == &UA_TYPES[UA_TYPES_STRING]);
+    if (!type || (!st->bytes && !type->pointerFree) || (!data && length)) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    NodeId current;
+    st->client      = &_client;
+    st->node        = _client.translate(node, current) ? current : node;
+    st->type        = type;
+    st->elementSize = st->bytes ? 1 : type->memSize;
+    st->chunk       = std::max<size_t>(_chunkBytes / st->elementSize, 1);
+    st->reading     = false;
+    st->source      = static_cast<const UA_Byte*>(data);
+    st->capacity    = length;
+    st->offset      = offset;
+    st->end         = (length + st->chunk - 1) / st->chunk;
+    return transfer(st);
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/lockprofiler.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+
+namespace {
+/*!
+    \brief The Table struct
+    Site totals keyed by mutex and call site
+*/
+struct Table {
+    std::mutex mutex;
+    std::map<std::pair<const void*, const void*>, Open62541::LockProfiler::Site> sites;
+    std::unordered_map<const void*, std::string> names;
+};
+
+Table& table()
+{
+    static Table* t = new Table;  // never destroyed - locks may be released during static destruction
+    return *t;
+}
+
+std::atomic<unsigned> rate{64};
+
+/*!
+    \brief symbol
+    \param p code address
+    \return function name and offset where available
+*/
+std::string symbol(const void* p)
+{
+    std::ostringstream os;
+#if defined(__GLIBC__)
+    void* a  = const_cast<void*>(p);
+    char** s = backtrace_symbols(&a, 1);
+    if (s) {
+        os << s[0];
+        free(s);
+        return os.str();
+    }
+#endif
+    os << p;
+    return os.str();
+}
+}  // namespace
+
+/*!
+    \brief Open62541::LockProfiler::record
+    \param mutex
+    \param site
+    \param shared
+    \param contended
+    \param waitNs
+    \param holdNs
+*/
+void Open62541::LockProfiler::record(const void* mutex,
+                                     const void* site,
+                                     bool shared,
+                                     bool contended,
+                                     uint64_t waitNs,
+                                     uint64_t holdNs)
+{
+    Table& t = table();
+    std::lock_guard<std::mutex> l(t.mutex);
+    Site& s = t.sites[std::make_pair(mutex, site)];
+    s.mutex = mutex;
+    s.site  = site;
+    s.shared |= shared;
+    s.samples++;
+    if (contended)
+        s.contended++;
+    s.waitNs += waitNs;
+    s.maxWaitNs = std::max(s.maxWaitNs, waitNs);
+    s.holdNs += holdNs;
+    s.maxHoldNs = std::max(s.maxHoldNs, holdNs);
+}
+
+/*!
+    \brief Open62541::LockProfiler::sample
+    \return true every sampleRate() calls on a thread
+*/
+bool Open62541::LockProfiler::sample()
+{
+    static thread_local unsigned n = 0;
+    const unsigned r               = rate.load(std::memory_order_relaxed);
+    if (r == 0)
+        return false;
+    if (++n < r)
+        return false;
+    n = 0;
+    return true;
+}
+
+/*!
+    \brief Open62541::LockProfiler::setSampleRate
+    \param n
+*/
+void Open62541::LockProfiler::setSampleRate(unsigned n)
+{
+    rate = n;
+}
+
+/*!
+    \brief Open62541::LockProfiler::sampleRate
+    \return one in n uncontended acquisitions are recorded
+*/
+unsigned Open62541::LockProfiler::sampleRate()
+{
+    return rate;
+}
+
+/*!
+    \brief Open62541::LockProfiler::setName
+    \param mutex
+    \param name
+*/
+void Open62541::LockProfiler::setName(const void* mutex, const std::string& name)
+{
+    Table& t = table();
+    std::lock_guard<std::mutex> l(t.mutex);
+    t.names[mutex] = name;
+}
+
+/*!
+    \brief Open62541::LockProfiler::sites
+    \param out
+*/
+void Open62541::LockProfiler::sites(std::vector<Site>& out)
+{
+    out.clear();
+    Table& t = table();
+    std::lock_guard<std::mutex> l(t.mutex);
+    out.reserve(t.sites.size());
+    for (auto& i : t.sites) {
+        out.push_back(i.second);
+    }
+}
+
+/*!
+    \brief Open62541::LockProfiler::report
+    \param os
+    \param top
+*/
+void Open62541::LockProfiler::report(std::ostream& os, size_t top)
+{
+    std::vector<Site> v;
+    sites(v);
+    std::sort(v.begin(), v.end(), [](const Site& a, const Site& b) { return a.waitNs > b.waitNs; });
+    if (top && (v.size() > top))
+        v.resize(top);
+    std::unordered_map<const void*, std::string> names;
+    {
+        Table& t = table();
+        std::lock_guard<std::mutex> l(t.mutex);
+        names = t.names;
+    }
+    os << "Lock profile - uncontended acquisitions sampled 1 in " << sampleRate() << std::endl;
+    for (const Site& s : v) {
+        auto n = names.find(s.mutex);
+        os << (s.shared ? "R " : "W ");
+        if (n != names.end())
+            os << n->second;
+        else
+            os << s.mutex;
+        os << " at " << symbol(s.site) << std::endl;
+        os << "    samples " << s.samples << " contended " << s.contended << std::fixed << std::setprecision(1)
+           << " wait total " << s.waitNs / 1000.0 << " us max " << s.maxWaitNs / 1000.0 << " us";
+        if (!s.shared && s.samples)
+            os << " hold mean " << s.holdNs / 1000.0 / s.samples << " us max " << s.maxHoldNs / 1000.0 << " us";
+        os << std::endl;
+    }
+}
+
+/*!
+    \brief Open62541::LockProfiler::reset
+*/
+void Open62541::LockProfiler::reset()
+{
+    Table& t = table();
+    std::lock_guard<std::mutex> l(t.mutex);
+    t.sites.clear();
+}
+
+/*!
+    \brief Open62541::LockProfiler::pendingSite
+    \return
+*/
+const void*& Open62541::LockProfiler::pendingSite()
+{
+    static thread_local const void* p = nullptr;
+    return p;
+}
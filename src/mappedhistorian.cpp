@@ -0,0 +1,974 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/mappedhistorian.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+/*!
+    \brief Open62541::MappedHistoryBackend::MappedHistoryBackend
+    \param directory
+    \param segmentSize
+*/
+Open62541::MappedHistoryBackend::MappedHistoryBackend(const std::string& directory, size_t segmentSize)
+    : _directory(directory)
+    , _segmentSize(std::min<size_t>(std::max<size_t>(segmentSize, 4096), UINT32_MAX))
+{
+    initialise();
+    database().getHistoryData = nullptr;  // the default database then uses the low level interface
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::~MappedHistoryBackend
+*/
+Open62541::MappedHistoryBackend::~MappedHistoryBackend() { close(); }
+
+/*!
+    \brief Open62541::MappedHistoryBackend::segmentPath
+    \param id
+    \return file path of a segment
+*/
+std::string Open62541::MappedHistoryBackend::segmentPath(UA_UInt32 id) const
+{
+    char b[32];
+    snprintf(b, sizeof(b), "/history-%08u.seg", unsigned(id));
+    return _directory + b;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::openSegment
+    \param id
+    \param create make a new zero filled file
+    \param index scan an existing file into the time index - false when openAsync indexes it later
+    \return true on success
+*/
+bool Open62541::MappedHistoryBackend::openSegment(UA_UInt32 id, bool create, bool index)
+{
+    SegmentRef s(new Segment);
+    s->id   = id;
+    s->path = segmentPath(id);
+    if (create) {
+        std::ofstream f(s->path, std::ios::binary | std::ios::trunc);
+        f.seekp(std::streamoff(_segmentSize - 1));
+        f.put(0);
+        if (!f) {
+            _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+            return false;
+        }
+    }
+    else if (!std::ifstream(s->path)) {
+        return false;  // gone - not an error
+    }
+    try {
+        s->file   = boost::interprocess::file_mapping(s->path.c_str(), boost::interprocess::read_write);
+        s->region = boost::interprocess::mapped_region(s->file, boost::interprocess::read_write);
+    }
+    catch (...) {
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        return false;
+    }
+    if (!create && index) {
+        ScanCounts counts;
+        scan(*s, _index, counts);
+        s->used  = counts.used;
+        s->live  = counts.live;
+        s->first = counts.first;
+        s->last  = counts.last;
+    }
+    _segments[id] = std::move(s);
+    return true;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::scan
+    Index the records of a mapped segment - stops at the first incomplete record. The segment is only read
+    \param s
+    \param index added to
+    \param counts set to the extent, live records and time range found
+    \return false if loading was stopped part way
+*/
+bool Open62541::MappedHistoryBackend::scan(Segment& s, Index& index, ScanCounts& counts)
+{
+    size_t offset  = 0;
+    size_t records = 0;
+    counts         = ScanCounts();
+    while (offset + sizeof(RecordHeader) <= s.capacity()) {
+        if (!(++records & 0xFFF) && _stopLoading)
+            return false;
+        const RecordHeader* h = reinterpret_cast<const RecordHeader*>(s.data() + offset);
+        if ((h->magic != Magic) || (h->length < sizeof(RecordHeader)) || (offset + h->length > s.capacity()))
+            break;
+        if (!(h->flags & Deleted)) {
+            UA_ByteString b;
+            b.length = h->nodeLength;
+            b.data   = s.data() + offset + sizeof(RecordHeader);
+            size_t o = 0;
+            UA_NodeId n;
+            UA_NodeId_init(&n);
+            if (UA_decodeBinary(&b, &o, &n, &UA_TYPES[UA_TYPES_NODEID], nullptr) == UA_STATUSCODE_GOOD) {
+                TimeIndex* t = index.value(n);
+                if (!t)
+                    t = &index.put(n);
+                Entry e;
+                e.time    = h->time;
+                e.segment = s.id;
+                e.offset  = UA_UInt32(offset);
+                insert(*t, e);
+                if (!counts.live || (h->time < counts.first))
+                    counts.first = h->time;
+                if (!counts.live || (h->time > counts.last))
+                    counts.last = h->time;
+                counts.live++;
+            }
+            UA_NodeId_clear(&n);
+        }
+        offset += h->length;
+    }
+    counts.used = offset;
+    return true;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::writeManifest
+    The manifest records the range of segment ids so open() needs no directory listing. Written to a temporary
+    file and renamed over the old one, so a crash mid write leaves the previous manifest rather than a torn one
+*/
+void Open62541::MappedHistoryBackend::writeManifest()
+{
+    const std::string path = _directory + "/manifest";
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream f(temp, std::ios::trunc);
+        if (!_segments.empty()) {
+            f << _segments.begin()->first << " " << _segments.rbegin()->first << std::endl;
+        }
+        if (!f)
+            return;  // keep the old manifest
+    }
+    std::rename(temp.c_str(), path.c_str());
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::open
+    \return true on success
+*/
+bool Open62541::MappedHistoryBackend::open()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!_segments.empty())
+        return true;
+    _lastError = UA_STATUSCODE_GOOD;
+    UA_UInt32 first = 0;
+    UA_UInt32 last  = 0;
+    std::ifstream m(_directory + "/manifest");
+    if (m >> first >> last) {
+        for (UA_UInt32 id = first; id <= last; id++) {
+            openSegment(id, false);
+        }
+    }
+    if (_segments.empty() && !openSegment(last + 1, true))
+        return false;
+    writeManifest();
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::openAsync
+    \param threads
+    \return true if the segments mapped
+*/
+bool Open62541::MappedHistoryBackend::openAsync(unsigned threads)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!_segments.empty())
+        return true;
+    _lastError = UA_STATUSCODE_GOOD;
+    UA_UInt32 first = 0;
+    UA_UInt32 last  = 0;
+    std::vector<SegmentRef> existing;
+    std::ifstream m(_directory + "/manifest");
+    if (m >> first >> last) {
+        for (UA_UInt32 id = first; id <= last; id++) {
+            if (openSegment(id, false, false))
+                existing.push_back(_segments[id]);
+        }
+    }
+    // new values go to a segment of their own so the ones being indexed do not change
+    if (!openSegment(last + 1, true))
+        return false;
+    writeManifest();
+    if (existing.empty())
+        return lastOK();
+    if (threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    threads      = unsigned(std::min<size_t>(threads, existing.size()));
+    _pending     = existing.size();
+    _stopLoading = false;
+    std::vector<std::vector<SegmentRef>> work(threads);
+    for (size_t i = 0; i < existing.size(); i++) {
+        work[i % threads].push_back(existing[i]);
+    }
+    for (auto& w : work) {
+        _loaders.emplace_back(&MappedHistoryBackend::load, this, std::move(w));
+    }
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::load
+    Indexing thread - each segment is scanned into an index of its own without the lock, then merged. The
+    references keep the segments mapped whatever happens to them meanwhile
+    \param segments
+*/
+void Open62541::MappedHistoryBackend::load(std::vector<SegmentRef> segments)
+{
+    for (SegmentRef& s : segments) {
+        Index part;
+        ScanCounts counts;
+        if (!scan(*s, part, counts))
+            return;
+        std::lock_guard<std::mutex> l(_mutex);
+        if (_segments.count(s->id))
+            merge(*s, part, counts);  // not dropped while it was scanned
+        if (--_pending == 0) {
+            const size_t n = _segments.size();
+            retain();  // held back while loading
+            if (n != _segments.size())
+                writeManifest();
+        }
+        _loaded.notify_all();
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::merge
+    Add the entries of a loaded segment to the time index - called with the lock held. Where a value was
+    written at the same time since the server started the loaded record is the older one and is deleted
+    \param s the segment loaded
+    \param part its entries
+    \param counts what the scan found - published to the segment first, as deletes here count against them
+*/
+void Open62541::MappedHistoryBackend::merge(Segment& s, Index& part, const ScanCounts& counts)
+{
+    s.used  = counts.used;
+    s.live  = counts.live;
+    s.first = counts.first;
+    s.last  = counts.last;
+    for (auto& i : part) {
+        TimeIndex& loaded = i.second;
+        TimeIndex* t      = _index.value(i.first);
+        if (!t) {
+            _index.put(i.first).swap(loaded);
+            continue;
+        }
+        const size_t mid = t->size();
+        t->reserve(mid + loaded.size());
+        for (const Entry& e : loaded) {
+            auto j = std::lower_bound(t->begin(), t->begin() + mid, e.time, [](const Entry& x, UA_DateTime v) {
+                return x.time < v;
+            });
+            if ((j != t->begin() + mid) && (j->time == e.time))
+                markDeleted(e);
+            else
+                t->push_back(e);
+        }
+        // both runs are sorted by time
+        std::inplace_merge(t->begin(), t->begin() + mid, t->end(), [](const Entry& a, const Entry& b) {
+            return a.time < b.time;
+        });
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::waitLoaded
+    \param timeoutMs
+    \return true if loading completed
+*/
+bool Open62541::MappedHistoryBackend::waitLoaded(unsigned timeoutMs)
+{
+    std::unique_lock<std::mutex> l(_mutex);
+    auto done = [this]() { return _pending == 0; };
+    if (timeoutMs == 0) {
+        _loaded.wait(l, done);
+        return true;
+    }
+    return _loaded.wait_for(l, std::chrono::milliseconds(timeoutMs), done);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::stopLoading
+    Stop and join the indexing threads - without the lock, which they take
+*/
+void Open62541::MappedHistoryBackend::stopLoading()
+{
+    _stopLoading = true;
+    for (auto& t : _loaders) {
+        if (t.joinable())
+            t.join();
+    }
+    _loaders.clear();
+    _pending = 0;
+    _loaded.notify_all();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::reserve
+    \param nodes
+*/
+void Open62541::MappedHistoryBackend::reserve(size_t nodes)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _index.reserve(nodes);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::close
+*/
+void Open62541::MappedHistoryBackend::close()
+{
+    stopLoading();
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto& s : _segments) {
+        s.second->region.flush(0, s.second->used, false);
+    }
+    _segments.clear();
+    _index.clearAll();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::flush
+    \param async
+*/
+void Open62541::MappedHistoryBackend::flush(bool async)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    for (auto& s : _segments) {
+        s.second->region.flush(0, s.second->used, async);
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::isOpen
+    \return true if open
+*/
+bool Open62541::MappedHistoryBackend::isOpen()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return !_segments.empty();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::writable
+    \param length record length
+    \return segment with room for the record, rotating if needed
+*/
+Open62541::MappedHistoryBackend::Segment* Open62541::MappedHistoryBackend::writable(size_t length)
+{
+    if (_segments.empty()) {
+        _lastError = UA_STATUSCODE_BADINVALIDSTATE;
+        return nullptr;
+    }
+    if (length > _segmentSize) {
+        _lastError = UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        return nullptr;
+    }
+    Segment* s = _segments.rbegin()->second.get();
+    if (s->used + length <= s->capacity())
+        return s;
+    s->region.flush(0, s->used, true);  // full - rotate
+    if (!openSegment(s->id + 1, true))
+        return nullptr;
+    retain();
+    writeManifest();
+    return _segments.rbegin()->second.get();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::append
+    \param node
+    \param v
+    \param e set to the new record position
+    \return true on success
+*/
+bool Open62541::MappedHistoryBackend::append(const UA_NodeId& node, const UA_DataValue& v, Entry& e)
+{
+    UA_ByteString nb;
+    UA_ByteString vb;
+    UA_ByteString_init(&nb);
+    UA_ByteString_init(&vb);
+    bool ret = false;
+    if ((UA_encodeBinary(&node, &UA_TYPES[UA_TYPES_NODEID], &nb) == UA_STATUSCODE_GOOD) &&
+        (UA_encodeBinary(&v, &UA_TYPES[UA_TYPES_DATAVALUE], &vb) == UA_STATUSCODE_GOOD) && (nb.length <= 0xFFFF)) {
+        size_t length = (sizeof(RecordHeader) + nb.length + vb.length + 7) & ~size_t(7);
+        Segment* s    = writable(length);
+        if (s) {
+            UA_Byte* p = s->data() + s->used;
+            memcpy(p + sizeof(RecordHeader), nb.data, nb.length);
+            memcpy(p + sizeof(RecordHeader) + nb.length, vb.data, vb.length);
+            RecordHeader* h = reinterpret_cast<RecordHeader*>(p);
+            h->length       = UA_UInt32(length);
+            h->time         = historyKey(v);
+            h->flags        = 0;
+            h->nodeLength   = UA_UInt16(nb.length);
+            h->reserved     = 0;
+            h->valueLength  = UA_UInt32(vb.length);
+            h->reserved2    = 0;
+            h->magic        = Magic;  // complete
+            e.time          = h->time;
+            e.segment       = s->id;
+            e.offset        = UA_UInt32(s->used);
+            if (!s->live || (e.time < s->first))
+                s->first = e.time;
+            if (!s->live || (e.time > s->last))
+                s->last = e.time;
+            s->used += length;
+            s->live++;
+            ret = true;
+        }
+    }
+    else {
+        _lastError = UA_STATUSCODE_BADENCODINGERROR;
+    }
+    UA_ByteString_clear(&nb);
+    UA_ByteString_clear(&vb);
+    return ret;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::header
+    \param e
+    \return the mapped record header or nullptr
+*/
+const Open62541::MappedHistoryBackend::RecordHeader* Open62541::MappedHistoryBackend::header(const Entry& e)
+{
+    auto i = _segments.find(e.segment);
+    if (i == _segments.end())
+        return nullptr;
+    return reinterpret_cast<const RecordHeader*>(i->second->data() + e.offset);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::decode
+    Decode a value straight from its mapped page
+    \param e
+    \param v initialised data value
+    \return true on success
+*/
+bool Open62541::MappedHistoryBackend::decode(const Entry& e, UA_DataValue& v)
+{
+    const RecordHeader* h = header(e);
+    if (!h)
+        return false;
+    UA_ByteString b;
+    b.length = h->valueLength;
+    b.data   = const_cast<UA_Byte*>(reinterpret_cast<const UA_Byte*>(h) + sizeof(RecordHeader) + h->nodeLength);
+    size_t o = 0;
+    return UA_decodeBinary(&b, &o, &v, &UA_TYPES[UA_TYPES_DATAVALUE], nullptr) == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::markDeleted
+    \param e
+*/
+void Open62541::MappedHistoryBackend::markDeleted(const Entry& e)
+{
+    auto i = _segments.find(e.segment);
+    if (i != _segments.end()) {
+        RecordHeader* h = reinterpret_cast<RecordHeader*>(i->second->data() + e.offset);
+        if (!(h->flags & Deleted)) {
+            h->flags |= Deleted;
+            i->second->live--;
+        }
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::dropSegment
+    Unmap and delete a segment file and every index entry into it
+    \param id
+*/
+void Open62541::MappedHistoryBackend::dropSegment(UA_UInt32 id)
+{
+    auto i = _segments.find(id);
+    if (i == _segments.end())
+        return;
+    for (auto& n : _index) {
+        TimeIndex& t = n.second;
+        t.erase(std::remove_if(t.begin(), t.end(), [id](const Entry& e) { return e.segment == id; }), t.end());
+    }
+    std::string path = i->second->path;
+    _segments.erase(i);
+    boost::interprocess::file_mapping::remove(path.c_str());
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::retain
+    Drop segments beyond the limit or past the retention period - never the current segment
+*/
+void Open62541::MappedHistoryBackend::retain()
+{
+    if (_pending)
+        return;  // segments are being indexed
+    while (_maxSegments && (_segments.size() > _maxSegments)) {
+        dropSegment(_segments.begin()->first);
+    }
+    if (_retention > 0) {
+        UA_DateTime cutoff = UA_DateTime_now() - _retention;
+        while ((_segments.size() > 1) && (_segments.begin()->second->last < cutoff)) {
+            dropSegment(_segments.begin()->first);
+        }
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::applyRetention
+*/
+void Open62541::MappedHistoryBackend::applyRetention()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = _segments.size();
+    retain();
+    if (n != _segments.size())
+        writeManifest();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::find
+    \param t
+    \param time
+    \return the entry at time or end
+*/
+Open62541::MappedHistoryBackend::TimeIndex::iterator Open62541::MappedHistoryBackend::find(TimeIndex& t,
+                                                                                           UA_DateTime time)
+{
+    auto i = std::lower_bound(t.begin(), t.end(), time, [](const Entry& e, UA_DateTime v) { return e.time < v; });
+    return ((i != t.end()) && (i->time == time)) ? i : t.end();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::insert
+    \param t
+    \param e
+*/
+void Open62541::MappedHistoryBackend::insert(TimeIndex& t, const Entry& e)
+{
+    if (t.empty() || (e.time >= t.back().time)) {
+        t.push_back(e);  // the usual case
+    }
+    else {
+        auto i = std::upper_bound(t.begin(), t.end(), e.time, [](UA_DateTime v, const Entry& x) {
+            return v < x.time;
+        });
+        t.insert(i, e);
+    }
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::store
+    \param node
+    \param value
+    \param replace allow an existing value at the timestamp to be replaced
+    \param insert allow a new value
+    \return status
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::store(const NodeId& node,
+                                                     const UA_DataValue* value,
+                                                     bool replace,
+                                                     bool insert)
+{
+    if (!value)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_DateTime t = historyKey(*value);
+    TimeIndex* ti = timeIndex(node);
+    bool exists   = ti && (find(*ti, t) != ti->end());
+    if (exists && !replace)
+        return UA_STATUSCODE_BADENTRYEXISTS;
+    if (!exists && !insert)
+        return UA_STATUSCODE_BADNOENTRYEXISTS;
+    Entry e;
+    if (!append(*node.constRef(), *value, e))
+        return _lastError;
+    ti = timeIndex(node);  // a rotation may have dropped entries
+    if (!ti)
+        ti = &_index.put(*node.constRef());
+    auto i = find(*ti, t);
+    if (i != ti->end()) {
+        markDeleted(*i);
+        *i = e;
+    }
+    else {
+        this->insert(*ti, e);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::size
+    \param n
+    \return values
+*/
+size_t Open62541::MappedHistoryBackend::size(const NodeId& n)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(n);
+    return t ? t->size() : 0;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::segmentCount
+    \return segments
+*/
+size_t Open62541::MappedHistoryBackend::segmentCount()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _segments.size();
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::memoryUsage
+    \param r
+*/
+void Open62541::MappedHistoryBackend::memoryUsage(MemoryReport& r)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = 0;
+    for (auto& i : _index) {
+        const size_t b = MemoryReport::HashNode + sizeof(i) + MemoryReport::heapOf(i.second);
+        if (r.detail())
+            r.add("history", b, i.second.size(), toString(i.first));
+        n += b;
+    }
+    r.add("history", n, _index.size());
+    size_t mapped = 0;
+    for (auto& s : _segments) {
+        if (s.second)
+            mapped += s.second->capacity();
+    }
+    r.add("historyMapped", mapped, _segments.size());
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::serverSetHistoryData
+    \return status
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::serverSetHistoryData(Context& c,
+                                                                    bool /*historizing*/,
+                                                                    const UA_DataValue* value)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, value, true, true);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::getDateTimeMatch
+    \param c
+    \param timestamp
+    \param strategy
+    \return index or the end index if there is no match
+*/
+size_t Open62541::MappedHistoryBackend::getDateTimeMatch(Context& c,
+                                                          const UA_DateTime timestamp,
+                                                          const MatchStrategy strategy)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    if (!t || t->empty())
+        return 0;
+    return matchTime(t->size(), timestamp, strategy, [t](size_t i) { return (*t)[i].time; }, interpolation());
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::getEnd
+    \return index after the last value
+*/
+size_t Open62541::MappedHistoryBackend::getEnd(Context& c)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    return t ? t->size() : 0;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::lastIndex
+    \return index of the last value
+*/
+size_t Open62541::MappedHistoryBackend::lastIndex(Context& c)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    return (t && !t->empty()) ? t->size() - 1 : 0;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::firstIndex
+    \return 0
+*/
+size_t Open62541::MappedHistoryBackend::firstIndex(Context& /*c*/) { return 0; }
+
+/*!
+    \brief Open62541::MappedHistoryBackend::resultSize
+    \return number of values in the range including both ends
+*/
+size_t Open62541::MappedHistoryBackend::resultSize(Context& c, size_t startIndex, size_t endIndex)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    if (!t || (startIndex >= t->size()) || (endIndex >= t->size()))
+        return 0;
+    return (startIndex <= endIndex) ? endIndex - startIndex + 1 : startIndex - endIndex + 1;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::copyDataValues
+    Values are decoded straight from the mapped pages. The continuation point is the count already returned
+    \return status
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::copyDataValues(Context& c,
+                                                               size_t startIndex,
+                                                               size_t endIndex,
+                                                               UA_Boolean reverse,
+                                                               size_t valueSize,
+                                                               UA_NumericRange range,
+                                                               UA_Boolean /*releaseContinuationPoints*/,
+                                                               std::string& in,
+                                                               std::string& out,
+                                                               size_t* providedValues,
+                                                               UA_DataValue* values)
+{
+    size_t skip = 0;
+    if (!readContinuation(in, skip))
+        return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t   = timeIndex(c.nodeId);
+    size_t counter = 0;
+    if (t && !t->empty() && (reverse ? (startIndex >= endIndex) : (startIndex <= endIndex))) {
+        size_t total = reverse ? startIndex - endIndex + 1 : endIndex - startIndex + 1;
+        if (skip > total)
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        size_t index = reverse ? startIndex - skip : startIndex + skip;
+        for (size_t n = skip; (n < total) && (counter < valueSize) && (index < t->size()); n++) {
+            UA_DataValue& d = values[counter];
+            if (range.dimensionsSize > 0) {
+                UA_DataValue s;
+                UA_DataValue_init(&s);
+                if (decode((*t)[index], s)) {
+                    d          = s;  // take everything but the value
+                    d.hasValue = false;
+                    UA_Variant_init(&d.value);
+                    if (s.hasValue)
+                        d.hasValue = (UA_Variant_copyRange(&s.value, &d.value, range) == UA_STATUSCODE_GOOD);
+                }
+                UA_DataValue_clear(&s);
+            }
+            else {
+                decode((*t)[index], d);
+            }
+            counter++;
+            if (reverse) {
+                if (index == 0)
+                    break;
+                index--;
+            }
+            else {
+                index++;
+            }
+        }
+        if ((total - skip) > counter)
+            writeContinuation(out, skip + counter);
+    }
+    if (providedValues)
+        *providedValues = counter;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::getDataValue
+    The value stays valid until the next call
+    \param c
+    \param index
+    \return data value or nullptr
+*/
+const UA_DataValue* Open62541::MappedHistoryBackend::getDataValue(Context& c, size_t index)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    if (!t || (index >= t->size()))
+        return nullptr;
+    _current.clear();
+    return decode((*t)[index], *_current.ref()) ? _current.constRef() : nullptr;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::insertDataValue
+    \return BADENTRYEXISTS if there is already a value at the timestamp
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::insertDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    if (loading())
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, value, false, true);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::insertDataValues
+    The batch is sorted and appended as records, then merged into the node's time index in one pass
+    \return status of the call - each value's status is in results
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::insertDataValues(Context& c,
+                                                                const UA_DataValue* values,
+                                                                size_t n,
+                                                                UA_StatusCode* results)
+{
+    if (!values || !results)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if (loading()) {
+        std::fill(results, results + n, UA_STATUSCODE_BADRESOURCEUNAVAILABLE);
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    }
+    std::vector<size_t> order = historyOrder(values, n, results);
+    if (order.empty())
+        return UA_STATUSCODE_GOOD;
+    std::lock_guard<std::mutex> l(_mutex);
+    const UA_NodeId& node = *c.nodeId.constRef();
+    TimeIndex added;
+    added.reserve(order.size());
+    for (size_t i : order) {
+        TimeIndex* ti = timeIndex(c.nodeId);  // a rotation may have dropped entries
+        if (ti && (find(*ti, values[i].sourceTimestamp) != ti->end())) {
+            results[i] = UA_STATUSCODE_BADENTRYEXISTS;
+            continue;
+        }
+        Entry e;
+        if (append(node, values[i], e))
+            added.push_back(e);
+        else
+            results[i] = _lastError;
+    }
+    // entries of the batch in a segment dropped by a later rotation are gone
+    added.erase(std::remove_if(added.begin(),
+                               added.end(),
+                               [this](const Entry& e) { return _segments.find(e.segment) == _segments.end(); }),
+                added.end());
+    if (added.empty())
+        return UA_STATUSCODE_GOOD;
+    TimeIndex* ti = timeIndex(c.nodeId);
+    if (!ti)
+        ti = &_index.put(node);
+    if (ti->empty() || (added.front().time > ti->back().time)) {
+        ti->insert(ti->end(), added.begin(), added.end());
+    }
+    else {
+        TimeIndex merged;
+        merged.reserve(ti->size() + added.size());
+        std::merge(ti->begin(),
+                   ti->end(),
+                   added.begin(),
+                   added.end(),
+                   std::back_inserter(merged),
+                   [](const Entry& a, const Entry& b) { return a.time < b.time; });
+        ti->swap(merged);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::replaceDataValue
+    \return BADNOENTRYEXISTS if there is no value at the timestamp
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::replaceDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    if (loading())
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, value, true, false);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::updateDataValue
+    Insert or replace
+    \return status
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::updateDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    if (loading())
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, value, true, true);
+}
+
+/*!
+    \brief Open62541::MappedHistoryBackend::removeDataValue
+    Removes values from startTimestamp up to but not including endTimestamp, or at startTimestamp if they are equal.
+    Segments left with no live records are deleted
+    \return status
+*/
+UA_StatusCode Open62541::MappedHistoryBackend::removeDataValue(Context& c,
+                                                               UA_DateTime startTimestamp,
+                                                               UA_DateTime endTimestamp)
+{
+    if (startTimestamp > endTimestamp)
+        return UA_STATUSCODE_BADTIMESTAMPNOTSUPPORTED;
+    if (loading())
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    std::lock_guard<std::mutex> l(_mutex);
+    TimeIndex* t = timeIndex(c.nodeId);
+    if (!t)
+        return UA_STATUSCODE_GOOD;
+    auto b = std::lower_bound(t->begin(), t->end(), startTimestamp, [](const Entry& e, UA_DateTime v) {
+        return e.time < v;
+    });
+    auto e = (startTimestamp == endTimestamp)
+                 ? std::upper_bound(b, t->end(), startTimestamp, [](UA_DateTime v, const Entry& x) { return v < x.time; })
+                 : std::lower_bound(b, t->end(), endTimestamp, [](const Entry& x, UA_DateTime v) { return x.time < v; });
+    for (auto i = b; i != e; i++) {
+        markDeleted(*i);
+    }
+    t->erase(b, e);
+    if (_pending)
+        return UA_STATUSCODE_GOOD;  // segments being indexed count no live records yet
+    bool dropped = false;
+    for (auto i = _segments.begin(); (i != _segments.end()) && (i->first != _segments.rbegin()->first);) {
+        UA_UInt32 id = i->first;
+        bool empty   = (i->second->live == 0);
+        i++;
+        if (empty) {
+            dropSegment(id);
+            dropped = true;
+        }
+    }
+    if (dropped)
+        writeManifest();
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::MappedHistorian::MappedHistorian
+    \param directory
+    \param numberNodes
+    \param segmentSize
+*/
+Open62541::MappedHistorian::MappedHistorian(const std::string& directory, size_t numberNodes, size_t segmentSize)
+    : _store(directory, segmentSize)
+{
+    gathering() = UA_HistoryDataGathering_Default(numberNodes);
+    database()  = UA_HistoryDatabase_default(gathering());
+    backend()   = _store.database();
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/memoryreport.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+namespace {
+
+/*!
+    \brief The MemoryContext class
+    Data source of one published figure
+*/
+class MemoryContext : public Open62541::NodeContext
+{
+public:
+    enum Field { Bytes = 0, Objects, FieldCount };
+
+private:
+    Open62541::Server& _server;
+    std::string _subsystem;  // empty for the total
+    Field _field;
+
+public:
+    MemoryContext(Open62541::Server& s, const std::string& subsystem, Field f)
+        : NodeContext("Memory")
+        , _server(s)
+        , _subsystem(subsystem)
+        , _field(f)
+    {
+    }
+    bool hasReadDataView() const { return true; }
+    bool readDataView(Open62541::Server&, const UA_NodeId&, const UA_NumericRange*, UA_DataValue& value)
+    {
+        Open62541::MemoryReport r;
+        _server.memoryReport(r);
+        UA_UInt64 n = 0;
+        if (_subsystem.empty()) {
+            if (_field == Bytes) {
+                n = r.totalBytes();
+            }
+            else {
+                for (const auto& i : r.items())
+                    n += i.name.empty() ? i.objects : 0;
+            }
+        }
+        else {
+            n = (_field == Bytes) ? r.bytes(_subsystem) : r.objects(_subsystem);
+        }
+        value.hasValue = UA_Variant_setScalarCopy(&value.value, &n, &UA_TYPES[UA_TYPES_UINT64]) == UA_STATUSCODE_GOOD;
+        return value.hasValue;
+    }
+};
+
+const char* fieldNames[MemoryContext::FieldCount] = {"Bytes", "Objects"};
+}  // namespace
+
+/*!
+    \brief Open62541::MemoryReport::add
+    \param subsystem
+    \param bytes
+    \param objects
+    \param name
+*/
+void Open62541::MemoryReport::add(const std::string& subsystem, size_t bytes, size_t objects, const std::string& name)
+{
+    Item i;
+    i.subsystem = subsystem;
+    i.name      = name;
+    i.bytes     = bytes;
+    i.objects   = objects;
+    _items.push_back(std::move(i));
+}
+
+/*!
+    \brief Open62541::MemoryReport::bytes
+    \param subsystem
+    \return total bytes
+*/
+size_t Open62541::MemoryReport::bytes(const std::string& subsystem) const
+{
+    size_t n = 0;
+    for (const Item& i : _items) {
+        if (i.name.empty() && (i.subsystem == subsystem))
+            n += i.bytes;
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::MemoryReport::objects
+    \param subsystem
+    \return total objects
+*/
+size_t Open62541::MemoryReport::objects(const std::string& subsystem) const
+{
+    size_t n = 0;
+    for (const Item& i : _items) {
+        if (i.name.empty() && (i.subsystem == subsystem))
+            n += i.objects;
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::MemoryReport::totalBytes
+    \return bytes of all subsystems
+*/
+size_t Open62541::MemoryReport::totalBytes() const
+{
+    size_t n = 0;
+    for (const Item& i : _items) {
+        if (i.name.empty())
+            n += i.bytes;
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::MemoryReport::report
+    \param os
+*/
+void Open62541::MemoryReport::report(std::ostream& os) const
+{
+    std::vector<const Item*> v;
+    v.reserve(_items.size());
+    for (const Item& i : _items)
+        v.push_back(&i);
+    std::stable_sort(v.begin(), v.end(), [](const Item* a, const Item* b) {
+        if (a->name.empty() != b->name.empty())
+            return a->name.empty();  // totals first
+        return a->bytes > b->bytes;
+    });
+    os << "Memory " << totalBytes() << " bytes" << std::endl;
+    for (const Item* i : v) {
+        os << "  " << std::left << std::setw(16) << i->subsystem << std::setw(40) << i->name << std::right
+           << " bytes " << std::setw(12) << i->bytes << " objects " << std::setw(10) << i->objects << std::endl;
+    }
+}
+
+/*!
+    \brief Open62541::MemoryReport::heapOf
+    \param n
+    \return bytes of a string or byte string identifier
+*/
+size_t Open62541::MemoryReport::heapOf(const UA_NodeId& n)
+{
+    switch (n.identifierType) {
+        case UA_NODEIDTYPE_STRING:
+        case UA_NODEIDTYPE_BYTESTRING:
+            return n.identifier.string.length;
+        default:
+            return 0;
+    }
+}
+
+/*!
+    \brief Open62541::MemoryReport::heapOf
+    \param v
+    \return bytes of the data - members of non pointer free types are estimated by their encoded size
+*/
+size_t Open62541::MemoryReport::heapOf(const UA_Variant& v)
+{
+    if (!v.type || !v.data || (v.data == UA_EMPTY_ARRAY_SENTINEL))
+        return 0;
+    const size_t n = UA_Variant_isScalar(&v) ? 1 : v.arrayLength;
+    size_t b       = n * v.type->memSize + v.arrayDimensionsSize * sizeof(UA_UInt32);
+    if (!v.type->pointerFree) {
+        const char* p = static_cast<const char*>(v.data);
+        for (size_t i = 0; i < n; i++, p += v.type->memSize)
+            b += UA_calcSizeBinary(p, v.type);
+    }
+    return b;
+}
+
+/*!
+    \brief Open62541::MemoryReport::addNodes
+    \param server
+    \param parent
+    \param nameSpaceIndex
+    \return true on success
+*/
+bool Open62541::MemoryReport::addNodes(Server& server, const NodeId& parent, int nameSpaceIndex)
+{
+    static std::mutex m;
+    static std::vector<std::unique_ptr<MemoryContext>> contexts;  // live as long as the nodes
+    std::lock_guard<std::mutex> l(m);
+    //
+    MemoryReport r;
+    server.memoryReport(r);
+    std::vector<std::string> subsystems(1);  // the total first
+    for (const Item& i : r.items()) {
+        if (i.name.empty() && (std::find(subsystems.begin(), subsystems.end(), i.subsystem) == subsystems.end()))
+            subsystems.push_back(i.subsystem);
+    }
+    //
+    const NodeId root(nameSpaceIndex, "Memory");
+    if (!server.addFolder(parent, "Memory", root, NodeId::Null, nameSpaceIndex))
+        return false;
+    for (const std::string& s : subsystems) {
+        const std::string name = s.empty() ? std::string("Total") : s;
+        const NodeId folder(nameSpaceIndex, "Memory." + name);
+        if (!server.addFolder(root, name, folder, NodeId::Null, nameSpaceIndex))
+            return false;
+        for (int f = 0; f < MemoryContext::FieldCount; f++) {
+            NodeId n(nameSpaceIndex, "Memory." + name + "." + fieldNames[f]);
+            contexts.emplace_back(new MemoryContext(server, s, MemoryContext::Field(f)));
+            MemoryContext* c = contexts.back().get();
+            if (!server.addVariable(folder, fieldNames[f], Variant(UA_UInt64(0)), n, NodeId::Null, c, nameSpaceIndex))
+                return false;
+            if (!c->setAsDataSource(server, n))
+                return false;
+        }
+    }
+    return true;
+}
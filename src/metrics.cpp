@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/metrics.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <mutex>
+
+std::atomic<bool> Open62541::Metrics::_enabled{true};
+
+namespace {
+typedef Open62541::Metrics M;
+
+/*!
+    \brief The Shard struct
+    Counters of one thread - only that thread writes them, so a relaxed load and store is enough
+*/
+struct Shard {
+    std::atomic<UA_UInt64> count[M::ProbeCount]                = {};
+    std::atomic<UA_UInt64> totalNs[M::ProbeCount]              = {};
+    std::atomic<UA_UInt64> maxNs[M::ProbeCount]                = {};
+    std::atomic<UA_UInt64> buckets[M::ProbeCount][M::Buckets] = {};
+
+    void addTo(M::Probe p, M::Stats& s) const
+    {
+        s.count += count[p].load(std::memory_order_relaxed);
+        s.totalNs += totalNs[p].load(std::memory_order_relaxed);
+        s.maxNs = std::max(s.maxNs, maxNs[p].load(std::memory_order_relaxed));
+        for (int i = 0; i < M::Buckets; i++) {
+            s.buckets[i] += buckets[p][i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/*!
+    \brief The Registry struct
+    Live shards, the totals of threads that have exited and the baseline taken by reset
+*/
+struct Registry {
+    std::mutex mutex;
+    std::vector<Shard*> shards;
+    M::Stats retired[M::ProbeCount];
+    M::Stats baseline[M::ProbeCount];
+};
+
+Registry& registry()
+{
+    static Registry* r = new Registry;  // never destroyed - threads may exit after static destruction
+    return *r;
+}
+
+/*!
+    \brief The ShardHolder struct
+    Registers the shard of a thread on first use and folds it into the retired totals on thread exit
+*/
+struct ShardHolder {
+    Shard shard;
+    ShardHolder()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> l(r.mutex);
+        r.shards.push_back(&shard);
+    }
+    ~ShardHolder()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> l(r.mutex);
+        for (int p = 0; p < M::ProbeCount; p++) {
+            shard.addTo(M::Probe(p), r.retired[p]);
+        }
+        r.shards.erase(std::remove(r.shards.begin(), r.shards.end(), &shard), r.shards.end());
+    }
+};
+
+inline Shard& localShard()
+{
+    static thread_local ShardHolder h;
+    return h.shard;
+}
+
+inline void bump(std::atomic<UA_UInt64>& a, UA_UInt64 v)
+{
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+/*!
+    \brief The MetricsContext class
+    Data source of one published figure
+*/
+class MetricsContext : public Open62541::NodeContext
+{
+public:
+    enum Field { Count = 0, MeanUs, P99Us, MaxUs, FieldCount };
+
+private:
+    M::Probe _probe;
+    Field _field;
+
+public:
+    MetricsContext(M::Probe p, Field f)
+        : NodeContext("Metrics")
+        , _probe(p)
+        , _field(f)
+    {
+    }
+    bool hasReadDataView() const { return true; }
+    bool readDataView(Open62541::Server&, const UA_NodeId&, const UA_NumericRange*, UA_DataValue& value)
+    {
+        M::Stats s;
+        M::snapshot(_probe, s);
+        UA_StatusCode ret;
+        if (_field == Count) {
+            ret = UA_Variant_setScalarCopy(&value.value, &s.count, &UA_TYPES[UA_TYPES_UINT64]);
+        }
+        else {
+            UA_Double d = (_field == MeanUs) ? s.meanUs() : (_field == P99Us) ? s.percentileUs(0.99) : s.maxNs / 1000.0;
+            ret         = UA_Variant_setScalarCopy(&value.value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);
+        }
+        value.hasValue = (ret == UA_STATUSCODE_GOOD);
+        return value.hasValue;
+    }
+};
+
+const char* fieldNames[MetricsContext::FieldCount] = {"Count", "MeanUs", "P99Us", "MaxUs"};
+}  // namespace
+
+/*!
+    \brief Open62541::Metrics::Stats::percentileUs
+    \param p
+    \return upper bound of the bucket in us
+*/
+double Open62541::Metrics::Stats::percentileUs(double p) const
+{
+    if (!count)
+        return 0.0;
+    const UA_UInt64 target = std::max<UA_UInt64>(1, UA_UInt64(p * double(count) + 0.5));
+    UA_UInt64 n            = 0;
+    for (int i = 0; i < Buckets - 1; i++) {
+        n += buckets[i];
+        if (n >= target)
+            return double(UA_UInt64(1) << i);
+    }
+    return maxNs / 1000.0;
+}
+
+/*!
+    \brief Open62541::Metrics::record
+    \param p
+    \param ns
+*/
+void Open62541::Metrics::record(Probe p, UA_UInt64 ns)
+{
+    if ((p < 0) || (p >= ProbeCount))
+        return;
+    Shard& s = localShard();
+    int b    = 0;
+    for (UA_UInt64 us = ns / 1000; us && (b < Buckets - 1); us >>= 1) {
+        b++;
+    }
+    bump(s.count[p], 1);
+    bump(s.totalNs[p], ns);
+    bump(s.buckets[p][b], 1);
+    if (ns > s.maxNs[p].load(std::memory_order_relaxed))
+        s.maxNs[p].store(ns, std::memory_order_relaxed);
+}
+
+/*!
+    \brief Open62541::Metrics::snapshot
+    \param p
+    \param s
+*/
+void Open62541::Metrics::snapshot(Probe p, Stats& s)
+{
+    s = Stats();
+    if ((p < 0) || (p >= ProbeCount))
+        return;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> l(r.mutex);
+    Stats t = r.retired[p];
+    for (Shard* h : r.shards) {
+        h->addTo(p, t);
+    }
+    const Stats& b = r.baseline[p];
+    s.count        = t.count - b.count;
+    s.totalNs      = t.totalNs - b.totalNs;
+    s.maxNs        = t.maxNs;
+    for (int i = 0; i < Buckets; i++) {
+        s.buckets[i] = t.buckets[i] - b.buckets[i];
+    }
+}
+
+/*!
+    \brief Open62541::Metrics::reset
+    Counts are rebased rather than cleared so no thread's counters are written by another. Maxima are cleared
+*/
+void Open62541::Metrics::reset()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> l(r.mutex);
+    for (int p = 0; p < ProbeCount; p++) {
+        Stats t = r.retired[p];
+        r.retired[p].maxNs = 0;
+        for (Shard* h : r.shards) {
+            h->addTo(Probe(p), t);
+            h->maxNs[p].store(0, std::memory_order_relaxed);
+        }
+        t.maxNs       = 0;
+        r.baseline[p] = t;
+    }
+}
+
+/*!
+    \brief Open62541::Metrics::name
+    \param p
+    \return name of the probe
+*/
+const char* Open62541::Metrics::name(Probe p)
+{
+    static const char* n[ProbeCount] = {"DataSourceRead",
+                                        "DataSourceWrite",
+                                        "MethodCall",
+                                        "Notification",
+                                        "Browse",
+                                        "LockWait",
+                                        "TimerCallback",
+                                        "ChannelRenewal"};
+    return ((p >= 0) && (p < ProbeCount)) ? n[p] : "";
+}
+
+/*!
+    \brief Open62541::Metrics::addNodes
+    \param server
+    \param parent
+    \param nameSpaceIndex
+    \return true on success
+*/
+bool Open62541::Metrics::addNodes(Server& server, const NodeId& parent, int nameSpaceIndex)
+{
+    static std::mutex m;
+    static std::vector<std::unique_ptr<MetricsContext>> contexts;  // one per figure - shared by every server
+    std::lock_guard<std::mutex> l(m);
+    if (contexts.empty()) {
+        for (int p = 0; p < ProbeCount; p++) {
+            for (int f = 0; f < MetricsContext::FieldCount; f++) {
+                contexts.emplace_back(new MetricsContext(Probe(p), MetricsContext::Field(f)));
+            }
+        }
+    }
+    //
+    const NodeId root(nameSpaceIndex, "Metrics");
+    if (!server.addFolder(parent, "Metrics", root, NodeId::Null, nameSpaceIndex))
+        return false;
+    for (int p = 0; p < ProbeCount; p++) {
+        const std::string probe = name(Probe(p));
+        const NodeId folder(nameSpaceIndex, "Metrics." + probe);
+        if (!server.addFolder(root, probe, folder, NodeId::Null, nameSpaceIndex))
+            return false;
+        for (int f = 0; f < MetricsContext::FieldCount; f++) {
+            NodeId n(nameSpaceIndex, "Metrics." + probe + "." + fieldNames[f]);
+            MetricsContext* c = contexts[p * MetricsContext::FieldCount + f].get();
+            Variant v = (f == MetricsContext::Count) ? Variant(UA_UInt64(0)) : Variant(0.0);
+            if (!server.addVariable(folder, fieldNames[f], v, n, NodeId::Null, c, nameSpaceIndex))
+                return false;
+            if (!c->setAsDataSource(server, n))
+                return false;
+        }
+    }
+    return true;
+}
@@ -62,22 +62,41 @@ void Open62541::MonitoredItem::deleteMonitoredItemCallback(UA_Client* client,
     \param monContext
     \param value
 */
-void Open62541::MonitoredItem::dataChangeNotificationCallback(UA_Client* client,
-                                                              UA_UInt32 subId,
+void Open62541::MonitoredItem::dataChangeNotificationCallback(UA_Client* /*client*/,
+                                                              UA_UInt32 /*subId*/,
                                                               void* /*subContext*/,
                                                               UA_UInt32 /*monId*/,
                                                               void* monContext,
                                                               UA_DataValue* value)
 {
-    Client* cl = (Client*)UA_Client_getContext(client);
-    if (cl && (cl->getConnectStatus() == UA_STATUSCODE_GOOD)) {
-        ClientSubscription* c = cl->subscription(subId);
-        if (c) {
-            Open62541::MonitoredItem* m = (Open62541::MonitoredItem*)(monContext);
-            if (m) {
-                m->dataChangeNotification(value);
+    // the item is its own context and holds its subscription - items are removed from the client before
+    // they are destroyed so no lookup is needed on this path
+    Open62541::MonitoredItem* m = static_cast<Open62541::MonitoredItem*>(monContext);
+    if (m && value && !m->retired()) {
+        Metrics::Scope timing(Metrics::Notification);
+        ClientSubscription& s = m->subscription();
+        if (TrafficRecorder* r = s.client().recorder())
+            r->dataChange(*m->_nodeId.constRef(), *value);  // as received - before any client side filter
+        if (s.adaptive())
+            s.observe(m, value);
+        if (m->_removeFilter && m->_changeFilter) {
+            m->_changeFilter.reset();  // retired on this thread - a held value is older than this one
+            m->_removeFilter = false;
+        }
+        if (m->_changeFilter) {
+            const bool held = m->_changeFilter->holding();
+            if (!m->_changeFilter->pass(*value)) {
+                if (!held && m->_changeFilter->holding())
+                    s.queueHeld(m);  // released by the flush once the interval has passed
+                return;              // the stack clears the value
             }
         }
+        if (s.batching()) {
+            s.queueNotification(m, value);
+        }
+        else {
+            m->dataChangeNotification(value);
+        }
     }
 }
 
@@ -92,24 +111,49 @@ void Open62541::MonitoredItem::dataChangeNotificationCallback(UA_Client* client,
     \param nEventFields
     \param eventFields
 */
-void Open62541::MonitoredItem::eventNotificationCallback(UA_Client* client,
-                                                         UA_UInt32 subId,
+void Open62541::MonitoredItem::eventNotificationCallback(UA_Client* /*client*/,
+                                                         UA_UInt32 /*subId*/,
                                                          void* /*subContext*/,
                                                          UA_UInt32 /*monId*/,
                                                          void* monContext,
                                                          size_t nEventFields,
                                                          UA_Variant* eventFields)
 {
-    Client* cl = (Client*)UA_Client_getContext(client);
-    if (cl && (cl->getConnectStatus() == UA_STATUSCODE_GOOD)) {
-        ClientSubscription* c = cl->subscription(subId);
-        if (c) {
-            Open62541::MonitoredItem* m = (Open62541::MonitoredItem*)(monContext);
-            if (m) {
-                m->eventNotification(nEventFields, eventFields);
-            }
+    Open62541::MonitoredItem* m = static_cast<Open62541::MonitoredItem*>(monContext);
+    if (m && !m->retired()) {
+        Metrics::Scope timing(Metrics::Notification);
+        m->eventNotification(nEventFields, eventFields);
+    }
+}
+
+/*!
+    \brief Open62541::MonitoredItem::releaseHeld
+    \param now
+    \return true if nothing is held any longer
+*/
+bool Open62541::MonitoredItem::releaseHeld(UA_DateTime now)
+{
+    if (!_changeFilter)
+        return true;
+    const bool removing = _removeFilter;
+    UA_DataValue v;
+    UA_DataValue_init(&v);
+    const bool released = _changeFilter->release(now, v, removing);
+    if (removing) {
+        _changeFilter.reset();
+        _removeFilter = false;
+    }
+    if (released) {
+        Metrics::Scope timing(Metrics::Notification);
+        if (_sub.batching()) {
+            _sub.queueNotification(this, &v);
+        }
+        else {
+            dataChangeNotification(&v);
         }
+        UA_DataValue_clear(&v);
     }
+    return !_changeFilter || !_changeFilter->holding();
 }
 
 /*!
@@ -158,8 +202,13 @@ bool Open62541::MonitoredItem::setTriggering(const SetTriggeringRequest& request
 */
 bool Open62541::MonitoredItemDataChange::addDataChange(NodeId& n, UA_TimestampsToReturn ts)
 {
+    if (&n != &_nodeId)
+        _nodeId = n;
+    _ts = ts;
     MonitoredItemCreateRequest monRequest;
-    monRequest      = UA_MonitoredItemCreateRequest_default(n);
+    monRequest = UA_MonitoredItemCreateRequest_default(n);
+    monRequest.get().requestedParameters.samplingInterval = _samplingInterval;
+    monRequest.get().requestedParameters.queueSize        = _queueSize;
     _response.get() = UA_Client_MonitoredItems_createDataChange(subscription().client().client(),
                                                                 subscription().id(),
                                                                 ts,
@@ -167,7 +216,21 @@ bool Open62541::MonitoredItemDataChange::addDataChange(NodeId& n, UA_TimestampsT
                                                                 this,
                                                                 dataChangeNotificationCallback,
                                                                 deleteMonitoredItemCallback);
-    return _response.get().statusCode == UA_STATUSCODE_GOOD;
+    if (_response.get().statusCode == UA_STATUSCODE_GOOD) {
+        attachCache();
+        return true;
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::MonitoredItemDataChange::attachCache
+*/
+void Open62541::MonitoredItemDataChange::attachCache()
+{
+    SubscriptionValueCache* c = subscription().client().valueCache();
+    if (c && !_cacheEntry)
+        _cacheEntry = c->attach(_nodeId);
 }
 
 /*!
@@ -179,6 +242,9 @@ bool Open62541::MonitoredItemDataChange::addDataChange(NodeId& n, UA_TimestampsT
 bool Open62541::MonitoredItemEvent::addEvent(NodeId& n, UA_TimestampsToReturn ts)
 {
     remove();  // delete any existing item
+    if (&n != &_nodeId)
+        _nodeId = n;
+    _ts = ts;
 
     _response = UA_Client_MonitoredItems_createEvent(subscription().client().client(),
                                                      subscription().id(),
@@ -11,9 +11,102 @@
  */
 #include <open62541cpp/nodecontext.h>
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/arena.h>
+#include <open62541cpp/metrics.h>
 
 // set of contexts
-Open62541::RegisteredNodeContext::NodeContextMap Open62541::RegisteredNodeContext::_map;
+std::atomic<Open62541::NodeContextRegistry::Slot*>
+    Open62541::NodeContextRegistry::_chunks[Open62541::NodeContextRegistry::MaxChunks];
+std::mutex Open62541::NodeContextRegistry::_mutex;
+Open62541::NodeContextRegistry::Handle Open62541::NodeContextRegistry::_next = 1;  // 0 is invalid
+
+std::vector<Open62541::NodeContextRegistry::Handle>& Open62541::NodeContextRegistry::freeList()
+{
+    static std::vector<Handle> l;
+    return l;
+}
+
+Open62541::ReadWriteMutex& Open62541::NodeContextRegistry::nameMutex()
+{
+    static ReadWriteMutex m;
+    return m;
+}
+
+std::unordered_map<std::string, Open62541::NodeContextRegistry::Handle>& Open62541::NodeContextRegistry::names()
+{
+    static std::unordered_map<std::string, Handle> m;
+    return m;
+}
+
+/*!
+    \brief Open62541::NodeContextRegistry::add
+    \param c
+    \param name
+    \return handle
+*/
+Open62541::NodeContextRegistry::Handle Open62541::NodeContextRegistry::add(NodeContext* c, const std::string& name)
+{
+    Handle h = InvalidHandle;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (!freeList().empty()) {
+            h = freeList().back();
+            freeList().pop_back();
+        }
+        else {
+            if ((_next >> ChunkBits) >= MaxChunks)
+                return InvalidHandle;  // full
+            h = _next++;
+        }
+        Slot* chunk = _chunks[h >> ChunkBits].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new Slot[ChunkSize];  // chunks live for the life of the process
+            for (size_t i = 0; i < ChunkSize; i++) {
+                chunk[i].store(nullptr, std::memory_order_relaxed);
+            }
+            _chunks[h >> ChunkBits].store(chunk, std::memory_order_release);
+        }
+        chunk[h & (ChunkSize - 1)].store(c, std::memory_order_release);
+    }
+    if (!name.empty()) {
+        WriteLock l(nameMutex());
+        names()[name] = h;
+    }
+    return h;
+}
+
+/*!
+    \brief Open62541::NodeContextRegistry::remove
+    \param h
+*/
+void Open62541::NodeContextRegistry::remove(Handle h, const std::string& name)
+{
+    if (!find(h))
+        return;
+    if (!name.empty()) {
+        WriteLock l(nameMutex());
+        auto i = names().find(name);
+        if ((i != names().end()) && (i->second == h)) {
+            names().erase(i);
+        }
+    }
+    std::lock_guard<std::mutex> l(_mutex);
+    _chunks[h >> ChunkBits].load(std::memory_order_relaxed)[h & (ChunkSize - 1)].store(nullptr,
+                                                                                        std::memory_order_release);
+    freeList().push_back(h);
+}
+
+/*!
+    \brief Open62541::NodeContextRegistry::handle
+    \param name
+    \return handle or InvalidHandle
+*/
+Open62541::NodeContextRegistry::Handle Open62541::NodeContextRegistry::handle(const std::string& name)
+{
+    ReadLock l(nameMutex());
+    auto i = names().find(name);
+    return (i != names().end()) ? i->second : InvalidHandle;
+}
 
 // prepared objects
 UA_DataSource Open62541::NodeContext::_dataSource = {Open62541::NodeContext::readDataSource,
@@ -25,11 +118,6 @@ UA_ValueCallback Open62541::NodeContext::_valueCallback = {Open62541::NodeContex
 UA_NodeTypeLifecycle Open62541::NodeContext::_nodeTypeLifeCycle = {Open62541::NodeContext::typeConstructor,
                                                                    Open62541::NodeContext::typeDestructor};
 
-//
-// Default Datavalue
-//
-static Open62541::Variant defaultValue("Undefined");
-
 /*!
  * \brief Open62541::NodeContext::typeConstructor
  * \param server
@@ -93,7 +181,7 @@ void Open62541::NodeContext::typeDestructor(UA_Server* server,
         if (p) {
             //
             Server* s = Server::findServer(server);
-            if (s) {
+            if (s && !s->deferTypeDestructor(*nodeId, *typeNodeId, p)) {
                 NodeId n;
                 n = *nodeId;
                 NodeId t;
@@ -113,6 +201,7 @@ void Open62541::NodeContext::typeDestructor(UA_Server* server,
  */
 bool Open62541::NodeContext::setTypeLifeCycle(Server& server, NodeId& n)
 {
+    StartupTrace::Scope trace(server.startupTrace(), "setTypeLifeCycle");
     _lastError = UA_Server_setNodeTypeLifecycle(server.server(), n, _nodeTypeLifeCycle);
     return lastOK();
 }
@@ -156,22 +245,337 @@ UA_StatusCode Open62541::NodeContext::readDataSource(UA_Server* server,
         NodeContext* p = (NodeContext*)(nodeContext);  // require node contexts to be NULL or NodeContext objects
         Server* s      = Server::findServer(server);
         if (s && p && nodeId && value) {
-            NodeId n;
-            n = *nodeId;
-            if (!p->readData(*s, n, range, *value)) {
-                ret = UA_STATUSCODE_BADDATAUNAVAILABLE;
+            Metrics::Scope timing(Metrics::DataSourceRead);
+            bool ok;
+            if (!range && p->_readCacheSize.load(std::memory_order_relaxed)) {
+                ok = p->readCached(*s, *nodeId, *value);  // stamped when read from the backend
+                if (ok && !includeSourceTimeStamp) {
+                    value->hasSourceTimestamp = false;
+                }
             }
             else {
-                if (includeSourceTimeStamp) {
-                    value->hasServerTimestamp = true;
+                ok = p->readSource(*s, *nodeId, range, *value);
+                if (ok && includeSourceTimeStamp) {
+                    value->hasSourceTimestamp = true;
                     value->sourceTimestamp    = UA_DateTime_now();
                 }
             }
+            if (!ok) {
+                ret = UA_STATUSCODE_BADDATAUNAVAILABLE;
+            }
         }
     }
     return ret;
 }
 
+/*!
+    \brief Open62541::NodeContext::readSource
+    \param server
+    \param node
+    \param range
+    \param value
+    \return true on success
+*/
+bool Open62541::NodeContext::readSource(Server& server,
+                                        const UA_NodeId& node,
+                                        const UA_NumericRange* range,
+                                        UA_DataValue& value)
+{
+    ScopedArena arena;  // temporaries made by the handler are released on return
+    if (hasReadDataView()) {
+        return readDataView(server, node, range, value);  // no node id copy
+    }
+    NodeId n;
+    n = node;
+    return readData(server, n, range, value);
+}
+
+/*!
+    \brief Open62541::NodeContext::readCached
+    \param server
+    \param node
+    \param value
+    \return true on success
+*/
+bool Open62541::NodeContext::readCached(Server& server, const UA_NodeId& node, UA_DataValue& value)
+{
+    std::unique_lock<std::mutex> l(_readCacheMutex);
+    CachedRead* c = _readCache.value(node);
+    if (!c) {
+        l.unlock();
+        bool ok = readSource(server, node, nullptr, value);
+        if (ok) {
+            value.hasSourceTimestamp = true;
+            value.sourceTimestamp    = UA_DateTime_now();
+        }
+        return ok;
+    }
+    const size_t seen = c->generation;
+    for (;;) {
+        // fresh, or completed by the read we waited for
+        if (c->valid &&
+            ((c->generation != seen) || ((UA_DateTime_nowMonotonic() - c->when) <= c->maxAge))) {
+            _cacheHits++;
+            return UA_DataValue_copy(c->value.constRef(), &value) == UA_STATUSCODE_GOOD;
+        }
+        if (!c->loading)
+            break;
+        _readCacheCond.wait(l);
+        c = _readCache.value(node);
+        if (!c)
+            return false;  // uncached while waiting
+    }
+    c->loading         = true;
+    const size_t epoch = c->epoch;
+    _cacheMisses++;
+    l.unlock();
+    //
+    UA_DataValue v;
+    UA_DataValue_init(&v);
+    bool ok = readSource(server, node, nullptr, v);
+    if (ok) {
+        v.hasSourceTimestamp = true;
+        v.sourceTimestamp    = UA_DateTime_now();
+    }
+    //
+    l.lock();
+    c = _readCache.value(node);
+    if (c) {
+        c->loading = false;
+        c->valid   = ok && (c->epoch == epoch);  // a write meanwhile may have changed what was read
+        if (c->valid) {
+            c->value = v;
+            c->when  = UA_DateTime_nowMonotonic();
+            c->generation++;
+        }
+    }
+    l.unlock();
+    _readCacheCond.notify_all();
+    if (ok)
+        value = v;  // hand over
+    else
+        UA_DataValue_clear(&v);
+    return ok;
+}
+
+/*!
+    \brief Open62541::NodeContext::cacheReads
+    \param server
+    \param node
+    \return
+*/
+bool Open62541::NodeContext::cacheReads(Server& server, const NodeId& node)
+{
+    UA_Double ms = 0.0;
+    const bool ok = server.readMinimumSamplingInterval(node, ms);
+    setCacheAge(node, (ok && (ms > 0.0)) ? ms : 0.0);
+    return ok;
+}
+
+/*!
+    \brief Open62541::NodeContext::setCacheAge
+    \param node
+    \param ms
+*/
+void Open62541::NodeContext::setCacheAge(const NodeId& node, double ms)
+{
+    std::lock_guard<std::mutex> l(_readCacheMutex);
+    CachedRead* c = _readCache.value(node.get());
+    if (!c)
+        c = &_readCache.put(node.get());
+    c->maxAge      = UA_DateTime(ms * UA_DATETIME_MSEC);
+    _readCacheSize = _readCache.size();
+}
+
+/*!
+    \brief Open62541::NodeContext::uncacheReads
+    \param node
+*/
+void Open62541::NodeContext::uncacheReads(const NodeId& node)
+{
+    {
+        std::lock_guard<std::mutex> l(_readCacheMutex);
+        _readCache.remove(node.get());
+        _readCacheSize = _readCache.size();
+    }
+    _readCacheCond.notify_all();
+}
+
+/*!
+    \brief Open62541::NodeContext::invalidateRead
+    \param node
+*/
+void Open62541::NodeContext::invalidateRead(const UA_NodeId& node)
+{
+    if (!_readCacheSize.load(std::memory_order_relaxed))
+        return;
+    std::lock_guard<std::mutex> l(_readCacheMutex);
+    CachedRead* c = _readCache.value(node);
+    if (c) {
+        c->valid = false;
+        c->epoch++;
+    }
+}
+
+/*!
+ * \brief Open62541::NodeContext::~NodeContext
+ */
+Open62541::NodeContext::~NodeContext()
+{
+    // the last resort - a derived context using coalescing has called stopCoalescing while still whole
+    Server* s = nullptr;
+    {
+        std::lock_guard<std::mutex> l(_pendingMutex);
+        s               = _coalesceServer;
+        _coalesceServer = nullptr;
+    }
+    if (s) {
+        s->removeCoalescingContext(this);  // waits for a flush in progress
+    }
+}
+
+/*!
+ * \brief Open62541::NodeContext::stopCoalescing
+ */
+void Open62541::NodeContext::stopCoalescing()
+{
+    Server* s = nullptr;
+    {
+        std::lock_guard<std::mutex> l(_pendingMutex);
+        _coalesceWindow = 0;  // later writes are delivered at once
+        s               = _coalesceServer;
+        _coalesceServer = nullptr;
+    }
+    if (s) {
+        s->removeCoalescingContext(this);  // waits for a flush in progress
+        flushWrites(*s, true);             // the writes the clients saw succeed
+    }
+}
+
+/*!
+ * \brief Open62541::NodeContext::coalesceWrite
+ * \param server
+ * \param node
+ * \param value
+ * \param dataSource
+ * \return true if the write was merged and will be delivered later
+ */
+bool Open62541::NodeContext::coalesceWrite(Server& server,
+                                           const UA_NodeId& node,
+                                           const UA_DataValue& value,
+                                           bool dataSource)
+{
+    if (_coalesceWindow <= 0)
+        return false;
+    {
+        std::lock_guard<std::mutex> l(_pendingMutex);
+        PendingWrite* w = _pending.value(node);
+        if (w) {
+            w->value      = value;  // last value wins - storage is reused
+            w->dataSource = dataSource;
+        }
+        else {
+            PendingWrite& n = _pending.put(node);
+            n.value         = value;
+            n.first         = UA_DateTime_nowMonotonic();
+            n.dataSource    = dataSource;
+        }
+        if (_coalesceServer == &server)
+            return true;
+        _coalesceServer = &server;
+    }
+    server.addCoalescingContext(this);
+    return true;
+}
+
+/*!
+ * \brief Open62541::NodeContext::flushWrites
+ * \param server
+ * \param force
+ * \return number delivered
+ */
+size_t Open62541::NodeContext::flushWrites(Server& server, bool force)
+{
+    std::vector<std::pair<NodeId, PendingWrite>> due;
+    {
+        std::lock_guard<std::mutex> l(_pendingMutex);
+        if (_pending.empty())
+            return 0;
+        UA_DateTime now = UA_DateTime_nowMonotonic();
+        for (auto& i : _pending) {
+            if (force || (_coalesceWindow <= 0) || ((now - i.second.first) >= _coalesceWindow)) {
+                NodeId n;
+                n = i.first;
+                due.emplace_back(std::move(n), std::move(i.second));
+            }
+        }
+        for (auto& d : due) {
+            _pending.remove(d.first);
+        }
+    }
+    // deliver outside the lock - handlers may write again
+    for (auto& d : due) {
+        if (d.second.dataSource) {
+            writeData(server, d.first, nullptr, d.second.value);
+            invalidateRead(d.first);
+        }
+        else {
+            writeValue(server, d.first, nullptr, d.second.value);
+        }
+    }
+    return due.size();
+}
+
+/*!
+ * \brief Open62541::NodeContext::publishScalar
+ * \param value
+ * \param p
+ * \param type
+ * \return error code
+ */
+UA_StatusCode Open62541::NodeContext::publishScalar(UA_DataValue& value, void* p, const UA_DataType* type)
+{
+    if (!p || !type)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_Variant_setScalar(&value.value, p, type);
+    value.value.storageType = UA_VARIANT_DATA_NODELETE;  // caller keeps ownership
+    value.hasValue          = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+ * \brief Open62541::NodeContext::publishArray
+ * \param value
+ * \param p
+ * \param n
+ * \param type
+ * \param range
+ * \return error code
+ */
+UA_StatusCode Open62541::NodeContext::publishArray(UA_DataValue& value,
+                                                   void* p,
+                                                   size_t n,
+                                                   const UA_DataType* type,
+                                                   const UA_NumericRange* range)
+{
+    if (!type || (!p && (n > 0)))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_Variant v;
+    UA_Variant_setArray(&v, p, n, type);
+    v.storageType = UA_VARIANT_DATA_NODELETE;
+    if (range && (range->dimensionsSize > 0)) {
+        // only the selected part is returned - copy it so the data value owns it
+        UA_StatusCode ret = UA_Variant_copyRange(&v, &value.value, *range);
+        if (ret != UA_STATUSCODE_GOOD)
+            return ret;
+    }
+    else {
+        value.value = v;
+    }
+    value.hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
 /*!
  * \brief writeDataSource
  * \param server
@@ -196,6 +600,12 @@ UA_StatusCode Open62541::NodeContext::writeDataSource(UA_Server* server,
         NodeContext* p = (NodeContext*)(nodeContext);  // require node contexts to be NULL or NodeContext objects
         Server* s      = Server::findServer(server);
         if (s && p && nodeId && value) {
+            p->invalidateRead(*nodeId);
+            if (!range && p->coalesceWrite(*s, *nodeId, *value, true)) {
+                return UA_STATUSCODE_GOOD;  // delivered later by flushWrites
+            }
+            Metrics::Scope timing(Metrics::DataSourceWrite);
+            ScopedArena arena;  // temporaries made by the handler are released on return
             NodeId n;
             n = *nodeId;
             if (!p->writeData(*s, n, range, *value)) {
@@ -268,6 +678,9 @@ void Open62541::NodeContext::writeValueCallback(UA_Server* server,
         NodeContext* p = (NodeContext*)(nodeContext);  // require node contexts to be NULL or NodeContext objects
         Server* s      = Server::findServer(server);
         if (s && p && nodeId && value) {
+            if (!range && p->coalesceWrite(*s, *nodeId, *value, false)) {
+                return;  // delivered later by flushWrites
+            }
             NodeId n = *nodeId;
             p->writeValue(*s, n, range, *value);
         }
@@ -0,0 +1,1549 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/nodeset.h>
+#include <open62541cpp/open62541server.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace Open62541 {
+
+static const char Base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*!
+    \brief The value types NodeSet2 values are read and written as - the element name is the type name.
+    Named here as UA_DataType::typeName only exists with UA_ENABLE_TYPEDESCRIPTION
+*/
+static const struct {
+    int type;
+    const char* name;
+} valueTypes[] = {{UA_TYPES_BOOLEAN, "Boolean"},
+                  {UA_TYPES_SBYTE, "SByte"},
+                  {UA_TYPES_BYTE, "Byte"},
+                  {UA_TYPES_INT16, "Int16"},
+                  {UA_TYPES_UINT16, "UInt16"},
+                  {UA_TYPES_INT32, "Int32"},
+                  {UA_TYPES_UINT32, "UInt32"},
+                  {UA_TYPES_INT64, "Int64"},
+                  {UA_TYPES_UINT64, "UInt64"},
+                  {UA_TYPES_FLOAT, "Float"},
+                  {UA_TYPES_DOUBLE, "Double"},
+                  {UA_TYPES_STRING, "String"},
+                  {UA_TYPES_DATETIME, "DateTime"},
+                  {UA_TYPES_GUID, "Guid"},
+                  {UA_TYPES_BYTESTRING, "ByteString"},
+                  {UA_TYPES_NODEID, "NodeId"},
+                  {UA_TYPES_STATUSCODE, "StatusCode"},
+                  {UA_TYPES_QUALIFIEDNAME, "QualifiedName"},
+                  {UA_TYPES_LOCALIZEDTEXT, "LocalizedText"}};
+
+/*!
+    \brief valueType
+    \param name element name
+    \return the supported type of that name or nullptr
+*/
+static const UA_DataType* valueType(const std::string& name)
+{
+    for (const auto& t : valueTypes) {
+        if (name == t.name)
+            return &UA_TYPES[t.type];
+    }
+    return nullptr;
+}
+
+/*!
+    \brief valueTypeName
+    \param type
+    \return the element name of a supported type or nullptr
+*/
+static const char* valueTypeName(const UA_DataType* type)
+{
+    for (const auto& t : valueTypes) {
+        if (type == &UA_TYPES[t.type])
+            return t.name;
+    }
+    return nullptr;
+}
+
+/*!
+    \brief daysFromCivil
+    \return days since 1970-01-01 of a proleptic Gregorian date
+*/
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+    y -= (m <= 2);
+    const int64_t era  = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = unsigned(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + int64_t(doe) - 719468;
+}
+
+/*!
+    \brief trim
+    \return s without leading and trailing white space
+*/
+static std::string trim(const std::string& s)
+{
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos)
+        return std::string();
+    return s.substr(b, s.find_last_not_of(" \t\r\n") - b + 1);
+}
+
+/*!
+    \brief setString
+    \param s empty string set to a copy of t
+    \param t
+*/
+static void setString(UA_String& s, const std::string& t)
+{
+    UA_String_clear(&s);
+    if (t.empty())
+        return;
+    s.data = static_cast<UA_Byte*>(UA_malloc(t.size()));
+    if (s.data) {
+        memcpy(s.data, t.data(), t.size());
+        s.length = t.size();
+    }
+}
+
+/*!
+    \brief fromBase64
+    \param s
+    \return decoded bytes - characters outside the alphabet are ignored
+*/
+static std::string fromBase64(const std::string& s)
+{
+    std::string b;
+    uint32_t x = 0;
+    int bits   = 0;
+    for (char c : s) {
+        const char* q = (c == '=') ? nullptr : strchr(Base64, c);
+        if (!q || !c)
+            continue;
+        x = (x << 6) | uint32_t(q - Base64);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            b += char((x >> bits) & 0xFF);
+        }
+    }
+    return b;
+}
+
+/*!
+    \brief toBase64
+    \param s
+    \return s encoded
+*/
+static std::string toBase64(const UA_ByteString& s)
+{
+    std::string r;
+    size_t i = 0;
+    for (; i + 3 <= s.length; i += 3) {
+        uint32_t x = (uint32_t(s.data[i]) << 16) | (uint32_t(s.data[i + 1]) << 8) | s.data[i + 2];
+        char q[4]  = {Base64[x >> 18], Base64[(x >> 12) & 63], Base64[(x >> 6) & 63], Base64[x & 63]};
+        r.append(q, 4);
+    }
+    if (i < s.length) {
+        uint32_t x = uint32_t(s.data[i]) << 16;
+        if (i + 1 < s.length)
+            x |= uint32_t(s.data[i + 1]) << 8;
+        char q[4] = {Base64[x >> 18], Base64[(x >> 12) & 63], (i + 1 < s.length) ? Base64[(x >> 6) & 63] : '=', '='};
+        r.append(q, 4);
+    }
+    return r;
+}
+
+/*!
+    \brief parseGuid
+    \param s as 72962B91-FA75-4AE6-8D28-B404DC7DAF63
+    \param g
+    \return true if s is a guid
+*/
+static bool parseGuid(const std::string& s, UA_Guid& g)
+{
+    unsigned d[11];
+    if (sscanf(s.c_str(),
+               "%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x",
+               &d[0],
+               &d[1],
+               &d[2],
+               &d[3],
+               &d[4],
+               &d[5],
+               &d[6],
+               &d[7],
+               &d[8],
+               &d[9],
+               &d[10]) != 11)
+        return false;
+    g.data1 = d[0];
+    g.data2 = UA_UInt16(d[1]);
+    g.data3 = UA_UInt16(d[2]);
+    for (int i = 0; i < 8; i++)
+        g.data4[i] = UA_Byte(d[3 + i]);
+    return true;
+}
+
+/*!
+    \brief guidText
+    \param g
+    \return g as text
+*/
+static std::string guidText(const UA_Guid& g)
+{
+    char b[40];
+    int n = snprintf(b,
+                     sizeof(b),
+                     "%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+                     unsigned(g.data1),
+                     unsigned(g.data2),
+                     unsigned(g.data3),
+                     g.data4[0],
+                     g.data4[1],
+                     g.data4[2],
+                     g.data4[3],
+                     g.data4[4],
+                     g.data4[5],
+                     g.data4[6],
+                     g.data4[7]);
+    return std::string(b, size_t(n));
+}
+
+namespace {
+typedef std::vector<std::pair<std::string, std::string>> Attributes;
+
+/*!
+    \brief attribute
+    \return the value of a named attribute or nullptr
+*/
+const std::string* attribute(const Attributes& a, const char* name)
+{
+    for (auto& i : a) {
+        if (i.first == name)
+            return &i.second;
+    }
+    return nullptr;
+}
+
+/*!
+    \brief The XmlReader class
+    Minimal streaming XML reader - start and end of elements with their attributes, and text. CDATA and the
+    predefined and numeric entities are decoded; comments, processing instructions and the DOCTYPE are
+    skipped. Names lose their namespace prefix - NodeSet2 element names do not clash across namespaces
+*/
+class XmlReader
+{
+    std::streambuf* _in;
+    size_t _line = 1;
+
+    int get()
+    {
+        int c = _in->sbumpc();
+        if (c == '\n')
+            _line++;
+        return c;
+    }
+    int peek() { return _in->sgetc(); }
+    void space()
+    {
+        for (int c = peek(); (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'); c = peek())
+            get();
+    }
+    static std::string local(const std::string& s)
+    {
+        size_t p = s.find(':');
+        return (p == std::string::npos) ? s : s.substr(p + 1);
+    }
+
+    /*!
+        \brief until
+        Read past a terminator
+        \param end
+        \param out set to what came before the terminator if not null
+        \return false at the end of the stream
+    */
+    bool until(const char* end, std::string* out = nullptr)
+    {
+        const size_t n = strlen(end);
+        std::string w;
+        for (int c = get(); c != std::char_traits<char>::eof(); c = get()) {
+            w.push_back(char(c));
+            if ((w.size() >= n) && (w.compare(w.size() - n, n, end) == 0)) {
+                if (out)
+                    out->assign(w, 0, w.size() - n);
+                return true;
+            }
+            if (!out && (w.size() > n))
+                w.erase(0, 1);
+        }
+        return false;
+    }
+
+    bool name(std::string& s)
+    {
+        s.clear();
+        for (int c = peek(); c != std::char_traits<char>::eof(); c = peek()) {
+            if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '>') || (c == '/') || (c == '='))
+                break;
+            s.push_back(char(get()));
+        }
+        return !s.empty();
+    }
+
+    /*!
+        \brief decode
+        Replace entity references
+        \param raw
+        \param out
+        \return false on an unknown entity
+    */
+    static bool decode(const std::string& raw, std::string& out)
+    {
+        out.clear();
+        for (size_t i = 0; i < raw.size(); i++) {
+            if (raw[i] != '&') {
+                out.push_back(raw[i]);
+                continue;
+            }
+            size_t e = raw.find(';', i);
+            if (e == std::string::npos)
+                return false;
+            const std::string r = raw.substr(i + 1, e - i - 1);
+            i                   = e;
+            if (r == "lt")
+                out.push_back('<');
+            else if (r == "gt")
+                out.push_back('>');
+            else if (r == "amp")
+                out.push_back('&');
+            else if (r == "quot")
+                out.push_back('"');
+            else if (r == "apos")
+                out.push_back('\'');
+            else if ((r.size() > 1) && (r[0] == '#')) {
+                const bool hex  = (r[1] == 'x');
+                unsigned long c = strtoul(r.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10);
+                // as UTF-8
+                if (c < 0x80) {
+                    out.push_back(char(c));
+                }
+                else if (c < 0x800) {
+                    out.push_back(char(0xC0 | (c >> 6)));
+                    out.push_back(char(0x80 | (c & 0x3F)));
+                }
+                else if (c < 0x10000) {
+                    out.push_back(char(0xE0 | (c >> 12)));
+                    out.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+                    out.push_back(char(0x80 | (c & 0x3F)));
+                }
+                else {
+                    out.push_back(char(0xF0 | (c >> 18)));
+                    out.push_back(char(0x80 | ((c >> 12) & 0x3F)));
+                    out.push_back(char(0x80 | ((c >> 6) & 0x3F)));
+                    out.push_back(char(0x80 | (c & 0x3F)));
+                }
+            }
+            else
+                return false;
+        }
+        return true;
+    }
+
+public:
+    explicit XmlReader(std::istream& in)
+        : _in(in.rdbuf())
+    {
+    }
+    size_t line() const { return _line; }
+
+    /*!
+        \brief parse
+        Read the document, calling h.start(name, attributes), h.text(text) and h.end(name)
+        \param h handler
+        \return false on a syntax error
+    */
+    template <typename H>
+    bool parse(H& h)
+    {
+        std::string raw, text, tag, key, value;
+        Attributes attributes;
+        size_t depth = 0;
+        bool root    = false;
+        if (!_in)
+            return false;
+        for (int c = get();; c = get()) {
+            if (c == std::char_traits<char>::eof())
+                return root && !depth;
+            if (c != '<') {
+                if (depth)
+                    raw.push_back(char(c));
+                continue;
+            }
+            if (!raw.empty()) {
+                if (!decode(raw, text))
+                    return false;
+                h.text(text);
+                raw.clear();
+            }
+            c = peek();
+            if (c == '?') {
+                if (!until("?>"))
+                    return false;
+            }
+            else if (c == '!') {
+                get();
+                if (peek() == '-') {
+                    if (!until("-->"))
+                        return false;
+                }
+                else if (peek() == '[') {
+                    if (!until("]]>", &text) || (text.compare(0, 7, "[CDATA[") != 0))
+                        return false;
+                    if (depth)
+                        h.text(text.substr(7));
+                }
+                else if (!until(">")) {
+                    return false;  // DOCTYPE - an internal subset is not supported
+                }
+            }
+            else if (c == '/') {
+                get();
+                if (!name(tag) || !depth)
+                    return false;
+                space();
+                if (get() != '>')
+                    return false;
+                depth--;
+                h.end(local(tag));
+            }
+            else {
+                if (!name(tag))
+                    return false;
+                attributes.clear();
+                for (;;) {
+                    space();
+                    c = peek();
+                    if (c == '>' || c == '/') {
+                        get();
+                        if ((c == '/') && (get() != '>'))
+                            return false;
+                        root = true;
+                        h.start(local(tag), attributes);
+                        if (c == '/')
+                            h.end(local(tag));
+                        else
+                            depth++;
+                        break;
+                    }
+                    if (!name(key))
+                        return false;
+                    space();
+                    if (get() != '=')
+                        return false;
+                    space();
+                    int q = get();
+                    if ((q != '"') && (q != '\''))
+                        return false;
+                    const char end[2] = {char(q), 0};
+                    if (!until(end, &raw) || !decode(raw, value))
+                        return false;
+                    raw.clear();
+                    attributes.emplace_back(local(key), value);
+                }
+            }
+        }
+    }
+};
+
+/*!
+    \brief The Import struct
+    Handler of the reader - builds one node at a time
+*/
+struct Import {
+    /*!
+        \brief The Reference struct
+        Added once every node is in place
+    */
+    struct Reference {
+        NodeId source;
+        NodeId type;
+        NodeId target;
+        bool forward = true;
+    };
+
+    UA_Server* server;
+    UA_Nodestore& store;
+    std::vector<std::string> path;  // open elements
+    std::string text;
+    std::vector<UA_UInt16> remap{0};  // file namespace index to the server's
+    std::unordered_map<std::string, std::string> aliases;
+    std::string alias;
+    std::vector<Reference> references;
+    std::vector<std::pair<UA_Node*, NodeId>> referenceTypes;  // and their supertype
+    size_t nodes       = 0;
+    size_t added       = 0;  // references
+    size_t skipped     = 0;
+    size_t unsupported = 0;
+    // the open node
+    UA_Node* node = nullptr;
+    bool bad      = false;
+    std::string locale;
+    std::string referenceType;
+    bool forward = true;
+    NodeId supertype;
+    // the open Value
+    bool inValue            = false;
+    size_t valueDepth       = 0;
+    const UA_DataType* type = nullptr;
+    bool list               = false;
+    std::string valueText;
+    Attributes fields;
+    std::vector<UA_Byte> items;
+    size_t count = 0;
+
+    Import(UA_Server* s)
+        : server(s)
+        , store(UA_Server_getConfig(s)->nodestore)
+    {
+    }
+    ~Import()
+    {
+        clearItems();
+        if (node)
+            store.deleteNode(store.context, node);
+        for (auto& i : referenceTypes)
+            store.deleteNode(store.context, i.first);
+    }
+
+    /*!
+        \brief nodeId
+        \param s node id text or an alias
+        \param id set to the node id with its namespace remapped
+        \return true if s is a node id
+    */
+    bool nodeId(const std::string& s, UA_NodeId& id)
+    {
+        auto a               = aliases.find(s);
+        const std::string& t = (a != aliases.end()) ? a->second : s;
+        const char* p        = t.c_str();
+        unsigned long ns     = 0;  // nsu= is not supported
+        if (strncmp(p, "ns=", 3) == 0) {
+            char* e = nullptr;
+            ns      = strtoul(p + 3, &e, 10);
+            if (!e || (*e != ';') || (ns >= remap.size()))
+                return false;
+            p = e + 1;
+        }
+        UA_NodeId_clear(&id);
+        id.namespaceIndex = remap[ns];
+        if ((p[0] == 0) || (p[1] != '='))
+            return false;
+        const std::string v(p + 2);
+        switch (p[0]) {
+            case 'i':
+                id.identifierType     = UA_NODEIDTYPE_NUMERIC;
+                id.identifier.numeric = UA_UInt32(strtoul(v.c_str(), nullptr, 10));
+                return true;
+            case 's':
+                id.identifierType = UA_NODEIDTYPE_STRING;
+                setString(id.identifier.string, v);
+                return true;
+            case 'g':
+                id.identifierType = UA_NODEIDTYPE_GUID;
+                return parseGuid(v, id.identifier.guid);
+            case 'b':
+                id.identifierType = UA_NODEIDTYPE_BYTESTRING;
+                setString(id.identifier.byteString, fromBase64(v));
+                return true;
+            default:
+                return false;
+        }
+    }
+    bool nodeId(const std::string& s, NodeId& id) { return nodeId(s, *id.ref()); }
+
+    /*!
+        \brief qualifiedName
+        \param s as 2:Name - no prefix for namespace 0
+        \param q
+        \return true on success
+    */
+    bool qualifiedName(const std::string& s, UA_QualifiedName& q)
+    {
+        size_t p = s.find(':');
+        UA_QualifiedName_clear(&q);
+        if ((p != std::string::npos) && (p > 0) && (s.find_first_not_of("0123456789") == p)) {
+            unsigned long ns = strtoul(s.c_str(), nullptr, 10);
+            if (ns >= remap.size())
+                return false;
+            q.namespaceIndex = remap[ns];
+            setString(q.name, s.substr(p + 1));
+        }
+        else {
+            setString(q.name, s);
+        }
+        return true;
+    }
+
+    //
+    // value items
+    //
+    void clearItems()
+    {
+        if (type) {
+            for (size_t i = 0; i < count; i++)
+                UA_clear(items.data() + i * type->memSize, type);
+        }
+        items.clear();
+        count = 0;
+    }
+
+    const std::string* field(const char* name) const { return attribute(fields, name); }
+
+    /*!
+        \brief item
+        Convert the text or fields of a value item
+        \param p zeroed memory of the type
+        \return true on success
+    */
+    bool item(void* p)
+    {
+        const std::string t = trim(valueText);
+        switch (type->typeKind) {
+            case UA_DATATYPEKIND_BOOLEAN:
+                *static_cast<UA_Boolean*>(p) = (t == "true") || (t == "1");
+                return true;
+            case UA_DATATYPEKIND_SBYTE:
+                *static_cast<UA_SByte*>(p) = UA_SByte(strtol(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_BYTE:
+                *static_cast<UA_Byte*>(p) = UA_Byte(strtoul(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_INT16:
+                *static_cast<UA_Int16*>(p) = UA_Int16(strtol(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_UINT16:
+                *static_cast<UA_UInt16*>(p) = UA_UInt16(strtoul(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_INT32:
+                *static_cast<UA_Int32*>(p) = UA_Int32(strtol(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_UINT32:
+                *static_cast<UA_UInt32*>(p) = UA_UInt32(strtoul(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_INT64:
+                *static_cast<UA_Int64*>(p) = UA_Int64(strtoll(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_UINT64:
+                *static_cast<UA_UInt64*>(p) = UA_UInt64(strtoull(t.c_str(), nullptr, 10));
+                return true;
+            case UA_DATATYPEKIND_FLOAT:
+                *static_cast<UA_Float*>(p) = strtof(t.c_str(), nullptr);
+                return true;
+            case UA_DATATYPEKIND_DOUBLE:
+                *static_cast<UA_Double*>(p) = strtod(t.c_str(), nullptr);
+                return true;
+            case UA_DATATYPEKIND_STRING:
+                setString(*static_cast<UA_String*>(p), valueText);  // white space is content
+                return true;
+            case UA_DATATYPEKIND_BYTESTRING:
+                setString(*static_cast<UA_ByteString*>(p), fromBase64(t));
+                return true;
+            case UA_DATATYPEKIND_DATETIME: {
+                int y = 0, mo = 0, d = 0, h = 0, mi = 0, se = 0, n = 0;
+                if ((sscanf(t.c_str(), "%d-%d-%dT%d:%d:%d%n", &y, &mo, &d, &h, &mi, &se, &n) < 6) || (mo < 1) ||
+                    (mo > 12) || (d < 1) || (d > 31))
+                    return false;
+                int64_t frac   = 0;
+                const char* fp = t.c_str() + n;
+                if (*fp == '.') {
+                    int digits = 0;
+                    for (fp++; (*fp >= '0') && (*fp <= '9'); fp++) {
+                        if (digits++ < 7)
+                            frac = frac * 10 + (*fp - '0');
+                    }
+                    for (; digits < 7; digits++)
+                        frac *= 10;
+                }
+                int64_t secs = daysFromCivil(y, unsigned(mo), unsigned(d)) * 86400 + h * 3600 + mi * 60 + se;
+                *static_cast<UA_DateTime*>(p) = secs * UA_DATETIME_SEC + frac + UA_DATETIME_UNIX_EPOCH;
+                return true;
+            }
+            case UA_DATATYPEKIND_GUID: {
+                const std::string* s = field("String");
+                return parseGuid(s ? trim(*s) : t, *static_cast<UA_Guid*>(p));
+            }
+            case UA_DATATYPEKIND_NODEID: {
+                const std::string* s = field("Identifier");
+                return s && nodeId(trim(*s), *static_cast<UA_NodeId*>(p));
+            }
+            case UA_DATATYPEKIND_STATUSCODE: {
+                const std::string* s = field("Code");
+                *static_cast<UA_StatusCode*>(p) = UA_StatusCode(strtoul(s ? s->c_str() : "0", nullptr, 0));
+                return true;
+            }
+            case UA_DATATYPEKIND_QUALIFIEDNAME: {
+                UA_QualifiedName& q  = *static_cast<UA_QualifiedName*>(p);
+                const std::string* i = field("NamespaceIndex");
+                const std::string* n = field("Name");
+                unsigned long ns     = i ? strtoul(i->c_str(), nullptr, 10) : 0;
+                if (ns >= remap.size())
+                    return false;
+                q.namespaceIndex = remap[ns];
+                setString(q.name, n ? trim(*n) : std::string());
+                return true;
+            }
+            case UA_DATATYPEKIND_LOCALIZEDTEXT: {
+                UA_LocalizedText& l  = *static_cast<UA_LocalizedText*>(p);
+                const std::string* a = field("Locale");
+                const std::string* b = field("Text");
+                setString(l.locale, a ? trim(*a) : std::string());
+                setString(l.text, b ? *b : std::string());
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    //
+    // node attributes
+    //
+    void numeric(const Attributes& a, const char* name, UA_Byte& v)
+    {
+        const std::string* s = attribute(a, name);
+        if (s)
+            v = UA_Byte(strtoul(s->c_str(), nullptr, 10));
+    }
+    void boolean(const Attributes& a, const char* name, UA_Boolean& v)
+    {
+        const std::string* s = attribute(a, name);
+        if (s)
+            v = (*s == "true") || (*s == "1");
+    }
+    template <typename N>
+    void variableAttributes(const Attributes& a, N& n)
+    {
+        const std::string* s = attribute(a, "DataType");
+        if (!nodeId(s ? *s : std::string("i=24"), n.dataType))  // BaseDataType by default
+            bad = true;
+        s           = attribute(a, "ValueRank");
+        n.valueRank = s ? UA_Int32(strtol(s->c_str(), nullptr, 10)) : -1;
+        s           = attribute(a, "ArrayDimensions");
+        if (s && !s->empty()) {
+            std::vector<UA_UInt32> d;
+            for (const char* p = s->c_str(); *p;) {
+                char* e = nullptr;
+                d.push_back(UA_UInt32(strtoul(p, &e, 10)));
+                if (!e || (e == p))
+                    break;
+                p = (*e == ',') ? e + 1 : e;
+            }
+            n.arrayDimensions = static_cast<UA_UInt32*>(UA_Array_new(d.size(), &UA_TYPES[UA_TYPES_UINT32]));
+            if (n.arrayDimensions) {
+                memcpy(n.arrayDimensions, d.data(), d.size() * sizeof(UA_UInt32));
+                n.arrayDimensionsSize = d.size();
+            }
+        }
+    }
+
+    void beginNode(UA_NodeClass c, const Attributes& a)
+    {
+        node = store.newNode(store.context, c);
+        bad  = !node;
+        supertype.null();
+        if (!node)
+            return;
+        const std::string* s = attribute(a, "NodeId");
+        if (!s || !nodeId(*s, node->head.nodeId))
+            bad = true;
+        s = attribute(a, "BrowseName");
+        if (!s || !qualifiedName(*s, node->head.browseName))
+            bad = true;
+        s = attribute(a, "WriteMask");
+        if (s)
+            node->head.writeMask = UA_UInt32(strtoul(s->c_str(), nullptr, 10));
+        switch (c) {
+            case UA_NODECLASS_VARIABLE:
+                variableAttributes(a, node->variableNode);
+                node->variableNode.accessLevel = UA_ACCESSLEVELMASK_READ;
+                numeric(a, "AccessLevel", node->variableNode.accessLevel);
+                s = attribute(a, "MinimumSamplingInterval");
+                if (s)
+                    node->variableNode.minimumSamplingInterval = strtod(s->c_str(), nullptr);
+                boolean(a, "Historizing", node->variableNode.historizing);
+                break;
+            case UA_NODECLASS_VARIABLETYPE:
+                variableAttributes(a, node->variableTypeNode);
+                boolean(a, "IsAbstract", node->variableTypeNode.isAbstract);
+                break;
+            case UA_NODECLASS_OBJECT:
+                numeric(a, "EventNotifier", node->objectNode.eventNotifier);
+                break;
+            case UA_NODECLASS_OBJECTTYPE:
+                boolean(a, "IsAbstract", node->objectTypeNode.isAbstract);
+                break;
+            case UA_NODECLASS_DATATYPE:
+                boolean(a, "IsAbstract", node->dataTypeNode.isAbstract);
+                break;
+            case UA_NODECLASS_REFERENCETYPE:
+                boolean(a, "IsAbstract", node->referenceTypeNode.isAbstract);
+                boolean(a, "Symmetric", node->referenceTypeNode.symmetric);
+                break;
+            case UA_NODECLASS_METHOD:
+                node->methodNode.executable = true;
+                boolean(a, "Executable", node->methodNode.executable);
+                break;
+            case UA_NODECLASS_VIEW:
+                boolean(a, "ContainsNoLoops", node->viewNode.containsNoLoops);
+                numeric(a, "EventNotifier", node->viewNode.eventNotifier);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void endNode()
+    {
+        if (!node)
+            return;
+        if (bad) {
+            store.deleteNode(store.context, node);
+            node = nullptr;
+            skipped++;
+            return;
+        }
+        if (!node->head.displayName.text.length)
+            UA_String_copy(&node->head.browseName.name, &node->head.displayName.text);
+        if (node->head.nodeClass == UA_NODECLASS_REFERENCETYPE) {
+            referenceTypes.push_back(std::make_pair(node, supertype));
+            node = nullptr;
+            return;
+        }
+        node->head.constructed = true;  // nothing to construct - the model gives every child
+        if (store.insertNode(store.context, node, nullptr) == UA_STATUSCODE_GOOD)
+            nodes++;
+        else
+            skipped++;  // the store deleted the node - most likely it exists already
+        node = nullptr;
+    }
+
+    void endValue()
+    {
+        inValue = false;
+        if (!node || !type || (!list && (count != 1))) {
+            clearItems();
+            return;
+        }
+        UA_Variant v;
+        UA_Variant_init(&v);
+        void* a = UA_Array_new(count, type);
+        if (!a && count) {
+            clearItems();
+            return;
+        }
+        if (count)
+            memcpy(a, items.data(), count * type->memSize);  // the array takes over what the items own
+        if (list)
+            UA_Variant_setArray(&v, a, count, type);
+        else
+            UA_Variant_setScalar(&v, a, type);
+        items.clear();
+        count = 0;
+        UA_DataValue* dv = nullptr;
+        if (node->head.nodeClass == UA_NODECLASS_VARIABLE)
+            dv = &node->variableNode.value.data.value;
+        else if (node->head.nodeClass == UA_NODECLASS_VARIABLETYPE)
+            dv = &node->variableTypeNode.value.data.value;
+        if (dv) {
+            UA_DataValue_clear(dv);
+            dv->value    = v;
+            dv->hasValue = true;
+        }
+        else {
+            UA_Variant_clear(&v);
+        }
+    }
+
+    //
+    // reader events
+    //
+    void start(const std::string& name, const Attributes& a)
+    {
+        path.push_back(name);
+        text.clear();
+        valueText.clear();
+        const size_t d = path.size();
+        if (inValue) {
+            const size_t r = d - valueDepth;
+            if (r == 1) {
+                list = (name.compare(0, 6, "ListOf") == 0);
+                type = valueType(list ? name.substr(6) : name);
+                if (!type)
+                    unsupported++;  // ExtensionObject and the like
+            }
+            if (r == (list ? 2u : 1u))
+                fields.clear();
+            return;
+        }
+        if (d == 2) {
+            static const std::pair<const char*, UA_NodeClass> classes[] = {
+                {"UAObject", UA_NODECLASS_OBJECT},
+                {"UAVariable", UA_NODECLASS_VARIABLE},
+                {"UAMethod", UA_NODECLASS_METHOD},
+                {"UAObjectType", UA_NODECLASS_OBJECTTYPE},
+                {"UAVariableType", UA_NODECLASS_VARIABLETYPE},
+                {"UADataType", UA_NODECLASS_DATATYPE},
+                {"UAReferenceType", UA_NODECLASS_REFERENCETYPE},
+                {"UAView", UA_NODECLASS_VIEW}};
+            for (auto& c : classes) {
+                if (name == c.first) {
+                    beginNode(c.second, a);
+                    return;
+                }
+            }
+            return;
+        }
+        if (!node && (name == "Alias")) {
+            const std::string* s = attribute(a, "Alias");
+            alias                = s ? *s : std::string();
+            return;
+        }
+        if (!node || (path[1].compare(0, 2, "UA") != 0))
+            return;
+        if (d == 3) {
+            const std::string* s = attribute(a, "Locale");
+            locale               = s ? *s : std::string();
+            if (name == "Value") {
+                inValue    = true;
+                valueDepth = d;
+                type       = nullptr;
+                list       = false;
+                clearItems();
+            }
+            else if (name == "Definition") {
+                unsupported++;
+            }
+        }
+        else if ((d == 4) && (name == "Reference")) {
+            const std::string* s = attribute(a, "ReferenceType");
+            referenceType        = s ? *s : std::string();
+            s                    = attribute(a, "IsForward");
+            forward              = !s || (*s != "false");
+        }
+    }
+
+    void characters(const std::string& t)
+    {
+        if (inValue)
+            valueText += t;
+        else
+            text += t;
+    }
+
+    void end(const std::string& name)
+    {
+        const size_t d = path.size();
+        path.pop_back();
+        if (inValue) {
+            const size_t r = d - valueDepth;
+            if (r == 0) {
+                endValue();
+            }
+            else if (type && (r == (list ? 2u : 1u))) {
+                items.resize((count + 1) * type->memSize, 0);
+                if (item(items.data() + count * type->memSize))
+                    count++;
+                else
+                    items.resize(count * type->memSize);
+            }
+            else if (r == (list ? 3u : 2u)) {
+                fields.emplace_back(name, valueText);
+            }
+            valueText.clear();
+            return;
+        }
+        if (!node) {
+            if ((d == 3) && (name == "Uri"))
+                remap.push_back(UA_Server_addNamespace(server, trim(text).c_str()));
+            else if (name == "Alias")
+                aliases[alias] = trim(text);
+            else if (d == 2)
+                endNode();  // a node that could not be created
+            return;
+        }
+        if (d == 2) {
+            endNode();
+        }
+        else if (d == 3) {
+            UA_LocalizedText* l = nullptr;
+            if (name == "DisplayName")
+                l = &node->head.displayName;
+            else if (name == "Description")
+                l = &node->head.description;
+            else if ((name == "InverseName") && (node->head.nodeClass == UA_NODECLASS_REFERENCETYPE))
+                l = &node->referenceTypeNode.inverseName;
+            if (l && !l->text.length) {  // the first locale given
+                setString(l->locale, locale);
+                setString(l->text, trim(text));
+            }
+        }
+        else if ((d == 4) && (name == "Reference")) {
+            Reference r;
+            r.source  = NodeId(node->head.nodeId);
+            r.forward = forward;
+            if (!nodeId(referenceType, r.type) || !nodeId(trim(text), r.target)) {
+                skipped++;
+                return;
+            }
+            const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+            if (!forward && UA_NodeId_equal(r.type.constRef(), &hasSubtype))
+                supertype = r.target;
+            references.push_back(std::move(r));
+        }
+        text.clear();
+    }
+};
+
+/*!
+    \brief The Reader struct
+    Adapts the reader's events to Import
+*/
+struct Reader {
+    Import& import;
+    void start(const std::string& n, const Attributes& a) { import.start(n, a); }
+    void text(const std::string& t) { import.characters(t); }
+    void end(const std::string& n) { import.end(n); }
+};
+}  // namespace
+
+/*!
+    \brief Open62541::NodeSetImporter::load
+    \param in
+    \return true if the document was read to the end
+*/
+bool Open62541::NodeSetImporter::load(std::istream& in)
+{
+    _nodes       = 0;
+    _references  = 0;
+    _skipped     = 0;
+    _unsupported = 0;
+    _line        = 0;
+    _lastError   = UA_STATUSCODE_GOOD;
+    UA_Server* s = _server.server();
+    if (!s) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+    WriteLock l(_server.mutex());
+    Import im(s);
+    Reader h{im};
+    XmlReader x(in);
+    const bool ok = x.parse(h);
+    //
+    // reference types - a subtype may come before its supertype, so go round until nothing more is added
+    for (bool progress = true; progress && !im.referenceTypes.empty();) {
+        progress = false;
+        for (auto i = im.referenceTypes.begin(); i != im.referenceTypes.end();) {
+            UA_Node* node                = i->first;
+            UA_ReferenceTypeAttributes a = UA_ReferenceTypeAttributes_default;
+            a.displayName                = node->head.displayName;  // shallow - the node owns them
+            a.description                = node->head.description;
+            a.writeMask                  = node->head.writeMask;
+            a.isAbstract                 = node->referenceTypeNode.isAbstract;
+            a.symmetric                  = node->referenceTypeNode.symmetric;
+            a.inverseName                = node->referenceTypeNode.inverseName;
+            UA_StatusCode ret            = UA_Server_addReferenceTypeNode(s,
+                                                               node->head.nodeId,
+                                                               i->second,
+                                                               UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                                               node->head.browseName,
+                                                               a,
+                                                               nullptr,
+                                                               nullptr);
+            if ((ret == UA_STATUSCODE_BADPARENTNODEIDINVALID) && !i->second.isNull()) {
+                i++;  // supertype not added yet
+                continue;
+            }
+            if (ret == UA_STATUSCODE_GOOD) {
+                im.nodes++;
+                progress = true;
+            }
+            else {
+                im.skipped++;
+            }
+            im.store.deleteNode(im.store.context, node);
+            i = im.referenceTypes.erase(i);
+        }
+    }
+    //
+    // references - one added forward gives its target the inverse, so the inverse listed there is a duplicate
+    for (const Import::Reference& r : im.references) {
+        UA_ExpandedNodeId target;
+        UA_ExpandedNodeId_init(&target);
+        target.nodeId     = r.target.get();  // shallow - not cleared
+        UA_StatusCode ret = UA_Server_addReference(s, r.source, r.type, target, r.forward);
+        if (ret == UA_STATUSCODE_GOOD)
+            im.added++;
+        else if (ret != UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED)
+            im.skipped++;
+    }
+    _nodes       = im.nodes;
+    _references  = im.added;
+    _skipped     = im.skipped + im.referenceTypes.size();
+    _unsupported = im.unsupported;
+    if (!ok) {
+        _line      = x.line();
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+    }
+    return ok;
+}
+
+/*!
+    \brief Open62541::NodeSetImporter::load
+    \param file
+    \return true if the file was read to the end
+*/
+bool Open62541::NodeSetImporter::load(const std::string& file)
+{
+    std::ifstream f(file, std::ios::binary);
+    if (!f) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        return false;
+    }
+    return load(f);
+}
+
+//
+// NodeSetExporter
+//
+
+/*!
+    \brief escaped
+    Write text with the XML special characters replaced
+*/
+static void escaped(std::ostream& o, const char* s, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        switch (s[i]) {
+            case '<':
+                o << "&lt;";
+                break;
+            case '>':
+                o << "&gt;";
+                break;
+            case '&':
+                o << "&amp;";
+                break;
+            case '"':
+                o << "&quot;";
+                break;
+            default:
+                o.put(s[i]);
+                break;
+        }
+    }
+}
+static void escaped(std::ostream& o, const UA_String& s)
+{
+    escaped(o, reinterpret_cast<const char*>(s.data), s.length);
+}
+static void escaped(std::ostream& o, const std::string& s) { escaped(o, s.data(), s.size()); }
+
+/*!
+    \brief nodeIdText
+    \param id
+    \return id in the NodeSet2 text form
+*/
+static std::string nodeIdText(const UA_NodeId& id)
+{
+    std::string r = id.namespaceIndex ? "ns=" + std::to_string(id.namespaceIndex) + ";" : std::string();
+    switch (id.identifierType) {
+        case UA_NODEIDTYPE_NUMERIC:
+            return r + "i=" + std::to_string(id.identifier.numeric);
+        case UA_NODEIDTYPE_STRING:
+            return r + "s=" +
+                   std::string(reinterpret_cast<const char*>(id.identifier.string.data), id.identifier.string.length);
+        case UA_NODEIDTYPE_GUID:
+            return r + "g=" + guidText(id.identifier.guid);
+        default:
+            return r + "b=" + toBase64(id.identifier.byteString);
+    }
+}
+
+/*!
+    \brief itemXml
+    Write the content of one value item
+    \return false if the type is not supported
+*/
+static bool itemXml(std::ostream& o, const void* p, const UA_DataType* t)
+{
+    char b[64];
+    switch (t->typeKind) {
+        case UA_DATATYPEKIND_BOOLEAN:
+            o << (*static_cast<const UA_Boolean*>(p) ? "true" : "false");
+            return true;
+        case UA_DATATYPEKIND_SBYTE:
+            o << int(*static_cast<const UA_SByte*>(p));
+            return true;
+        case UA_DATATYPEKIND_BYTE:
+            o << unsigned(*static_cast<const UA_Byte*>(p));
+            return true;
+        case UA_DATATYPEKIND_INT16:
+            o << *static_cast<const UA_Int16*>(p);
+            return true;
+        case UA_DATATYPEKIND_UINT16:
+            o << *static_cast<const UA_UInt16*>(p);
+            return true;
+        case UA_DATATYPEKIND_INT32:
+            o << *static_cast<const UA_Int32*>(p);
+            return true;
+        case UA_DATATYPEKIND_UINT32:
+            o << *static_cast<const UA_UInt32*>(p);
+            return true;
+        case UA_DATATYPEKIND_INT64:
+            o << (long long)(*static_cast<const UA_Int64*>(p));
+            return true;
+        case UA_DATATYPEKIND_UINT64:
+            o << (unsigned long long)(*static_cast<const UA_UInt64*>(p));
+            return true;
+        case UA_DATATYPEKIND_FLOAT:
+            o.write(b, snprintf(b, sizeof(b), "%.9g", double(*static_cast<const UA_Float*>(p))));
+            return true;
+        case UA_DATATYPEKIND_DOUBLE:
+            o.write(b, snprintf(b, sizeof(b), "%.17g", *static_cast<const UA_Double*>(p)));
+            return true;
+        case UA_DATATYPEKIND_STRING:
+            escaped(o, *static_cast<const UA_String*>(p));
+            return true;
+        case UA_DATATYPEKIND_BYTESTRING:
+            o << toBase64(*static_cast<const UA_ByteString*>(p));
+            return true;
+        case UA_DATATYPEKIND_DATETIME: {
+            UA_DateTime d         = *static_cast<const UA_DateTime*>(p);
+            UA_DateTimeStruct dts = UA_DateTime_toStruct(d);
+            long frac             = long(((d % UA_DATETIME_SEC) + UA_DATETIME_SEC) % UA_DATETIME_SEC);
+            o.write(b,
+                    snprintf(b,
+                             sizeof(b),
+                             "%04d-%02u-%02uT%02u:%02u:%02u.%07ldZ",
+                             int(dts.year),
+                             unsigned(dts.month),
+                             unsigned(dts.day),
+                             unsigned(dts.hour),
+                             unsigned(dts.min),
+                             unsigned(dts.sec),
+                             frac));
+            return true;
+        }
+        case UA_DATATYPEKIND_GUID:
+            o << "<uax:String>" << guidText(*static_cast<const UA_Guid*>(p)) << "</uax:String>";
+            return true;
+        case UA_DATATYPEKIND_NODEID:
+            o << "<uax:Identifier>";
+            escaped(o, nodeIdText(*static_cast<const UA_NodeId*>(p)));
+            o << "</uax:Identifier>";
+            return true;
+        case UA_DATATYPEKIND_STATUSCODE:
+            o << "<uax:Code>" << *static_cast<const UA_StatusCode*>(p) << "</uax:Code>";
+            return true;
+        case UA_DATATYPEKIND_QUALIFIEDNAME: {
+            const UA_QualifiedName& q = *static_cast<const UA_QualifiedName*>(p);
+            o << "<uax:NamespaceIndex>" << q.namespaceIndex << "</uax:NamespaceIndex><uax:Name>";
+            escaped(o, q.name);
+            o << "</uax:Name>";
+            return true;
+        }
+        case UA_DATATYPEKIND_LOCALIZEDTEXT: {
+            const UA_LocalizedText& l = *static_cast<const UA_LocalizedText*>(p);
+            o << "<uax:Locale>";
+            escaped(o, l.locale);
+            o << "</uax:Locale><uax:Text>";
+            escaped(o, l.text);
+            o << "</uax:Text>";
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/*!
+    \brief valueXml
+    Write a Value element
+    \return false if the value is not written
+*/
+static bool valueXml(std::ostream& o, const UA_Variant& v)
+{
+    const char* n = valueTypeName(v.type);
+    if (!n || (v.arrayDimensionsSize > 1))
+        return false;
+    o << "    <Value>\n";
+    if (UA_Variant_isScalar(&v)) {
+        o << "      <uax:" << n << ">";
+        itemXml(o, v.data, v.type);
+        o << "</uax:" << n << ">\n";
+    }
+    else {
+        o << "      <uax:ListOf" << n << ">\n";
+        const UA_Byte* p = static_cast<const UA_Byte*>(v.data);
+        for (size_t i = 0; i < v.arrayLength; i++, p += v.type->memSize) {
+            o << "        <uax:" << n << ">";
+            itemXml(o, p, v.type);
+            o << "</uax:" << n << ">\n";
+        }
+        o << "      </uax:ListOf" << n << ">\n";
+    }
+    o << "    </Value>\n";
+    return true;
+}
+
+/*!
+    \brief localizedXml
+    Write a localized text element if it has text
+*/
+static void localizedXml(std::ostream& o, const char* name, const UA_LocalizedText& l)
+{
+    if (!l.text.length)
+        return;
+    o << "    <" << name;
+    if (l.locale.length) {
+        o << " Locale=\"";
+        escaped(o, l.locale);
+        o << "\"";
+    }
+    o << ">";
+    escaped(o, l.text);
+    o << "</" << name << ">\n";
+}
+
+/*!
+    \brief Open62541::NodeSetExporter::save
+    \param out
+    \return true if the stream took it all
+*/
+bool Open62541::NodeSetExporter::save(std::ostream& out)
+{
+    _nodes       = 0;
+    _unsupported = 0;
+    _lastError   = UA_STATUSCODE_GOOD;
+    UA_Server* s = _server.server();
+    if (!s) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+    WriteLock l(_server.mutex());
+    out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+           "<UANodeSet xmlns=\"http://opcfoundation.org/UA/2011/03/UANodeSet.xsd\" "
+           "xmlns:uax=\"http://opcfoundation.org/UA/2008/02/Types.xsd\">\n";
+    // the server's namespace indexes are kept - the file's list starts at namespace 1
+    UA_Variant ns;
+    UA_Variant_init(&ns);
+    if ((UA_Server_readValue(s, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_NAMESPACEARRAY), &ns) == UA_STATUSCODE_GOOD) &&
+        (ns.type == &UA_TYPES[UA_TYPES_STRING]) && (ns.arrayLength > 1)) {
+        out << "  <NamespaceUris>\n";
+        const UA_String* uri = static_cast<const UA_String*>(ns.data);
+        for (size_t i = 1; i < ns.arrayLength; i++) {
+            out << "    <Uri>";
+            escaped(out, uri[i]);
+            out << "</Uri>\n";
+        }
+        out << "  </NamespaceUris>\n";
+    }
+    UA_Variant_clear(&ns);
+    //
+    UA_Nodestore& store = UA_Server_getConfig(s)->nodestore;
+    std::vector<NodeId> ids;
+    store.iterate(
+        store.context,
+        [](void* c, const UA_Node* node) {
+            if (node->head.nodeId.namespaceIndex)
+                static_cast<std::vector<NodeId>*>(c)->push_back(NodeId(node->head.nodeId));
+        },
+        &ids);
+    for (const NodeId& id : ids) {
+        const UA_Node* node = store.getNode(store.context, id.constRef());
+        if (!node)
+            continue;
+        const char* element = nullptr;
+        switch (node->head.nodeClass) {
+            case UA_NODECLASS_OBJECT:
+                element = "UAObject";
+                break;
+            case UA_NODECLASS_VARIABLE:
+                element = "UAVariable";
+                break;
+            case UA_NODECLASS_METHOD:
+                element = "UAMethod";
+                break;
+            case UA_NODECLASS_OBJECTTYPE:
+                element = "UAObjectType";
+                break;
+            case UA_NODECLASS_VARIABLETYPE:
+                element = "UAVariableType";
+                break;
+            case UA_NODECLASS_DATATYPE:
+                element = "UADataType";
+                break;
+            case UA_NODECLASS_REFERENCETYPE:
+                element = "UAReferenceType";
+                break;
+            case UA_NODECLASS_VIEW:
+                element = "UAView";
+                break;
+            default:
+                store.releaseNode(store.context, node);
+                continue;
+        }
+        out << "  <" << element << " NodeId=\"";
+        escaped(out, nodeIdText(node->head.nodeId));
+        out << "\" BrowseName=\"";
+        if (node->head.browseName.namespaceIndex)
+            out << node->head.browseName.namespaceIndex << ":";
+        escaped(out, node->head.browseName.name);
+        out << "\"";
+        if (node->head.writeMask)
+            out << " WriteMask=\"" << node->head.writeMask << "\"";
+        const UA_Variant* value = nullptr;
+        auto variable           = [&](const UA_NodeId& dataType, UA_Int32 rank, size_t n, const UA_UInt32* dims) {
+            out << " DataType=\"";
+            escaped(out, nodeIdText(dataType));
+            out << "\" ValueRank=\"" << rank << "\"";
+            if (n) {
+                out << " ArrayDimensions=\"";
+                for (size_t i = 0; i < n; i++)
+                    out << (i ? "," : "") << dims[i];
+                out << "\"";
+            }
+        };
+        switch (node->head.nodeClass) {
+            case UA_NODECLASS_VARIABLE: {
+                const UA_VariableNode& v = node->variableNode;
+                variable(v.dataType, v.valueRank, v.arrayDimensionsSize, v.arrayDimensions);
+                out << " AccessLevel=\"" << unsigned(v.accessLevel) << "\"";
+                if (v.minimumSamplingInterval != 0.0)
+                    out << " MinimumSamplingInterval=\"" << v.minimumSamplingInterval << "\"";
+                if (v.historizing)
+                    out << " Historizing=\"true\"";
+                if ((v.valueSource == UA_VALUESOURCE_DATA) && v.value.data.value.hasValue)
+                    value = &v.value.data.value.value;
+                break;
+            }
+            case UA_NODECLASS_VARIABLETYPE: {
+                const UA_VariableTypeNode& v = node->variableTypeNode;
+                variable(v.dataType, v.valueRank, v.arrayDimensionsSize, v.arrayDimensions);
+                if (v.isAbstract)
+                    out << " IsAbstract=\"true\"";
+                if ((v.valueSource == UA_VALUESOURCE_DATA) && v.value.data.value.hasValue)
+                    value = &v.value.data.value.value;
+                break;
+            }
+            case UA_NODECLASS_OBJECT:
+                if (node->objectNode.eventNotifier)
+                    out << " EventNotifier=\"" << unsigned(node->objectNode.eventNotifier) << "\"";
+                break;
+            case UA_NODECLASS_OBJECTTYPE:
+                if (node->objectTypeNode.isAbstract)
+                    out << " IsAbstract=\"true\"";
+                break;
+            case UA_NODECLASS_DATATYPE:
+                if (node->dataTypeNode.isAbstract)
+                    out << " IsAbstract=\"true\"";
+                break;
+            case UA_NODECLASS_REFERENCETYPE:
+                if (node->referenceTypeNode.isAbstract)
+                    out << " IsAbstract=\"true\"";
+                if (node->referenceTypeNode.symmetric)
+                    out << " Symmetric=\"true\"";
+                break;
+            case UA_NODECLASS_METHOD:
+                if (!node->methodNode.executable)
+                    out << " Executable=\"false\"";
+                break;
+            case UA_NODECLASS_VIEW:
+                if (node->viewNode.containsNoLoops)
+                    out << " ContainsNoLoops=\"true\"";
+                if (node->viewNode.eventNotifier)
+                    out << " EventNotifier=\"" << unsigned(node->viewNode.eventNotifier) << "\"";
+                break;
+            default:
+                break;
+        }
+        out << ">\n";
+        localizedXml(out, "DisplayName", node->head.displayName);
+        localizedXml(out, "Description", node->head.description);
+        if (node->head.nodeClass == UA_NODECLASS_REFERENCETYPE)
+            localizedXml(out, "InverseName", node->referenceTypeNode.inverseName);
+        //
+        UA_BrowseDescription bd;
+        UA_BrowseDescription_init(&bd);
+        bd.nodeId          = node->head.nodeId;  // shallow - bd is not cleared
+        bd.browseDirection = UA_BROWSEDIRECTION_BOTH;
+        bd.includeSubtypes = true;
+        bd.resultMask      = UA_BROWSERESULTMASK_REFERENCETYPEID | UA_BROWSERESULTMASK_ISFORWARD;
+        UA_BrowseResult r  = UA_Server_browse(s, 0, &bd);
+        if (r.referencesSize) {
+            out << "    <References>\n";
+            for (size_t i = 0; i < r.referencesSize; i++) {
+                const UA_ReferenceDescription& d = r.references[i];
+                out << "      <Reference ReferenceType=\"";
+                escaped(out, nodeIdText(d.referenceTypeId));
+                out << "\"" << (d.isForward ? "" : " IsForward=\"false\"") << ">";
+                escaped(out, nodeIdText(d.nodeId.nodeId));
+                out << "</Reference>\n";
+            }
+            out << "    </References>\n";
+        }
+        UA_BrowseResult_clear(&r);
+        if (value && !UA_Variant_isEmpty(value) && !valueXml(out, *value))
+            _unsupported++;
+        out << "  </" << element << ">\n";
+        store.releaseNode(store.context, node);
+        _nodes++;
+        if (!out)
+            break;
+    }
+    out << "</UANodeSet>\n";
+    out.flush();
+    if (!out)
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::NodeSetExporter::save
+    Written to a temporary file that then replaces file
+    \param file
+    \return true on success
+*/
+bool Open62541::NodeSetExporter::save(const std::string& file)
+{
+    std::string t = file + ".tmp";
+    bool ok       = false;
+    {
+        std::ofstream f(t, std::ios::binary | std::ios::trunc);
+        ok = f && save(f);
+    }
+    if (!ok || (rename(t.c_str(), file.c_str()) != 0)) {
+        remove(t.c_str());
+        if (lastOK())
+            _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace Open62541
@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/nodestore.h>
+#include <cstring>
+
+namespace Open62541 {
+
+namespace {
+// plugin table entries - the context is the store
+Nodestore* store(void* nsCtx)
+{
+    return static_cast<Nodestore*>(nsCtx);
+}
+}  // namespace
+
+/*!
+    \brief Open62541::Nodestore::plug
+    \param ns
+*/
+void Open62541::Nodestore::plug(UA_Nodestore& ns)
+{
+    ns.context     = this;
+    ns.clear       = [](void* c) { store(c)->clear(); };
+    ns.newNode     = [](void* c, UA_NodeClass nodeClass) { return store(c)->newNode(nodeClass); };
+    ns.deleteNode  = [](void* c, UA_Node* node) { store(c)->deleteNode(node); };
+    ns.getNode     = [](void* c, const UA_NodeId* nodeId) { return store(c)->getNode(*nodeId); };
+    ns.releaseNode = [](void* c, const UA_Node* node) {
+        if (node)
+            store(c)->releaseNode(node);
+    };
+    ns.getNodeCopy = [](void* c, const UA_NodeId* nodeId, UA_Node** outNode) {
+        return store(c)->getNodeCopy(*nodeId, outNode);
+    };
+    ns.insertNode = [](void* c, UA_Node* node, UA_NodeId* addedNodeId) {
+        return store(c)->insertNode(node, addedNodeId);
+    };
+    ns.replaceNode        = [](void* c, UA_Node* node) { return store(c)->replaceNode(node); };
+    ns.removeNode         = [](void* c, const UA_NodeId* nodeId) { return store(c)->removeNode(*nodeId); };
+    ns.getReferenceTypeId = [](void* c, UA_Byte index) { return store(c)->getReferenceTypeId(index); };
+    ns.iterate            = [](void* c, UA_NodestoreVisitor visitor, void* visitorCtx) {
+        store(c)->iterate(visitor, visitorCtx);
+    };
+}
+
+/*!
+    \brief Open62541::NumericNodestore::NumericNodestore
+    \param directLimit
+    \param slabSize
+*/
+Open62541::NumericNodestore::NumericNodestore(UA_UInt32 directLimit, size_t slabSize)
+    : _directLimit(directLimit)
+    , _slabSize(slabSize ? slabSize : 1)
+{
+    for (auto& i : _referenceTypeIds) {
+        UA_NodeId_init(&i);
+    }
+}
+
+/*!
+    \brief Open62541::NumericNodestore::~NumericNodestore
+*/
+Open62541::NumericNodestore::~NumericNodestore()
+{
+    clear();
+}
+
+/*!
+    \brief Open62541::NumericNodestore::allocate
+    \return a zeroed entry from the slabs
+*/
+Open62541::NumericNodestore::Entry* Open62541::NumericNodestore::allocate()
+{
+    std::lock_guard<std::mutex> l(_allocMutex);
+    if (!_free) {
+        // a new slab - thread its entries onto the free list
+        _slabs.emplace_back(new Entry[_slabSize]);
+        Entry* s = _slabs.back().get();
+        for (size_t i = _slabSize; i > 0; i--) {
+            s[i - 1].nextFree = _free;
+            _free             = &s[i - 1];
+        }
+    }
+    Entry* e = _free;
+    _free    = e->nextFree;
+    _used++;
+    memset(&e->node, 0, sizeof(UA_Node));
+    e->orig     = nullptr;
+    e->nextFree = nullptr;
+    e->state    = 0;
+    return e;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::recycle
+    Clear an entry's node and return the entry to the free list
+    \param e
+*/
+void Open62541::NumericNodestore::recycle(Entry* e)
+{
+    UA_Node_clear(&e->node);
+    std::lock_guard<std::mutex> l(_allocMutex);
+    e->nextFree = _free;
+    _free       = e;
+    _used--;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::retire
+    Mark an entry taken out of the index - it is recycled now or by the last releaseNode
+    \param e
+*/
+void Open62541::NumericNodestore::retire(Entry* e)
+{
+    if (e->state.fetch_or(Deleted) == 0) {
+        recycle(e);
+    }
+}
+
+/*!
+    \brief Open62541::NumericNodestore::find
+    \param id
+    \return the indexed entry or null - call under the lock
+*/
+Open62541::NumericNodestore::Entry* Open62541::NumericNodestore::find(const UA_NodeId& id) const
+{
+    if (id.identifierType == UA_NODEIDTYPE_NUMERIC && id.identifier.numeric < _directLimit) {
+        if (id.namespaceIndex >= _namespaces.size())
+            return nullptr;
+        const std::vector<Entry*>& d = _namespaces[id.namespaceIndex].direct;
+        return (id.identifier.numeric < d.size()) ? d[id.identifier.numeric] : nullptr;
+    }
+    auto i = _hashed.find(id);
+    return (i != _hashed.end()) ? i->second : nullptr;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::slot
+    \param id
+    \param create make room for the id if it has no slot
+    \return the index cell of the id or null - call under the write lock
+*/
+Open62541::NumericNodestore::Entry** Open62541::NumericNodestore::slot(const UA_NodeId& id, bool create)
+{
+    if (id.identifierType == UA_NODEIDTYPE_NUMERIC && id.identifier.numeric < _directLimit) {
+        if (id.namespaceIndex >= _namespaces.size()) {
+            if (!create)
+                return nullptr;
+            _namespaces.resize(size_t(id.namespaceIndex) + 1);
+        }
+        std::vector<Entry*>& d = _namespaces[id.namespaceIndex].direct;
+        if (id.identifier.numeric >= d.size()) {
+            if (!create)
+                return nullptr;
+            d.resize(size_t(id.identifier.numeric) + 1, nullptr);
+        }
+        return &d[id.identifier.numeric];
+    }
+    if (create)
+        return &_hashed.put(id, nullptr);
+    return _hashed.value(id);
+}
+
+/*!
+    \brief Open62541::NumericNodestore::erase
+    Take an id out of the index - call under the write lock
+    \param id
+*/
+void Open62541::NumericNodestore::erase(const UA_NodeId& id)
+{
+    if (id.identifierType == UA_NODEIDTYPE_NUMERIC && id.identifier.numeric < _directLimit) {
+        Namespace& n                    = _namespaces[id.namespaceIndex];
+        n.direct[id.identifier.numeric] = nullptr;
+        if (id.identifier.numeric < n.next)
+            n.next = id.identifier.numeric;
+        _direct--;
+    }
+    else {
+        _hashed.remove(id);
+    }
+    _size--;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::assignId
+    Give a node id of numeric 0 the lowest free id of its namespace - call under the write lock
+    \param id
+    \return false if the namespace is full
+*/
+bool Open62541::NumericNodestore::assignId(UA_NodeId& id)
+{
+    if (id.namespaceIndex >= _namespaces.size()) {
+        _namespaces.resize(size_t(id.namespaceIndex) + 1);
+    }
+    Namespace& n = _namespaces[id.namespaceIndex];
+    UA_UInt32 i  = n.next;
+    while (i < _directLimit && i < n.direct.size() && n.direct[i])
+        i++;
+    if (i >= _directLimit) {
+        // the direct range is full - look for a free hashed id
+        for (id.identifier.numeric = i; _hashed.value(id); id.identifier.numeric = ++i) {
+            if (i == UA_UINT32_MAX)
+                return false;
+        }
+    }
+    id.identifier.numeric = i;
+    n.next                = i + 1;
+    return true;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::clear
+*/
+void Open62541::NumericNodestore::clear()
+{
+    WriteLock l(_mutex);
+    for (auto& n : _namespaces) {
+        for (Entry* e : n.direct) {
+            if (e)
+                UA_Node_clear(&e->node);
+        }
+    }
+    for (auto& i : _hashed) {
+        UA_Node_clear(&i.second->node);
+    }
+    _namespaces.clear();
+    _hashed.clearAll();
+    _size   = 0;
+    _direct = 0;
+    for (UA_Byte i = 0; i < _referenceTypes; i++) {
+        UA_NodeId_clear(&_referenceTypeIds[i]);
+    }
+    _referenceTypes = 0;
+    std::lock_guard<std::mutex> a(_allocMutex);
+    _slabs.clear();
+    _free = nullptr;
+    _used = 0;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::newNode
+    \param nodeClass
+    \return new node
+*/
+UA_Node* Open62541::NumericNodestore::newNode(UA_NodeClass nodeClass)
+{
+    Entry* e               = allocate();
+    e->node.head.nodeClass = nodeClass;
+    return &e->node;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::deleteNode
+    \param node
+*/
+void Open62541::NumericNodestore::deleteNode(UA_Node* node)
+{
+    if (node)
+        recycle(entry(node));
+}
+
+/*!
+    \brief Open62541::NumericNodestore::getNode
+    \param nodeId
+    \return node or null
+*/
+const UA_Node* Open62541::NumericNodestore::getNode(const UA_NodeId& nodeId)
+{
+    ReadLock l(_mutex);
+    Entry* e = find(nodeId);
+    if (!e)
+        return nullptr;
+    e->state++;
+    return &e->node;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::releaseNode
+    \param node
+*/
+void Open62541::NumericNodestore::releaseNode(const UA_Node* node)
+{
+    Entry* e = entry(node);
+    if (e->state.fetch_sub(1) == Deleted + 1) {
+        recycle(e);  // the last holder of a removed node
+    }
+}
+
+/*!
+    \brief Open62541::NumericNodestore::getNodeCopy
+    \param nodeId
+    \param outNode
+    \return status
+*/
+UA_StatusCode Open62541::NumericNodestore::getNodeCopy(const UA_NodeId& nodeId, UA_Node** outNode)
+{
+    Entry* c = allocate();
+    ReadLock l(_mutex);
+    Entry* e = find(nodeId);
+    if (!e) {
+        l.unlock();
+        recycle(c);
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    }
+    UA_StatusCode ret = UA_Node_copy(&e->node, &c->node);
+    if (ret != UA_STATUSCODE_GOOD) {
+        l.unlock();
+        recycle(c);
+        return ret;
+    }
+    c->orig  = e;
+    *outNode = &c->node;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::insertNode
+    \param node
+    \param addedNodeId
+    \return status
+*/
+UA_StatusCode Open62541::NumericNodestore::insertNode(UA_Node* node, UA_NodeId* addedNodeId)
+{
+    Entry* e = entry(node);
+    WriteLock l(_mutex);
+    UA_NodeId& id = node->head.nodeId;
+    if (id.identifierType == UA_NODEIDTYPE_NUMERIC && id.identifier.numeric == 0) {
+        if (!assignId(id)) {
+            l.unlock();
+            recycle(e);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+    }
+    else if (find(id)) {
+        l.unlock();
+        recycle(e);
+        return UA_STATUSCODE_BADNODEIDEXISTS;
+    }
+    if (node->head.nodeClass == UA_NODECLASS_REFERENCETYPE) {
+        if (_referenceTypes >= UA_REFERENCETYPESET_MAX ||
+            UA_NodeId_copy(&id, &_referenceTypeIds[_referenceTypes]) != UA_STATUSCODE_GOOD) {
+            l.unlock();
+            recycle(e);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        node->referenceTypeNode.referenceTypeIndex = _referenceTypes++;
+    }
+    if (addedNodeId) {
+        UA_StatusCode ret = UA_NodeId_copy(&id, addedNodeId);
+        if (ret != UA_STATUSCODE_GOOD) {
+            l.unlock();
+            recycle(e);
+            return ret;
+        }
+    }
+    Entry** s = slot(id, true);
+    *s        = e;
+    e->orig   = nullptr;
+    _size++;
+    if (id.identifierType == UA_NODEIDTYPE_NUMERIC && id.identifier.numeric < _directLimit)
+        _direct++;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::replaceNode
+    \param node
+    \return status
+*/
+UA_StatusCode Open62541::NumericNodestore::replaceNode(UA_Node* node)
+{
+    Entry* e = entry(node);
+    WriteLock l(_mutex);
+    Entry** s = slot(node->head.nodeId, false);
+    if (!s || !*s || *s != e->orig) {
+        UA_StatusCode ret = (s && *s) ? UA_STATUSCODE_BADINTERNALERROR  // replaced since the copy was taken
+                                      : UA_STATUSCODE_BADNODEIDUNKNOWN;
+        l.unlock();
+        recycle(e);
+        return ret;
+    }
+    Entry* old = *s;
+    *s         = e;
+    e->orig    = nullptr;
+    retire(old);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::removeNode
+    \param nodeId
+    \return status
+*/
+UA_StatusCode Open62541::NumericNodestore::removeNode(const UA_NodeId& nodeId)
+{
+    WriteLock l(_mutex);
+    Entry* e = find(nodeId);
+    if (!e)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    erase(nodeId);
+    retire(e);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::getReferenceTypeId
+    \param index
+    \return node id or null
+*/
+const UA_NodeId* Open62541::NumericNodestore::getReferenceTypeId(UA_Byte index)
+{
+    ReadLock l(_mutex);
+    return (index < _referenceTypes) ? &_referenceTypeIds[index] : nullptr;
+}
+
+/*!
+    \brief Open62541::NumericNodestore::iterate
+    The visitor runs without the lock, so it may look up other nodes
+    \param visitor
+    \param context
+*/
+void Open62541::NumericNodestore::iterate(UA_NodestoreVisitor visitor, void* context)
+{
+    std::vector<Entry*> held;
+    {
+        ReadLock l(_mutex);
+        held.reserve(_size);
+        for (auto& n : _namespaces) {
+            for (Entry* e : n.direct) {
+                if (e) {
+                    e->state++;
+                    held.push_back(e);
+                }
+            }
+        }
+        for (auto& i : _hashed) {
+            i.second->state++;
+            held.push_back(i.second);
+        }
+    }
+    for (Entry* e : held) {
+        visitor(context, &e->node);
+        releaseNode(&e->node);
+    }
+}
+
+/*!
+    \brief Open62541::NumericNodestore::bytes
+    \return bytes held
+*/
+size_t Open62541::NumericNodestore::bytes()
+{
+    ReadLock l(_mutex);
+    size_t n = 0;
+    for (auto& i : _namespaces) {
+        n += i.direct.capacity() * sizeof(Entry*);
+    }
+    std::lock_guard<std::mutex> a(_allocMutex);
+    return n + _slabs.size() * _slabSize * sizeof(Entry);
+}
+
+}  // namespace Open62541
@@ -11,6 +11,10 @@
  */
 #include <open62541cpp/open62541client.h>
 #include <open62541cpp/clientbrowser.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 /*!
  * \brief subscriptionInactivityCallback
@@ -42,10 +46,408 @@ void Open62541::Client::asyncServiceCallback(UA_Client* client,
 {
     Client* p = (Client*)(UA_Client_getContext(client));
     if (p) {
-        p->asyncService(userdata, requestId, response, responseType);
+        if (userdata == p) {
+            // sent with sendAsync - find the handler by request id
+            AsyncHandler h;
+            {
+                std::lock_guard<std::mutex> l(p->_asyncMutex);
+                auto i = p->_asyncHandlers.find(requestId);
+                if (i != p->_asyncHandlers.end()) {
+                    h = std::move(i->second);
+                    p->_asyncHandlers.erase(i);
+                }
+            }
+            if (h) {
+                UA_StatusCode s = response ? static_cast<UA_ResponseHeader*>(response)->serviceResult
+                                           : UA_STATUSCODE_BADUNEXPECTEDERROR;  // every response starts with a header
+                // handlers can nest when one pumps the client - restore the outer owner afterwards
+                std::thread::id outer = p->_asyncHandlerThread.exchange(std::this_thread::get_id());
+                try {
+                    h(s, response);
+                }
+                catch (...) {
+                    // must not unwind through the C stack
+                }
+                p->_asyncHandlerThread = outer;
+            }
+        }
+        else {
+            p->asyncService(userdata, requestId, response, responseType);
+        }
     }
 }
 
+/*!
+    \brief Open62541::Client::sendAsync
+    \param request
+    \param requestType
+    \param responseType
+    \param handler
+    \param requestId
+    \return true if sent
+*/
+bool Open62541::Client::sendAsync(const void* request,
+                                  const UA_DataType* requestType,
+                                  const UA_DataType* responseType,
+                                  AsyncHandler handler,
+                                  UA_UInt32* requestId)
+{
+    if (!_client || !handler || !request)
+        return false;
+    // a handler runs on the thread pumping the client, which may hold the client lock - do not take it again
+    std::unique_ptr<WriteLock> l;
+    if (_asyncHandlerThread.load() != std::this_thread::get_id())
+        l.reset(new WriteLock(_mutex));
+    // the table is locked over the send so a response pumped by another thread cannot miss its handler
+    std::lock_guard<std::mutex> al(_asyncMutex);
+    UA_UInt32 id = 0;
+    _lastError   = __UA_Client_AsyncService(_client, request, requestType, asyncServiceCallback, responseType, this, &id);
+    if (_lastError != UA_STATUSCODE_GOOD)
+        return false;
+    _asyncHandlers[id] = std::move(handler);
+    if (requestId)
+        *requestId = id;
+    return true;
+}
+
+/*!
+    \brief Open62541::Client::readValueAsync
+    \param nodeId
+    \param done
+    \return true if sent
+*/
+bool Open62541::Client::readValueAsync(const NodeId& nodeId, std::function<void(UA_StatusCode, DataValue&)> done)
+{
+    NodeId current;
+    UA_ReadValueId rvi;
+    UA_ReadValueId_init(&rvi);
+    // shallow - encoded before sendAsync returns
+    rvi.nodeId      = *(translate(nodeId, current) ? current : nodeId).constRef();
+    rvi.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead        = &rvi;
+    req.nodesToReadSize    = 1;
+    req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    return sendAsync(&req,
+                     &UA_TYPES[UA_TYPES_READREQUEST],
+                     &UA_TYPES[UA_TYPES_READRESPONSE],
+                     [done](UA_StatusCode s, void* response) {
+                         DataValue v;
+                         UA_ReadResponse* r = static_cast<UA_ReadResponse*>(response);
+                         if (s == UA_STATUSCODE_GOOD) {
+                             if (r->resultsSize == 1) {
+                                 v.adopt(r->results[0]);  // response is cleared by the stack - take the value
+                                 if (v.constRef()->hasStatus)
+                                     s = v.constRef()->status;
+                             }
+                             else {
+                                 s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+                             }
+                         }
+                         if (done)
+                             done(s, v);
+                     });
+}
+
+/*!
+    \brief Open62541::Client::readValueAsync
+    \param nodeId
+    \return future data value
+*/
+std::future<Open62541::DataValue> Open62541::Client::readValueAsync(const NodeId& nodeId)
+{
+    auto p = std::make_shared<std::promise<DataValue>>();
+    std::future<DataValue> f = p->get_future();
+    auto fail = [](UA_StatusCode s) {
+        DataValue v;
+        v.ref()->hasStatus = true;
+        v.ref()->status    = s;
+        return v;
+    };
+    if (!readValueAsync(nodeId, [p, fail](UA_StatusCode s, DataValue& v) {
+            p->set_value((s == UA_STATUSCODE_GOOD) ? std::move(v) : fail(s));
+        })) {
+        p->set_value(fail(_lastError));
+    }
+    return f;
+}
+
+/*!
+    \brief Open62541::Client::writeValueAsync
+    \param nodeId
+    \param value
+    \param done
+    \return true if sent
+*/
+bool Open62541::Client::writeValueAsync(const NodeId& nodeId, const Variant& value, std::function<void(UA_StatusCode)> done)
+{
+    NodeId current;
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    // shallow - encoded before sendAsync returns
+    wv.nodeId         = *(translate(nodeId, current) ? current : nodeId).constRef();
+    wv.attributeId    = UA_ATTRIBUTEID_VALUE;
+    wv.value.hasValue = true;
+    wv.value.value    = *value.constRef();
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    req.nodesToWrite     = &wv;
+    req.nodesToWriteSize = 1;
+    return sendAsync(&req,
+                     &UA_TYPES[UA_TYPES_WRITEREQUEST],
+                     &UA_TYPES[UA_TYPES_WRITERESPONSE],
+                     [done](UA_StatusCode s, void* response) {
+                         UA_WriteResponse* r = static_cast<UA_WriteResponse*>(response);
+                         if (s == UA_STATUSCODE_GOOD)
+                             s = (r->resultsSize == 1) ? r->results[0] : UA_STATUSCODE_BADUNEXPECTEDERROR;
+                         if (done)
+                             done(s);
+                     });
+}
+
+/*!
+    \brief Open62541::Client::writeValueAsync
+    \param nodeId
+    \param value
+    \return future write status
+*/
+std::future<UA_StatusCode> Open62541::Client::writeValueAsync(const NodeId& nodeId, const Variant& value)
+{
+    auto p = std::make_shared<std::promise<UA_StatusCode>>();
+    std::future<UA_StatusCode> f = p->get_future();
+    if (!writeValueAsync(nodeId, value, [p](UA_StatusCode s) { p->set_value(s); })) {
+        p->set_value(_lastError);
+    }
+    return f;
+}
+
+/*!
+    \brief Open62541::Client::callMethodAsync
+    \param objectId
+    \param methodId
+    \param in
+    \param done
+    \return true if sent
+*/
+bool Open62541::Client::callMethodAsync(const NodeId& objectId,
+                                        const NodeId& methodId,
+                                        const VariantList& in,
+                                        std::function<void(UA_StatusCode, VariantCallResult&)> done)
+{
+    UA_CallMethodRequest item;
+    UA_CallMethodRequest_init(&item);
+    item.objectId            = *objectId.constRef();  // shallow - encoded before sendAsync returns
+    item.methodId            = *methodId.constRef();
+    item.inputArguments      = const_cast<UA_Variant*>(in.data());
+    item.inputArgumentsSize  = in.size();
+    UA_CallRequest req;
+    UA_CallRequest_init(&req);
+    req.methodsToCall     = &item;
+    req.methodsToCallSize = 1;
+    return sendAsync(&req,
+                     &UA_TYPES[UA_TYPES_CALLREQUEST],
+                     &UA_TYPES[UA_TYPES_CALLRESPONSE],
+                     [done](UA_StatusCode s, void* response) {
+                         VariantCallResult out;
+                         UA_CallResponse* r = static_cast<UA_CallResponse*>(response);
+                         if (s == UA_STATUSCODE_GOOD) {
+                             if (r->resultsSize == 1) {
+                                 UA_CallMethodResult& m = r->results[0];
+                                 s                      = m.statusCode;
+                                 // take the output arguments - the response no longer owns them
+                                 out.set(m.outputArguments, m.outputArgumentsSize);
+                                 m.outputArguments     = nullptr;
+                                 m.outputArgumentsSize = 0;
+                             }
+                             else {
+                                 s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+                             }
+                         }
+                         if (done)
+                             done(s, out);
+                     });
+}
+
+namespace Open62541 {
+/*!
+    \brief The HistoryReadRawState struct
+    Carried across the continuation point round trips of one historyReadRawAsync
+*/
+struct HistoryReadRawState {
+    Client* client = nullptr;
+    NodeId node;
+    UA_ReadRawModifiedDetails details;
+    UA_TimestampsToReturn timestamps = UA_TIMESTAMPSTORETURN_BOTH;
+    std::vector<DataValue> values;
+    std::function<void(UA_StatusCode, std::vector<DataValue>&)> done;
+    static bool send(std::shared_ptr<HistoryReadRawState> st, const UA_ByteString& continuationPoint);
+};
+}  // namespace Open62541
+
+/*!
+    \brief Open62541::HistoryReadRawState::send
+    \param st
+    \param continuationPoint
+    \return true if sent
+*/
+bool Open62541::HistoryReadRawState::send(std::shared_ptr<HistoryReadRawState> st, const UA_ByteString& continuationPoint)
+{
+    UA_HistoryReadValueId item;
+    UA_HistoryReadValueId_init(&item);
+    item.nodeId            = *st->node.constRef();  // shallow - encoded before sendAsync returns
+    item.continuationPoint = continuationPoint;
+    UA_HistoryReadRequest req;
+    UA_HistoryReadRequest_init(&req);
+    req.historyReadDetails.encoding              = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    req.historyReadDetails.content.decoded.type  = &UA_TYPES[UA_TYPES_READRAWMODIFIEDDETAILS];
+    req.historyReadDetails.content.decoded.data  = &st->details;
+    req.timestampsToReturn                       = st->timestamps;
+    req.nodesToRead                              = &item;
+    req.nodesToReadSize                          = 1;
+    return st->client->sendAsync(&req,
+                                 &UA_TYPES[UA_TYPES_HISTORYREADREQUEST],
+                                 &UA_TYPES[UA_TYPES_HISTORYREADRESPONSE],
+                                 [st](UA_StatusCode s, void* response) {
+                                     UA_HistoryReadResponse* r = static_cast<UA_HistoryReadResponse*>(response);
+                                     if ((s == UA_STATUSCODE_GOOD) && (r->resultsSize != 1))
+                                         s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+                                     if (s == UA_STATUSCODE_GOOD) {
+                                         UA_HistoryReadResult& h = r->results[0];
+                                         s                       = h.statusCode;
+                                         const UA_ExtensionObject& e = h.historyData;
+                                         if ((UA_StatusCode_isBad(s) == false) &&
+                                             (e.encoding >= UA_EXTENSIONOBJECT_DECODED) &&
+                                             (e.content.decoded.type == &UA_TYPES[UA_TYPES_HISTORYDATA])) {
+                                             UA_HistoryData* d = static_cast<UA_HistoryData*>(e.content.decoded.data);
+                                             size_t base       = st->values.size();
+                                             st->values.resize(base + d->dataValuesSize);
+                                             for (size_t i = 0; i < d->dataValuesSize; i++)
+                                                 st->values[base + i].adopt(d->dataValues[i]);
+                                         }
+                                         if (!UA_StatusCode_isBad(s) && (h.continuationPoint.length > 0)) {
+                                             if (send(st, h.continuationPoint))
+                                                 return;  // more to come
+                                             s = st->client->lastError();
+                                         }
+                                     }
+                                     if (st->done)
+                                         st->done(s, st->values);
+                                 });
+}
+
+/*!
+    \brief Open62541::Client::historyReadRawAsync
+    \param n
+    \param startTime
+    \param endTime
+    \param numValuesPerNode
+    \param done
+    \param returnBounds
+    \param timestampsToReturn
+    \return true if sent
+*/
+bool Open62541::Client::historyReadRawAsync(const NodeId& n,
+                                            UA_DateTime startTime,
+                                            UA_DateTime endTime,
+                                            unsigned numValuesPerNode,
+                                            std::function<void(UA_StatusCode, std::vector<DataValue>&)> done,
+                                            bool returnBounds,
+                                            UA_TimestampsToReturn timestampsToReturn)
+{
+    auto st    = std::make_shared<HistoryReadRawState>();
+    st->client = this;
+    st->node   = n;
+    UA_ReadRawModifiedDetails_init(&st->details);
+    st->details.startTime        = startTime;
+    st->details.endTime          = endTime;
+    st->details.isReadModified   = false;
+    st->details.numValuesPerNode = (UA_UInt32)numValuesPerNode;
+    st->details.returnBounds     = returnBounds ? UA_TRUE : UA_FALSE;
+    st->timestamps               = timestampsToReturn;
+    st->done                     = std::move(done);
+    return HistoryReadRawState::send(st, UA_BYTESTRING_NULL);
+}
+
+/*!
+    \brief Open62541::Client::historyUpdate
+    \param n
+    \param performInsertReplace
+    \param values
+    \param batchSize
+    \param results
+    \return true if every request was serviced
+*/
+bool Open62541::Client::historyUpdate(const NodeId& n,
+                                      UA_PerformUpdateType performInsertReplace,
+                                      const std::vector<DataValue>& values,
+                                      size_t batchSize,
+                                      std::vector<UA_StatusCode>* results)
+{
+    if (!_client) {
+        _lastError = UA_STATUSCODE_BADCONNECTIONCLOSED;
+        return false;
+    }
+    if (results)
+        results->assign(values.size(), UA_STATUSCODE_GOOD);
+    if (values.empty()) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    if (!batchSize)
+        batchSize = values.size();
+    //
+    // time order so the server side merges a contiguous run - the order is kept to map the results back
+    std::vector<size_t> order(values.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&values](size_t a, size_t b) {
+        return values[a].constRef()->sourceTimestamp < values[b].constRef()->sourceTimestamp;
+    });
+    std::vector<UA_DataValue> batch;  // shallow copies - the request is encoded before the call returns
+    batch.reserve(std::min(batchSize, values.size()));
+    _lastError = UA_STATUSCODE_GOOD;
+    for (size_t first = 0; first < order.size(); first += batchSize) {
+        size_t last = std::min(first + batchSize, order.size());
+        batch.clear();
+        for (size_t i = first; i < last; i++)
+            batch.push_back(*values[order[i]].constRef());
+        UA_UpdateDataDetails details;
+        UA_UpdateDataDetails_init(&details);
+        details.nodeId               = *n.constRef();
+        details.performInsertReplace = performInsertReplace;
+        details.updateValuesSize     = batch.size();
+        details.updateValues         = batch.data();
+        UA_HistoryUpdateRequest request;
+        UA_HistoryUpdateRequest_init(&request);
+        UA_ExtensionObject item;
+        item.encoding                    = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+        item.content.decoded.type        = &UA_TYPES[UA_TYPES_UPDATEDATADETAILS];
+        item.content.decoded.data        = &details;
+        request.historyUpdateDetailsSize = 1;
+        request.historyUpdateDetails     = &item;
+        UA_HistoryUpdateResponse response = UA_Client_Service_historyUpdate(_client, request);
+        UA_StatusCode s                   = response.responseHeader.serviceResult;
+        if ((s == UA_STATUSCODE_GOOD) && (response.resultsSize != 1))
+            s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+        if (s == UA_STATUSCODE_GOOD)
+            s = response.results[0].statusCode;
+        if (results) {
+            for (size_t i = first; i < last; i++) {
+                size_t k = i - first;
+                if (s != UA_STATUSCODE_GOOD)
+                    (*results)[order[i]] = s;
+                else if (k < response.results[0].operationResultsSize)
+                    (*results)[order[i]] = response.results[0].operationResults[k];
+            }
+        }
+        UA_HistoryUpdateResponse_clear(&response);
+        if (s != UA_STATUSCODE_GOOD)
+            _lastError = s;
+    }
+    return lastOK();
+}
+
 /*!
  * \brief Open62541::Client::stateCallback
  * \param client
@@ -63,45 +465,214 @@ void Open62541::Client::stateCallback(UA_Client* client,
 }
 
 /*!
-    \brief Open62541::Client::deleteTree
-    \param nodeId
-    \return
+    \brief Open62541::Client::deleteTrees
+    \param roots
+    \return true if every node was deleted
 */
-bool Open62541::Client::deleteTree(NodeId& nodeId)
+bool Open62541::Client::deleteTrees(const std::vector<NodeId>& roots)
 {
-    if (_client) {
-        NodeIdMap m;
-        browseTree(nodeId, m);
-        for (auto i = m.begin(); i != m.end(); i++) {
-            UA_NodeId& ni = i->second;
-            if (ni.namespaceIndex > 0) {  // namespace 0 appears to be reserved
-                WriteLock l(_mutex);
-                UA_Client_deleteNode(_client, i->second, true);
-            }
+    if (!_client)
+        return false;
+    _lastError = UA_STATUSCODE_GOOD;
+    NodeIdSet batch;
+    std::vector<std::pair<NodeId, size_t>> nodes;  // and depth
+    for (const NodeId& root : roots) {
+        if ((root.nameSpaceIndex() == 0) || !batch.put(root.get()))  // namespace 0 is reserved
+            continue;
+        nodes.emplace_back(root, 0);
+        BrowseOptions o;
+        o.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+        o.nameSpace       = root.nameSpaceIndex();
+        browseVisit(
+            root,
+            [&batch, &nodes](const UA_ReferenceDescription& r, const UA_NodeId&, size_t depth) {
+                if (!batch.put(r.nodeId.nodeId))
+                    return BrowseSkipChildren;  // under another root
+                nodes.emplace_back(NodeId(r.nodeId.nodeId), depth);
+                return BrowseContinue;
+            },
+            o);
+        if (!lastOK())
+            return false;
+    }
+    // children first - a node is never deleted before its descendants
+    typedef std::pair<NodeId, size_t> Item;
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Item& a, const Item& b) { return a.second > b.second; });
+    //
+    const size_t batchSize = 1000;
+    std::vector<UA_DeleteNodesItem> items(std::min(batchSize, nodes.size()));
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    UA_DeleteNodesRequest req;
+    UA_DeleteNodesRequest_init(&req);
+    for (size_t offset = 0; offset < nodes.size(); offset += batchSize) {
+        const size_t n = std::min(batchSize, nodes.size() - offset);
+        for (size_t i = 0; i < n; i++) {
+            UA_DeleteNodesItem_init(&items[i]);
+            items[i].nodeId                 = nodes[offset + i].first.get();  // shallow - only encoded
+            items[i].deleteTargetReferences = UA_TRUE;
+        }
+        req.nodesToDelete     = items.data();
+        req.nodesToDeleteSize = n;
+        UA_DeleteNodesResponse resp;
+        {
+            WriteLock l(_mutex);
+            resp = UA_Client_Service_deleteNodes(_client, req);
+        }
+        UA_StatusCode s = resp.responseHeader.serviceResult;
+        for (size_t i = 0; (s == UA_STATUSCODE_GOOD) && (i < resp.resultsSize); i++) {
+            if ((first == UA_STATUSCODE_GOOD) && (resp.results[i] != UA_STATUSCODE_GOOD))
+                first = resp.results[i];
+        }
+        UA_DeleteNodesResponse_clear(&resp);
+        if (s != UA_STATUSCODE_GOOD) {
+            first = s;
+            break;
         }
     }
+    _pathCache.clear();
+    if (_browseCache)
+        _browseCache->invalidateAll();  // the subtrees and every reference into them
+    _lastError = first;
     return lastOK();
 }
 
 /*!
-    \brief browseTreeCallBack
-    \param childId
-    \param isInverse
-    \param referenceTypeId
-    \param handle
-    \return
+    \brief Open62541::Client::browseVisit
+    \param start
+    \param visit
+    \param options
+    \return true on success
 */
-
-static UA_StatusCode browseTreeCallBack(UA_NodeId childId,
-                                        UA_Boolean isInverse,
-                                        UA_NodeId /*referenceTypeId*/,
-                                        void* handle)
+bool Open62541::Client::browseVisit(const NodeId& start, BrowseVisitor visit, const BrowseOptions& options)
 {
-    if (!isInverse) {  // not a parent node - only browse forward
-        Open62541::UANodeIdList* pl = (Open62541::UANodeIdList*)handle;
-        pl->put(childId);
+    if (!_client || !visit)
+        return false;
+    NodeIdSet visited;  // the address space is a graph - visit each node once
+    visited.put(start);
+    std::vector<std::pair<NodeId, size_t>> stack;  // explicit stack - no recursion
+    stack.emplace_back(start, 0);
+    //
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = options.referenceTypeId;  // shallow
+    bd.includeSubtypes = options.includeSubtypes;
+    bd.nodeClassMask   = options.nodeClassMask;
+    bd.resultMask      = UA_BROWSERESULTMASK_ALL;  // browse names come back with the references
+    //
+    UA_BrowseRequest request;
+    UA_BrowseRequest_init(&request);
+    request.requestedMaxReferencesPerNode = options.maxReferences;
+    request.nodesToBrowse                 = &bd;  // shallow - never cleared
+    request.nodesToBrowseSize             = 1;
+    //
+    _lastError   = UA_STATUSCODE_GOOD;
+    bool running = true;
+    // pass one node's references to the visitor - a page from the server or all of them from the cache
+    auto visitReferences = [&](const UA_ReferenceDescription* references, size_t n, size_t depth) {
+        for (size_t i = 0; running && (i < n); i++) {
+            const UA_ReferenceDescription& rd = references[i];
+            const UA_NodeId& child            = rd.nodeId.nodeId;
+            if ((rd.nodeId.serverIndex != 0) || !options.accept(child) || !visited.put(child))
+                continue;
+            switch (visit(rd, bd.nodeId, depth)) {
+                case BrowseStop:
+                    running = false;
+                    break;
+                case BrowseContinue:
+                    if ((options.maxDepth == 0) || (depth < options.maxDepth)) {
+                        stack.emplace_back(NodeId(child), depth);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    };
+    BrowseCache* cache = _browseCache;
+    std::vector<UA_ReferenceDescription> all;  // every page of a node - only gathered for the cache
+    while (running && !stack.empty()) {
+        std::pair<NodeId, size_t> item = std::move(stack.back());
+        stack.pop_back();
+        const size_t depth = item.second + 1;
+        bd.nodeId          = item.first.get();  // shallow
+        //
+        BrowseCache::ResultRef cached = cache ? cache->find(bd) : BrowseCache::ResultRef();
+        if (cached) {
+            visitReferences(cached->references.data(), cached->references.size(), depth);
+            continue;
+        }
+        UA_BrowseResult r;
+        UA_BrowseResult_init(&r);
+        {
+            WriteLock l(_mutex);
+            TrafficRecorder::Scope trace(recorder(),
+                                         TrafficRecorder::Browse,
+                                         &request,
+                                         &UA_TYPES[UA_TYPES_BROWSEREQUEST]);
+            UA_BrowseResponse response = UA_Client_Service_browse(_client, request);
+            _lastError                 = response.responseHeader.serviceResult;
+            trace.done(_lastError);
+            if ((_lastError == UA_STATUSCODE_GOOD) && (response.resultsSize == 1)) {
+                r = response.results[0];  // take the result
+                UA_BrowseResult_init(&response.results[0]);
+            }
+            UA_BrowseResponse_clear(&response);
+        }
+        if (_lastError != UA_STATUSCODE_GOOD)
+            break;
+        bool complete = false;
+        for (;;) {
+            if (r.statusCode != UA_STATUSCODE_GOOD) {
+                _lastError = r.statusCode;
+                break;
+            }
+            // stream the references as they arrive
+            visitReferences(r.references, r.referencesSize, depth);
+            if (cache && (r.referencesSize > 0)) {
+                all.insert(all.end(), r.references, r.references + r.referencesSize);  // take the members
+                UA_free(r.references);
+                r.references     = nullptr;
+                r.referencesSize = 0;
+            }
+            if (r.continuationPoint.length == 0) {
+                complete = true;
+                break;
+            }
+            // more references - fetch them or release the continuation point if stopping
+            UA_BrowseNextRequest next;
+            UA_BrowseNextRequest_init(&next);
+            next.releaseContinuationPoints = running ? UA_FALSE : UA_TRUE;
+            next.continuationPoints        = &r.continuationPoint;  // shallow
+            next.continuationPointsSize    = 1;
+            UA_BrowseResult nr;
+            UA_BrowseResult_init(&nr);
+            {
+                WriteLock l(_mutex);
+                UA_BrowseNextResponse response = UA_Client_Service_browseNext(_client, next);
+                _lastError                     = response.responseHeader.serviceResult;
+                if ((_lastError == UA_STATUSCODE_GOOD) && (response.resultsSize == 1)) {
+                    nr = response.results[0];
+                    UA_BrowseResult_init(&response.results[0]);
+                }
+                UA_BrowseNextResponse_clear(&response);
+            }
+            UA_BrowseResult_clear(&r);
+            r = nr;
+            if (!running || (_lastError != UA_STATUSCODE_GOOD))
+                break;
+        }
+        UA_BrowseResult_clear(&r);
+        if (cache) {
+            if (complete)
+                cache->put(bd, all);  // takes them - the visitor may have stopped but every page has come
+            for (auto& rd : all) {
+                UA_ReferenceDescription_clear(&rd);
+            }
+            all.clear();
+        }
     }
-    return UA_STATUSCODE_GOOD;
+    return lastOK();
 }
 
 /*!
@@ -112,21 +683,18 @@ static UA_StatusCode browseTreeCallBack(UA_NodeId childId,
 */
 bool Open62541::Client::browseChildren(UA_NodeId& nodeId, NodeIdMap& m)
 {
-    Open62541::UANodeIdList l;
-    {
-        WriteLock ll(mutex());
-        UA_Client_forEachChildNodeCall(_client, nodeId, browseTreeCallBack, &l);  // get the childlist
-    }
-    for (int i = 0; i < int(l.size()); i++) {
-        if (l[i].namespaceIndex == nodeId.namespaceIndex) {  // only in same namespace
-            std::string s = Open62541::toString(l[i]);
-            if (m.find(s) == m.end()) {
-                m.put(l[i]);
-                browseChildren(l[i], m);  // recurse no duplicates
-            }
-        }
-    }
-    return lastOK();
+    BrowseOptions o;
+    o.nameSpace = nodeId.namespaceIndex;  // only in same namespace
+    return browseVisit(
+        NodeId(nodeId),
+        [&m](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            const std::string s = Open62541::toString(r.nodeId.nodeId);
+            if (m.find(s) != m.end())
+                return BrowseSkipChildren;
+            m.put(r.nodeId.nodeId);
+            return BrowseContinue;
+        },
+        o);
 }
 
 /*!
@@ -151,34 +719,27 @@ bool Open62541::Client::browseTree(Open62541::NodeId& nodeId, Open62541::UANodeT
 bool Open62541::Client::browseTree(UA_NodeId& nodeId, Open62541::UANode* node)
 {
     // form a heirachical tree of nodes
-    if (_client) {
-        Open62541::UANodeIdList l;
-        {
-            WriteLock ll(mutex());
-            UA_Client_forEachChildNodeCall(_client, nodeId, browseTreeCallBack, &l);  // get the childlist
-        }
-        for (int i = 0; i < int(l.size()); i++) {
-            if (l[i].namespaceIndex > 0) {
-                QualifiedName outBrowseName;
-                {
-                    WriteLock ll(mutex());
-                    _lastError = __UA_Client_readAttribute(_client,
-                                                           &l[i],
-                                                           UA_ATTRIBUTEID_BROWSENAME,
-                                                           outBrowseName,
-                                                           &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
-                }
-                if (lastOK()) {
-                    std::string s = toString(outBrowseName.get().name);  // get the browse name and leaf key
-                    NodeId nId    = l[i];                                // deep copy
-                    UANode* n     = node->createChild(s);                // create the node
-                    n->setData(nId);
-                    browseTree(l[i], n);
-                }
-            }
-        }
-    }
-    return lastOK();
+    if (!_client || !node)
+        return false;
+    BrowseOptions o;
+    o.minNameSpace = 1;
+    UnorderedNodeIdMap<UANode*> parents;  // tree node for each node id added
+    parents.put(nodeId, node);
+    return browseVisit(
+        NodeId(nodeId),
+        [&parents](const UA_ReferenceDescription& r, const UA_NodeId& parent, size_t) {
+            UANode** p = parents.value(parent);
+            if (!p)
+                return BrowseSkipChildren;
+            std::string s = toString(r.browseName.name);  // get the browse name and leaf key
+            UANode* n     = (*p)->createChild(s);         // create the node
+            NodeId nId;
+            nId = r.nodeId.nodeId;  // deep copy
+            n->setData(nId);
+            parents.put(r.nodeId.nodeId, n);
+            return BrowseContinue;
+        },
+        o);
 }
 
 /*!
@@ -193,6 +754,36 @@ bool Open62541::Client::browseTree(NodeId& nodeId, NodeIdMap& m)
     return browseChildren(nodeId, m);
 }
 
+/*!
+    \brief Open62541::Client::browseChildren
+    \param nodeId
+    \param m
+    \return
+*/
+bool Open62541::Client::browseChildren(UA_NodeId& nodeId, NodeIdSet& m)
+{
+    BrowseOptions o;
+    o.nameSpace = nodeId.namespaceIndex;  // only in same namespace
+    return browseVisit(
+        NodeId(nodeId),
+        [&m](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            return m.put(r.nodeId.nodeId) ? BrowseContinue : BrowseSkipChildren;
+        },
+        o);
+}
+
+/*!
+    \brief Open62541::Client::browseTree
+    \param nodeId
+    \param m
+    \return
+*/
+bool Open62541::Client::browseTree(NodeId& nodeId, NodeIdSet& m)
+{
+    m.put(nodeId);
+    return browseChildren(nodeId, m);
+}
+
 /*!
     \brief Open62541::Client::getEndpoints
     \param serverUrl
@@ -201,6 +792,16 @@ bool Open62541::Client::browseTree(NodeId& nodeId, NodeIdMap& m)
 */
 UA_StatusCode Open62541::Client::getEndpoints(const std::string& serverUrl, std::vector<std::string>& list)
 {
+    if (_discovery) {
+        EndpointDescriptionArray a;
+        _lastError = _discovery->getEndpoints(serverUrl, a);
+        if (lastOK()) {
+            for (size_t i = 0; i < a.length(); i++) {
+                list.push_back(toString(a.at(i).endpointUrl));
+            }
+        }
+        return _lastError;
+    }
     if (_client) {
         UA_EndpointDescription* endpointDescriptions = nullptr;
         size_t endpointDescriptionsSize              = 0;
@@ -231,23 +832,21 @@ UA_StatusCode Open62541::Client::getEndpoints(const std::string& serverUrl, std:
 */
 bool Open62541::Client::nodeIdFromPath(NodeId& start, Path& path, NodeId& nodeId)
 {
-    // nodeId is a shallow copy - do not delete and is volatile
-    UA_NodeId n = start.get();
-
+    nodeId    = start;
     int level = 0;
     if (path.size() > 0) {
+        level = int(_pathCache.find(start, path, nodeId));  // skip the longest known prefix
         Open62541::ClientBrowser b(*this);
         while (level < int(path.size())) {
-            b.browse(n);
+            b.browse(nodeId);
             auto i = b.find(path[level]);
             if (i == b.list().end())
                 return false;
             level++;
-            n = (*i).childId;
+            nodeId = (*i).childId;  // deep copy
+            _pathCache.put(start, path, level, nodeId);
         }
     }
-
-    nodeId = n;  // deep copy
     return level == int(path.size());
 }
 
@@ -264,25 +863,23 @@ bool Open62541::Client::createFolderPath(NodeId& start, Path& path, int nameSpac
     //
     // create folder path first then add varaibles to path's end leaf
     //
-    UA_NodeId n = start.get();
+    nodeId = start;
     //
     int level = 0;
     if (path.size() > 0) {
+        level = int(_pathCache.find(start, path, nodeId));  // skip the longest known prefix
         Open62541::ClientBrowser b(*this);
         while (level < int(path.size())) {
-            b.browse(n);
+            b.browse(nodeId);
             auto i = b.find(path[level]);
             if (i == b.list().end())
                 break;
             level++;
-            n = (*i).childId;  // shallow copy
+            nodeId = (*i).childId;  // deep copy
+            _pathCache.put(start, path, level, nodeId);
         }
-        if (level == int(path.size())) {
-            nodeId = n;
-        }
-        else {
+        if (level < int(path.size())) {
             NodeId nf(nameSpaceIndex, 0);  // auto generate NODE id
-            nodeId = n;
             NodeId newNode;
             while (level < int(path.size())) {
                 addFolder(nodeId, path[level], nf, newNode.notNull(), nameSpaceIndex);
@@ -291,6 +888,7 @@ bool Open62541::Client::createFolderPath(NodeId& start, Path& path, int nameSpac
                 }
                 nodeId = newNode;  // assign
                 level++;
+                _pathCache.put(start, path, level, nodeId);
             }
         }
     }
@@ -344,6 +942,7 @@ bool Open62541::Client::addFolder(NodeId& parent,
                                          attr.get(),
                                          newNode.isNull() ? nullptr : newNode.ref());
 
+    browseChanged(parent);
     return lastOK();
 }
 
@@ -380,6 +979,7 @@ bool Open62541::Client::addVariable(NodeId& parent,
                                            var_attr,
                                            newNode.isNull() ? nullptr : newNode.ref());
 
+    browseChanged(parent);
     return lastOK();
 }
 
@@ -417,9 +1017,61 @@ bool Open62541::Client::addProperty(NodeId& parent,
                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),  // no variable type
                                            var_attr,
                                            newNode.isNull() ? nullptr : newNode.ref());
+    browseChanged(parent);
     return lastOK();
 }
 
+/*!
+    \brief Open62541::Client::renewalPeriod
+    \return interval between renewals in UA_DateTime units - 0 if unknown
+*/
+UA_DateTime Open62541::Client::renewalPeriod() const
+{
+    if (!_client)
+        return 0;
+    const UA_ClientConfig* config = UA_Client_getConfig(_client);
+    return config ? UA_DateTime(config->secureChannelLifeTime) * UA_DATETIME_MSEC * 3 / 4 : 0;
+}
+
+/*!
+    \brief Open62541::Client::renewingIterate
+    The stack checks the renewal point at the start of an iteration and sends the request there, so this
+    iteration carries the cost - signing and encrypting the open request on a secured channel
+    \param interval
+*/
+void Open62541::Client::renewingIterate(uint32_t interval)
+{
+    const Metrics::Clock::time_point start = Metrics::Clock::now();
+    _lastError                             = UA_Client_run_iterate(_client, interval);
+    const UA_UInt64 ns =
+        UA_UInt64(std::chrono::duration_cast<std::chrono::nanoseconds>(Metrics::Clock::now() - start).count());
+    const UA_DateTime now = UA_DateTime_nowMonotonic();
+    if (_nextRenewal) {  // still open - the next renewal follows the response, estimate it from now
+        _nextRenewal = now + renewalPeriod();
+        _lastRenewal = now;
+    }
+    _lastRenewalNs = ns;
+    _renewals++;
+    if (Metrics::enabled())
+        Metrics::record(Metrics::ChannelRenewal, ns);
+}
+
+/*!
+    \brief Open62541::Client::renewing
+    \param ms
+    \return true if a request sent now may wait on a renewal
+*/
+bool Open62541::Client::renewing(UA_UInt32 ms) const
+{
+    const UA_DateTime next = _nextRenewal;
+    if (!next)
+        return false;
+    const UA_DateTime now    = UA_DateTime_nowMonotonic();
+    const UA_DateTime window = UA_DateTime(ms) * UA_DATETIME_MSEC;
+    const UA_DateTime last   = _lastRenewal;
+    return ((next - now) <= window) || (last && ((now - last) <= window));
+}
+
 /*!
  * \brief Open62541::Client::stateChange
  * \param channelState
@@ -435,8 +1087,21 @@ void Open62541::Client::stateChange(UA_SecureChannelState channelState,
     _sessionState  = sessionState;
     _connectStatus = connectStatus;
 
+    if (channelState != UA_SECURECHANNELSTATE_OPEN) {
+        _nextRenewal = 0;
+        _lastRenewal = 0;
+    }
+    else if (!_nextRenewal) {
+        const UA_DateTime period = renewalPeriod();  // a new channel - renewals are counted from now
+        if (period > 0)
+            _nextRenewal = UA_DateTime_nowMonotonic() + period;
+    }
+
     if (!connectStatus) {
         if (_lastSessionState != sessionState) {
+            if (_autoRecover && (_lastSessionState == UA_SESSIONSTATE_ACTIVATED)) {
+                suspendSubscriptions();  // session lost - keep the definitions for the next one
+            }
             switch (sessionState) {
                 case UA_SESSIONSTATE_CLOSED:
                     SessionStateClosed();
@@ -454,6 +1119,18 @@ void Open62541::Client::stateChange(UA_SecureChannelState channelState,
                     SessionStateActivateRequested();
                     break;
                 case UA_SESSIONSTATE_ACTIVATED:
+                    _limitsKnown = false;  // may be a different server - read the limits again
+                    {
+                        std::lock_guard<std::mutex> l(_namespaceMutex);
+                        _namespacesKnown = false;  // and the namespaces
+                    }
+                    _translateCache.clear();
+                    if (_browseCache)
+                        _browseCache->invalidateAll();  // changes made meanwhile were not seen
+                    if (!_suspended.empty())
+                        _recoverPending = true;  // recreated from runIterate
+                    if (registeredNodes())
+                        _reregisterPending = true;  // handles may differ in the new session
                     SessionStateActivated();
                     break;
                 case UA_SESSIONSTATE_CLOSING:
@@ -503,3 +1180,867 @@ void Open62541::Client::stateChange(UA_SecureChannelState channelState,
         connectFail();
     }
 }
+
+/*!
+    \brief Open62541::Client::operationLimits
+    \param maxRead
+    \param maxWrite
+    \param refresh
+*/
+void Open62541::Client::operationLimits(UA_UInt32& maxRead, UA_UInt32& maxWrite, bool refresh)
+{
+    if (_client && (refresh || !_limitsKnown)) {
+        const UA_UInt32 limitIds[3] = {UA_NS0ID_SERVER_SERVERCAPABILITIES_OPERATIONLIMITS_MAXNODESPERREAD,
+                                       UA_NS0ID_SERVER_SERVERCAPABILITIES_OPERATIONLIMITS_MAXNODESPERWRITE,
+                                       UA_NS0ID_SERVER_SERVERCAPABILITIES_OPERATIONLIMITS_MAXMONITOREDITEMSPERCALL};
+        UA_ReadValueId ids[3];
+        for (size_t i = 0; i < 3; i++) {
+            UA_ReadValueId_init(&ids[i]);
+            ids[i].nodeId      = UA_NODEID_NUMERIC(0, limitIds[i]);
+            ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        }
+        UA_ReadRequest req;
+        UA_ReadRequest_init(&req);
+        req.nodesToRead        = ids;
+        req.nodesToReadSize    = 3;
+        req.timestampsToReturn = UA_TIMESTAMPSTORETURN_NEITHER;
+        UA_UInt32 limits[3]    = {0, 0, 0};  // missing or unreadable means no limit
+        {
+            WriteLock l(_mutex);
+            UA_ReadResponse resp = UA_Client_Service_read(_client, req);
+            if ((resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) && (resp.resultsSize == 3)) {
+                for (size_t i = 0; i < 3; i++) {
+                    const UA_DataValue& dv = resp.results[i];
+                    if (dv.hasValue && UA_Variant_hasScalarType(&dv.value, &UA_TYPES[UA_TYPES_UINT32])) {
+                        limits[i] = *static_cast<UA_UInt32*>(dv.value.data);
+                    }
+                }
+                _limitsKnown = true;  // retry next time if the read itself failed
+            }
+            UA_ReadResponse_clear(&resp);
+            _maxNodesPerRead          = limits[0];
+            _maxNodesPerWrite         = limits[1];
+            _maxMonitoredItemsPerCall = limits[2];
+        }
+    }
+    maxRead  = _maxNodesPerRead;
+    maxWrite = _maxNodesPerWrite;
+}
+
+/*!
+    \brief batchSize
+    \param serverLimit
+    \param cap
+    \param n
+    \return number of nodes to put in each request
+*/
+static size_t batchSize(UA_UInt32 serverLimit, UA_UInt32 cap, size_t n)
+{
+    size_t b = n;
+    if ((serverLimit > 0) && (serverLimit < b))
+        b = serverLimit;
+    if ((cap > 0) && (cap < b))
+        b = cap;
+    return (b > 0) ? b : 1;
+}
+
+/*!
+    \brief Open62541::Client::readAttributes
+    \param nodesToRead
+    \param results
+    \param timestamps
+    \return true if all reads succeeded
+*/
+bool Open62541::Client::readAttributes(const std::vector<UA_ReadValueId>& nodesToRead,
+                                       std::vector<DataValue>& results,
+                                       UA_TimestampsToReturn timestamps)
+{
+    if (!_client)
+        return false;
+    results.resize(nodesToRead.size());  // existing entries are kept and reused
+    if (nodesToRead.empty()) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    UA_UInt32 maxRead  = 0;
+    UA_UInt32 maxWrite = 0;
+    operationLimits(maxRead, maxWrite);
+    const size_t batch = batchSize(maxRead, _maxBatch, nodesToRead.size());
+    // handles from registerNodes are sent as the ids of the current session
+    const UA_ReadValueId* ids = nodesToRead.data();
+    std::vector<UA_ReadValueId> translated;
+    std::vector<NodeId> current;
+    if (registeredNodes()) {
+        translated = nodesToRead;  // shallow
+        current.resize(nodesToRead.size());
+        for (size_t i = 0; i < nodesToRead.size(); i++) {
+            if (translate(nodesToRead[i].nodeId, current[i]))
+                translated[i].nodeId = *current[i].constRef();  // shallow
+        }
+        ids = translated.data();
+    }
+    //
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.timestampsToReturn = timestamps;
+    for (size_t offset = 0; offset < nodesToRead.size(); offset += batch) {
+        const size_t n = std::min(batch, nodesToRead.size() - offset);
+        // shallow - the request only borrows the caller's ReadValueIds and is never cleared
+        req.nodesToRead     = const_cast<UA_ReadValueId*>(ids + offset);
+        req.nodesToReadSize = n;
+        UA_ReadResponse resp;
+        {
+            WriteLock l(_mutex);
+            TrafficRecorder::Scope trace(recorder(), TrafficRecorder::Read, &req, &UA_TYPES[UA_TYPES_READREQUEST]);
+            resp = UA_Client_Service_read(_client, req);
+            trace.done(resp.responseHeader.serviceResult);
+        }
+        UA_StatusCode s = resp.responseHeader.serviceResult;
+        if ((s == UA_STATUSCODE_GOOD) && (resp.resultsSize != n))
+            s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+        if (s == UA_STATUSCODE_GOOD) {
+            for (size_t i = 0; i < n; i++) {
+                results[offset + i].adopt(resp.results[i]);  // steals the value - nothing is copied
+                if ((first == UA_STATUSCODE_GOOD) && (results[offset + i].status() != UA_STATUSCODE_GOOD))
+                    first = results[offset + i].status();
+            }
+        }
+        UA_ReadResponse_clear(&resp);
+        if (s != UA_STATUSCODE_GOOD) {
+            // the service failed for the whole chunk - mark the rest so callers can see where it stopped
+            for (size_t i = offset; i < results.size(); i++) {
+                results[i].null();
+                results[i].ref()->hasStatus = true;
+                results[i].ref()->status    = s;
+            }
+            _lastError = s;
+            return false;
+        }
+    }
+    _lastError = first;
+    return first == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::Client::readAttributes
+    \param nodeIds
+    \param attributeId
+    \param results
+    \return true if all reads succeeded
+*/
+bool Open62541::Client::readAttributes(const std::vector<NodeId>& nodeIds,
+                                       UA_AttributeId attributeId,
+                                       std::vector<DataValue>& results)
+{
+    std::vector<UA_ReadValueId> ids(nodeIds.size());
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId      = *nodeIds[i].constRef();  // shallow - nodeIds outlives the read
+        ids[i].attributeId = attributeId;
+    }
+    return readAttributes(ids, results, UA_TIMESTAMPSTORETURN_NEITHER);
+}
+
+/*!
+    \brief Open62541::Client::readValues
+    \param nodeIds
+    \param results
+    \param timestamps
+    \return true if all reads succeeded
+*/
+bool Open62541::Client::readValues(const std::vector<NodeId>& nodeIds,
+                                   std::vector<DataValue>& results,
+                                   UA_TimestampsToReturn timestamps)
+{
+    std::vector<UA_ReadValueId> ids(nodeIds.size());
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId      = *nodeIds[i].constRef();
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    return readAttributes(ids, results, timestamps);
+}
+
+/*!
+    \brief Open62541::Client::writeValues
+    \param nodeIds
+    \param values
+    \param results
+    \return true if all writes succeeded
+*/
+bool Open62541::Client::writeValues(const std::vector<NodeId>& nodeIds,
+                                    const std::vector<Variant>& values,
+                                    std::vector<UA_StatusCode>& results)
+{
+    if (!_client)
+        return false;
+    if (nodeIds.size() != values.size()) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    results.assign(nodeIds.size(), UA_STATUSCODE_GOOD);
+    if (nodeIds.empty()) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    UA_UInt32 maxRead  = 0;
+    UA_UInt32 maxWrite = 0;
+    operationLimits(maxRead, maxWrite);
+    const size_t batch = batchSize(maxWrite, _maxBatch, nodeIds.size());
+    //
+    std::vector<UA_WriteValue> wv(batch);
+    std::vector<NodeId> current(batch);  // ids of registered handles
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    for (size_t offset = 0; offset < nodeIds.size(); offset += batch) {
+        const size_t n = std::min(batch, nodeIds.size() - offset);
+        for (size_t i = 0; i < n; i++) {
+            // shallow copies - the request is encoded, not kept, and never cleared
+            UA_WriteValue_init(&wv[i]);
+            const NodeId& n      = nodeIds[offset + i];
+            wv[i].nodeId         = *(translate(n, current[i]) ? current[i] : n).constRef();
+            wv[i].attributeId    = UA_ATTRIBUTEID_VALUE;
+            wv[i].value.hasValue = true;
+            wv[i].value.value    = *values[offset + i].constRef();
+        }
+        req.nodesToWrite     = wv.data();
+        req.nodesToWriteSize = n;
+        UA_WriteResponse resp;
+        {
+            WriteLock l(_mutex);
+            TrafficRecorder::Scope trace(recorder(), TrafficRecorder::Write, &req, &UA_TYPES[UA_TYPES_WRITEREQUEST]);
+            resp = UA_Client_Service_write(_client, req);
+            trace.done(resp.responseHeader.serviceResult);
+        }
+        UA_StatusCode s = resp.responseHeader.serviceResult;
+        if ((s == UA_STATUSCODE_GOOD) && (resp.resultsSize != n))
+            s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+        if (s == UA_STATUSCODE_GOOD) {
+            for (size_t i = 0; i < n; i++) {
+                results[offset + i] = resp.results[i];
+                if ((first == UA_STATUSCODE_GOOD) && (resp.results[i] != UA_STATUSCODE_GOOD))
+                    first = resp.results[i];
+            }
+        }
+        UA_WriteResponse_clear(&resp);
+        if (s != UA_STATUSCODE_GOOD) {
+            std::fill(results.begin() + offset, results.end(), s);
+            _lastError = s;
+            return false;
+        }
+    }
+    _lastError = first;
+    return first == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::Client::namespaceArray
+    \param uris
+    \param refresh
+    \return true on success
+*/
+bool Open62541::Client::namespaceArray(std::vector<std::string>& uris, bool refresh)
+{
+    {
+        std::lock_guard<std::mutex> l(_namespaceMutex);
+        if (_namespacesKnown && !refresh) {
+            uris = _namespaces;
+            return true;
+        }
+    }
+    // read without the cache lock - it is never held across a service call
+    NodeId n(0, UA_NS0ID_SERVER_NAMESPACEARRAY);
+    Variant v;
+    if (!readAttribute(n.constRef(), UA_ATTRIBUTEID_VALUE, v.ref(), &UA_TYPES[UA_TYPES_VARIANT]))
+        return false;
+    if (v.constRef()->type != &UA_TYPES[UA_TYPES_STRING]) {
+        _lastError = UA_STATUSCODE_BADTYPEMISMATCH;
+        return false;
+    }
+    const UA_String* a = static_cast<const UA_String*>(v.constRef()->data);
+    uris.resize(v.constRef()->arrayLength);
+    for (size_t i = 0; i < uris.size(); i++) {
+        uris[i] = toString(a[i]);
+    }
+    std::lock_guard<std::mutex> l(_namespaceMutex);
+    _namespaces      = uris;
+    _namespacesKnown = true;
+    return true;
+}
+
+namespace {
+/*!
+    \brief qualifyPath
+    \param path elements - "<ns>:<name>" or a name in the default namespace
+    \param nameSpace default namespace
+    \param out elements in "<ns>:<name>" form
+*/
+void qualifyPath(const Open62541::Path& path, UA_UInt16 nameSpace, Open62541::Path& out)
+{
+    out.resize(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        const std::string& e = path[i];
+        const size_t c       = e.find(':');
+        if ((c != std::string::npos) && (c > 0) && (e.find_first_not_of("0123456789") == c))
+            out[i] = e;
+        else
+            out[i] = std::to_string(nameSpace) + ":" + e;
+    }
+}
+}  // namespace
+
+/*!
+    \brief Open62541::Client::translate
+    \param handle
+    \param current
+    \return true if the node is registered under another id
+*/
+bool Open62541::Client::translate(const UA_NodeId& handle, NodeId& current)
+{
+    std::shared_ptr<const RegisterIndex> m = registered();
+    if (m->empty())
+        return false;
+    auto i = m->find(handle);
+    if ((i == m->end()) || UA_NodeId_equal(i->second->current.constRef(), &handle))
+        return false;
+    current = i->second->current;
+    return true;
+}
+
+/*!
+    \brief Open62541::Client::registerNodes
+    \param nodes
+    \return true on success
+*/
+bool Open62541::Client::registerNodes(std::vector<NodeId>& nodes)
+{
+    if (!_client)
+        return false;
+    if (nodes.empty()) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    std::vector<UA_NodeId> ids(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        ids[i] = *nodes[i].constRef();  // shallow
+    }
+    UA_RegisterNodesRequest req;
+    UA_RegisterNodesRequest_init(&req);
+    req.nodesToRegister     = ids.data();
+    req.nodesToRegisterSize = ids.size();
+    UA_RegisterNodesResponse resp;
+    {
+        WriteLock l(_mutex);
+        resp = UA_Client_Service_registerNodes(_client, req);
+    }
+    UA_StatusCode s = resp.responseHeader.serviceResult;
+    if ((s == UA_STATUSCODE_GOOD) && (resp.registeredNodeIdsSize != nodes.size()))
+        s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (s == UA_STATUSCODE_GOOD) {
+        std::lock_guard<std::mutex> l(_registerMutex);
+        auto m = std::make_shared<RegisterIndex>(*registered());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto r     = std::make_shared<Registration>();
+            r->node    = nodes[i];
+            r->current = NodeId(resp.registeredNodeIds[i]);
+            m->erase(*nodes[i].constRef());  // the key points into the registration it replaces
+            m->emplace(*r->node.constRef(), r);
+        }
+        publishRegistered(m);
+    }
+    UA_RegisterNodesResponse_clear(&resp);
+    _lastError = s;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::Client::unregisterNodes
+    \param handles
+    \return true on success
+*/
+bool Open62541::Client::unregisterNodes(std::vector<NodeId>& handles)
+{
+    if (!_client)
+        return false;
+    if (handles.empty()) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    std::vector<NodeId> current(handles.size());
+    std::vector<UA_NodeId> ids(handles.size());
+    for (size_t i = 0; i < handles.size(); i++) {
+        ids[i] = *(translate(handles[i], current[i]) ? current[i] : handles[i]).constRef();  // shallow
+    }
+    UA_UnregisterNodesRequest req;
+    UA_UnregisterNodesRequest_init(&req);
+    req.nodesToUnregister     = ids.data();
+    req.nodesToUnregisterSize = ids.size();
+    UA_UnregisterNodesResponse resp;
+    {
+        WriteLock l(_mutex);
+        resp = UA_Client_Service_unregisterNodes(_client, req);
+    }
+    _lastError = resp.responseHeader.serviceResult;
+    UA_UnregisterNodesResponse_clear(&resp);
+    // forgotten even if the service failed - a lost session took the registrations with it
+    std::lock_guard<std::mutex> l(_registerMutex);
+    auto m = std::make_shared<RegisterIndex>(*registered());
+    for (auto& h : handles) {
+        m->erase(*h.constRef());
+    }
+    publishRegistered(m);
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::Client::reregisterNodes
+    \param lock
+    \return true on success
+*/
+bool Open62541::Client::reregisterNodes(bool lock)
+{
+    _reregisterPending = false;
+    if (!_client)
+        return false;
+    std::vector<RegistrationRef> regs;
+    for (auto& r : *registered()) {
+        regs.push_back(r.second);
+    }
+    _lastError = UA_STATUSCODE_GOOD;
+    if (regs.empty())
+        return true;
+    std::vector<UA_NodeId> ids(regs.size());
+    for (size_t i = 0; i < regs.size(); i++) {
+        ids[i] = *regs[i]->node.constRef();  // shallow - regs holds the registrations
+    }
+    UA_RegisterNodesRequest req;
+    UA_RegisterNodesRequest_init(&req);
+    req.nodesToRegister     = ids.data();
+    req.nodesToRegisterSize = ids.size();
+    UA_RegisterNodesResponse resp;
+    {
+        std::unique_ptr<WriteLock> l;
+        if (lock)
+            l.reset(new WriteLock(_mutex));
+        resp = UA_Client_Service_registerNodes(_client, req);
+    }
+    UA_StatusCode s = resp.responseHeader.serviceResult;
+    if ((s == UA_STATUSCODE_GOOD) && (resp.registeredNodeIdsSize != regs.size()))
+        s = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    if (s == UA_STATUSCODE_GOOD) {
+        std::lock_guard<std::mutex> l(_registerMutex);
+        auto m = std::make_shared<RegisterIndex>(*registered());
+        for (size_t i = 0; i < regs.size(); i++) {
+            auto j = m->find(*regs[i]->node.constRef());
+            if ((j == m->end()) || (j->second != regs[i]))
+                continue;  // unregistered or registered again meanwhile
+            auto r     = std::make_shared<Registration>();
+            r->node    = regs[i]->node;
+            r->current = NodeId(resp.registeredNodeIds[i]);
+            m->erase(j);
+            m->emplace(*r->node.constRef(), r);
+        }
+        publishRegistered(m);
+    }
+    UA_RegisterNodesResponse_clear(&resp);
+    _lastError = s;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::Client::suspendSubscriptions
+*/
+void Open62541::Client::suspendSubscriptions()
+{
+    ClientSubscriptionMap::MapRef current = _subscriptions.takeAll();
+    for (auto& i : *current) {
+        if (i.second) {
+            i.second->invalidate();  // the server side objects went with the session
+            _suspended.push_back(std::make_pair(i.first, i.second));
+        }
+    }
+    _recoverPending = !_suspended.empty();
+}
+
+/*!
+    \brief Open62541::Client::recoverSubscriptions
+    \param lock
+    \return true if all recovered
+*/
+bool Open62541::Client::recoverSubscriptions(bool lock)
+{
+    _recoverPending = false;
+    std::vector<std::pair<UA_UInt32, ClientSubscriptionRef>> pending;
+    pending.swap(_suspended);
+    for (auto& p : pending) {
+        ClientSubscriptionRef& s = p.second;
+        if (s->recover(lock)) {
+            _subscriptions.set(s->id(), s);
+            subscriptionRecovered(p.first, s->id());
+        }
+        else {
+            _suspended.push_back(p);  // try again on the next session or call again
+        }
+    }
+    return _suspended.empty();
+}
+
+namespace {
+/*!
+    \brief The ConnectionRegistry struct
+    Clients by the address of their logger - the only per client pointer the connection factory is given
+*/
+struct ConnectionRegistry {
+    std::mutex mutex;
+    std::map<const UA_Logger*, Open62541::Client*> clients;
+};
+
+ConnectionRegistry& connectionRegistry()
+{
+    static ConnectionRegistry r;
+    return r;
+}
+
+void unregisterConnection(Open62541::Client* c)
+{
+    ConnectionRegistry& r = connectionRegistry();
+    std::lock_guard<std::mutex> l(r.mutex);
+    for (auto i = r.clients.begin(); i != r.clients.end();) {
+        if (i->second == c)
+            i = r.clients.erase(i);
+        else
+            ++i;
+    }
+}
+}  // namespace
+
+/*!
+    \brief Open62541::Client::openWake
+*/
+void Open62541::Client::openWake()
+{
+    if (::pipe(_wakeFd) == 0) {
+        ::fcntl(_wakeFd[0], F_SETFL, ::fcntl(_wakeFd[0], F_GETFL) | O_NONBLOCK);
+        ::fcntl(_wakeFd[1], F_SETFL, ::fcntl(_wakeFd[1], F_GETFL) | O_NONBLOCK);
+    }
+    else {
+        _wakeFd[0] = _wakeFd[1] = -1;  // runWait falls back to the stack's own wait
+    }
+}
+
+/*!
+    \brief Open62541::Client::closeWake
+*/
+void Open62541::Client::closeWake()
+{
+    unregisterConnection(this);
+    for (int& fd : _wakeFd) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+}
+
+/*!
+    \brief Open62541::Client::wake
+*/
+void Open62541::Client::wake()
+{
+    if (_wakeFd[1] >= 0) {
+        const char b = 1;
+        (void)!::write(_wakeFd[1], &b, 1);  // a full pipe is already signalled
+    }
+}
+
+/*!
+    \brief Open62541::Client::drainWake
+*/
+void Open62541::Client::drainWake()
+{
+    char b[64];
+    while ((_wakeFd[0] >= 0) && (::read(_wakeFd[0], b, sizeof(b)) > 0)) {
+    }
+}
+
+/*!
+    \brief Open62541::Client::captureConnection
+*/
+void Open62541::Client::captureConnection()
+{
+    unregisterConnection(this);
+    _socketFd               = -1;
+    UA_ClientConfig* cfg    = UA_Client_getConfig(_client);
+    _initConnection         = cfg->initConnectionFunc;
+    cfg->initConnectionFunc = Client::initConnection;
+    ConnectionRegistry& r   = connectionRegistry();
+    std::lock_guard<std::mutex> l(r.mutex);
+    r.clients[&cfg->logger] = this;
+}
+
+/*!
+    \brief Open62541::Client::initConnection
+    Wraps the configured connection factory to note the socket of each new connection
+    \param config
+    \param endpointUrl
+    \param timeout
+    \param logger
+    \return the connection
+*/
+UA_Connection Open62541::Client::initConnection(UA_ConnectionConfig config,
+                                                UA_String endpointUrl,
+                                                UA_UInt32 timeout,
+                                                const UA_Logger* logger)
+{
+    Client* p = nullptr;
+    {
+        ConnectionRegistry& r = connectionRegistry();
+        std::lock_guard<std::mutex> l(r.mutex);
+        auto i = r.clients.find(logger);
+        if (i != r.clients.end())
+            p = i->second;
+    }
+    UA_ConnectClientConnection f = (p && p->_initConnection) ? p->_initConnection : UA_ClientConnectionTCP_init;
+    UA_Connection c              = f(config, endpointUrl, timeout, logger);
+    if (p)
+        p->_socketFd = int(c.sockfd);
+    return c;
+}
+
+/*!
+    \brief Open62541::Client::nextDeadline
+    \param capMs
+    \return
+*/
+unsigned Open62541::Client::nextDeadline(unsigned capMs) const
+{
+    if (_wheelCallbackId && _wheel.size())
+        capMs = std::min(capMs, std::max(_wheelTick, 1u));  // the wheel is driven by one repeated callback
+    const UA_DateTime now = UA_DateTime_nowMonotonic();
+    for (auto& i : _timerMap) {
+        const UA_DateTime d = i.second->due();
+        if (d == 0)
+            continue;
+        if (d <= now)
+            return 0;
+        capMs = unsigned(std::min<UA_DateTime>(capMs, (d - now + UA_DATETIME_MSEC - 1) / UA_DATETIME_MSEC));
+    }
+    return capMs;
+}
+
+/*!
+    \brief Open62541::Client::runCommands
+    \return
+*/
+size_t Open62541::Client::runCommands()
+{
+    size_t n = 0;
+    std::function<void(Client&)> f;
+    const size_t limit = _commands.capacity();  // commands that post more commands wait for the next pass
+    while ((n < limit) && _commands.pop(f)) {
+        if (f)
+            f(*this);
+        f = nullptr;
+        n++;
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::Client::runWait
+    \param maxWaitMs
+    \return
+*/
+bool Open62541::Client::runWait(unsigned maxWaitMs)
+{
+    if (!_client || (_connectStatus != UA_STATUSCODE_GOOD))
+        return false;
+    unsigned wait = nextDeadline(maxWaitMs ? maxWaitMs : _idleWaitMs);
+    if (!_commands.empty())
+        wait = 0;
+    if ((_socketFd >= 0) && (_wakeFd[0] >= 0) && (_channelState == UA_SECURECHANNELSTATE_OPEN)) {
+        if (wait) {
+            pollfd fds[2];
+            fds[0].fd      = _socketFd;
+            fds[0].events  = POLLIN;
+            fds[0].revents = 0;
+            fds[1].fd      = _wakeFd[0];
+            fds[1].events  = POLLIN;
+            fds[1].revents = 0;
+            ::poll(fds, 2, int(wait));
+        }
+        drainWake();
+        runCommands();
+        return runIterate(0);  // the socket is readable or a deadline has passed - nothing to wait for
+    }
+    // connecting, or a network layer without a socket - the stack waits, wake ups are seen on its return
+    drainWake();
+    runCommands();
+    return runIterate(std::min(wait, 100u));
+}
+
+/*!
+    \brief Open62541::Client::memoryReport
+    \param r
+*/
+void Open62541::Client::memoryReport(MemoryReport& r)
+{
+    size_t items                          = 0;
+    ClientSubscriptionMap::MapRef current = _subscriptions.snapshot();
+    for (const auto& s : *current) {
+        if (s.second)
+            items += s.second->monitoredItemCount();
+    }
+    r.add("subscriptions",
+          current->size() * (MemoryReport::MapNode + sizeof(UA_UInt32) + sizeof(ClientSubscriptionRef) +
+                             sizeof(ClientSubscription)),
+          current->size());
+    // map entry, shared_ptr control block and the item
+    r.add("monitoredItems",
+          items * (MemoryReport::MapNode + sizeof(unsigned) + sizeof(MonitoredItemRef) + 2 * sizeof(void*) +
+                   sizeof(MonitoredItemDataChange)),
+          items);
+    r.add("timers", _timerMap.size() * (MemoryReport::MapNode + sizeof(UA_UInt64) + sizeof(TimerPtr) + sizeof(Timer)),
+          _timerMap.size());
+    {
+        std::lock_guard<std::mutex> l(_asyncMutex);
+        r.add("asyncRequests",
+              _asyncHandlers.size() * (MemoryReport::MapNode + sizeof(UA_UInt32) + sizeof(AsyncHandler)),
+              _asyncHandlers.size());
+    }
+    // keys are the start node and the path - taken as 64 bytes
+    const size_t path = MemoryReport::HashNode + sizeof(std::string) + 64 + sizeof(NodeId);
+    r.add("pathCache", (_pathCache.size() + _translateCache.size()) * path,
+          _pathCache.size() + _translateCache.size());
+    {
+        std::shared_ptr<const RegisterIndex> m = registered();
+        size_t b                               = 0;
+        for (const auto& i : *m) {
+            b += MemoryReport::HashNode + sizeof(i) + sizeof(Registration) +
+                 MemoryReport::heapOf(*i.second->node.constRef()) +
+                 MemoryReport::heapOf(*i.second->current.constRef());  // the key points into node
+        }
+        r.add("registeredNodes", b, m->size());
+    }
+    r.add("commands", _commands.memoryUsage(), _commands.size());
+    //
+    std::vector<MemoryReport::Source> sources;
+    {
+        std::lock_guard<std::mutex> l(_memoryMutex);
+        for (const auto& i : _memorySources)
+            sources.push_back(i.second);
+    }
+    for (auto& f : sources) {
+        if (f)
+            f(r);
+    }
+}
+
+/*!
+    \brief Open62541::Client::addMemorySource
+    \param name
+    \param f
+*/
+void Open62541::Client::addMemorySource(const std::string& name, MemoryReport::Source f)
+{
+    std::lock_guard<std::mutex> l(_memoryMutex);
+    _memorySources[name] = f;
+}
+
+/*!
+    \brief Open62541::Client::removeMemorySource
+    \param name
+*/
+void Open62541::Client::removeMemorySource(const std::string& name)
+{
+    std::lock_guard<std::mutex> l(_memoryMutex);
+    _memorySources.erase(name);
+}
+
+/*!
+    \brief Open62541::Client::recordRead
+    \param r
+    \param start
+    \param nodeId
+    \param attributeId
+*/
+void Open62541::Client::recordRead(TrafficRecorder& r,
+                                   TrafficRecorder::Clock::time_point start,
+                                   const UA_NodeId& nodeId,
+                                   UA_AttributeId attributeId)
+{
+    // shallow - only encoded
+    UA_ReadValueId id;
+    UA_ReadValueId_init(&id);
+    id.nodeId      = nodeId;
+    id.attributeId = attributeId;
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead     = &id;
+    req.nodesToReadSize = 1;
+    r.request(TrafficRecorder::Read, &req, &UA_TYPES[UA_TYPES_READREQUEST], start, _lastError);
+}
+
+/*!
+    \brief Open62541::Client::recordWrite
+    \param r
+    \param start
+    \param nodeId
+    \param attributeId
+    \param in
+    \param inDataType
+*/
+void Open62541::Client::recordWrite(TrafficRecorder& r,
+                                    TrafficRecorder::Clock::time_point start,
+                                    const UA_NodeId& nodeId,
+                                    UA_AttributeId attributeId,
+                                    const void* in,
+                                    const UA_DataType* inDataType)
+{
+    // shallow - only encoded
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    wv.nodeId         = nodeId;
+    wv.attributeId    = attributeId;
+    wv.value.hasValue = true;
+    if (inDataType == &UA_TYPES[UA_TYPES_VARIANT]) {
+        wv.value.value = *static_cast<const UA_Variant*>(in);
+    }
+    else {
+        UA_Variant_setScalar(&wv.value.value, const_cast<void*>(in), inDataType);
+    }
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    req.nodesToWrite     = &wv;
+    req.nodesToWriteSize = 1;
+    r.request(TrafficRecorder::Write, &req, &UA_TYPES[UA_TYPES_WRITEREQUEST], start, _lastError);
+}
+
+/*!
+    \brief Open62541::Client::recordCall
+    \param r
+    \param start
+    \param objectId
+    \param methodId
+    \param in
+*/
+void Open62541::Client::recordCall(TrafficRecorder& r,
+                                   TrafficRecorder::Clock::time_point start,
+                                   const UA_NodeId& objectId,
+                                   const UA_NodeId& methodId,
+                                   const VariantList& in)
+{
+    // shallow - only encoded
+    UA_CallMethodRequest m;
+    UA_CallMethodRequest_init(&m);
+    m.objectId           = objectId;
+    m.methodId           = methodId;
+    m.inputArguments     = const_cast<UA_Variant*>(in.data());
+    m.inputArgumentsSize = in.size();
+    UA_CallRequest req;
+    UA_CallRequest_init(&req);
+    req.methodsToCall     = &m;
+    req.methodsToCallSize = 1;
+    r.request(TrafficRecorder::Call, &req, &UA_TYPES[UA_TYPES_CALLREQUEST], start, _lastError);
+}
@@ -12,6 +12,8 @@
 */
 #include <open62541cpp/open62541objects.h>
 #include <sstream>
+#include <algorithm>
+#include <cstdio>
 
 // Standard static nodes
 Open62541::NodeId Open62541::NodeId::Objects(0, UA_NS0ID_OBJECTSFOLDER);
@@ -85,160 +87,185 @@ void Open62541::Variant::fromAny(boost::any& a)
     }
 }
 
-std::string Open62541::variantToString(UA_Variant& v)
+//
+// Formatting helpers - append to the caller's buffer, no streams or temporaries
+//
+/*!
+    \brief appendUnsigned
+    \param out
+    \param v
+*/
+static void appendUnsigned(std::string& out, uint64_t v)
 {
-    std::string ret;
-    switch (v.type->typeKind) {
-        /**
-            Boolean
-            ^^^^^^^
-        */
-        case UA_DATATYPEKIND_BOOLEAN: {
-            ret = ((UA_Boolean*)(v.data)) ? "true" : "false";
-        } break;
-
-        /**
-            SByte
-            ^^^^^
-        */
-        case UA_DATATYPEKIND_SBYTE: {
-            int i = *((char*)v.data);
-            ret   = std::to_string(i);
-        } break;
-
-        /**
-            Byte
-            ^^^^
-        */
-        case UA_DATATYPEKIND_BYTE: {
-            unsigned i = *((unsigned char*)v.data);
-            ret        = std::to_string(i);
-        } break;
-
-        /**
-            Int16
-            ^^^^^
-        */
-        case UA_DATATYPEKIND_INT16: {
-            int16_t i = *((int16_t*)v.data);
-            ret       = std::to_string(i);
-
-        } break;
-
-        /**
-            UInt16
-            ^^^^^^
-        */
-        case UA_DATATYPEKIND_UINT16: {
-            uint16_t i = *((uint16_t*)v.data);
-            ret        = std::to_string(i);
-
-        } break;
-
-        /**
-            Int32
-            ^^^^^
-        */
-        case UA_DATATYPEKIND_INT32: {
-            int32_t i = *((int32_t*)v.data);
-            ret       = std::to_string(i);
-
-        } break;
-
-        /**
-            UInt32
-            ^^^^^^
-        */
-        case UA_DATATYPEKIND_UINT32: {
-            uint32_t i = *((uint32_t*)v.data);
-            ret        = std::to_string(i);
-
-        } break;
-
-        /**
-            Int64
-            ^^^^^
-        */
-        case UA_DATATYPEKIND_INT64: {
-            int64_t i = *((int64_t*)v.data);
-            ret       = std::to_string(i);
-
-        } break;
-
-        /**
-            UInt64
-            ^^^^^^
-        */
-        case UA_DATATYPEKIND_UINT64: {
-            uint32_t i = *((uint32_t*)v.data);
-            ret        = std::to_string(i);
-
-        } break;
-
-        /**
-            Float
-            ^^^^^
-        */
-        case UA_DATATYPEKIND_FLOAT: {
-            float i = *((float*)v.data);
-            ret     = std::to_string(i);
-
-        } break;
-
-        /**
-            Double
-            ^^^^^^
-        */
-        case UA_DATATYPEKIND_DOUBLE: {
-            double i = *((double*)v.data);
-            ret      = std::to_string(i);
+    char b[24];
+    char* e = b + sizeof(b);
+    char* p = e;
+    do {
+        *--p = char('0' + (v % 10));
+        v /= 10;
+    } while (v);
+    out.append(p, size_t(e - p));
+}
 
-        } break;
+/*!
+    \brief appendSigned
+    \param out
+    \param v
+*/
+static void appendSigned(std::string& out, int64_t v)
+{
+    if (v < 0) {
+        out.push_back('-');
+        appendUnsigned(out, uint64_t(0) - uint64_t(v));  // safe for INT64_MIN
+    }
+    else {
+        appendUnsigned(out, uint64_t(v));
+    }
+}
 
-        /**
-            String
-            ^^^^^^
-        */
-        case UA_DATATYPEKIND_STRING: {
+/*!
+    \brief appendDouble
+    same format as std::to_string
+    \param out
+    \param v
+*/
+static void appendDouble(std::string& out, double v)
+{
+    char b[512];  // %f of DBL_MAX is 316 characters
+    int l = snprintf(b, sizeof(b), "%f", v);
+    if (l > 0)
+        out.append(b, size_t(std::min(l, int(sizeof(b)) - 1)));
+}
 
-            UA_String* p = (UA_String*)(v.data);
-            ret          = std::string((const char*)p->data, p->length);
+/*!
+    \brief appendHex
+    \param out
+    \param v
+*/
+static void appendHex(std::string& out, uint32_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    char b[8];
+    char* e = b + sizeof(b);
+    char* p = e;
+    do {
+        *--p = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    out.append(p, size_t(e - p));
+}
 
-        } break;
+/*!
+    \brief appendDigits
+    \param out
+    \param v
+    \param width zero padded minimum width
+*/
+static void appendDigits(std::string& out, unsigned v, int width)
+{
+    char b[12];
+    char* e = b + sizeof(b);
+    char* p = e;
+    do {
+        *--p = char('0' + (v % 10));
+        v /= 10;
+    } while (v);
+    while ((e - p) < width)
+        *--p = '0';
+    out.append(p, size_t(e - p));
+}
 
-        /**
-            DateTime
-            ^^^^^^^^
-        */
-        case UA_DATATYPEKIND_DATETIME: {
-            UA_DateTime* p        = (UA_DateTime*)(v.data);
-            UA_DateTimeStruct dts = UA_DateTime_toStruct(*p);
-            char b[64];
-            int l = sprintf(b,
-                            "%02u-%02u-%04u %02u:%02u:%02u.%03u, ",
-                            dts.day,
-                            dts.month,
-                            dts.year,
-                            dts.hour,
-                            dts.min,
-                            dts.sec,
-                            dts.milliSec);
-            ret   = std::string(b, l);
-        } break;
+/*!
+    \brief Open62541::timestampToString
+    \param date
+    \param out appended to
+*/
+void Open62541::timestampToString(UA_DateTime date, std::string& out)
+{
+    UA_DateTimeStruct dts = UA_DateTime_toStruct(date);
+    // "%02u-%02u-%04u %02u:%02u:%02u.%03u, "
+    appendDigits(out, dts.day, 2);
+    out.push_back('-');
+    appendDigits(out, dts.month, 2);
+    out.push_back('-');
+    appendDigits(out, dts.year, 4);
+    out.push_back(' ');
+    appendDigits(out, dts.hour, 2);
+    out.push_back(':');
+    appendDigits(out, dts.min, 2);
+    out.push_back(':');
+    appendDigits(out, dts.sec, 2);
+    out.push_back('.');
+    appendDigits(out, dts.milliSec, 3);
+    out.append(", ", 2);
+}
 
-        /**
-            ByteString
-            ^^^^^^^^^^
-        */
+/*!
+    \brief Open62541::variantToString
+    Appends the (first) value of the variant
+    \param v
+    \param out appended to
+*/
+void Open62541::variantToString(const UA_Variant& v, std::string& out)
+{
+    if (!v.type || (v.data <= UA_EMPTY_ARRAY_SENTINEL))
+        return;
+    switch (v.type->typeKind) {
+        case UA_DATATYPEKIND_BOOLEAN:
+            out.append(*((const UA_Boolean*)(v.data)) ? "true" : "false");
+            break;
+        case UA_DATATYPEKIND_SBYTE:
+            appendSigned(out, *((const UA_SByte*)v.data));
+            break;
+        case UA_DATATYPEKIND_BYTE:
+            appendUnsigned(out, *((const UA_Byte*)v.data));
+            break;
+        case UA_DATATYPEKIND_INT16:
+            appendSigned(out, *((const UA_Int16*)v.data));
+            break;
+        case UA_DATATYPEKIND_UINT16:
+            appendUnsigned(out, *((const UA_UInt16*)v.data));
+            break;
+        case UA_DATATYPEKIND_INT32:
+            appendSigned(out, *((const UA_Int32*)v.data));
+            break;
+        case UA_DATATYPEKIND_UINT32:
+            appendUnsigned(out, *((const UA_UInt32*)v.data));
+            break;
+        case UA_DATATYPEKIND_INT64:
+            appendSigned(out, *((const UA_Int64*)v.data));
+            break;
+        case UA_DATATYPEKIND_UINT64:
+            appendUnsigned(out, *((const UA_UInt64*)v.data));
+            break;
+        case UA_DATATYPEKIND_FLOAT:
+            appendDouble(out, *((const UA_Float*)v.data));
+            break;
+        case UA_DATATYPEKIND_DOUBLE:
+            appendDouble(out, *((const UA_Double*)v.data));
+            break;
+        case UA_DATATYPEKIND_STRING:
         case UA_DATATYPEKIND_BYTESTRING: {
-            UA_ByteString* p = (UA_ByteString*)(v.data);
-            ret              = std::string((const char*)p->data, p->length);
-
+            const UA_String* p = (const UA_String*)(v.data);
+            out.append((const char*)p->data, p->length);
         } break;
-
+        case UA_DATATYPEKIND_DATETIME:
+            timestampToString(*((const UA_DateTime*)(v.data)), out);
+            break;
         default:
             break;
     }
+}
+
+/*!
+    \brief Open62541::variantToString
+    \param v
+    \return value as string
+*/
+std::string Open62541::variantToString(UA_Variant& v)
+{
+    std::string ret;
+    variantToString(v, ret);
     return ret;
 }
 
@@ -338,6 +365,10 @@ UA_StatusCode Open62541::BrowserBase::browseIter(UA_NodeId childId,
 */
 void Open62541::BrowserBase::print(std::ostream& os)
 {
+    for (const BrowseView& v : _views) {
+        os << toString(v.childId()) << " ns:" << v.nameSpace() << ": " << v.name()
+           << " Ref:" << toString(v.referenceTypeId()) << std::endl;
+    }
     for (BrowseItem& i : _list) {
         std::string s;
         int j;
@@ -388,32 +419,158 @@ void Open62541::BrowserBase::process(UA_NodeId childId, UA_NodeId referenceTypeI
 */
 std::string Open62541::timestampToString(UA_DateTime date)
 {
-    UA_DateTimeStruct dts = UA_DateTime_toStruct(date);
-    char b[64];
-    int l = sprintf(b,
-                    "%02u-%02u-%04u %02u:%02u:%02u.%03u, ",
-                    dts.day,
-                    dts.month,
-                    dts.year,
-                    dts.hour,
-                    dts.min,
-                    dts.sec,
-                    dts.milliSec);
-    return std::string(b, l);
+    std::string ret;
+    ret.reserve(32);
+    timestampToString(date, ret);
+    return ret;
 }
 
 /*!
     \brief dataValueToString
     \param value
+    \param out appended to
 */
+void Open62541::dataValueToString(const UA_DataValue& value, std::string& out)
+{
+    /* Print status and timestamps */
+    out.append("ServerTime:");
+    timestampToString(value.serverTimestamp, out);
+    out.append(" SourceTime:");
+    timestampToString(value.sourceTimestamp, out);
+    out.append(" Status:");
+    appendHex(out, value.status);
+    out.append(" Value:");
+    variantToString(value.value, out);
+}
 
+/*!
+    \brief dataValueToString
+    \param value
+*/
 std::string Open62541::dataValueToString(UA_DataValue* value)
 {
-    std::stringstream os;
-    /* Print status and timestamps */
-    os << "ServerTime:" << timestampToString(value->serverTimestamp) << " ";
-    os << "SourceTime:" << timestampToString(value->sourceTimestamp) << " ";
-    os << "Status:" << std::hex << value->status << " ";
-    os << "Value:" << variantToString(value->value);
-    return os.str();
+    std::string ret;
+    ret.reserve(96);
+    dataValueToString(*value, ret);
+    return ret;
+}
+
+/*!
+    \brief dataValuesToString
+    \param values
+    \param n
+    \param out appended to
+    \param separator
+*/
+void Open62541::dataValuesToString(const UA_DataValue* values, size_t n, std::string& out, const char* separator)
+{
+    out.reserve(out.size() + n * 96);
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0)
+            out.append(separator);
+        dataValueToString(values[i], out);
+    }
+}
+
+/*!
+    \brief Open62541::StringPool::intern
+    \param s
+    \return
+*/
+Open62541::InternedString Open62541::StringPool::intern(const std::string& s)
+{
+    {
+        ReadLock l(_mutex);
+        auto i = _map.find(s);
+        if (i != _map.end())
+            return InternedString(&i->second);
+    }
+    WriteLock l(_mutex);
+    auto r = _map.emplace(s, UA_String());
+    if (r.second) {
+        // point the UA_String at the characters of the key - keys are never modified
+        r.first->second.length = r.first->first.size();
+        r.first->second.data   = (UA_Byte*)(r.first->first.data());
+    }
+    return InternedString(&r.first->second);
+}
+
+/*!
+    \brief Open62541::PathCache::makeKey
+    \param start
+    \param path
+    \param key start node then the elements - each prefix of the path is a prefix of the key
+    \param ends offset in key of the end of each element
+*/
+void Open62541::PathCache::makeKey(const UA_NodeId& start,
+                                   const Path& path,
+                                   std::string& key,
+                                   std::vector<size_t>& ends)
+{
+    key = toString(start);
+    ends.resize(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        key += '\x1f';  // unit separator - not expected in browse names
+        key += path[i];
+        ends[i] = key.size();
+    }
+}
+
+/*!
+    \brief Open62541::PathCache::find
+    \param start
+    \param path
+    \param nodeId
+    \return number of elements resolved
+*/
+size_t Open62541::PathCache::find(const UA_NodeId& start, const Path& path, NodeId& nodeId) const
+{
+    if (!_enabled || path.empty())
+        return 0;
+    std::string key;
+    std::vector<size_t> ends;
+    makeKey(start, path, key, ends);
+    ReadLock l(_mutex);
+    if (_map.empty())
+        return 0;
+    for (size_t n = path.size(); n > 0; n--) {
+        key.resize(ends[n - 1]);
+        auto i = _map.find(key);
+        if (i != _map.end()) {
+            nodeId = i->second;
+            return n;
+        }
+    }
+    return 0;
+}
+
+/*!
+    \brief Open62541::PathCache::put
+    \param start
+    \param path
+    \param n
+    \param nodeId
+*/
+void Open62541::PathCache::put(const UA_NodeId& start, const Path& path, size_t n, const UA_NodeId& nodeId)
+{
+    if (!_enabled || (n == 0) || (n > path.size()))
+        return;
+    std::string key;
+    std::vector<size_t> ends;
+    makeKey(start, path, key, ends);
+    key.resize(ends[n - 1]);
+    WriteLock l(_mutex);
+    if (_map.size() >= _maxSize)
+        _map.clear();
+    _map[key] = nodeId;
+}
+
+/*!
+    \brief Open62541::StringPool::global
+    \return
+*/
+Open62541::StringPool& Open62541::StringPool::global()
+{
+    static StringPool p;
+    return p;
 }
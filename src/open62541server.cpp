@@ -10,13 +10,104 @@
     A PARTICULAR PURPOSE.
 */
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/pollscheduler.h>
 #include <open62541cpp/nodecontext.h>
 #include <open62541cpp/serverbrowser.h>
 #include <open62541cpp/open62541client.h>
 #include <open62541cpp/historydatabase.h>
+#include <open62541cpp/roleaccesscontrol.h>
+#include <open62541cpp/serveraggregator.h>
+#include <open62541cpp/serversnapshot.h>
 
 // map UA_SERVER to Server objects
+Open62541::Server::RegistryEntry Open62541::Server::_registry[Open62541::Server::RegistrySize];
 Open62541::Server::ServerMap Open62541::Server::_serverMap;
+std::atomic<bool> Open62541::Server::_hasOverflow{false};
+std::mutex Open62541::Server::_registryMutex;
+
+namespace {
+/*!
+    \brief isAdminSession
+    Calls made through the Server object run in the stack's admin session - ns=0, guid with data1 1
+    \param sessionId
+    \return true for the admin session
+*/
+bool isAdminSession(const UA_NodeId* sessionId)
+{
+    if (!sessionId)
+        return true;
+    return (sessionId->namespaceIndex == 0) && (sessionId->identifierType == UA_NODEIDTYPE_GUID) &&
+           (sessionId->identifier.guid.data1 == 1) && (sessionId->identifier.guid.data2 == 0) &&
+           (sessionId->identifier.guid.data3 == 0);
+}
+}  // namespace
+
+/*!
+    \brief Open62541::Server::limiterFor
+    \param sessionId
+    \return
+*/
+Open62541::SessionLimiter* Open62541::Server::limiterFor(const UA_NodeId* sessionId) const
+{
+    return (_sessionLimiter && !isAdminSession(sessionId)) ? _sessionLimiter : nullptr;
+}
+
+/*!
+    \brief Open62541::Server::registerServer
+    \param s
+    \param p
+*/
+void Open62541::Server::registerServer(UA_Server* s, Server* p)
+{
+    std::lock_guard<std::mutex> l(_registryMutex);
+    for (size_t i = 0; i < RegistrySize; i++) {
+        if (_registry[i].key.load(std::memory_order_relaxed) == s) {
+            _registry[i].server.store(p, std::memory_order_relaxed);
+            return;
+        }
+    }
+    for (size_t i = 0; i < RegistrySize; i++) {
+        if (_registry[i].key.load(std::memory_order_relaxed) == nullptr) {
+            _registry[i].server.store(p, std::memory_order_relaxed);
+            _registry[i].key.store(s, std::memory_order_release);  // publish after the value
+            return;
+        }
+    }
+    _serverMap[s] = p;
+    _hasOverflow.store(true, std::memory_order_release);
+}
+
+/*!
+    \brief Open62541::Server::unregisterServer
+    \param s
+*/
+void Open62541::Server::unregisterServer(UA_Server* s)
+{
+    std::lock_guard<std::mutex> l(_registryMutex);
+    for (size_t i = 0; i < RegistrySize; i++) {
+        if (_registry[i].key.load(std::memory_order_relaxed) == s) {
+            _registry[i].key.store(nullptr, std::memory_order_release);
+            _registry[i].server.store(nullptr, std::memory_order_relaxed);
+            return;
+        }
+    }
+    _serverMap.erase(s);
+    _hasOverflow.store(!_serverMap.empty(), std::memory_order_release);
+}
+
+/*!
+    \brief Open62541::Server::findServerOverflow
+    \param s
+    \return server or nullptr if not registered
+*/
+Open62541::Server* Open62541::Server::findServerOverflow(UA_Server* s)
+{
+    if (!_hasOverflow.load(std::memory_order_acquire))
+        return nullptr;
+    std::lock_guard<std::mutex> l(_registryMutex);
+    auto i = _serverMap.find(s);
+    return (i != _serverMap.end()) ? i->second : nullptr;
+}
 
 /*!
     \brief Open62541::Server::findContext
@@ -28,6 +119,16 @@ Open62541::NodeContext* Open62541::Server::findContext(const std::string& s)
     return RegisteredNodeContext::findRef(s);  // not all node contexts are registered
 }
 
+/*!
+    \brief Open62541::Server::findContext
+    \param h registry handle
+    \return
+*/
+Open62541::NodeContext* Open62541::Server::findContext(NodeContextRegistry::Handle h)
+{
+    return NodeContextRegistry::find(h);
+}
+
 /*!
     \brief Open62541::Server::setHistoryDatabase
     \param h
@@ -84,13 +185,33 @@ void Open62541::Server::destructor(UA_Server* server,
                                    const UA_NodeId* nodeId,
                                    void* nodeContext)
 {
-    if (server && nodeId && nodeContext) {
-        NodeContext* cp = (NodeContext*)(nodeContext);
-        Server* s       = Server::findServer(server);
-        if (s) {
-            NodeId n(*nodeId);
-            cp->destruct(*s, n);
+    Server* s = server ? Server::findServer(server) : nullptr;
+    std::vector<DeferredDestructor>* d = deferredDestructors();
+    if (s && d) {
+        // deleteTrees is deleting on this thread - run with the rest of its batch
+        if (nodeId) {
+            DeferredDestructor e;
+            e.node    = *nodeId;
+            e.context = static_cast<NodeContext*>(nodeContext);
+            d->push_back(std::move(e));
         }
+        return;
+    }
+    if (s) {
+        s->_pathCache.clear();  // any cached path may run through the deleted node
+        if (nodeId && s->_permissionCache.enabled())
+            s->_permissionCache.invalidateNode(*nodeId);
+        if (nodeId && s->_writeFilter.enabled())
+            s->_writeFilter.clearNode(*nodeId);
+        if (nodeId) {
+            std::lock_guard<std::mutex> l(s->_methodLaneMutex);
+            s->_methodLanes.remove(*nodeId);
+        }
+    }
+    if (s && nodeId && nodeContext) {
+        NodeContext* cp = (NodeContext*)(nodeContext);
+        NodeId n(*nodeId);
+        cp->destruct(*s, n);
     }
 }
 
@@ -106,6 +227,54 @@ void Open62541::Server::asyncOperationNotifyCallback(UA_Server* server)
     }
 }
 
+/*!
+    \brief Open62541::Server::runAsyncOperations
+    \return number of operations run
+*/
+size_t Open62541::Server::runAsyncOperations()
+{
+    size_t n = 0;
+    if (!_server)
+        return n;
+    UA_AsyncOperationType type;
+    const UA_AsyncOperationRequest* request = nullptr;
+    void* context                           = nullptr;
+    UA_DateTime timeout                     = 0;
+    while (UA_Server_getAsyncOperationNonBlocking(_server, &type, &request, &context, &timeout)) {
+        if (type == UA_ASYNCOPERATIONTYPE_CALL) {
+            // counted from here - a call waiting in a lane holds a slot as much as a running one
+            SessionLimiter* limiter = _sessionLimiter;
+            if (limiter && !limiter->enterAsync()) {
+                UA_CallMethodResult busy;
+                UA_CallMethodResult_init(&busy);
+                busy.statusCode = UA_STATUSCODE_BADTOOMANYOPERATIONS;
+                UA_Server_setAsyncOperationResult(_server, (const UA_AsyncOperationResponse*)&busy, context);
+                n++;
+                continue;
+            }
+            // the stack calls ServerMethod::methodCallback from the job - on a worker, not the network loop.
+            // The job owns a copy of the request - the stack may drop its own on a timeout while the job waits
+            std::shared_ptr<UA_CallMethodRequest> call(new UA_CallMethodRequest, [](UA_CallMethodRequest* r) {
+                UA_CallMethodRequest_clear(r);
+                delete r;
+            });
+            UA_CallMethodRequest_init(call.get());
+            UA_CallMethodRequest_copy(&request->callMethodRequest, call.get());
+            auto job = [this, call, context, limiter] {
+                UA_CallMethodResult result = UA_Server_call(_server, call.get());
+                UA_Server_setAsyncOperationResult(_server, (const UA_AsyncOperationResponse*)&result, context);
+                UA_CallMethodResult_clear(&result);
+                if (limiter)
+                    limiter->leaveAsync();
+            };
+            if (!_workers.post(job, methodLane(call->methodId)))
+                job();
+        }
+        n++;
+    }
+    return n;
+}
+
 void Open62541::Server::monitoredItemRegisterCallback(UA_Server* server,
                                                       const UA_NodeId* sessionId,
                                                       void* sessionContext,
@@ -120,6 +289,27 @@ void Open62541::Server::monitoredItemRegisterCallback(UA_Server* server,
     }
 }
 
+/*!
+    \brief Open62541::Server::monitoredItemRegister
+    \param nodeId
+    \param attibuteId
+    \param removed
+*/
+void Open62541::Server::monitoredItemRegister(const UA_NodeId* /*sessionId*/,
+                                              void* /*sessionContext*/,
+                                              const UA_NodeId* nodeId,
+                                              void* /*nodeContext*/,
+                                              uint32_t attibuteId,
+                                              bool removed)
+{
+    if (nodeId && (attibuteId == UA_ATTRIBUTEID_VALUE)) {
+        if (_pollScheduler)
+            _pollScheduler->monitored(*nodeId, removed);
+        if (_aggregator)
+            _aggregator->monitored(*nodeId, removed);
+    }
+}
+
 UA_Boolean Open62541::Server::createOptionalChildCallback(UA_Server* server,
                                                           const UA_NodeId* sessionId,
                                                           void* sessionContext,
@@ -163,6 +353,11 @@ UA_Boolean Open62541::Server::allowAddNodeHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);  // find the server
     if (p) {
+        if (p->_roleAccess)
+            return (sessionId && item &&
+                    p->_roleAccess->allowed(*sessionId, item->parentNodeId.nodeId, RoleAccessControl::AddNode))
+                       ? UA_TRUE
+                       : UA_FALSE;
         return p->allowAddNode(ac, sessionId, sessionContext, item);
     }
     return UA_FALSE;
@@ -176,6 +371,11 @@ UA_Boolean Open62541::Server::allowAddReferenceHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (p->_roleAccess)
+            return (sessionId && item &&
+                    p->_roleAccess->allowed(*sessionId, item->sourceNodeId, RoleAccessControl::AddReference))
+                       ? UA_TRUE
+                       : UA_FALSE;
         return p->allowAddReference(ac, sessionId, sessionContext, item);
     }
     return UA_FALSE;
@@ -189,6 +389,11 @@ UA_Boolean Open62541::Server::allowDeleteNodeHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (p->_roleAccess)
+            return (sessionId && item &&
+                    p->_roleAccess->allowed(*sessionId, item->nodeId, RoleAccessControl::DeleteNode))
+                       ? UA_TRUE
+                       : UA_FALSE;
         return p->allowDeleteNode(ac, sessionId, sessionContext, item);
     }
 
@@ -203,6 +408,11 @@ UA_Boolean Open62541::Server::allowDeleteReferenceHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (p->_roleAccess)
+            return (sessionId && item &&
+                    p->_roleAccess->allowed(*sessionId, item->sourceNodeId, RoleAccessControl::RemoveReference))
+                       ? UA_TRUE
+                       : UA_FALSE;
         return p->allowDeleteReference(ac, sessionId, sessionContext, item);
     }
     return UA_FALSE;
@@ -218,12 +428,22 @@ UA_StatusCode Open62541::Server::activateSessionHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
-        return p->activateSession(ac,
-                                  endpointDescription,
-                                  secureChannelRemoteCertificate,
-                                  sessionId,
-                                  userIdentityToken,
-                                  sessionContext);
+        UA_StatusCode ret = UA_STATUSCODE_BADSESSIONIDINVALID;
+        if (p->_roleAccess) {
+            if (sessionId)
+                ret = p->_roleAccess->activateSession(*sessionId, userIdentityToken);
+        }
+        else {
+            ret = p->activateSession(ac,
+                                     endpointDescription,
+                                     secureChannelRemoteCertificate,
+                                     sessionId,
+                                     userIdentityToken,
+                                     sessionContext);
+        }
+        if ((ret == UA_STATUSCODE_GOOD) && sessionId && p->_sessionLimiter)
+            p->_sessionLimiter->open(*sessionId);  // joins the weighted share
+        return ret;
     }
     return -1;
 }
@@ -236,6 +456,19 @@ void Open62541::Server::closeSessionHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (sessionId) {
+            p->_permissionCache.removeSession(*sessionId);
+            if (p->_sessionLimiter)
+                p->_sessionLimiter->close(*sessionId);
+            if (p->_roleAccess)
+                p->_roleAccess->unbindSession(*sessionId);
+            std::lock_guard<std::mutex> l(p->_sessionClosedMutex);
+            if (!p->_sessionClosed.empty()) {
+                NodeId id(*sessionId);
+                for (auto& i : p->_sessionClosed)
+                    i.second(id);
+            }
+        }
         p->closeSession(ac, sessionId, sessionContext);
     }
 }
@@ -250,7 +483,15 @@ UA_UInt32 Open62541::Server::getUserRightsMaskHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
-        return p->getUserRightsMask(ac, sessionId, sessionContext, nodeId, nodeContext);
+        if (p->_roleAccess)
+            return (sessionId && nodeId) ? p->_roleAccess->rightsMask(*sessionId, *nodeId) : 0;
+        UA_UInt32 v = 0;
+        if (sessionId && nodeId && p->_permissionCache.find(*sessionId, *nodeId, PermissionCache::RightsMask, v))
+            return v;
+        v = p->getUserRightsMask(ac, sessionId, sessionContext, nodeId, nodeContext);
+        if (sessionId && nodeId)
+            p->_permissionCache.put(*sessionId, *nodeId, PermissionCache::RightsMask, v);
+        return v;
     }
     return 0;
 }
@@ -265,7 +506,20 @@ UA_Byte Open62541::Server::getUserAccessLevelHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
-        return p->getUserAccessLevel(ac, sessionId, sessionContext, nodeId, nodeContext);
+        SessionLimiter* l = p->limiterFor(sessionId);
+        if (l && !l->admit(*sessionId, SessionLimiter::Read))
+            return 0;  // over budget - not cached
+        if (p->_roleAccess)
+            return (sessionId && nodeId) ? p->_roleAccess->accessLevel(*sessionId, *nodeId) : 0;
+        if (p->_nextAccessLevel)
+            return p->_nextAccessLevel(server, ac, sessionId, sessionContext, nodeId, nodeContext);
+        UA_UInt32 v = 0;
+        if (sessionId && nodeId && p->_permissionCache.find(*sessionId, *nodeId, PermissionCache::AccessLevel, v))
+            return UA_Byte(v);
+        v = p->getUserAccessLevel(ac, sessionId, sessionContext, nodeId, nodeContext);
+        if (sessionId && nodeId)
+            p->_permissionCache.put(*sessionId, *nodeId, PermissionCache::AccessLevel, v);
+        return UA_Byte(v);
     }
     return 0;
 }
@@ -280,7 +534,22 @@ UA_Boolean Open62541::Server::getUserExecutableHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
-        return p->getUserExecutable(ac, sessionId, sessionContext, methodId, methodContext);
+        SessionLimiter* l = p->limiterFor(sessionId);
+        if (l && !l->admit(*sessionId, SessionLimiter::Call))
+            return UA_FALSE;
+        if (p->_roleAccess)
+            return (sessionId && methodId && p->_roleAccess->allowed(*sessionId, *methodId, RoleAccessControl::Call))
+                       ? UA_TRUE
+                       : UA_FALSE;
+        if (p->_nextExecutable)
+            return p->_nextExecutable(server, ac, sessionId, sessionContext, methodId, methodContext);
+        UA_UInt32 v = 0;
+        if (sessionId && methodId && p->_permissionCache.find(*sessionId, *methodId, PermissionCache::Executable, v))
+            return v ? UA_TRUE : UA_FALSE;
+        v = p->getUserExecutable(ac, sessionId, sessionContext, methodId, methodContext) ? 1 : 0;
+        if (sessionId && methodId)
+            p->_permissionCache.put(*sessionId, *methodId, PermissionCache::Executable, v);
+        return v ? UA_TRUE : UA_FALSE;
     }
     return UA_FALSE;
 }
@@ -319,6 +588,12 @@ UA_Boolean Open62541::Server::allowHistoryUpdateUpdateDataHandler(UA_Server* ser
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (p->_roleAccess) {
+            const UA_UInt32 h = (performInsertReplace == UA_PERFORMUPDATETYPE_INSERT)
+                                    ? UA_UInt32(RoleAccessControl::InsertHistory)
+                                    : UA_UInt32(RoleAccessControl::ModifyHistory);
+            return (sessionId && nodeId && p->_roleAccess->allowed(*sessionId, *nodeId, h)) ? UA_TRUE : UA_FALSE;
+        }
         return p->allowHistoryUpdateUpdateData(ac, sessionId, sessionContext, nodeId, performInsertReplace, value);
     }
     return UA_FALSE;
@@ -336,6 +611,11 @@ UA_Boolean Open62541::Server::allowHistoryUpdateDeleteRawModifiedHandler(UA_Serv
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
+        if (p->_roleAccess)
+            return (sessionId && nodeId &&
+                    p->_roleAccess->allowed(*sessionId, *nodeId, RoleAccessControl::DeleteHistory))
+                       ? UA_TRUE
+                       : UA_FALSE;
         return p->allowHistoryUpdateDeleteRawModified(ac,
                                                       sessionId,
                                                       sessionContext,
@@ -357,7 +637,32 @@ UA_Boolean Open62541::Server::allowBrowseNodeHandler(UA_Server* server,
 {
     Server* p = Open62541::Server::findServer(server);
     if (p) {
-        return (p->allowBrowseNode(ac, sessionId, sessionContext, nodeId, nodeContext)) ? UA_TRUE : UA_FALSE;
+        if (p->_lazyCount.load(std::memory_order_relaxed) && nodeId && !isAdminSession(sessionId)) {
+            bool lazy = false;
+            {
+                std::lock_guard<std::mutex> l(p->_lazyMutex);
+                lazy = (p->_lazy.find(NodeId(*nodeId)) != p->_lazy.end());
+            }
+            if (lazy) {
+                // the stack is inside the Browse service - build between iterations, not here
+                NodeId n(*nodeId);
+                p->postCommand([n](Server& s) { s.materialize(n); });
+            }
+        }
+        SessionLimiter* l = p->limiterFor(sessionId);
+        if (l && !l->admit(*sessionId, SessionLimiter::Browse))
+            return UA_FALSE;
+        if (p->_roleAccess)
+            return (sessionId && nodeId && p->_roleAccess->allowed(*sessionId, *nodeId, RoleAccessControl::Browse))
+                       ? UA_TRUE
+                       : UA_FALSE;
+        UA_UInt32 v = 0;
+        if (sessionId && nodeId && p->_permissionCache.find(*sessionId, *nodeId, PermissionCache::Browse, v))
+            return v ? UA_TRUE : UA_FALSE;
+        v = p->allowBrowseNode(ac, sessionId, sessionContext, nodeId, nodeContext) ? 1 : 0;
+        if (sessionId && nodeId)
+            p->_permissionCache.put(*sessionId, *nodeId, PermissionCache::Browse, v);
+        return v ? UA_TRUE : UA_FALSE;
     }
     return UA_FALSE;
 }
@@ -385,78 +690,341 @@ UA_Boolean Open62541::Server::allowTransferSubscriptionHandler(UA_Server* server
 #endif
 
 /*!
-    \brief deleteTree
-    \param nodeId
-    \return
+    \brief Open62541::Server::deleteTrees
+    \param roots
+    \return true if every node was deleted
 */
-bool Open62541::Server::deleteTree(const NodeId& nodeId)
+bool Open62541::Server::deleteTrees(const std::vector<NodeId>& roots)
 {
     if (!_server)
         return false;
-    NodeIdMap m;  // set of nodes to delete
-    browseTree(nodeId, m);
-    for (auto i = m.begin(); i != m.end(); i++) {
+    _lastError = UA_STATUSCODE_GOOD;
+    //
+    // reference types followed to children - HierarchicalReferences and its subtypes
+    NodeIdSet hierarchical;
+    const NodeId hierarchicalReferences(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    hierarchical.put(hierarchicalReferences.get());
+    BrowseOptions subtypes;
+    subtypes.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    subtypes.nodeClassMask   = UA_NODECLASS_REFERENCETYPE;
+    browseVisit(
+        hierarchicalReferences,
+        [&hierarchical](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            hierarchical.put(r.nodeId.nodeId);
+            return BrowseContinue;
+        },
+        subtypes);
+    //
+    // gather - one browse per node in both directions; references leading out of the batch are kept
+    struct Reference {
+        NodeId node;  // in the batch
+        NodeId referenceType;
+        bool isForward;
+        NodeId target;
+    };
+    NodeIdSet batch;
+    std::vector<std::pair<NodeId, size_t>> nodes;  // and depth - breadth first
+    std::vector<Reference> references;
+    UnorderedNodeIdMap<NodeId> typeOf;  // type definitions - for the type lifecycle destructors
+    const UA_NodeId hasTypeDefinition = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+    for (const NodeId& root : roots) {
+        if ((root.nameSpaceIndex() > 0) && batch.put(root.get()))  // namespace 0 is reserved
+            nodes.emplace_back(root, 0);
+    }
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.browseDirection = UA_BROWSEDIRECTION_BOTH;
+    bd.includeSubtypes = true;
+    bd.resultMask      = UA_BROWSERESULTMASK_REFERENCETYPEID | UA_BROWSERESULTMASK_ISFORWARD;
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const NodeId node  = nodes[n].first;  // nodes grows below
+        const size_t depth = nodes[n].second;
+        bd.nodeId          = node.get();  // shallow
+        UA_BrowseResult r;
         {
-            UA_NodeId& ni = i->second;
-            if (ni.namespaceIndex > 0) {  // namespaces 0  appears to be reserved
-                WriteLock l(_mutex);
-                UA_Server_deleteNode(_server, i->second, true);
+            AttributeReadLock l(_mutex);
+            r = UA_Server_browse(_server, 0, &bd);
+        }
+        for (;;) {
+            for (size_t i = 0; i < r.referencesSize; i++) {
+                const UA_ReferenceDescription& rd = r.references[i];
+                const UA_NodeId& target           = rd.nodeId.nodeId;
+                if (rd.nodeId.serverIndex != 0)
+                    continue;
+                if (rd.isForward && (target.namespaceIndex == node.nameSpaceIndex()) &&
+                    hierarchical.contains(rd.referenceTypeId) && batch.put(target)) {
+                    nodes.emplace_back(NodeId(target), depth + 1);
+                }
+                if (rd.isForward && UA_NodeId_equal(&rd.referenceTypeId, &hasTypeDefinition))
+                    typeOf.put(node.get(), NodeId(target));
+                Reference e;
+                e.node          = node;
+                e.referenceType = rd.referenceTypeId;
+                e.isForward     = rd.isForward;
+                e.target        = target;
+                references.push_back(std::move(e));
+            }
+            if (r.continuationPoint.length == 0)
+                break;
+            UA_ByteString cp    = r.continuationPoint;
+            r.continuationPoint = UA_BYTESTRING_NULL;
+            UA_BrowseResult_clear(&r);
+            {
+                AttributeReadLock l(_mutex);
+                r = UA_Server_browseNext(_server, UA_FALSE, &cp);
+            }
+            UA_ByteString_clear(&cp);
+        }
+        UA_BrowseResult_clear(&r);
+    }
+    // children first - a node is never deleted before its descendants
+    typedef std::pair<NodeId, size_t> Item;
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Item& a, const Item& b) { return a.second > b.second; });
+    //
+    // destructors first, in the order the stack runs them - while the nodes are still there to be read and
+    // without the lock, so they can call the server
+    std::vector<DeferredDestructor> destructors;
+    destructors.reserve(nodes.size());
+    {
+        AttributeReadLock l(_mutex);
+        UA_Nodestore& store = UA_Server_getConfig(_server)->nodestore;
+        for (const auto& n : nodes) {
+            const UA_Node* p = store.getNode(store.context, n.first.constRef());
+            if (!p)
+                continue;
+            NodeContext* context = static_cast<NodeContext*>(p->head.context);
+            store.releaseNode(store.context, p);
+            if (!context)
+                continue;
+            const NodeId* type = typeOf.value(*n.first.constRef());
+            if (type) {
+                // the type's lifecycle destructor is run with the node's context - only ours can be run early
+                const UA_Node* t = store.getNode(store.context, type->constRef());
+                if (t) {
+                    const bool lifecycle =
+                        ((t->head.nodeClass == UA_NODECLASS_OBJECTTYPE) &&
+                         (t->objectTypeNode.lifecycle.destructor == NodeContext::typeDestructor)) ||
+                        ((t->head.nodeClass == UA_NODECLASS_VARIABLETYPE) &&
+                         (t->variableTypeNode.lifecycle.destructor == NodeContext::typeDestructor));
+                    store.releaseNode(store.context, t);
+                    if (lifecycle) {
+                        DeferredDestructor e;
+                        e.node    = n.first;
+                        e.type    = *type;
+                        e.context = context;
+                        destructors.push_back(std::move(e));
+                    }
+                }
             }
+            DeferredDestructor e;
+            e.node    = n.first;
+            e.context = context;
+            destructors.push_back(std::move(e));
         }
     }
+    for (DeferredDestructor& e : destructors) {
+        if (e.type.isNull())
+            e.context->destruct(*this, e.node);
+        else
+            e.context->typeDestruct(*this, e.node, e.type);
+    }
+    //
+    std::vector<DeferredDestructor> deferred;
+    deferred.reserve(nodes.size());
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    {
+        WriteLock l(_mutex);
+        deferredDestructors() = &deferred;
+        for (const Reference& e : references) {
+            if (!batch.contains(e.target.get())) {
+                // the target's half of the reference - the batch's half goes with its node
+                UA_Server_deleteReference(_server,
+                                          e.target,
+                                          e.referenceType,
+                                          e.isForward ? UA_FALSE : UA_TRUE,
+                                          UA_EXPANDEDNODEID_NODEID(e.node.get()),
+                                          UA_FALSE);
+            }
+        }
+        for (const auto& n : nodes) {
+            UA_StatusCode s = UA_Server_deleteNode(_server, n.first, UA_FALSE);
+            if ((first == UA_STATUSCODE_GOOD) && (s != UA_STATUSCODE_GOOD))
+                first = s;
+        }
+        deferredDestructors() = nullptr;
+    }
+    runDestructors(deferred, &batch);  // the stack's calls for the batch have been run already
+    _lastError = first;
     return lastOK();
 }
 
 /*!
-    \brief browseTreeCallBack
-    \param childId
-    \param isInverse
-    \param referenceTypeId
-    \param handle
-    \return
+    \brief Open62541::Server::deferredDestructors
+    \return the destructor batch of this thread - null unless deleteTrees is deleting
 */
-
-static UA_StatusCode browseTreeCallBack(UA_NodeId childId,
-                                        UA_Boolean isInverse,
-                                        UA_NodeId /*referenceTypeId*/,
-                                        void* handle)
+std::vector<Open62541::Server::DeferredDestructor>*& Open62541::Server::deferredDestructors()
 {
-    if (!isInverse) {  // not a parent node - only browse forward
-        Open62541::UANodeIdList* pl = (Open62541::UANodeIdList*)handle;
-        pl->put(childId);
-    }
-    return UA_STATUSCODE_GOOD;
+    static thread_local std::vector<DeferredDestructor>* d = nullptr;
+    return d;
 }
 
 /*!
-    \brief Open62541::Client::browseChildren
-    \param nodeId
-    \param m
-    \return
+    \brief Open62541::Server::deferTypeDestructor
+    \param node
+    \param type
+    \param context
+    \return true if deferred
 */
-
-bool Open62541::Server::browseChildren(const UA_NodeId& nodeId, NodeIdMap& m)
+bool Open62541::Server::deferTypeDestructor(const UA_NodeId& node, const UA_NodeId& type, NodeContext* context)
 {
-    if (!_server)
+    std::vector<DeferredDestructor>* d = deferredDestructors();
+    if (!d)
         return false;
-    Open62541::UANodeIdList l;
-    {
+    DeferredDestructor e;
+    e.node    = node;
+    e.type    = type;
+    e.context = context;
+    d->push_back(std::move(e));
+    return true;
+}
 
-        WriteLock ll(_mutex);
-        UA_Server_forEachChildNodeCall(_server, nodeId, browseTreeCallBack, &l);  // get the childlist
+/*!
+    \brief Open62541::Server::runDestructors
+    What the destructor hook does per node, done once for a batch where it can be
+    \param d
+    \param done nodes whose destructors have been run - only the caches are updated for these
+*/
+void Open62541::Server::runDestructors(std::vector<DeferredDestructor>& d, const NodeIdSet* done)
+{
+    if (d.empty())
+        return;
+    _pathCache.clear();
+    std::vector<UA_NodeId> deleted;  // shallow
+    deleted.reserve(d.size());
+    for (const DeferredDestructor& e : d) {
+        if (!e.type.isNull())
+            continue;
+        if (_permissionCache.enabled())
+            _permissionCache.invalidateNode(e.node.get());
+        deleted.push_back(*e.node.constRef());
+    }
+    if (_writeFilter.enabled())
+        _writeFilter.clearNodes(deleted);
+    {
+        std::lock_guard<std::mutex> l(_methodLaneMutex);
+        for (const UA_NodeId& n : deleted)
+            _methodLanes.remove(n);
+    }
+    for (DeferredDestructor& e : d) {
+        if (!e.context || (done && done->contains(*e.node.constRef())))
+            continue;
+        if (e.type.isNull())
+            e.context->destruct(*this, e.node);
+        else
+            e.context->typeDestruct(*this, e.node, e.type);
     }
-    for (int i = 0; i < int(l.size()); i++) {
-        if (l[i].namespaceIndex == nodeId.namespaceIndex) {  // only in same namespace
-            std::string s = Open62541::toString(l[i]);
-            if (m.find(s) == m.end()) {
-                m.put(l[i]);
-                browseChildren(l[i], m);  // recurse no duplicates
+}
+
+/*!
+    \brief Open62541::Server::browseVisit
+    \param start
+    \param visit
+    \param options
+    \return true on success
+*/
+bool Open62541::Server::browseVisit(const NodeId& start, BrowseVisitor visit, const BrowseOptions& options)
+{
+    if (!_server || !visit)
+        return false;
+    NodeIdSet visited;  // the address space is a graph - visit each node once
+    visited.put(start);
+    std::vector<std::pair<NodeId, size_t>> stack;  // explicit stack - no recursion
+    stack.emplace_back(start, 0);
+    //
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = options.referenceTypeId;  // shallow
+    bd.includeSubtypes = options.includeSubtypes;
+    bd.nodeClassMask   = options.nodeClassMask;
+    bd.resultMask      = UA_BROWSERESULTMASK_ALL;  // browse names come back with the references
+    //
+    _lastError   = UA_STATUSCODE_GOOD;
+    bool running = true;
+    while (running && !stack.empty()) {
+        std::pair<NodeId, size_t> item = std::move(stack.back());
+        stack.pop_back();
+        const size_t depth = item.second + 1;
+        bd.nodeId          = item.first.get();  // shallow
+        UA_BrowseResult r;
+        {
+            AttributeReadLock l(_mutex);
+            r = UA_Server_browse(_server, options.maxReferences, &bd);
+        }
+        for (;;) {
+            if (r.statusCode != UA_STATUSCODE_GOOD) {
+                _lastError = r.statusCode;
+                break;
+            }
+            for (size_t i = 0; running && (i < r.referencesSize); i++) {
+                const UA_ReferenceDescription& rd = r.references[i];
+                const UA_NodeId& child            = rd.nodeId.nodeId;
+                if ((rd.nodeId.serverIndex != 0) || !options.accept(child) || !visited.put(child))
+                    continue;
+                switch (visit(rd, bd.nodeId, depth)) {
+                    case BrowseStop:
+                        running = false;
+                        break;
+                    case BrowseContinue:
+                        if ((options.maxDepth == 0) || (depth < options.maxDepth)) {
+                            stack.emplace_back(NodeId(child), depth);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if (r.continuationPoint.length == 0)
+                break;
+            // more references - fetch them or release the continuation point if stopping
+            UA_ByteString cp    = r.continuationPoint;
+            r.continuationPoint = UA_BYTESTRING_NULL;
+            UA_BrowseResult_clear(&r);
+            {
+                AttributeReadLock l(_mutex);
+                r = UA_Server_browseNext(_server, running ? UA_FALSE : UA_TRUE, &cp);
             }
+            UA_ByteString_clear(&cp);
+            if (!running)
+                break;
         }
+        UA_BrowseResult_clear(&r);
     }
     return lastOK();
 }
 
+/*!
+    \brief Open62541::Server::browseChildren
+    \param nodeId
+    \param m
+    \return
+*/
+bool Open62541::Server::browseChildren(const UA_NodeId& nodeId, NodeIdMap& m)
+{
+    BrowseOptions o;
+    o.nameSpace = nodeId.namespaceIndex;  // only in same namespace
+    return browseVisit(
+        NodeId(nodeId),
+        [&m](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            const std::string s = Open62541::toString(r.nodeId.nodeId);
+            if (m.find(s) != m.end())
+                return BrowseSkipChildren;
+            m.put(r.nodeId.nodeId);
+            return BrowseContinue;
+        },
+        o);
+}
+
 /*!
     \brief Open62541::Client::browseTree
     \param nodeId
@@ -477,31 +1045,28 @@ bool Open62541::Server::browseTree(const Open62541::NodeId& nodeId, Open62541::U
 */
 bool Open62541::Server::browseTree(const UA_NodeId& nodeId, Open62541::UANode* node)
 {
-    if (!_server)
+    if (!_server || !node)
         return false;
     // form a heirachical tree of nodes
-    Open62541::UANodeIdList l;  // shallow copy node IDs and take ownership
-    {
-        WriteLock ll(_mutex);
-        UA_Server_forEachChildNodeCall(_server, nodeId, browseTreeCallBack, &l);  // get the childlist
-    }
-    for (int i = 0; i < int(l.size()); i++) {
-        if (l[i].namespaceIndex > 0) {
-            QualifiedName outBrowseName;
-            {
-                WriteLock ll(_mutex);
-                _lastError = __UA_Server_read(_server, &l[i], UA_ATTRIBUTEID_BROWSENAME, outBrowseName);
-            }
-            if (_lastError == UA_STATUSCODE_GOOD) {
-                std::string s = toString(outBrowseName.get().name);  // get the browse name and leak key
-                NodeId nId    = l[i];                                // deep copy
-                UANode* n     = node->createChild(s);                // create the node
-                n->setData(nId);
-                browseTree(l[i], n);
-            }
-        }
-    }
-    return lastOK();
+    BrowseOptions o;
+    o.minNameSpace = 1;
+    UnorderedNodeIdMap<UANode*> parents;  // tree node for each node id added
+    parents.put(nodeId, node);
+    return browseVisit(
+        NodeId(nodeId),
+        [&parents](const UA_ReferenceDescription& r, const UA_NodeId& parent, size_t) {
+            UANode** p = parents.value(parent);
+            if (!p)
+                return BrowseSkipChildren;
+            std::string s = toString(r.browseName.name);
+            UANode* n     = (*p)->createChild(s);  // create the node
+            NodeId nId;
+            nId = r.nodeId.nodeId;  // deep copy
+            n->setData(nId);
+            parents.put(r.nodeId.nodeId, n);
+            return BrowseContinue;
+        },
+        o);
 }
 
 /*!
@@ -516,6 +1081,172 @@ bool Open62541::Server::browseTree(const NodeId& nodeId, NodeIdMap& m)
     return browseChildren(nodeId, m);
 }
 
+/*!
+    \brief Open62541::Server::browseChildren
+    \param nodeId
+    \param m
+    \return
+*/
+bool Open62541::Server::browseChildren(const UA_NodeId& nodeId, NodeIdSet& m)
+{
+    BrowseOptions o;
+    o.nameSpace = nodeId.namespaceIndex;  // only in same namespace
+    return browseVisit(
+        NodeId(nodeId),
+        [&m](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            return m.put(r.nodeId.nodeId) ? BrowseContinue : BrowseSkipChildren;
+        },
+        o);
+}
+
+/*!
+    \brief Open62541::Server::browseTree
+    \param nodeId
+    \param m
+    \return
+*/
+bool Open62541::Server::browseTree(const NodeId& nodeId, NodeIdSet& m)
+{
+    m.put(nodeId);
+    return browseChildren(nodeId, m);
+}
+
+/*!
+    \brief Open62541::Server::readValues
+    \param nodeIds
+    \param results
+    \param timestamps
+    \return true if all reads succeeded
+*/
+bool Open62541::Server::readValues(const std::vector<NodeId>& nodeIds,
+                                   std::vector<DataValue>& results,
+                                   UA_TimestampsToReturn timestamps)
+{
+    if (!_server)
+        return false;
+    results.resize(nodeIds.size());  // existing entries are kept and reused
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    UA_ReadValueId rvi;
+    UA_ReadValueId_init(&rvi);
+    rvi.attributeId = UA_ATTRIBUTEID_VALUE;
+    {
+        AttributeReadLock l(_mutex);
+        for (size_t i = 0; i < nodeIds.size(); i++) {
+            rvi.nodeId = nodeIds[i].get();  // shallow - the read does not take ownership
+            results[i].adopt(UA_Server_read(_server, &rvi, timestamps));
+            if ((first == UA_STATUSCODE_GOOD) && (results[i].status() != UA_STATUSCODE_GOOD)) {
+                first = results[i].status();
+            }
+        }
+    }
+    _lastError = first;
+    return first == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::Server::writeValueOnChange
+    \param nodeId
+    \param value
+    \return
+*/
+bool Open62541::Server::writeValueOnChange(const NodeId& nodeId, const Variant& value)
+{
+    if (!_server)
+        return false;
+    if (!_writeFilter.changed(nodeId.get(), value.get())) {
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
+    _lastError = __UA_Server_write(_server, nodeId, UA_ATTRIBUTEID_VALUE, &UA_TYPES[UA_TYPES_VARIANT], value);
+    if (!lastOK())
+        _writeFilter.forget(nodeId.get());  // the node keeps its old value
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::Server::writeValues
+    \param nodeIds
+    \param values
+    \param results
+    \return true if all writes succeeded
+*/
+bool Open62541::Server::writeValues(const std::vector<NodeId>& nodeIds,
+                                    const std::vector<Variant>& values,
+                                    std::vector<UA_StatusCode>& results)
+{
+    if (!_server)
+        return false;
+    if (nodeIds.size() != values.size()) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    results.resize(nodeIds.size());
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    {
+        WriteLock l(_mutex);
+        for (size_t i = 0; i < nodeIds.size(); i++) {
+            results[i] = writeValueLocked(nodeIds[i].get(), values[i].get());
+            if ((first == UA_STATUSCODE_GOOD) && (results[i] != UA_STATUSCODE_GOOD)) {
+                first = results[i];
+            }
+        }
+    }
+    _lastError = first;
+    return first == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::Server::writeValues
+    \param n
+    \param nodeIds
+    \param values
+    \param results
+    \return true if all writes succeeded
+*/
+bool Open62541::Server::writeValues(size_t n,
+                                    const UA_NodeId* nodeIds,
+                                    const UA_Variant* values,
+                                    UA_StatusCode* results)
+{
+    if (!_server)
+        return false;
+    UA_StatusCode first = UA_STATUSCODE_GOOD;
+    {
+        WriteLock l(_mutex);
+        for (size_t i = 0; i < n; i++) {
+            results[i] = writeValueLocked(nodeIds[i], values[i]);
+            if ((first == UA_STATUSCODE_GOOD) && (results[i] != UA_STATUSCODE_GOOD)) {
+                first = results[i];
+            }
+        }
+    }
+    _lastError = first;
+    return first == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::Server::writeValueLocked
+    Write one value through the write filter - the caller holds the lock
+    \param nodeId
+    \param value
+    \return status code
+*/
+UA_StatusCode Open62541::Server::writeValueLocked(const UA_NodeId& nodeId, const UA_Variant& value)
+{
+    if (_writeFilter.enabled() && !_writeFilter.changed(nodeId, value))
+        return UA_STATUSCODE_GOOD;
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    wv.attributeId    = UA_ATTRIBUTEID_VALUE;
+    wv.value.hasValue = true;
+    wv.nodeId         = nodeId;  // shallow copies - the write copies what it keeps
+    wv.value.value    = value;
+    UA_StatusCode ret = UA_Server_write(_server, &wv);
+    if ((ret != UA_STATUSCODE_GOOD) && _writeFilter.enabled())
+        _writeFilter.forget(nodeId);
+    return ret;
+}
+
 /*!
     \brief Open62541::Server::terminate
 */
@@ -523,40 +1254,282 @@ void Open62541::Server::terminate()
 {
     if (_server) {
         //
-        _timerMap.clear();
+        _workers.stop();  // normally already stopped by start()
+        _wheel.clear();   // before _timerMutex - wheel handlers take it
+        {
+            std::lock_guard<std::recursive_mutex> l(_timerMutex);
+            for (auto& i : _timerMap) {
+                if (!TimerWheel::isWheelId(i.first))
+                    UA_Server_removeCallback(_server, i.first);  // the loop has stopped
+            }
+            _timerMap.clear();
+        }
+        _wheelCallbackId = 0;  // removed with the server
+        {
+            std::lock_guard<std::mutex> l(_lazyMutex);
+            _lazy.clear();
+            _lazyCount = 0;
+        }
 #ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
-        _conditionMap.clear();
+        _conditions.clear();
 #endif
         UA_Server_run_shutdown(_server);
         UA_Server_delete(_server);
-        _serverMap.erase(_server);
+        unregisterServer(_server);
         _server = nullptr;
+#ifdef UA_ENABLE_PUBSUB
+        _pubSub.clear();  // realtime field buffers - the stack no longer refers to them
+#endif
     }
 }
 
+/*!
+    \brief Open62541::Server::addLazyNode
+    \param node
+    \param build
+*/
+void Open62541::Server::addLazyNode(const NodeId& node, LazyBuilder build)
+{
+    if (!build)
+        return;
+    std::lock_guard<std::mutex> l(_lazyMutex);
+    if (_lazy.find(node) == _lazy.end())
+        _lazyCount++;
+    _lazy[node] = std::move(build);
+}
+
+/*!
+    \brief Open62541::Server::materialize
+    \param node
+    \return true if built
+*/
+bool Open62541::Server::materialize(const NodeId& node)
+{
+    LazyBuilder build;
+    {
+        std::lock_guard<std::mutex> l(_lazyMutex);
+        auto i = _lazy.find(node);
+        if (i == _lazy.end())
+            return false;
+        build = std::move(i->second);
+        _lazy.erase(i);  // a concurrent browse of the same node finds nothing to do
+        _lazyCount--;
+    }
+    StartupTrace::Scope trace(_startup, "materialize");
+    return build(*this);
+}
+
+/*!
+    \brief Open62541::Server::materializeAll
+    \return number built
+*/
+size_t Open62541::Server::materializeAll()
+{
+    size_t ret = 0;
+    for (;;) {
+        NodeId n;
+        {
+            std::lock_guard<std::mutex> l(_lazyMutex);
+            if (_lazy.empty())
+                break;
+            n = _lazy.begin()->first;
+        }
+        if (materialize(n))
+            ret++;
+    }
+    return ret;
+}
+
+/*!
+    \brief Open62541::Server::setTimerWheel
+    \param tickMs
+    \param grouped
+    \return true if changed
+*/
+bool Open62541::Server::setTimerWheel(unsigned tickMs, bool grouped)
+{
+    if (_wheel.size() > 0)
+        return false;
+    if (tickMs == 0) {
+        if (_wheelCallbackId && _server) {
+            UA_Server_removeCallback(_server, _wheelCallbackId);
+        }
+        _wheelCallbackId = 0;
+    }
+    else {
+        _wheel.setTick(tickMs);
+        if (_wheelCallbackId && _server) {
+            UA_Server_changeRepeatedCallbackInterval(_server, _wheelCallbackId, tickMs);
+        }
+    }
+    _wheelTick    = tickMs;
+    _wheelGrouped = grouped;
+    return true;
+}
+
+/*!
+    \brief Open62541::Server::startTimerWheel
+    \return true if the wheel is running
+*/
+bool Open62541::Server::startTimerWheel()
+{
+    if (_wheelCallbackId)
+        return true;
+    if (!_server || !_wheelTick)
+        return false;
+    _lastError = UA_Server_addRepeatedCallback(_server, Server::wheelCallback, this, _wheelTick, &_wheelCallbackId);
+    if (!lastOK()) {
+        _wheelCallbackId = 0;
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::Server::addWheelTimer
+    \param delayMs
+    \param intervalMs
+    \param func
+    \return timer id or 0
+*/
+UA_UInt64 Open62541::Server::addWheelTimer(unsigned delayMs, unsigned intervalMs, TimerWheel::Handler func)
+{
+    if (!startTimerWheel())
+        return 0;
+    _lastError = UA_STATUSCODE_GOOD;
+    return _wheel.add(delayMs, intervalMs, std::move(func), _wheelGrouped);
+}
+
+/*!
+    \brief Open62541::Server::addWheelTimerEvent
+    \param delayMs
+    \param intervalMs
+    \param callbackId
+    \param func
+    \return true on success
+*/
+bool Open62541::Server::addWheelTimerEvent(unsigned delayMs,
+                                           unsigned intervalMs,
+                                           UA_UInt64& callbackId,
+                                           std::function<void(Timer&)> func)
+{
+    // same order as a firing wheel - its handlers take _timerMutex with the wheel locked
+    std::lock_guard<std::recursive_mutex> w(_wheel.mutex());
+    std::lock_guard<std::recursive_mutex> l(_timerMutex);
+    callbackId = addWheelTimer(delayMs, intervalMs, [this](UA_UInt64 id) {
+        // on the pool the timer is looked up again by id as it may have been removed in the meantime
+        if (!post([this, id] { handleTimer(id); })) {
+            handleTimer(id);
+        }
+    });
+    if (callbackId == 0)
+        return false;
+    _timerMap[callbackId] = TimerPtr(new Timer(this, callbackId, intervalMs == 0, func));
+    return true;
+}
+
 /*!
     \brief Open62541::Server::start
     \param iterate
 */
 void Open62541::Server::start()
 {  // start the server
-    if (!_running) {
-        _running = true;
+    if (!_running && !_stopped) {
+        _loopThread = std::this_thread::get_id();
+        _running    = true;
         if (_server) {
-            _serverMap[_server] = this;  // map for call backs
-            UA_Server_run_startup(_server);
-            initialise();
-            while (_running) {
-                {
-                    UA_Server_run_iterate(_server, true);
+            if (!_loopConfig.empty())
+                _loopConfig.apply();
+            registerServer(_server, this);  // map for call backs
+            {
+                StartupTrace::Scope t(_startup, "runStartup");
+                UA_Server_run_startup(_server);
+            }
+            {
+                StartupTrace::Scope t(_startup, "initialise");
+                initialise();
+            }
+            _startup.setActive(false);
+            if (_workerThreads > 0) {
+                _workers.start(_workerThreads);
+            }
+            while (_running && !_stopped) {
+                // posted commands skip the network wait - a wait already in progress runs to its timeout
+                UA_Server_run_iterate(_server, !_commandsPending.load(std::memory_order_acquire));
+                runCommands(_commands.capacity());
+                flushCoalescedWrites();
+                if (_asyncPending.exchange(false)) {
+                    runAsyncOperations();
+                }
+                if (_workers.running()) {
+                    // hand off process() so the network loop is not held up - skip if the last one is still busy
+                    if (!_processPending.exchange(true)) {
+                        if (!_workers.post([this] {
+                                process();
+                                _processPending = false;
+                            })) {
+                            _processPending = false;
+                        }
+                    }
+                }
+                else {
+                    process();  // called from time to time - Only safe places to access server are in process() and
+                                // callbacks
                 }
-                process();  // called from time to time - Only safe places to access server are in process() and
-                            // callbacks
             }
+            _workers.stop();  // drain outstanding jobs before shutting down
+            runCommands(_commands.capacity());  // bounded - producers that keep posting cannot hold up the stop
+            flushCoalescedWrites(true);
             terminate();
         }
-        _running = false;
+        _running    = false;
+        _loopThread = std::thread::id();
+    }
+}
+
+/*!
+    \brief Open62541::Server::runCommands
+    \param limit
+    \return number of commands run
+*/
+size_t Open62541::Server::runCommands(size_t limit)
+{
+    size_t n = 0;
+    Command c;
+    _commandsPending.store(false, std::memory_order_relaxed);
+    while ((limit == 0 || n < limit) && _commands.pop(c)) {
+        if (c.fn) {
+            c.fn(*this);
+            c.fn = nullptr;
+        }
+        else {
+            writeValue(c.node, c.value);
+        }
+        n++;
     }
+    if (!_commands.empty()) {
+        _commandsPending = true;  // batch limit reached or a producer is mid publish - come back without waiting
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::Server::flushCoalescedWrites
+    \param force
+    \return number of writes delivered
+*/
+size_t Open62541::Server::flushCoalescedWrites(bool force)
+{
+    std::lock_guard<std::recursive_mutex> g(_coalesceMutex);  // a context being destroyed waits for the flush
+    if (_coalescing.empty())
+        return 0;
+    std::vector<NodeContext*> l(_coalescing.begin(), _coalescing.end());  // handlers may add contexts
+    size_t n = 0;
+    for (auto c : l) {
+        if (_coalescing.count(c))  // or remove them
+            n += c->flushWrites(*this, force);
+    }
+    return n;
 }
 
 /*!
@@ -564,6 +1537,7 @@ void Open62541::Server::start()
 */
 void Open62541::Server::stop()
 {  // stop the server
+    _stopped = true;  // before start() has run, e.g. on a thread not yet scheduled
     _running = false;
 }
 
@@ -592,6 +1566,7 @@ bool Open62541::Server::nodeIdFromPath(const NodeId& start, const Path& path, No
     //
     int level = 0;
     if (path.size() > 0) {
+        level = int(_pathCache.find(start, path, nodeId));  // skip the longest known prefix
         ServerBrowser b(*this);
         while (level < int(path.size())) {
             b.browse(nodeId);
@@ -600,6 +1575,7 @@ bool Open62541::Server::nodeIdFromPath(const NodeId& start, const Path& path, No
                 return false;
             level++;
             nodeId = (*i).childId;
+            _pathCache.put(start, path, level, nodeId);
         }
     }
     return level == int(path.size());
@@ -619,25 +1595,27 @@ bool Open62541::Server::createFolderPath(const NodeId& start, const Path& path,
     // create folder path first then add varaibles to path's end leaf
     // create folder path first then add varaibles to path's end leaf
     //
-    UA_NodeId n = start.get();  // use node ids to browse with
-    int level   = 0;
+    nodeId    = start;
+    int level = 0;
     if (path.size() > 0) {
+        level = int(_pathCache.find(start, path, nodeId));  // skip the longest known prefix
         ServerBrowser b(*this);
         while (level < int(path.size())) {
-            b.browse(n);
+            b.browse(nodeId);
             auto i = b.find(path[level]);
             if (i == b.list().end())
                 break;
             level++;
-            n = (*i).childId;  // shallow copy
+            nodeId = (*i).childId;  // deep copy - the browser list goes on the next browse
+            _pathCache.put(start, path, level, nodeId);
         }
-        nodeId = n;
         NodeId newNode;
         while (level < int(path.size())) {
             if (!addFolder(nodeId, path[level], NodeId::Null, newNode.notNull(), nameSpaceIndex))
                 break;
             nodeId = newNode;  // assign
             level++;
+            _pathCache.put(start, path, level, nodeId);
         }
     }
     return level == int(path.size());
@@ -671,6 +1649,7 @@ bool Open62541::Server::addFolder(const NodeId& parent,
 {
     if (!_server)
         return false;
+    StartupTrace::Scope trace(_startup, "addFolder");
     if (nameSpaceIndex == 0)
         nameSpaceIndex = parent.nameSpaceIndex();  // inherit parent by default
     QualifiedName qn(nameSpaceIndex, childName);
@@ -691,6 +1670,44 @@ bool Open62541::Server::addFolder(const NodeId& parent,
     return lastOK();
 }
 
+/*!
+    \brief Open62541::Server::addFolder
+    \param parent
+    \param childName
+    \param nodeId
+    \param newNode
+    \param nameSpaceIndex
+    \return
+*/
+bool Open62541::Server::addFolder(const NodeId& parent,
+                                  const InternedString& childName,
+                                  const NodeId& nodeId,
+                                  NodeId& newNode,
+                                  int nameSpaceIndex)
+{
+    if (!_server)
+        return false;
+    StartupTrace::Scope trace(_startup, "addFolder");
+    if (nameSpaceIndex == 0)
+        nameSpaceIndex = parent.nameSpaceIndex();  // inherit parent by default
+    // shallow structures - the server copies them so nothing is allocated or freed here
+    UA_QualifiedName qn      = makeQualifiedName(UA_UInt16(nameSpaceIndex), childName);
+    UA_ObjectAttributes attr = UA_ObjectAttributes_default;
+    attr.displayName         = makeLocalizedText(childName);
+    attr.description         = attr.displayName;
+    WriteLock l(_mutex);
+    _lastError = UA_Server_addObjectNode(_server,
+                                         nodeId,
+                                         parent,
+                                         NodeId::Organizes,
+                                         qn,
+                                         NodeId::FolderType,
+                                         attr,
+                                         NULL,
+                                         newNode.isNull() ? nullptr : newNode.clearRef());
+    return lastOK();
+}
+
 /*!
     \brief Open62541::Server::addFolder::addVariable
     \param parent
@@ -708,6 +1725,7 @@ bool Open62541::Server::addVariable(const NodeId& parent,
 {
     if (!_server)
         return false;
+    StartupTrace::Scope trace(_startup, "addVariable");
     if (nameSpaceIndex == 0)
         nameSpaceIndex = parent.nameSpaceIndex();  // inherit parent by default
 
@@ -732,6 +1750,51 @@ bool Open62541::Server::addVariable(const NodeId& parent,
     return lastOK();
 }
 
+/*!
+    \brief Open62541::Server::addVariable
+    \param parent
+    \param childName
+    \param value
+    \param nodeId
+    \param newNode
+    \param c
+    \param nameSpaceIndex
+    \return
+*/
+bool Open62541::Server::addVariable(const NodeId& parent,
+                                    const InternedString& childName,
+                                    const Variant& value,
+                                    const NodeId& nodeId,
+                                    NodeId& newNode,
+                                    NodeContext* c,
+                                    int nameSpaceIndex)
+{
+    if (!_server)
+        return false;
+    StartupTrace::Scope trace(_startup, "addVariable");
+    if (nameSpaceIndex == 0)
+        nameSpaceIndex = parent.nameSpaceIndex();  // inherit parent by default
+    // shallow structures - the server copies them so nothing is allocated or freed here
+    UA_QualifiedName qn        = makeQualifiedName(UA_UInt16(nameSpaceIndex), childName);
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName           = makeLocalizedText(childName);
+    attr.description           = attr.displayName;
+    attr.accessLevel           = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    attr.value                 = value.get();  // shallow - value outlives the call
+    attr.dataType              = value.get().type->typeId;
+    WriteLock l(_mutex);
+    _lastError = UA_Server_addVariableNode(_server,
+                                           nodeId,
+                                           parent,
+                                           NodeId::Organizes,
+                                           qn,
+                                           UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),  // no variable type
+                                           attr,
+                                           c,
+                                           newNode.isNull() ? nullptr : newNode.clearRef());
+    return lastOK();
+}
+
 /*!
     \brief Open62541::Server::addHistoricalVariable
     \param parent
@@ -893,3 +1956,95 @@ bool Open62541::Server::addPeriodicServerRegister(
     //
     return lastOK();
 }
+
+/*!
+    \brief Open62541::Server::saveSnapshot
+    \param path
+    \return true on success
+*/
+bool Open62541::Server::saveSnapshot(const std::string& path)
+{
+    ServerSnapshot s(*this);
+    bool ret   = s.save(path);
+    _lastError = s.lastError();
+    return ret;
+}
+
+/*!
+    \brief Open62541::Server::loadSnapshot
+    \param path
+    \return true if every node and reference was loaded and every context found
+*/
+bool Open62541::Server::loadSnapshot(const std::string& path)
+{
+    ServerSnapshot s(*this);
+    bool ret   = s.load(path);
+    _lastError = s.lastError();
+    return ret && lastOK() && s.unbound().empty();
+}
+
+/*!
+    \brief Open62541::Server::memoryReport
+    \param r
+*/
+void Open62541::Server::memoryReport(MemoryReport& r)
+{
+    {
+        std::lock_guard<std::recursive_mutex> l(_timerMutex);
+        const size_t each = MemoryReport::MapNode + sizeof(UA_UInt64) + sizeof(TimerPtr) + sizeof(Timer);
+        r.add("timers", _timerMap.size() * each, _timerMap.size());
+    }
+    r.add("commands", _commands.memoryUsage(), _commands.size());
+    // keys are the start node and the path - taken as 64 bytes
+    r.add("pathCache", _pathCache.size() * (MemoryReport::HashNode + sizeof(std::string) + 64 + sizeof(NodeId)),
+          _pathCache.size());
+    {
+        std::lock_guard<std::mutex> l(_lazyMutex);
+        size_t b = 0;
+        for (const auto& i : _lazy)
+            b += MemoryReport::HashNode + sizeof(i) + MemoryReport::heapOf(*i.first.constRef());
+        r.add("lazyNodes", b, _lazy.size());
+    }
+    {
+        std::lock_guard<std::mutex> l(_contextMutex);
+        size_t b = 0;
+        for (const auto& i : _contexts)
+            b += MemoryReport::HashNode + sizeof(i) + MemoryReport::heapOf(i.first);
+        r.add("contexts", b, _contexts.size());
+    }
+#ifdef UA_ENABLE_SUBSCRIPTIONS_ALARMS_CONDITIONS
+    _conditions.memoryUsage(r);
+#endif
+    //
+    std::vector<MemoryReport::Source> sources;
+    {
+        std::lock_guard<std::mutex> l(_memoryMutex);
+        for (const auto& i : _memorySources)
+            sources.push_back(i.second);
+    }
+    for (auto& f : sources) {
+        if (f)
+            f(r);
+    }
+}
+
+/*!
+    \brief Open62541::Server::addMemorySource
+    \param name
+    \param f
+*/
+void Open62541::Server::addMemorySource(const std::string& name, MemoryReport::Source f)
+{
+    std::lock_guard<std::mutex> l(_memoryMutex);
+    _memorySources[name] = f;
+}
+
+/*!
+    \brief Open62541::Server::removeMemorySource
+    \param name
+*/
+void Open62541::Server::removeMemorySource(const std::string& name)
+{
+    std::lock_guard<std::mutex> l(_memoryMutex);
+    _memorySources.erase(name);
+}
@@ -0,0 +1,545 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/parallelhistory.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+/*!
+    \brief The RawBounds struct
+    Where a raw read starts and ends in a backend
+*/
+struct RawBounds {
+    size_t startIndex = 0;
+    size_t endIndex   = 0;
+    bool addFirst     = false;
+    bool addLast      = false;
+    bool reverse      = false;
+};
+
+/*!
+    \brief rawResultSize
+    Index range and size of a raw read - as the stack's default database works it out
+    \return number of values including missing bounds
+*/
+static size_t rawResultSize(const UA_HistoryDataBackend& b,
+                            UA_Server* server,
+                            const UA_NodeId* sessionId,
+                            void* sessionContext,
+                            const UA_NodeId* nodeId,
+                            UA_DateTime start,
+                            UA_DateTime end,
+                            UA_UInt32 numValuesPerNode,
+                            bool returnBounds,
+                            RawBounds& r)
+{
+    size_t storeEnd = b.getEnd(server, b.context, sessionId, sessionContext, nodeId);
+    size_t first    = b.firstIndex(server, b.context, sessionId, sessionContext, nodeId);
+    size_t last     = b.lastIndex(server, b.context, sessionId, sessionContext, nodeId);
+    auto match      = [&](UA_DateTime t, MatchStrategy s) {
+        return b.getDateTimeMatch(server, b.context, sessionId, sessionContext, nodeId, t, s);
+    };
+    auto count = [&](size_t from, size_t to) {
+        return b.resultSize(server, b.context, sessionId, sessionContext, nodeId, from, to);
+    };
+    r            = RawBounds();
+    r.startIndex = storeEnd;
+    r.endIndex   = storeEnd;
+    if (end == UA_INT64_MIN)
+        r.reverse = false;
+    else if (start == UA_INT64_MIN)
+        r.reverse = true;
+    else
+        r.reverse = end < start;
+    size_t size = 0;
+    if (last != storeEnd) {
+        if (start == end) {
+            if (returnBounds) {
+                r.startIndex = match(start, MATCH_EQUAL_OR_BEFORE);
+                if (r.startIndex == storeEnd) {
+                    r.startIndex = match(start, MATCH_AFTER);
+                    r.addFirst   = true;
+                }
+                r.endIndex = match(start, MATCH_AFTER);
+                size       = count(r.startIndex, r.endIndex);
+            }
+            else {
+                r.startIndex = match(start, MATCH_EQUAL);
+                r.endIndex   = r.startIndex;
+                size         = (r.startIndex == storeEnd) ? 0 : 1;
+            }
+        }
+        else if (start == UA_INT64_MIN) {
+            r.endIndex = first;
+            if (returnBounds) {
+                r.addLast    = true;
+                r.startIndex = match(end, MATCH_EQUAL_OR_AFTER);
+                if (r.startIndex == storeEnd) {
+                    r.startIndex = match(end, MATCH_EQUAL_OR_BEFORE);
+                    r.addFirst   = true;
+                }
+            }
+            else {
+                r.startIndex = match(end, MATCH_EQUAL_OR_BEFORE);
+            }
+            size = count(r.endIndex, r.startIndex);
+        }
+        else if (end == UA_INT64_MIN) {
+            r.endIndex = last;
+            if (returnBounds) {
+                r.addLast    = true;
+                r.startIndex = match(start, MATCH_EQUAL_OR_BEFORE);
+                if (r.startIndex == storeEnd) {
+                    r.startIndex = match(start, MATCH_AFTER);
+                    r.addFirst   = true;
+                }
+            }
+            else {
+                r.startIndex = match(start, MATCH_EQUAL_OR_AFTER);
+            }
+            size = count(r.startIndex, r.endIndex);
+        }
+        else if (r.reverse) {
+            if (returnBounds) {
+                r.startIndex = match(start, MATCH_EQUAL_OR_AFTER);
+                if (r.startIndex == storeEnd) {
+                    r.addFirst   = true;
+                    r.startIndex = match(start, MATCH_BEFORE);
+                }
+                r.endIndex = match(end, MATCH_EQUAL_OR_BEFORE);
+                if (r.endIndex == storeEnd) {
+                    r.addLast  = true;
+                    r.endIndex = match(end, MATCH_AFTER);
+                }
+            }
+            else {
+                r.startIndex = match(start, MATCH_EQUAL_OR_BEFORE);
+                r.endIndex   = match(end, MATCH_AFTER);
+            }
+            size = count(r.endIndex, r.startIndex);
+        }
+        else {
+            if (returnBounds) {
+                r.startIndex = match(start, MATCH_EQUAL_OR_BEFORE);
+                if (r.startIndex == storeEnd) {
+                    r.addFirst   = true;
+                    r.startIndex = match(start, MATCH_AFTER);
+                }
+                r.endIndex = match(end, MATCH_EQUAL_OR_AFTER);
+                if (r.endIndex == storeEnd) {
+                    r.addLast  = true;
+                    r.endIndex = match(end, MATCH_BEFORE);
+                }
+            }
+            else {
+                r.startIndex = match(start, MATCH_EQUAL_OR_AFTER);
+                r.endIndex   = match(end, MATCH_BEFORE);
+            }
+            size = count(r.startIndex, r.endIndex);
+        }
+    }
+    else if (returnBounds) {
+        r.addLast  = true;
+        r.addFirst = true;
+    }
+    if (r.addLast)
+        ++size;
+    if (r.addFirst)
+        ++size;
+    if ((numValuesPerNode > 0) && (size > numValuesPerNode)) {
+        size      = numValuesPerNode;
+        r.addLast = false;
+    }
+    return size;
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::readHistory
+    \return status
+*/
+UA_StatusCode Open62541::ParallelHistoryDatabase::readHistory(UA_Server* server,
+                                                              const UA_NodeId* sessionId,
+                                                              void* sessionContext,
+                                                              const UA_HistoryDataBackend& b,
+                                                              const UA_ReadRawModifiedDetails& details,
+                                                              UA_TimestampsToReturn /*timestampsToReturn*/,
+                                                              UA_Boolean releaseContinuationPoints,
+                                                              size_t maxSize,
+                                                              UA_NumericRange range,
+                                                              const UA_NodeId* nodeId,
+                                                              const UA_ByteString* continuationPoint,
+                                                              UA_ByteString* outContinuationPoint,
+                                                              UA_HistoryData* result)
+{
+    const UA_DateTime start = details.startTime;
+    const UA_DateTime end   = details.endTime;
+    // our continuation point is the number of values already sent followed by the backend's own
+    size_t skip = 0;
+    UA_ByteString backendIn;
+    UA_ByteString_init(&backendIn);
+    if (continuationPoint && (continuationPoint->length > 0)) {
+        if (continuationPoint->length < sizeof(size_t))
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        memcpy(&skip, continuationPoint->data, sizeof(size_t));
+        backendIn.length = continuationPoint->length - sizeof(size_t);
+        backendIn.data   = continuationPoint->data + sizeof(size_t);
+    }
+    size_t storeEnd = b.getEnd(server, b.context, sessionId, sessionContext, nodeId);
+    RawBounds r;
+    size_t total = rawResultSize(b,
+                                 server,
+                                 sessionId,
+                                 sessionContext,
+                                 nodeId,
+                                 start,
+                                 end,
+                                 (details.numValuesPerNode == 0) ? 0 : details.numValuesPerNode + (UA_UInt32)skip,
+                                 details.returnBounds,
+                                 r);
+    size_t n = (total > skip) ? total - skip : 0;
+    if (n > maxSize)
+        n = maxSize;
+    UA_DataValue* out = nullptr;
+    if (n > 0) {
+        out = static_cast<UA_DataValue*>(UA_Array_new(n, &UA_TYPES[UA_TYPES_DATAVALUE]));
+        if (!out)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    size_t counter = 0;
+    if (r.addFirst && (skip == 0) && (counter < n)) {
+        out[counter].hasStatus          = true;
+        out[counter].status             = UA_STATUSCODE_BADBOUNDNOTFOUND;
+        out[counter].hasSourceTimestamp = true;
+        out[counter].sourceTimestamp    = (start == UA_INT64_MIN) ? end : start;
+        ++counter;
+    }
+    UA_ByteString backendOut;
+    UA_ByteString_init(&backendOut);
+    if ((r.endIndex != storeEnd) && (r.startIndex != storeEnd) && (counter < n)) {
+        size_t provided  = 0;
+        size_t valueSize = n - counter;
+        size_t values    = total - (r.addFirst ? 1 : 0) - (r.addLast ? 1 : 0);
+        if ((valueSize + skip) > values)
+            valueSize = (skip == 0) ? values : total - skip - (r.addLast ? 1 : 0);
+        UA_StatusCode ret = UA_STATUSCODE_GOOD;
+        if (valueSize > 0)
+            ret = b.copyDataValues(server,
+                                   b.context,
+                                   sessionId,
+                                   sessionContext,
+                                   nodeId,
+                                   r.startIndex,
+                                   r.endIndex,
+                                   r.reverse,
+                                   valueSize,
+                                   range,
+                                   releaseContinuationPoints,
+                                   &backendIn,
+                                   &backendOut,
+                                   &provided,
+                                   &out[counter]);
+        if (ret != UA_STATUSCODE_GOOD) {
+            UA_Array_delete(out, n, &UA_TYPES[UA_TYPES_DATAVALUE]);
+            UA_ByteString_clear(&backendOut);
+            return ret;
+        }
+        counter += provided;
+    }
+    if (r.addLast && (counter < n)) {
+        out[counter].hasStatus          = true;
+        out[counter].status             = UA_STATUSCODE_BADBOUNDNOTFOUND;
+        out[counter].hasSourceTimestamp = true;
+        size_t first = b.firstIndex(server, b.context, sessionId, sessionContext, nodeId);
+        const UA_DataValue* e =
+            (storeEnd != first) ? b.getDataValue(server, b.context, sessionId, sessionContext, nodeId, r.endIndex) : nullptr;
+        if ((start == UA_INT64_MIN) && e)
+            out[counter].sourceTimestamp = e->sourceTimestamp - UA_DATETIME_SEC;
+        else if ((end == UA_INT64_MIN) && e)
+            out[counter].sourceTimestamp = e->sourceTimestamp + UA_DATETIME_SEC;
+        else
+            out[counter].sourceTimestamp = end;
+    }
+    result->dataValues     = out;
+    result->dataValuesSize = n;
+    // more values to come - in this range, in the backend, or only a bound was sent
+    if (((skip + n) < total) || ((backendOut.length > 0) && (details.numValuesPerNode != 0)) ||
+        ((skip == 0) && r.addFirst && (n == 1))) {
+        if (UA_ByteString_allocBuffer(outContinuationPoint, backendOut.length + sizeof(size_t)) != UA_STATUSCODE_GOOD) {
+            UA_ByteString_clear(&backendOut);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        size_t next = skip + n;
+        memcpy(outContinuationPoint->data, &next, sizeof(size_t));
+        if (backendOut.length > 0)
+            memcpy(outContinuationPoint->data + sizeof(size_t), backendOut.data, backendOut.length);
+    }
+    UA_ByteString_clear(&backendOut);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::ParallelHistoryDatabase
+    \param gathering
+*/
+Open62541::ParallelHistoryDatabase::ParallelHistoryDatabase(const UA_HistoryDataGathering& gathering)
+    : _gathering(gathering)
+{
+    _default = UA_HistoryDatabase_default(gathering);
+    initialise();
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::~ParallelHistoryDatabase
+*/
+Open62541::ParallelHistoryDatabase::~ParallelHistoryDatabase() { deleteMembers(); }
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::deleteMembers
+    Also clears the gathering
+*/
+void Open62541::ParallelHistoryDatabase::deleteMembers()
+{
+    if (_default.context && _default.clear)
+        _default.clear(&_default);
+    _default.context = nullptr;
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::setValue
+*/
+void Open62541::ParallelHistoryDatabase::setValue(Context& c, UA_Boolean historizing, const UA_DataValue* value)
+{
+    if (_default.context && _default.setValue)
+        _default.setValue(c.server.server(),
+                          _default.context,
+                          c.sessionId.constRef(),
+                          c.sessionContext,
+                          c.nodeId.constRef(),
+                          historizing,
+                          value);
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::updateData
+    Inserts into a C++ backend are passed to it as one batch so it can sort and merge them in one pass -
+    everything else goes to the default database, which calls the backend once per value
+*/
+void Open62541::ParallelHistoryDatabase::updateData(Context& c,
+                                                    const UA_RequestHeader* requestHeader,
+                                                    const UA_UpdateDataDetails* details,
+                                                    UA_HistoryUpdateResult* result)
+{
+    if (details && result && (details->performInsertReplace == UA_PERFORMUPDATETYPE_INSERT) &&
+        (details->updateValuesSize > 1) && _gathering.getHistorizingSetting) {
+        UA_Server* server = c.server.server();
+        const UA_HistorizingNodeIdSettings* setting =
+            _gathering.getHistorizingSetting(server, _gathering.context, &details->nodeId);
+        HistoryDataBackend* b = setting ? HistoryDataBackend::fromBackend(setting->historizingBackend) : nullptr;
+        if (b) {
+            UA_Byte accessLevel = 0;
+            UA_Server_readAccessLevel(server, details->nodeId, &accessLevel);
+            if (!(accessLevel & UA_ACCESSLEVELMASK_HISTORYWRITE)) {
+                result->statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
+                return;
+            }
+            UA_Boolean historizing = false;
+            UA_Server_readHistorizing(server, details->nodeId, &historizing);
+            if (!historizing) {
+                result->statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
+                return;
+            }
+            result->operationResults = static_cast<UA_StatusCode*>(
+                UA_Array_new(details->updateValuesSize, &UA_TYPES[UA_TYPES_STATUSCODE]));
+            if (!result->operationResults) {
+                result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+                return;
+            }
+            result->operationResultsSize = details->updateValuesSize;
+            HistoryDataBackend::Context bc(server, c.sessionId.constRef(), c.sessionContext, &details->nodeId);
+            result->statusCode =
+                b->insertDataValues(bc, details->updateValues, details->updateValuesSize, result->operationResults);
+            return;
+        }
+    }
+    if (_default.context && _default.updateData)
+        _default.updateData(c.server.server(),
+                            _default.context,
+                            c.sessionId.constRef(),
+                            c.sessionContext,
+                            requestHeader,
+                            details,
+                            result);
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::deleteRawModified
+*/
+void Open62541::ParallelHistoryDatabase::deleteRawModified(Context& c,
+                                                           const UA_RequestHeader* requestHeader,
+                                                           const UA_DeleteRawModifiedDetails* details,
+                                                           UA_HistoryUpdateResult* result)
+{
+    if (_default.context && _default.deleteRawModified)
+        _default.deleteRawModified(c.server.server(),
+                                   _default.context,
+                                   c.sessionId.constRef(),
+                                   c.sessionContext,
+                                   requestHeader,
+                                   details,
+                                   result);
+}
+
+/*!
+    \brief Open62541::ParallelHistoryDatabase::readRaw
+*/
+void Open62541::ParallelHistoryDatabase::readRaw(Context& c,
+                                                 const UA_RequestHeader* /*requestHeader*/,
+                                                 const UA_ReadRawModifiedDetails* historyReadDetails,
+                                                 UA_TimestampsToReturn timestampsToReturn,
+                                                 UA_Boolean releaseContinuationPoints,
+                                                 size_t nodesToReadSize,
+                                                 const UA_HistoryReadValueId* nodesToRead,
+                                                 UA_HistoryReadResponse* response,
+                                                 UA_HistoryData* const* const historyData)
+{
+    UA_Server* server          = c.server.server();
+    const UA_NodeId* sessionId = c.sessionId.constRef();
+    void* sessionContext       = c.sessionContext;
+    //
+    // the checks touch the address space so are made here, on the server thread
+    std::vector<Read> reads;
+    reads.reserve(nodesToReadSize);
+    for (size_t i = 0; i < nodesToReadSize; i++) {
+        UA_HistoryReadResult& result = response->results[i];
+        const UA_NodeId* nodeId      = &nodesToRead[i].nodeId;
+        UA_Byte accessLevel          = 0;
+        UA_Server_readAccessLevel(server, *nodeId, &accessLevel);
+        if (!(accessLevel & UA_ACCESSLEVELMASK_HISTORYREAD)) {
+            result.statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
+            continue;
+        }
+        UA_Boolean historizing = false;
+        UA_Server_readHistorizing(server, *nodeId, &historizing);
+        const UA_HistorizingNodeIdSettings* setting =
+            (historizing && _gathering.getHistorizingSetting)
+                ? _gathering.getHistorizingSetting(server, _gathering.context, nodeId)
+                : nullptr;
+        if (!setting) {
+            result.statusCode = UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
+            continue;
+        }
+        const UA_HistoryDataBackend& b = setting->historizingBackend;
+        if (historyReadDetails->returnBounds &&
+            !(b.boundSupported && b.boundSupported(server, b.context, sessionId, sessionContext, nodeId))) {
+            result.statusCode = UA_STATUSCODE_BADBOUNDNOTSUPPORTED;
+            continue;
+        }
+        if (!(b.timestampsToReturnSupported &&
+              b.timestampsToReturnSupported(server, b.context, sessionId, sessionContext, nodeId, timestampsToReturn))) {
+            result.statusCode = UA_STATUSCODE_BADTIMESTAMPNOTSUPPORTED;
+            continue;
+        }
+        if (!b.getHistoryData && !(b.getEnd && b.firstIndex && b.lastIndex && b.getDateTimeMatch && b.resultSize &&
+                                   b.copyDataValues && b.getDataValue)) {
+            result.statusCode = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+            continue;
+        }
+        Read r;
+        r.item    = &nodesToRead[i];
+        r.result  = &result;
+        r.data    = historyData[i];
+        r.backend = b;
+        r.maxSize = setting->maxHistoryDataResponseSize;
+        if (nodesToRead[i].indexRange.length > 0) {
+            UA_StatusCode s = UA_NumericRange_parse(&r.range, nodesToRead[i].indexRange);
+            if (s != UA_STATUSCODE_GOOD) {
+                result.statusCode = s;
+                continue;
+            }
+        }
+        reads.push_back(r);
+    }
+    //
+    auto readOne = [&](Read& r) {
+        const UA_HistoryDataBackend& b = r.backend;
+        if (b.getHistoryData) {
+            r.result->statusCode = b.getHistoryData(server,
+                                                    sessionId,
+                                                    sessionContext,
+                                                    &b,
+                                                    historyReadDetails->startTime,
+                                                    historyReadDetails->endTime,
+                                                    &r.item->nodeId,
+                                                    r.maxSize,
+                                                    historyReadDetails->numValuesPerNode,
+                                                    historyReadDetails->returnBounds,
+                                                    timestampsToReturn,
+                                                    r.range,
+                                                    releaseContinuationPoints,
+                                                    &r.item->continuationPoint,
+                                                    &r.result->continuationPoint,
+                                                    r.data);
+        }
+        else {
+            r.result->statusCode = readHistory(server,
+                                               sessionId,
+                                               sessionContext,
+                                               b,
+                                               *historyReadDetails,
+                                               timestampsToReturn,
+                                               releaseContinuationPoints,
+                                               r.maxSize,
+                                               r.range,
+                                               &r.item->nodeId,
+                                               &r.item->continuationPoint,
+                                               &r.result->continuationPoint,
+                                               r.data);
+        }
+        if (r.range.dimensionsSize > 0)
+            UA_free(r.range.dimensions);
+    };
+    //
+    WorkerPool& pool = _pool ? *_pool : c.server.workers();
+    if ((reads.size() < _threshold) || !pool.running() || (pool.size() == 0)) {
+        for (Read& r : reads)
+            readOne(r);
+        _serialReads++;
+    }
+    else {
+        // each job takes the next unread node until none are left - the calling thread joins in
+        std::atomic<size_t> next{0};
+        std::mutex m;
+        std::condition_variable cv;
+        size_t finished = 0;
+        auto drain      = [&]() {
+            for (size_t k = next++; k < reads.size(); k = next++)
+                readOne(reads[k]);
+        };
+        size_t jobs   = std::min(pool.size(), reads.size() - 1);
+        size_t posted = 0;
+        for (size_t j = 0; j < jobs; j++) {
+            if (pool.post([&]() {
+                    drain();
+                    std::lock_guard<std::mutex> l(m);
+                    finished++;
+                    cv.notify_one();
+                }))
+                posted++;
+        }
+        drain();
+        std::unique_lock<std::mutex> l(m);
+        cv.wait(l, [&]() { return finished == posted; });
+        _parallelReads++;
+    }
+    response->responseHeader.serviceResult = UA_STATUSCODE_GOOD;
+}
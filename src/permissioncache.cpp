@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/permissioncache.h>
+
+/*!
+    \brief Open62541::PermissionCache::Table::find
+    \param node
+    \param op
+    \param v
+    \return true if a decision is known
+*/
+bool Open62541::PermissionCache::Table::find(const UA_NodeId& node, Operation op, UA_UInt32& v) const
+{
+    const UA_UInt32 bit = 1u << op;
+    ReadLock l(_mutex);
+    auto i = _entries.find(node);
+    if ((i != _entries.end()) && (i->second.known & bit)) {
+        v = i->second.value[op];
+        return true;
+    }
+    if (_defaults & bit) {
+        v = _default[op];
+        return true;
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::PermissionCache::Table::put
+    \param node
+    \param op
+    \param v
+    \param maxEntries
+*/
+void Open62541::PermissionCache::Table::put(const UA_NodeId& node, Operation op, UA_UInt32 v, size_t maxEntries)
+{
+    WriteLock l(_mutex);
+    Entry* e = _entries.value(node);
+    if (!e) {
+        if (_entries.size() >= maxEntries)
+            _entries.clearAll();
+        e = &_entries.put(node);
+    }
+    e->known |= 1u << op;
+    e->value[op] = v;
+}
+
+/*!
+    \brief Open62541::PermissionCache::Table::setDefault
+    \param op
+    \param v
+*/
+void Open62541::PermissionCache::Table::setDefault(Operation op, UA_UInt32 v)
+{
+    WriteLock l(_mutex);
+    _defaults |= 1u << op;
+    _default[op] = v;
+}
+
+/*!
+    \brief Open62541::PermissionCache::Table::clearDefault
+    \param op
+*/
+void Open62541::PermissionCache::Table::clearDefault(Operation op)
+{
+    WriteLock l(_mutex);
+    _defaults &= ~(1u << op);
+    _default[op] = 0;
+}
+
+/*!
+    \brief Open62541::PermissionCache::Table::remove
+    \param node
+*/
+void Open62541::PermissionCache::Table::remove(const UA_NodeId& node)
+{
+    WriteLock l(_mutex);
+    _entries.remove(node);
+}
+
+/*!
+    \brief Open62541::PermissionCache::Table::clear
+    \param all also drop the defaults
+*/
+void Open62541::PermissionCache::Table::clear(bool all)
+{
+    WriteLock l(_mutex);
+    _entries.clearAll();
+    if (all)
+        _defaults = 0;
+}
+
+/*!
+    \brief Open62541::PermissionCache::sessionTable
+    \param session
+    \return the session's table or nullptr
+*/
+Open62541::PermissionCache::TableRef Open62541::PermissionCache::sessionTable(const UA_NodeId& session) const
+{
+    ReadLock l(_mutex);
+    auto i = _sessions.find(session);
+    return (i != _sessions.end()) ? i->second : TableRef();
+}
+
+/*!
+    \brief Open62541::PermissionCache::find
+    \param session
+    \param node
+    \param op
+    \param v
+    \return true if a decision is cached
+*/
+bool Open62541::PermissionCache::find(const UA_NodeId& session, const UA_NodeId& node, Operation op, UA_UInt32& v) const
+{
+    if (!_enabled || (op >= OperationCount))
+        return false;
+    TableRef t = sessionTable(session);
+    return t && t->find(node, op, v);
+}
+
+/*!
+    \brief Open62541::PermissionCache::put
+    \param session
+    \param node
+    \param op
+    \param v
+*/
+void Open62541::PermissionCache::put(const UA_NodeId& session, const UA_NodeId& node, Operation op, UA_UInt32 v)
+{
+    if (!_enabled || (op >= OperationCount))
+        return;
+    TableRef t = table(session, true);
+    t->put(node, op, v, _maxEntries);
+}
+
+/*!
+    \brief Open62541::PermissionCache::table
+    \param session
+    \param create
+    \return
+*/
+Open62541::PermissionCache::TableRef Open62541::PermissionCache::table(const UA_NodeId& session, bool create)
+{
+    TableRef t = sessionTable(session);
+    if (t || !create)
+        return t;
+    WriteLock l(_mutex);
+    TableRef* p = _sessions.value(session);  // another thread may have made it
+    if (!p)
+        p = &_sessions.put(session, std::make_shared<Table>());
+    return *p;
+}
+
+/*!
+    \brief Open62541::PermissionCache::profile
+    \param name
+    \return
+*/
+Open62541::PermissionCache::TableRef Open62541::PermissionCache::profile(const std::string& name)
+{
+    WriteLock l(_mutex);
+    TableRef& t = _profiles[name];
+    if (!t)
+        t = std::make_shared<Table>();
+    return t;
+}
+
+/*!
+    \brief Open62541::PermissionCache::setProfile
+    \param session
+    \param name
+*/
+void Open62541::PermissionCache::setProfile(const UA_NodeId& session, const std::string& name)
+{
+    WriteLock l(_mutex);
+    TableRef& t = _profiles[name];
+    if (!t)
+        t = std::make_shared<Table>();
+    _sessions.put(session, t);
+}
+
+/*!
+    \brief Open62541::PermissionCache::removeProfile
+    \param name
+*/
+void Open62541::PermissionCache::removeProfile(const std::string& name)
+{
+    WriteLock l(_mutex);
+    _profiles.erase(name);
+}
+
+/*!
+    \brief Open62541::PermissionCache::removeSession
+    \param session
+*/
+void Open62541::PermissionCache::removeSession(const UA_NodeId& session)
+{
+    WriteLock l(_mutex);
+    _sessions.remove(session);
+}
+
+/*!
+    \brief Open62541::PermissionCache::invalidate
+*/
+void Open62541::PermissionCache::invalidate()
+{
+    ReadLock l(_mutex);
+    for (auto i = _sessions.begin(); i != _sessions.end(); i++) {
+        i->second->clear();
+    }
+    for (auto i = _profiles.begin(); i != _profiles.end(); i++) {
+        i->second->clear();
+    }
+}
+
+/*!
+    \brief Open62541::PermissionCache::invalidateSession
+    \param session
+*/
+void Open62541::PermissionCache::invalidateSession(const UA_NodeId& session)
+{
+    // dropping the binding is enough - a private table is released, a shared one is left to its profile
+    removeSession(session);
+}
+
+/*!
+    \brief Open62541::PermissionCache::invalidateProfile
+    \param name
+*/
+void Open62541::PermissionCache::invalidateProfile(const std::string& name)
+{
+    ReadLock l(_mutex);
+    auto i = _profiles.find(name);
+    if (i != _profiles.end())
+        i->second->clear();
+}
+
+/*!
+    \brief Open62541::PermissionCache::invalidateNode
+    \param node
+*/
+void Open62541::PermissionCache::invalidateNode(const UA_NodeId& node)
+{
+    ReadLock l(_mutex);
+    for (auto i = _sessions.begin(); i != _sessions.end(); i++) {
+        i->second->remove(node);
+    }
+    for (auto i = _profiles.begin(); i != _profiles.end(); i++) {
+        i->second->remove(node);
+    }
+}
+
+/*!
+    \brief Open62541::PermissionCache::clear
+*/
+void Open62541::PermissionCache::clear()
+{
+    WriteLock l(_mutex);
+    _sessions.clearAll();
+    _profiles.clear();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/pollscheduler.h>
+#include <open62541cpp/open62541server.h>
+
+/*!
+    \brief Open62541::PollScheduler::PollScheduler
+    \param s
+    \param phases
+*/
+Open62541::PollScheduler::PollScheduler(Server& s, size_t phases)
+    : _server(s)
+    , _phases(phases)
+    , _self(std::make_shared<PollScheduler*>(this))
+{
+    _server.setPollScheduler(this);
+}
+
+/*!
+    \brief Open62541::PollScheduler::~PollScheduler
+*/
+Open62541::PollScheduler::~PollScheduler()
+{
+    if (_server.pollScheduler() == this)
+        _server.setPollScheduler(nullptr);
+    _self.reset();    // posted applies become no-ops
+    _groups.clear();  // stops polling
+}
+
+/*!
+    \brief Open62541::PollScheduler::add
+    \param node
+    \param intervalMs
+    \param func
+    \return
+*/
+bool Open62541::PollScheduler::add(const NodeId& node, unsigned intervalMs, PollFunc func)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node.get());
+    if (e && !e->removed)
+        return false;
+    if (!e)
+        e = &_entries.put(node.get());
+    e->removed  = false;
+    e->interval = intervalMs ? intervalMs : 1;
+    e->func     = std::make_shared<PollFunc>(func);
+    return true;
+}
+
+/*!
+    \brief Open62541::PollScheduler::remove
+    \param node
+    \return
+*/
+bool Open62541::PollScheduler::remove(const NodeId& node)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node.get());
+        if (!e || e->removed)
+            return false;
+        e->removed = true;
+        e->func.reset();
+    }
+    schedule(node.get());
+    return true;
+}
+
+/*!
+    \brief Open62541::PollScheduler::request
+    \param node
+    \param intervalMs
+    \return
+*/
+bool Open62541::PollScheduler::request(const NodeId& node, unsigned intervalMs)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node.get());
+        if (!e || e->removed)
+            return false;
+        e->requested = intervalMs;
+    }
+    schedule(node.get());
+    return true;
+}
+
+/*!
+    \brief Open62541::PollScheduler::monitored
+    \param node
+    \param removed
+*/
+void Open62541::PollScheduler::monitored(const UA_NodeId& node, bool removed)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node);
+        if (!e)
+            return;  // not a polled node
+        if (!removed)
+            e->monitors++;
+        else if (e->monitors)
+            e->monitors--;
+    }
+    schedule(node);
+}
+
+/*!
+    \brief Open62541::PollScheduler::schedule
+    Post an apply to the server loop - at most one outstanding per node
+    \param node
+*/
+void Open62541::PollScheduler::schedule(const UA_NodeId& node)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node);
+        if (!e || e->queued)
+            return;
+        e->queued = true;
+    }
+    std::weak_ptr<PollScheduler*> w = _self;
+    NodeId n(node);
+    if (!_server.postCommand([w, n](Server&) {
+            auto p = w.lock();
+            if (p)
+                (*p)->apply(n);
+        })) {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node);
+        if (e)
+            e->queued = false;  // the next change tries again
+    }
+}
+
+/*!
+    \brief Open62541::PollScheduler::apply
+    Start, stop or move a node's polling to match its monitored items - server loop thread
+    \param node
+*/
+void Open62541::PollScheduler::apply(const NodeId& node)
+{
+    unsigned want    = 0;
+    unsigned have    = 0;
+    UA_UInt64 member = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node.get());
+        if (!e)
+            return;
+        e->queued = false;
+        if (!e->removed && e->monitors)
+            want = (e->requested && (e->requested < e->interval)) ? e->requested : e->interval;
+        have   = e->group;
+        member = e->member;
+        if (want == have) {
+            if (e->removed)
+                _entries.remove(node.get());
+            return;
+        }
+    }
+    // groups run their members with the group locked and members take _mutex - so not held here
+    if (have) {
+        auto g = _groups.find(have);
+        if (g != _groups.end()) {
+            g->second->remove(member);
+            if (g->second->size() == 0)
+                _groups.erase(g);
+        }
+        _active--;
+    }
+    UA_UInt64 id = 0;
+    if (want) {
+        auto& g = _groups[want];
+        if (!g) {
+            g.reset(new ServerCallbackGroup(_server, want, _phases));
+            g->start();
+        }
+        id = g->add([this, node] { poll(node); });
+        _active++;
+    }
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node.get());
+    if (e) {
+        e->group  = want;
+        e->member = id;
+        if (e->removed && !want)
+            _entries.remove(node.get());
+    }
+}
+
+/*!
+    \brief Open62541::PollScheduler::poll
+    \param node
+*/
+void Open62541::PollScheduler::poll(const NodeId& node)
+{
+    std::shared_ptr<PollFunc> f;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Entry* e = _entries.value(node.get());
+        if (e)
+            f = e->func;
+    }
+    if (f && *f) {
+        (*f)(_server, node);
+        _polls++;
+    }
+}
@@ -0,0 +1,911 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/pubsub.h>
+#include <open62541cpp/open62541server.h>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#ifdef UA_ENABLE_PUBSUB
+#ifndef UA_ENABLE_AMALGAMATION
+#include "open62541/plugin/pubsub_udp.h"
+#ifdef UA_ENABLE_PUBSUB_ETH_UADP
+#include "open62541/plugin/pubsub_ethernet.h"
+#endif
+#endif
+#ifdef UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING
+#include <pthread.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#endif
+
+namespace {
+/*!
+    \brief stringView
+    \param s
+    \return UA_String referencing s - valid while s is
+*/
+UA_String stringView(const std::string& s)
+{
+    UA_String r;
+    r.length = s.size();
+    r.data   = (UA_Byte*)(s.data());
+    return r;
+}
+
+/*!
+    \brief storeValue
+    Update a realtime field buffer. Fixed size values are copied in place, so memory bound to the field keeps
+    its address; other types are replaced unless the buffer is bound memory
+    \param dst field buffer
+    \param src same type and length as the buffer
+    \return status code
+*/
+UA_StatusCode storeValue(UA_DataValue& dst, const UA_Variant& src)
+{
+    UA_Variant& d = dst.value;
+    if ((src.type != d.type) || (src.arrayLength != d.arrayLength) || !src.data)
+        return UA_STATUSCODE_BADTYPEMISMATCH;  // the offsets of a fixed layout would move
+    if (src.type->pointerFree) {
+        const size_t n = UA_Variant_isScalar(&src) ? 1 : src.arrayLength;
+        memcpy(d.data, src.data, n * src.type->memSize);  // no allocation
+        return UA_STATUSCODE_GOOD;
+    }
+    if (d.storageType == UA_VARIANT_DATA_NODELETE)
+        return UA_STATUSCODE_BADTYPEMISMATCH;  // bound memory cannot take a value of varying size
+    UA_Variant t;
+    UA_StatusCode ret = UA_Variant_copy(&src, &t);
+    if (ret == UA_STATUSCODE_GOOD) {
+        UA_Variant_clear(&d);
+        d = t;
+    }
+    return ret;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::PubSubFieldContext::readData
+    \param range
+    \param value
+    \return true on success
+*/
+bool Open62541::PubSubFieldContext::readData(Server& /*server*/,
+                                             NodeId& /*node*/,
+                                             const UA_NumericRange* range,
+                                             UA_DataValue& value)
+{
+    if (!_value || !_value->hasValue)
+        return false;
+    if (range) {
+        if (UA_Variant_copyRange(&_value->value, &value.value, *range) != UA_STATUSCODE_GOOD)
+            return false;
+        value.hasValue = true;
+        return true;
+    }
+    return UA_DataValue_copy(_value, &value) == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::PubSubFieldContext::writeData
+    The encoded size of a fixed layout must not change - only values of the same type and length are taken
+    \param range
+    \param value
+    \return true on success
+*/
+bool Open62541::PubSubFieldContext::writeData(Server& /*server*/,
+                                              NodeId& /*node*/,
+                                              const UA_NumericRange* range,
+                                              const UA_DataValue& value)
+{
+    if (!_value || range || !value.hasValue)
+        return false;
+    return storeValue(*_value, value.value) == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::ServerPubSub::findField
+    \param field
+    \return realtime field or null
+*/
+Open62541::ServerPubSub::RealtimeField* Open62541::ServerPubSub::findField(const NodeId& field)
+{
+    for (auto& f : _fields) {
+        if (UA_NodeId_equal(f->field.constRef(), field.constRef()))
+            return f.get();
+    }
+    return nullptr;
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addUdpTransport
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addUdpTransport()
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_ServerConfig_addPubSubTransportLayer(UA_Server_getConfig(_server.server()),
+                                                         UA_PubSubTransportLayerUDPMP());
+    return lastOK();
+}
+
+#ifdef UA_ENABLE_PUBSUB_ETH_UADP
+/*!
+    \brief Open62541::ServerPubSub::addEthernetTransport
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addEthernetTransport()
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_ServerConfig_addPubSubTransportLayer(UA_Server_getConfig(_server.server()),
+                                                         UA_PubSubTransportLayerEthernet());
+    return lastOK();
+}
+#endif
+
+/*!
+    \brief Open62541::ServerPubSub::addConnection
+    \param name
+    \param profile
+    \param url
+    \param networkInterface
+    \param publisherId
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addConnection(const std::string& name,
+                                            const std::string& profile,
+                                            const std::string& url,
+                                            const std::string& networkInterface,
+                                            UA_UInt16 publisherId,
+                                            NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_PubSubConnectionConfig c;
+    memset(&c, 0, sizeof(c));
+    c.name                = stringView(name);  // the stack copies the configuration
+    c.transportProfileUri = stringView(profile);
+    c.enabled             = UA_TRUE;
+    UA_NetworkAddressUrlDataType address;
+    address.networkInterface = stringView(networkInterface);
+    address.url              = stringView(url);
+    UA_Variant_setScalar(&c.address, &address, &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    c.publisherIdType     = UA_PUBSUB_PUBLISHERID_NUMERIC;
+    c.publisherId.numeric = publisherId;
+    //
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addPubSubConnection(_server.server(), &c, id.ref());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeConnection
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeConnection(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removePubSubConnection(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addPublishedDataSet
+    \param name
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addPublishedDataSet(const std::string& name, NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_PublishedDataSetConfig c;
+    memset(&c, 0, sizeof(c));
+    c.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    c.name                 = stringView(name);
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addPublishedDataSet(_server.server(), &c, id.ref()).addResult;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removePublishedDataSet
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removePublishedDataSet(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removePublishedDataSet(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addField
+    \param dataSet
+    \param alias
+    \param variable
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addField(const NodeId& dataSet,
+                                       const std::string& alias,
+                                       const NodeId& variable,
+                                       NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_DataSetFieldConfig c;
+    memset(&c, 0, sizeof(c));
+    c.dataSetFieldType                                   = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    c.field.variable.fieldNameAlias                      = stringView(alias);
+    c.field.variable.promotedField                       = UA_FALSE;
+    c.field.variable.publishParameters.publishedVariable = variable.get();
+    c.field.variable.publishParameters.attributeId       = UA_ATTRIBUTEID_VALUE;
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addDataSetField(_server.server(), dataSet.get(), &c, id.ref()).result;
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addRealtimeField
+    \param dataSet
+    \param alias
+    \param variable
+    \param initial
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addRealtimeField(const NodeId& dataSet,
+                                               const std::string& alias,
+                                               const NodeId& variable,
+                                               const Variant& initial,
+                                               NodeId& id)
+{
+    if (!_server.server() || UA_Variant_isEmpty(initial.constRef()))
+        return false;
+    std::unique_ptr<RealtimeField> f(new RealtimeField);
+    _lastError = UA_Variant_copy(initial.constRef(), &f->value.value);
+    if (!lastOK())
+        return false;
+    f->value.hasValue = true;
+    return addStaticField(dataSet, alias, variable, std::move(f), id);
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addStaticField
+    \param dataSet
+    \param alias
+    \param variable
+    \param f field buffer - value set
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addStaticField(const NodeId& dataSet,
+                                             const std::string& alias,
+                                             const NodeId& variable,
+                                             std::unique_ptr<RealtimeField> f,
+                                             NodeId& id)
+{
+    f->source   = &f->value;
+    f->variable = variable;
+    //
+    UA_DataSetFieldConfig c;
+    memset(&c, 0, sizeof(c));
+    c.dataSetFieldType                                   = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    c.field.variable.fieldNameAlias                      = stringView(alias);
+    c.field.variable.promotedField                       = UA_FALSE;
+    c.field.variable.publishParameters.publishedVariable = variable.get();
+    c.field.variable.publishParameters.attributeId       = UA_ATTRIBUTEID_VALUE;
+    c.field.variable.rtValueSource.rtFieldSourceEnabled  = UA_TRUE;
+    c.field.variable.rtValueSource.staticValueSource     = &f->source;  // the stack keeps this pointer
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addDataSetField(_server.server(), dataSet.get(), &c, id.ref()).result;
+    if (!lastOK())
+        return false;
+    f->field = id;
+    _fields.push_back(std::move(f));
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addBoundField
+    \param dataSet
+    \param b
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addBoundField(const NodeId& dataSet, const Binding& b, NodeId& id)
+{
+    if (!_server.server() || !b.data || !b.type || !b.type->pointerFree) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    std::unique_ptr<RealtimeField> f(new RealtimeField);
+    if (b.length > 0)
+        UA_Variant_setArray(&f->value.value, b.data, b.length, b.type);
+    else
+        UA_Variant_setScalar(&f->value.value, b.data, b.type);
+    f->value.value.storageType = UA_VARIANT_DATA_NODELETE;  // the caller owns the memory
+    f->value.hasValue          = true;
+    return addStaticField(dataSet, b.alias, b.variable, std::move(f), id);
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addBoundFields
+    \param dataSet
+    \param b
+    \param ids
+    \return true if all were added
+*/
+bool Open62541::ServerPubSub::addBoundFields(const NodeId& dataSet,
+                                             const std::vector<Binding>& b,
+                                             std::vector<NodeId>& ids)
+{
+    ids.resize(b.size());
+    for (size_t i = 0; i < b.size(); i++) {
+        if (!addBoundField(dataSet, b[i], ids[i]))
+            return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeField
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeField(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removeDataSetField(_server.server(), id.get()).result;
+    if (lastOK()) {
+        for (auto i = _fields.begin(); i != _fields.end(); ++i) {
+            if (UA_NodeId_equal((*i)->field.constRef(), id.constRef())) {
+                if ((*i)->context)
+                    UA_Server_setNodeContext(_server.server(), (*i)->variable.get(), nullptr);
+                _fields.erase(i);
+                break;
+            }
+        }
+    }
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::setFieldValue
+    \param field
+    \param v
+    \return true on success
+*/
+bool Open62541::ServerPubSub::setFieldValue(const NodeId& field, const Variant& v)
+{
+    if (!_server.server())
+        return false;
+    // guards _fields only - the publisher reads the buffer on the server loop without this lock
+    WriteLock l(_server.mutex());
+    RealtimeField* f = findField(field);
+    if (!f)
+        return false;
+    _lastError = storeValue(f->value, *v.constRef());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::bindField
+    \param field
+    \return true on success
+*/
+bool Open62541::ServerPubSub::bindField(const NodeId& field)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    RealtimeField* f = findField(field);
+    if (!f)
+        return false;
+    if (!f->context)
+        f->context.reset(new PubSubFieldContext(&f->value));
+    _lastError = UA_Server_setNodeContext(_server.server(), f->variable.get(), f->context.get());
+    if (lastOK()) {
+        if (!f->context->setAsDataSource(_server, f->variable))
+            _lastError = f->context->lastError();
+    }
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addWriterGroup
+    \param connection
+    \param name
+    \param interval
+    \param writerGroupId
+    \param fixedSize
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addWriterGroup(const NodeId& connection,
+                                             const std::string& name,
+                                             UA_Duration interval,
+                                             UA_UInt16 writerGroupId,
+                                             bool fixedSize,
+                                             NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_WriterGroupConfig c;
+    memset(&c, 0, sizeof(c));
+    c.name               = stringView(name);
+    c.publishingInterval = interval;
+    c.enabled            = UA_FALSE;
+    c.writerGroupId      = writerGroupId;
+    c.encodingMimeType   = UA_PUBSUB_ENCODING_UADP;
+    c.rtLevel            = fixedSize ? UA_PUBSUB_RT_FIXED_SIZE : UA_PUBSUB_RT_NONE;
+    //
+    // a fixed layout carries the same headers in every message so the payload offsets never move
+    UA_UadpWriterGroupMessageDataType m;
+    UA_UadpWriterGroupMessageDataType_init(&m);
+    m.networkMessageContentMask = (UA_UadpNetworkMessageContentMask)(
+        UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID | UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER |
+        UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID | UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER);
+    c.messageSettings.encoding             = UA_EXTENSIONOBJECT_DECODED;
+    c.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPWRITERGROUPMESSAGEDATATYPE];
+    c.messageSettings.content.decoded.data = &m;
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addWriterGroup(_server.server(), connection.get(), &c, id.ref());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeWriterGroup
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeWriterGroup(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removeWriterGroup(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::freezeWriterGroup
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::freezeWriterGroup(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_freezeWriterGroupConfiguration(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::unfreezeWriterGroup
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::unfreezeWriterGroup(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_unfreezeWriterGroupConfiguration(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::setWriterGroupOperational
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::setWriterGroupOperational(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_setWriterGroupOperational(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::setWriterGroupDisabled
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::setWriterGroupDisabled(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_setWriterGroupDisabled(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addDataSetWriter
+    \param writerGroup
+    \param dataSet
+    \param name
+    \param dataSetWriterId
+    \param keyFrameCount
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addDataSetWriter(const NodeId& writerGroup,
+                                               const NodeId& dataSet,
+                                               const std::string& name,
+                                               UA_UInt16 dataSetWriterId,
+                                               UA_UInt32 keyFrameCount,
+                                               NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_DataSetWriterConfig c;
+    memset(&c, 0, sizeof(c));
+    c.name            = stringView(name);
+    c.dataSetWriterId = dataSetWriterId;
+    c.keyFrameCount   = keyFrameCount;
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addDataSetWriter(_server.server(), writerGroup.get(), dataSet.get(), &c, id.ref());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeDataSetWriter
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeDataSetWriter(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removeDataSetWriter(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addReaderGroup
+    \param connection
+    \param name
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addReaderGroup(const NodeId& connection, const std::string& name, NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    UA_ReaderGroupConfig c;
+    memset(&c, 0, sizeof(c));
+    c.name = stringView(name);
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addReaderGroup(_server.server(), connection.get(), &c, id.ref());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeReaderGroup
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeReaderGroup(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removeReaderGroup(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::setReaderGroupOperational
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::setReaderGroupOperational(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_setReaderGroupOperational(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::setReaderGroupDisabled
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::setReaderGroupDisabled(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_setReaderGroupDisabled(_server.server(), id.get());
+    return lastOK();
+}
+
+/*!
+    \brief Open62541::ServerPubSub::addDataSetReader
+    \param readerGroup
+    \param name
+    \param publisherId
+    \param writerGroupId
+    \param dataSetWriterId
+    \param fields
+    \param context
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::addDataSetReader(const NodeId& readerGroup,
+                                               const std::string& name,
+                                               UA_UInt16 publisherId,
+                                               UA_UInt16 writerGroupId,
+                                               UA_UInt16 dataSetWriterId,
+                                               const std::vector<ReaderField>& fields,
+                                               NodeContext* context,
+                                               NodeId& id)
+{
+    if (!_server.server() || fields.empty())
+        return false;
+    for (const ReaderField& f : fields) {
+        if (!f.type)
+            return false;
+    }
+    UA_DataSetReaderConfig c;
+    memset(&c, 0, sizeof(c));
+    c.name = stringView(name);
+    UA_Variant_setScalar(&c.publisherId, &publisherId, &UA_TYPES[UA_TYPES_UINT16]);
+    c.writerGroupId   = writerGroupId;
+    c.dataSetWriterId = dataSetWriterId;
+    //
+    // the fields expected in each message - decoded in this order
+    std::vector<UA_FieldMetaData> meta(fields.size());
+    for (size_t i = 0; i < fields.size(); i++) {
+        UA_FieldMetaData& m = meta[i];
+        UA_FieldMetaData_init(&m);
+        m.name       = stringView(fields[i].name);
+        m.dataType   = fields[i].type->typeId;
+        m.valueRank  = -1;  // scalar
+        m.builtInType = (fields[i].type->typeId.namespaceIndex == 0 &&
+                         fields[i].type->typeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+                         fields[i].type->typeId.identifier.numeric <= UA_NS0ID_DIAGNOSTICINFO)
+                            ? UA_Byte(fields[i].type->typeId.identifier.numeric)
+                            : UA_Byte(UA_NS0ID_EXTENSIONOBJECT);
+    }
+    c.dataSetMetaData.name       = stringView(name);
+    c.dataSetMetaData.fieldsSize = meta.size();
+    c.dataSetMetaData.fields     = meta.data();
+    //
+    WriteLock l(_server.mutex());
+    id.notNull();
+    _lastError = UA_Server_addDataSetReader(_server.server(), readerGroup.get(), &c, id.ref());
+    if (!lastOK())
+        return false;
+    //
+    std::vector<UA_FieldTargetDataType> targets(fields.size());
+    for (size_t i = 0; i < fields.size(); i++) {
+        UA_FieldTargetDataType_init(&targets[i]);
+        targets[i].attributeId  = UA_ATTRIBUTEID_VALUE;
+        targets[i].targetNodeId = fields[i].target.get();
+    }
+    UA_TargetVariablesDataType tv;
+    UA_TargetVariablesDataType_init(&tv);
+    tv.targetVariablesSize = targets.size();
+    tv.targetVariables     = targets.data();
+    _lastError             = UA_Server_DataSetReader_createTargetVariables(_server.server(), id.get(), &tv);
+    if (!lastOK()) {
+        UA_Server_removeDataSetReader(_server.server(), id.get());
+        return false;
+    }
+    //
+    // received values are written to the targets - route their value callbacks to the context
+    if (context) {
+        for (const ReaderField& f : fields) {
+            NodeId n = f.target;
+            UA_Server_setNodeContext(_server.server(), n.get(), context);
+            context->setValueCallback(_server, n);
+        }
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerPubSub::removeDataSetReader
+    \param id
+    \return true on success
+*/
+bool Open62541::ServerPubSub::removeDataSetReader(const NodeId& id)
+{
+    if (!_server.server())
+        return false;
+    WriteLock l(_server.mutex());
+    _lastError = UA_Server_removeDataSetReader(_server.server(), id.get());
+    return lastOK();
+}
+
+#ifdef UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING
+//
+// Publish cycles on dedicated threads. The stack asks for its writer group callbacks through these hooks
+// when built with UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING; each callback gets a thread that sleeps to
+// absolute deadlines, so a late cycle does not shift the ones after it.
+//
+namespace {
+struct PublishCycle {
+    UA_Server* server           = nullptr;
+    UA_ServerCallback callback  = nullptr;
+    void* data                  = nullptr;
+    std::atomic<int64_t> period{0};  // ns
+    std::atomic<bool> running{false};
+    bool detached = false;  // removed from its own cycle - the thread deletes it
+    std::thread thread;
+};
+
+std::mutex cycleMutex;
+std::map<UA_UInt64, std::unique_ptr<PublishCycle>> cycles;
+UA_UInt64 nextCycleId = 1;
+Open62541::ServerPubSub::RealtimeSettings settings;
+
+/*!
+    \brief runCycle
+    \param c
+*/
+void runCycle(PublishCycle* c)
+{
+    Open62541::ServerPubSub::RealtimeSettings rs;
+    {
+        std::lock_guard<std::mutex> l(cycleMutex);
+        rs = settings;  // fixed for the life of the thread
+    }
+#ifdef __linux__
+    if (rs.priority > 0) {
+        sched_param p;
+        p.sched_priority = rs.priority;
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &p);  // needs the privilege - best effort
+    }
+    if (rs.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(rs.cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#endif
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (c->running) {
+        const int64_t ns = next.tv_nsec + c->period;
+        next.tv_sec += time_t(ns / 1000000000);
+        next.tv_nsec = long(ns % 1000000000);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        if (!c->running)
+            break;
+        if (rs.beforePublish)
+            rs.beforePublish();  // sample the bound memory at a fixed point of the cycle
+        c->callback(c->server, c->data);
+    }
+    if (c->detached)
+        delete c;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::ServerPubSub::setRealtimeSettings
+    \param s
+*/
+void Open62541::ServerPubSub::setRealtimeSettings(const RealtimeSettings& s)
+{
+    std::lock_guard<std::mutex> l(cycleMutex);
+    settings = s;
+}
+
+extern "C" {
+/*!
+    \brief UA_PubSubManager_addRepeatedCallback
+    Stack hook - start a publish thread
+*/
+UA_StatusCode UA_PubSubManager_addRepeatedCallback(UA_Server* server,
+                                                   UA_ServerCallback callback,
+                                                   void* data,
+                                                   UA_Double interval_ms,
+                                                   UA_DateTime* /*baseTime*/,
+                                                   UA_TimerPolicy /*timerPolicy*/,
+                                                   UA_UInt64* callbackId)
+{
+    if (!callback || (interval_ms <= 0.0))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::unique_ptr<PublishCycle> c(new PublishCycle);
+    c->server   = server;
+    c->callback = callback;
+    c->data     = data;
+    c->period   = int64_t(interval_ms * 1000000.0);
+    c->running  = true;
+    std::lock_guard<std::mutex> l(cycleMutex);
+    c->thread = std::thread(runCycle, c.get());
+    if (callbackId)
+        *callbackId = nextCycleId;
+    cycles[nextCycleId++] = std::move(c);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief UA_PubSubManager_changeRepeatedCallbackInterval
+    Stack hook - takes effect from the next cycle
+*/
+UA_StatusCode UA_PubSubManager_changeRepeatedCallbackInterval(UA_Server* /*server*/,
+                                                              UA_UInt64 callbackId,
+                                                              UA_Double interval_ms,
+                                                              UA_DateTime* /*baseTime*/,
+                                                              UA_TimerPolicy /*timerPolicy*/)
+{
+    if (interval_ms <= 0.0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::lock_guard<std::mutex> l(cycleMutex);
+    auto i = cycles.find(callbackId);
+    if (i == cycles.end())
+        return UA_STATUSCODE_BADNOTFOUND;
+    i->second->period = int64_t(interval_ms * 1000000.0);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief UA_PubSubManager_removeRepeatedCallback
+    Stack hook - stop a publish thread and wait for its cycle to finish
+*/
+void UA_PubSubManager_removeRepeatedCallback(UA_Server* /*server*/, UA_UInt64 callbackId)
+{
+    std::unique_ptr<PublishCycle> c;
+    {
+        std::lock_guard<std::mutex> l(cycleMutex);
+        auto i = cycles.find(callbackId);
+        if (i == cycles.end())
+            return;
+        c = std::move(i->second);
+        cycles.erase(i);
+    }
+    c->running = false;
+    if (c->thread.get_id() == std::this_thread::get_id()) {
+        c->detached = true;  // removed from its own cycle - the loop exits and frees it
+        c->thread.detach();
+        c.release();
+    }
+    else if (c->thread.joinable()) {
+        c->thread.join();
+    }
+}
+}
+#endif  // UA_ENABLE_PUBSUB_CUSTOM_PUBLISH_HANDLING
+
+#endif  // UA_ENABLE_PUBSUB
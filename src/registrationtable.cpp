@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/registrationtable.h>
+#include <algorithm>
+
+/*!
+    \brief Open62541::RegistrationTable::Filter::key
+    \return cache key of the filter
+*/
+std::string Open62541::RegistrationTable::Filter::key() const
+{
+    std::string k;
+    for (const auto& s : serverUris) {
+        k += s;
+        k += '\n';
+    }
+    k += '\t';
+    for (const auto& s : localeIds) {
+        k += s;
+        k += '\n';
+    }
+    k += '\t';
+    std::vector<std::string> c(capabilities);
+    std::sort(c.begin(), c.end());  // order does not change the result
+    for (const auto& s : c) {
+        k += s;
+        k += '\n';
+    }
+    k += requireLocale ? '1' : '0';
+    return k;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::index
+    \param r
+*/
+void Open62541::RegistrationTable::index(const Registration& r)
+{
+    for (const auto& c : r.capabilities) {
+        _byCapability[c].insert(r.serverUri);
+    }
+    for (const auto& n : r.names) {
+        _byLocale[n.first].insert(r.serverUri);
+    }
+    for (const auto& u : r.discoveryUrls) {
+        _byDiscoveryUrl[u] = r.serverUri;
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::unindex
+    \param r
+*/
+void Open62541::RegistrationTable::unindex(const Registration& r)
+{
+    for (const auto& c : r.capabilities) {
+        auto i = _byCapability.find(c);
+        if (i != _byCapability.end()) {
+            i->second.erase(r.serverUri);
+            if (i->second.empty())
+                _byCapability.erase(i);
+        }
+    }
+    for (const auto& n : r.names) {
+        auto i = _byLocale.find(n.first);
+        if (i != _byLocale.end()) {
+            i->second.erase(r.serverUri);
+            if (i->second.empty())
+                _byLocale.erase(i);
+        }
+    }
+    for (const auto& u : r.discoveryUrls) {
+        auto i = _byDiscoveryUrl.find(u);
+        if ((i != _byDiscoveryUrl.end()) && (i->second == r.serverUri))
+            _byDiscoveryUrl.erase(i);
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::changed
+    Drop the encoded responses - called with the lock held
+*/
+void Open62541::RegistrationTable::changed()
+{
+    _encoded.clear();
+    _generation++;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::removeLocked
+    \param serverUri
+*/
+void Open62541::RegistrationTable::removeLocked(const std::string& serverUri)
+{
+    auto i = _servers.find(serverUri);
+    if (i == _servers.end())
+        return;
+    if (i->second.timer)
+        _wheel.cancel(i->second.timer);
+    unindex(i->second);
+    _servers.erase(i);
+    changed();
+}
+
+/*!
+    \brief Open62541::RegistrationTable::registerServer
+    \param s
+*/
+void Open62541::RegistrationTable::registerServer(const UA_RegisteredServer& s)
+{
+    const std::string uri = toString(s.serverUri);
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!s.isOnline) {
+        removeLocked(uri);
+        return;
+    }
+    Registration r;
+    r.serverUri        = uri;
+    r.productUri       = toString(s.productUri);
+    r.serverType       = s.serverType;
+    r.gatewayServerUri = toString(s.gatewayServerUri);
+    r.lastSeen         = UA_DateTime_nowMonotonic();
+    for (size_t i = 0; i < s.serverNamesSize; i++) {
+        r.names.push_back(std::make_pair(toString(s.serverNames[i].locale), toString(s.serverNames[i].text)));
+    }
+    for (size_t i = 0; i < s.discoveryUrlsSize; i++) {
+        r.discoveryUrls.push_back(toString(s.discoveryUrls[i]));
+    }
+    //
+    auto i = _servers.find(uri);
+    if (i != _servers.end()) {
+        Registration& o = i->second;
+        // a renewal with nothing changed only moves the expiry - the encoded responses stay valid
+        const bool same = (o.productUri == r.productUri) && (o.names == r.names) && (o.serverType == r.serverType) &&
+                          (o.gatewayServerUri == r.gatewayServerUri) && (o.discoveryUrls == r.discoveryUrls);
+        r.capabilities = o.capabilities;  // capabilities come from mDNS, not the registration
+        r.timer        = o.timer;
+        if (!same) {
+            unindex(o);
+            index(r);
+            changed();
+        }
+        o = r;
+    }
+    else {
+        index(r);
+        _servers[uri] = r;
+        changed();
+    }
+    //
+    Registration& e = _servers[uri];
+    if (e.timer) {
+        _wheel.cancel(e.timer);
+        e.timer = 0;
+    }
+    if (_timeout > 0) {
+        e.timer = _wheel.add(_timeout * 1000, 0, [this, uri](UA_UInt64) {
+            auto j = _servers.find(uri);  // advance() holds the table lock
+            if (j != _servers.end()) {
+                j->second.timer = 0;  // fired - nothing to cancel
+                removeLocked(uri);
+            }
+        });
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::serverOnNetwork
+    \param s
+    \param isServerAnnounce
+*/
+void Open62541::RegistrationTable::serverOnNetwork(const UA_ServerOnNetwork& s, bool isServerAnnounce)
+{
+    if (!isServerAnnounce)
+        return;  // the registration expires on its own
+    std::vector<std::string> caps;
+    for (size_t i = 0; i < s.serverCapabilitiesSize; i++) {
+        caps.push_back(toString(s.serverCapabilities[i]));
+    }
+    std::string uri;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        auto i = _byDiscoveryUrl.find(toString(s.discoveryUrl));
+        if (i == _byDiscoveryUrl.end())
+            return;
+        uri = i->second;
+    }
+    setCapabilities(uri, caps);
+}
+
+/*!
+    \brief Open62541::RegistrationTable::setCapabilities
+    \param serverUri
+    \param capabilities
+    \return false if not registered
+*/
+bool Open62541::RegistrationTable::setCapabilities(const std::string& serverUri,
+                                                   const std::vector<std::string>& capabilities)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _servers.find(serverUri);
+    if (i == _servers.end())
+        return false;
+    if (i->second.capabilities != capabilities) {
+        unindex(i->second);
+        i->second.capabilities = capabilities;
+        index(i->second);
+        changed();
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::remove
+    \param serverUri
+    \return false if not registered
+*/
+bool Open62541::RegistrationTable::remove(const std::string& serverUri)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_servers.find(serverUri) == _servers.end())
+        return false;
+    removeLocked(serverUri);
+    return true;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::find
+    \param serverUri
+    \param r
+    \return false if not registered
+*/
+bool Open62541::RegistrationTable::find(const std::string& serverUri, Registration& r) const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _servers.find(serverUri);
+    if (i == _servers.end())
+        return false;
+    r = i->second;
+    return true;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::select
+    Hashed lookups only - the smallest capability set is scanned and checked against the others
+    \param f
+    \param out
+*/
+void Open62541::RegistrationTable::select(const Filter& f, std::vector<const Registration*>& out) const
+{
+    out.clear();
+    auto accept = [this, &f](const std::string& uri) -> const Registration* {
+        auto i = _servers.find(uri);
+        if (i == _servers.end())
+            return nullptr;
+        for (const auto& c : f.capabilities) {
+            auto s = _byCapability.find(c);
+            if ((s == _byCapability.end()) || (s->second.count(uri) == 0))
+                return nullptr;
+        }
+        if (f.requireLocale) {
+            bool found = false;
+            for (const auto& lc : f.localeIds) {
+                auto s = _byLocale.find(lc);
+                if ((s != _byLocale.end()) && (s->second.count(uri) > 0)) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                return nullptr;
+        }
+        return &i->second;
+    };
+    //
+    if (!f.serverUris.empty()) {
+        for (const auto& u : f.serverUris) {
+            if (const Registration* r = accept(u))
+                out.push_back(r);
+        }
+        return;
+    }
+    if (!f.capabilities.empty()) {
+        const std::unordered_set<std::string>* smallest = nullptr;
+        for (const auto& c : f.capabilities) {
+            auto s = _byCapability.find(c);
+            if (s == _byCapability.end())
+                return;  // nobody offers it
+            if (!smallest || (s->second.size() < smallest->size()))
+                smallest = &s->second;
+        }
+        for (const auto& u : *smallest) {
+            if (const Registration* r = accept(u))
+                out.push_back(r);
+        }
+        return;
+    }
+    for (const auto& s : _servers) {
+        if (const Registration* r = accept(s.first))
+            out.push_back(r);
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::describe
+    \param r
+    \param f
+    \param d filled with copies
+*/
+void Open62541::RegistrationTable::describe(const Registration& r, const Filter& f, UA_ApplicationDescription& d) const
+{
+    UA_ApplicationDescription_init(&d);
+    d.applicationUri   = UA_String_fromChars(r.serverUri.c_str());
+    d.productUri       = UA_String_fromChars(r.productUri.c_str());
+    d.applicationType  = r.serverType;
+    d.gatewayServerUri = UA_String_fromChars(r.gatewayServerUri.c_str());
+    const std::pair<std::string, std::string>* name = r.names.empty() ? nullptr : &r.names.front();
+    for (const auto& lc : f.localeIds) {
+        auto n = std::find_if(r.names.begin(), r.names.end(), [&lc](const std::pair<std::string, std::string>& p) {
+            return p.first == lc;
+        });
+        if (n != r.names.end()) {
+            name = &(*n);
+            break;
+        }
+    }
+    if (name)
+        d.applicationName = UA_LOCALIZEDTEXT_ALLOC(name->first.c_str(), name->second.c_str());
+    if (!r.discoveryUrls.empty()) {
+        d.discoveryUrls =
+            static_cast<UA_String*>(UA_Array_new(r.discoveryUrls.size(), &UA_TYPES[UA_TYPES_STRING]));
+        if (d.discoveryUrls) {
+            d.discoveryUrlsSize = r.discoveryUrls.size();
+            for (size_t i = 0; i < r.discoveryUrls.size(); i++) {
+                d.discoveryUrls[i] = UA_String_fromChars(r.discoveryUrls[i].c_str());
+            }
+        }
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::findServers
+    \param f
+    \param out
+*/
+void Open62541::RegistrationTable::findServers(const Filter& f, ApplicationDescriptionArray& out) const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    std::vector<const Registration*> v;
+    select(f, v);
+    out.allocate(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        describe(*v[i], f, out.at(i));
+    }
+}
+
+/*!
+    \brief Open62541::RegistrationTable::encodedServers
+    \param f
+    \return encoded servers array
+*/
+Open62541::RegistrationTable::EncodedRef Open62541::RegistrationTable::encodedServers(const Filter& f)
+{
+    const std::string key = f.key();
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _encoded.find(key);
+    if (i != _encoded.end())
+        return i->second;
+    //
+    std::vector<const Registration*> v;
+    select(f, v);
+    UA_FindServersResponse r;
+    UA_FindServersResponse_init(&r);
+    if (!v.empty()) {
+        r.servers = static_cast<UA_ApplicationDescription*>(
+            UA_Array_new(v.size(), &UA_TYPES[UA_TYPES_APPLICATIONDESCRIPTION]));
+        if (!r.servers)
+            return EncodedRef();
+        r.serversSize = v.size();
+        for (size_t j = 0; j < v.size(); j++) {
+            describe(*v[j], f, r.servers[j]);
+        }
+    }
+    // encode the whole response and keep what follows the (default) header
+    UA_ByteString b;
+    UA_ByteString_init(&b);
+    EncodedRef ret;
+    if (UA_encodeBinary(&r, &UA_TYPES[UA_TYPES_FINDSERVERSRESPONSE], &b) == UA_STATUSCODE_GOOD) {
+        const size_t header = UA_calcSizeBinary(&r.responseHeader, &UA_TYPES[UA_TYPES_RESPONSEHEADER]);
+        if (header <= b.length)
+            ret = std::make_shared<const std::vector<UA_Byte>>(b.data + header, b.data + b.length);
+    }
+    UA_ByteString_clear(&b);
+    UA_FindServersResponse_clear(&r);
+    if (ret) {
+        if (_encoded.size() >= _encodedLimit)
+            _encoded.clear();  // filters vary little - start again rather than track use
+        _encoded[key] = ret;
+    }
+    return ret;
+}
+
+/*!
+    \brief Open62541::RegistrationTable::advance
+    \param now
+    \return number expired
+*/
+size_t Open62541::RegistrationTable::advance(UA_DateTime now)
+{
+    std::lock_guard<std::mutex> l(_mutex);  // before the wheel lock - the expiry handlers use the table
+    return _wheel.advance(now);
+}
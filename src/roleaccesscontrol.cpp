@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/roleaccesscontrol.h>
+#include <open62541cpp/open62541server.h>
+
+namespace {
+/*!
+    \brief handleOf
+    \param h handle table
+    \param n node
+    \return the node's handle - a new one if it has none
+*/
+UA_UInt32 handleOf(Open62541::UnorderedNodeIdMap<UA_UInt32>& h, const UA_NodeId& n)
+{
+    UA_UInt32* p = h.value(n);
+    return p ? *p : h.put(n, UA_UInt32(h.size()));
+}
+
+std::string permissionNames(UA_UInt32 p)
+{
+    static const char* names[] = {"Browse",
+                                  "ReadRolePermissions",
+                                  "WriteAttribute",
+                                  "WriteRolePermissions",
+                                  "WriteHistorizing",
+                                  "Read",
+                                  "Write",
+                                  "ReadHistory",
+                                  "InsertHistory",
+                                  "ModifyHistory",
+                                  "DeleteHistory",
+                                  "ReceiveEvents",
+                                  "Call",
+                                  "AddReference",
+                                  "RemoveReference",
+                                  "DeleteNode",
+                                  "AddNode"};
+    std::string s;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (p & (1u << i)) {
+            if (!s.empty())
+                s += "|";
+            s += names[i];
+        }
+    }
+    return s.empty() ? std::string("None") : s;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::RoleAccessControl::Profile::permissions
+    \param n
+    \return
+*/
+UA_UInt32 Open62541::RoleAccessControl::Profile::permissions(const UA_NodeId& n) const
+{
+    if (compiled) {
+        auto i = compiled->handles.find(n);
+        if ((i != compiled->handles.end()) && (i->second < masks.size()))
+            return masks[i->second];
+    }
+    return (n.namespaceIndex < nameSpaces.size()) ? nameSpaces[n.namespaceIndex] : UA_UInt32(None);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::addRole
+    \param name
+    \return
+*/
+size_t Open62541::RoleAccessControl::addRole(const std::string& name)
+{
+    WriteLock l(_mutex);
+    for (size_t i = 0; i < _roles.size(); i++) {
+        if (_roles[i] == name)
+            return i;
+    }
+    if (_roles.size() >= MaxRoles)
+        return MaxRoles;
+    _roles.push_back(name);
+    return _roles.size() - 1;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::role
+    \param name
+    \return
+*/
+size_t Open62541::RoleAccessControl::role(const std::string& name) const
+{
+    ReadLock l(_mutex);
+    for (size_t i = 0; i < _roles.size(); i++) {
+        if (_roles[i] == name)
+            return i;
+    }
+    return MaxRoles;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::roleSet
+    \param names
+    \param s set to the roles - unknown names are skipped
+    \return false if a name is not a role
+*/
+bool Open62541::RoleAccessControl::roleSet(const std::vector<std::string>& names, RoleSet& s) const
+{
+    s       = 0;
+    bool ok = true;
+    for (const std::string& n : names) {
+        size_t i = 0;
+        while ((i < _roles.size()) && (_roles[i] != n))
+            i++;
+        if (i < _roles.size())
+            s |= RoleSet(1) << i;
+        else
+            ok = false;
+    }
+    return ok;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::addUser
+    \param name
+    \param password
+    \param roles
+    \return
+*/
+bool Open62541::RoleAccessControl::addUser(const std::string& name,
+                                           const std::string& password,
+                                           const std::vector<std::string>& roles)
+{
+    for (const std::string& r : roles) {
+        if (addRole(r) == MaxRoles)
+            return false;
+    }
+    WriteLock l(_mutex);
+    User& u    = _users[name];
+    u.password = password;
+    roleSet(roles, u.roles);
+    return true;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::removeUser
+    Sessions already bound keep their roles until they close
+    \param name
+*/
+void Open62541::RoleAccessControl::removeUser(const std::string& name)
+{
+    WriteLock l(_mutex);
+    _users.erase(name);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::setAnonymousRoles
+    \param roles
+    \return
+*/
+bool Open62541::RoleAccessControl::setAnonymousRoles(const std::vector<std::string>& roles)
+{
+    for (const std::string& r : roles) {
+        if (addRole(r) == MaxRoles)
+            return false;
+    }
+    WriteLock l(_mutex);
+    roleSet(roles, _anonymous);
+    return true;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::addRule
+    \param role
+    \param scope
+    \param node
+    \param ns
+    \param permissions
+    \param deny
+*/
+void Open62541::RoleAccessControl::addRule(size_t role,
+                                           Scope scope,
+                                           const UA_NodeId& node,
+                                           UA_UInt16 ns,
+                                           UA_UInt32 permissions,
+                                           bool deny)
+{
+    WriteLock l(_mutex);
+    if (role >= _roles.size())
+        return;
+    Rule r;
+    r.role        = role;
+    r.scope       = scope;
+    r.node        = NodeId(node);
+    r.nameSpace   = ns;
+    r.permissions = permissions & All;
+    r.deny        = deny;
+    _rules.push_back(r);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::clearRules
+*/
+void Open62541::RoleAccessControl::clearRules()
+{
+    WriteLock l(_mutex);
+    _rules.clear();
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::compileRules
+    \param server
+    \param rules
+    \param roles
+    \return the compiled tables
+*/
+std::unique_ptr<Open62541::RoleAccessControl::Compiled>
+Open62541::RoleAccessControl::compileRules(Server* server, const std::vector<Rule>& rules, size_t roles) const
+{
+    std::unique_ptr<Compiled> c(new Compiled);
+    std::vector<std::vector<UA_UInt32>> allow(roles), deny(roles);
+    std::vector<std::vector<UA_UInt32>> nsAllow(roles), nsDeny(roles);
+    //
+    auto apply = [&](const Rule& r, UA_UInt32 h) {
+        std::vector<UA_UInt32>& m = r.deny ? deny[r.role] : allow[r.role];
+        if (m.size() <= h)
+            m.resize(h + 1, 0);
+        m[h] |= r.permissions;
+    };
+    //
+    BrowseOptions o;
+    o.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    //
+    for (const Rule& r : rules) {
+        switch (r.scope) {
+            case NamespaceScope: {
+                std::vector<UA_UInt32>& m = r.deny ? nsDeny[r.role] : nsAllow[r.role];
+                if (m.size() <= r.nameSpace)
+                    m.resize(size_t(r.nameSpace) + 1, 0);
+                m[r.nameSpace] |= r.permissions;
+            } break;
+            case SubtreeScope:
+                apply(r, handleOf(c->handles, r.node.get()));
+                if (server) {
+                    server->browseVisit(
+                        r.node,
+                        [&](const UA_ReferenceDescription& d, const UA_NodeId&, size_t) {
+                            apply(r, handleOf(c->handles, d.nodeId.nodeId));
+                            return BrowseContinue;
+                        },
+                        o);
+                }
+                break;
+            case NodeScope:
+                apply(r, handleOf(c->handles, r.node.get()));
+                break;
+        }
+    }
+    //
+    // fold the namespace rules into the node masks - a node's mask then stands alone
+    const size_t n = c->handles.size();
+    c->roleMasks.resize(roles);
+    c->nameSpaces.resize(roles);
+    for (size_t i = 0; i < roles; i++) {
+        nsAllow[i].resize(std::max(nsAllow[i].size(), nsDeny[i].size()), 0);
+        nsDeny[i].resize(nsAllow[i].size(), 0);
+        allow[i].resize(n, 0);
+        deny[i].resize(n, 0);
+        c->nameSpaces[i].resize(nsAllow[i].size());
+        for (size_t j = 0; j < nsAllow[i].size(); j++) {
+            c->nameSpaces[i][j] = nsAllow[i][j] & ~nsDeny[i][j];
+        }
+        c->roleMasks[i].resize(n);
+        for (auto j = c->handles.begin(); j != c->handles.end(); j++) {
+            const size_t ns   = j->first.namespaceIndex;
+            const UA_UInt32 h = j->second;
+            UA_UInt32 a       = allow[i][h];
+            UA_UInt32 d       = deny[i][h];
+            if (ns < nsAllow[i].size()) {
+                a |= nsAllow[i][ns];
+                d |= nsDeny[i][ns];
+            }
+            c->roleMasks[i][h] = a & ~d;
+        }
+    }
+    return c;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::compile
+    \param server
+    \return
+*/
+bool Open62541::RoleAccessControl::compile(Server* server)
+{
+    std::vector<Rule> rules;
+    size_t roles = 0;
+    {
+        ReadLock l(_mutex);
+        rules = _rules;
+        roles = _roles.size();
+    }
+    std::unique_ptr<Compiled> c = compileRules(server, rules, roles);
+    //
+    WriteLock l(_mutex);
+    _compiled = CompiledRef(c.release());
+    // rebuild the sessions' tables against the new rules
+    std::unordered_map<RoleSet, ProfileRef> old;
+    old.swap(_profiles);
+    std::unordered_map<const Profile*, ProfileRef> moved;
+    for (auto i = old.begin(); i != old.end(); i++) {
+        moved[i->second.get()] = profile(i->first);
+    }
+    for (auto i = _sessions.begin(); i != _sessions.end(); i++) {
+        auto j = moved.find(i->second.get());
+        if (j != moved.end())
+            i->second = j->second;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::profile
+    \param roles
+    \return the tables of a role set - built on first use
+*/
+Open62541::RoleAccessControl::ProfileRef Open62541::RoleAccessControl::profile(RoleSet roles)
+{
+    ProfileRef& r = _profiles[roles];
+    if (r)
+        return r;
+    std::shared_ptr<Profile> p = std::make_shared<Profile>();
+    p->compiled                = _compiled;
+    if (_compiled) {
+        p->masks.resize(_compiled->handles.size(), 0);
+        for (size_t i = 0; i < _compiled->roleMasks.size(); i++) {
+            if (!(roles & (RoleSet(1) << i)))
+                continue;
+            const std::vector<UA_UInt32>& m = _compiled->roleMasks[i];
+            for (size_t j = 0; j < m.size(); j++) {
+                p->masks[j] |= m[j];
+            }
+            const std::vector<UA_UInt32>& s = _compiled->nameSpaces[i];
+            if (p->nameSpaces.size() < s.size())
+                p->nameSpaces.resize(s.size(), 0);
+            for (size_t j = 0; j < s.size(); j++) {
+                p->nameSpaces[j] |= s[j];
+            }
+        }
+    }
+    r = p;
+    return r;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::authenticate
+    \param user
+    \param password
+    \return
+*/
+bool Open62541::RoleAccessControl::authenticate(const std::string& user, const std::string& password) const
+{
+    ReadLock l(_mutex);
+    auto i = _users.find(user);
+    return (i != _users.end()) && (i->second.password == password);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::bindSession
+    \param session
+    \param user
+    \return
+*/
+bool Open62541::RoleAccessControl::bindSession(const UA_NodeId& session, const std::string& user)
+{
+    WriteLock l(_mutex);
+    auto i = _users.find(user);
+    if (i == _users.end())
+        return false;
+    _sessions.put(session, profile(i->second.roles));
+    return true;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::bindAnonymous
+    \param session
+    \return
+*/
+bool Open62541::RoleAccessControl::bindAnonymous(const UA_NodeId& session)
+{
+    WriteLock l(_mutex);
+    if (!_anonymous)
+        return false;
+    _sessions.put(session, profile(_anonymous));
+    return true;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::unbindSession
+    \param session
+*/
+void Open62541::RoleAccessControl::unbindSession(const UA_NodeId& session)
+{
+    WriteLock l(_mutex);
+    _sessions.remove(session);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::activateSession
+    \param session
+    \param token
+    \return
+*/
+UA_StatusCode Open62541::RoleAccessControl::activateSession(const UA_NodeId& session, const UA_ExtensionObject* token)
+{
+    if (!token || (token->encoding == UA_EXTENSIONOBJECT_ENCODED_NOBODY) ||
+        ((token->encoding >= UA_EXTENSIONOBJECT_DECODED) &&
+         (token->content.decoded.type == &UA_TYPES[UA_TYPES_ANONYMOUSIDENTITYTOKEN]))) {
+        return bindAnonymous(session) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADIDENTITYTOKENINVALID;
+    }
+    if ((token->encoding >= UA_EXTENSIONOBJECT_DECODED) &&
+        (token->content.decoded.type == &UA_TYPES[UA_TYPES_USERNAMEIDENTITYTOKEN]) && token->content.decoded.data) {
+        const UA_UserNameIdentityToken* t =
+            static_cast<const UA_UserNameIdentityToken*>(token->content.decoded.data);
+        const std::string user(reinterpret_cast<const char*>(t->userName.data), t->userName.length);
+        const std::string password(reinterpret_cast<const char*>(t->password.data), t->password.length);
+        if (authenticate(user, password) && bindSession(session, user))
+            return UA_STATUSCODE_GOOD;
+        return UA_STATUSCODE_BADUSERACCESSDENIED;
+    }
+    return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::permissions
+    \param session
+    \param node
+    \return
+*/
+UA_UInt32 Open62541::RoleAccessControl::permissions(const UA_NodeId& session, const UA_NodeId& node) const
+{
+    ReadLock l(_mutex);
+    auto i = _sessions.find(session);
+    return ((i != _sessions.end()) && i->second) ? i->second->permissions(node) : UA_UInt32(None);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::userPermissions
+    \param user
+    \param node
+    \return
+*/
+UA_UInt32 Open62541::RoleAccessControl::userPermissions(const std::string& user, const UA_NodeId& node)
+{
+    WriteLock l(_mutex);
+    auto i = _users.find(user);
+    return (i != _users.end()) ? profile(i->second.roles)->permissions(node) : UA_UInt32(None);
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::accessLevel
+    \param session
+    \param node
+    \return
+*/
+UA_Byte Open62541::RoleAccessControl::accessLevel(const UA_NodeId& session, const UA_NodeId& node) const
+{
+    const UA_UInt32 p = permissions(session, node);
+    UA_Byte a         = 0;
+    if (p & Read)
+        a |= UA_ACCESSLEVELMASK_READ;
+    if (p & Write)
+        a |= UA_ACCESSLEVELMASK_WRITE | UA_ACCESSLEVELMASK_STATUSWRITE | UA_ACCESSLEVELMASK_TIMESTAMPWRITE;
+    if (p & ReadHistory)
+        a |= UA_ACCESSLEVELMASK_HISTORYREAD;
+    if (p & (InsertHistory | ModifyHistory | DeleteHistory))
+        a |= UA_ACCESSLEVELMASK_HISTORYWRITE;
+    return a;
+}
+
+/*!
+    \brief Open62541::RoleAccessControl::print
+    \param os
+*/
+void Open62541::RoleAccessControl::print(std::ostream& os) const
+{
+    ReadLock l(_mutex);
+    os << "Roles:" << std::endl;
+    for (size_t i = 0; i < _roles.size(); i++) {
+        os << "  " << i << " " << _roles[i] << std::endl;
+    }
+    auto roleNames = [this](RoleSet s) {
+        std::string r;
+        for (size_t i = 0; i < _roles.size(); i++) {
+            if (s & (RoleSet(1) << i)) {
+                if (!r.empty())
+                    r += ",";
+                r += _roles[i];
+            }
+        }
+        return r;
+    };
+    os << "Users:" << std::endl;
+    for (auto i = _users.begin(); i != _users.end(); i++) {
+        os << "  " << i->first << " [" << roleNames(i->second.roles) << "]" << std::endl;
+    }
+    os << "  (anonymous) [" << roleNames(_anonymous) << "]" << std::endl;
+    os << "Rules:" << std::endl;
+    for (const Rule& r : _rules) {
+        os << "  " << _roles[r.role] << (r.deny ? " deny " : " grant ") << permissionNames(r.permissions) << " on ";
+        switch (r.scope) {
+            case NamespaceScope:
+                os << "namespace " << r.nameSpace;
+                break;
+            case SubtreeScope:
+                os << "subtree " << toString(r.node.get());
+                break;
+            case NodeScope:
+                os << "node " << toString(r.node.get());
+                break;
+        }
+        os << std::endl;
+    }
+}
@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/serveraggregator.h>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/open62541client.h>
+#include <open62541cpp/clientsubscription.h>
+#include <open62541cpp/monitoreditem.h>
+
+namespace {
+/*!
+    \brief copyValue
+    \param from
+    \param range index range or null
+    \param to
+    \return true if copied
+*/
+bool copyValue(const UA_DataValue& from, const UA_NumericRange* range, UA_DataValue& to)
+{
+    if (range && from.hasValue) {
+        UA_DataValue_init(&to);
+        to.hasValue           = UA_Variant_copyRange(&from.value, &to.value, *range) == UA_STATUSCODE_GOOD;
+        to.hasStatus          = from.hasStatus;
+        to.status             = from.status;
+        to.hasSourceTimestamp = from.hasSourceTimestamp;
+        to.sourceTimestamp    = from.sourceTimestamp;
+        return to.hasValue;
+    }
+    return UA_DataValue_copy(&from, &to) == UA_STATUSCODE_GOOD;
+}
+}  // namespace
+
+/*!
+    \brief The Open62541::ServerAggregator::FeedItem class
+    Downstream monitored item of a shared feed - runs on the session's pump thread
+*/
+class Open62541::ServerAggregator::FeedItem : public MonitoredItemDataChange
+{
+    std::weak_ptr<Feed> _feed;
+
+public:
+    FeedItem(const FeedRef& f, ClientSubscription& s)
+        : MonitoredItemDataChange(s)
+        , _feed(f)
+    {
+    }
+    ~FeedItem()
+    {
+        FeedRef f = _feed.lock();
+        if (f) {
+            std::lock_guard<std::mutex> l(f->mutex);
+            f->valid = false;  // subscription lost or item removed - reads go downstream again
+            f->item  = 0;
+        }
+    }
+    void dataChangeNotification(UA_DataValue* value) override
+    {
+        FeedRef f = _feed.lock();
+        if (f && value) {
+            std::lock_guard<std::mutex> l(f->mutex);
+            f->value.assignFrom(*value);
+            f->valid = true;
+        }
+    }
+};
+
+/*!
+    \brief Open62541::ServerAggregator::ServerAggregator
+    \param s
+    \param pool
+    \param nameSpace
+*/
+Open62541::ServerAggregator::ServerAggregator(Server& s, ClientPool& pool, UA_UInt16 nameSpace)
+    : NodeContext("ServerAggregator")
+    , _server(s)
+    , _pool(pool)
+    , _nameSpace(nameSpace)
+{
+    _server.setAggregator(this);
+}
+
+/*!
+    \brief Open62541::ServerAggregator::~ServerAggregator
+*/
+Open62541::ServerAggregator::~ServerAggregator()
+{
+    if (_server.aggregator() == this)
+        _server.setAggregator(nullptr);
+}
+
+/*!
+    \brief Open62541::ServerAggregator::localId
+    \param mount
+    \param remote
+    \return
+*/
+Open62541::NodeId Open62541::ServerAggregator::localId(const std::string& mount, const UA_NodeId& remote) const
+{
+    return NodeId(_nameSpace, mount + "|" + toString(remote));
+}
+
+/*!
+    \brief Open62541::ServerAggregator::mount
+    \param endpoint
+    \param name
+    \param parent
+    \param remoteRoot
+    \return
+*/
+bool Open62541::ServerAggregator::mount(const std::string& endpoint,
+                                        const std::string& name,
+                                        const NodeId& parent,
+                                        const NodeId& remoteRoot)
+{
+    _pool.add(endpoint);  // already there is fine
+    const NodeId folder = localId(name, remoteRoot.get());
+    size_t index        = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        index = _mounts.size();
+        Mount m;
+        m.endpoint = endpoint;
+        m.name     = name;
+        _mounts.push_back(m);
+    }
+    if (!_server.addFolder(parent, name, folder, NodeId::Null, _nameSpace))
+        return false;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Mirror& m = _mirrors.put(folder.get());
+        m.mount   = index;
+        m.remote  = remoteRoot;
+    }
+    defer(folder);
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerAggregator::defer
+    Mirror the node's children on its next browse
+    \param local
+*/
+void Open62541::ServerAggregator::defer(const NodeId& local)
+{
+    _server.addLazyNode(local, [this, local](Server& s) { return expand(s, local); });
+}
+
+/*!
+    \brief Open62541::ServerAggregator::resolve
+    \param local
+    \param client
+    \param remote
+    \return
+*/
+bool Open62541::ServerAggregator::resolve(const UA_NodeId& local, ClientRef& client, NodeId& remote)
+{
+    std::string endpoint;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Mirror* m = _mirrors.value(local);
+        if (!m)
+            return false;
+        remote   = m->remote;
+        endpoint = _mounts[m->mount].endpoint;
+    }
+    client = _pool.find(endpoint);
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerAggregator::expand
+    Browse the downstream node once and add its object and variable children - runs on the browsing thread
+    \param server
+    \param local
+    \return
+*/
+bool Open62541::ServerAggregator::expand(Server& server, const NodeId& local)
+{
+    NodeId remote;
+    std::string mount;
+    std::string endpoint;
+    size_t index = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        Mirror* m = _mirrors.value(local.get());
+        if (!m)
+            return false;
+        index    = m->mount;
+        remote   = m->remote;
+        mount    = _mounts[index].name;
+        endpoint = _mounts[index].endpoint;
+    }
+    ClientRef client = _pool.find(endpoint);
+    if (!client) {
+        _failures++;
+        defer(local);  // try again on the next browse
+        return false;
+    }
+    struct Child {
+        NodeId remote;
+        std::string name;
+        UA_NodeClass nodeClass;
+    };
+    std::vector<Child> children;
+    BrowseOptions options;
+    options.maxDepth        = 1;
+    options.nodeClassMask   = UA_NODECLASS_OBJECT | UA_NODECLASS_VARIABLE;
+    options.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    const bool ok = client->browseVisit(
+        remote,
+        [&children](const UA_ReferenceDescription& r, const UA_NodeId&, size_t) {
+            if (r.isForward && (r.nodeId.serverIndex == 0)) {
+                Child c;
+                c.remote    = r.nodeId.nodeId;
+                c.name      = std::string((const char*)r.browseName.name.data, r.browseName.name.length);
+                c.nodeClass = r.nodeClass;
+                children.push_back(c);
+            }
+            return BrowseContinue;
+        },
+        options);
+    _expanded++;
+    if (!ok) {
+        _failures++;
+        defer(local);
+        return false;
+    }
+    for (const auto& c : children) {
+        const NodeId n = localId(mount, c.remote.get());
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            if (_mirrors.value(n.get()))
+                continue;  // reached by another reference
+            Mirror& m = _mirrors.put(n.get());
+            m.mount   = index;
+            m.remote  = c.remote;
+        }
+        bool added = false;
+        if (c.nodeClass == UA_NODECLASS_OBJECT) {
+            added = server.addFolder(local, c.name, n, NodeId::Null, _nameSpace);
+        }
+        else {
+            VariableAttributes attr;
+            attr.setDefault();  // any data type and rank - the downstream node decides
+            attr.setDisplayName(c.name);
+            attr.setDescription(c.name);
+            attr.get().accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+            NodeId created(n);
+            added = server.addVariableNode(n,
+                                           local,
+                                           NodeId::HasComponent,
+                                           QualifiedName(_nameSpace, c.name),
+                                           NodeId::BaseDataVariableType,
+                                           attr,
+                                           NodeId::Null,
+                                           this) &&
+                    setAsDataSource(server, created);
+        }
+        if (added) {
+            defer(n);  // properties of variables too
+        }
+        else {
+            std::lock_guard<std::mutex> l(_mutex);
+            _mirrors.remove(n.get());
+        }
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerAggregator::readData
+    \param node
+    \param range
+    \param value
+    \return
+*/
+bool Open62541::ServerAggregator::readData(Server& /*server*/,
+                                           NodeId& node,
+                                           const UA_NumericRange* range,
+                                           UA_DataValue& value)
+{
+    FeedRef feed;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        auto* f = _feeds.value(node.get());
+        if (f)
+            feed = f->first;
+    }
+    if (feed) {
+        bool restart = false;
+        {
+            std::lock_guard<std::mutex> l(feed->mutex);
+            if (feed->valid) {
+                _shared++;
+                return copyValue(feed->value.get(), range, value);
+            }
+            restart = !feed->pending && !feed->item && !feed->closed;
+        }
+        if (restart)
+            start(feed);  // session came back or the item was lost - read directly meanwhile
+    }
+    ClientRef client;
+    NodeId remote;
+    if (!resolve(node.get(), client, remote))
+        return false;
+    if (!client) {
+        _failures++;
+        return false;
+    }
+    std::vector<UA_ReadValueId> request(1);
+    UA_ReadValueId_init(&request[0]);
+    request[0].nodeId      = remote.get();  // shallow
+    request[0].attributeId = UA_ATTRIBUTEID_VALUE;
+    std::vector<DataValue> results;
+    if (!client->readAttributes(request, results) || results.empty()) {
+        _failures++;
+        return false;
+    }
+    _reads++;
+    return copyValue(results[0].get(), range, value);
+}
+
+/*!
+    \brief Open62541::ServerAggregator::monitored
+    \param node
+    \param removed
+*/
+void Open62541::ServerAggregator::monitored(const UA_NodeId& node, bool removed)
+{
+    FeedRef feed;
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        auto* f = _feeds.value(node);
+        if (!removed) {
+            if (!f) {
+                Mirror* m = _mirrors.value(node);
+                if (!m)
+                    return;  // not a mirrored node
+                f                = &_feeds.put(node);
+                f->first         = std::make_shared<Feed>();
+                f->first->remote = m->remote;
+                f->first->mount  = m->mount;
+                first            = true;
+            }
+            f->second++;
+            feed = f->first;
+        }
+        else {
+            if (!f || (--f->second > 0))
+                return;
+            feed = f->first;
+            _feeds.remove(node);
+        }
+    }
+    if (first) {
+        start(feed);
+        return;
+    }
+    if (!removed)
+        return;
+    // last user gone - drop the downstream item on its session's thread
+    ClientRef client;
+    UA_UInt32 subscription = 0;
+    unsigned item          = 0;
+    {
+        std::lock_guard<std::mutex> l(feed->mutex);
+        feed->closed = true;
+        feed->valid  = false;
+        client       = feed->client;
+        subscription = feed->subscription;
+        item         = feed->item;
+    }
+    if (client && item) {
+        client->postCommand([feed, subscription, item](Client& c) {
+            ClientSubscription* s = c.subscription(subscription);
+            if (s)
+                s->deleteMonitorItem(item);
+        });
+    }
+}
+
+/*!
+    \brief Open62541::ServerAggregator::start
+    Post the creation of a feed's downstream item to its session
+    \param f
+*/
+void Open62541::ServerAggregator::start(const FeedRef& f)
+{
+    std::string endpoint;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        endpoint = _mounts[f->mount].endpoint;
+    }
+    ClientRef client = _pool.find(endpoint);
+    if (!client)
+        return;  // retried by the next read
+    {
+        std::lock_guard<std::mutex> l(f->mutex);
+        if (f->pending || f->closed)
+            return;
+        f->pending = true;
+        f->client  = client;
+    }
+    std::weak_ptr<Feed> w = f;
+    if (!client->postCommand([this, w](Client& c) {
+            FeedRef p = w.lock();
+            if (p)
+                attach(c, p);
+        })) {
+        std::lock_guard<std::mutex> l(f->mutex);
+        f->pending = false;
+    }
+}
+
+/*!
+    \brief Open62541::ServerAggregator::attach
+    Create a feed's downstream item - on the session's pump thread
+    \param c
+    \param f
+*/
+void Open62541::ServerAggregator::attach(Client& c, const FeedRef& f)
+{
+    {
+        std::lock_guard<std::mutex> l(f->mutex);
+        f->pending = false;
+        if (f->closed || f->item)
+            return;
+    }
+    UA_UInt32 id = 0;
+    {
+        std::lock_guard<std::mutex> l(_subscriptionMutex);
+        auto i = _subscriptions.find(&c);
+        if (i != _subscriptions.end())
+            id = i->second;
+    }
+    ClientSubscription* s = id ? c.subscription(id) : nullptr;
+    if (!s) {
+        if (!c.addSubscription(id) || !(s = c.subscription(id))) {
+            _failures++;
+            return;
+        }
+        std::lock_guard<std::mutex> l(_subscriptionMutex);
+        _subscriptions[&c] = id;
+    }
+    FeedItem* item = new FeedItem(f, *s);
+    item->setSampling(_samplingInterval, 1);
+    NodeId remote = f->remote;
+    if (!item->addDataChange(remote)) {
+        delete item;
+        _failures++;
+        return;
+    }
+    MonitoredItemRef r(item);
+    const unsigned n = s->addMonitorItem(r);
+    bool closed      = false;
+    {
+        std::lock_guard<std::mutex> l(f->mutex);
+        f->subscription = id;
+        f->item         = n;
+        closed          = f->closed;
+    }
+    if (closed)
+        s->deleteMonitorItem(n);  // last user left while it was being created
+}
+
+/*!
+    \brief Open62541::ServerAggregator::writeData
+    \param node
+    \param range
+    \param value
+    \return
+*/
+bool Open62541::ServerAggregator::writeData(Server& /*server*/,
+                                            NodeId& node,
+                                            const UA_NumericRange* range,
+                                            const UA_DataValue& value)
+{
+    if (range || !value.hasValue)
+        return false;
+    ClientRef client;
+    NodeId remote;
+    if (!resolve(node.get(), client, remote))
+        return false;
+    if (!client) {
+        _failures++;
+        return false;
+    }
+    Variant v(value.value);
+    if (!client->setVariable(remote, v)) {
+        _failures++;
+        return false;
+    }
+    _writes++;
+    return true;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/servercallbackgroup.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+
+/*!
+    \brief Open62541::ServerCallbackGroup::callbackFunction
+    \param data
+*/
+void Open62541::ServerCallbackGroup::callbackFunction(UA_Server* /*server*/, void* data)
+{
+    Open62541::ServerCallbackGroup* p = static_cast<Open62541::ServerCallbackGroup*>(data);
+    if (p)
+        p->tick();
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::ServerCallbackGroup
+    \param s
+    \param interval
+    \param phases
+*/
+Open62541::ServerCallbackGroup::ServerCallbackGroup(Server& s, unsigned interval, size_t phases)
+    : _server(s)
+    , _interval(interval ? interval : 1)
+{
+    phases = std::max<size_t>(1, std::min<size_t>(phases, _interval));
+    _phases.resize(phases);
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::~ServerCallbackGroup
+*/
+Open62541::ServerCallbackGroup::~ServerCallbackGroup()
+{
+    stop();
+    std::unique_lock<std::mutex> l(_jobMutex);
+    _jobCond.wait(l, [this] { return _queued == 0; });
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::start
+    \return
+*/
+bool Open62541::ServerCallbackGroup::start()
+{
+    if ((_id == 0) && _server.server()) {
+        WriteLock l(_server.mutex());
+        const UA_Double tick = UA_Double(_interval) / UA_Double(_phases.size());
+        _lastError           = UA_Server_addRepeatedCallback(_server.server(), callbackFunction, this, tick, &_id);
+        if (!lastOK())
+            _id = 0;
+        return lastOK();
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::stop
+    \return
+*/
+bool Open62541::ServerCallbackGroup::stop()
+{
+    if (_id != 0) {
+        if (_server.server()) {
+            WriteLock l(_server.mutex());
+            UA_Server_removeRepeatedCallback(_server.server(), _id);
+            _id = 0;
+            return true;
+        }
+    }
+    _id = 0;
+    return false;
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::add
+    Place a member in the phase with the fewest members
+    \param func
+    \return member id
+*/
+UA_UInt64 Open62541::ServerCallbackGroup::add(Func func)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    size_t phase = 0;
+    for (size_t i = 1; i < _phases.size(); i++) {
+        if (_phases[i].size() < _phases[phase].size())
+            phase = i;
+    }
+    std::unique_ptr<Member> m(new Member);
+    m->id   = _nextId++;
+    m->func = std::move(func);
+    Where w;
+    w.phase            = phase;
+    w.index            = _phases[phase].size();
+    const UA_UInt64 id = m->id;
+    _where[id]         = w;
+    _phases[phase].push_back(std::move(m));
+    return id;
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::remove
+    \param id
+    \return
+*/
+bool Open62541::ServerCallbackGroup::remove(UA_UInt64 id)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);  // waits for a running phase
+    auto i = _where.find(id);
+    if (i == _where.end())
+        return false;
+    const Where w = i->second;
+    _where.erase(i);
+    auto& v = _phases[w.phase];
+    if (_running) {
+        // the member may be the one running - mark it and compact once the phase is done
+        v[w.index]->id = 0;
+        _dead.push_back(w.phase);
+        return true;
+    }
+    if (w.index != (v.size() - 1)) {
+        v[w.index]                   = std::move(v.back());
+        _where[v[w.index]->id].index = w.index;
+    }
+    v.pop_back();
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::purge
+    Compact phases with members removed while running
+*/
+void Open62541::ServerCallbackGroup::purge()
+{
+    std::sort(_dead.begin(), _dead.end());
+    _dead.erase(std::unique(_dead.begin(), _dead.end()), _dead.end());
+    for (size_t phase : _dead) {
+        auto& v = _phases[phase];
+        v.erase(std::remove_if(v.begin(), v.end(), [](const std::unique_ptr<Member>& m) { return m->id == 0; }),
+                v.end());
+        for (size_t j = 0; j < v.size(); j++) {
+            _where[v[j]->id].index = j;
+        }
+    }
+    _dead.clear();
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::runPhase
+    \param phase
+*/
+void Open62541::ServerCallbackGroup::runPhase(size_t phase)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    _running = true;
+    auto& v = _phases[phase];
+    for (size_t j = 0; j < v.size(); j++) {  // members added to this phase while running also run
+        Member* m = v[j].get();
+        if (m->id && m->func)
+            m->func();
+    }
+    _running = false;
+    if (!_dead.empty())
+        purge();
+}
+
+/*!
+    \brief Open62541::ServerCallbackGroup::tick
+    Run the next phase - on the worker pool for a thread safe group
+*/
+void Open62541::ServerCallbackGroup::tick()
+{
+    _ticks++;
+    const size_t phase = _next;
+    _next              = (_next + 1) % _phases.size();
+    if (_threadSafe) {
+        {
+            std::lock_guard<std::mutex> l(_jobMutex);
+            if (_queued >= _phases.size()) {
+                _overruns++;  // a whole interval behind - drop this phase rather than queue without bound
+                return;
+            }
+            _queued++;
+        }
+        auto done = [this] {
+            std::lock_guard<std::mutex> l(_jobMutex);
+            _queued--;
+            _jobCond.notify_all();
+        };
+        if (_server.post([this, phase, done] {
+                runPhase(phase);
+                done();
+            })) {
+            return;
+        }
+        done();  // pool not running
+    }
+    runPhase(phase);
+}
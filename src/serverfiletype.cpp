@@ -0,0 +1,543 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/serverfiletype.h>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// FileType methods in the order of ServerFileType::_methods
+const UA_UInt32 methodIds[6] = {UA_NS0ID_FILETYPE_OPEN,
+                                UA_NS0ID_FILETYPE_CLOSE,
+                                UA_NS0ID_FILETYPE_READ,
+                                UA_NS0ID_FILETYPE_WRITE,
+                                UA_NS0ID_FILETYPE_GETPOSITION,
+                                UA_NS0ID_FILETYPE_SETPOSITION};
+const char* methodNames[6] = {"Open", "Close", "Read", "Write", "GetPosition", "SetPosition"};
+
+/*!
+    \brief scalar
+    \param n inputs
+    \param in
+    \param i index
+    \param type
+    \return the input if it is a scalar of the type - null if missing or of another type
+*/
+const void* scalar(size_t n, const UA_Variant* in, size_t i, const UA_DataType* type)
+{
+    return ((i < n) && UA_Variant_hasScalarType(&in[i], type)) ? in[i].data : nullptr;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::ServerFileType::Handle::~Handle
+*/
+Open62541::ServerFileType::Handle::~Handle()
+{
+    if (map)
+        munmap((void*)map, mapped);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+/*!
+    \brief Open62541::ServerFileType::ServerFileType
+    \param s
+    \param async
+*/
+Open62541::ServerFileType::ServerFileType(Server& s, bool async)
+    : ServerObjectType(s, "FileType")
+    , _async(async)
+{
+    typeId() = NodeId(0, UA_NS0ID_FILETYPE);
+    setNameSpace(0);
+    // async calls come from the stack's own session so Read and Write only check the session when sync
+    const std::vector<ServerMethod::SessionMethodFunc> funcs = {
+        [this](Server&, const UA_NodeId* s, const UA_NodeId* o, size_t n, const UA_Variant* in, size_t,
+               UA_Variant* out) { return open(s, o, n, in, out); },
+        [this](Server&, const UA_NodeId* s, const UA_NodeId* o, size_t n, const UA_Variant* in, size_t,
+               UA_Variant*) { return close(s, o, n, in); },
+        [this](Server&, const UA_NodeId* s, const UA_NodeId*, size_t n, const UA_Variant* in, size_t,
+               UA_Variant* out) { return read(_async ? nullptr : s, n, in, out); },
+        [this](Server&, const UA_NodeId* s, const UA_NodeId*, size_t n, const UA_Variant* in, size_t, UA_Variant*) {
+            return write(_async ? nullptr : s, n, in);
+        },
+        [this](Server&, const UA_NodeId* s, const UA_NodeId*, size_t n, const UA_Variant* in, size_t,
+               UA_Variant* out) { return getPosition(s, n, in, out); },
+        [this](Server&, const UA_NodeId* s, const UA_NodeId*, size_t n, const UA_Variant* in, size_t, UA_Variant*) {
+            return setPosition(s, n, in);
+        }};
+    for (size_t i = 0; i < funcs.size(); i++) {
+        const bool bulk = (i == 2) || (i == 3);  // Read and Write - the rest stay sync to know the session
+        _methods.emplace_back(new ServerMethod(methodNames[i]));
+        _methods.back()->setSessionFunction(funcs[i]);
+        _methods.back()->setAsync(_async && bulk);
+        _methods.back()->setLane(bulk ? WorkerPool::Bulk : WorkerPool::Control);
+    }
+    server().addSessionClosed(this, [this](const NodeId& session) { sessionClosed(session); });
+}
+
+/*!
+    \brief Open62541::ServerFileType::~ServerFileType
+*/
+Open62541::ServerFileType::~ServerFileType()
+{
+    server().removeSessionClosed(this);
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _handles.clear();
+    }
+    if (_bound && server().server()) {
+        for (size_t i = 0; i < _methods.size(); i++)
+            server().setNodeContext(NodeId(0, methodIds[i]), nullptr);  // calls now find no handler
+    }
+}
+
+/*!
+    \brief Open62541::ServerFileType::bind
+    \return true on success
+*/
+bool Open62541::ServerFileType::bind()
+{
+    if (_bound)
+        return true;
+    for (size_t i = 0; i < _methods.size(); i++) {
+        NodeId id(0, methodIds[i]);
+        if (!server().setNodeContext(id, _methods[i].get()) || !_methods[i]->setMethodNodeCallBack(server(), id))
+            return false;
+    }
+    _bound = true;
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerFileType::addFile
+    \param name
+    \param parent
+    \param path
+    \param writable
+    \param nodeId
+    \param requestNodeId
+    \return true on success
+*/
+bool Open62541::ServerFileType::addFile(const std::string& name,
+                                        const NodeId& parent,
+                                        const std::string& path,
+                                        bool writable,
+                                        NodeId& nodeId,
+                                        const NodeId& requestNodeId)
+{
+    if (!bind())
+        return false;
+    NodeId object;
+    object.notNull();
+    if (!addInstance(name, parent, object, requestNodeId))
+        return false;
+    File f;
+    f.path     = path;
+    f.writable = writable;
+    auto child = [this, &object](const char* browseName) {
+        BrowsePathResult r;
+        if (server().browseSimplifiedBrowsePath(object, 1, QualifiedName(0, browseName), r) && r.targetsSize())
+            return NodeId(r.targets(0).targetId.nodeId);
+        return NodeId();
+    };
+    f.size      = child("Size");
+    f.openCount = child("OpenCount");
+    for (const char* n : {"Writable", "UserWritable"}) {
+        NodeId id = child(n);
+        if (!id.isNull())
+            server().writeValue(id, Variant(UA_Boolean(writable)));
+    }
+    struct stat st;
+    const UA_UInt64 size = (::stat(path.c_str(), &st) == 0) ? UA_UInt64(st.st_size) : 0;
+    if (!f.size.isNull())
+        server().writeValue(f.size, Variant(size));
+    if (!f.openCount.isNull())
+        server().writeValue(f.openCount, Variant(UA_UInt16(0)));
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _files.put(object) = f;
+    }
+    if (!nodeId.isNull())
+        nodeId = object;
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerFileType::removeFile
+    \param object
+    \return true if removed
+*/
+bool Open62541::ServerFileType::removeFile(const NodeId& object)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (!_files.value(object))
+            return false;
+        _files.remove(object);
+        for (auto i = _handles.begin(); i != _handles.end();) {
+            if (i->second->object == object)
+                i = _handles.erase(i);  // a call still using the handle keeps it until it returns
+            else
+                ++i;
+        }
+    }
+    return server().deleteTree(object);
+}
+
+/*!
+    \brief Open62541::ServerFileType::handle
+    \param id
+    \param session caller - null to skip the check
+    \return the handle or null if it does not exist or belongs to another session
+*/
+Open62541::ServerFileType::HandleRef Open62541::ServerFileType::handle(UA_UInt32 id, const UA_NodeId* session)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = _handles.find(id);
+    if ((i == _handles.end()) || (session && !UA_NodeId_equal(i->second->session.constRef(), session)))
+        return HandleRef();
+    return i->second;
+}
+
+/*!
+    \brief Open62541::ServerFileType::opened
+    Publish the open count and size of a file after an open or close
+    \param object
+    \param size current size - ~0 to leave it
+*/
+void Open62541::ServerFileType::opened(const NodeId& object, UA_UInt64 size)
+{
+    NodeId sizeId, countId;
+    UA_UInt16 count = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        File* f = _files.value(object);
+        if (!f)
+            return;
+        sizeId  = f->size;
+        countId = f->openCount;
+        count   = UA_UInt16(std::min<size_t>(f->opens, 0xFFFF));
+    }
+    if (!countId.isNull())
+        server().writeValue(countId, Variant(count));
+    if (!sizeId.isNull() && (size != ~UA_UInt64(0)))
+        server().writeValue(sizeId, Variant(size));
+}
+
+/*!
+    \brief Open62541::ServerFileType::sessionClosed
+    Close the handles of a closed session - called from within the stack so counts are posted, not written
+    \param session
+*/
+void Open62541::ServerFileType::sessionClosed(const NodeId& session)
+{
+    std::vector<std::pair<NodeId, UA_UInt16>> counts;  // OpenCount updates - the last for a file wins
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        for (auto i = _handles.begin(); i != _handles.end();) {
+            if (i->second->session != session) {
+                ++i;
+                continue;
+            }
+            File* f = _files.value(i->second->object);
+            if (f) {
+                if (f->opens)
+                    f->opens--;
+                if (i->second->mode & Write)
+                    f->writing = false;
+                if (!f->openCount.isNull())
+                    counts.emplace_back(f->openCount, UA_UInt16(std::min<size_t>(f->opens, 0xFFFF)));
+            }
+            i = _handles.erase(i);  // a call still using the handle keeps it until it returns
+        }
+    }
+    for (auto& c : counts)
+        server().postWrite(c.first, Variant(c.second));
+}
+
+/*!
+    \brief Open62541::ServerFileType::open
+    Open(Byte mode) returns UInt32 fileHandle owned by the session
+    \param session
+    \param object
+    \param n
+    \param in
+    \param out
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::open(const UA_NodeId* session,
+                                              const UA_NodeId* object,
+                                              size_t n,
+                                              const UA_Variant* in,
+                                              UA_Variant* out)
+{
+    const UA_Byte* pm = static_cast<const UA_Byte*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_BYTE]));
+    if (!session || !object || !pm)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    const UA_Byte mode = *pm;
+    const bool writing = (mode & Write) != 0;
+    if (!(mode & (Read | Write)) || (mode & ~(Read | Write | EraseExisting | Append)) ||
+        (!writing && (mode & (EraseExisting | Append))))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    //
+    NodeId id(*object);
+    std::string path;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        File* f = _files.value(id);
+        if (!f)
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+        if (f->writing)
+            return writing ? UA_STATUSCODE_BADNOTWRITABLE : UA_STATUSCODE_BADNOTREADABLE;
+        if (writing && (!f->writable || f->opens))
+            return UA_STATUSCODE_BADNOTWRITABLE;  // a writer needs the file to itself
+        if (_handles.size() >= _maxHandles)
+            return UA_STATUSCODE_BADTOOMANYOPERATIONS;
+        path = f->path;
+        f->opens++;
+        f->writing = writing;  // reserved before the file is opened outside the lock
+    }
+    //
+    HandleRef h = std::make_shared<Handle>();
+    h->object   = id;
+    h->session  = NodeId(*session);
+    h->mode     = mode;
+    int flags   = writing ? (((mode & Read) ? O_RDWR : O_WRONLY) | O_CREAT) : O_RDONLY;
+    if (mode & EraseExisting)
+        flags |= O_TRUNC;
+    h->fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+    struct stat st;
+    UA_StatusCode ret = UA_STATUSCODE_GOOD;
+    if ((h->fd < 0) || (fstat(h->fd, &st) != 0)) {
+        ret = writing ? UA_STATUSCODE_BADNOTWRITABLE : UA_STATUSCODE_BADNOTREADABLE;
+    }
+    else {
+        h->mapped = size_t(st.st_size);
+        if (mode & Append)
+            h->position = UA_UInt64(st.st_size);
+        if (!writing && h->mapped) {
+            void* p = mmap(nullptr, h->mapped, PROT_READ, MAP_SHARED, h->fd, 0);
+            if (p == MAP_FAILED) {
+                h->mapped = 0;  // read through the descriptor instead
+            }
+            else {
+                madvise(p, h->mapped, MADV_SEQUENTIAL);
+                h->map = static_cast<const UA_Byte*>(p);
+            }
+        }
+    }
+    UA_UInt32 handle = 0;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        File* f = _files.value(id);
+        if (!f) {
+            ret = UA_STATUSCODE_BADNODEIDUNKNOWN;  // removed meanwhile
+        }
+        else if (ret != UA_STATUSCODE_GOOD) {
+            f->opens--;
+            f->writing = false;
+        }
+        else {
+            do {
+                handle = _nextHandle++;
+            } while (!handle || _handles.count(handle));
+            _handles[handle] = h;
+        }
+    }
+    if (ret != UA_STATUSCODE_GOOD)
+        return ret;
+    opened(id, (mode & EraseExisting) ? 0 : ~UA_UInt64(0));
+    return UA_Variant_setScalarCopy(&out[0], &handle, &UA_TYPES[UA_TYPES_UINT32]);
+}
+
+/*!
+    \brief Open62541::ServerFileType::close
+    Close(UInt32 fileHandle)
+    \param session
+    \param object
+    \param n
+    \param in
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::close(const UA_NodeId* session,
+                                               const UA_NodeId* object,
+                                               size_t n,
+                                               const UA_Variant* in)
+{
+    const UA_UInt32* ph = static_cast<const UA_UInt32*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_UINT32]));
+    if (!session || !object || !ph)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    NodeId id(*object);
+    HandleRef h;
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        auto i = _handles.find(*ph);
+        if ((i == _handles.end()) || !(i->second->object == id) ||
+            !UA_NodeId_equal(i->second->session.constRef(), session))
+            return UA_STATUSCODE_BADINVALIDARGUMENT;
+        h = i->second;
+        _handles.erase(i);
+        File* f = _files.value(id);
+        if (f) {
+            if (f->opens)
+                f->opens--;
+            if (h->mode & Write)
+                f->writing = false;
+        }
+    }
+    UA_UInt64 size = ~UA_UInt64(0);
+    if (h->mode & Write) {
+        std::lock_guard<std::mutex> l(h->mutex);
+        struct stat st;
+        if (fstat(h->fd, &st) == 0)
+            size = UA_UInt64(st.st_size);
+    }
+    opened(id, size);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::ServerFileType::read
+    Read(UInt32 fileHandle, Int32 length) returns ByteString data - empty at the end of the file
+    \param session null when async
+    \param n
+    \param in
+    \param out
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::read(const UA_NodeId* session, size_t n, const UA_Variant* in, UA_Variant* out)
+{
+    const UA_UInt32* ph = static_cast<const UA_UInt32*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_UINT32]));
+    const UA_Int32* pl  = static_cast<const UA_Int32*>(scalar(n, in, 1, &UA_TYPES[UA_TYPES_INT32]));
+    if (!ph || !pl || (*pl < 0))
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    HandleRef h = handle(*ph, session);
+    if (!h)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if (!(h->mode & Read))
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    UA_ByteString* data = UA_ByteString_new();
+    if (!data)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    size_t want = std::min<size_t>(size_t(*pl), _maxChunk);
+    std::lock_guard<std::mutex> l(h->mutex);
+    if (h->map) {
+        want = (h->position < h->mapped) ? std::min<size_t>(want, h->mapped - size_t(h->position)) : 0;
+        if (want && (UA_ByteString_allocBuffer(data, want) == UA_STATUSCODE_GOOD))
+            memcpy(data->data, h->map + h->position, want);  // the one copy - the mapping into the response
+    }
+    else if (want && (UA_ByteString_allocBuffer(data, want) == UA_STATUSCODE_GOOD)) {
+        size_t got = 0;
+        while (got < want) {
+            const ssize_t r = pread(h->fd, data->data + got, want - got, off_t(h->position + got));
+            if (r <= 0)
+                break;
+            got += size_t(r);
+        }
+        data->length = got;
+        if (!got) {
+            UA_ByteString_clear(data);
+            want = 0;
+        }
+    }
+    if (want && !data->length) {
+        UA_ByteString_delete(data);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    h->position += data->length;
+    _bytesRead += data->length;
+    UA_Variant_setScalar(&out[0], data, &UA_TYPES[UA_TYPES_BYTESTRING]);  // the output takes the buffer
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::ServerFileType::write
+    Write(UInt32 fileHandle, ByteString data)
+    \param session null when async
+    \param n
+    \param in
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::write(const UA_NodeId* session, size_t n, const UA_Variant* in)
+{
+    const UA_UInt32* ph     = static_cast<const UA_UInt32*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_UINT32]));
+    const UA_ByteString* pd = static_cast<const UA_ByteString*>(scalar(n, in, 1, &UA_TYPES[UA_TYPES_BYTESTRING]));
+    if (!ph || !pd)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    HandleRef h = handle(*ph, session);
+    if (!h)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    if (!(h->mode & Write))
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    std::lock_guard<std::mutex> l(h->mutex);
+    size_t done = 0;
+    while (done < pd->length) {
+        const ssize_t r = pwrite(h->fd, pd->data + done, pd->length - done, off_t(h->position + done));
+        if (r <= 0)
+            break;
+        done += size_t(r);
+    }
+    h->position += done;
+    _bytesWritten += done;
+    return (done == pd->length) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADNOTWRITABLE;
+}
+
+/*!
+    \brief Open62541::ServerFileType::getPosition
+    GetPosition(UInt32 fileHandle) returns UInt64 position
+    \param session
+    \param n
+    \param in
+    \param out
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::getPosition(const UA_NodeId* session,
+                                                     size_t n,
+                                                     const UA_Variant* in,
+                                                     UA_Variant* out)
+{
+    const UA_UInt32* ph = static_cast<const UA_UInt32*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_UINT32]));
+    HandleRef h         = (ph && session) ? handle(*ph, session) : HandleRef();
+    if (!h)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::lock_guard<std::mutex> l(h->mutex);
+    return UA_Variant_setScalarCopy(&out[0], &h->position, &UA_TYPES[UA_TYPES_UINT64]);
+}
+
+/*!
+    \brief Open62541::ServerFileType::setPosition
+    SetPosition(UInt32 fileHandle, UInt64 position) - a position past the end is the end
+    \param session
+    \param n
+    \param in
+    \return status
+*/
+UA_StatusCode Open62541::ServerFileType::setPosition(const UA_NodeId* session, size_t n, const UA_Variant* in)
+{
+    const UA_UInt32* ph = static_cast<const UA_UInt32*>(scalar(n, in, 0, &UA_TYPES[UA_TYPES_UINT32]));
+    const UA_UInt64* pp = static_cast<const UA_UInt64*>(scalar(n, in, 1, &UA_TYPES[UA_TYPES_UINT64]));
+    HandleRef h         = (ph && session) ? handle(*ph, session) : HandleRef();
+    if (!h || !pp)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::lock_guard<std::mutex> l(h->mutex);
+    UA_UInt64 end = h->mapped;
+    struct stat st;
+    if (!h->map && (fstat(h->fd, &st) == 0))
+        end = UA_UInt64(st.st_size);
+    h->position = std::min(*pp, end);
+    return UA_STATUSCODE_GOOD;
+}
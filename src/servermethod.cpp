@@ -11,6 +11,7 @@
  */
 #include <open62541cpp/servermethod.h>
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/arena.h>
 /*!
     \brief Open62541::ServerMethod::methodCallback
     \param handle
@@ -22,7 +23,7 @@
     \return status code
 */
 UA_StatusCode Open62541::ServerMethod::methodCallback(UA_Server* server,
-                                                      const UA_NodeId* /*sessionId*/,
+                                                      const UA_NodeId* sessionId,
                                                       void* /*sessionContext*/,
                                                       const UA_NodeId* /*methodId*/,
                                                       void* methodContext,  // references the handler
@@ -37,7 +38,15 @@ UA_StatusCode Open62541::ServerMethod::methodCallback(UA_Server* server,
     if (methodContext) {
         Server* s = Server::findServer(server);
         if (s) {
+            SessionLimiter::Slot slot(s->limiterFor(sessionId), sessionId);
+            if (!slot.ok())
+                return UA_STATUSCODE_BADTOOMANYOPERATIONS;  // session at its concurrency limit
+            Metrics::Scope timing(Metrics::MethodCall);
+            ScopedArena arena;  // temporaries made by the handler are released on return
             Open62541::ServerMethod* p = (Open62541::ServerMethod*)methodContext;
+            if (p->_sessionFunc) {
+                return p->_sessionFunc(*s, sessionId, objectId, inputSize, input, outputSize, output);
+            }
             if (p->_func) {
                 return p->_func(*s, objectId, inputSize, input, outputSize, output);  // was the functor defined
             }
@@ -82,8 +91,14 @@ Open62541::ServerMethod::ServerMethod(const std::string& n, MethodFunc f, int nI
  */
 bool Open62541::ServerMethod::setMethodNodeCallBack(Open62541::Server& s, Open62541::NodeId& node)
 {
-    return s.server() ? (UA_Server_setMethodNode_callback(s.server(), node, methodCallback) == UA_STATUSCODE_GOOD)
-                      : false;
+    if (!s.server() || (UA_Server_setMethodNode_callback(s.server(), node, methodCallback) != UA_STATUSCODE_GOOD))
+        return false;
+    if (_async) {
+        s.setAsyncOperationNotify();
+        s.setMethodLane(node, _lane);
+        return s.setMethodNodeAsync(node, true);
+    }
+    return true;
 }
 
 /*!
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/servernodebuilder.h>
+
+/*!
+    \brief viewString
+    \param s
+    \return UA_String referencing s - no copy
+*/
+static UA_String viewString(const std::string& s)
+{
+    UA_String r;
+    r.length = s.size();
+    r.data   = (UA_Byte*)(s.data());
+    return r;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::stage
+    \param k
+    \param parent
+    \param parentId
+    \param name
+    \param nodeId
+    \return reference to the new item
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::stage(Kind k,
+                                                                      Ref parent,
+                                                                      const NodeId& parentId,
+                                                                      const std::string& name,
+                                                                      const NodeId& nodeId)
+{
+    _items.emplace_back();
+    Item& i  = _items.back();
+    i.kind   = k;
+    i.parent = parent;
+    i.name   = name;
+    if (parent == External) {
+        i.parentId = parentId;
+    }
+    if (nodeId.isNull()) {
+        i.requestedId = NodeId(_nameSpace, 0);  // server assigned
+    }
+    else {
+        i.requestedId = nodeId;
+    }
+    return _items.size() - 1;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addObject
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::addObject(const NodeId& parent,
+                                                                          const std::string& name,
+                                                                          const NodeId& typeId,
+                                                                          const NodeId& nodeId,
+                                                                          NodeContext* c)
+{
+    Ref r              = stage(ObjectNode, External, parent, name, nodeId);
+    _items[r].typeId   = typeId;
+    _items[r].context  = c;
+    return r;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addObject
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::addObject(Ref parent,
+                                                                          const std::string& name,
+                                                                          const NodeId& typeId,
+                                                                          const NodeId& nodeId,
+                                                                          NodeContext* c)
+{
+    Ref r             = stage(ObjectNode, parent, NodeId::Null, name, nodeId);
+    _items[r].typeId  = typeId;
+    _items[r].context = c;
+    return r;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addVariable
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::addVariable(const NodeId& parent,
+                                                                            const std::string& name,
+                                                                            const Variant& value,
+                                                                            const NodeId& nodeId,
+                                                                            NodeContext* c)
+{
+    Ref r             = stage(VariableNode, External, parent, name, nodeId);
+    _items[r].value   = value;
+    _items[r].context = c;
+    return r;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addVariable
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::addVariable(Ref parent,
+                                                                            const std::string& name,
+                                                                            const Variant& value,
+                                                                            const NodeId& nodeId,
+                                                                            NodeContext* c)
+{
+    Ref r             = stage(VariableNode, parent, NodeId::Null, name, nodeId);
+    _items[r].value   = value;
+    _items[r].context = c;
+    return r;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addPath
+    \param root
+    \param path
+    \param value
+    \param c
+    \return reference to the variable
+*/
+Open62541::ServerNodeBuilder::Ref Open62541::ServerNodeBuilder::addPath(const NodeId& root,
+                                                                        const UAPath& path,
+                                                                        const Variant& value,
+                                                                        NodeContext* c)
+{
+    if (path.empty())
+        return External;
+    Ref parent = External;
+    std::string key = toString(root);  // folders are shared per root
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+        key += "/";
+        key += path[i];
+        auto f = _paths.find(key);
+        if (f != _paths.end()) {
+            parent = f->second;
+        }
+        else {
+            parent      = (parent == External) ? addFolder(root, path[i]) : addFolder(parent, path[i]);
+            _paths[key] = parent;
+        }
+    }
+    return (parent == External) ? addVariable(root, path.back(), value, NodeId::Null, c)
+                                : addVariable(parent, path.back(), value, NodeId::Null, c);
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addTree
+    \param parent
+    \param n
+    \return number staged
+*/
+size_t Open62541::ServerNodeBuilder::addTree(const NodeId& parent, UANode* n)
+{
+    if (!n)
+        return 0;
+    size_t count = 0;
+    // breadth first so parents are always staged before their children
+    std::vector<std::pair<Ref, UANode*>> level;
+    level.emplace_back(External, n);
+    while (!level.empty()) {
+        std::vector<std::pair<Ref, UANode*>> next;
+        for (auto& l : level) {
+            for (auto& c : l.second->children()) {
+                UANode* child = c.second;
+                Ref r         = (l.first == External) ? addFolder(parent, child->name(), child->data())
+                                                      : addFolder(l.first, child->name(), child->data());
+                _items[r].treeNode = child;
+                next.emplace_back(r, child);
+                count++;
+            }
+        }
+        level.swap(next);
+    }
+    return count;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::addItem
+    Called with the server write lock held
+    \param i
+    \return error code
+*/
+UA_StatusCode Open62541::ServerNodeBuilder::addItem(Item& i)
+{
+    const UA_NodeId* parent = nullptr;
+    if (i.parent == External) {
+        parent = i.parentId.constRef();
+    }
+    else {
+        // a parent must be staged before its children - anything else is a bad reference
+        if (i.parent >= size_t(&i - _items.data()))
+            return UA_STATUSCODE_BADPARENTNODEIDINVALID;
+        Item& p = _items[i.parent];
+        if (p.status != UA_STATUSCODE_GOOD)
+            return UA_STATUSCODE_BADPARENTNODEIDINVALID;
+        parent = p.result.constRef();
+    }
+    // shallow structures referencing the item - the server copies what it keeps
+    UA_QualifiedName qn;
+    qn.namespaceIndex = UA_UInt16(_nameSpace);
+    qn.name           = viewString(i.name);
+    UA_LocalizedText lt;
+    lt.locale = UA_STRING_NULL;
+    lt.text   = qn.name;
+    UA_NodeId out;
+    UA_NodeId_init(&out);
+    UA_StatusCode ret = UA_STATUSCODE_GOOD;
+    switch (i.kind) {
+        case VariableNode: {
+            UA_VariableAttributes attr = UA_VariableAttributes_default;
+            attr.displayName           = lt;
+            attr.description           = lt;
+            attr.accessLevel           = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+            attr.value                 = i.value.get();
+            if (i.value.get().type)
+                attr.dataType = i.value.get().type->typeId;
+            ret = UA_Server_addVariableNode(_server.server(),
+                                            i.requestedId,
+                                            *parent,
+                                            NodeId::Organizes,
+                                            qn,
+                                            NodeId::BaseDataVariableType,
+                                            attr,
+                                            i.context,
+                                            &out);
+        } break;
+        case ObjectNode:
+        case FolderNode: {
+            UA_ObjectAttributes attr = UA_ObjectAttributes_default;
+            attr.displayName         = lt;
+            attr.description         = lt;
+            ret                      = UA_Server_addObjectNode(_server.server(),
+                                          i.requestedId,
+                                          *parent,
+                                          (i.kind == FolderNode) ? NodeId::Organizes : NodeId::HasComponent,
+                                          qn,
+                                          (i.kind == FolderNode) ? NodeId::FolderType : i.typeId,
+                                          attr,
+                                          i.context,
+                                          &out);
+        } break;
+    }
+    if (ret == UA_STATUSCODE_GOOD) {
+        i.result.adopt(out);
+        if (i.treeNode)
+            i.treeNode->data() = i.result;
+    }
+    else {
+        UA_NodeId_clear(&out);
+    }
+    return ret;
+}
+
+/*!
+    \brief Open62541::ServerNodeBuilder::build
+    \return true if all items were added
+*/
+bool Open62541::ServerNodeBuilder::build()
+{
+    if (!_server.server())
+        return false;
+    {
+        WriteLock l(_server.mutex());
+        for (; _built < _items.size(); _built++) {
+            Item& i  = _items[_built];
+            i.status = addItem(i);
+            if (i.status != UA_STATUSCODE_GOOD)
+                _failed++;
+        }
+    }
+    return _failed == 0;
+}
@@ -30,6 +30,41 @@ Open62541::ServerNodeTree::ServerNodeTree(Server& s, NodeId& parent, int ns)
  */
 Open62541::ServerNodeTree::~ServerNodeTree() {}
 
+/*!
+    \brief resync
+    \param f
+    \return number of changes
+*/
+size_t Open62541::ServerNodeTree::resync(const ChangeFunc& f)
+{
+    UANodeTree t(root().data());
+    if (!_server.browseTree(root().data(), t))
+        return 0;
+    return applyDiff(t, f);
+}
+
+/*!
+    \brief addLazyFolder
+    \param path
+    \param fill
+    \return true on success
+*/
+bool Open62541::ServerNodeTree::addLazyFolder(UAPath& path, LazyFill fill)
+{
+    if (path.empty() || !fill)
+        return false;
+    createPathFolders(path, rootNode());
+    UANode* n = node(path);
+    if (!n)
+        return false;
+    UAPath base = path;
+    _server.addLazyNode(n->data(), [this, base, fill](Server&) {
+        fill(*this, base);
+        return true;
+    });
+    return true;
+}
+
 /*!
     \brief addFolderNode
     \param parent
@@ -11,6 +11,19 @@
  */
 #include <open62541cpp/serverobjecttype.h>
 
+/*!
+    \brief viewString
+    \param s
+    \return UA_String referencing s - no copy
+*/
+static UA_String viewString(const std::string& s)
+{
+    UA_String r;
+    r.length = s.size();
+    r.data   = (UA_Byte*)(s.data());
+    return r;
+}
+
 /*!
        \brief Open62541::ServerObjectType::ServerObjectType
        \param n
@@ -71,6 +84,7 @@ bool Open62541::ServerObjectType::addDerivedObjectType(const std::string& n,
 */
 bool Open62541::ServerObjectType::addType(const NodeId& nodeId)
 {  // base node of type
+    _template.clear();
     if (addBaseObjectType(_name, nodeId)) {
         return addChildren(_typeId);
     }
@@ -109,3 +123,44 @@ bool Open62541::ServerObjectType::addInstance(const std::string& n,
     UAPRINTLASTERROR(_server.lastError());
     return ret;
 }
+
+/*!
+    \brief Open62541::ServerObjectType::addInstances
+    \param names
+    \param parent
+    \param nodeIds
+    \param context
+    \return true if all were added
+*/
+bool Open62541::ServerObjectType::addInstances(const std::vector<std::string>& names,
+                                               const NodeId& parent,
+                                               std::vector<NodeId>& nodeIds,
+                                               NodeContext* context)
+{
+    nodeIds.clear();
+    nodeIds.resize(names.size());
+    if (!_server.server() || !instanceTemplate().valid())
+        return false;
+    const UA_NodeId requested = UA_NODEID_NUMERIC(UA_UInt16(parent.nameSpaceIndex()), 0);
+    UA_StatusCode ret         = UA_STATUSCODE_GOOD;
+    WriteLock l(_server.mutex());
+    for (size_t i = 0; i < names.size(); i++) {
+        // shallow - the stack copies what it keeps
+        UA_QualifiedName qn;
+        qn.namespaceIndex        = UA_UInt16(parent.nameSpaceIndex());
+        qn.name                  = viewString(names[i]);
+        UA_ObjectAttributes attr = UA_ObjectAttributes_default;
+        attr.displayName.text    = qn.name;
+        UA_NodeId out;
+        UA_NodeId_init(&out);
+        UA_StatusCode r = _template.instantiate(_server.server(), requested, parent, NodeId::Organizes, qn, attr,
+                                                context, &out);
+        if (r == UA_STATUSCODE_GOOD) {
+            nodeIds[i].adopt(out);
+        }
+        else if (ret == UA_STATUSCODE_GOOD) {
+            ret = r;
+        }
+    }
+    return ret == UA_STATUSCODE_GOOD;
+}
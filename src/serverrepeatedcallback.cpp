@@ -11,6 +11,7 @@
  */
 #include <serverrepeatedcallback.h>
 #include <open62541cpp/open62541server.h>
+#include <open62541cpp/servercallbackgroup.h>
 /*!
 
     \brief Open62541::ServerRepeatedCallback::callbackFunction
@@ -20,8 +21,10 @@
 void Open62541::ServerRepeatedCallback::callbackFunction(UA_Server* /*server*/, void* data)
 {
     Open62541::ServerRepeatedCallback* p = (Open62541::ServerRepeatedCallback*)data;
-    if (p)
+    if (p) {
+        Metrics::Scope timing(Metrics::TimerCallback);
         p->callback();
+    }
 }
 
 /*!
@@ -57,7 +60,17 @@ Open62541::ServerRepeatedCallback::ServerRepeatedCallback(Server& s,
 */
 bool Open62541::ServerRepeatedCallback::start()
 {
+    if ((_id == 0) && _group) {
+        _id        = _group->add([this] { callback(); });
+        _lastError = UA_STATUSCODE_GOOD;
+        return true;
+    }
     if ((_id == 0) && _server.server()) {
+        if (_server.timerWheelEnabled()) {
+            _id        = _server.addWheelTimer(_interval, _interval, [this](UA_UInt64) { callback(); });
+            _lastError = _server.lastError();
+            return _id != 0;
+        }
         WriteLock l(_server.mutex());
         _lastError = UA_Server_addRepeatedCallback(_server.server(), callbackFunction, this, _interval, &_id);
         return lastOK();
@@ -72,6 +85,13 @@ bool Open62541::ServerRepeatedCallback::start()
 */
 bool Open62541::ServerRepeatedCallback::changeInterval(unsigned i)
 {
+    if (_group) {
+        return false;  // the group sets the interval
+    }
+    if (TimerWheel::isWheelId(_id)) {
+        _lastError = _server.timerWheel().changeInterval(_id, i) ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADNOTFOUND;
+        return lastOK();
+    }
     if ((_id != 0) && _server.server()) {
         WriteLock l(_server.mutex());
         _lastError = UA_Server_changeRepeatedCallbackInterval(_server.server(), _id, i);
@@ -92,6 +112,18 @@ bool Open62541::ServerRepeatedCallback::changeInterval(unsigned i)
  */
 bool Open62541::ServerRepeatedCallback::stop()
 {
+    if (_group) {
+        const bool running = (_id != 0);
+        if (running)
+            _group->remove(_id);  // waits for a running phase
+        _id = 0;
+        return running;
+    }
+    if (TimerWheel::isWheelId(_id)) {
+        _server.timerWheel().cancel(_id);  // waits for a running callback
+        _id = 0;
+        return true;
+    }
     if (_id != 0) {
         if (_server.server()) {
             WriteLock l(_server.mutex());
@@ -111,7 +143,14 @@ bool Open62541::ServerRepeatedCallback::stop()
 */
 Open62541::ServerRepeatedCallback::~ServerRepeatedCallback()
 {
-    if (_server.server()) {
+    if (_group) {
+        if (_id != 0)
+            _group->remove(_id);
+    }
+    else if (TimerWheel::isWheelId(_id)) {
+        _server.timerWheel().cancel(_id);
+    }
+    else if (_server.server()) {
         WriteLock l(server().mutex());
         UA_Server_removeRepeatedCallback(_server.server(), _id);
     }
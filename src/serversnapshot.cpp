@@ -0,0 +1,609 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/serversnapshot.h>
+#include <open62541cpp/open62541server.h>
+#include <open62541cpp/servermethod.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace Open62541 {
+
+namespace {
+size_t padded(size_t n) { return (n + 7) & ~size_t(7); }
+std::string text(const UA_String& s) { return std::string(reinterpret_cast<const char*>(s.data), s.length); }
+
+/*!
+    \brief The Encoder struct
+    Appends UA binary values to an image
+*/
+struct Encoder {
+    std::vector<UA_Byte>& image;
+    bool ok = true;
+    explicit Encoder(std::vector<UA_Byte>& i)
+        : image(i)
+    {
+    }
+    void put(const void* v, const UA_DataType* t)
+    {
+        size_t n = UA_calcSizeBinary(v, t);
+        size_t o = image.size();
+        image.resize(o + n);
+        UA_ByteString b;
+        b.length = n;
+        b.data   = image.data() + o;
+        if (UA_encodeBinary(v, t, &b) != UA_STATUSCODE_GOOD)
+            ok = false;
+    }
+    template <typename T> void operator()(const T& v) { put(&v, ua_type_traits<T>::type()); }
+    void dims(size_t n, const UA_UInt32* p)
+    {
+        (*this)(UA_UInt32(n));
+        for (size_t i = 0; i < n; i++)
+            (*this)(p[i]);
+    }
+    template <typename N> void value(const N& n)
+    {
+        // a data source is read when asked for - there is no value to keep
+        if (n.valueSource == UA_VALUESOURCE_DATA) {
+            (*this)(n.value.data.value);
+        }
+        else {
+            UA_DataValue v;
+            UA_DataValue_init(&v);
+            (*this)(v);
+        }
+    }
+};
+
+/*!
+    \brief The Decoder struct
+    Reads UA binary values from one record
+*/
+struct Decoder {
+    UA_ByteString b;
+    size_t o = 0;
+    bool ok  = true;
+    Decoder(const UA_Byte* p, size_t n)
+    {
+        b.data   = const_cast<UA_Byte*>(p);
+        b.length = n;
+    }
+    void get(void* v, const UA_DataType* t)
+    {
+        if (ok && (UA_decodeBinary(&b, &o, v, t, nullptr) != UA_STATUSCODE_GOOD))
+            ok = false;
+    }
+    template <typename T> void operator()(T& v) { get(&v, ua_type_traits<T>::type()); }
+    void dims(size_t& n, UA_UInt32*& p)
+    {
+        UA_UInt32 k = 0;
+        (*this)(k);
+        if (!ok || !k)
+            return;
+        if (k > (b.length - o) / sizeof(UA_UInt32)) {
+            ok = false;  // more dimensions than bytes left - a corrupt image
+            return;
+        }
+        p = static_cast<UA_UInt32*>(UA_Array_new(k, &UA_TYPES[UA_TYPES_UINT32]));
+        if (!p) {
+            ok = false;
+            return;
+        }
+        n = k;
+        for (size_t i = 0; i < n; i++)
+            (*this)(p[i]);
+    }
+    template <typename N> void value(N& n) { (*this)(n.value.data.value); }
+};
+
+/*!
+    \brief attributes
+    Encode or decode the attributes of a node - the node class is already known
+    \param io Encoder or Decoder
+    \param n node
+*/
+template <typename IO, typename N>
+void attributes(IO& io, N& n)
+{
+    io(n.head.browseName);
+    io(n.head.displayName);
+    io(n.head.description);
+    io(n.head.writeMask);
+    switch (n.head.nodeClass) {
+        case UA_NODECLASS_VARIABLE:
+            io.value(n.variableNode);
+            io(n.variableNode.dataType);
+            io(n.variableNode.valueRank);
+            io.dims(n.variableNode.arrayDimensionsSize, n.variableNode.arrayDimensions);
+            io(n.variableNode.accessLevel);
+            io(n.variableNode.minimumSamplingInterval);
+            io(n.variableNode.historizing);
+            break;
+        case UA_NODECLASS_VARIABLETYPE:
+            io.value(n.variableTypeNode);
+            io(n.variableTypeNode.dataType);
+            io(n.variableTypeNode.valueRank);
+            io.dims(n.variableTypeNode.arrayDimensionsSize, n.variableTypeNode.arrayDimensions);
+            io(n.variableTypeNode.isAbstract);
+            break;
+        case UA_NODECLASS_OBJECT:
+            io(n.objectNode.eventNotifier);
+            break;
+        case UA_NODECLASS_OBJECTTYPE:
+            io(n.objectTypeNode.isAbstract);
+            break;
+        case UA_NODECLASS_REFERENCETYPE:
+            io(n.referenceTypeNode.isAbstract);
+            io(n.referenceTypeNode.symmetric);
+            io(n.referenceTypeNode.inverseName);
+            break;
+        case UA_NODECLASS_DATATYPE:
+            io(n.dataTypeNode.isAbstract);
+            break;
+        case UA_NODECLASS_METHOD:
+            io(n.methodNode.executable);
+            break;
+        case UA_NODECLASS_VIEW:
+            io(n.viewNode.containsNoLoops);
+            io(n.viewNode.eventNotifier);
+            break;
+        default:
+            break;
+    }
+}
+
+/*!
+    \brief The Loaded struct
+    A record whose node is in place - its references and bindings follow
+*/
+struct Loaded {
+    NodeId id;
+    const UA_Byte* record = nullptr;
+    size_t length         = 0;
+    size_t references     = 0;  // offset of the reference count in the record
+    NodeContext* context  = nullptr;
+    UA_Byte bindings      = 0;
+};
+}  // namespace
+
+/*!
+    \brief Open62541::ServerSnapshot::record
+    Append a node's record
+    \param node
+    \return false if it could not be encoded
+*/
+bool Open62541::ServerSnapshot::record(const UA_Node* node)
+{
+    size_t offset = _image.size();
+    _image.resize(offset + sizeof(Record));
+    Encoder e(_image);
+    e(node->head.nodeId);
+    //
+    // the context is kept by name - like the server's lifecycle callbacks, every context is a NodeContext
+    std::string name;
+    UA_Byte bindings = 0;
+    if (node->head.context) {
+        name = static_cast<NodeContext*>(node->head.context)->name();
+        switch (node->head.nodeClass) {
+            case UA_NODECLASS_VARIABLE:
+                if (node->variableNode.valueSource == UA_VALUESOURCE_DATASOURCE)
+                    bindings |= DataSource;
+                else if (node->variableNode.value.data.callback.onRead ||
+                         node->variableNode.value.data.callback.onWrite)
+                    bindings |= ValueCallback;
+                break;
+            case UA_NODECLASS_OBJECTTYPE:
+                if (node->objectTypeNode.lifecycle.constructor || node->objectTypeNode.lifecycle.destructor)
+                    bindings |= TypeLifecycle;
+                break;
+            case UA_NODECLASS_METHOD:
+                if (node->methodNode.method)
+                    bindings |= Method;
+                break;
+            default:
+                break;
+        }
+    }
+    UA_String s;
+    s.length = name.size();
+    s.data   = reinterpret_cast<UA_Byte*>(const_cast<char*>(name.data()));
+    e(s);
+    e(bindings);
+    attributes(e, *node);
+    //
+    // forward references, and inverse ones from namespace zero - an inverse reference between saved nodes is
+    // the forward reference of the other node
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId          = node->head.nodeId;  // shallow - bd is not cleared
+    bd.browseDirection = UA_BROWSEDIRECTION_BOTH;
+    bd.includeSubtypes = true;
+    bd.resultMask      = UA_BROWSERESULTMASK_REFERENCETYPEID | UA_BROWSERESULTMASK_ISFORWARD;
+    UA_BrowseResult r  = UA_Server_browse(_server.server(), 0, &bd);
+    UA_UInt32 n        = 0;
+    for (size_t i = 0; i < r.referencesSize; i++) {
+        if (r.references[i].isForward || !r.references[i].nodeId.nodeId.namespaceIndex)
+            n++;
+    }
+    e(n);
+    for (size_t i = 0; i < r.referencesSize; i++) {
+        const UA_ReferenceDescription& d = r.references[i];
+        if (d.isForward || !d.nodeId.nodeId.namespaceIndex) {
+            e(d.referenceTypeId);
+            e(d.isForward);
+            e(d.nodeId);
+        }
+    }
+    _references += n;
+    UA_BrowseResult_clear(&r);
+    //
+    size_t length = padded(_image.size() - offset);
+    if (!e.ok || (length > UINT32_MAX)) {
+        _image.resize(offset);
+        return false;
+    }
+    _image.resize(offset + length, 0);
+    Record h;
+    h.length    = UA_UInt32(length);
+    h.nodeClass = node->head.nodeClass;
+    memcpy(_image.data() + offset, &h, sizeof(h));
+    _index.push_back(offset);
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerSnapshot::save
+    The image is built in memory and written to a temporary file that then replaces file
+    \param file
+    \return true on success
+*/
+bool Open62541::ServerSnapshot::save(const std::string& file)
+{
+    _image.clear();
+    _index.clear();
+    _nodes      = 0;
+    _references = 0;
+    _skipped    = 0;
+    _lastError  = UA_STATUSCODE_GOOD;
+    UA_Server* s = _server.server();
+    if (!s) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+    _image.resize(sizeof(Header), 0);
+    //
+    WriteLock l(_server.mutex());
+    Encoder e(_image);
+    UA_Variant ns;
+    UA_Variant_init(&ns);
+    UA_UInt32 namespaces = 0;
+    if ((UA_Server_readValue(s, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_NAMESPACEARRAY), &ns) == UA_STATUSCODE_GOOD) &&
+        (ns.type == &UA_TYPES[UA_TYPES_STRING])) {
+        const UA_String* uri = static_cast<const UA_String*>(ns.data);
+        for (size_t i = 1; i < ns.arrayLength; i++, namespaces++)
+            e(uri[i]);
+    }
+    UA_Variant_clear(&ns);
+    _image.resize(padded(_image.size()), 0);
+    //
+    UA_Nodestore& store = UA_Server_getConfig(s)->nodestore;
+    std::vector<NodeId> ids;
+    store.iterate(
+        store.context,
+        [](void* c, const UA_Node* node) {
+            if (node->head.nodeId.namespaceIndex)
+                static_cast<std::vector<NodeId>*>(c)->push_back(NodeId(node->head.nodeId));
+        },
+        &ids);
+    for (const NodeId& id : ids) {
+        const UA_Node* node = store.getNode(store.context, id.constRef());
+        if (!node)
+            continue;  // removed meanwhile
+        if (record(node))
+            _nodes++;
+        else
+            _skipped++;
+        store.releaseNode(store.context, node);
+    }
+    l.unlock();
+    //
+    Header h;
+    h.magic       = Magic;
+    h.version     = Version;
+    h.count       = _index.size();
+    h.indexOffset = _image.size();
+    h.namespaces  = namespaces;
+    h.reserved    = 0;
+    memcpy(_image.data(), &h, sizeof(h));
+    size_t n = _index.size() * sizeof(UA_UInt64);
+    _image.resize(_image.size() + n);
+    if (n)
+        memcpy(_image.data() + h.indexOffset, _index.data(), n);
+    //
+    std::string t = file + ".tmp";
+    {
+        std::ofstream f(t, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(_image.data()), std::streamsize(_image.size()));
+        if (!f) {
+            remove(t.c_str());
+            _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        }
+    }
+    if (lastOK() && (rename(t.c_str(), file.c_str()) != 0))
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    _image.clear();
+    _index.clear();
+    if (lastOK() && _skipped)
+        _lastError = UA_STATUSCODE_UNCERTAINDATASUBNORMAL;  // written without the nodes that did not encode
+    return _skipped ? false : lastOK();
+}
+
+/*!
+    \brief Open62541::ServerSnapshot::load
+    Nodes go straight into the nodestore under the server lock. Reference types are added through the server
+    so it records their place in the type hierarchy. References are added once every node is in place, then
+    the lock is released and the context bindings are restored
+    \param file
+    \return true if the file was valid
+*/
+bool Open62541::ServerSnapshot::load(const std::string& file)
+{
+    _nodes      = 0;
+    _references = 0;
+    _skipped    = 0;
+    _unbound.clear();
+    _lastError   = UA_STATUSCODE_GOOD;
+    UA_Server* s = _server.server();
+    if (!s) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+    try {
+        mapping = boost::interprocess::file_mapping(file.c_str(), boost::interprocess::read_only);
+        region  = boost::interprocess::mapped_region(mapping, boost::interprocess::read_only);
+    }
+    catch (...) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        return false;
+    }
+    const UA_Byte* data = static_cast<const UA_Byte*>(region.get_address());
+    const size_t size   = region.get_size();
+    const Header* h     = reinterpret_cast<const Header*>(data);
+    if ((size < sizeof(Header)) || (h->magic != Magic) || (h->version != Version) || (h->indexOffset > size) ||
+        (h->indexOffset & 7) || (h->count != (size - h->indexOffset) / sizeof(UA_UInt64))) {
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+        return false;
+    }
+    const UA_UInt64* index = reinterpret_cast<const UA_UInt64*>(data + h->indexOffset);
+    //
+    WriteLock l(_server.mutex());
+    // saved namespace index to this server's
+    std::vector<UA_UInt16> remap(size_t(h->namespaces) + 1, 0);
+    Decoder d(data + sizeof(Header), h->indexOffset - sizeof(Header));
+    for (UA_UInt32 i = 1; i <= h->namespaces; i++) {
+        UA_String uri;
+        UA_String_init(&uri);
+        d(uri);
+        if (!d.ok) {
+            _lastError = UA_STATUSCODE_BADDECODINGERROR;
+            return false;
+        }
+        remap[i] = UA_Server_addNamespace(s, text(uri).c_str());
+        UA_String_clear(&uri);
+    }
+    auto remapped = [&remap](UA_UInt16& ns) {
+        if (ns < remap.size())
+            ns = remap[ns];
+    };
+    //
+    UA_Nodestore& store = UA_Server_getConfig(s)->nodestore;
+    std::vector<Loaded> loaded;
+    std::vector<std::pair<UA_Node*, size_t>> referenceTypes;  // node and its entry in loaded
+    loaded.reserve(h->count);
+    for (UA_UInt64 k = 0; k < h->count; k++) {
+        const UA_UInt64 o = index[k];
+        const Record* r   = reinterpret_cast<const Record*>(data + o);
+        if ((o & 7) || (o + sizeof(Record) > h->indexOffset) || (r->length < sizeof(Record)) ||
+            (r->length > h->indexOffset - o)) {
+            _skipped++;
+            continue;
+        }
+        Decoder rd(data + o + sizeof(Record), r->length - sizeof(Record));
+        UA_Node* node = store.newNode(store.context, UA_NodeClass(r->nodeClass));
+        if (!node) {
+            _lastError = UA_STATUSCODE_BADOUTOFMEMORY;
+            break;
+        }
+        Loaded e;
+        UA_String name;
+        UA_String_init(&name);
+        rd(node->head.nodeId);
+        rd(name);
+        rd(e.bindings);
+        attributes(rd, *node);
+        const std::string contextName = text(name);
+        UA_String_clear(&name);
+        if (!rd.ok) {
+            store.deleteNode(store.context, node);
+            _skipped++;
+            continue;
+        }
+        remapped(node->head.nodeId.namespaceIndex);
+        remapped(node->head.browseName.namespaceIndex);
+        if (node->head.nodeClass == UA_NODECLASS_VARIABLE)
+            remapped(node->variableNode.dataType.namespaceIndex);
+        if (node->head.nodeClass == UA_NODECLASS_VARIABLETYPE)
+            remapped(node->variableTypeNode.dataType.namespaceIndex);
+        if (!contextName.empty()) {
+            e.context = _server.context(contextName);
+            if (!e.context)
+                _unbound.push_back(contextName);
+        }
+        e.id         = NodeId(node->head.nodeId);
+        e.record     = data + o + sizeof(Record);
+        e.length     = r->length - sizeof(Record);
+        e.references = rd.o;
+        if (node->head.nodeClass == UA_NODECLASS_REFERENCETYPE) {
+            referenceTypes.push_back(std::make_pair(node, loaded.size()));
+            loaded.push_back(std::move(e));
+            continue;
+        }
+        node->head.context     = e.context;
+        node->head.constructed = true;  // the node was constructed before it was saved
+        if (store.insertNode(store.context, node, nullptr) == UA_STATUSCODE_GOOD) {
+            _nodes++;
+            loaded.push_back(std::move(e));
+        }
+        else {
+            _skipped++;  // the store deleted the node - most likely it exists already
+        }
+    }
+    //
+    // reference types - a subtype may come before its supertype, so go round until nothing more is added
+    auto supertype = [&](const Loaded& e, UA_NodeId& parent) {
+        Decoder rd(e.record, e.length);
+        rd.o        = e.references;
+        UA_UInt32 n = 0;
+        rd(n);
+        for (UA_UInt32 i = 0; rd.ok && (i < n); i++) {
+            UA_NodeId type;
+            UA_Boolean forward = true;
+            UA_ExpandedNodeId target;
+            UA_NodeId_init(&type);
+            UA_ExpandedNodeId_init(&target);
+            rd(type);
+            rd(forward);
+            rd(target);
+            bool found = rd.ok && !forward && (type.namespaceIndex == 0) &&
+                         (type.identifierType == UA_NODEIDTYPE_NUMERIC) &&
+                         (type.identifier.numeric == UA_NS0ID_HASSUBTYPE);
+            if (found) {
+                remapped(target.nodeId.namespaceIndex);
+                UA_NodeId_clear(&parent);
+                UA_NodeId_copy(&target.nodeId, &parent);
+            }
+            UA_NodeId_clear(&type);
+            UA_ExpandedNodeId_clear(&target);
+            if (found)
+                return true;
+        }
+        return false;
+    };
+    for (bool progress = true; progress && !referenceTypes.empty();) {
+        progress = false;
+        for (auto i = referenceTypes.begin(); i != referenceTypes.end();) {
+            UA_Node* node = i->first;
+            Loaded& e     = loaded[i->second];
+            UA_NodeId parent;
+            UA_NodeId_init(&parent);
+            UA_StatusCode ret = UA_STATUSCODE_BADPARENTNODEIDINVALID;
+            if (supertype(e, parent)) {
+                UA_ReferenceTypeAttributes a = UA_ReferenceTypeAttributes_default;
+                a.displayName                = node->head.displayName;  // shallow - the node owns them
+                a.description                = node->head.description;
+                a.writeMask                  = node->head.writeMask;
+                a.isAbstract                 = node->referenceTypeNode.isAbstract;
+                a.symmetric                  = node->referenceTypeNode.symmetric;
+                a.inverseName                = node->referenceTypeNode.inverseName;
+                ret = UA_Server_addReferenceTypeNode(s,
+                                                     node->head.nodeId,
+                                                     parent,
+                                                     UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                                     node->head.browseName,
+                                                     a,
+                                                     e.context,
+                                                     nullptr);
+            }
+            UA_NodeId_clear(&parent);
+            if (ret == UA_STATUSCODE_BADPARENTNODEIDINVALID) {
+                i++;  // supertype not added yet
+                continue;
+            }
+            if (ret == UA_STATUSCODE_GOOD) {
+                _nodes++;
+                progress = true;
+            }
+            else {
+                _skipped++;
+                e.record = nullptr;  // no references either
+            }
+            store.deleteNode(store.context, node);
+            i = referenceTypes.erase(i);
+        }
+    }
+    for (auto& i : referenceTypes) {
+        _skipped++;
+        loaded[i.second].record = nullptr;
+        store.deleteNode(store.context, i.first);
+    }
+    //
+    // references - a forward one adds the inverse to its target too
+    for (const Loaded& e : loaded) {
+        if (!e.record)
+            continue;
+        Decoder rd(e.record, e.length);
+        rd.o        = e.references;
+        UA_UInt32 n = 0;
+        rd(n);
+        for (UA_UInt32 i = 0; rd.ok && (i < n); i++) {
+            UA_NodeId type;
+            UA_Boolean forward = true;
+            UA_ExpandedNodeId target;
+            UA_NodeId_init(&type);
+            UA_ExpandedNodeId_init(&target);
+            rd(type);
+            rd(forward);
+            rd(target);
+            if (rd.ok) {
+                remapped(type.namespaceIndex);
+                remapped(target.nodeId.namespaceIndex);
+                UA_StatusCode ret = UA_Server_addReference(s, e.id, type, target, forward);
+                if (ret == UA_STATUSCODE_GOOD)
+                    _references++;
+                else if (ret != UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED)  // e.g. a supertype link
+                    _skipped++;
+            }
+            UA_NodeId_clear(&type);
+            UA_ExpandedNodeId_clear(&target);
+        }
+        if (!rd.ok)
+            _skipped++;
+    }
+    l.unlock();
+    //
+    // bindings - contexts install their callbacks through the server
+    for (Loaded& e : loaded) {
+        if (!e.context || !e.bindings)
+            continue;
+        if (e.bindings & DataSource)
+            e.context->setAsDataSource(_server, e.id);
+        if (e.bindings & ValueCallback)
+            e.context->setValueCallback(_server, e.id);
+        if (e.bindings & TypeLifecycle)
+            e.context->setTypeLifeCycle(_server, e.id);
+        if (e.bindings & Method) {
+            ServerMethod* m = dynamic_cast<ServerMethod*>(e.context);
+            if (m)
+                m->setMethodNodeCallBack(_server, e.id);
+        }
+    }
+    if (lastOK() && _skipped)
+        _lastError = UA_STATUSCODE_UNCERTAINDATASUBNORMAL;
+    return true;
+}
+
+}  // namespace Open62541
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/serverthreads.h>
+#include <open62541cpp/open62541server.h>
+
+/*!
+    \brief Open62541::ServerThreads::add
+    \param s
+    \param cpu
+    \return
+*/
+bool Open62541::ServerThreads::add(Server& s, int cpu)
+{
+    ThreadConfig c;
+    if (cpu >= 0)
+        c.cpus.push_back(cpu);
+    return add(s, c);
+}
+
+/*!
+    \brief Open62541::ServerThreads::add
+    \param s
+    \param c
+    \return
+*/
+bool Open62541::ServerThreads::add(Server& s, const ThreadConfig& c)
+{
+    if (_running)
+        return false;
+    std::unique_ptr<Entry> e(new Entry);
+    e->server = &s;
+    e->config = c;
+    _entries.push_back(std::move(e));
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerThreads::start
+    \return
+*/
+bool Open62541::ServerThreads::start()
+{
+    if (_running)
+        return false;
+    _running = true;
+    for (auto& e : _entries) {
+        Entry* p  = e.get();
+        p->thread = std::thread([p] {
+            p->config.apply();   // best effort
+            p->server->start();  // runs until stop()
+        });
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::ServerThreads::stop
+*/
+void Open62541::ServerThreads::stop()
+{
+    if (!_running)
+        return;
+    for (auto& e : _entries) {
+        e->server->stop();
+    }
+    for (auto& e : _entries) {
+        if (e->thread.joinable())
+            e->thread.join();
+    }
+    _running = false;
+}
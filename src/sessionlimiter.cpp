@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/sessionlimiter.h>
+#include <algorithm>
+
+/*!
+    \brief Open62541::SessionLimiter::SessionLimiter
+*/
+Open62541::SessionLimiter::SessionLimiter()
+{
+    resetCounts();
+}
+
+/*!
+    \brief Open62541::SessionLimiter::resetCounts
+*/
+void Open62541::SessionLimiter::resetCounts()
+{
+    for (size_t i = 0; i < OperationCount; i++) {
+        _admitted[i] = 0;
+        _rejected[i] = 0;
+    }
+    _busy    = 0;
+    _unknown = 0;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::session
+    Find or add - called with the mutex held
+    \param id
+    \return
+*/
+Open62541::SessionLimiter::Session& Open62541::SessionLimiter::session(const UA_NodeId& id)
+{
+    Session* s = _sessions.value(id);
+    if (!s) {
+        s         = &_sessions.put(id);
+        s->limits = _default;
+        _totalWeight += s->limits.weight;
+    }
+    return *s;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::rate
+    \param s
+    \return refill rate of a session - 0 for unlimited
+*/
+double Open62541::SessionLimiter::rate(const Session& s) const
+{
+    double r = s.limits.rate;
+    if ((_capacity > 0.0) && (_totalWeight > 0.0)) {
+        const double share = _capacity * s.limits.weight / _totalWeight;
+        r                  = (r > 0.0) ? std::min(r, share) : share;
+    }
+    return r;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::setDefaultLimits
+    \param l
+*/
+void Open62541::SessionLimiter::setDefaultLimits(const Limits& l)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _default     = l;
+    _totalWeight = 0.0;
+    for (auto& i : _sessions) {
+        if (!i.second.own)
+            i.second.limits = l;
+        _totalWeight += i.second.limits.weight;
+    }
+}
+
+/*!
+    \brief Open62541::SessionLimiter::setLimits
+    \param id
+    \param l
+*/
+void Open62541::SessionLimiter::setLimits(const UA_NodeId& id, const Limits& l)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    Session& s = session(id);
+    _totalWeight += l.weight - s.limits.weight;
+    s.limits = l;
+    s.own    = true;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::setCapacity
+    \param opsPerSecond
+*/
+void Open62541::SessionLimiter::setCapacity(double opsPerSecond)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    _capacity = std::max(0.0, opsPerSecond);
+}
+
+/*!
+    \brief Open62541::SessionLimiter::open
+    \param id
+*/
+void Open62541::SessionLimiter::open(const UA_NodeId& id)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    session(id);
+}
+
+/*!
+    \brief Open62541::SessionLimiter::close
+    \param id
+*/
+void Open62541::SessionLimiter::close(const UA_NodeId& id)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    Session* s = _sessions.value(id);
+    if (s) {
+        _totalWeight -= s->limits.weight;
+        _sessions.remove(id);
+        if (_sessions.empty())
+            _totalWeight = 0.0;  // no drift
+    }
+}
+
+/*!
+    \brief Open62541::SessionLimiter::admit
+    \param id
+    \param op
+    \param cost
+    \return
+*/
+bool Open62541::SessionLimiter::admit(const UA_NodeId& id, Operation op, double cost)
+{
+    {
+        std::lock_guard<std::mutex> g(_mutex);
+        Session* p = _sessions.value(id);
+        if (!p) {
+            _unknown++;  // closed, or activated before the limiter was set - not added back
+            return false;
+        }
+        Session& s     = *p;
+        const double r = rate(s);
+        if (r > 0.0) {
+            const double burst    = (s.limits.burst > 0.0) ? s.limits.burst : std::max(1.0, r);
+            const UA_DateTime now = UA_DateTime_nowMonotonic();
+            if (s.tokens < 0.0)
+                s.tokens = burst;
+            else
+                s.tokens = std::min(burst, s.tokens + r * double(now - s.last) / double(UA_DATETIME_SEC));
+            s.last = now;
+            if (s.tokens < cost) {
+                _rejected[op]++;
+                return false;
+            }
+            s.tokens -= cost;
+        }
+    }
+    _admitted[op]++;
+    return true;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::enter
+    \param id
+    \return
+*/
+bool Open62541::SessionLimiter::enter(const UA_NodeId& id)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    Session* s = _sessions.value(id);
+    if (!s) {
+        _unknown++;
+        return false;
+    }
+    if (s->limits.concurrent && (s->running >= s->limits.concurrent)) {
+        _busy++;
+        return false;
+    }
+    s->running++;
+    return true;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::leave
+    \param id
+*/
+void Open62541::SessionLimiter::leave(const UA_NodeId& id)
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    Session* s = _sessions.value(id);
+    if (s && s->running)
+        s->running--;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::enterAsync
+    \return
+*/
+bool Open62541::SessionLimiter::enterAsync()
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    if (_default.concurrent && (_asyncRunning >= _default.concurrent)) {
+        _busy++;
+        return false;
+    }
+    _asyncRunning++;
+    return true;
+}
+
+/*!
+    \brief Open62541::SessionLimiter::leaveAsync
+*/
+void Open62541::SessionLimiter::leaveAsync()
+{
+    std::lock_guard<std::mutex> g(_mutex);
+    if (_asyncRunning)
+        _asyncRunning--;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/startuptrace.h>
+#include <algorithm>
+#include <iomanip>
+
+/*!
+    \brief Open62541::StartupTrace::record
+    \param name
+    \param ns
+*/
+void Open62541::StartupTrace::record(const char* name, uint64_t ns)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    auto i = std::find_if(_phases.begin(), _phases.end(), [name](const Phase& p) { return p.name == name; });
+    if (i == _phases.end()) {
+        _phases.emplace_back();
+        i       = _phases.end() - 1;
+        i->name = name;
+    }
+    i->count++;
+    i->ns += ns;
+    i->maxNs = std::max(i->maxNs, ns);
+}
+
+/*!
+    \brief Open62541::StartupTrace::phases
+    \param out
+*/
+void Open62541::StartupTrace::phases(std::vector<Phase>& out) const
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    out = _phases;
+}
+
+/*!
+    \brief Open62541::StartupTrace::report
+    \param os
+*/
+void Open62541::StartupTrace::report(std::ostream& os) const
+{
+    std::vector<Phase> v;
+    phases(v);
+    os << "Startup trace" << std::endl;
+    for (const Phase& p : v) {
+        os << "  " << std::left << std::setw(20) << p.name << std::right << " count " << std::setw(8) << p.count
+           << std::fixed << std::setprecision(3) << " total " << std::setw(10) << p.ns / 1.0e6 << " ms"
+           << " mean " << std::setw(8) << (p.count ? p.ns / 1000.0 / p.count : 0.0) << " us"
+           << " max " << std::setw(8) << p.maxNs / 1000.0 << " us" << std::endl;
+    }
+}
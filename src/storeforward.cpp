@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/storeforward.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const size_t RecordPrefix = sizeof(UA_UInt16) + sizeof(UA_UInt32);  // node and value lengths
+}  // namespace
+
+/*!
+    \brief Open62541::StoreForward::StoreForward
+    \param directory
+    \param maxBytes
+    \param segmentSize
+*/
+Open62541::StoreForward::StoreForward(const std::string& directory, size_t maxBytes, size_t segmentSize)
+    : _directory(directory)
+    , _segmentSize(std::max<size_t>(segmentSize, 4096))
+    , _maxBytes(std::max(maxBytes, _segmentSize))
+{
+}
+
+/*!
+    \brief Open62541::StoreForward::~StoreForward
+*/
+Open62541::StoreForward::~StoreForward() { close(); }
+
+/*!
+    \brief Open62541::StoreForward::segmentPath
+    \param id
+    \return file path of a segment
+*/
+std::string Open62541::StoreForward::segmentPath(UA_UInt32 id) const
+{
+    char b[32];
+    snprintf(b, sizeof(b), "/buffer-%08u.sfq", unsigned(id));
+    return _directory + b;
+}
+
+/*!
+    \brief Open62541::StoreForward::writeManifest
+    The segment range and the delivery position - written as the position moves. Written to a temporary file
+    and renamed over the old one, so a crash mid write leaves the previous manifest rather than a torn one
+*/
+void Open62541::StoreForward::writeManifest()
+{
+    const std::string path = _directory + "/manifest";
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream f(temp, std::ios::trunc);
+        if (!_segments.empty()) {
+            f << _segments.begin()->first << " " << _segments.rbegin()->first << " " << _head.first << " "
+              << _head.second << " " << _headRecords << std::endl;
+        }
+        if (!f)
+            return;  // keep the old manifest
+    }
+    std::rename(temp.c_str(), path.c_str());
+}
+
+/*!
+    \brief Open62541::StoreForward::scan
+    Count the complete blocks of a segment left by an earlier run - a block cut short by a crash ends it
+    \param id
+    \param s
+    \return false if there is no such file
+*/
+bool Open62541::StoreForward::scan(UA_UInt32 id, Segment& s)
+{
+    std::ifstream f(segmentPath(id), std::ios::binary);
+    if (!f)
+        return false;
+    f.seekg(0, std::ios::end);
+    const size_t size = size_t(f.tellg());
+    size_t offset     = 0;
+    BlockHeader h;
+    while (offset + sizeof(h) <= size) {
+        f.seekg(offset);
+        if (!f.read(reinterpret_cast<char*>(&h), sizeof(h)) || (h.magic != Magic) ||
+            (offset + sizeof(h) + h.packed > size))
+            break;
+        s.records += h.count;
+        offset += sizeof(h) + h.packed;
+    }
+    s.bytes = offset;
+    return true;
+}
+
+/*!
+    \brief Open62541::StoreForward::openTail
+    Start a new segment to append to
+    \param id
+    \return true on success
+*/
+bool Open62541::StoreForward::openTail(UA_UInt32 id)
+{
+    _tail.close();
+    _tail.clear();
+    _tail.open(segmentPath(id), std::ios::binary | std::ios::trunc);
+    if (!_tail) {
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        return false;
+    }
+    _segments[id] = Segment();
+    writeManifest();
+    return true;
+}
+
+/*!
+    \brief Open62541::StoreForward::open
+    \return true on success
+*/
+bool Open62541::StoreForward::open()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_open)
+        return true;
+    _lastError      = UA_STATUSCODE_GOOD;
+    UA_UInt32 first = 0;
+    UA_UInt32 last  = 0;
+    Position head(0, 0);
+    size_t headRecords = 0;
+    std::ifstream m(_directory + "/manifest");
+    if (m >> first >> last >> head.first >> head.second >> headRecords) {
+        for (UA_UInt32 id = std::max(first, head.first); id <= last; id++) {
+            Segment s;
+            if (scan(id, s)) {
+                _segments[id] = s;
+                _bytes += s.bytes;
+            }
+        }
+    }
+    if (!_segments.empty() && (_segments.begin()->first == head.first) &&
+        (head.second <= _segments.begin()->second.bytes)) {
+        _head        = head;
+        _headRecords = headRecords;
+    }
+    else {
+        _head        = Position(_segments.empty() ? last + 1 : _segments.begin()->first, 0);
+        _headRecords = 0;
+    }
+    // never append after a block a crash may have cut short
+    if (!openTail(last + 1))
+        return false;
+    _open = true;
+    return true;
+}
+
+/*!
+    \brief Open62541::StoreForward::close
+*/
+void Open62541::StoreForward::close()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!_open)
+        return;
+    writeBlock();
+    writeManifest();
+    _tail.close();
+    _reader.close();
+    _segments.clear();
+    _bytes = 0;
+    _open  = false;
+}
+
+/*!
+    \brief Open62541::StoreForward::append
+    \param node
+    \param value
+    \return true on success
+*/
+bool Open62541::StoreForward::append(const NodeId& node, const UA_DataValue& value)
+{
+    UA_ByteString nb;
+    UA_ByteString vb;
+    UA_ByteString_init(&nb);
+    UA_ByteString_init(&vb);
+    bool ret = false;
+    if ((UA_encodeBinary(node.constRef(), &UA_TYPES[UA_TYPES_NODEID], &nb) == UA_STATUSCODE_GOOD) &&
+        (UA_encodeBinary(&value, &UA_TYPES[UA_TYPES_DATAVALUE], &vb) == UA_STATUSCODE_GOOD) &&
+        (nb.length <= 0xFFFF) && (vb.length <= 0xFFFFFFFF)) {
+        const UA_UInt16 nl = UA_UInt16(nb.length);
+        const UA_UInt32 vl = UA_UInt32(vb.length);
+        std::lock_guard<std::mutex> l(_mutex);
+        if (_open) {
+            const size_t o = _block.size();
+            _block.resize(o + RecordPrefix + nb.length + vb.length);
+            UA_Byte* p = _block.data() + o;
+            memcpy(p, &nl, sizeof(nl));
+            memcpy(p + sizeof(nl), &vl, sizeof(vl));
+            memcpy(p + RecordPrefix, nb.data, nb.length);
+            memcpy(p + RecordPrefix + nb.length, vb.data, vb.length);
+            _blockRecords++;
+            _appended++;
+            ret = (_block.size() < _blockSize) || writeBlock();
+        }
+        else {
+            _lastError = UA_STATUSCODE_BADINVALIDSTATE;
+        }
+    }
+    else {
+        _lastError = UA_STATUSCODE_BADENCODINGERROR;
+    }
+    UA_ByteString_clear(&nb);
+    UA_ByteString_clear(&vb);
+    return ret;
+}
+
+/*!
+    \brief Open62541::StoreForward::flush
+    \return true on success
+*/
+bool Open62541::StoreForward::flush()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!_open) {
+        _lastError = UA_STATUSCODE_BADINVALIDSTATE;
+        return false;
+    }
+    return writeBlock();
+}
+
+/*!
+    \brief Open62541::StoreForward::feed
+    \param node
+    \return
+*/
+Open62541::monitorItemFunc Open62541::StoreForward::feed(const NodeId& node)
+{
+    return [this, node](ClientSubscription&, UA_DataValue* v) {
+        if (v)
+            append(node, *v);
+    };
+}
+
+/*!
+    \brief Open62541::StoreForward::writeBlock
+    Compress and write the pending records - called with the mutex held
+    \return true on success
+*/
+bool Open62541::StoreForward::writeBlock()
+{
+    if (_block.empty())
+        return true;
+    std::vector<UA_Byte> packed;
+    packed.reserve(_block.size() / 2);
+    compress(_block.data(), _block.size(), packed);
+    BlockHeader h;
+    h.magic             = Magic;
+    h.count             = UA_UInt32(_blockRecords);
+    h.raw               = UA_UInt32(_block.size());
+    h.packed            = UA_UInt32(packed.size());
+    const size_t length = sizeof(h) + packed.size();
+    _block.clear();
+    _blockRecords = 0;
+    UA_UInt32 id  = _segments.rbegin()->first;
+    if (_segments.rbegin()->second.bytes && (_segments.rbegin()->second.bytes + length > _segmentSize)) {
+        if (!openTail(++id)) {
+            _dropped += h.count;
+            return false;
+        }
+    }
+    _tail.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    _tail.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    _tail.flush();
+    if (!_tail) {
+        _tail.clear();
+        _dropped += h.count;
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        openTail(id + 1);  // a partly written block ends the segment
+        return false;
+    }
+    Segment& s = _segments[id];
+    s.bytes += length;
+    s.records += h.count;
+    _bytes += length;
+    retain();
+    return true;
+}
+
+/*!
+    \brief Open62541::StoreForward::retain
+    Drop the oldest segments beyond the size bound - called with the mutex held
+*/
+void Open62541::StoreForward::retain()
+{
+    bool changed = false;
+    while ((_bytes > _maxBytes) && (_segments.size() > 1)) {
+        auto i = _segments.begin();
+        _dropped += i->second.records - ((i->first == _head.first) ? _headRecords : 0);
+        _bytes -= i->second.bytes;
+        std::remove(segmentPath(i->first).c_str());
+        if (_head.first <= i->first) {
+            _head        = Position(std::next(i)->first, 0);
+            _headRecords = 0;
+        }
+        _segments.erase(i);
+        changed = true;
+    }
+    if (changed)
+        writeManifest();
+}
+
+/*!
+    \brief Open62541::StoreForward::readBlock
+    Read the block at a position and move past it - called with the mutex held
+    \param p
+    \param consumed records of p's segment before p - kept with p
+    \param out decoded records appended
+    \return false if there are no more blocks
+*/
+bool Open62541::StoreForward::readBlock(Position& p, size_t& consumed, std::vector<Record>& out)
+{
+    auto i = _segments.lower_bound(p.first);
+    while ((i != _segments.end()) && ((i->first != p.first) || (p.second >= i->second.bytes))) {
+        if (i->first == p.first)
+            ++i;  // this one is done
+        if (i == _segments.end())
+            return false;
+        p        = Position(i->first, 0);
+        consumed = 0;
+    }
+    if (i == _segments.end())
+        return false;
+    if (!_reader.is_open() || (_readerSegment != p.first)) {
+        _reader.close();
+        _reader.open(segmentPath(p.first), std::ios::binary);
+        _readerSegment = p.first;
+    }
+    _reader.clear();
+    _reader.seekg(p.second);
+    BlockHeader h;
+    std::vector<UA_Byte> packed;
+    if (_reader.read(reinterpret_cast<char*>(&h), sizeof(h)) && (h.magic == Magic)) {
+        packed.resize(h.packed);
+        _reader.read(reinterpret_cast<char*>(packed.data()), packed.size());
+    }
+    if (!_reader || (h.magic != Magic)) {
+        // unreadable - skip the rest of the segment
+        _dropped += i->second.records - consumed;
+        consumed   = i->second.records;
+        p.second   = i->second.bytes;
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+        return true;
+    }
+    p.second += sizeof(h) + h.packed;
+    consumed += h.count;
+    std::vector<UA_Byte> raw;
+    if (!expand(packed.data(), packed.size(), raw, h.raw)) {
+        _dropped += h.count;
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+        return true;
+    }
+    size_t o = 0;
+    while (o + RecordPrefix <= raw.size()) {
+        UA_UInt16 nl;
+        UA_UInt32 vl;
+        memcpy(&nl, raw.data() + o, sizeof(nl));
+        memcpy(&vl, raw.data() + o + sizeof(nl), sizeof(vl));
+        if (o + RecordPrefix + nl + vl > raw.size())
+            break;
+        UA_ByteString nb;
+        nb.length = nl;
+        nb.data   = raw.data() + o + RecordPrefix;
+        UA_ByteString vb;
+        vb.length = vl;
+        vb.data   = nb.data + nl;
+        out.emplace_back();
+        Record& r = out.back();
+        r.node.null();
+        r.value.null();
+        size_t no = 0;
+        size_t vo = 0;
+        if ((UA_decodeBinary(&nb, &no, r.node.ref(), &UA_TYPES[UA_TYPES_NODEID], nullptr) != UA_STATUSCODE_GOOD) ||
+            (UA_decodeBinary(&vb, &vo, r.value.ref(), &UA_TYPES[UA_TYPES_DATAVALUE], nullptr) !=
+             UA_STATUSCODE_GOOD)) {
+            out.pop_back();
+            _dropped++;
+            _lastError = UA_STATUSCODE_BADDECODINGERROR;
+        }
+        o += RecordPrefix + nl + vl;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::StoreForward::commit
+    Move the delivery position after a batch was accepted and delete the segments passed - called with the mutex
+    held. Segments dropped by the size bound while the sink ran may already have moved it further
+    \param to
+    \param consumed
+*/
+void Open62541::StoreForward::commit(const Position& to, size_t consumed)
+{
+    if (_head < to) {
+        _head        = to;
+        _headRecords = consumed;
+    }
+    while ((_segments.size() > 1) && (_segments.begin()->first < _head.first)) {
+        auto i = _segments.begin();
+        _bytes -= i->second.bytes;
+        std::remove(segmentPath(i->first).c_str());
+        _segments.erase(i);
+    }
+    writeManifest();
+}
+
+/*!
+    \brief Open62541::StoreForward::drain
+    \param sink
+    \param batchSize
+    \param maxBatches
+    \return records delivered
+*/
+size_t Open62541::StoreForward::drain(Sink sink, size_t batchSize, size_t maxBatches)
+{
+    std::lock_guard<std::mutex> d(_drainMutex);
+    size_t total   = 0;
+    size_t batches = 0;
+    std::vector<Record> batch;
+    while (!maxBatches || (batches < maxBatches)) {
+        batch.clear();
+        Position to;
+        size_t consumed = 0;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            if (!_open)
+                break;
+            to       = _head;
+            consumed = _headRecords;
+            while ((batch.size() < batchSize) && readBlock(to, consumed, batch)) {
+            }
+            if ((to == _head) && writeBlock()) {  // caught up - take the pending records too
+                while ((batch.size() < batchSize) && readBlock(to, consumed, batch)) {
+                }
+            }
+            if (to == _head)
+                break;  // empty
+        }
+        if (!batch.empty() && !sink(batch))
+            break;  // kept for the next drain
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            commit(to, consumed);
+        }
+        total += batch.size();
+        _delivered += batch.size();
+        batches++;
+    }
+    return total;
+}
+
+/*!
+    \brief Open62541::StoreForward::backlog
+    \return records not yet delivered
+*/
+size_t Open62541::StoreForward::backlog()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = _blockRecords;
+    for (const auto& s : _segments) {
+        n += s.second.records;
+    }
+    return n - std::min(n, _headRecords);
+}
+
+/*!
+    \brief Open62541::StoreForward::compress
+    A control byte below 0x80 is followed by that many plus one literal bytes. Otherwise its low bits are a match
+    length less four followed by a 16 bit little endian distance back into the output
+    \param in
+    \param length
+    \param out
+*/
+void Open62541::StoreForward::compress(const UA_Byte* in, size_t length, std::vector<UA_Byte>& out)
+{
+    enum { HashBits = 14, MinMatch = 4, MaxMatch = 0x7F + MinMatch, MaxLiterals = 0x80 };
+    const UA_UInt32 none = 0xFFFFFFFF;
+    std::vector<UA_UInt32> table(size_t(1) << HashBits, none);  // last position of each 4 byte hash
+    size_t literal = 0;                                           // start of the pending literal run
+    auto literals  = [&](size_t end) {
+        while (literal < end) {
+            const size_t n = std::min<size_t>(end - literal, MaxLiterals);
+            out.push_back(UA_Byte(n - 1));
+            out.insert(out.end(), in + literal, in + literal + n);
+            literal += n;
+        }
+    };
+    size_t i = 0;
+    while (i + MinMatch <= length) {
+        UA_UInt32 v;
+        memcpy(&v, in + i, sizeof(v));
+        const size_t h = (v * 2654435761U) >> (32 - HashBits);
+        const size_t c = table[h];
+        table[h]       = UA_UInt32(i);
+        if ((c != none) && (i - c <= 0xFFFF) && !memcmp(in + c, in + i, MinMatch)) {
+            size_t n = MinMatch;
+            while ((n < MaxMatch) && (i + n < length) && (in[c + n] == in[i + n]))
+                n++;
+            literals(i);
+            const size_t d = i - c;
+            out.push_back(UA_Byte(0x80 | (n - MinMatch)));
+            out.push_back(UA_Byte(d & 0xFF));
+            out.push_back(UA_Byte(d >> 8));
+            i += n;
+            literal = i;
+        }
+        else {
+            i++;
+        }
+    }
+    literals(length);
+}
+
+/*!
+    \brief Open62541::StoreForward::expand
+    \param in
+    \param length
+    \param out
+    \param limit
+    \return true on success
+*/
+bool Open62541::StoreForward::expand(const UA_Byte* in, size_t length, std::vector<UA_Byte>& out, size_t limit)
+{
+    const size_t base = out.size();
+    out.reserve(base + limit);  // matches copy from out into itself
+    size_t i = 0;
+    while (i < length) {
+        const UA_Byte t = in[i++];
+        if (t < 0x80) {
+            const size_t n = size_t(t) + 1;
+            if ((i + n > length) || (out.size() - base + n > limit))
+                return false;
+            out.insert(out.end(), in + i, in + i + n);
+            i += n;
+        }
+        else {
+            if (i + 2 > length)
+                return false;
+            const size_t n = size_t(t & 0x7F) + 4;
+            const size_t d = size_t(in[i]) | (size_t(in[i + 1]) << 8);
+            i += 2;
+            if (!d || (d > out.size() - base) || (out.size() - base + n > limit))
+                return false;
+            const size_t s = out.size() - d;
+            for (size_t k = 0; k < n; k++)
+                out.push_back(out[s + k]);
+        }
+    }
+    return out.size() - base == limit;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/subscriptionvaluecache.h>
+
+/*!
+    \brief Open62541::SubscriptionValueCache::attach
+    \param n
+    \return entry
+*/
+Open62541::SubscriptionValueCache::EntryRef Open62541::SubscriptionValueCache::attach(const NodeId& n)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    std::shared_ptr<const Index> current = index();
+    auto i                               = current->find(*n.constRef());
+    if (i != current->end()) {
+        i->second->subscribers++;
+        return i->second;
+    }
+    auto e  = std::make_shared<Entry>();
+    e->node = n;  // owns the key
+    e->subscribers++;
+    // copy on write - readers keep the old index until they next look, keys are shallow so this is cheap
+    auto m = std::make_shared<Index>(*current);
+    m->emplace(*e->node.constRef(), e);
+    std::atomic_store(&_index, std::shared_ptr<const Index>(m));
+    return e;
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::detach
+    \param e
+*/
+void Open62541::SubscriptionValueCache::detach(const EntryRef& e)
+{
+    if (e && (e->subscribers > 0))
+        e->subscribers--;
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::update
+    \param e
+    \param v
+*/
+void Open62541::SubscriptionValueCache::update(Entry& e, const UA_DataValue& v)
+{
+    update(e, SharedDataValue::copyOf(v));
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::update
+    \param e
+    \param v
+*/
+void Open62541::SubscriptionValueCache::update(Entry& e, const SharedDataValue& v)
+{
+    SharedDataValue::store(e.value, v);
+    e.received = UA_DateTime_now();
+    e.valid    = true;
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::find
+    \param n
+    \return entry or null
+*/
+Open62541::SubscriptionValueCache::EntryRef Open62541::SubscriptionValueCache::find(const NodeId& n) const
+{
+    std::shared_ptr<const Index> m = index();
+    auto i                         = m->find(*n.constRef());
+    return (i != m->end()) ? i->second : EntryRef();
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::read
+    \param n
+    \param out
+    \param received
+    \return freshness
+*/
+Open62541::SubscriptionValueCache::Freshness Open62541::SubscriptionValueCache::read(const NodeId& n,
+                                                                                   DataValue& out,
+                                                                                   UA_DateTime* received) const
+{
+    SharedDataValue v;
+    Freshness f = read(n, v, received);
+    if (v) {
+        UA_DataValue_clear(out.ref());
+        UA_DataValue_copy(&v.get(), out.ref());
+    }
+    return f;
+}
+
+/*!
+    \brief Open62541::SubscriptionValueCache::read
+    \param n
+    \param out
+    \param received
+    \return freshness
+*/
+Open62541::SubscriptionValueCache::Freshness Open62541::SubscriptionValueCache::read(const NodeId& n,
+                                                                                   SharedDataValue& out,
+                                                                                   UA_DateTime* received) const
+{
+    EntryRef e = find(n);
+    if (!e)
+        return Freshness::Missing;
+    SharedDataValue v = SharedDataValue::load(e->value);
+    if (!v)
+        return Freshness::Missing;  // subscribed but no notification yet
+    out                 = v;
+    const UA_DateTime t = e->received;
+    if (received)
+        *received = t;
+    const UA_DateTime maxAge = _maxAge;
+    if (!e->valid || (e->subscribers == 0))
+        return Freshness::Stale;
+    if ((maxAge > 0) && ((UA_DateTime_now() - t) > maxAge))
+        return Freshness::Stale;
+    return Freshness::Fresh;
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/tagimage.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+static_assert(sizeof(Open62541::TagImage::Header) == 64, "TagImage::Header must be one cache line");
+static_assert(sizeof(Open62541::TagImage::Slot) == 64, "TagImage::Slot must be one cache line");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "TagImage needs lock free atomics to share them between processes");
+
+namespace {
+/*!
+    \brief maxTries
+    Attempts at a consistent copy before a read gives up - a write takes well under a microsecond
+*/
+const int maxTries = 1000;
+
+/*!
+    \brief The TagContext class
+    Data source of a node bound to a slot
+*/
+class TagContext : public Open62541::NodeContext
+{
+    Open62541::TagImage& _image;
+    size_t _slot;
+
+public:
+    TagContext(Open62541::TagImage& t, size_t i)
+        : NodeContext("TagImage")
+        , _image(t)
+        , _slot(i)
+    {
+    }
+    bool hasReadDataView() const { return true; }
+    bool readDataView(Open62541::Server&, const UA_NodeId&, const UA_NumericRange* range, UA_DataValue& value)
+    {
+        if (!_image.read(_slot, value))
+            return false;
+        if (range) {
+            UA_Variant v;
+            UA_Variant_init(&v);
+            if (UA_Variant_copyRange(&value.value, &v, *range) != UA_STATUSCODE_GOOD)
+                return false;
+            UA_Variant_clear(&value.value);
+            value.value = v;
+        }
+        return true;
+    }
+};
+}  // namespace
+
+/*!
+    \brief Open62541::TagImage::create
+    \param name
+    \param slots
+    \param valueSize
+    \return true on success
+*/
+bool Open62541::TagImage::create(const std::string& name, size_t slots, size_t valueSize)
+{
+    close();
+    const size_t stride = (sizeof(Slot) + valueSize + 63) & ~size_t(63);  // slots on cache lines
+    const size_t bytes  = sizeof(Header) + slots * stride;
+    if (!slots || !valueSize || (stride > UA_UINT32_MAX) || (slots > UA_UINT32_MAX)) {
+        _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+        return false;
+    }
+    try {
+        boost::interprocess::shared_memory_object::remove(name.c_str());
+        _shm = boost::interprocess::shared_memory_object(boost::interprocess::create_only,
+                                                         name.c_str(),
+                                                         boost::interprocess::read_write);
+        _shm.truncate(boost::interprocess::offset_t(bytes));
+        _region = boost::interprocess::mapped_region(_shm, boost::interprocess::read_write);
+    }
+    catch (...) {
+        _lastError = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        boost::interprocess::shared_memory_object::remove(name.c_str());
+        _shm = boost::interprocess::shared_memory_object();
+        return false;
+    }
+    _header = static_cast<Header*>(_region.get_address());
+    std::memset(static_cast<void*>(_header), 0, bytes);
+    _header->version   = Version;
+    _header->slots     = UA_UInt32(slots);
+    _header->stride    = UA_UInt32(stride);
+    _header->valueSize = UA_UInt32(stride - sizeof(Slot));  // the padding is usable
+    _header->count.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = Magic;  // last - a producer opening early sees no magic
+    _name          = name;
+    _owner         = true;
+    _writable      = true;
+    _lastError     = UA_STATUSCODE_GOOD;
+    return true;
+}
+
+/*!
+    \brief Open62541::TagImage::open
+    \param name
+    \param writable
+    \return true on success
+*/
+bool Open62541::TagImage::open(const std::string& name, bool writable)
+{
+    close();
+    const boost::interprocess::mode_t m = writable ? boost::interprocess::read_write : boost::interprocess::read_only;
+    try {
+        _shm    = boost::interprocess::shared_memory_object(boost::interprocess::open_only, name.c_str(), m);
+        _region = boost::interprocess::mapped_region(_shm, m);
+    }
+    catch (...) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        close();
+        return false;
+    }
+    Header* h         = static_cast<Header*>(_region.get_address());
+    const size_t size = _region.get_size();
+    if ((size < sizeof(Header)) || (h->magic != Magic) || (h->version != Version) ||
+        (h->stride < sizeof(Slot) + h->valueSize) || (size < sizeof(Header) + size_t(h->slots) * h->stride)) {
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+        close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    _header    = h;
+    _name      = name;
+    _writable  = writable;
+    _lastError = UA_STATUSCODE_GOOD;
+    return true;
+}
+
+/*!
+    \brief Open62541::TagImage::close
+*/
+void Open62541::TagImage::close()
+{
+    _header = nullptr;
+    _region = boost::interprocess::mapped_region();
+    _shm    = boost::interprocess::shared_memory_object();
+    if (_owner)
+        boost::interprocess::shared_memory_object::remove(_name.c_str());
+    _owner    = false;
+    _writable = false;
+}
+
+/*!
+    \brief Open62541::TagImage::define
+    \param tag
+    \param type
+    \param arrayLength
+    \return slot or -1
+*/
+int Open62541::TagImage::define(const std::string& tag, const UA_DataType* type, size_t arrayLength)
+{
+    _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+    if (!_header || !_writable || !type || (type < UA_TYPES) || (type >= UA_TYPES + UA_TYPES_COUNT))
+        return -1;
+    if (!type->pointerFree || tag.empty() || (tag.size() >= NameSize))
+        return -1;
+    if ((arrayLength ? arrayLength : 1) * type->memSize > _header->valueSize)
+        return -1;
+    if (find(tag) >= 0) {
+        _lastError = UA_STATUSCODE_BADNODEIDEXISTS;
+        return -1;
+    }
+    const UA_UInt32 n = _header->count.load(std::memory_order_relaxed);
+    if (n >= _header->slots) {
+        _lastError = UA_STATUSCODE_BADOUTOFMEMORY;
+        return -1;
+    }
+    Slot* s = slot(n);
+    s->sequence.store(0, std::memory_order_relaxed);
+    s->type   = UA_UInt16(type - UA_TYPES);
+    s->flags  = arrayLength ? UA_UInt16(Array) : 0;
+    s->length = arrayLength ? UA_UInt32(arrayLength) : 1;
+    s->status = UA_STATUSCODE_GOOD;
+    std::memcpy(s->name, tag.c_str(), tag.size() + 1);
+    _header->count.store(n + 1, std::memory_order_release);  // publish the slot
+    _lastError = UA_STATUSCODE_GOOD;
+    return int(n);
+}
+
+/*!
+    \brief Open62541::TagImage::find
+    \param tag
+    \return slot or -1
+*/
+int Open62541::TagImage::find(const std::string& tag) const
+{
+    const size_t n = count();
+    for (size_t i = 0; i < n; i++) {
+        if (tag == slot(i)->name)
+            return int(i);
+    }
+    return -1;
+}
+
+/*!
+    \brief Open62541::TagImage::tagName
+    \param i
+    \return name or empty
+*/
+std::string Open62541::TagImage::tagName(size_t i) const
+{
+    return (i < count()) ? std::string(slot(i)->name) : std::string();
+}
+
+/*!
+    \brief Open62541::TagImage::tagType
+    \param i
+    \return type or null
+*/
+const UA_DataType* Open62541::TagImage::tagType(size_t i) const
+{
+    return ((i < count()) && (slot(i)->type < UA_TYPES_COUNT)) ? &UA_TYPES[slot(i)->type] : nullptr;
+}
+
+/*!
+    \brief Open62541::TagImage::write
+    \param i
+    \param data
+    \param length
+    \param sourceTimestamp
+    \param status
+    \return true on success
+*/
+bool Open62541::TagImage::write(size_t i,
+                                const void* data,
+                                size_t length,
+                                UA_DateTime sourceTimestamp,
+                                UA_StatusCode status)
+{
+    if (!_writable || (i >= count()) || !data)
+        return false;
+    Slot* s            = slot(i);
+    const bool array   = (s->flags & Array) != 0;
+    const size_t n     = array ? length : 1;
+    const size_t bytes = n * UA_TYPES[s->type].memSize;
+    if (bytes > _header->valueSize)
+        return false;
+    const UA_UInt32 q = s->sequence.load(std::memory_order_relaxed);
+    s->sequence.store(q + 1, std::memory_order_relaxed);  // odd - readers retry
+    std::atomic_thread_fence(std::memory_order_release);  // the odd sequence is seen before any of the value
+    std::memcpy(valueOf(s), data, bytes);
+    s->length          = UA_UInt32(n);
+    s->status          = status;
+    s->sourceTimestamp = sourceTimestamp;
+    s->sequence.store(q + 2, std::memory_order_release);
+    return true;
+}
+
+/*!
+    \brief Open62541::TagImage::read
+    \param i
+    \param value
+    \return true on success
+*/
+bool Open62541::TagImage::read(size_t i, UA_DataValue& value)
+{
+    if ((i >= count()) || (slot(i)->type >= UA_TYPES_COUNT))  // the segment is shared - do not trust it
+        return false;
+    Slot* s                 = slot(i);
+    const UA_DataType* type = &UA_TYPES[s->type];
+    const bool array        = (s->flags & Array) != 0;
+    const size_t maxLength  = array ? _header->valueSize / type->memSize : 1;
+    void* data              = UA_Array_new(maxLength, type);  // pointer free - filled by copying
+    if (!data)
+        return false;
+    for (int tries = 0; tries < maxTries; tries++) {
+        if (tries > 0) {
+            _retries++;
+            if ((tries % 64) == 0)
+                std::this_thread::yield();  // the writer may have been preempted
+        }
+        const UA_UInt32 q = s->sequence.load(std::memory_order_acquire);
+        if (q & 1)
+            continue;
+        const size_t n                    = std::min<size_t>(s->length, maxLength);  // checked - may be torn
+        const UA_StatusCode status        = s->status;
+        const UA_DateTime sourceTimestamp = s->sourceTimestamp;
+        std::memcpy(data, valueOf(s), n * type->memSize);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->sequence.load(std::memory_order_relaxed) != q)
+            continue;
+        UA_DataValue_clear(&value);
+        if (array) {
+            if (n == 0) {
+                UA_free(data);
+                data = UA_EMPTY_ARRAY_SENTINEL;
+            }
+            UA_Variant_setArray(&value.value, data, n, type);
+        }
+        else {
+            UA_Variant_setScalar(&value.value, data, type);
+        }
+        value.hasValue           = true;
+        value.status             = status;
+        value.hasStatus          = status != UA_STATUSCODE_GOOD;
+        value.sourceTimestamp    = sourceTimestamp;
+        value.hasSourceTimestamp = sourceTimestamp != 0;
+        return true;
+    }
+    UA_Array_delete(data, maxLength, type);
+    return false;
+}
+
+/*!
+    \brief Open62541::TagImage::sequence
+    \param i
+    \return sequence
+*/
+UA_UInt32 Open62541::TagImage::sequence(size_t i) const
+{
+    return (i < count()) ? (slot(i)->sequence.load(std::memory_order_acquire) & ~UA_UInt32(1)) : 0;
+}
+
+/*!
+    \brief Open62541::TagImage::bind
+    \param server
+    \param node
+    \param i
+    \return true on success
+*/
+bool Open62541::TagImage::bind(Server& server, NodeId& node, size_t i)
+{
+    _lastError = UA_STATUSCODE_BADINVALIDARGUMENT;
+    if ((i >= count()) || !server.server())
+        return false;
+    void* c    = nullptr;
+    _lastError = UA_Server_getNodeContext(server.server(), node.get(), &c);
+    if (_lastError != UA_STATUSCODE_GOOD)
+        return false;
+    if (c) {
+        _lastError = UA_STATUSCODE_BADINVALIDSTATE;  // belongs to something else
+        return false;
+    }
+    _contexts.emplace_back(new TagContext(*this, i));
+    NodeContext* t = _contexts.back().get();
+    if (!server.setNodeContext(node, t) || !t->setAsDataSource(server, node)) {
+        _lastError = server.lastError();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TagImage::addNodes
+    \param server
+    \param parent
+    \param folder
+    \param nameSpaceIndex
+    \return true on success
+*/
+bool Open62541::TagImage::addNodes(Server& server, const NodeId& parent, const std::string& folder, int nameSpaceIndex)
+{
+    const NodeId root(nameSpaceIndex, folder);
+    if (!server.addFolder(parent, folder, root, NodeId::Null, nameSpaceIndex)) {
+        _lastError = server.lastError();
+        return false;
+    }
+    const size_t n = count();
+    for (size_t i = 0; i < n; i++) {
+        const std::string tag = tagName(i);
+        NodeId node(nameSpaceIndex, folder + "." + tag);
+        Variant v;
+        UA_DataValue d;
+        UA_DataValue_init(&d);
+        if (read(i, d))
+            v.assignFrom(d.value);  // the initial value fixes the data type
+        UA_DataValue_clear(&d);
+        if (!server.addVariable(root, tag, v, node, NodeId::Null, nullptr, nameSpaceIndex)) {
+            _lastError = server.lastError();
+            return false;
+        }
+        if (!bind(server, node, i))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/threadconfig.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*!
+    \brief Open62541::ThreadConfig::apply
+    \param index
+    \return
+*/
+bool Open62541::ThreadConfig::apply(int index) const
+{
+    bool ok = true;
+#ifdef __linux__
+    if (!name.empty()) {
+        std::string n = (index >= 0) ? name + std::to_string(index) : name;
+        if (n.size() > 15)
+            n.resize(15);  // kernel limit
+        ok &= pthread_setname_np(pthread_self(), n.c_str()) == 0;
+    }
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : cpus) {
+            if ((c >= 0) && (c < CPU_SETSIZE))
+                CPU_SET(c, &set);
+        }
+        ok &= pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+    if (priority > 0) {
+        sched_param p;
+        p.sched_priority = priority;
+        ok &= pthread_setschedparam(pthread_self(), SCHED_FIFO, &p) == 0;
+    }
+#ifdef SYS_set_mempolicy
+    if (numaNode >= 0) {
+        // MPOL_PREFERRED from <numaif.h> - called directly so libnuma is not needed
+        const int preferred = 1;
+        const size_t bits   = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(size_t(numaNode) / bits + 1, 0);
+        mask[size_t(numaNode) / bits] |= 1UL << (size_t(numaNode) % bits);
+        ok &= syscall(SYS_set_mempolicy, preferred, mask.data(), mask.size() * bits + 1) == 0;
+    }
+#else
+    ok &= numaNode < 0;
+#endif
+#else
+    (void)index;
+    ok = empty();
+#endif
+    return ok;
+}
@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/tieredhistorian.h>
+#include <algorithm>
+
+static inline bool isGood(UA_StatusCode s) { return (s & 0xC0000000) == 0; }
+
+/*!
+    \brief Open62541::TieredHistoryBackend::TieredHistoryBackend
+    \param tiers
+*/
+Open62541::TieredHistoryBackend::TieredHistoryBackend(const std::vector<Tier>& tiers)
+    : _tiers(tiers)
+{
+    if (_tiers.empty())
+        _tiers.push_back(Tier());
+    _tiers[0].interval = 0;  // the first tier is always raw
+    for (size_t i = 1; i < _tiers.size(); i++) {
+        if (_tiers[i].interval <= 0)
+            _tiers[i].interval = UA_DATETIME_SEC;
+    }
+    initialise();
+    database().getHistoryData = nullptr;  // the default database then uses the low level interface
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::standardTiers
+    \return tiers
+*/
+std::vector<Open62541::TieredHistoryBackend::Tier> Open62541::TieredHistoryBackend::standardTiers()
+{
+    const UA_DateTime hour = UA_DateTime(3600) * UA_DATETIME_SEC;
+    std::vector<Tier> t;
+    t.push_back(Tier(0, hour));
+    t.push_back(Tier(60 * UA_DATETIME_SEC, 30 * 24 * hour));
+    t.push_back(Tier(hour, 0));
+    return t;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::setRetention
+    \param tier
+    \param retention
+    \param maxValues
+*/
+void Open62541::TieredHistoryBackend::setRetention(size_t tier, UA_DateTime retention, size_t maxValues)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (tier < _tiers.size()) {
+        _tiers[tier].retention = retention;
+        _tiers[tier].maxValues = maxValues;
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::setAggregate
+    \param tier
+    \param a
+*/
+void Open62541::TieredHistoryBackend::setAggregate(size_t tier, HistoryAggregates::Aggregate a)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if ((tier > 0) && (tier < _tiers.size()))
+        _tiers[tier].aggregate = a;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::series
+    \param n
+    \param create
+    \return series or nullptr
+*/
+Open62541::TieredHistoryBackend::Series* Open62541::TieredHistoryBackend::series(const NodeId& n, bool create)
+{
+    Series* s = _series.value(*n.constRef());
+    if (!s && create) {
+        s = &_series.put(*n.constRef());
+        s->rollups.resize(_tiers.size() - 1);
+    }
+    return s;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::bucketStart
+    \param t
+    \param interval
+    \return start of the interval holding t
+*/
+UA_DateTime Open62541::TieredHistoryBackend::bucketStart(UA_DateTime t, UA_DateTime interval)
+{
+    UA_DateTime r = t % interval;
+    return (r < 0) ? t - r - interval : t - r;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::keyOf
+    \return key time of a value of a tier
+*/
+UA_DateTime Open62541::TieredHistoryBackend::keyOf(const Series& s, size_t tier, size_t i) const
+{
+    return tier ? s.rollups[tier - 1][i].start : historyKey(*s.raw[i].constRef());
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::tierSize
+    \return values in a tier
+*/
+size_t Open62541::TieredHistoryBackend::tierSize(const Series& s, size_t tier) const
+{
+    return tier ? s.rollups[tier - 1].size() : s.raw.size();
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::lowerBound
+    \return first value of a tier at or after t
+*/
+size_t Open62541::TieredHistoryBackend::lowerBound(const Series& s, size_t tier, UA_DateTime t) const
+{
+    return searchTime(tierSize(s, tier), t, false, [this, &s, tier](size_t i) { return keyOf(s, tier, i); });
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::view
+    Each tier contributes the values before the oldest of the finer tiers
+    \param s
+    \param v
+*/
+void Open62541::TieredHistoryBackend::view(const Series& s, View& v) const
+{
+    size_t n = _tiers.size();
+    v.count.assign(n, 0);
+    v.offset.assign(n, 0);
+    bool limited       = false;
+    UA_DateTime cutoff = 0;
+    for (size_t k = 0; k < n; k++) {
+        v.count[k] = limited ? lowerBound(s, k, cutoff) : tierSize(s, k);
+        if (v.count[k]) {
+            cutoff  = keyOf(s, k, 0);
+            limited = true;
+        }
+    }
+    v.size = 0;
+    for (size_t k = n; k-- > 0;) {
+        v.offset[k] = v.size;
+        v.size += v.count[k];
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::locate
+    \param v
+    \param index view index
+    \param tier set to the tier of the value
+    \param i set to the index in the tier
+    \return false if out of range
+*/
+bool Open62541::TieredHistoryBackend::locate(const View& v, size_t index, size_t& tier, size_t& i) const
+{
+    for (size_t k = v.count.size(); k-- > 0;) {
+        if (index < v.offset[k] + v.count[k]) {
+            tier = k;
+            i    = index - v.offset[k];
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::valueOf
+    \param s
+    \param tier
+    \param i
+    \param d set to a copy of the raw value or the rollup
+*/
+void Open62541::TieredHistoryBackend::valueOf(const Series& s, size_t tier, size_t i, UA_DataValue& d) const
+{
+    if (!tier) {
+        UA_DataValue_copy(s.raw[i].constRef(), &d);
+        return;
+    }
+    const Bucket& b = s.rollups[tier - 1][i];
+    DataValue r;
+    HistoryAggregates::setResult(r, b.start, _tiers[tier].aggregate, b.summary);
+    r.ref()->sourceTimestamp = b.start;  // the index key, also for Minimum and Maximum
+    d = *r.ref();                        // take it over
+    UA_DataValue_init(r.ref());
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::roll
+    Add a value to the rollup of its interval in each rollup tier
+    \param s
+    \param t
+    \param v
+*/
+void Open62541::TieredHistoryBackend::roll(Series& s, UA_DateTime t, const UA_DataValue& v)
+{
+    double d  = 0.0;
+    bool good = (!v.hasStatus || isGood(v.status)) && HistoryAggregates::toDouble(v, d);
+    for (size_t k = 1; k < _tiers.size(); k++) {
+        std::deque<Bucket>& q = s.rollups[k - 1];
+        UA_DateTime start     = bucketStart(t, _tiers[k].interval);
+        Bucket* b             = nullptr;
+        if (q.empty() || (start > q.back().start)) {
+            q.emplace_back();
+            b        = &q.back();
+            b->start = start;
+        }
+        else if (start == q.back().start) {
+            b = &q.back();  // the usual case
+        }
+        else {
+            auto i = std::lower_bound(q.begin(), q.end(), start, [](const Bucket& x, UA_DateTime y) {
+                return x.start < y;
+            });
+            if ((i == q.end()) || (i->start != start)) {
+                i        = q.emplace(i);
+                i->start = start;
+            }
+            b = &(*i);
+        }
+        if (good)
+            b->summary.add(t, d);
+        else
+            b->summary.bad++;
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::rebuild
+    Recompute the rollups overlapping a changed range from the raw values - rollups of intervals the
+    raw tier no longer holds in full are left as they are
+    \param s
+    \param from
+    \param to inclusive
+*/
+void Open62541::TieredHistoryBackend::rebuild(Series& s, UA_DateTime from, UA_DateTime to)
+{
+    if (s.raw.empty())
+        return;
+    UA_DateTime oldest = keyOf(s, 0, 0);
+    for (size_t k = 1; k < _tiers.size(); k++) {
+        std::deque<Bucket>& q  = s.rollups[k - 1];
+        UA_DateTime interval   = _tiers[k].interval;
+        UA_DateTime first      = std::max(bucketStart(from, interval), bucketStart(oldest, interval));
+        if (first < oldest)
+            first += interval;  // partly before the raw values
+        for (UA_DateTime start = first; (start <= to) && (start >= first); start += interval) {
+            Bucket b;
+            b.start = start;
+            for (size_t i = lowerBound(s, 0, start); (i < s.raw.size()) && (keyOf(s, 0, i) < start + interval); i++) {
+                const UA_DataValue& v = *s.raw[i].constRef();
+                double d              = 0.0;
+                if ((!v.hasStatus || isGood(v.status)) && HistoryAggregates::toDouble(v, d))
+                    b.summary.add(historyKey(v), d);
+                else
+                    b.summary.bad++;
+            }
+            auto i = std::lower_bound(q.begin(), q.end(), start, [](const Bucket& x, UA_DateTime y) {
+                return x.start < y;
+            });
+            bool exists = (i != q.end()) && (i->start == start);
+            if (b.summary.count || b.summary.bad) {
+                if (exists)
+                    *i = b;
+                else
+                    q.insert(i, b);
+            }
+            else if (exists) {
+                q.erase(i);
+            }
+        }
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::retain
+    Drop what is past each tier's retention or beyond its cap
+    \param s
+    \param now
+*/
+void Open62541::TieredHistoryBackend::retain(Series& s, UA_DateTime now)
+{
+    const Tier& raw = _tiers[0];
+    if (raw.retention > 0) {
+        UA_DateTime cutoff = now - raw.retention;
+        while (!s.raw.empty() && (historyKey(*s.raw.front().constRef()) < cutoff)) {
+            s.raw.pop_front();
+            _dropped++;
+        }
+    }
+    while (raw.maxValues && (s.raw.size() > raw.maxValues)) {
+        s.raw.pop_front();
+        _dropped++;
+    }
+    for (size_t k = 1; k < _tiers.size(); k++) {
+        const Tier& t         = _tiers[k];
+        std::deque<Bucket>& q = s.rollups[k - 1];
+        if (t.retention > 0) {
+            UA_DateTime cutoff = now - t.retention;
+            while (!q.empty() && ((q.front().start + t.interval) <= cutoff)) {
+                q.pop_front();
+                _dropped++;
+            }
+        }
+        while (t.maxValues && (q.size() > t.maxValues)) {
+            q.pop_front();
+            _dropped++;
+        }
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::store
+    \param n
+    \param v
+    \param replace allow an existing raw value at the timestamp to be replaced
+    \param insert allow a new value
+    \return status
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::store(const NodeId& n, const UA_DataValue& v, bool replace, bool insert)
+{
+    Series& s     = *series(n, true);
+    UA_DateTime t = historyKey(v);
+    DataValue d;
+    UA_DataValue_copy(&v, d.ref());
+    if (s.raw.empty() || (t > historyKey(*s.raw.back().constRef()))) {
+        // the usual case
+        if (!insert)
+            return UA_STATUSCODE_BADNOENTRYEXISTS;
+        s.raw.push_back(std::move(d));
+        roll(s, t, v);
+    }
+    else {
+        size_t i    = lowerBound(s, 0, t);
+        bool exists = (i < s.raw.size()) && (keyOf(s, 0, i) == t);
+        if (exists && !replace)
+            return UA_STATUSCODE_BADENTRYEXISTS;
+        if (!exists && !insert)
+            return UA_STATUSCODE_BADNOENTRYEXISTS;
+        if (exists) {
+            s.raw[i] = std::move(d);
+            rebuild(s, t, t);
+        }
+        else {
+            s.raw.insert(s.raw.begin() + i, std::move(d));
+            roll(s, t, v);
+        }
+    }
+    retain(s, UA_DateTime_now());
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::applyRetention
+*/
+void Open62541::TieredHistoryBackend::applyRetention()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    UA_DateTime now = UA_DateTime_now();
+    for (auto& i : _series) {
+        retain(i.second, now);
+    }
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::read
+    \param n
+    \param start
+    \param end
+    \param maxValues
+    \param out
+    \return tier read
+*/
+size_t Open62541::TieredHistoryBackend::read(const NodeId& n,
+                                             UA_DateTime start,
+                                             UA_DateTime end,
+                                             size_t maxValues,
+                                             std::vector<DataValue>& out)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    out.clear();
+    Series* s = series(n);
+    if (!s)
+        return 0;
+    if (end < start)
+        std::swap(start, end);
+    //
+    // a tier holds the start of the span if its oldest value is at or before it or no coarser tier
+    // has a whole interval before that
+    size_t tier = _tiers.size();
+    size_t from = 0;
+    size_t to   = 0;
+    for (size_t k = 0; k < _tiers.size(); k++) {
+        size_t m = tierSize(*s, k);
+        if (!m)
+            continue;
+        UA_DateTime oldest = keyOf(*s, k, 0);
+        bool holds         = (oldest <= start);
+        for (size_t j = k + 1; !holds && (j <= _tiers.size()); j++) {
+            if (j == _tiers.size())
+                holds = true;
+            else if (tierSize(*s, j) && ((keyOf(*s, j, 0) + _tiers[j].interval) <= oldest))
+                break;
+        }
+        size_t a = lowerBound(*s, k, k ? bucketStart(start, _tiers[k].interval) : start);
+        size_t b = lowerBound(*s, k, end);
+        tier     = k;  // the coarsest with values, failing all else
+        from     = a;
+        to       = b;
+        if (holds && (!maxValues || ((b - a) <= maxValues)))
+            break;
+    }
+    if (tier == _tiers.size())
+        return 0;
+    out.resize(to - from);
+    for (size_t i = from; i < to; i++) {
+        valueOf(*s, tier, i, *out[i - from].ref());
+    }
+    return tier;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::size
+    \param n
+    \param tier
+    \return values in the tier
+*/
+size_t Open62541::TieredHistoryBackend::size(const NodeId& n, size_t tier)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s = series(n);
+    return (s && (tier < _tiers.size())) ? tierSize(*s, tier) : 0;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::nodeCount
+    \return nodes
+*/
+size_t Open62541::TieredHistoryBackend::nodeCount()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    return _series.size();
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::memoryUsed
+    Counts the fixed size of raw values, not strings or arrays they hold
+    \return bytes
+*/
+size_t Open62541::TieredHistoryBackend::memoryUsed()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = 0;
+    for (auto& i : _series) {
+        n += bytesOf(i.second);
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::bytesOf
+    \param s
+    \return bytes held by the tiers of a node
+*/
+size_t Open62541::TieredHistoryBackend::bytesOf(const Series& s)
+{
+    size_t n = sizeof(Series);
+    for (const DataValue& d : s.raw) {
+        const UA_DataValue& v = *d.constRef();
+        n += sizeof(DataValue) + ((v.hasValue && v.value.type) ? v.value.type->memSize : 0);
+    }
+    for (const std::deque<Bucket>& q : s.rollups) {
+        n += q.size() * sizeof(Bucket);
+    }
+    return n;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::memoryUsage
+    \param r
+*/
+void Open62541::TieredHistoryBackend::memoryUsage(MemoryReport& r)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    size_t n = 0;
+    for (auto& i : _series) {
+        const size_t b = bytesOf(i.second) + MemoryReport::HashNode + sizeof(UA_NodeId);
+        if (r.detail()) {
+            size_t values = i.second.raw.size();
+            for (const std::deque<Bucket>& q : i.second.rollups)
+                values += q.size();
+            r.add("history", b, values, toString(i.first));
+        }
+        n += b;
+    }
+    r.add("history", n, _series.size());
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::clearNode
+    \param n
+*/
+void Open62541::TieredHistoryBackend::clearNode(const NodeId& n)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _series.remove(*n.constRef());
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::clearAll
+*/
+void Open62541::TieredHistoryBackend::clearAll()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _series.clearAll();
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::serverSetHistoryData
+    \return status
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::serverSetHistoryData(Context& c,
+                                                                    bool /*historizing*/,
+                                                                    const UA_DataValue* value)
+{
+    if (!value)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    std::lock_guard<std::mutex> l(_mutex);
+    store(c.nodeId, *value, true, true);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::getDateTimeMatch
+    \return index in the merged history or the end index if there is no match
+*/
+size_t Open62541::TieredHistoryBackend::getDateTimeMatch(Context& c,
+                                                          const UA_DateTime timestamp,
+                                                          const MatchStrategy strategy)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s = series(c.nodeId);
+    if (!s)
+        return 0;
+    View v;
+    view(*s, v);
+    if (!v.size)
+        return 0;
+    return matchTime(v.size, timestamp, strategy, [this, s, &v](size_t index) {
+        size_t tier = 0;
+        size_t i    = 0;
+        locate(v, index, tier, i);
+        return keyOf(*s, tier, i);
+    });
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::getEnd
+    \return index after the last value
+*/
+size_t Open62541::TieredHistoryBackend::getEnd(Context& c)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s = series(c.nodeId);
+    if (!s)
+        return 0;
+    View v;
+    view(*s, v);
+    return v.size;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::lastIndex
+    \return index of the last value
+*/
+size_t Open62541::TieredHistoryBackend::lastIndex(Context& c)
+{
+    size_t n = getEnd(c);
+    return n ? n - 1 : 0;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::firstIndex
+    \return 0
+*/
+size_t Open62541::TieredHistoryBackend::firstIndex(Context& /*c*/) { return 0; }
+
+/*!
+    \brief Open62541::TieredHistoryBackend::resultSize
+    \return number of values in the range including both ends
+*/
+size_t Open62541::TieredHistoryBackend::resultSize(Context& c, size_t startIndex, size_t endIndex)
+{
+    size_t n = getEnd(c);
+    if (!n || (startIndex >= n) || (endIndex >= n))
+        return 0;
+    return (startIndex <= endIndex) ? endIndex - startIndex + 1 : startIndex - endIndex + 1;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::copyDataValues
+    The continuation point is the count of values already returned
+    \return status
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::copyDataValues(Context& c,
+                                                               size_t startIndex,
+                                                               size_t endIndex,
+                                                               UA_Boolean reverse,
+                                                               size_t valueSize,
+                                                               UA_NumericRange range,
+                                                               UA_Boolean /*releaseContinuationPoints*/,
+                                                               std::string& in,
+                                                               std::string& out,
+                                                               size_t* providedValues,
+                                                               UA_DataValue* values)
+{
+    size_t skip = 0;
+    if (!readContinuation(in, skip))
+        return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s      = series(c.nodeId);
+    size_t counter = 0;
+    View v;
+    if (s)
+        view(*s, v);
+    if (v.size && (reverse ? (startIndex >= endIndex) : (startIndex <= endIndex))) {
+        size_t total = reverse ? startIndex - endIndex + 1 : endIndex - startIndex + 1;
+        if (skip > total)
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        size_t index = reverse ? startIndex - skip : startIndex + skip;
+        size_t tier  = 0;
+        size_t i     = 0;
+        for (size_t n = skip; (n < total) && (counter < valueSize) && locate(v, index, tier, i); n++) {
+            UA_DataValue& d = values[counter];
+            valueOf(*s, tier, i, d);
+            if ((range.dimensionsSize > 0) && d.hasValue) {
+                UA_Variant r;
+                UA_Variant_init(&r);
+                d.hasValue = (UA_Variant_copyRange(&d.value, &r, range) == UA_STATUSCODE_GOOD);
+                UA_Variant_clear(&d.value);
+                d.value = r;
+            }
+            counter++;
+            if (reverse) {
+                if (index == 0)
+                    break;
+                index--;
+            }
+            else {
+                index++;
+            }
+        }
+        if ((total - skip) > counter)
+            writeContinuation(out, skip + counter);
+    }
+    if (providedValues)
+        *providedValues = counter;
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::getDataValue
+    A rollup stays valid until the next call
+    \return data value or nullptr
+*/
+const UA_DataValue* Open62541::TieredHistoryBackend::getDataValue(Context& c, size_t index)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s = series(c.nodeId);
+    if (!s)
+        return nullptr;
+    View v;
+    view(*s, v);
+    size_t tier = 0;
+    size_t i    = 0;
+    if (!locate(v, index, tier, i))
+        return nullptr;
+    if (!tier)
+        return s->raw[i].constRef();
+    _current.clear();
+    valueOf(*s, tier, i, *_current.ref());
+    return _current.constRef();
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::insertDataValue
+    \return BADENTRYEXISTS if there is already a raw value at the timestamp
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::insertDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, *value, false, true);
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::replaceDataValue
+    \return BADNOENTRYEXISTS if there is no raw value at the timestamp
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::replaceDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, *value, true, false);
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::updateDataValue
+    Insert or replace
+    \return status
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::updateDataValue(Context& c, const UA_DataValue* value)
+{
+    if (!value || !value->hasSourceTimestamp)
+        return UA_STATUSCODE_BADINVALIDTIMESTAMP;
+    std::lock_guard<std::mutex> l(_mutex);
+    return store(c.nodeId, *value, true, true);
+}
+
+/*!
+    \brief Open62541::TieredHistoryBackend::removeDataValue
+    Removes raw values from startTimestamp up to but not including endTimestamp, or at startTimestamp if
+    they are equal, and rebuilds the rollups over the range that the raw values still cover
+    \return status
+*/
+UA_StatusCode Open62541::TieredHistoryBackend::removeDataValue(Context& c,
+                                                               UA_DateTime startTimestamp,
+                                                               UA_DateTime endTimestamp)
+{
+    if (startTimestamp > endTimestamp)
+        return UA_STATUSCODE_BADTIMESTAMPNOTSUPPORTED;
+    std::lock_guard<std::mutex> l(_mutex);
+    Series* s = series(c.nodeId);
+    if (!s)
+        return UA_STATUSCODE_GOOD;
+    size_t first = lowerBound(*s, 0, startTimestamp);
+    size_t last  = (startTimestamp == endTimestamp) ? first : lowerBound(*s, 0, endTimestamp);
+    if (startTimestamp == endTimestamp) {
+        while ((last < s->raw.size()) && (keyOf(*s, 0, last) == startTimestamp))
+            last++;
+    }
+    if (last > first) {
+        s->raw.erase(s->raw.begin() + first, s->raw.begin() + last);
+        rebuild(*s, startTimestamp, (startTimestamp == endTimestamp) ? endTimestamp : endTimestamp - 1);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TieredMemoryHistorian::TieredMemoryHistorian
+    \param numberNodes
+    \param tiers
+*/
+Open62541::TieredMemoryHistorian::TieredMemoryHistorian(size_t numberNodes,
+                                                        const std::vector<TieredHistoryBackend::Tier>& tiers)
+    : _store(tiers)
+{
+    gathering() = UA_HistoryDataGathering_Default(numberNodes);
+    database()  = UA_HistoryDatabase_default(gathering());
+    backend()   = _store.database();
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/timerwheel.h>
+
+/*!
+    \brief Open62541::TimerWheel::TimerWheel
+    \param tickMs
+*/
+Open62541::TimerWheel::TimerWheel(unsigned tickMs)
+    : _tickMs(tickMs ? tickMs : 1)
+{
+}
+
+/*!
+    \brief Open62541::TimerWheel::setTick
+    \param ms
+    \return
+*/
+bool Open62541::TimerWheel::setTick(unsigned ms)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    if (!_timers.empty())
+        return false;
+    _tickMs = ms ? ms : 1;
+    _now    = 0;  // resynchronised by the next add
+    return true;
+}
+
+/*!
+    \brief Open62541::TimerWheel::insert
+    Link a node into the slot for its expiry - the level is chosen so the slot is reached, directly or by
+    cascading, no later than the expiry
+    \param n
+*/
+void Open62541::TimerWheel::insert(Node* n)
+{
+    if (n->expiry < _now)
+        n->expiry = _now;  // overdue - expires on the current slot if it is being cascaded, else the next
+    UA_UInt64 e     = n->expiry;
+    UA_UInt64 delta = e - _now;
+    const UA_UInt64 span = UA_UInt64(1) << (SlotBits * Levels);
+    if (delta >= span) {
+        e     = _now + span - 1;  // beyond the top level - reinserted when it cascades
+        delta = span - 1;
+    }
+    int level = 0;
+    while ((level < (Levels - 1)) && (delta >= (UA_UInt64(1) << (SlotBits * (level + 1)))))
+        level++;
+    _slots[level][(e >> (SlotBits * level)) & (Slots - 1)].append(n);
+}
+
+/*!
+    \brief Open62541::TimerWheel::cascade
+    Move the nodes of the current slot of a level down the hierarchy
+    \param level
+*/
+void Open62541::TimerWheel::cascade(int level)
+{
+    Node& head = _slots[level][(_now >> (SlotBits * level)) & (Slots - 1)];
+    Node l;
+    while (!head.empty()) {
+        Node* n = head.next;
+        n->unlink();
+        l.append(n);
+    }
+    while (!l.empty()) {
+        Node* n = l.next;
+        n->unlink();
+        insert(n);
+    }
+}
+
+/*!
+    \brief Open62541::TimerWheel::tick
+    Advance one tick and expire the level 0 slot
+*/
+void Open62541::TimerWheel::tick()
+{
+    _now++;
+    for (int level = 1; level < Levels; level++) {
+        if (_now & ((UA_UInt64(1) << (SlotBits * level)) - 1))
+            break;
+        cascade(level);
+    }
+    //
+    Node& head = _slots[0][_now & (Slots - 1)];
+    if (head.empty())
+        return;
+    Node expired;  // detach so handlers adding timers for this slot do not run in this pass
+    while (!head.empty()) {
+        Node* n = head.next;
+        n->unlink();
+        expired.append(n);
+    }
+    while (!expired.empty()) {
+        Node* n = expired.next;
+        n->unlink();  // cancel() may unlink later members of expired
+        if (n->group)
+            fire(static_cast<Group*>(n));
+        else
+            fire(static_cast<Timer*>(n));
+    }
+}
+
+/*!
+    \brief Open62541::TimerWheel::fire
+    \param t
+*/
+void Open62541::TimerWheel::fire(Timer* t)
+{
+    _firing++;
+    if (!t->cancelled && t->func) {
+        t->func(t->id);
+        _fired++;
+    }
+    _firing--;
+    if (t->cancelled)
+        return;
+    if (t->interval) {
+        t->unlink();  // the handler may have re-armed it with changeInterval
+        t->expiry = _now + t->interval;
+        insert(t);
+    }
+    else {
+        t->cancelled = true;  // one shot - dropped once no handler is running
+        _dead.push_back(t->id);
+    }
+}
+
+/*!
+    \brief Open62541::TimerWheel::fire
+    \param g
+*/
+void Open62541::TimerWheel::fire(Group* g)
+{
+    _batches++;
+    std::vector<Timer*> batch(g->members);  // members may leave or join while their handlers run
+    g->firing = true;
+    _firing++;
+    for (Timer* t : batch) {
+        if (!t->cancelled && t->func) {
+            t->func(t->id);
+            _fired++;
+        }
+    }
+    _firing--;
+    g->firing = false;
+    if (g->members.empty()) {
+        _groups.erase(g->interval);
+    }
+    else {
+        g->expiry = _now + g->interval;
+        insert(g);
+    }
+}
+
+/*!
+    \brief Open62541::TimerWheel::join
+    \param t
+    \param interval ticks
+    \param delay ticks to the first expiry of a new group
+*/
+void Open62541::TimerWheel::join(Timer* t, UA_UInt64 interval, UA_UInt64 delay)
+{
+    std::unique_ptr<Group>& g = _groups[interval];
+    if (!g) {
+        g.reset(new Group);
+        g->interval = interval;
+        g->expiry   = _now + delay;
+        insert(g.get());
+    }
+    t->owner    = g.get();
+    t->index    = g->members.size();
+    t->interval = interval;
+    g->members.push_back(t);
+}
+
+/*!
+    \brief Open62541::TimerWheel::leave
+    \param t
+*/
+void Open62541::TimerWheel::leave(Timer* t)
+{
+    Group* g = t->owner;
+    if (!g)
+        return;
+    Timer* last          = g->members.back();
+    g->members[t->index] = last;
+    last->index          = t->index;
+    g->members.pop_back();
+    t->owner = nullptr;
+    if (g->members.empty() && !g->firing) {
+        g->unlink();
+        _groups.erase(g->interval);
+    }
+}
+
+/*!
+    \brief Open62541::TimerWheel::purge
+    Free timers cancelled while handlers were running
+*/
+void Open62541::TimerWheel::purge()
+{
+    if (_firing)
+        return;
+    for (UA_UInt64 id : _dead) {
+        _timers.erase(id);
+    }
+    _dead.clear();
+}
+
+/*!
+    \brief Open62541::TimerWheel::add
+    \param delayMs
+    \param intervalMs
+    \param func
+    \param grouped
+    \return
+*/
+UA_UInt64 Open62541::TimerWheel::add(unsigned delayMs, unsigned intervalMs, Handler func, bool grouped)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    if (_timers.empty() && _groups.empty())
+        _now = tickOf(UA_DateTime_nowMonotonic());  // idle wheel - nothing to expire on the way
+    std::unique_ptr<Timer> t(new Timer);
+    t->id   = (_nextId++) | IdFlag;
+    t->func = std::move(func);
+    if (intervalMs && grouped) {
+        join(t.get(), ticks(intervalMs), ticks(delayMs));
+    }
+    else {
+        t->interval = intervalMs ? ticks(intervalMs) : 0;
+        t->expiry   = _now + ticks(delayMs);
+        insert(t.get());
+    }
+    const UA_UInt64 id = t->id;
+    _timers[id]        = std::move(t);
+    return id;
+}
+
+/*!
+    \brief Open62541::TimerWheel::cancel
+    \param id
+    \return
+*/
+bool Open62541::TimerWheel::cancel(UA_UInt64 id)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);  // waits for a running handler
+    auto i = _timers.find(id);
+    if ((i == _timers.end()) || i->second->cancelled)
+        return false;
+    Timer* t = i->second.get();
+    t->unlink();
+    leave(t);
+    if (_firing) {
+        t->cancelled = true;  // its handler may be the one running
+        _dead.push_back(id);
+    }
+    else {
+        _timers.erase(i);
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TimerWheel::changeInterval
+    \param id
+    \param intervalMs
+    \return
+*/
+bool Open62541::TimerWheel::changeInterval(UA_UInt64 id, unsigned intervalMs)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    auto i = _timers.find(id);
+    if ((i == _timers.end()) || i->second->cancelled || !i->second->interval || !intervalMs)
+        return false;
+    Timer* t = i->second.get();
+    const UA_UInt64 n = ticks(intervalMs);
+    if (t->owner) {
+        if (t->owner->interval != n) {
+            leave(t);
+            join(t, n, n);
+        }
+    }
+    else {
+        t->interval = n;
+        t->unlink();
+        t->expiry = _now + n;
+        insert(t);
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TimerWheel::advance
+    \param now
+    \return
+*/
+size_t Open62541::TimerWheel::advance(UA_DateTime now)
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    const size_t before  = _fired;
+    const UA_UInt64 last = tickOf(now);
+    if (_timers.empty() && _groups.empty()) {
+        _now = last;
+        return 0;
+    }
+    while (_now < last) {
+        tick();
+    }
+    purge();
+    return _fired - before;
+}
+
+/*!
+    \brief Open62541::TimerWheel::clear
+*/
+void Open62541::TimerWheel::clear()
+{
+    std::lock_guard<std::recursive_mutex> l(_mutex);
+    for (auto& t : _timers) {
+        t.second->unlink();  // from a slot or from the slot being expired
+        t.second->owner = nullptr;
+    }
+    for (auto& g : _groups) {
+        g.second->unlink();
+        g.second->members.clear();
+    }
+    if (_firing) {
+        // running handlers still refer to their timers and group - drop them once the handlers return
+        for (auto& t : _timers) {
+            if (!t.second->cancelled) {
+                t.second->cancelled = true;
+                _dead.push_back(t.first);
+            }
+        }
+        for (auto i = _groups.begin(); i != _groups.end();) {
+            if (i->second->firing)
+                i++;
+            else
+                i = _groups.erase(i);
+        }
+        return;
+    }
+    _timers.clear();
+    _groups.clear();
+    _dead.clear();
+}
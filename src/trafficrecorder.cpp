@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/trafficrecorder.h>
+#include <open62541cpp/open62541client.h>
+#include <open62541cpp/open62541server.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+namespace {
+
+/*!
+    \brief requestType
+    \param k
+    \return type of the request body of a kind - nullptr for data changes
+*/
+const UA_DataType* requestType(Open62541::TrafficRecorder::Kind k)
+{
+    switch (k) {
+        case Open62541::TrafficRecorder::Read:
+            return &UA_TYPES[UA_TYPES_READREQUEST];
+        case Open62541::TrafficRecorder::Write:
+            return &UA_TYPES[UA_TYPES_WRITEREQUEST];
+        case Open62541::TrafficRecorder::Call:
+            return &UA_TYPES[UA_TYPES_CALLREQUEST];
+        case Open62541::TrafficRecorder::Browse:
+            return &UA_TYPES[UA_TYPES_BROWSEREQUEST];
+        case Open62541::TrafficRecorder::Translate:
+            return &UA_TYPES[UA_TYPES_TRANSLATEBROWSEPATHSTONODEIDSREQUEST];
+        default:
+            return nullptr;
+    }
+}
+
+inline UA_UInt64 nanoseconds(Open62541::TrafficRecorder::Clock::duration d)
+{
+    return UA_UInt64(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+/*!
+    \brief releaseContinuationPoints
+    A replayed browse must not leave continuation points held by the server
+    \param client
+    \param r
+*/
+void releaseContinuationPoints(UA_Client* client, const UA_BrowseResponse& r)
+{
+    std::vector<UA_ByteString> points;
+    for (size_t i = 0; i < r.resultsSize; i++) {
+        if (r.results[i].continuationPoint.length > 0)
+            points.push_back(r.results[i].continuationPoint);  // shallow
+    }
+    if (!points.empty()) {
+        UA_BrowseNextRequest next;
+        UA_BrowseNextRequest_init(&next);
+        next.releaseContinuationPoints = UA_TRUE;
+        next.continuationPoints        = points.data();
+        next.continuationPointsSize    = points.size();
+        UA_BrowseNextResponse response = UA_Client_Service_browseNext(client, next);
+        UA_BrowseNextResponse_clear(&response);
+    }
+}
+}  // namespace
+
+/*!
+    \brief Open62541::TrafficRecorder::open
+    \param path
+    \return true on success
+*/
+bool Open62541::TrafficRecorder::open(const std::string& path)
+{
+    close();
+    std::lock_guard<std::mutex> l(_mutex);
+    _file = std::fopen(path.c_str(), "wb");
+    if (!_file) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        return false;
+    }
+    std::setvbuf(_file, nullptr, _IOFBF, 1 << 16);  // records are small - write them in blocks
+    Header h;
+    h.magic   = Magic;
+    h.version = Version;
+    h.started = UA_DateTime_now();
+    _start    = Clock::now();
+    _records  = 0;
+    _bytes    = sizeof(h);
+    if (std::fwrite(&h, sizeof(h), 1, _file) != 1) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return false;
+    }
+    _lastError = UA_STATUSCODE_GOOD;
+    return true;
+}
+
+/*!
+    \brief Open62541::TrafficRecorder::close
+*/
+void Open62541::TrafficRecorder::close()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+}
+
+/*!
+    \brief Open62541::TrafficRecorder::write
+    \param k
+    \param at
+    \param latencyNs
+    \param status
+    \param a first part of the body
+    \param ta
+    \param b second part - may be null
+    \param tb
+*/
+void Open62541::TrafficRecorder::write(Kind k,
+                                       Clock::time_point at,
+                                       UA_UInt64 latencyNs,
+                                       UA_StatusCode status,
+                                       const void* a,
+                                       const UA_DataType* ta,
+                                       const void* b,
+                                       const UA_DataType* tb)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!_file)
+        return;
+    const size_t la = UA_calcSizeBinary(a, ta);
+    const size_t lb = b ? UA_calcSizeBinary(b, tb) : 0;
+    if ((la + lb) > UINT32_MAX) {
+        _lastError = UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED;
+        return;
+    }
+    _buffer.resize(sizeof(Record) + la + lb);
+    // encode straight into the buffer - it is preallocated so nothing is allocated
+    UA_ByteString s;
+    s.length         = la;
+    s.data           = _buffer.data() + sizeof(Record);
+    UA_StatusCode rc = UA_encodeBinary(a, ta, &s);
+    if ((rc == UA_STATUSCODE_GOOD) && b) {
+        s.length = lb;
+        s.data   = _buffer.data() + sizeof(Record) + la;
+        rc       = UA_encodeBinary(b, tb, &s);
+    }
+    if (rc != UA_STATUSCODE_GOOD) {
+        _lastError = rc;
+        return;
+    }
+    Record r;
+    memset(&r, 0, sizeof(r));
+    r.length    = UA_UInt32(la + lb);
+    r.kind      = UA_Byte(k);
+    r.status    = status;
+    r.timeNs    = (at > _start) ? nanoseconds(at - _start) : 0;
+    r.latencyNs = latencyNs;
+    memcpy(_buffer.data(), &r, sizeof(r));
+    if (std::fwrite(_buffer.data(), _buffer.size(), 1, _file) != 1) {
+        _lastError = UA_STATUSCODE_BADINTERNALERROR;
+        return;
+    }
+    _records++;
+    _bytes += _buffer.size();
+}
+
+/*!
+    \brief Open62541::TrafficRecorder::request
+    \param k
+    \param request
+    \param type
+    \param start
+    \param status
+*/
+void Open62541::TrafficRecorder::request(Kind k,
+                                         const void* request,
+                                         const UA_DataType* type,
+                                         Clock::time_point start,
+                                         UA_StatusCode status)
+{
+    write(k, start, nanoseconds(Clock::now() - start), status, request, type);
+}
+
+/*!
+    \brief Open62541::TrafficRecorder::dataChange
+    \param node
+    \param value
+*/
+void Open62541::TrafficRecorder::dataChange(const UA_NodeId& node, const UA_DataValue& value)
+{
+    write(DataChange,
+          Clock::now(),
+          0,
+          value.hasStatus ? value.status : UA_STATUSCODE_GOOD,
+          &node,
+          &UA_TYPES[UA_TYPES_NODEID],
+          &value,
+          &UA_TYPES[UA_TYPES_DATAVALUE]);
+}
+
+/*!
+    \brief Open62541::TrafficRecorder::name
+    \param k
+    \return
+*/
+const char* Open62541::TrafficRecorder::name(Kind k)
+{
+    switch (k) {
+        case Read:
+            return "Read";
+        case Write:
+            return "Write";
+        case Call:
+            return "Call";
+        case Browse:
+            return "Browse";
+        case Translate:
+            return "Translate";
+        case DataChange:
+            return "DataChange";
+        default:
+            return "Unknown";
+    }
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::load
+    \param path
+    \return true on success
+*/
+bool Open62541::TrafficReplayer::load(const std::string& path)
+{
+    _entries.clear();
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        _lastError = UA_STATUSCODE_BADNOTFOUND;
+        return false;
+    }
+    _lastError = UA_STATUSCODE_GOOD;
+    TrafficRecorder::Header h;
+    if ((std::fread(&h, sizeof(h), 1, f) != 1) || (h.magic != TrafficRecorder::Magic) ||
+        (h.version != TrafficRecorder::Version)) {
+        _lastError = UA_STATUSCODE_BADDECODINGERROR;
+    }
+    TrafficRecorder::Record r;
+    while ((_lastError == UA_STATUSCODE_GOOD) && (std::fread(&r, sizeof(r), 1, f) == 1)) {
+        if ((r.kind < TrafficRecorder::Read) || (r.kind >= TrafficRecorder::KindCount)) {
+            _lastError = UA_STATUSCODE_BADDECODINGERROR;
+            break;
+        }
+        Entry e;
+        e.kind      = TrafficRecorder::Kind(r.kind);
+        e.status    = r.status;
+        e.timeNs    = r.timeNs;
+        e.latencyNs = r.latencyNs;
+        e.body.resize(r.length);
+        if (r.length && (std::fread(e.body.data(), r.length, 1, f) != 1)) {
+            _lastError = UA_STATUSCODE_BADDECODINGERROR;  // truncated - the recorder did not close the file
+            break;
+        }
+        _entries.push_back(std::move(e));
+    }
+    std::fclose(f);
+    return _lastError == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::wait
+    \param start of the replay
+    \param e next entry
+*/
+void Open62541::TrafficReplayer::wait(TrafficRecorder::Clock::time_point start, const Entry& e) const
+{
+    if (_speed > 0.0) {
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(UA_UInt64(double(e.timeNs) / _speed)));
+    }
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::add
+    \param e
+    \param ns replay latency
+    \param status replay result
+*/
+void Open62541::TrafficReplayer::add(const Entry& e, UA_UInt64 ns, UA_StatusCode status)
+{
+    Stats& s = _stats[e.kind];
+    s.count++;
+    if (status != UA_STATUSCODE_GOOD)
+        s.failed++;
+    s.recordedNs += e.latencyNs;
+    s.replayedNs += ns;
+    s.maxNs = std::max(s.maxNs, ns);
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::send
+    \param c
+    \param e
+    \param ns set to the service latency
+    \return service result
+*/
+UA_StatusCode Open62541::TrafficReplayer::send(Client& c, const Entry& e, UA_UInt64& ns)
+{
+    ns                      = 0;
+    const UA_DataType* type = requestType(e.kind);
+    if (!type || !c.client())
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    UA_ByteString b;
+    b.length          = e.body.size();
+    b.data            = const_cast<UA_Byte*>(e.body.data());  // only read
+    size_t offset     = 0;
+    void* request     = UA_new(type);
+    UA_StatusCode ret = UA_decodeBinary(&b, &offset, request, type, nullptr);
+    if (ret == UA_STATUSCODE_GOOD) {
+        WriteLock l(c.mutex());
+        const TrafficRecorder::Clock::time_point start = TrafficRecorder::Clock::now();
+        switch (e.kind) {
+            case TrafficRecorder::Read: {
+                UA_ReadResponse r = UA_Client_Service_read(c.client(), *static_cast<UA_ReadRequest*>(request));
+                ns                = nanoseconds(TrafficRecorder::Clock::now() - start);
+                ret               = r.responseHeader.serviceResult;
+                UA_ReadResponse_clear(&r);
+            } break;
+            case TrafficRecorder::Write: {
+                UA_WriteResponse r = UA_Client_Service_write(c.client(), *static_cast<UA_WriteRequest*>(request));
+                ns                 = nanoseconds(TrafficRecorder::Clock::now() - start);
+                ret                = r.responseHeader.serviceResult;
+                UA_WriteResponse_clear(&r);
+            } break;
+            case TrafficRecorder::Call: {
+                UA_CallResponse r = UA_Client_Service_call(c.client(), *static_cast<UA_CallRequest*>(request));
+                ns                = nanoseconds(TrafficRecorder::Clock::now() - start);
+                ret               = r.responseHeader.serviceResult;
+                UA_CallResponse_clear(&r);
+            } break;
+            case TrafficRecorder::Browse: {
+                UA_BrowseResponse r = UA_Client_Service_browse(c.client(), *static_cast<UA_BrowseRequest*>(request));
+                ns                  = nanoseconds(TrafficRecorder::Clock::now() - start);
+                ret                 = r.responseHeader.serviceResult;
+                releaseContinuationPoints(c.client(), r);
+                UA_BrowseResponse_clear(&r);
+            } break;
+            case TrafficRecorder::Translate: {
+                UA_TranslateBrowsePathsToNodeIdsResponse r = UA_Client_Service_translateBrowsePathsToNodeIds(
+                    c.client(), *static_cast<UA_TranslateBrowsePathsToNodeIdsRequest*>(request));
+                ns  = nanoseconds(TrafficRecorder::Clock::now() - start);
+                ret = r.responseHeader.serviceResult;
+                UA_TranslateBrowsePathsToNodeIdsResponse_clear(&r);
+            } break;
+            default:
+                break;
+        }
+    }
+    UA_delete(request, type);
+    return ret;
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::replay
+    \param client
+    \return true if every request got the service result recorded for it
+*/
+bool Open62541::TrafficReplayer::replay(Client& client)
+{
+    for (Stats& s : _stats)
+        s = Stats();
+    _lastError = UA_STATUSCODE_GOOD;
+    const TrafficRecorder::Clock::time_point start = TrafficRecorder::Clock::now();
+    for (const Entry& e : _entries) {
+        if (e.kind == TrafficRecorder::DataChange)
+            continue;
+        wait(start, e);
+        UA_UInt64 ns    = 0;
+        UA_StatusCode s = send(client, e, ns);
+        add(e, ns, s);
+        if ((s != e.status) && (_lastError == UA_STATUSCODE_GOOD))
+            _lastError = (s != UA_STATUSCODE_GOOD) ? s : UA_STATUSCODE_BADUNEXPECTEDERROR;
+    }
+    _elapsedNs = nanoseconds(TrafficRecorder::Clock::now() - start);
+    return _lastError == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::replay
+    \param server
+    \return true if every write succeeded
+*/
+bool Open62541::TrafficReplayer::replay(Server& server)
+{
+    for (Stats& s : _stats)
+        s = Stats();
+    _lastError = UA_STATUSCODE_GOOD;
+    std::vector<UA_NodeId> ids;
+    std::vector<UA_Variant> values;
+    std::vector<UA_StatusCode> results;
+    const TrafficRecorder::Clock::time_point start = TrafficRecorder::Clock::now();
+    for (const Entry& e : _entries) {
+        if ((e.kind != TrafficRecorder::Write) && (e.kind != TrafficRecorder::DataChange))
+            continue;
+        UA_ByteString b;
+        b.length      = e.body.size();
+        b.data        = const_cast<UA_Byte*>(e.body.data());  // only read
+        size_t offset = 0;
+        UA_StatusCode s;
+        UA_WriteRequest w;
+        UA_NodeId node;
+        UA_DataValue v;
+        UA_WriteRequest_init(&w);
+        UA_NodeId_init(&node);
+        UA_DataValue_init(&v);
+        ids.clear();
+        values.clear();
+        if (e.kind == TrafficRecorder::Write) {
+            s = UA_decodeBinary(&b, &offset, &w, &UA_TYPES[UA_TYPES_WRITEREQUEST], nullptr);
+            for (size_t i = 0; (s == UA_STATUSCODE_GOOD) && (i < w.nodesToWriteSize); i++) {
+                const UA_WriteValue& wv = w.nodesToWrite[i];
+                if ((wv.attributeId == UA_ATTRIBUTEID_VALUE) && wv.value.hasValue) {
+                    ids.push_back(wv.nodeId);  // shallow
+                    values.push_back(wv.value.value);
+                }
+            }
+        }
+        else {
+            s = UA_decodeBinary(&b, &offset, &node, &UA_TYPES[UA_TYPES_NODEID], nullptr);
+            if (s == UA_STATUSCODE_GOOD)
+                s = UA_decodeBinary(&b, &offset, &v, &UA_TYPES[UA_TYPES_DATAVALUE], nullptr);
+            if ((s == UA_STATUSCODE_GOOD) && v.hasValue) {
+                ids.push_back(node);
+                values.push_back(v.value);
+            }
+        }
+        UA_UInt64 ns = 0;
+        if ((s == UA_STATUSCODE_GOOD) && !ids.empty()) {
+            wait(start, e);
+            results.resize(ids.size());
+            const TrafficRecorder::Clock::time_point t = TrafficRecorder::Clock::now();
+            server.writeValues(ids.size(), ids.data(), values.data(), results.data());
+            ns = nanoseconds(TrafficRecorder::Clock::now() - t);
+            s  = server.lastError();
+        }
+        add(e, ns, s);
+        if ((s != UA_STATUSCODE_GOOD) && (_lastError == UA_STATUSCODE_GOOD))
+            _lastError = s;
+        UA_WriteRequest_clear(&w);
+        UA_NodeId_clear(&node);
+        UA_DataValue_clear(&v);
+    }
+    _elapsedNs = nanoseconds(TrafficRecorder::Clock::now() - start);
+    return _lastError == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TrafficReplayer::report
+    \param os
+*/
+void Open62541::TrafficReplayer::report(std::ostream& os) const
+{
+    os << "Replay of " << _entries.size() << " records in " << double(_elapsedNs) / 1.0e6 << " ms at speed "
+       << _speed << std::endl;
+    for (int k = TrafficRecorder::Read; k < TrafficRecorder::KindCount; k++) {
+        const Stats& s = _stats[k];
+        if (s.count == 0)
+            continue;
+        os << "  " << std::left << std::setw(12) << TrafficRecorder::name(TrafficRecorder::Kind(k)) << std::right
+           << " count " << std::setw(8) << s.count << " failed " << std::setw(6) << s.failed << std::fixed
+           << std::setprecision(1) << " recorded us " << std::setw(10) << s.recordedMeanUs() << " replayed us "
+           << std::setw(10) << s.replayedMeanUs() << " delta us " << std::setw(10) << s.deltaUs() << " max us "
+           << std::setw(10) << double(s.maxNs) / 1000.0 << std::defaultfloat << std::endl;
+    }
+}
@@ -0,0 +1,465 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/treesnapshot.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+const UA_UInt64 FnvBasis = 0xcbf29ce484222325ULL;
+const UA_UInt64 FnvPrime = 0x100000001b3ULL;
+
+inline UA_UInt64 fnv(UA_UInt64 h, const char* p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        h ^= UA_Byte(p[i]);
+        h *= FnvPrime;
+    }
+    return h;
+}
+
+inline UA_UInt64 fnvSeparator(UA_UInt64 h)
+{
+    h ^= 0x2f;  // '/' - so that a|bc and ab|c differ
+    return h * FnvPrime;
+}
+
+inline size_t padded(size_t n) { return (n + 7) & ~size_t(7); }
+
+inline bool lessHash(const Open62541::TreeSnapshot::IndexEntry& a, const Open62541::TreeSnapshot::IndexEntry& b)
+{
+    return (a.hash < b.hash) || ((a.hash == b.hash) && (a.offset < b.offset));
+}
+
+/*!
+    \brief typeOf
+    \param id numeric ns0 type id
+    \return the built in type or nullptr
+*/
+const UA_DataType* typeOf(UA_UInt32 id)
+{
+    for (size_t i = 0; i < UA_TYPES_COUNT; i++) {
+        if ((UA_TYPES[i].typeId.namespaceIndex == 0) &&
+            (UA_TYPES[i].typeId.identifierType == UA_NODEIDTYPE_NUMERIC) &&
+            (UA_TYPES[i].typeId.identifier.numeric == id))
+            return &UA_TYPES[i];
+    }
+    return nullptr;
+}
+}  // namespace
+
+/*!
+    \brief Open62541::TreeSnapshot::pathHash
+    \param path
+    \return
+*/
+UA_UInt64 Open62541::TreeSnapshot::pathHash(const UAPath& path)
+{
+    UA_UInt64 h = FnvBasis;
+    for (const std::string& s : path) {
+        h = fnvSeparator(fnv(h, s.data(), s.size()));
+    }
+    return h;
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::pathHash
+    \param p encoded path
+    \param n its length
+    \param depth segments in it
+    \return the same hash as pathHash(const UAPath&)
+*/
+UA_UInt64 Open62541::TreeSnapshot::pathHash(const char* p, size_t n, size_t depth)
+{
+    UA_UInt64 h = FnvBasis;
+    size_t o    = 0;
+    for (size_t i = 0; (i < depth) && (o + sizeof(UA_UInt16) <= n); i++) {
+        UA_UInt16 l;
+        memcpy(&l, p + o, sizeof(l));
+        o += sizeof(l);
+        if (o + l > n)
+            break;
+        h = fnvSeparator(fnv(h, p + o, l));
+        o += l;
+    }
+    return h;
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::clear
+*/
+void Open62541::TreeSnapshot::clear()
+{
+    _image.clear();
+    _index.clear();
+    _ok = true;
+    _image.resize(sizeof(Header));
+    memset(_image.data(), 0, sizeof(Header));
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::beginRecord
+    Append a record - its subtree length is set by endRecord once its descendants follow
+    \param path
+    \param value
+    \return offset of the record
+*/
+size_t Open62541::TreeSnapshot::beginRecord(const UAPath& path, const void* value)
+{
+    size_t offset     = _image.size();
+    size_t pathLength = 0;
+    for (const std::string& s : path) {
+        if (s.size() > 0xFFFF)
+            _ok = false;
+        pathLength += sizeof(UA_UInt16) + s.size();
+    }
+    size_t valueLength = (value && _type) ? UA_calcSizeBinary(value, _type) : 0;
+    size_t length      = padded(sizeof(Record) + pathLength + valueLength);
+    if ((length > UINT32_MAX) || (path.size() > 0xFFFF)) {
+        _ok = false;
+        return offset;
+    }
+    _image.resize(offset + length, 0);
+    //
+    UA_Byte* p = _image.data() + offset + sizeof(Record);
+    for (const std::string& s : path) {
+        UA_UInt16 l = UA_UInt16(std::min<size_t>(s.size(), 0xFFFF));
+        memcpy(p, &l, sizeof(l));
+        memcpy(p + sizeof(l), s.data(), l);
+        p += sizeof(l) + l;
+    }
+    if (valueLength) {
+        // encode straight into the image - the buffer is preallocated so nothing is allocated
+        UA_ByteString b;
+        b.length = valueLength;
+        b.data   = p;
+        if (UA_encodeBinary(value, _type, &b) != UA_STATUSCODE_GOOD)
+            _ok = false;
+    }
+    //
+    Record r;
+    r.length      = UA_UInt32(length);
+    r.valueLength = UA_UInt32(valueLength);
+    r.subtree     = length;
+    r.depth       = UA_UInt16(path.size());
+    r.reserved    = 0;
+    r.pathLength  = UA_UInt32(pathLength);
+    memcpy(_image.data() + offset, &r, sizeof(r));
+    //
+    IndexEntry e;
+    e.hash   = pathHash(path);
+    e.offset = offset;
+    _index.push_back(e);
+    return offset;
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::endRecord
+    \param offset of the record begun with beginRecord
+*/
+void Open62541::TreeSnapshot::endRecord(size_t offset)
+{
+    if (offset + sizeof(Record) <= _image.size()) {
+        UA_UInt64 s = _image.size() - offset;
+        memcpy(_image.data() + offset + offsetof(Record, subtree), &s, sizeof(s));
+    }
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::finish
+    Append the index and fill in the header
+    \return false if a record could not be written
+*/
+bool Open62541::TreeSnapshot::finish()
+{
+    std::sort(_index.begin(), _index.end(), lessHash);
+    Header h;
+    h.magic       = Magic;
+    h.version     = Version;
+    h.count       = _index.size();
+    h.indexOffset = _image.size();
+    h.typeId =
+        (_type && (_type->typeId.identifierType == UA_NODEIDTYPE_NUMERIC)) ? _type->typeId.identifier.numeric : 0;
+    h.reserved    = 0;
+    memcpy(_image.data(), &h, sizeof(h));
+    size_t n = _index.size() * sizeof(IndexEntry);
+    _image.resize(_image.size() + n);
+    if (n)
+        memcpy(_image.data() + h.indexOffset, _index.data(), n);
+    return _ok;
+}
+
+/*!
+    \brief Open62541::TreeSnapshot::write
+    The image is written to a temporary file that then replaces file, so a reader never maps a part
+    written snapshot
+    \param file
+    \return false if the image could not be written
+*/
+bool Open62541::TreeSnapshot::write(const std::string& file) const
+{
+    if (_image.size() < sizeof(Header))
+        return false;
+    std::string t = file + ".tmp";
+    {
+        std::ofstream f(t, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(_image.data()), std::streamsize(_image.size()));
+        if (!f) {
+            remove(t.c_str());
+            return false;
+        }
+    }
+    return rename(t.c_str(), file.c_str()) == 0;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::open
+    \param file
+    \return false if the file is not a valid snapshot
+*/
+bool Open62541::TreeSnapshotView::open(const std::string& file)
+{
+    close();
+    try {
+        _file   = boost::interprocess::file_mapping(file.c_str(), boost::interprocess::read_only);
+        _region = boost::interprocess::mapped_region(_file, boost::interprocess::read_only);
+    }
+    catch (...) {
+        close();
+        return false;
+    }
+    if (!open(static_cast<const UA_Byte*>(_region.get_address()), _region.get_size())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::open
+    \param data
+    \param size
+    \return false if it is not a valid snapshot
+*/
+bool Open62541::TreeSnapshotView::open(const UA_Byte* data, size_t size)
+{
+    _header = nullptr;
+    _index  = nullptr;
+    _type   = nullptr;
+    if (!data || (size < sizeof(TreeSnapshot::Header)) || (reinterpret_cast<uintptr_t>(data) & 7))
+        return false;
+    const TreeSnapshot::Header* h = reinterpret_cast<const TreeSnapshot::Header*>(data);
+    if ((h->magic != TreeSnapshot::Magic) || (h->version != TreeSnapshot::Version) || (h->indexOffset > size) ||
+        (h->indexOffset & 7) || (h->count == 0) ||
+        (h->count != (size - h->indexOffset) / sizeof(TreeSnapshot::IndexEntry)))
+        return false;
+    _data   = data;
+    _size   = size;
+    _index  = reinterpret_cast<const TreeSnapshot::IndexEntry*>(data + h->indexOffset);
+    _header = h;
+    _type   = typeOf(h->typeId);
+    // the root record must be first and span every record
+    const TreeSnapshot::Record* r = first();
+    if (!r || r->depth || (sizeof(TreeSnapshot::Header) + r->subtree != h->indexOffset)) {
+        _header = nullptr;
+        _index  = nullptr;
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::close
+*/
+void Open62541::TreeSnapshotView::close()
+{
+    _header = nullptr;
+    _index  = nullptr;
+    _type   = nullptr;
+    _data   = nullptr;
+    _size   = 0;
+    _region = boost::interprocess::mapped_region();
+    _file   = boost::interprocess::file_mapping();
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::valid
+    \param offset
+    \return true if a whole record lies at offset
+*/
+bool Open62541::TreeSnapshotView::valid(UA_UInt64 offset) const
+{
+    if (!_header || (offset < sizeof(TreeSnapshot::Header)) || (offset & 7) ||
+        (offset + sizeof(TreeSnapshot::Record) > _header->indexOffset))
+        return false;
+    const TreeSnapshot::Record* r = reinterpret_cast<const TreeSnapshot::Record*>(_data + offset);
+    return (r->length >= sizeof(TreeSnapshot::Record)) && !(r->length & 7) &&
+           (offset + r->length <= _header->indexOffset) &&
+           (UA_UInt64(r->pathLength) + r->valueLength <= r->length - sizeof(TreeSnapshot::Record)) &&
+           (r->subtree >= r->length) && (r->subtree <= _header->indexOffset - offset);
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::samePath
+    \param r
+    \param path
+    \return true if the record is at path
+*/
+bool Open62541::TreeSnapshotView::samePath(const TreeSnapshot::Record* r, const UAPath& path) const
+{
+    if (r->depth != path.size())
+        return false;
+    const char* p = reinterpret_cast<const char*>(r + 1);
+    size_t o      = 0;
+    for (const std::string& s : path) {
+        UA_UInt16 l;
+        if (o + sizeof(l) > r->pathLength)
+            return false;
+        memcpy(&l, p + o, sizeof(l));
+        o += sizeof(l);
+        if ((l != s.size()) || (o + l > r->pathLength) || memcmp(p + o, s.data(), l))
+            return false;
+        o += l;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::find
+    \param path
+    \return the record or nullptr
+*/
+const Open62541::TreeSnapshot::Record* Open62541::TreeSnapshotView::find(const UAPath& path) const
+{
+    if (!_header)
+        return nullptr;
+    TreeSnapshot::IndexEntry k;
+    k.hash                              = TreeSnapshot::pathHash(path);
+    k.offset                            = 0;
+    const TreeSnapshot::IndexEntry* end = _index + _header->count;
+    const TreeSnapshot::IndexEntry* i   = std::lower_bound(_index, end, k, lessHash);
+    for (; (i != end) && (i->hash == k.hash); i++) {
+        if (valid(i->offset)) {
+            const TreeSnapshot::Record* r = reinterpret_cast<const TreeSnapshot::Record*>(_data + i->offset);
+            if (samePath(r, path))
+                return r;
+        }
+    }
+    return nullptr;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::decode
+    \param r
+    \param v
+    \return true on success
+*/
+bool Open62541::TreeSnapshotView::decode(const TreeSnapshot::Record* r, void* v) const
+{
+    if (!r || !v || !_type)
+        return false;
+    if (!r->valueLength)
+        return true;  // null value
+    UA_ByteString b;
+    b.length = r->valueLength;
+    b.data   = const_cast<UA_Byte*>(reinterpret_cast<const UA_Byte*>(r + 1) + r->pathLength);
+    size_t o = 0;
+    return UA_decodeBinary(&b, &o, v, _type, nullptr) == UA_STATUSCODE_GOOD;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::path
+    \param r
+    \param p
+*/
+void Open62541::TreeSnapshotView::path(const TreeSnapshot::Record* r, UAPath& p) const
+{
+    p.clear();
+    if (!r)
+        return;
+    const char* s = reinterpret_cast<const char*>(r + 1);
+    size_t o      = 0;
+    for (size_t i = 0; (i < r->depth) && (o + sizeof(UA_UInt16) <= r->pathLength); i++) {
+        UA_UInt16 l;
+        memcpy(&l, s + o, sizeof(l));
+        o += sizeof(l);
+        if (o + l > r->pathLength)
+            break;
+        p.push_back(std::string(s + o, l));
+        o += l;
+    }
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::first
+    \return
+*/
+const Open62541::TreeSnapshot::Record* Open62541::TreeSnapshotView::first() const
+{
+    return valid(sizeof(TreeSnapshot::Header)) ? reinterpret_cast<const TreeSnapshot::Record*>(
+                                                     _data + sizeof(TreeSnapshot::Header))
+                                               : nullptr;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::next
+    \param r
+    \return
+*/
+const Open62541::TreeSnapshot::Record* Open62541::TreeSnapshotView::next(const TreeSnapshot::Record* r) const
+{
+    if (!r)
+        return nullptr;
+    UA_UInt64 o = UA_UInt64(reinterpret_cast<const UA_Byte*>(r) - _data) + r->length;
+    return valid(o) ? reinterpret_cast<const TreeSnapshot::Record*>(_data + o) : nullptr;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::nextSibling
+    \param r
+    \return
+*/
+const Open62541::TreeSnapshot::Record* Open62541::TreeSnapshotView::nextSibling(const TreeSnapshot::Record* r) const
+{
+    if (!r)
+        return nullptr;
+    UA_UInt64 o = UA_UInt64(reinterpret_cast<const UA_Byte*>(r) - _data) + r->subtree;
+    return valid(o) ? reinterpret_cast<const TreeSnapshot::Record*>(_data + o) : nullptr;
+}
+
+/*!
+    \brief Open62541::TreeSnapshotView::children
+    Walks the node's children by skipping their subtrees
+    \param path
+    \param names
+    \return false if there is no such node
+*/
+bool Open62541::TreeSnapshotView::children(const UAPath& path, std::vector<std::string>& names) const
+{
+    names.clear();
+    const TreeSnapshot::Record* r = find(path);
+    if (!r)
+        return false;
+    const UA_Byte* end = reinterpret_cast<const UA_Byte*>(r) + r->subtree;
+    UAPath p;
+    for (const TreeSnapshot::Record* c = next(r); c && (reinterpret_cast<const UA_Byte*>(c) < end);
+         c = nextSibling(c)) {
+        if (c->depth != r->depth + 1)
+            break;  // damaged
+        this->path(c, p);
+        if (!p.empty())
+            names.push_back(p.back());
+    }
+    return true;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/workerpool.h>
+
+/*!
+    \brief Open62541::WorkerPool::WorkerPool
+*/
+Open62541::WorkerPool::WorkerPool()
+{
+    setLane(Control, 8);
+    setLane(Interactive, 4);
+    setLane(Bulk, 1);
+}
+
+/*!
+    \brief Open62541::WorkerPool::setLane
+    \param lane
+    \param weight
+    \param maxThreads
+*/
+void Open62541::WorkerPool::setLane(Lane lane, unsigned weight, size_t maxThreads)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        LaneState& s = _lanes[lane];
+        s.weight     = weight ? weight : 1;
+        s.credit     = s.weight;
+        s.maxThreads = maxThreads;
+    }
+    _cond.notify_all();
+}
+
+/*!
+    \brief Open62541::WorkerPool::start
+    \param n
+    \return true on success
+*/
+bool Open62541::WorkerPool::start(size_t n)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (_running || (n == 0))
+            return false;
+        _running = true;
+    }
+    try {
+        for (size_t i = 0; i < n; i++) {
+            _threads.emplace_back([this, i] {
+                _threadConfig.apply(int(i));
+                worker();
+            });
+        }
+    }
+    catch (...) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \brief Open62541::WorkerPool::stop
+*/
+void Open62541::WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        _running = false;
+    }
+    _cond.notify_all();
+    for (auto& t : _threads) {
+        if (t.joinable())
+            t.join();
+    }
+    _threads.clear();
+}
+
+/*!
+    \brief Open62541::WorkerPool::post
+    \param job
+    \return true if queued
+*/
+bool Open62541::WorkerPool::post(Job job, Lane lane)
+{
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if (!_running)
+            return false;
+        _lanes[lane].jobs.push_back(std::move(job));
+    }
+    _cond.notify_one();
+    return true;
+}
+
+/*!
+    \brief Open62541::WorkerPool::next
+    Weighted round - the highest runnable lane with credit, refilling every lane's credit once none has any
+    \return lane index or -1 if nothing can run
+*/
+int Open62541::WorkerPool::next()
+{
+    for (int pass = 0; pass < 2; pass++) {
+        bool any = false;
+        for (size_t i = 0; i < LaneCount; i++) {
+            if (runnable(i)) {
+                any = true;
+                if (_lanes[i].credit)
+                    return int(i);
+            }
+        }
+        if (!any)
+            break;
+        for (auto& i : _lanes)
+            i.credit = i.weight;
+    }
+    return -1;
+}
+
+/*!
+    \brief Open62541::WorkerPool::worker
+    Thread body - exits once stopped and the queues are drained
+*/
+void Open62541::WorkerPool::worker()
+{
+    for (;;) {
+        Job job;
+        int lane = -1;
+        {
+            std::unique_lock<std::mutex> l(_mutex);
+            for (;;) {
+                lane = next();
+                if (lane >= 0)
+                    break;
+                if (!_running) {
+                    bool empty = true;
+                    for (const auto& i : _lanes)
+                        empty = empty && i.jobs.empty();
+                    if (empty)
+                        return;  // stopped
+                }
+                _cond.wait(l);
+            }
+            LaneState& s = _lanes[lane];
+            job          = std::move(s.jobs.front());
+            s.jobs.pop_front();
+            s.credit--;
+            s.busy++;
+        }
+        try {
+            job();
+        }
+        catch (...) {
+            // a failing job must not take the pool down
+        }
+        bool capped = false;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            _lanes[lane].busy--;
+            capped = _lanes[lane].maxThreads != 0;
+        }
+        if (capped)
+            _cond.notify_all();  // a capped lane may run again
+    }
+}
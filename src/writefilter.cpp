@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2017 -  B. J. Hill
+ *
+ * This file is part of open62541 C++ classes. open62541 C++ classes are free software: you can
+ * redistribute it and/or modify it under the terms of the Mozilla Public
+ * License v2.0 as stated in the LICENSE file provided with open62541.
+ *
+ * open62541 C++ classes are distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE.
+ */
+#include <open62541cpp/writefilter.h>
+#include <cmath>
+#include <cstring>
+
+/*!
+    \brief Open62541::WriteFilter::update
+    Recompute the fast path flag - called with the mutex held
+*/
+void Open62541::WriteFilter::update()
+{
+    _enabled = _defaultOn || (_rulesOn > 0);
+}
+
+/*!
+    \brief Open62541::WriteFilter::setDefault
+    \param on
+    \param deadband
+*/
+void Open62541::WriteFilter::setDefault(bool on, double deadband)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    if (!on && _defaultOn) {
+        // writes are not remembered while off - values from before would be stale when it is switched on again
+        std::vector<NodeId> drop;
+        for (auto i = _entries.begin(); i != _entries.end(); i++) {
+            if (!i->second.rule)
+                drop.push_back(NodeId(i->first));
+        }
+        for (const NodeId& n : drop) {
+            _entries.remove(n);
+        }
+    }
+    _defaultOn   = on;
+    _defaultBand = deadband;
+    update();
+}
+
+/*!
+    \brief Open62541::WriteFilter::setNode
+    \param node
+    \param on
+    \param deadband
+*/
+void Open62541::WriteFilter::setNode(const UA_NodeId& node, bool on, double deadband)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node);
+    if (!e)
+        e = &_entries.put(node);
+    if (e->rule && e->on)
+        _rulesOn--;
+    if (!on) {
+        e->known = false;  // not kept up to date while off
+        e->last.null();
+    }
+    else {
+        _rulesOn++;
+    }
+    e->rule     = true;
+    e->on       = on;
+    e->deadband = deadband;
+    update();
+}
+
+/*!
+    \brief Open62541::WriteFilter::clearNode
+    \param node
+*/
+void Open62541::WriteFilter::clearNode(const UA_NodeId& node)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node);
+    if (e) {
+        if (e->rule && e->on)
+            _rulesOn--;
+        _entries.remove(node);
+        update();
+    }
+}
+
+/*!
+    \brief Open62541::WriteFilter::clearNodes
+    \param nodes
+*/
+void Open62541::WriteFilter::clearNodes(const std::vector<UA_NodeId>& nodes)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    for (const UA_NodeId& n : nodes) {
+        Entry* e = _entries.value(n);
+        if (e) {
+            if (e->rule && e->on)
+                _rulesOn--;
+            _entries.remove(n);
+        }
+    }
+    update();
+}
+
+/*!
+    \brief Open62541::WriteFilter::forget
+    \param node
+*/
+void Open62541::WriteFilter::forget(const UA_NodeId& node)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node);
+    if (e) {
+        if (e->rule) {
+            e->known = false;
+            e->last.null();
+        }
+        else {
+            _entries.remove(node);
+        }
+    }
+}
+
+/*!
+    \brief Open62541::WriteFilter::clear
+*/
+void Open62541::WriteFilter::clear()
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    _entries.clearAll();
+    _defaultOn = false;
+    _rulesOn   = 0;
+    update();
+}
+
+/*!
+    \brief Open62541::WriteFilter::changed
+    \param node
+    \param value
+    \return
+*/
+bool Open62541::WriteFilter::changed(const UA_NodeId& node, const UA_Variant& value)
+{
+    std::lock_guard<std::mutex> l(_mutex);
+    Entry* e = _entries.value(node);
+    const bool on         = e && e->rule ? e->on : _defaultOn;
+    const double deadband = e && e->rule ? e->deadband : _defaultBand;
+    if (!on) {
+        _passed++;
+        return true;
+    }
+    if (e && e->known && same(e->last.get(), value, deadband)) {
+        _skipped++;
+        return false;
+    }
+    if (!e)
+        e = &_entries.put(node);
+    e->last.assignFrom(value);
+    e->known = true;
+    _passed++;
+    return true;
+}
+
+/*!
+    \brief Open62541::WriteFilter::same
+    \param a
+    \param b
+    \param deadband
+    \return
+*/
+bool Open62541::WriteFilter::same(const UA_Variant& a, const UA_Variant& b, double deadband)
+{
+    if (a.type != b.type)
+        return false;
+    if (!a.type)
+        return true;  // both empty
+    if (UA_Variant_isScalar(&a) != UA_Variant_isScalar(&b))
+        return false;
+    const size_t n = UA_Variant_isScalar(&a) ? 1 : a.arrayLength;
+    if (n != (UA_Variant_isScalar(&b) ? 1 : b.arrayLength))
+        return false;
+    if (a.arrayDimensionsSize != b.arrayDimensionsSize)
+        return false;
+    if (a.arrayDimensionsSize &&
+        std::memcmp(a.arrayDimensions, b.arrayDimensions, a.arrayDimensionsSize * sizeof(UA_UInt32)) != 0)
+        return false;
+    if (n == 0)
+        return true;
+    if (deadband > 0.0) {
+        if (a.type == &UA_TYPES[UA_TYPES_DOUBLE]) {
+            const UA_Double* x = static_cast<const UA_Double*>(a.data);
+            const UA_Double* y = static_cast<const UA_Double*>(b.data);
+            for (size_t i = 0; i < n; i++) {
+                if (!(std::fabs(x[i] - y[i]) <= deadband))
+                    return false;  // NaN is always a change
+            }
+            return true;
+        }
+        if (a.type == &UA_TYPES[UA_TYPES_FLOAT]) {
+            const UA_Float* x = static_cast<const UA_Float*>(a.data);
+            const UA_Float* y = static_cast<const UA_Float*>(b.data);
+            for (size_t i = 0; i < n; i++) {
+                if (!(std::fabs(double(x[i]) - double(y[i])) <= deadband))
+                    return false;
+            }
+            return true;
+        }
+    }
+    if (a.type->typeKind <= UA_DATATYPEKIND_DOUBLE)
+        return std::memcmp(a.data, b.data, n * a.type->memSize) == 0;  // numbers have no padding
+    if (a.type->pointerFree) {
+        // structures may have padding bytes that differ - compare member by member
+        const UA_Byte* x = static_cast<const UA_Byte*>(a.data);
+        const UA_Byte* y = static_cast<const UA_Byte*>(b.data);
+        for (size_t i = 0; i < n; i++) {
+            const size_t o = i * a.type->memSize;
+            if (UA_order(x + o, y + o, a.type) != UA_ORDER_EQ)
+                return false;
+        }
+        return true;
+    }
+    if ((a.type == &UA_TYPES[UA_TYPES_STRING]) || (a.type == &UA_TYPES[UA_TYPES_BYTESTRING]) ||
+        (a.type == &UA_TYPES[UA_TYPES_XMLELEMENT])) {
+        const UA_String* x = static_cast<const UA_String*>(a.data);
+        const UA_String* y = static_cast<const UA_String*>(b.data);
+        for (size_t i = 0; i < n; i++) {
+            if (!UA_String_equal(&x[i], &y[i]))
+                return false;
+        }
+        return true;
+    }
+    return false;  // structured types always write
+}